@@ -164,6 +164,36 @@ def write_seq(path, duration, events):
     Path(path).write_text("\n".join(lines), encoding="utf-8")
 
 
+def sample_features(sample):
+    """Flat feature list in [0,1] of an image (row-major) or a 1D sample (clamped)."""
+    if isinstance(sample, list) and isinstance(sample[0], list):
+        # 2D (image): already [0,1] for MNIST/Fashion/Sklearn; keep as-is
+        vec, _, _ = image_to_vectors(sample)
+        return vec
+    # 1D (spiral 2D, parity bits, etc.): keep within [0,1]
+    return [min(1.0, max(0.0, v)) for v in sample]
+
+def write_features_csv(path, it, max_samples):
+    """
+    Raw features instead of .seq files, for encoding on the fly in C++
+    (enc::FeatureDataset::loadCsv / glia.EncodedDataset.from_csv): "label,f0,f1,..." rows.
+    """
+    count = 0
+    with open(path, "w", newline="", encoding="utf-8") as f:
+        w = csv.writer(f)
+        header_written = False
+        for sample, label in it:
+            if count >= max_samples:
+                break
+            feature_vals = sample_features(sample)
+            if not header_written:
+                w.writerow(["label"] + [f"f{i}" for i in range(len(feature_vals))])
+                header_written = True
+            w.writerow([label] + [f"{v:.6g}" for v in feature_vals])
+            count += 1
+    return count
+
+
 # ------------------------------
 # Main
 # ------------------------------
@@ -173,7 +203,8 @@ def main():
     p.add_argument("--split", choices=["train","test"], default="test", help="For MNIST/Fashion.")
     p.add_argument("--outdir", type=str, default="out_seqs")
     p.add_argument("--max-samples", type=int, default=1000, help="Cap number of samples to export.")
-    p.add_argument("--encoding", choices=["poisson","rate","latency"], default="poisson")
+    p.add_argument("--encoding", choices=["poisson","rate","latency","features"], default="poisson",
+                   help="'features' writes features.csv (raw features, encoded on the fly by the trainers) instead of .seq files.")
     p.add_argument("--duration", type=int, default=50, help="Total ticks per sample.")
     p.add_argument("--amp", type=float, default=200.0, help="Injection amount per event (scales lines’ third column).")
     p.add_argument("--max-rate", type=float, default=0.5, help="Max spikes/tick for poisson encoding when feature=1.0.")
@@ -216,6 +247,12 @@ def main():
     else:  # parity
         it = gen_parity(n_bits=args.parity_bits, n_samples=args.parity_samples, seed=args.rng_seed)
 
+    if args.encoding == "features":
+        features_path = outdir / "features.csv"
+        count = write_features_csv(features_path, it, args.max_samples)
+        print(f"Done. Wrote {count} samples to {features_path}.")
+        return
+
     label_path = outdir / "labels.csv"
     with open(label_path, "w", newline="", encoding="utf-8") as f:
         w = csv.writer(f)
@@ -227,16 +264,7 @@ def main():
                 break
 
             # Normalize & flatten features
-            if isinstance(sample, list) and isinstance(sample[0], list):
-                # 2D (image)
-                vec, h, w_ = image_to_vectors(sample)
-                # already [0,1] for MNIST/Fashion/Sklearn; keep as-is
-                feature_vals = vec
-            else:
-                # 1D (spiral 2D, parity bits, etc.)
-                feature_vals = sample
-                # Keep within [0,1]; if not, normalize:
-                feature_vals = [min(1.0, max(0.0, v)) for v in feature_vals]
+            feature_vals = sample_features(sample)
 
             # Encode
             if args.encoding == "poisson":
@@ -2,7 +2,7 @@ import os, math, random, argparse, json, pathlib
 from dataclasses import dataclass
 from typing import List, Tuple, Dict
 import numpy as np
-from seq_writer import write_seq, SeqHeader
+from seq_writer import write_seq, SeqHeader, DatasetWriter
 
 # ---------------------------
 # Helpers
@@ -205,6 +205,10 @@ def main():
     # mapping/export
     ap.add_argument("--id-prefix", type=str, default="S")
     ap.add_argument("--injection-scale", type=float, default=200.0)
+    ap.add_argument("--dataset", action="store_true",
+                    help="also pack all clips into <out>/episodes.gds (target O<n_objects>)")
+    ap.add_argument("--no-seq", action="store_true",
+                    help="skip the per-clip .seq text files (use with --dataset)")
 
     args = ap.parse_args()
     seed_all(args.seed)
@@ -222,6 +226,7 @@ def main():
 
     # labels header
     labels_rows = [("clip_id","tick","true_count")]
+    dataset = DatasetWriter() if args.dataset else None
 
     for clip_id in range(args.clips):
         def make_objs():
@@ -244,9 +249,12 @@ def main():
                                   args.id_prefix, args.injection_scale,
                                   args.max_events_per_bin)
         duration_ticks = int(math.ceil((args.duration_s*1000.0) / args.bin_ms))
-        write_seq(str(out / "seq" / f"clip_{clip_id:05d}.seq"),
-                  SeqHeader(duration_ticks=duration_ticks, loop=False),
-                  rows)
+        if not args.no_seq:
+            write_seq(str(out / "seq" / f"clip_{clip_id:05d}.seq"),
+                      SeqHeader(duration_ticks=duration_ticks, loop=False),
+                      rows)
+        if dataset is not None:
+            dataset.add(rows, label=f"O{sim['n_objects']}", name=f"clip_{clip_id:05d}")
 
         # Labels (count per tick, using the exact n_objects from this sim)
         for tick in range(duration_ticks):
@@ -256,6 +264,8 @@ def main():
     import csv
     with open(out / "labels" / "labels_counts.csv", "w", newline="", encoding="utf-8") as f:
         csv.writer(f).writerows(labels_rows)
+    if dataset is not None:
+        dataset.write(str(out / "episodes.gds"))
 
 if __name__ == "__main__":
     main()
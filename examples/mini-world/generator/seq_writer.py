@@ -1,3 +1,6 @@
+import struct
+import sys
+from array import array
 from dataclasses import dataclass
 from typing import Iterable, Tuple
 
@@ -17,3 +20,93 @@ def write_seq(path: str, header: SeqHeader, rows: Iterable[Tuple[int, str, float
         for tick, sid, inj in rows:
             f.write(f"{tick} {sid} {inj:.6f}\n")
 
+
+
+class DatasetWriter:
+    """
+    Packs many clips into one binary spike dataset (.gds, see src/data/spike_dataset.h),
+    which the C++ side memory-maps instead of parsing thousands of .seq files.
+
+        w = DatasetWriter()
+        w.add(rows, label="O2", name="clip_00000")
+        w.write("run1/episodes.gds")
+
+    Events are stored as InputSequence replays a .seq: sorted by tick, then sensory ID,
+    with the last value winning when a (tick, ID) pair repeats.
+    """
+    MAGIC = b"GDST"
+    VERSION = 1
+    HEADER = struct.Struct("<4sIQQIIQ8Q")
+    EPISODE = struct.Struct("<IIIIII")
+
+    def __init__(self):
+        self._strings = bytearray()
+        self._channels = {}   # id -> index
+        self._labels = {}
+        self._channel_refs = []
+        self._label_refs = []
+        self._episodes = []   # (label, flags, duration, name_ref)
+        self._event_offsets = array("Q", [0])
+        self._ticks = array("I")
+        self._channel_index = array("I")
+        self._values = array("f")
+
+    def _string(self, s: str) -> Tuple[int, int]:
+        b = s.encode("utf-8")
+        ref = (len(self._strings), len(b))
+        self._strings += b
+        return ref
+
+    def _index(self, table, refs, key: str) -> int:
+        i = table.get(key)
+        if i is None:
+            i = table[key] = len(refs)
+            refs.append(self._string(key))
+        return i
+
+    def add(self, rows: Iterable[Tuple[int, str, float]], label: str, name: str = "", loop: bool = False):
+        merged = {}
+        for tick, sid, inj in rows:
+            if tick >= 0:
+                merged[(int(tick), sid)] = float(inj)
+        for (tick, sid) in sorted(merged):
+            self._ticks.append(tick)
+            self._channel_index.append(self._index(self._channels, self._channel_refs, sid))
+            self._values.append(merged[(tick, sid)])
+        self._event_offsets.append(len(self._ticks))
+        duration = max((t for t, _ in merged), default=-1) + 1
+        self._episodes.append((self._index(self._labels, self._label_refs, label),
+                               1 if loop else 0, duration, self._string(name)))
+
+    def __len__(self) -> int:
+        return len(self._episodes)
+
+    def write(self, path: str):
+        align = lambda x: (x + 7) & ~7
+        n, e = len(self._episodes), len(self._ticks)
+        offsets = []
+        pos = self.HEADER.size
+        for size in (8 * len(self._channel_refs), 8 * len(self._label_refs), len(self._strings),
+                     self.EPISODE.size * n, 8 * (n + 1), 4 * e, 4 * e, 4 * e):
+            pos = align(pos)
+            offsets.append(pos)
+            pos += size
+        header = self.HEADER.pack(self.MAGIC, self.VERSION, n, e, len(self._channel_refs),
+                                  len(self._label_refs), len(self._strings), *offsets)
+        refs = lambda rs: b"".join(struct.pack("<II", o, l) for o, l in rs)
+
+        def le(a):
+            # the format is little-endian
+            if sys.byteorder == "big":
+                a = array(a.typecode, a)
+                a.byteswap()
+            return a.tobytes()
+
+        sections = [refs(self._channel_refs), refs(self._label_refs), bytes(self._strings),
+                    b"".join(self.EPISODE.pack(lab, flags, dur, 0, nm[0], nm[1]) for lab, flags, dur, nm in self._episodes),
+                    le(self._event_offsets), le(self._ticks), le(self._channel_index), le(self._values)]
+        with open(path, "wb") as f:
+            f.write(header)
+            for offset, data in zip(offsets, sections):
+                f.write(b"\0" * (offset - f.tell()))
+                f.write(data)
@@ -1,5 +1,5 @@
 // Digits (.seq) trainer and evaluator
-// Loads train/test from labels.csv, trains with gradient (default) or Hebbian, prints progress, saves metrics and net
+// Loads train/test from episodes.gds (packed, see tools/seq_pack.py), features.csv (encoded on the fly) or labels.csv, trains with gradient (default) or Hebbian, prints progress, saves metrics and net
 
 #include <iostream>
 #include <fstream>
@@ -17,6 +17,8 @@
 #include "../../src/arch/glia.h"
 #include "../../src/arch/neuron.h"
 #include "../../src/arch/input_sequence.h"
+#include "../../src/data/spike_dataset.h"
+#include "../../src/data/spike_encoder.h"
 #include "../../src/train/trainer.h"              // wrapper -> hebbian/trainer.h
 #include "../../src/train/training_config.h"      // wrapper -> hebbian/training_config.h
 #include "../../src/train/gradient/rate_gd_trainer.h"
@@ -28,6 +30,9 @@ struct Args {
     int batch = 16;
     int seed = 123456;
     bool hebbian = false;     // default to gradient
+    bool lockstep = false;    // simulate each batch's episodes together (BatchedNetwork)
+    int threads = 1;          // worker threads per batch (>1 implies --lockstep)
+    std::string encoding = "poisson"; // of features.csv splits: poisson | rate | latency
     // Episode/detector
     int warmup = 20;
     int window = 80;
@@ -52,6 +57,10 @@ struct Args {
     std::string train_metrics_csv;
     std::string train_plot_html;
     std::string predictions_csv_test;
+    // On-disk checkpoints (resume with --resume PATH)
+    std::string checkpoint;
+    int checkpoint_every = 1; // epochs
+    std::string resume;
 };
 
 static bool parse_args(int argc, char** argv, Args &a) {
@@ -64,6 +73,9 @@ static bool parse_args(int argc, char** argv, Args &a) {
         else if (k == "--batch") { std::string v; if (!next(v)) return false; a.batch = std::atoi(v.c_str()); }
         else if (k == "--seed") { std::string v; if (!next(v)) return false; a.seed = std::atoi(v.c_str()); }
         else if (k == "--hebbian") { a.hebbian = true; }
+        else if (k == "--lockstep") { a.lockstep = true; }
+        else if (k == "--threads") { std::string v; if (!next(v)) return false; a.threads = std::atoi(v.c_str()); }
+        else if (k == "--encoding") { if (!next(a.encoding)) return false; }
         else if (k == "--warmup") { std::string v; if (!next(v)) return false; a.warmup = std::atoi(v.c_str()); }
         else if (k == "--window") { std::string v; if (!next(v)) return false; a.window = std::atoi(v.c_str()); }
         else if (k == "--alpha") { std::string v; if (!next(v)) return false; a.alpha = std::atof(v.c_str()); }
@@ -84,6 +96,9 @@ static bool parse_args(int argc, char** argv, Args &a) {
         else if (k == "--train_metrics_csv") { if (!next(a.train_metrics_csv)) return false; }
         else if (k == "--train_plot_html") { if (!next(a.train_plot_html)) return false; }
         else if (k == "--predictions_csv_test") { if (!next(a.predictions_csv_test)) return false; }
+        else if (k == "--checkpoint") { if (!next(a.checkpoint)) return false; }
+        else if (k == "--checkpoint_every") { std::string v; if (!next(v)) return false; a.checkpoint_every = std::atoi(v.c_str()); }
+        else if (k == "--resume") { if (!next(a.resume)) return false; }
         else { std::cerr << "Unknown arg: " << k << "\n"; return false; }
     }
     // Only data_root is required; net is optional (a default net will be created if omitted)
@@ -149,6 +164,41 @@ static bool read_labels_list(const std::string &dir, std::vector<std::pair<std::
     return true;
 }
 
+// <dir>/episodes.gds when present (memory-mapped, no parsing), else <dir>/features.csv (raw
+// features kept in `features`, out gets their evaluation draw; see spike_encoder.h), else
+// labels.csv + .seq files. names gets (filename, label) per episode for the predictions CSV.
+static bool load_split(const std::string &dir, std::vector<Trainer::EpisodeData> &out, std::vector<std::pair<std::string,int>> &names,
+                       enc::FeatureDataset &features) {
+    const std::string packed = join_path(dir, "episodes.gds");
+    const std::string feature_csv = join_path(dir, "features.csv");
+    if (!gds::isDatasetFile(packed) && std::ifstream(feature_csv.c_str()).good()) {
+        std::string error;
+        if (!features.loadCsv(feature_csv, error)) { std::cerr << "Could not load " << feature_csv << ": " << error << "\n"; return false; }
+        out.resize(features.size());
+        names.clear();
+        for (size_t i = 0; i < features.size(); ++i) {
+            features.toEpisode(i, EpisodeSource::kEvaluation, out[i]);
+            names.emplace_back("features.csv:" + std::to_string(i), std::atoi(features.label(i).c_str() + 1));
+        }
+        return true;
+    }
+    if (!gds::isDatasetFile(packed)) {
+        read_labels_list(dir, names);
+        return load_labels_csv(dir, out);
+    }
+    gds::Dataset ds;
+    std::string error;
+    if (!ds.open(packed, error)) { std::cerr << "Could not load " << packed << ": " << error << "\n"; return false; }
+    out.resize(ds.size());
+    names.clear();
+    for (size_t i = 0; i < ds.size(); ++i) {
+        ds.toSequence(i, out[i].seq);
+        out[i].target_id = ds.label(i);
+        names.emplace_back(ds.name(i), std::atoi(ds.label(i).c_str() + 1));
+    }
+    return true;
+}
+
 static void print_progress_bar(size_t done, size_t total, double acc, double loss) {
     const int width = 30;
     double frac = (total==0) ? 1.0 : static_cast<double>(done)/static_cast<double>(total);
@@ -260,7 +310,7 @@ static double xent_from_rates(const std::map<std::string,float> &rates,
 int main(int argc, char** argv) {
     Args args;
     if (!parse_args(argc, argv, args)) {
-        std::cout << "Usage: " << argv[0] << " --root <data_root> [--net <net_path> --epochs E --batch B --seed S --hebbian --gd_temperature T --lr L --lambda B --weight_decay D --warmup U --window W --alpha A --threshold T --default OX --save_net PATH --train_metrics_json PATH --train_metrics_csv PATH --train_plot_html PATH --predictions_csv_test PATH]\n";
+        std::cout << "Usage: " << argv[0] << " --root <data_root> [--net <net_path> --epochs E --batch B --seed S --hebbian --lockstep --threads N --encoding poisson|rate|latency --gd_temperature T --lr L --lambda B --weight_decay D --warmup U --window W --alpha A --threshold T --default OX --save_net PATH --train_metrics_json PATH --train_metrics_csv PATH --train_plot_html PATH --predictions_csv_test PATH --checkpoint PATH --checkpoint_every N --resume PATH]\n";
         return 1;
     }
 
@@ -275,12 +325,17 @@ int main(int argc, char** argv) {
 
     // Load datasets
     std::vector<Trainer::EpisodeData> train_set, test_set;
-    if (!load_labels_csv(join_path(args.data_root, "train"), train_set)) return 2;
-    if (!load_labels_csv(join_path(args.data_root, "test"), test_set)) return 3;
+    std::vector<std::pair<std::string,int>> train_names, test_names;
+    enc::EncoderConfig encoder;
+    if (!enc::parseEncoding(args.encoding, encoder.encoding)) { std::cerr << "Unknown encoding: " << args.encoding << "\n"; return 1; }
+    encoder.seed = static_cast<uint64_t>(args.seed);
+    enc::FeatureDataset train_features(0, encoder), test_features(0, encoder);
+    if (!load_split(join_path(args.data_root, "train"), train_set, train_names, train_features)) return 2;
+    if (!load_split(join_path(args.data_root, "test"), test_set, test_names, test_features)) return 3;
     std::cout << "Digits .seq dataset: train=" << train_set.size() << "  test=" << test_set.size() << "\n";
 
     // Network
-    Glia net; net.configureNetworkFromFile(args.net_path);
+    Glia net; net.setBuildSeed(args.seed); net.configureNetworkFromFile(args.net_path);
 
     // Config
     TrainingConfig cfg;
@@ -294,6 +349,8 @@ int main(int argc, char** argv) {
     cfg.weight_decay = args.weight_decay;
     cfg.batch_size = std::max(1, args.batch);
     cfg.shuffle = true;
+    cfg.lockstep_batch = args.lockstep;
+    cfg.batch_threads = std::max(1, args.threads);
     cfg.verbose = true;
     cfg.log_every = 1;
     cfg.seed = args.seed;
@@ -313,24 +370,51 @@ int main(int argc, char** argv) {
     bool use_hebbian = args.hebbian;
 
     // Training loop (custom to collect loss)
-    std::mt19937 rng(cfg.seed);
     std::vector<double> epoch_loss, epoch_acc, epoch_margin;
-    for (int e = 0; e < std::max(1, args.epochs); ++e) {
-        if (cfg.shuffle) std::shuffle(train_set.begin(), train_set.end(), rng);
+    // epoch e's shuffled indices (keyed by (cfg.seed, e), see epochOrder()); batches point
+    // into train_set
+    std::vector<size_t> order;
+    std::vector<const Trainer::EpisodeData*> batch;
+    std::vector<EpisodeMetrics> bm;
+
+    // Checkpoints: the active trainer's state, then this loop's (epochs done, training set
+    // size, per-epoch metrics), written in the background after every --checkpoint_every
+    // epochs
+    const char *ckpt_kind = use_hebbian ? "digits_hebbian" : "digits_gd";
+    int first_epoch = 0;
+    if (!args.resume.empty()) {
+        ckpt::Reader r;
+        bool ok = r.open(args.resume, ckpt_kind) && (use_hebbian ? hebb_trainer.loadState(r) : gd_trainer.loadState(r));
+        if (ok) {
+            first_epoch = r.i32();
+            const uint64_t n = r.u64();
+            epoch_loss = r.vec<double>(); epoch_acc = r.vec<double>(); epoch_margin = r.vec<double>();
+            if (r.ok() && n != train_set.size()) r.fail("checkpoint is of a training set of " + std::to_string(n) + " episodes");
+            ok = r.ok();
+        }
+        if (!ok) { std::cerr << "Cannot resume: " << r.error() << "\n"; return 4; }
+        std::cout << "Resumed " << args.resume << " after epoch " << first_epoch << "\n";
+    }
+    ckpt::AsyncWriter checkpoint_writer;
+
+    for (int e = first_epoch; e < std::max(1, args.epochs); ++e) {
+        // a features.csv training set is redrawn every epoch
+        for (size_t i = 0; i < train_features.size(); ++i) train_features.toEpisode(i, static_cast<uint64_t>(e), train_set[i]);
+        epochOrder(order, train_set.size(), cfg.shuffle, cfg.seed, static_cast<uint64_t>(e));
         size_t epoch_total = 0, epoch_correct = 0; double epoch_margin_sum = 0.0, epoch_loss_sum = 0.0;
         size_t batches_total = (train_set.size() + static_cast<size_t>(std::max(1, cfg.batch_size)) - 1) / static_cast<size_t>(std::max(1, cfg.batch_size));
         size_t batches_done = 0;
         for (size_t i = 0; i < train_set.size(); i += std::max(1, cfg.batch_size)) {
             size_t j = std::min(train_set.size(), i + static_cast<size_t>(std::max(1, cfg.batch_size)));
-            std::vector<Trainer::EpisodeData> batch(train_set.begin() + i, train_set.begin() + j);
-            std::vector<EpisodeMetrics> bm;
-            if (use_hebbian) hebb_trainer.trainBatch(batch, cfg, &bm);
-            else gd_trainer.trainBatch(batch, cfg, &bm);
+            batch.clear();
+            for (size_t k = i; k < j; ++k) batch.push_back(&train_set[order[k]]);
+            if (use_hebbian) hebb_trainer.trainBatch(batch.data(), batch.size(), cfg, &bm);
+            else gd_trainer.trainBatch(batch.data(), batch.size(), cfg, &bm);
             // compute batch acc, loss, margin
             int correct = 0; double avg_margin = 0.0; double avg_loss = 0.0;
             for (size_t k = 0; k < bm.size() && k < batch.size(); ++k) {
                 const auto &m = bm[k];
-                const auto &ex = batch[k];
+                const auto &ex = *batch[k];
                 if (m.winner_id == ex.target_id) correct++;
                 avg_margin += m.margin;
                 avg_loss += xent_from_rates(m.rates, ex.target_id, cfg.grad.temperature);
@@ -357,7 +441,17 @@ int main(int argc, char** argv) {
                       << "  Margin=" << emag
                       << std::endl;
         }
+        if (!args.checkpoint.empty() && args.checkpoint_every > 0 && (e + 1) % args.checkpoint_every == 0) {
+            ckpt::Writer w(ckpt_kind);
+            if (use_hebbian) hebb_trainer.saveState(w); else gd_trainer.saveState(w);
+            w.i32(e + 1);
+            w.u64(train_set.size());
+            w.vec(epoch_loss); w.vec(epoch_acc); w.vec(epoch_margin);
+            checkpoint_writer.submit(args.checkpoint, w.release());
+        }
     }
+    std::string ckpt_err;
+    if (!checkpoint_writer.flush(&ckpt_err)) std::cerr << ckpt_err << "\n";
 
     // Save trained net
     if (!args.save_net.empty()) {
@@ -381,8 +475,6 @@ int main(int argc, char** argv) {
 
     // Validate on test set
     size_t total = 0, correct = 0; double sum_margin = 0.0;
-    std::vector<std::pair<std::string,int>> test_names;
-    read_labels_list(join_path(args.data_root, "test"), test_names);
     std::vector<EpisodeMetrics> test_metrics;
     test_metrics.reserve(test_set.size());
     std::set<std::string> rate_keys_set;
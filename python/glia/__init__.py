@@ -25,8 +25,8 @@ except ImportError as e:
     ) from e
 
 # High-level Python wrappers (Pythonic API)
-from .network import Network
-from .trainer import Trainer
+from .network import Network, spike_arrays, save_spikes_npz, load_spikes
+from .trainer import Trainer, evaluate_ensemble
 from .evolution import Evolution, plot_evolution_result
 from .data import (
     Dataset,
@@ -46,14 +46,45 @@ from ._core import (
     OutputDetectorConfig,
     EpisodeData,
     EpisodeMetrics,
+    DatasetMetrics,
+    EnsembleMetrics,
+    EnsembleEvaluator,
+    EncodedDataset,
+    EventWorld,
+    EventWorldConfig,
+    Polarity,
+    EncoderConfig,
+    Encoding,
     EvolutionConfig,
     EvoMetrics,
     NetworkSnapshot,
     EvolutionResult,
     EdgeRecord,
     NeuronRecord,
+    SweepEngine,
+    SweepParam,
+    SweepConfig,
+    SweepTrial,
+    SweepResult,
     RateGDTrainer,  # Gradient-based trainer for supervised learning
+    BpttTrainer,  # Surrogate-gradient backprop through time
+    OnlineTrainer,  # Continuous learning on a pushed event stream
+    OnlineLimits,
+    OnlineStats,
+    ProfileStats,
+    profiling_enabled,
+    SpikeRecorder,
+    ThreadPool,
+    TelemetryExporter,
+    device_available,
+    device_name,
+    InferenceModel,  # Shared read-only model for serving / worker processes
+    InferenceSession,
+    InferenceDecision,
+    InferenceServer,  # Sessions of one model run by a background thread
+    InferenceServerConfig,
 )
+from .aio import AsyncInferenceServer, AsyncSession
 
 # Visualization (optional - only if dependencies installed)
 try:
@@ -76,7 +107,11 @@ __all__ = [
     "load_dataset_from_directory",
     "create_config",
     "create_evo_config",
+    "evaluate_ensemble",
     "plot_evolution_result",
+    "spike_arrays",
+    "save_spikes_npz",
+    "load_spikes",
     # C++ types (direct access)
     "Neuron",
     "InputSequence",
@@ -85,12 +120,43 @@ __all__ = [
     "OutputDetectorConfig",
     "EpisodeData",
     "EpisodeMetrics",
+    "DatasetMetrics",
+    "EnsembleMetrics",
+    "EnsembleEvaluator",
+    "OnlineTrainer",
+    "OnlineLimits",
+    "OnlineStats",
+    "EncodedDataset",
+    "EventWorld",
+    "EventWorldConfig",
+    "Polarity",
+    "EncoderConfig",
+    "Encoding",
     "EvolutionConfig",
     "EvoMetrics",
     "NetworkSnapshot",
     "EvolutionResult",
     "EdgeRecord",
     "NeuronRecord",
+    "SweepEngine",
+    "SweepParam",
+    "SweepConfig",
+    "SweepTrial",
+    "SweepResult",
+    "ProfileStats",
+    "profiling_enabled",
+    "SpikeRecorder",
+    "ThreadPool",
+    "TelemetryExporter",
+    "device_available",
+    "device_name",
+    "InferenceModel",
+    "InferenceSession",
+    "InferenceDecision",
+    "InferenceServer",
+    "InferenceServerConfig",
+    "AsyncInferenceServer",
+    "AsyncSession",
     # Visualization (if available)
     "viz",
 ]
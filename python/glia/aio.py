@@ -0,0 +1,189 @@
+"""
+asyncio interface to InferenceServer
+
+The simulation runs in C++ on the server's driver thread and thread pool: push() only
+queues input (GIL released while it is copied), and decisions come back as awaitables,
+so an event loop never steps a network itself. Many servers (one per model) can share
+one ThreadPool to serve several networks from one process.
+"""
+import asyncio
+import weakref
+from typing import Optional
+from . import _core
+
+# queued after a session's last decision when it closes
+_CLOSED = object()
+
+
+class AsyncSession:
+    """
+    One input stream of an AsyncInferenceServer
+
+    Example:
+        >>> session = server.open()
+        >>> session.push(chunk)                 # [T, S] array or (ticks, handles, values)
+        >>> d = await session.decision()        # next reported decision
+        >>> async for d in session: ...         # every decision as it comes, until close()
+    """
+
+    def __init__(self, server: "AsyncInferenceServer", session_id: int):
+        self._server = server
+        self.id = session_id
+        self._decisions: asyncio.Queue = asyncio.Queue()
+        self._epoch = 0  # bumped by reset(); decisions of an earlier epoch are dropped
+        self._closed = False
+
+    def _deliver(self, epoch: int, decision) -> None:
+        if epoch == self._epoch and not self._closed:
+            self._decisions.put_nowait(decision)
+
+    def push(self, inputs, n_ticks: int = -1) -> None:
+        """
+        Queue ticks of input; returns at once, the ticks run in the background
+
+        Args:
+            inputs: [T, S] float array (row t goes into sensory handles 0..S-1) or a
+                    (ticks, handles, values) tuple of arrays, ticks relative to this chunk
+            n_ticks: ticks to queue (default: T, or the last event tick + 1)
+        """
+        if self._closed or not self._server._cpp.push(self.id, inputs, n_ticks):
+            raise RuntimeError(f"session {self.id} is closed")
+
+    async def decision(self) -> _core.InferenceDecision:
+        """
+        Next decision the server reports (every decision_every ticks, if set)
+
+        Raises RuntimeError once the session is closed and its decisions are read.
+        """
+        d = await self._decisions.get()
+        if d is _CLOSED:
+            self._decisions.put_nowait(_CLOSED)  # for the other waiters
+            raise RuntimeError(f"session {self.id} is closed")
+        return d
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self) -> _core.InferenceDecision:
+        try:
+            return await self.decision()
+        except RuntimeError:
+            if self._closed:
+                raise StopAsyncIteration
+            raise
+
+    @property
+    def latest(self) -> _core.InferenceDecision:
+        """Decision after the last tick run so far"""
+        return self._server._cpp.decision(self.id)
+
+    def reset(self) -> None:
+        """
+        Back to the initial state; queued ticks and unread decisions are dropped, and
+        coroutines awaiting decision() get the first one after the reset
+        """
+        if self._closed:
+            return
+        # returns once the session isn't running, so every earlier decision is already
+        # handed to the loop and carries the old epoch
+        self._server._cpp.reset(self.id)
+        self._epoch += 1
+        while not self._decisions.empty():
+            self._decisions.get_nowait()
+
+    def close(self) -> None:
+        """Stop the session; decision() raises RuntimeError (async for ends) after the unread ones"""
+        if self._closed:
+            return
+        self._closed = True
+        self._server._sessions.pop(self.id, None)
+        self._server._cpp.close(self.id)
+        self._decisions.put_nowait(_CLOSED)
+
+    def __repr__(self) -> str:
+        return f"<AsyncSession id={self.id} pending={self._decisions.qsize()}>"
+
+
+class AsyncInferenceServer:
+    """
+    Sessions of one InferenceModel served from an asyncio event loop
+
+    Input chunks are queued without blocking the loop; a C++ driver thread runs the
+    queued ticks of all sessions over the thread pool and each decision resolves the
+    session's pending decision() on the loop.
+
+    Example:
+        >>> model = glia.InferenceModel("digits.gnet")
+        >>> async with glia.AsyncInferenceServer(model, decision_every=50, threads=8) as server:
+        ...     session = server.open()
+        ...     session.push(events)
+        ...     d = await session.decision()
+    """
+
+    def __init__(
+        self,
+        model: _core.InferenceModel,
+        config: Optional[_core.InferenceServerConfig] = None,
+        *,
+        decision_every: Optional[int] = None,
+        threads: Optional[int] = None,
+        pool: Optional[_core.ThreadPool] = None,
+        loop: Optional[asyncio.AbstractEventLoop] = None,
+    ):
+        """
+        Args:
+            model: Model every session runs
+            config: Detector, decision window, threads (default InferenceServerConfig())
+            decision_every: Override config.decision_every (report every N ticks)
+            threads: Override config.threads (sessions run at once)
+            pool: ThreadPool to run on, e.g. one shared by several servers
+            loop: Event loop to resolve decisions on (default: the running loop)
+        """
+        cfg = config or _core.InferenceServerConfig()
+        if decision_every is not None:
+            cfg.decision_every = decision_every
+        if threads is not None:
+            cfg.threads = threads
+        self._loop = loop or asyncio.get_running_loop()
+        self._sessions = {}
+        self._cpp = _core.InferenceServer(model, cfg)
+        if pool is not None:
+            self._cpp.set_thread_pool(pool)
+
+        # the C++ server holds the callback, so it must not hold the server
+        ref = weakref.ref(self)
+
+        def on_decision(session_id, decision):
+            # a pool worker, with the GIL: hand over to the loop and return
+            server = ref()
+            session = server._sessions.get(session_id) if server is not None else None
+            if session is not None:
+                server._loop.call_soon_threadsafe(session._deliver, session._epoch, decision)
+
+        self._cpp.set_on_decision(on_decision)
+        self._cpp.start()
+
+    def open(self) -> AsyncSession:
+        """New session"""
+        session = AsyncSession(self, self._cpp.open())
+        self._sessions[session.id] = session
+        return session
+
+    @property
+    def queued_ticks(self) -> int:
+        """Ticks pushed and not yet run"""
+        return self._cpp.queued_ticks
+
+    async def aclose(self) -> None:
+        """Run the ticks still queued and stop, without blocking the loop"""
+        if self._cpp.running:
+            await self._loop.run_in_executor(None, self._cpp.stop)
+
+    async def __aenter__(self) -> "AsyncInferenceServer":
+        return self
+
+    async def __aexit__(self, *exc) -> None:
+        await self.aclose()
+
+    def __repr__(self) -> str:
+        return f"<AsyncInferenceServer sessions={len(self._sessions)} queued_ticks={self.queued_ticks}>"
@@ -81,6 +81,22 @@ class Dataset:
         
         return cls.from_sequences(sequences, targets)
     
+    @classmethod
+    def from_packed(cls, path: str) -> 'Dataset':
+        """
+        Load a packed spike dataset (.gds)
+        
+        The file is memory-mapped and decoded in C++ without text parsing; see
+        tools/seq_pack.py to convert a labels.csv + .seq directory.
+        
+        Args:
+            path: Path to a .gds file
+            
+        Returns:
+            Dataset with the file's episodes and target IDs
+        """
+        return cls(_core.SpikeDataset(path).episodes())
+    
     def split(
         self,
         train_fraction: float = 0.8,
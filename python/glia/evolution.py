@@ -62,10 +62,28 @@ class Evolution:
             callbacks
         )
     
+    def set_thread_pool(self, pool: Optional[_core.ThreadPool]) -> None:
+        """Run individuals and their inner training on this ThreadPool (None: evo_config.pool_threads)"""
+        self._engine.set_thread_pool(pool)
+    
+    def set_telemetry(self, sink: Optional[_core.TelemetryExporter]) -> None:
+        """Send per-individual and per-generation records to a TelemetryExporter (None: detach)"""
+        self._engine.set_telemetry(sink)
+    
+    def serve(self, host: str, port: int) -> None:
+        """
+        Work for a coordinator: evaluate the individuals its run() hands out until it finishes
+        
+        The coordinator sets evo_config.listen_port; this engine must be built from the same
+        network, data and configs (a mismatch raises RuntimeError).
+        """
+        self._engine.serve_worker(host, port)
+    
     def run(
         self,
         on_generation: Optional[Callable[[int, _core.NetworkSnapshot, _core.EvoMetrics], None]] = None,
-        verbose: bool = True
+        verbose: bool = True,
+        resume_from: Optional[str] = None
     ) -> _core.EvolutionResult:
         """
         Run evolutionary training
@@ -77,6 +95,8 @@ class Evolution:
         Args:
             on_generation: Callback(generation, best_genome, metrics) 
             verbose: Print progress
+            resume_from: Checkpoint written by a run with evo_config.checkpoint_path
+                         set; evolution continues after its last generation
             
         Returns:
             Evolution result with best genome and history
@@ -85,6 +105,9 @@ class Evolution:
             print("Warning: Python callbacks during evolution not yet supported.")
             print("Evolution will run with full GIL release (faster) but no callbacks.")
         
+        if resume_from is not None:
+            self._engine.load_checkpoint(resume_from)
+        
         # Run evolution (full GIL release)
         result = self._engine.run()
         
@@ -53,6 +53,34 @@ class Network:
         """Save network to file"""
         self._net.save(filepath)
     
+    def reorder(self) -> None:
+        """
+        Renumber interneurons and outputs by distance from the inputs so spike
+        delivery touches neighbouring memory. Spike timing is unchanged; neuron IDs
+        and sensory handles stay, other handles change.
+        """
+        self._net.reorder_neurons()
+    
+    def freeze(self, filepath: str, min_weight: float = 0.0, reorder: bool = True) -> None:
+        """
+        Save a compact inference copy in .gnet format.
+
+        Edges with |weight| < min_weight are dropped, then every neuron that can't
+        affect an output (not reached from the inputs, or no path to an O* neuron),
+        and the rest are renumbered by layer. This network is left unchanged.
+        """
+        self._net.save_frozen(filepath, min_weight, reorder)
+    
+    def clone(self) -> 'Network':
+        """
+        Deep copy of this network (parameters, state and connections)
+        
+        Cheaper than reloading the file when many copies are needed.
+        """
+        net = Network.__new__(Network)
+        net._net = self._net.clone()
+        return net
+    
     def step(self, n_steps: int = 1) -> None:
         """
         Run simulation steps
@@ -60,8 +88,40 @@ class Network:
         Args:
             n_steps: Number of timesteps to simulate
         """
-        for _ in range(n_steps):
+        if n_steps == 1:
             self._net.step()
+        else:
+            self._net.run(None, n_steps, "none")
+    
+    def run(
+        self,
+        inputs=None,
+        n_ticks: Optional[int] = None,
+        record: str = "raster"
+    ) -> Optional[np.ndarray]:
+        """
+        Run many timesteps in a single C++ call (GIL released throughout)
+        
+        Args:
+            inputs: Dense [T, S] array (row t is injected into the first S sensory
+                neurons, in sensory_ids order, before tick t), a sparse
+                (ticks, handles, values) tuple of arrays, or None
+            n_ticks: Ticks to run (default: T, or the last event tick + 1)
+            record: 'raster' for a bool [n_ticks, num_neurons] spike raster,
+                'counts' / 'rates' for spikes / spikes per tick per neuron,
+                or 'none'
+                
+        Returns:
+            Recorded array in neuron_ids order, or None for record='none'
+            
+        Example:
+            >>> raster = net.run(np.full((100, 2), 60.0, dtype=np.float32))
+            >>> rates = net.run((ticks, handles, values), 200, record="rates")
+        """
+        out = self._net.run(inputs, -1 if n_ticks is None else n_ticks, record)
+        if record == "raster":
+            return out.view(bool)
+        return out
     
     def inject(self, neuron_id: str, amount: float) -> None:
         """Inject current into a sensory neuron"""
@@ -77,8 +137,10 @@ class Network:
         Example:
             >>> net.inject_dict({"S0": 100.0, "S1": 50.0})
         """
-        for neuron_id, amount in inputs.items():
-            self._net.inject(neuron_id, amount)
+        ids = list(inputs.keys())
+        handles = self._net.get_handles(ids)
+        values = np.fromiter((inputs[i] for i in ids), dtype=np.float32, count=len(ids))
+        self._net.inject_batch(handles, values)
     
     def inject_array(self, values: np.ndarray) -> None:
         """
@@ -92,14 +154,12 @@ class Network:
             raise ValueError(
                 f"Array length {len(values)} doesn't match sensory neuron count {len(sensory_ids)}"
             )
-        for neuron_id, value in zip(sensory_ids, values):
-            self._net.inject(neuron_id, float(value))
+        self._net.inject_batch(self._net.get_handles(sensory_ids), np.asarray(values, dtype=np.float32))
     
     def reset(self) -> None:
-        """Reset network to initial state (reload from last load/save)"""
-        # For now, just set all values to resting
-        ids, _, thresholds, leaks = self.get_state()
-        self._net.set_state(ids, thresholds, leaks)
+        """Put every neuron at rest (value = resting, nothing staged, no refractory count,
+        adaptation or spike). Thresholds, leaks and weights are kept."""
+        self._net.reset_state()
     
     # ========== State Access ==========
     
@@ -140,6 +200,69 @@ class Network:
         """Set synaptic weights from edge list"""
         self._net.set_weights(from_ids, to_ids, weights)
     
+    def views(self) -> Dict[str, any]:
+        """
+        Zero-copy NumPy views of the simulation arrays, indexed by handle
+        
+        Returns:
+            Dictionary with keys 'ids' (handle -> neuron ID), 'num_sensory',
+            writable 'values', 'thresholds', 'leaks', 'resting', 'weights' and
+            read-only CSR 'row_offsets', 'row_split', 'targets'
+            
+        Edits take effect on the next step; call commit_views() before save(),
+        clone() or Neuron-level edits. Fetch new views after structural changes.
+        
+        Example:
+            >>> v = net.views()
+            >>> src = np.repeat(np.arange(len(v['ids'])), np.diff(v['row_offsets']))
+            >>> v['weights'][src == 0] *= 0.5
+            >>> net.commit_views()
+        """
+        return self._net.views()
+    
+    def commit_views(self) -> None:
+        """Copy parameter and weight edits made through views() into the neurons"""
+        self._net.commit_views()
+    
+    # ========== Spike Recording ==========
+    
+    def record_spikes(
+        self,
+        mode: str = "events",
+        capacity: int = 1 << 20,
+        neurons: Optional[List] = None
+    ) -> _core.SpikeRecorder:
+        """
+        Record spikes in C++ after every step, replacing any recorder attached before
+        
+        Args:
+            mode: 'events' keeps (tick, handle) pairs, 'raster' a bit-packed row per tick
+            capacity: Spikes ('events') or ticks ('raster') kept; older ones are
+                overwritten
+            neurons: Neuron IDs or handles to record (default: all)
+            
+        Returns:
+            The attached SpikeRecorder; read it with spikes()/raster() or
+            spike_arrays(), write it with save() or save_spikes_npz()
+            
+        Example:
+            >>> rec = net.record_spikes("events", capacity=1_000_000)
+            >>> net.run(inputs, record="none")
+            >>> arrays = spike_arrays(rec)
+        """
+        rec = _core.SpikeRecorder(mode, capacity)
+        if neurons is not None:
+            handles = [self._net.get_handle(n) if isinstance(n, str) else int(n) for n in neurons]
+            if any(h < 0 or h >= self.num_neurons for h in handles):
+                raise ValueError("unknown neuron in neurons")
+            rec.set_neurons(handles)
+        self._net.set_spike_recorder(rec)
+        return rec
+    
+    def stop_recording(self) -> None:
+        """Detach the spike recorder (it keeps what it recorded)"""
+        self._net.set_spike_recorder(None)
+    
     # ========== Properties ==========
     
     @property
@@ -173,6 +296,32 @@ class Network:
             'values': weights
         }
     
+    @property
+    def step_threads(self) -> int:
+        """Threads one step runs on (1 = serial); results don't depend on it"""
+        return self._net.get_step_threads()
+    
+    @step_threads.setter
+    def step_threads(self, threads: int) -> None:
+        self._net.set_step_threads(threads)
+    
+    def set_neuron_model(self, model: str, adapt_decay: float = 0.9, adapt_step: float = 10.0) -> None:
+        """
+        Select the neuron model of every step mode
+
+        Args:
+            model: 'lif' (default), 'lif_refractory' (a spike starts the neuron's
+                refractory period) or 'adaptive_threshold'
+            adapt_decay: per-tick decay of the adaptive threshold offset
+            adapt_step: offset added by each spike
+        """
+        self._net.set_neuron_model(model, adapt_decay, adapt_step)
+
+    @property
+    def neuron_model(self) -> str:
+        """Name of the neuron model ('lif', 'lif_refractory' or 'adaptive_threshold')"""
+        return self._net.get_neuron_model()
+    
     @property
     def sensory_ids(self) -> List[str]:
         """Get sensory neuron IDs"""
@@ -206,12 +355,20 @@ class Network:
         Returns:
             List of neuron IDs
         """
-        firing = []
-        for neuron_id in self.neuron_ids:
-            neuron = self.get_neuron(neuron_id)
-            if neuron and neuron.did_fire():
-                firing.append(neuron_id)
-        return firing
+        ids = self.neuron_ids
+        fired = self.get_fired()
+        return [ids[h] for h in np.flatnonzero(fired)]
+    
+    def get_fired(self) -> np.ndarray:
+        """
+        Fired flags of the last timestep, one bool per neuron in neuron_ids order
+        
+        Returns:
+            Boolean array of length num_neurons
+        """
+        mask = self._net.get_fired_mask()
+        bits = np.unpackbits(mask.view(np.uint8), bitorder='little')
+        return bits[:self.num_neurons].astype(bool)
     
     def to_adjacency_matrix(self, dense: bool = False) -> np.ndarray:
         """
@@ -261,3 +418,74 @@ class Network:
     def _cpp(self) -> _core.Network:
         """Access underlying C++ Network object"""
         return self._net
+
+
+def spike_arrays(recorder: _core.SpikeRecorder, unpack: bool = False) -> Dict[str, np.ndarray]:
+    """
+    Copy a SpikeRecorder's contents into NumPy arrays
+    
+    Args:
+        recorder: Recorder to read
+        unpack: For 'raster' recorders, return a bool [rows, columns] raster instead
+            of the packed uint64 words
+            
+    Returns:
+        Dictionary with 'ticks' and 'neurons' (int32 per spike, 'events'), or 'raster'
+        and 'first_tick' ('raster'); plus 'recorded' (handles, empty = all) and
+        'dropped'
+    """
+    out = {
+        'recorded': np.asarray(recorder.neurons(), dtype=np.int32),
+        'dropped': recorder.dropped,
+    }
+    if recorder.mode == "events":
+        spikes = recorder.spikes()
+        out['ticks'] = spikes[:, 0].copy()
+        out['neurons'] = spikes[:, 1].copy()
+    else:
+        words = recorder.raster().copy()
+        out['first_tick'] = recorder.first_tick
+        if unpack:
+            bits = np.unpackbits(words.view(np.uint8), axis=1, bitorder='little')
+            out['raster'] = bits[:, :recorder.columns].astype(bool)
+        else:
+            out['raster'] = words
+    return out
+
+
+def save_spikes_npz(recorder: _core.SpikeRecorder, path: str) -> None:
+    """Write a SpikeRecorder's contents to a compressed .npz (see spike_arrays)"""
+    np.savez_compressed(path, **spike_arrays(recorder))
+
+
+def load_spikes(path: str) -> Dict[str, np.ndarray]:
+    """
+    Read a file written by SpikeRecorder.save()
+    
+    Returns:
+        The same dictionary as spike_arrays() (raster packed), plus 'ticks_recorded'
+    """
+    header = np.dtype([
+        ('magic', 'S4'), ('version', '<u4'), ('mode', '<u4'), ('num_neurons', '<u4'),
+        ('columns', '<u4'), ('words', '<u4'), ('count', '<u8'), ('first_tick', '<i8'),
+        ('ticks', '<u8'), ('dropped', '<u8'),
+    ])
+    raw = np.fromfile(path, dtype=np.uint8)
+    h = raw[:header.itemsize].view(header)[0]
+    if h['magic'] != b'GSPK' or h['version'] != 1:
+        raise ValueError(f"{path}: not a spike recording")
+    pos = (header.itemsize + 7) & ~7
+    n = int(h['num_neurons'])
+    recorded = raw[pos:pos + 4 * n].view('<u4').astype(np.int32)
+    pos = (pos + 4 * n + 7) & ~7
+    count = int(h['count'])
+    out = {'recorded': recorded, 'dropped': int(h['dropped']), 'ticks_recorded': int(h['ticks'])}
+    if h['mode'] == 0:
+        spikes = raw[pos:pos + 8 * count].view('<i4').reshape(count, 2)
+        out['ticks'] = spikes[:, 0].copy()
+        out['neurons'] = spikes[:, 1].copy()
+    else:
+        words = int(h['words'])
+        out['raster'] = raw[pos:pos + 8 * count * words].view('<u8').reshape(count, words)
+        out['first_tick'] = int(h['first_tick'])
+    return out
@@ -98,7 +98,10 @@ class Trainer:
         config: Optional[_core.TrainingConfig] = None,
         on_epoch: Optional[Callable[[int, float, float], None]] = None,
         verbose: bool = True,
-        lr_schedule: Optional[str] = 'cosine'  # 'cosine', 'step', or None
+        lr_schedule: Optional[str] = 'cosine',  # 'cosine', 'step', or None
+        checkpoint_path: Optional[str] = None,
+        checkpoint_every: int = 1,
+        resume: bool = False
     ) -> Dict[str, List[float]]:
         """
         Train for multiple epochs with Python callback support and LR scheduling
@@ -107,7 +110,10 @@ class Trainer:
         Python callbacks, unlike train_epoch_fast() which releases the GIL.
         
         Args:
-            dataset: Training episodes
+            dataset: Training episodes, a SpikeDataset (episodes are then
+                     decoded on a prefetch thread instead of held in memory) or an
+                     EncodedDataset (encoded there, with fresh Poisson spikes per epoch)
+                     or an EventWorld (mini-world clips synthesized there)
             epochs: Number of epochs
             config: Training configuration
             on_epoch: Callback(epoch, accuracy, margin) called after each epoch
@@ -115,12 +121,18 @@ class Trainer:
             lr_schedule: Learning rate schedule ('cosine', 'step', or None)
                         'cosine': Smooth cosine annealing from initial LR to 0.01x
                         'step': Decay by 0.5 every 1/3 of epochs
+            checkpoint_path: Write the full trainer state here every checkpoint_every
+                             epochs (in the background, so training doesn't wait)
+            checkpoint_every: Epochs between checkpoints
+            resume: If checkpoint_path exists, load it and train only the epochs the
+                    interrupted call didn't finish (pass the same epochs and schedule)
             
         Returns:
             Training history dictionary
         """
         cfg = config or self._config
         initial_lr = cfg.lr
+        start = self._setup_checkpoints(cfg, checkpoint_path, checkpoint_every, resume)
         
         # Learning rate schedule function
         def get_lr(epoch: int) -> float:
@@ -137,7 +149,7 @@ class Trainer:
             else:
                 return initial_lr
         
-        for epoch in range(epochs):
+        for epoch in range(start, epochs):
             # Update learning rate
             cfg.lr = get_lr(epoch)
             
@@ -174,6 +186,7 @@ class Trainer:
         
         # Restore original learning rate
         cfg.lr = initial_lr
+        self._finish_checkpoints(cfg, checkpoint_path)
         
         return self._history
     
@@ -181,7 +194,10 @@ class Trainer:
         self,
         dataset: List[_core.EpisodeData],
         epochs: int = 10,
-        config: Optional[_core.TrainingConfig] = None
+        config: Optional[_core.TrainingConfig] = None,
+        checkpoint_path: Optional[str] = None,
+        checkpoint_every: int = 1,
+        resume: bool = False
     ) -> Dict[str, List[float]]:
         """
         Fast training without callbacks (full GIL release)
@@ -190,17 +206,23 @@ class Trainer:
         entire training run, but you can't monitor progress with Python callbacks.
         
         Args:
-            dataset: Training episodes
+            dataset: Training episodes, a SpikeDataset (episodes are then
+                     decoded on a prefetch thread instead of held in memory) or an
+                     EncodedDataset (encoded there, with fresh Poisson spikes per epoch)
+                     or an EventWorld (mini-world clips synthesized there)
             epochs: Number of epochs  
             config: Training configuration
+            checkpoint_path, checkpoint_every, resume: as in train()
             
         Returns:
             Training history dictionary
         """
         cfg = config or self._config
+        start = self._setup_checkpoints(cfg, checkpoint_path, checkpoint_every, resume)
         
         # C++ train_epoch releases GIL for entire duration
-        self._trainer.train_epoch(dataset, epochs, cfg)
+        self._trainer.train_epoch(dataset, max(0, epochs - start), cfg)
+        self._finish_checkpoints(cfg, checkpoint_path)
         
         # Get final history
         acc_hist = self._trainer.get_epoch_acc_history()
@@ -213,43 +235,91 @@ class Trainer:
     
     def evaluate_dataset(
         self,
-        dataset: List[_core.EpisodeData],
+        dataset,
         config: Optional[_core.TrainingConfig] = None
     ) -> Dict[str, Any]:
         """
         Evaluate network on entire dataset
         
+        Every episode starts from the network's current state; they run as parallel
+        lanes in C++ over config.batch_threads workers with the GIL released, and the
+        network is left as it was.
+        
         Args:
-            dataset: Evaluation episodes
+            dataset: Evaluation episodes, a SpikeDataset, an EncodedDataset or an EventWorld
             config: Training config
             
         Returns:
-            Dictionary with accuracy, margin, and per-episode metrics
+            Dictionary with accuracy, margin, correct, total, the confusion matrix
+            (by target and winner, indexing labels; the last row/column count episodes
+            without an output target/winner) and per-episode NumPy arrays
         """
         cfg = config or self._config
+        return _metrics_dict(self._trainer.evaluate_dataset(dataset, cfg))
+    
+    def save_checkpoint(self, path: str) -> None:
+        """
+        Write the full trainer state to a file: network weights and dynamic state,
+        optimizer state (Adam moments and step), RNG, reward baseline, prune
+        counters and history
+        """
+        self._trainer.save_checkpoint(path)
+    
+    def load_checkpoint(self, path: str) -> None:
+        """
+        Resume from a file written by save_checkpoint() or train(checkpoint_path=...);
+        the network must have been built from the same file
+        """
+        self._trainer.load_checkpoint(path)
+        self._history['accuracy'] = list(self._trainer.get_epoch_acc_history())
+        self._history['margin'] = list(self._trainer.get_epoch_margin_history())
+    
+    def _setup_checkpoints(self, cfg, checkpoint_path, checkpoint_every, resume) -> int:
+        """Point cfg at checkpoint_path and resume from it; returns the epochs already done"""
+        if not checkpoint_path:
+            return 0
+        import os
+        start = 0
+        if resume and os.path.exists(checkpoint_path):
+            self.load_checkpoint(checkpoint_path)
+            start = self._trainer.epochs_completed()
+        cfg.checkpoint_path = checkpoint_path
+        cfg.checkpoint_every = checkpoint_every
+        return start
+    
+    def _finish_checkpoints(self, cfg, checkpoint_path) -> None:
+        if checkpoint_path:
+            self._trainer.flush_checkpoints()
+            cfg.checkpoint_path = ""
+    
+    def profile(self) -> _core.ProfileStats:
+        """
+        Phase timers and hot-path counters since construction or reset_profile()
         
-        metrics_list = []
-        correct = 0
-        total_margin = 0.0
-        
-        for episode in dataset:
-            metrics = self._trainer.evaluate(episode.seq, cfg)
-            metrics_list.append(metrics)
-            
-            if metrics.winner_id == episode.target_id:
-                correct += 1
-            total_margin += metrics.margin
+        All zero unless the core was built with GLIA_PROFILE (see profiling_enabled()).
+        """
+        return self._trainer.profile()
+    
+    def reset_profile(self) -> None:
+        """Zero the profiling counters"""
+        self._trainer.reset_profile()
+    
+    def set_thread_pool(self, pool: Optional[_core.ThreadPool]) -> None:
+        """
+        Run batch workers on this ThreadPool (None: config.pool_threads decides)
         
-        accuracy = correct / len(dataset) if dataset else 0.0
-        avg_margin = total_margin / len(dataset) if dataset else 0.0
+        Trainers given the same pool share its threads instead of each using their own.
+        """
+        self._trainer.set_thread_pool(pool)
+    
+    def set_telemetry(self, sink: Optional[_core.TelemetryExporter]) -> None:
+        """
+        Send progress records to a TelemetryExporter (None: detach)
         
-        return {
-            'accuracy': accuracy,
-            'margin': avg_margin,
-            'episodes': metrics_list,
-            'correct': correct,
-            'total': len(dataset)
-        }
+        Every batch, epoch and (GLIA_PROFILE builds) profiling phase becomes a record
+        written by the exporter's thread; batch lines are then no longer printed.
+        """
+        self._trainer.set_telemetry(sink)
     
     def revert_checkpoint(self) -> bool:
         """
@@ -292,3 +362,50 @@ class Trainer:
     def _cpp(self) -> _core.Trainer:
         """Access underlying C++ Trainer object"""
         return self._trainer
+
+
+def _metrics_dict(m: _core.DatasetMetrics) -> Dict[str, Any]:
+    """Trainer.evaluate_dataset()'s dictionary of a DatasetMetrics"""
+    return {
+        'accuracy': m.accuracy,
+        'margin': m.mean_margin,
+        'correct': m.num_correct,
+        'total': m.total,
+        'labels': list(m.labels),
+        'confusion': m.confusion,
+        'winners': m.winner,
+        'targets': m.target,
+        'margins': m.margin,
+        'ticks': m.ticks,
+        'episode_correct': m.correct,
+    }
+
+
+def evaluate_ensemble(
+    networks: List[Network],
+    dataset,
+    config: Optional[_core.TrainingConfig] = None
+) -> Dict[str, Any]:
+    """
+    Evaluate several networks on the same episodes in one pass
+    
+    Each network is scored as Trainer.evaluate_dataset() would score it, but every
+    episode's inputs are decoded once for all of them (EnsembleEvaluator). The
+    networks need the same sensory neuron IDs.
+    
+    Args:
+        networks: Networks to evaluate
+        dataset: Evaluation episodes, a SpikeDataset, an EncodedDataset or an EventWorld
+        config: Training config (detector, warmup, decision window, batch_threads)
+        
+    Returns:
+        Dictionary with 'members' (one evaluate_dataset() dictionary per network) and
+        'vote' (the same for the majority vote: ties go to the larger summed margin, and
+        margins are the lead in votes over the number of networks)
+    """
+    ens = _core.EnsembleEvaluator([n._cpp for n in networks])
+    m = ens.evaluate_dataset(dataset, config or _core.TrainingConfig())
+    return {
+        'members': [_metrics_dict(d) for d in m.members],
+        'vote': _metrics_dict(m.vote),
+    }
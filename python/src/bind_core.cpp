@@ -28,6 +28,8 @@ void bind_network(py::module &m);
 void bind_input_sequence(py::module &m);
 void bind_training(py::module &m);
 void bind_evolution(py::module &m);
+void bind_data(py::module &m);
+void bind_serve(py::module &m);
 
 PYBIND11_MODULE(_core, m) {
     m.doc() = "GliaGL C++ core module - Fast spiking neural network simulator";
@@ -41,4 +43,6 @@ PYBIND11_MODULE(_core, m) {
     bind_input_sequence(m);
     bind_training(m);
     bind_evolution(m);
+    bind_data(m);
+    bind_serve(m);
 }
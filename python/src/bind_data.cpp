@@ -0,0 +1,308 @@
+/**
+ * @file bind_data.cpp
+ * @brief Python bindings for packed spike datasets (.gds)
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <memory>
+#include <stdexcept>
+#include "../../src/data/spike_dataset.h"
+#include "../../src/data/spike_encoder.h"
+#include "../../src/data/event_world.h"
+#include "../../src/train/trainer.h"
+
+namespace py = pybind11;
+
+void bind_data(py::module &m) {
+    py::class_<gds::Dataset, std::shared_ptr<gds::Dataset>>(m, "SpikeDataset",
+        "Packed, memory-mapped spike dataset (.gds)\n\n"
+        "Example:\n"
+        "    >>> ds = SpikeDataset('data/train/episodes.gds')\n"
+        "    >>> trainer.train_epoch(ds.episodes(), epochs=10, config=cfg)\n")
+        
+        .def(py::init([](const std::string &path) {
+            auto ds = std::make_shared<gds::Dataset>();
+            std::string error;
+            if (!ds->open(path, error))
+                throw std::runtime_error(path + ": " + error);
+            return ds;
+        }),
+        py::arg("path"),
+        "Map and validate a .gds file")
+        
+        .def("__len__", &gds::Dataset::size)
+        .def_property_readonly("num_events", &gds::Dataset::numEvents)
+        .def_property_readonly("channels", &gds::Dataset::channels,
+             "Sensory neuron IDs events refer to (channel table)")
+        .def_property_readonly("labels", &gds::Dataset::labels,
+             "Target IDs (label table)")
+        .def("label", &gds::Dataset::label, py::arg("index"), "Target ID of an episode")
+        .def("name", &gds::Dataset::name, py::arg("index"), "Name of an episode (e.g. its source file)")
+        .def("duration", &gds::Dataset::duration, py::arg("index"), "Ticks of an episode")
+        
+        .def("events", [](std::shared_ptr<gds::Dataset> self, size_t i) {
+            if (i >= self->size()) throw py::index_error();
+            gds::Dataset::Events ev = self->events(i);
+            // read-only views into the mapping; the base keeps the dataset open
+            py::object owner = py::cast(self);
+            auto view = [&](const py::array &a) { a.attr("setflags")(py::arg("write") = false); return a; };
+            return py::make_tuple(
+                view(py::array_t<uint32_t>(ev.size, ev.ticks, owner)),
+                view(py::array_t<uint32_t>(ev.size, ev.channels, owner)),
+                view(py::array_t<float>(ev.size, ev.values, owner)));
+        },
+        py::arg("index"),
+        "Events of an episode as zero-copy (ticks, channel indices, values) arrays")
+        
+        .def("sequence", [](const gds::Dataset &self, size_t i) {
+            if (i >= self.size()) throw py::index_error();
+            InputSequence seq;
+            self.toSequence(i, seq);
+            return seq;
+        },
+        py::arg("index"),
+        "Episode as an InputSequence")
+        
+        .def("episodes", [](const gds::Dataset &self) {
+            std::vector<Trainer::EpisodeData> out(self.size());
+            {
+                py::gil_scoped_release release;
+                for (size_t i = 0; i < out.size(); ++i) {
+                    self.toSequence(i, out[i].seq);
+                    out[i].target_id = self.label(i);
+                }
+            }
+            return out;
+        },
+        "All episodes as EpisodeData, ready for the trainers")
+        
+        .def("__repr__", [](const gds::Dataset &self) {
+            return "<SpikeDataset episodes=" + std::to_string(self.size()) +
+                   " events=" + std::to_string(self.numEvents()) + ">";
+        });
+    
+    py::enum_<enc::Encoding>(m, "Encoding", "Spike encoding of an EncodedDataset")
+        .value("Poisson", enc::Encoding::Poisson)
+        .value("Rate", enc::Encoding::Rate)
+        .value("Latency", enc::Encoding::Latency);
+    
+    py::class_<enc::EncoderConfig>(m, "EncoderConfig",
+        "How an EncodedDataset turns features in [0, 1] into spikes (the encodings of\n"
+        "examples/make_glia_seqs.py)")
+        .def(py::init<>())
+        .def(py::init([](const std::string &encoding) {
+            enc::EncoderConfig c;
+            if (!enc::parseEncoding(encoding, c.encoding))
+                throw std::invalid_argument("unknown encoding '" + encoding + "' (poisson, rate or latency)");
+            return c;
+        }),
+        py::arg("encoding"),
+        "Defaults with the encoding named 'poisson', 'rate' or 'latency'")
+        .def_readwrite("encoding", &enc::EncoderConfig::encoding)
+        .def_readwrite("duration", &enc::EncoderConfig::duration, "Ticks of an episode")
+        .def_readwrite("amp", &enc::EncoderConfig::amp, "Input per event (rate: scaled by the feature)")
+        .def_readwrite("max_rate", &enc::EncoderConfig::max_rate, "Poisson: expected spikes per tick at feature 1")
+        .def_readwrite("min_intensity", &enc::EncoderConfig::min_intensity, "Features below send nothing")
+        .def_readwrite("tick_min", &enc::EncoderConfig::tick_min, "Latency: tick of feature 1")
+        .def_readwrite("tick_max", &enc::EncoderConfig::tick_max, "Latency: tick of feature 0 (-1: duration - 1)")
+        .def_readwrite("seed", &enc::EncoderConfig::seed, "Seed of the Poisson draws")
+        .def_readwrite("fresh_per_epoch", &enc::EncoderConfig::fresh_per_epoch,
+                       "Poisson: new spikes every training epoch (else the same ones)");
+    
+    py::class_<enc::FeatureDataset, std::shared_ptr<enc::FeatureDataset>>(m, "EncodedDataset",
+        "Labeled feature vectors encoded into spikes as the trainers load them; only the\n"
+        "features are stored, and Poisson spikes can be drawn afresh every epoch\n\n"
+        "Example:\n"
+        "    >>> ds = EncodedDataset(X, ['O%d' % y for y in Y], EncoderConfig('poisson'))\n"
+        "    >>> trainer.train_epoch(ds, epochs=10, config=cfg)\n")
+        
+        .def(py::init([](py::array_t<float, py::array::c_style | py::array::forcecast> features,
+                         const std::vector<std::string> &labels, const enc::EncoderConfig &config) {
+            if (features.ndim() != 2)
+                throw std::invalid_argument("features must be 2D [episodes, features]");
+            const size_t n = static_cast<size_t>(features.shape(0)), dim = static_cast<size_t>(features.shape(1));
+            if (labels.size() != n)
+                throw std::invalid_argument("expected " + std::to_string(n) + " labels, got " + std::to_string(labels.size()));
+            auto ds = std::make_shared<enc::FeatureDataset>(dim, config);
+            ds->reserve(n);
+            const float *x = features.data();
+            for (size_t i = 0; i < n; ++i) ds->add(x + i * dim, labels[i]);
+            return ds;
+        }),
+        py::arg("features"), py::arg("labels"), py::arg("config") = enc::EncoderConfig(),
+        "From a [episodes, features] array in [0, 1] and each episode's target ID")
+        
+        .def_static("from_csv", [](const std::string &path, const enc::EncoderConfig &config) {
+            auto ds = std::make_shared<enc::FeatureDataset>(0, config);
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = ds->loadCsv(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+            return ds;
+        },
+        py::arg("path"), py::arg("config") = enc::EncoderConfig(),
+        "Load 'label,f0,f1,...' rows (after a header; label k becomes target 'O<k>')")
+        
+        .def("__len__", &enc::FeatureDataset::size)
+        .def_property_readonly("dim", &enc::FeatureDataset::dim, "Features per episode")
+        .def_property("channels", &enc::FeatureDataset::channels, &enc::FeatureDataset::setChannels,
+             "Sensory neuron ID of each feature (default S0, S1, ...)")
+        .def_property("config", &enc::FeatureDataset::config, &enc::FeatureDataset::setConfig)
+        .def("label", [](const enc::FeatureDataset &self, size_t i) {
+            if (i >= self.size()) throw py::index_error();
+            return self.label(i);
+        },
+        py::arg("index"), "Target ID of an episode")
+        .def("features", [](std::shared_ptr<enc::FeatureDataset> self, size_t i) {
+            if (i >= self->size()) throw py::index_error();
+            py::array_t<float> a(self->dim(), self->features(i), py::cast(self));
+            a.attr("setflags")(py::arg("write") = false);
+            return a;
+        },
+        py::arg("index"), "Features of an episode (read-only view)")
+        .def("episode", [](const enc::FeatureDataset &self, size_t i, int64_t epoch) {
+            if (i >= self.size()) throw py::index_error();
+            Trainer::EpisodeData ep;
+            self.toEpisode(i, epoch < 0 ? EpisodeSource::kEvaluation : static_cast<uint64_t>(epoch), ep);
+            return ep;
+        },
+        py::arg("index"), py::arg("epoch") = -1,
+        "Episode as the trainers see it in a training epoch (-1: in evaluation)")
+        .def("episodes", [](const enc::FeatureDataset &self, int64_t epoch) {
+            std::vector<Trainer::EpisodeData> out(self.size());
+            {
+                py::gil_scoped_release release;
+                const uint64_t e = epoch < 0 ? EpisodeSource::kEvaluation : static_cast<uint64_t>(epoch);
+                for (size_t i = 0; i < out.size(); ++i) self.toEpisode(i, e, out[i]);
+            }
+            return out;
+        },
+        py::arg("epoch") = -1,
+        "All episodes as EpisodeData, drawn as in a training epoch (-1: in evaluation)")
+        
+        .def("__repr__", [](const enc::FeatureDataset &self) {
+            return "<EncodedDataset episodes=" + std::to_string(self.size()) + " features=" + std::to_string(self.dim()) +
+                   " encoding=" + enc::name(self.config().encoding) + ">";
+        });
+    
+    py::enum_<world::Polarity>(m, "Polarity", "Event polarities an EventWorld emits")
+        .value("Both", world::Polarity::Both)
+        .value("On", world::Polarity::On)
+        .value("Off", world::Polarity::Off);
+    
+    py::class_<world::WorldConfig>(m, "EventWorldConfig",
+        "Settings of the event-camera mini-world, under event_world.py's config.json keys")
+        .def(py::init<>())
+        .def_static("from_json", [](const std::string &path) {
+            world::WorldConfig c;
+            std::string error;
+            if (!world::loadConfig(path, c, error)) throw std::runtime_error(error);
+            return c;
+        },
+        py::arg("path"), "Read a config.json written by event_world.py")
+        .def("save", [](const world::WorldConfig &self, const std::string &path) {
+            std::string error;
+            if (!world::saveConfig(path, self, error)) throw std::runtime_error(error);
+        },
+        py::arg("path"), "Write the settings as config.json")
+        .def("set", [](world::WorldConfig &self, const std::string &key, const std::string &value) {
+            std::string error;
+            if (!world::setOption(self, key, value, error)) throw std::invalid_argument(error);
+        },
+        py::arg("key"), py::arg("value"), "Set a setting from text by its config.json key")
+        .def_readwrite("seed", &world::WorldConfig::seed)
+        .def_readwrite("clips", &world::WorldConfig::clips)
+        .def_readwrite("width", &world::WorldConfig::width)
+        .def_readwrite("height", &world::WorldConfig::height)
+        .def_readwrite("fps", &world::WorldConfig::fps)
+        .def_readwrite("duration_s", &world::WorldConfig::duration_s)
+        .def_readwrite("bin_ms", &world::WorldConfig::bin_ms, "Milliseconds per tick")
+        .def_readwrite("event_threshold", &world::WorldConfig::event_threshold,
+                       "Brightness change between frames that makes an event")
+        .def_readwrite("polarity", &world::WorldConfig::polarity)
+        .def_readwrite("max_events_per_bin", &world::WorldConfig::max_events_per_bin,
+                       "Events per (tick, channel); only 0 (none) changes a clip, < 0: no cap")
+        .def_readwrite("max_objects", &world::WorldConfig::max_objects)
+        .def_readwrite("size_min", &world::WorldConfig::size_min, "Radius (circle) or half-side (square), pixels")
+        .def_readwrite("size_max", &world::WorldConfig::size_max)
+        .def_readwrite("speed_min", &world::WorldConfig::speed_min, "Pixels per second")
+        .def_readwrite("speed_max", &world::WorldConfig::speed_max)
+        .def_readwrite("brightness_min", &world::WorldConfig::brightness_min)
+        .def_readwrite("brightness_max", &world::WorldConfig::brightness_max)
+        .def_readwrite("bg_drift", &world::WorldConfig::bg_drift, "Background change per second")
+        .def_readwrite("id_prefix", &world::WorldConfig::id_prefix)
+        .def_readwrite("injection_scale", &world::WorldConfig::injection_scale)
+        .def_readwrite("fresh_per_epoch", &world::WorldConfig::fresh_per_epoch,
+                       "New clips every training epoch (evaluations keep the written ones)");
+    
+    py::class_<world::EventWorld, std::shared_ptr<world::EventWorld>>(m, "EventWorld",
+        "Native mini-world generator: clips are synthesized in C++ with deterministic\n"
+        "per-clip seeds, written to a .gds in parallel, or streamed to the trainers\n\n"
+        "Example:\n"
+        "    >>> w = EventWorld(EventWorldConfig.from_json('data/run1/config.json'))\n"
+        "    >>> w.write_dataset('run1/episodes.gds')\n"
+        "    >>> trainer.train_epoch(w, epochs=10, config=cfg)\n")
+        .def(py::init([](const world::WorldConfig &config) { return std::make_shared<world::EventWorld>(config); }),
+             py::arg("config") = world::WorldConfig())
+        .def("__len__", &world::EventWorld::size)
+        .def_property_readonly("config", &world::EventWorld::config)
+        .def_property_readonly("duration_ticks", &world::EventWorld::durationTicks)
+        .def_property_readonly("channels", &world::EventWorld::channels,
+             "Sensory neuron IDs by channel, (y * width + x) * 2 + polarity")
+        .def("episode", [](const world::EventWorld &self, size_t i, uint64_t variant) {
+            if (i >= self.size()) throw py::index_error();
+            Trainer::EpisodeData ep;
+            {
+                py::gil_scoped_release release;
+                self.clip(i, variant, ep);
+            }
+            return ep;
+        },
+        py::arg("index"), py::arg("variant") = 0,
+        "Clip as EpisodeData (variant 0 is the one write_dataset writes)")
+        .def("write_dataset", [](const world::EventWorld &self, const std::string &path, int threads) {
+            std::string error;
+            std::vector<int> objects;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                std::shared_ptr<ThreadPool> owned;
+                ok = self.writeDataset(path, error, ThreadPool::resolve(nullptr, threads, owned), &objects);
+            }
+            if (!ok) throw std::runtime_error(error);
+            return objects;
+        },
+        py::arg("path"), py::arg("threads") = 0,
+        "Synthesize every clip in parallel and write a .gds (GIL released); returns the\n"
+        "object count of each clip")
+        .def("__repr__", [](const world::EventWorld &self) {
+            return "<EventWorld clips=" + std::to_string(self.size()) + " " + std::to_string(self.config().width) +
+                   "x" + std::to_string(self.config().height) + " ticks=" + std::to_string(self.durationTicks()) + ">";
+        });
+    
+    m.def("write_event_counts", [](const std::string &path, const std::vector<int> &objects, int duration_ticks) {
+        std::string error;
+        if (!world::writeCounts(path, objects, duration_ticks, error)) throw std::runtime_error(error);
+    },
+    py::arg("path"), py::arg("objects"), py::arg("duration_ticks"),
+    "Write per-tick object counts as labels_counts.csv (clip_id,tick,true_count)");
+    
+    m.def("pack_labels_csv", [](const std::string &dir, const std::string &out_path) {
+        std::string error;
+        size_t packed = 0;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = gds::packLabelsCsv(dir, out_path, error, &packed);
+        }
+        if (!ok) throw std::runtime_error(error);
+        return packed;
+    },
+    py::arg("dir"), py::arg("out_path"),
+    "Pack <dir>/labels.csv and its .seq files into a .gds dataset; returns the episode count");
+}
@@ -7,6 +7,7 @@
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
 #include "../../src/evo/evolution_engine.h"
+#include "../../src/evo/sweep_engine.h"
 
 namespace py = pybind11;
 
@@ -19,6 +20,8 @@ void bind_evolution(py::module &m) {
         .def_readwrite("acc", &EvoMetrics::acc, "Classification accuracy")
         .def_readwrite("margin", &EvoMetrics::margin, "Average margin")
         .def_readwrite("edges", &EvoMetrics::edges, "Number of connections")
+        .def_readwrite("ticks", &EvoMetrics::ticks, "Mean ticks per validation episode")
+        .def_readwrite("stopped", &EvoMetrics::stopped, "Validation was cut short by racing")
         .def("__repr__", [](const EvoMetrics &m) {
             return "<EvoMetrics fitness=" + std::to_string(m.fitness) +
                    " acc=" + std::to_string(m.acc) + ">";
@@ -39,6 +42,16 @@ void bind_evolution(py::module &m) {
                       "Threshold mutation std dev")
         .def_readwrite("sigma_leak", &EvolutionEngine::Config::sigma_leak,
                       "Leak mutation std dev")
+        .def_readwrite("p_add_edge", &EvolutionEngine::Config::p_add_edge,
+                      "Chance per child of one new edge")
+        .def_readwrite("p_remove_edge", &EvolutionEngine::Config::p_remove_edge,
+                      "Chance per child of one removed edge")
+        .def_readwrite("p_add_neuron", &EvolutionEngine::Config::p_add_neuron,
+                      "Chance per child of a new hidden neuron splitting an edge")
+        .def_readwrite("crossover_rate", &EvolutionEngine::Config::crossover_rate,
+                      "Share of children bred from two parents")
+        .def_readwrite("crossover_rows", &EvolutionEngine::Config::crossover_rows,
+                      "Cross over whole neurons (parameters and outgoing edges) instead of single edges")
         .def_readwrite("w_acc", &EvolutionEngine::Config::w_acc,
                       "Accuracy weight in fitness")
         .def_readwrite("w_margin", &EvolutionEngine::Config::w_margin,
@@ -48,6 +61,39 @@ void bind_evolution(py::module &m) {
         .def_readwrite("seed", &EvolutionEngine::Config::seed)
         .def_readwrite("lamarckian", &EvolutionEngine::Config::lamarckian)
         .def_readwrite("lineage_json", &EvolutionEngine::Config::lineage_json)
+        .def_readwrite("threads", &EvolutionEngine::Config::threads,
+                      "Individuals of a generation evaluated at once")
+        .def_readwrite("pool_threads", &EvolutionEngine::Config::pool_threads,
+                      "Threads of the pool individuals and their trainers run on (0 = ThreadPool.shared())")
+        .def_readwrite("checkpoint_path", &EvolutionEngine::Config::checkpoint_path,
+                      "File the population, lineage and RNG are checkpointed to (empty = off)")
+        .def_readwrite("checkpoint_every", &EvolutionEngine::Config::checkpoint_every,
+                      "Generations between checkpoints")
+        .def_readwrite("listen_port", &EvolutionEngine::Config::listen_port,
+                      "Accept workers (serve_worker) on this TCP port during run() (0 = off)")
+        .def_readwrite("worker_timeout", &EvolutionEngine::Config::worker_timeout,
+                      "Seconds a worker may take for one individual before it is re-queued")
+        .def_readwrite("evaluate_locally", &EvolutionEngine::Config::evaluate_locally,
+                      "With listen_port, also evaluate individuals on this machine")
+        .def_readwrite("reconnect_seconds", &EvolutionEngine::Config::reconnect_seconds,
+                      "How long serve_worker keeps retrying an unreachable coordinator")
+        .def_readwrite("steady_state", &EvolutionEngine::Config::steady_state,
+                      "Asynchronous evolution: each finished evaluation immediately starts a tournament-bred child")
+        .def_readwrite("tournament_size", &EvolutionEngine::Config::tournament_size,
+                      "Individuals compared to pick a parent in steady-state mode")
+        .def_readwrite("fitness_cache", &EvolutionEngine::Config::fitness_cache,
+                      "Non-Lamarckian: reuse the metrics of genomes evaluated in the previous generation (elites)")
+        .def_readwrite("race", &EvolutionEngine::Config::race,
+                      "Stop validating individuals that can no longer reach the parents' lowest accuracy")
+        .def_readwrite("shared_evaluation", &EvolutionEngine::Config::shared_evaluation,
+                      "Train a generation first, then validate it in one EnsembleEvaluator pass that decodes\n"
+                      "each validation episode once for all individuals (race is not applied)")
+        .def_readwrite("genome_fp16", &EvolutionEngine::Config::genome_fp16,
+                      "Store genome weight blocks in half precision (weights are rounded to fp16)")
+        .def_readwrite("lineage_memory_mb", &EvolutionEngine::Config::lineage_memory_mb,
+                      "Lineage kept in memory before older nodes move to lineage_spill (0 = no cap)")
+        .def_readwrite("lineage_spill", &EvolutionEngine::Config::lineage_spill,
+                      "File older lineage nodes are appended to (default: lineage_json + '.nodes')")
         .def("__repr__", [](const EvolutionEngine::Config &c) {
             return "<EvolutionConfig pop=" + std::to_string(c.population) +
                    " gens=" + std::to_string(c.generations) + ">";
@@ -68,8 +114,10 @@ void bind_evolution(py::module &m) {
     
     py::class_<EvolutionEngine::NetSnapshot>(m, "NetworkSnapshot")
         .def(py::init<>())
-        .def_readwrite("neurons", &EvolutionEngine::NetSnapshot::neurons)
-        .def_readwrite("edges", &EvolutionEngine::NetSnapshot::edges);
+        .def_property_readonly("neurons", &EvolutionEngine::neuronRecords, "Neuron records (id, thr, leak) in tick order")
+        .def_property_readonly("edges", &EvolutionEngine::edgeRecords, "Edge records (from, to, w)")
+        .def("restore", &EvolutionEngine::NetSnapshot::restore, py::arg("network"),
+             "Write the snapshot's weights and parameters into a network");
     
     // Evolution Result
     py::class_<EvolutionEngine::Result>(m, "EvolutionResult",
@@ -78,7 +126,9 @@ void bind_evolution(py::module &m) {
         .def_readwrite("best_genome", &EvolutionEngine::Result::best_genome)
         .def_readwrite("best_fitness_hist", &EvolutionEngine::Result::best_fitness_hist)
         .def_readwrite("best_acc_hist", &EvolutionEngine::Result::best_acc_hist)
-        .def_readwrite("best_margin_hist", &EvolutionEngine::Result::best_margin_hist);
+        .def_readwrite("best_margin_hist", &EvolutionEngine::Result::best_margin_hist)
+        .def_readonly("profile", &EvolutionEngine::Result::profile,
+                      "Profiling counters of the run (zero unless built with GLIA_PROFILE)");
     
     // Callbacks struct (bind before EvolutionEngine to avoid default arg issues)
     py::class_<EvolutionEngine::Callbacks>(m, "EvolutionCallbacks")
@@ -125,7 +175,139 @@ void bind_evolution(py::module &m) {
              "Note: This releases the GIL for the duration.\n"
              "For Python callbacks, use the Python wrapper in glia.evolution")
         
+        .def("set_thread_pool", &EvolutionEngine::setThreadPool, py::arg("pool"),
+             "Run individuals and their trainers on this ThreadPool (None: back to config.pool_threads)")
+        .def("set_telemetry", &EvolutionEngine::setTelemetry, py::arg("sink"),
+             "Send individual/generation/phase records to a TelemetryExporter (None: detach)")
+        
+        .def("load_checkpoint", [](EvolutionEngine &self, const std::string &path) {
+            std::string error;
+            if (!self.loadCheckpoint(path, error)) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Continue a checkpointed run: the next run() starts after the last saved generation")
+        
+        .def("serve_worker", [](EvolutionEngine &self, const std::string &host, int port) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.serveWorker(host, port, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("host"), py::arg("port"),
+        "Evaluate individuals for the coordinator run() at host:port (evo_config.listen_port)\n"
+        "until it finishes (GIL released). Needs the coordinator's network, data and configs.")
+        
         .def("__repr__", [](const EvolutionEngine &e) {
             return "<EvolutionEngine>";
         });
+    
+    // Hyperparameter sweeps
+    py::class_<SweepEngine::Param>(m, "SweepParam",
+        "One searched TrainingConfig field (see SweepEngine.field_names())")
+        .def(py::init<>())
+        .def(py::init([](const std::string &name, const std::vector<double> &values, double lo, double hi, bool log_scale) {
+            SweepEngine::Param p;
+            p.name = name; p.values = values; p.lo = lo; p.hi = hi; p.log_scale = log_scale;
+            return p;
+        }),
+        py::arg("name"), py::arg("values") = std::vector<double>(), py::arg("lo") = 0.0, py::arg("hi") = 1.0,
+        py::arg("log_scale") = false)
+        .def_readwrite("name", &SweepEngine::Param::name, "Field name, e.g. 'lr' or 'detector.alpha'")
+        .def_readwrite("values", &SweepEngine::Param::values, "Values to try (empty: drawn from [lo, hi])")
+        .def_readwrite("lo", &SweepEngine::Param::lo)
+        .def_readwrite("hi", &SweepEngine::Param::hi)
+        .def_readwrite("log_scale", &SweepEngine::Param::log_scale, "Draw log-uniformly from [lo, hi]")
+        .def("__repr__", [](const SweepEngine::Param &p) {
+            return "<SweepParam " + p.name + ">";
+        });
+    
+    py::class_<SweepEngine::Config>(m, "SweepConfig",
+        "Configuration for hyperparameter sweeps")
+        .def(py::init<>())
+        .def_readwrite("trials", &SweepEngine::Config::trials,
+                      "Random configurations to try (0 = every combination of the params' values)")
+        .def_readwrite("min_epochs", &SweepEngine::Config::min_epochs,
+                      "Epochs every trial trains before the first pruning")
+        .def_readwrite("max_epochs", &SweepEngine::Config::max_epochs,
+                      "Epochs the trials that are never pruned train")
+        .def_readwrite("eta", &SweepEngine::Config::eta,
+                      "Successive halving: keep the best 1/eta per rung, which trains eta times longer (<= 1: no pruning)")
+        .def_readwrite("trainer", &SweepEngine::Config::trainer,
+                      "'hebbian' (Trainer), 'rate_gd' (RateGDTrainer) or 'bptt' (BpttTrainer)")
+        .def_readwrite("seed", &SweepEngine::Config::seed)
+        .def_readwrite("threads", &SweepEngine::Config::threads,
+                      "Trials trained at once")
+        .def_readwrite("pool_threads", &SweepEngine::Config::pool_threads,
+                      "Threads of the pool trials and their trainers run on (0 = ThreadPool.shared())")
+        .def_readwrite("verbose", &SweepEngine::Config::verbose,
+                      "Print each rung's standings")
+        .def("__repr__", [](const SweepEngine::Config &c) {
+            return "<SweepConfig trials=" + std::to_string(c.trials) +
+                   " epochs=" + std::to_string(c.min_epochs) + ".." + std::to_string(c.max_epochs) + ">";
+        });
+    
+    py::class_<SweepEngine::Trial>(m, "SweepTrial",
+        "One configuration of a sweep and how far it got")
+        .def(py::init<>())
+        .def_readonly("index", &SweepEngine::Trial::index)
+        .def_readonly("values", &SweepEngine::Trial::values, "Applied values, by param")
+        .def_readonly("config", &SweepEngine::Trial::config, "The base TrainingConfig with the values applied")
+        .def_readonly("epoch_acc_hist", &SweepEngine::Trial::epoch_acc_hist)
+        .def_readonly("pruned_at", &SweepEngine::Trial::pruned_at,
+                      "Rung after which the trial was dropped (-1: trained to max_epochs)")
+        .def_readonly("score", &SweepEngine::Trial::score,
+                      "Validation accuracy (without a validation set, or if pruned: last epoch accuracy)")
+        .def_readonly("profile", &SweepEngine::Trial::profile)
+        .def("__repr__", [](const SweepEngine::Trial &t) {
+            return "<SweepTrial " + std::to_string(t.index) + " score=" + std::to_string(t.score) + ">";
+        });
+    
+    py::class_<SweepEngine::Result>(m, "SweepResult",
+        "Result of a hyperparameter sweep")
+        .def(py::init<>())
+        .def_readonly("trials", &SweepEngine::Result::trials)
+        .def_readonly("best", &SweepEngine::Result::best,
+                      "Index of the best trial that trained to max_epochs (-1 if none)")
+        .def_readonly("rung_epochs", &SweepEngine::Result::rung_epochs, "Epochs at the end of each rung")
+        .def_readonly("epochs_trained", &SweepEngine::Result::epochs_trained, "Epochs summed over trials")
+        .def_readonly("profile", &SweepEngine::Result::profile,
+                      "Profiling counters of the sweep (zero unless built with GLIA_PROFILE)");
+    
+    py::class_<SweepEngine, std::shared_ptr<SweepEngine>>(m, "SweepEngine",
+        "Hyperparameter search over TrainingConfig fields with successive halving\n\n"
+        "Example:\n"
+        "    >>> space = [SweepParam('lr', lo=1e-3, hi=1.0, log_scale=True),\n"
+        "    ...          SweepParam('detector.alpha', values=[0.02, 0.05, 0.1])]\n"
+        "    >>> sweep = SweepEngine(net_path, train_data, val_data, train_cfg, space, sweep_cfg)\n"
+        "    >>> result = sweep.run()\n")
+        .def(py::init<const std::string&,
+                      const std::vector<Trainer::EpisodeData>&,
+                      const std::vector<Trainer::EpisodeData>&,
+                      const TrainingConfig&,
+                      const std::vector<SweepEngine::Param>&,
+                      const SweepEngine::Config&>(),
+             py::arg("network_path"),
+             py::arg("train_set"),
+             py::arg("val_set"),
+             py::arg("train_config"),
+             py::arg("space"),
+             py::arg("sweep_config"),
+             "Create sweep engine (params naming unknown fields are dropped with a warning)")
+        
+        .def("run", &SweepEngine::run,
+             py::call_guard<py::gil_scoped_release>(),
+             "Run the sweep (GIL released)")
+        
+        .def("set_thread_pool", &SweepEngine::setThreadPool, py::arg("pool"),
+             "Run trials and their trainers on this ThreadPool (None: back to config.pool_threads)")
+        
+        .def_static("field_names", &SweepEngine::fieldNames,
+                    "TrainingConfig fields a SweepParam can name")
+        
+        .def("__repr__", [](const SweepEngine &e) {
+            return "<SweepEngine>";
+        });
 }
@@ -6,12 +6,77 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
+#include <algorithm>
 #include "../../src/arch/glia.h"
 #include "../../src/arch/neuron.h"  // Need full definition for shared_ptr in method signatures
+#include "../../src/arch/compiled_network.h"
+#include "../../src/arch/spike_recorder.h"
 
 namespace py = pybind11;
 
 void bind_network(py::module &m) {
+    // In-engine spike recorder (attach with Network.set_spike_recorder)
+    py::class_<SpikeRecorder, std::shared_ptr<SpikeRecorder>>(m, "SpikeRecorder",
+        "Ring buffer of spikes filled by the network after every step\n\n"
+        "Example:\n"
+        "    >>> rec = SpikeRecorder('events', 1_000_000)\n"
+        "    >>> net.set_spike_recorder(rec)\n"
+        "    >>> net.run(inputs)\n"
+        "    >>> spikes = rec.spikes()  # int32 [n, 2]: tick, handle\n")
+        .def(py::init([](const std::string &mode, int capacity) {
+            if (mode != "events" && mode != "raster")
+                throw std::invalid_argument("mode must be 'events' or 'raster'");
+            return std::make_shared<SpikeRecorder>(mode == "events" ? SpikeRecorder::Mode::Events : SpikeRecorder::Mode::Raster, capacity);
+        }),
+        py::arg("mode") = "events", py::arg("capacity") = 1 << 20,
+        "mode: 'events' keeps (tick, handle) pairs, capacity = spikes;\n"
+        "'raster' keeps a bit-packed row per tick, capacity = ticks")
+        .def_property_readonly("mode", [](const SpikeRecorder &self) {
+            return self.mode() == SpikeRecorder::Mode::Events ? "events" : "raster";
+        })
+        .def_property_readonly("capacity", &SpikeRecorder::capacity)
+        .def("set_neurons", &SpikeRecorder::setNeurons, py::arg("handles"),
+             "Record only these handles (empty: all); clears the recording")
+        .def("neurons", &SpikeRecorder::neurons)
+        .def("clear", &SpikeRecorder::clear, "Drop the recording and restart the tick count")
+        .def_property_readonly("ticks", &SpikeRecorder::ticks, "Steps recorded")
+        .def_property_readonly("dropped", &SpikeRecorder::dropped,
+                               "Spikes (events) or rows (raster) overwritten because the ring was full")
+        .def_property_readonly("total_spikes", &SpikeRecorder::totalSpikes)
+        .def_property_readonly("first_tick", &SpikeRecorder::firstTick,
+                               "Tick of the oldest row (raster) or spike (events) kept")
+        .def("spikes", [](std::shared_ptr<SpikeRecorder> self) {
+            if (self->mode() != SpikeRecorder::Mode::Events)
+                throw std::runtime_error("spikes() needs an 'events' recorder");
+            const int32_t *p = &self->spikes()->tick;
+            py::array_t<int32_t> a(std::vector<py::ssize_t>{self->numSpikes(), 2}, p, py::cast(self));
+            a.attr("setflags")(py::arg("write") = false);
+            return a;
+        },
+        "Zero-copy int32 [n, 2] view (tick, handle), oldest first; valid until the next\n"
+        "step or clear() (copy it to keep it)")
+        .def("raster", [](std::shared_ptr<SpikeRecorder> self) {
+            if (self->mode() != SpikeRecorder::Mode::Raster)
+                throw std::runtime_error("raster() needs a 'raster' recorder");
+            const uint64_t *p = self->raster();
+            py::array_t<uint64_t> a(std::vector<py::ssize_t>{self->numRows(), self->words()}, p, py::cast(self));
+            a.attr("setflags")(py::arg("write") = false);
+            return a;
+        },
+        "Zero-copy uint64 [rows, words] view of the bit-packed raster, oldest row first\n"
+        "(bit c % 64 of word c // 64 = column c); valid until the next step or clear()")
+        .def_property_readonly("columns", &SpikeRecorder::columns)
+        .def("save", [](SpikeRecorder &self, const std::string &path) {
+            std::string error;
+            if (!self.save(path, error)) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Write the recording to a compact binary file (see spike_recorder.h)")
+        .def("__repr__", [](const SpikeRecorder &self) {
+            return std::string("<SpikeRecorder ") + (self.mode() == SpikeRecorder::Mode::Events ? "events" : "raster") +
+                   " capacity=" + std::to_string(self.capacity()) + " ticks=" + std::to_string(self.ticks()) + ">";
+        });
+
     // Main Network class
     py::class_<Glia, std::shared_ptr<Glia>>(m, "Network",
         "Spiking neural network simulator\n\n"
@@ -31,17 +96,166 @@ void bind_network(py::module &m) {
         .def("load", &Glia::configureNetworkFromFile,
              py::arg("filepath"), py::arg("verbose") = true,
              "Load network from .net file")
+        .def("set_build_seed", &Glia::setBuildSeed, py::arg("seed"),
+             "Seed for NEWNET random graphs when the file has no SEED line")
+        .def("set_build_threads", &Glia::setBuildThreads, py::arg("threads"),
+             "Threads for NEWNET construction (the graph doesn't depend on it)")
         .def("save", &Glia::saveNetworkToFile,
              py::arg("filepath"),
              "Save network to .net file")
+        .def("reorder_neurons", &Glia::reorderNeurons,
+             "Renumber interneurons and outputs in layer order (IDs kept; non-sensory handles change)")
+        .def("save_frozen", &Glia::saveFrozen,
+             py::arg("filepath"), py::arg("min_weight") = 0.0f, py::arg("reorder") = true,
+             "Save an inference copy (.gnet): small edges and neurons that can't reach an output dropped, renumbered by layer")
+        .def("clone", [](const Glia &self) { return std::make_shared<Glia>(self); },
+             "Deep copy of the network (parameters, state and connections)")
         
         // Simulation
         .def("step", &Glia::step,
              py::call_guard<py::gil_scoped_release>(),
              "Run one simulation timestep (GIL released)")
-        .def("inject", &Glia::injectSensory,
+        .def("is_at_rest", &Glia::isAtRest,
+             "True if no neuron can fire again without new input (only leak is left)")
+        .def("fast_forward", &Glia::fastForward, py::arg("ticks"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Advance `ticks` input-free ticks in one closed-form pass if the network is at\n"
+             "rest; returns False (and does nothing) otherwise, then step as usual")
+        .def("set_step_threads", &Glia::setStepThreads, py::arg("threads"),
+             "Threads one step runs on (1 = serial); results are identical, pays off for\n"
+             "large networks in the default compiled mode")
+        .def("get_step_threads", &Glia::getStepThreads)
+        .def("set_neuron_model", [](Glia &self, const std::string &kind, float adapt_decay, float adapt_step) {
+                membrane::ModelParams model;
+                const membrane::NeuronModel kinds[] = {membrane::NeuronModel::Lif, membrane::NeuronModel::LifRefractory,
+                                                       membrane::NeuronModel::AdaptiveThreshold};
+                bool found = false;
+                for (membrane::NeuronModel k : kinds)
+                    if (kind == membrane::name(k)) { model.kind = k; found = true; }
+                if (!found) throw std::invalid_argument("model must be 'lif', 'lif_refractory' or 'adaptive_threshold'");
+                model.adapt_decay = adapt_decay;
+                model.adapt_step = adapt_step;
+                self.setNeuronModel(model);
+            },
+             py::arg("model"), py::arg("adapt_decay") = 0.9f, py::arg("adapt_step") = 10.0f,
+             "Neuron model: 'lif' (default), 'lif_refractory' (a spike starts the refractory period)\n"
+             "or 'adaptive_threshold' (fires above threshold + a; a decays by adapt_decay per tick\n"
+             "and grows by adapt_step per spike)")
+        .def("get_neuron_model", [](const Glia &self) { return std::string(membrane::name(self.getNeuronModel().kind)); })
+        .def("reset_state", &Glia::resetState,
+             "Put every neuron at rest (value = resting, nothing staged, no refractory count,\n"
+             "adaptation or spike); parameters and weights are kept")
+        .def("inject", static_cast<void (Glia::*)(const std::string &, float)>(&Glia::injectSensory),
              py::arg("neuron_id"), py::arg("amount"),
              "Inject current into sensory neuron")
+        .def("inject", static_cast<void (Glia::*)(int, float)>(&Glia::injectSensory),
+             py::arg("handle"), py::arg("amount"),
+             "Inject current into sensory neuron by handle (see get_handles)")
+        .def("inject_batch", [](Glia &self,
+                                py::array_t<int, py::array::c_style | py::array::forcecast> handles,
+                                py::array_t<float, py::array::c_style | py::array::forcecast> values) {
+            if (handles.size() != values.size())
+                throw std::invalid_argument("handles and values must have the same length");
+            self.injectSensoryBatch(handles.data(), values.data(), static_cast<int>(handles.size()));
+        },
+        py::arg("handles"), py::arg("values"),
+        "Inject values[i] into sensory neuron handles[i]")
+        
+        .def("run", [](Glia &self, py::object inputs, int n_ticks, const std::string &record) -> py::object {
+            typedef py::array_t<float, py::array::c_style | py::array::forcecast> FloatArray;
+            typedef py::array_t<int, py::array::c_style | py::array::forcecast> IntArray;
+            if (record != "raster" && record != "counts" && record != "rates" && record != "none")
+                throw std::invalid_argument("record must be 'raster', 'counts', 'rates' or 'none'");
+
+            // dense [T, S] array, sparse (ticks, handles, values) triple, or no input
+            const bool sparse = py::isinstance<py::tuple>(inputs);
+            FloatArray dense, values;
+            IntArray ticks, handles;
+            int rows = 0, width = 0;
+            if (sparse) {
+                py::sequence ev = py::reinterpret_borrow<py::sequence>(inputs);
+                if (ev.size() != 3)
+                    throw std::invalid_argument("sparse inputs must be (ticks, handles, values)");
+                ticks = py::cast<IntArray>(ev[0]);
+                handles = py::cast<IntArray>(ev[1]);
+                values = py::cast<FloatArray>(ev[2]);
+                if (ticks.size() != handles.size() || ticks.size() != values.size())
+                    throw std::invalid_argument("ticks, handles and values must have the same length");
+                if (n_ticks < 0) {
+                    const int *t = ticks.data();
+                    n_ticks = ticks.size() ? *std::max_element(t, t + ticks.size()) + 1 : 0;
+                }
+            } else if (!inputs.is_none()) {
+                dense = py::cast<FloatArray>(inputs);
+                if (dense.ndim() != 2)
+                    throw std::invalid_argument("dense inputs must be a [ticks, sensory] array");
+                rows = static_cast<int>(dense.shape(0));
+                width = static_cast<int>(dense.shape(1));
+                if (n_ticks < 0) n_ticks = rows;
+            }
+            if (n_ticks < 0)
+                throw std::invalid_argument("n_ticks is required when there are no inputs");
+
+            const int n = self.getNeuronCount();
+            py::array_t<uint8_t> raster;
+            py::array_t<int> counts;
+            uint8_t *raster_ptr = nullptr;
+            int *counts_ptr = nullptr;
+            if (record == "raster") {
+                raster = py::array_t<uint8_t>(std::vector<py::ssize_t>{n_ticks, n});
+                raster_ptr = raster.mutable_data();
+            } else if (record != "none") {
+                counts = py::array_t<int>(n);
+                counts_ptr = counts.mutable_data();
+                std::fill(counts_ptr, counts_ptr + n, 0);
+            }
+
+            {
+                py::gil_scoped_release release;
+                if (sparse)
+                    self.runSparse(ticks.data(), handles.data(), values.data(), static_cast<int>(ticks.size()), n_ticks, raster_ptr, counts_ptr);
+                else
+                    self.runDense(rows ? dense.data() : nullptr, rows, width, n_ticks, raster_ptr, counts_ptr);
+            }
+
+            if (record == "raster") return raster;
+            if (record == "counts") return counts;
+            if (record == "rates") {
+                py::array_t<float> rates(n);
+                float *r = rates.mutable_data();
+                for (int h = 0; h < n; ++h) r[h] = n_ticks > 0 ? static_cast<float>(counts_ptr[h]) / n_ticks : 0.0f;
+                return rates;
+            }
+            return py::none();
+        },
+        py::arg("inputs") = py::none(), py::arg("n_ticks") = -1, py::arg("record") = "raster",
+        "Run many steps in one call (GIL released for the whole run)\n\n"
+        "Args:\n"
+        "    inputs: [T, S] float array (row t goes into sensory handles 0..S-1 before tick t),\n"
+        "            a (ticks, handles, values) tuple of arrays, or None\n"
+        "    n_ticks: ticks to run (default: T, or the last event tick + 1)\n"
+        "    record: 'raster' (uint8 [n_ticks, neurons] fired flags), 'counts' (int32 spikes\n"
+        "            per neuron), 'rates' (float32 spikes per tick) or 'none'\n")
+        
+        // Handles (index in get_all_neuron_ids order; valid until neurons are added/removed)
+        .def("get_handle", &Glia::getNeuronHandle,
+             py::arg("neuron_id"),
+             "Handle of a neuron ID, or -1")
+        .def("get_handles", [](const Glia &self, const std::vector<std::string> &ids) {
+            std::vector<int> h = self.getNeuronHandles(ids);
+            return py::array_t<int>(h.size(), h.data());
+        },
+        py::arg("neuron_ids"),
+        "Handles of several neuron IDs as an int32 array (-1 for unknown IDs)")
+        .def("did_fire", &Glia::didFire,
+             py::arg("handle"),
+             "True if the neuron fired on the last step")
+        .def("get_fired_mask", [](const Glia &self) {
+            std::vector<uint64_t> mask;
+            self.getFiredMask(mask);
+            return py::array_t<uint64_t>(mask.size(), mask.data());
+        },
+        "Fired bitmask of the last step as a uint64 array (bit h%64 of word h//64 per handle h)")
         
         // Neuron access
         .def("get_neuron", &Glia::getNeuronById,
@@ -122,6 +336,63 @@ void bind_network(py::module &m) {
         py::arg("from_ids"), py::arg("to_ids"), py::arg("weights"),
         "Set synaptic weights from edge list (creates connections if needed)")
         
+        // Zero-copy views of the compiled arrays (handle order = get_all_neuron_ids order)
+        .def("views", [](std::shared_ptr<Glia> self) {
+            CompiledNetwork *cn = self->getCompiled();
+            if (!cn)
+                throw std::runtime_error("views() needs a compiled network (tick neurons, no edges leaving the network)");
+            cn->settle(); // exact values even after event-driven steps
+
+            // per-neuron arrays live in the network; they keep their storage while the
+            // neuron count is unchanged
+            py::object owner = py::cast(self);
+            auto neuron_view = [&](std::vector<float> &v) {
+                return py::array_t<float>(v.size(), v.data(), owner);
+            };
+
+            // edge arrays belong to the current topology block, which the capsule keeps
+            // alive even if the network has moved on to a new one
+            float *weights = cn->mutableWeights();
+            auto *topo = new std::shared_ptr<const CompiledTopology>(cn->topology());
+            py::capsule keep(topo, [](void *p) { delete static_cast<std::shared_ptr<const CompiledTopology> *>(p); });
+            auto edge_view = [&](const std::vector<int> &v) {
+                py::array_t<int> a(v.size(), v.data(), keep);
+                a.attr("setflags")(py::arg("write") = false);
+                return a;
+            };
+
+            py::dict d;
+            d["ids"] = self->getAllNeuronIDs();
+            d["num_sensory"] = cn->num_sensory;
+            d["values"] = neuron_view(cn->value);
+            d["thresholds"] = neuron_view(cn->threshold);
+            d["leaks"] = neuron_view(cn->leak);
+            d["resting"] = neuron_view(cn->resting);
+            d["row_offsets"] = edge_view((*topo)->row_offsets);
+            d["row_split"] = edge_view((*topo)->row_split);
+            d["targets"] = edge_view((*topo)->targets);
+            d["weights"] = py::array_t<float>(cn->numEdges(), weights, keep);
+            return d;
+        },
+        "Zero-copy NumPy views of the compiled network, indexed by handle\n\n"
+        "Returns:\n"
+        "    dict: 'ids' (handle -> ID, once), 'num_sensory', writable float32 'values',\n"
+        "    'thresholds', 'leaks', 'resting' and 'weights', read-only int32 CSR\n"
+        "    'row_offsets', 'row_split', 'targets' (edges of handle h are\n"
+        "    row_offsets[h]:row_offsets[h+1], forward edges first up to row_split[h])\n\n"
+        "Writes take effect on the next step; call commit_views() to copy parameter and\n"
+        "weight edits into the neurons (needed before save(), clone() or Neuron-level\n"
+        "edits). Structural changes or weight edits made elsewhere detach the edge\n"
+        "views (they keep showing the old block); fetch new views afterwards. The\n"
+        "per-neuron views are invalid once neurons are added or removed.")
+        .def("commit_views", &Glia::commitCompiledEdits,
+             "Copy edits made through views() into the neurons")
+        
+        // Spike recording
+        .def("set_spike_recorder", &Glia::setSpikeRecorder, py::arg("recorder"),
+             "Feed a SpikeRecorder after every step (None detaches)")
+        .def("get_spike_recorder", &Glia::getSpikeRecorder)
+        
         .def("__repr__", [](const Glia &self) {
             return "<Network neurons=" + std::to_string(self.getNeuronCount()) +
                    " connections=" + std::to_string(self.getConnectionCount()) + ">";
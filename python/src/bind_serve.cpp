@@ -0,0 +1,266 @@
+/**
+ * @file bind_serve.cpp
+ * @brief Python bindings for inference models and sessions (src/serve)
+ */
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../../src/arch/glia.h"
+#include "../../src/serve/inference_server.h"
+
+namespace py = pybind11;
+
+namespace {
+
+// ticks of input by tick: inputs of tick k are [offsets[k], offsets[k + 1])
+struct TickChunk {
+    std::vector<int> offsets;
+    std::vector<int> handles;
+    std::vector<float> values;
+    int ticks = 0;
+};
+
+// A [T, S] float array (row t into sensory handles 0..S-1) or a (ticks, handles, values)
+// tuple of arrays as a TickChunk of n_ticks ticks (default T, or the last event tick + 1);
+// called with the GIL held, releases it while bucketing
+void bucketInputs(py::object inputs, int n_ticks, TickChunk &out) {
+    typedef py::array_t<float, py::array::c_style | py::array::forcecast> FloatArray;
+    typedef py::array_t<int, py::array::c_style | py::array::forcecast> IntArray;
+    if (py::isinstance<py::tuple>(inputs)) {
+        py::sequence ev = py::reinterpret_borrow<py::sequence>(inputs);
+        if (ev.size() != 3)
+            throw std::invalid_argument("sparse inputs must be (ticks, handles, values)");
+        IntArray ticks = py::cast<IntArray>(ev[0]);
+        IntArray handles = py::cast<IntArray>(ev[1]);
+        FloatArray values = py::cast<FloatArray>(ev[2]);
+        if (ticks.size() != handles.size() || ticks.size() != values.size())
+            throw std::invalid_argument("ticks, handles and values must have the same length");
+        if (n_ticks < 0) {
+            const int *t = ticks.data();
+            n_ticks = ticks.size() ? *std::max_element(t, t + ticks.size()) + 1 : 0;
+        }
+        py::gil_scoped_release release;
+        // bucket events by tick, keeping same-tick order (as Network.run does)
+        const int n = static_cast<int>(ticks.size());
+        const int *et = ticks.data();
+        out.ticks = n_ticks;
+        out.offsets.assign(n_ticks + 1, 0);
+        for (int k = 0; k < n; ++k)
+            if (et[k] >= 0 && et[k] < n_ticks) out.offsets[et[k] + 1]++;
+        for (int t = 0; t < n_ticks; ++t) out.offsets[t + 1] += out.offsets[t];
+        std::vector<int> fill(out.offsets.begin(), out.offsets.end() - 1);
+        out.handles.resize(out.offsets[n_ticks]);
+        out.values.resize(out.offsets[n_ticks]);
+        for (int k = 0; k < n; ++k)
+            if (et[k] >= 0 && et[k] < n_ticks) {
+                out.handles[fill[et[k]]] = handles.data()[k];
+                out.values[fill[et[k]]++] = values.data()[k];
+            }
+    } else {
+        FloatArray dense = py::cast<FloatArray>(inputs);
+        if (dense.ndim() != 2)
+            throw std::invalid_argument("dense inputs must be a [ticks, sensory] array");
+        const int rows = static_cast<int>(dense.shape(0));
+        const int width = static_cast<int>(dense.shape(1));
+        if (n_ticks < 0) n_ticks = rows;
+        py::gil_scoped_release release;
+        const int filled = std::min(rows, n_ticks);
+        out.ticks = n_ticks;
+        out.offsets.assign(n_ticks + 1, 0);
+        for (int t = 0; t < n_ticks; ++t) out.offsets[t + 1] = out.offsets[t] + (t < filled ? width : 0);
+        out.handles.resize(static_cast<size_t>(filled) * width);
+        for (size_t i = 0; i < out.handles.size(); ++i) out.handles[i] = static_cast<int>(i % width);
+        out.values.assign(dense.data(), dense.data() + static_cast<size_t>(filled) * width);
+    }
+}
+
+// stop the driver with the GIL released: workers may be waiting for it in on_decision
+void stopServer(InferenceServer &s) {
+    if (PyGILState_Check()) {
+        py::gil_scoped_release release;
+        s.stop();
+    } else {
+        s.stop();
+    }
+}
+
+} // namespace
+
+void bind_serve(py::module &m) {
+    py::class_<InferenceDecision>(m, "InferenceDecision")
+        .def_readonly("winner", &InferenceDecision::winner,
+                      "Detector winner (default_id / empty when abstaining)")
+        .def_readonly("winner_slot", &InferenceDecision::winner_slot,
+                      "Index into InferenceModel.output_ids, -1 when abstaining")
+        .def_readonly("margin", &InferenceDecision::margin)
+        .def_readonly("tick", &InferenceDecision::tick, "Ticks run since open/reset")
+        .def_readonly("decided", &InferenceDecision::decided,
+                      "The winner can't change within the decision window")
+        .def("__repr__", [](const InferenceDecision &d) {
+            return "<InferenceDecision winner='" + d.winner + "' margin=" + std::to_string(d.margin) +
+                   " tick=" + std::to_string(d.tick) + ">";
+        });
+
+    py::class_<InferenceModel, std::shared_ptr<InferenceModel>>(m, "InferenceModel",
+        "Immutable snapshot of a network for inference (topology, weights, parameters,\n"
+        "initial state). A model saved as an image and attached in worker processes is\n"
+        "shared by all of them: only each session's membrane state is per process.\n\n"
+        "Example:\n"
+        "    >>> InferenceModel('trained.net').save('/dev/shm/digits.gimg')   # once\n"
+        "    >>> model = InferenceModel('/dev/shm/digits.gimg')               # per worker\n"
+        "    >>> session = InferenceSession(model, OutputDetectorConfig(), 50)\n")
+        .def(py::init([](const std::string &path) {
+            auto model = std::make_shared<InferenceModel>();
+            if (!model->load(path)) throw std::runtime_error(path + ": could not load a model");
+            return model;
+        }),
+        py::arg("path"),
+        "Load a .net/.gnet file, or attach a model image written by save() (read-only mapping)")
+        .def_static("from_network", [](Glia &net) {
+            auto model = std::make_shared<InferenceModel>();
+            if (!model->build(net)) throw std::runtime_error("network can't be used for inference (delays or non-lif model)");
+            return model;
+        },
+        py::arg("net"),
+        "Snapshot a network as it is now")
+        .def("save", [](const InferenceModel &self, const std::string &path) {
+            if (!self.save(path)) throw std::runtime_error(path + ": could not write the model image");
+        },
+        py::arg("path"),
+        "Write the model as an image that processes attach to (e.g. under /dev/shm)")
+        .def("quantize", [](InferenceModel &self, int bits) {
+            if (!self.quantize(bits)) throw std::invalid_argument("bits must be 0, 8 or 16");
+        },
+        py::arg("bits"),
+        "Switch to fixed-point inference with 8 or 16 bit weights (0 = float); before sessions open")
+        .def_property_readonly("attached", &InferenceModel::attached,
+                               "True if the arrays are read from a mapped image")
+        .def_property_readonly("size", &InferenceModel::size)
+        .def_property_readonly("num_sensory", &InferenceModel::numSensory)
+        .def_property_readonly("num_edges", &InferenceModel::numEdges)
+        .def_property_readonly("weight_bits", &InferenceModel::weightBits)
+        .def_property_readonly("weight_bytes", &InferenceModel::weightBytes)
+        .def_property_readonly("neuron_ids", &InferenceModel::neuronIds)
+        .def_property_readonly("output_ids", &InferenceModel::outputIds)
+        .def("sensory_handle", &InferenceModel::sensoryHandle, py::arg("neuron_id"),
+             "Handle of a sensory neuron ID, or -1");
+
+    py::class_<InferenceSession>(m, "InferenceSession",
+        "Per-stream membrane state over a shared InferenceModel, plus an output detector")
+        .def(py::init([](std::shared_ptr<InferenceModel> model, const OutputDetectorConfig &detector, int decision_window) {
+            return new InferenceSession(model, detector, decision_window);
+        }),
+        py::arg("model"), py::arg("detector") = OutputDetectorConfig(), py::arg("decision_window") = 50)
+        .def("reset", &InferenceSession::reset, "Back to the model's initial state; detector cleared")
+        .def("inject", [](InferenceSession &self,
+                          py::array_t<int, py::array::c_style | py::array::forcecast> handles,
+                          py::array_t<float, py::array::c_style | py::array::forcecast> values) {
+            if (handles.size() != values.size())
+                throw std::invalid_argument("handles and values must have the same length");
+            self.inject(handles.data(), values.data(), static_cast<int>(handles.size()));
+        },
+        py::arg("handles"), py::arg("values"),
+        "Stage values[i] into sensory handle handles[i] for the next tick")
+        .def("step", &InferenceSession::step, "Advance one tick and update the detector")
+        .def("run", [](InferenceSession &self, py::object inputs, int n_ticks) {
+            TickChunk chunk;
+            bucketInputs(inputs, n_ticks, chunk);
+            py::gil_scoped_release release;
+            for (int t = 0; t < chunk.ticks; ++t) {
+                const int lo = chunk.offsets[t];
+                self.inject(chunk.handles.data() + lo, chunk.values.data() + lo, chunk.offsets[t + 1] - lo);
+                self.step();
+            }
+            return self.decision();
+        },
+        py::arg("inputs"), py::arg("n_ticks") = -1,
+        "Run many ticks in one call (GIL released) and return the decision\n\n"
+        "Args:\n"
+        "    inputs: [T, S] float array (row t goes into sensory handles 0..S-1 before tick t)\n"
+        "            or a (ticks, handles, values) tuple of arrays\n"
+        "    n_ticks: ticks to run (default: T, or the last event tick + 1)\n")
+        .def("decision", &InferenceSession::decision)
+        .def_property_readonly("ticks", &InferenceSession::ticks)
+        .def("fired", [](const InferenceSession &self) {
+            return py::array_t<uint8_t>(self.model().size(), self.fired());
+        },
+        "Fired flags of the last tick per neuron (uint8 array)");
+
+    py::class_<InferenceServer::Config>(m, "InferenceServerConfig")
+        .def(py::init<>())
+        .def_readwrite("detector", &InferenceServer::Config::detector, "Detector of every session")
+        .def_readwrite("decision_window", &InferenceServer::Config::decision_window,
+                       "Horizon for InferenceDecision.decided")
+        .def_readwrite("threads", &InferenceServer::Config::threads, "Sessions run at once")
+        .def_readwrite("pool_threads", &InferenceServer::Config::pool_threads,
+                       "Threads of the pool they run on (0 = ThreadPool.shared())")
+        .def_readwrite("decision_every", &InferenceServer::Config::decision_every,
+                       "> 0: report a session's decision after every decision_every-th tick instead of\n"
+                       "after the last of its queued ticks");
+
+    py::class_<InferenceServer, std::shared_ptr<InferenceServer>>(m, "InferenceServer",
+        "Sessions of one model fed from any thread. push() queues ticks; process() runs\n"
+        "them, or start() a driver thread that does whenever ticks are queued and reports\n"
+        "decisions through on_decision (see glia.aio for the asyncio interface).")
+        .def(py::init([](std::shared_ptr<InferenceModel> model, const InferenceServer::Config &config) {
+            return std::shared_ptr<InferenceServer>(new InferenceServer(model, config), [](InferenceServer *s) {
+                stopServer(*s);
+                delete s;
+            });
+        }),
+        py::arg("model"), py::arg("config") = InferenceServer::Config())
+        .def("open", &InferenceServer::open, "New session; returns its id")
+        .def("close", &InferenceServer::close, py::arg("session"), "Close a session; its queued ticks are dropped")
+        .def("reset", &InferenceServer::reset, py::arg("session"),
+             "Back to the initial state; queued ticks dropped",
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("session_count", &InferenceServer::sessionCount)
+        .def("push", [](InferenceServer &self, int session, py::object inputs, int n_ticks) {
+            TickChunk chunk;
+            bucketInputs(inputs, n_ticks, chunk);
+            py::gil_scoped_release release;
+            return self.pushTicks(session, chunk.offsets.data(), chunk.handles.data(), chunk.values.data(), chunk.ticks);
+        },
+        py::arg("session"), py::arg("inputs"), py::arg("n_ticks") = -1,
+        "Queue ticks of input for a session, in one call; False if the session is unknown\n\n"
+        "Args:\n"
+        "    inputs: [T, S] float array (row t goes into sensory handles 0..S-1 at tick t)\n"
+        "            or a (ticks, handles, values) tuple of arrays, ticks relative to this chunk\n"
+        "    n_ticks: ticks to queue (default: T, or the last event tick + 1)\n")
+        .def("process", &InferenceServer::process, py::call_guard<py::gil_scoped_release>(),
+             "Run all queued ticks (GIL released); not while started")
+        .def("decision", &InferenceServer::decision, py::arg("session"), "Latest decision of a session")
+        .def("set_on_decision", [](InferenceServer &self, py::object fn) {
+            if (self.running()) throw std::runtime_error("set on_decision before start()");
+            if (fn.is_none()) { self.on_decision = nullptr; return; }
+            py::function f = py::reinterpret_borrow<py::function>(fn);
+            self.on_decision = [f](int session, const InferenceDecision &d) {
+                py::gil_scoped_acquire gil;
+                try {
+                    f(session, d);
+                } catch (py::error_already_set &e) {
+                    e.discard_as_unraisable("InferenceServer.on_decision");
+                }
+            };
+        },
+        py::arg("callback"),
+        "fn(session, decision), called on the worker that ran the session (it takes the GIL);\n"
+        "None removes it. Set before start().")
+        .def("set_thread_pool", &InferenceServer::setThreadPool, py::arg("pool"),
+             "Run sessions on this ThreadPool (overrides config.pool_threads)")
+        .def("start", &InferenceServer::start, "Process queued ticks on a driver thread from now on")
+        .def("stop", [](InferenceServer &self) { stopServer(self); },
+             "Run the ticks still queued and stop the driver thread (GIL released)")
+        .def_property_readonly("running", &InferenceServer::running)
+        .def_property_readonly("queued_ticks", &InferenceServer::queuedTicks,
+                               "Ticks pushed and not yet taken by a worker")
+        .def("__repr__", [](const InferenceServer &s) {
+            return "<InferenceServer sessions=" + std::to_string(s.sessionCount()) +
+                   (s.running() ? " running" : "") + ">";
+        });
+}
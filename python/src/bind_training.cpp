@@ -6,14 +6,101 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include "../../src/train/trainer.h"
+#include "../../src/train/ensemble_eval.h"
 #include "../../src/train/training_config.h"
 #include "../../src/train/gradient/rate_gd_trainer.h"
+#include "../../src/train/gradient/bptt_trainer.h"
+#include "../../src/train/hebbian/online_trainer.h"
 #include "../../src/arch/output_detection.h"
+#include "../../src/arch/profiling.h"
+#include "../../src/arch/thread_pool.h"
+#include "../../src/arch/telemetry.h"
+#include "../../src/arch/device_network.h"
+#include "../../src/data/spike_dataset.h"
+#include "../../src/data/spike_encoder.h"
+#include "../../src/data/event_world.h"
 
 namespace py = pybind11;
 
 void bind_training(py::module &m) {
+    // Profiling counters (all zero unless built with GLIA_PROFILE)
+    m.def("profiling_enabled", &prof::enabled,
+          "True if the core was built with GLIA_PROFILE (phase timers and counters record)");
+
+    // GPU backend for lockstep batches (built with GLIA_CUDA)
+    m.def("device_available", &DeviceNetwork::available,
+          "True if the core has a GPU backend and found a device (TrainingConfig.device_batch)");
+    m.def("device_name", &DeviceNetwork::name, "Backend and device name, or 'none'");
+
+    // Work-stealing pool shared by trainers, evolution and NEWNET construction
+    py::class_<ThreadPool, std::shared_ptr<ThreadPool>>(m, "ThreadPool",
+        "Persistent work-stealing thread pool; pass one to several trainers/engines to share its threads")
+        .def(py::init<int>(), py::arg("threads") = 0,
+             "Pool with `threads` threads including the caller (0 = one per core)")
+        .def_property_readonly("size", &ThreadPool::size)
+        .def_static("shared", &ThreadPool::shared, "Process-wide default pool")
+        .def_static("set_shared_threads", &ThreadPool::setSharedThreads, py::arg("threads"),
+                    "Resize the process-wide pool (0 = one per core) for later runs")
+        .def("__repr__", [](const ThreadPool &p) {
+            return "<ThreadPool size=" + std::to_string(p.size()) + ">";
+        });
+
+    // Progress records of trainers and evolution, written by a background thread
+    py::class_<telemetry::Sink, std::shared_ptr<telemetry::Sink>>(m, "TelemetrySink");
+    py::class_<telemetry::Exporter, telemetry::Sink, std::shared_ptr<telemetry::Exporter>>(m, "TelemetryExporter",
+        "Writes batch/epoch/phase/individual/generation records from a background thread.\n\n"
+        "Targets: 'run.jsonl' (JSON lines), 'run.csv' (CSV), 'tcp://host:port' (JSON lines).\n"
+        "Attach with Trainer.set_telemetry / Evolution.set_telemetry; batch progress then goes\n"
+        "here instead of the console.")
+        .def(py::init([](const std::string &target, size_t capacity) {
+            auto ex = std::make_shared<telemetry::Exporter>(capacity);
+            if (!target.empty() && !ex->open(target)) throw std::runtime_error("cannot open telemetry target " + target);
+            return ex;
+        }),
+        py::arg("target") = "", py::arg("capacity") = 8192,
+        "Exporter buffering `capacity` records between drains, opened on `target` if given")
+        .def("open", [](telemetry::Exporter &self, const std::string &target) {
+            if (!self.open(target)) throw std::runtime_error("cannot open telemetry target " + target);
+        }, py::arg("target"))
+        .def("close", &telemetry::Exporter::close, py::call_guard<py::gil_scoped_release>(),
+             "Write what was emitted, then close the target")
+        .def("flush", &telemetry::Exporter::flush, py::call_guard<py::gil_scoped_release>(),
+             "Wait until the records emitted so far are written")
+        .def_property_readonly("is_open", &telemetry::Exporter::isOpen)
+        .def_property_readonly("written", &telemetry::Exporter::written)
+        .def_property_readonly("dropped", &telemetry::Exporter::dropped,
+                               "Records dropped because the buffer was full, the exporter closed or a write failed");
+
+    py::class_<prof::Stats>(m, "ProfileStats",
+        "Per-phase wall time and hot-path counters")
+        .def(py::init<>())
+        .def_property_readonly("phase_seconds", [](const prof::Stats &s) {
+            py::dict d;
+            for (int p = 0; p < prof::NumPhases; ++p) d[prof::phaseName(p)] = s.seconds[p];
+            return d;
+        }, "Seconds spent per phase (summed over worker threads)")
+        .def_property_readonly("phase_calls", [](const prof::Stats &s) {
+            py::dict d;
+            for (int p = 0; p < prof::NumPhases; ++p) d[prof::phaseName(p)] = s.calls[p];
+            return d;
+        }, "Times each phase was entered")
+        .def_readonly("ticks", &prof::Stats::ticks, "Network steps")
+        .def_readonly("spikes", &prof::Stats::spikes)
+        .def_readonly("synaptic_events", &prof::Stats::synaptic_events,
+                      "Out-edges of neurons that fired")
+        .def_readonly("edges_touched", &prof::Stats::edges_touched,
+                      "Per-edge trainer work (traces, deltas, updates)")
+        .def_readonly("allocations", &prof::Stats::allocations,
+                      "operator new calls (GLIA_PROFILE_ALLOCATIONS builds only)")
+        .def("spikes_per_tick", &prof::Stats::spikesPerTick)
+        .def("reset", &prof::Stats::reset)
+        .def("summary", &prof::Stats::summary)
+        .def("__repr__", [](const prof::Stats &s) {
+            return "<ProfileStats " + s.summary() + ">";
+        });
+
     // GradConfig - gradient descent optimizer configuration
     py::class_<GradConfig>(m, "GradConfig",
         "Gradient descent optimizer configuration")
@@ -34,6 +121,12 @@ void bind_training(py::module &m) {
                       "Adam epsilon for numerical stability")
         .def_readwrite("clip_grad_norm", &GradConfig::clip_grad_norm,
                       "Gradient clipping norm (0 = disabled)")
+        .def_readwrite("bptt_window", &GradConfig::bptt_window,
+                      "BpttTrainer: ticks per backward window; membranes are checkpointed per window (0 = whole episode)")
+        .def_readwrite("bptt_truncate", &GradConfig::bptt_truncate,
+                      "BpttTrainer: cut the gradient at window boundaries (truncated BPTT)")
+        .def_readwrite("surrogate_beta", &GradConfig::surrogate_beta,
+                      "BpttTrainer: sharpness of the surrogate spike derivative")
         .def("__repr__", [](const GradConfig &c) {
             return "<GradConfig optimizer='" + c.optimizer + "'>";
         });
@@ -43,13 +136,21 @@ void bind_training(py::module &m) {
         "Output detector configuration")
         .def(py::init<>())
         .def_readwrite("type", &OutputDetectorConfig::type,
-                      "Detector type: 'ema'")
+                      "Detector type: 'ema', 'count' (windowed spike count) or 'first_spike'")
         .def_readwrite("alpha", &OutputDetectorConfig::alpha,
                       "EMA smoothing factor")
         .def_readwrite("threshold", &OutputDetectorConfig::threshold,
                       "Minimum activity threshold")
         .def_readwrite("default_id", &OutputDetectorConfig::default_id,
                       "Default output when abstaining")
+        .def_readwrite("window", &OutputDetectorConfig::window,
+                      "Window in ticks for 'count'/'first_spike' (0 = decision_window)")
+        .def_readwrite("early_exit", &OutputDetectorConfig::early_exit,
+                      "Stop evaluation once the winner can no longer change")
+        .def_readwrite("early_exit_margin", &OutputDetectorConfig::early_exit_margin,
+                      "With early_exit: also stop once margin reaches this (0 = off)")
+        .def_readwrite("fast_forward", &OutputDetectorConfig::fast_forward,
+                      "evaluate(): skip input-free stretches while the network is at rest")
         .def("__repr__", [](const OutputDetectorConfig &c) {
             return "<OutputDetectorConfig type='" + c.type + 
                    "' alpha=" + std::to_string(c.alpha) + ">";
@@ -72,6 +173,59 @@ void bind_training(py::module &m) {
                    "' margin=" + std::to_string(m.margin) + ">";
         });
     
+    // DatasetMetrics struct (per-episode arrays are copied into NumPy arrays)
+    py::class_<DatasetMetrics>(m, "DatasetMetrics",
+        "Results of evaluate_dataset: summary and per-episode arrays in dataset order")
+        .def(py::init<>())
+        .def_readonly("labels", &DatasetMetrics::labels,
+                      "Output neuron IDs; winner, target and confusion index them")
+        .def_readonly("accuracy", &DatasetMetrics::accuracy)
+        .def_readonly("mean_margin", &DatasetMetrics::mean_margin)
+        .def_readonly("mean_ticks", &DatasetMetrics::mean_ticks,
+                      "Mean ticks run per episode (less than warmup + window with early exit)")
+        .def_readonly("num_correct", &DatasetMetrics::num_correct)
+        .def_property_readonly("total", &DatasetMetrics::size)
+        .def_property_readonly("winner", [](const DatasetMetrics &d) {
+            return py::array_t<int>(d.winner.size(), d.winner.data());
+        }, "int [n]: winning label per episode, -1 for none or a non-output ID")
+        .def_property_readonly("target", [](const DatasetMetrics &d) {
+            return py::array_t<int>(d.target.size(), d.target.data());
+        }, "int [n]: target label per episode, -1 if the target isn't an output")
+        .def_property_readonly("margin", [](const DatasetMetrics &d) {
+            return py::array_t<float>(d.margin.size(), d.margin.data());
+        }, "float32 [n]: winner's margin over the runner-up per episode")
+        .def_property_readonly("ticks", [](const DatasetMetrics &d) {
+            return py::array_t<int>(d.ticks.size(), d.ticks.data());
+        }, "int [n]: ticks run per episode")
+        .def_property_readonly("correct", [](const DatasetMetrics &d) {
+            py::array_t<bool> a(d.correct.size());
+            bool *p = a.mutable_data();
+            for (size_t i = 0; i < d.correct.size(); ++i) p[i] = d.correct[i] != 0;
+            return a;
+        }, "bool [n]: winner ID == target ID")
+        .def_property_readonly("confusion", [](const DatasetMetrics &d) {
+            const py::ssize_t L = static_cast<py::ssize_t>(d.labels.size()) + 1;
+            return py::array_t<int>(std::vector<py::ssize_t>{L, L}, d.confusion.data());
+        }, "int [L + 1, L + 1]: episodes by target (rows) and winner (columns); the last\n"
+           "row and column count the -1s")
+        .def("__repr__", [](const DatasetMetrics &d) {
+            return "<DatasetMetrics total=" + std::to_string(d.size()) +
+                   " accuracy=" + std::to_string(d.accuracy) +
+                   " mean_margin=" + std::to_string(d.mean_margin) + ">";
+        });
+
+    py::class_<EnsembleMetrics>(m, "EnsembleMetrics",
+        "Results of EnsembleEvaluator.evaluate_dataset: one DatasetMetrics per network and the majority vote's")
+        .def_readonly("members", &EnsembleMetrics::members, "DatasetMetrics per network, in constructor order")
+        .def_readonly("vote", &EnsembleMetrics::vote,
+            "The vote: winner the output most networks chose (ties: larger summed margin),\n"
+            "margin the lead in votes over the number of networks, ticks the most any network ran")
+        .def("__repr__", [](const EnsembleMetrics &e) {
+            return "<EnsembleMetrics networks=" + std::to_string(e.members.size()) +
+                   " total=" + std::to_string(e.vote.size()) +
+                   " vote_accuracy=" + std::to_string(e.vote.accuracy) + ">";
+        });
+    
     // TrainingConfig - comprehensive configuration
     py::class_<TrainingConfig>(m, "TrainingConfig",
         "Training configuration parameters")
@@ -85,6 +239,11 @@ void bind_training(py::module &m) {
         .def_readwrite("lr", &TrainingConfig::lr, "Learning rate")
         .def_readwrite("batch_size", &TrainingConfig::batch_size)
         .def_readwrite("shuffle", &TrainingConfig::shuffle)
+        .def_readwrite("lockstep_batch", &TrainingConfig::lockstep_batch, "Simulate a batch's episodes together; each starts from the batch-start state")
+        .def_readwrite("batch_threads", &TrainingConfig::batch_threads, "Worker threads per batch (>1 implies lockstep_batch); results don't depend on it")
+        .def_readwrite("device_batch", &TrainingConfig::device_batch, "Simulate lockstep batches on the GPU (implies lockstep_batch; CPU without a device); results don't depend on it")
+        .def_readwrite("pool_threads", &TrainingConfig::pool_threads, "Threads of the pool batch workers run on (0 = ThreadPool.shared(); ignored after set_thread_pool)")
+        .def_readwrite("prefetch_batches", &TrainingConfig::prefetch_batches, "Batches train_epoch loads ahead on a background thread (0 = inline)")
         .def_readwrite("weight_decay", &TrainingConfig::weight_decay)
         .def_readwrite("weight_clip", &TrainingConfig::weight_clip)
         
@@ -128,12 +287,17 @@ void bind_training(py::module &m) {
         .def_readwrite("log_every", &TrainingConfig::log_every)
         .def_readwrite("seed", &TrainingConfig::seed)
         .def_readwrite("weight_jitter_std", &TrainingConfig::weight_jitter_std)
+        .def_readwrite("timing_jitter", &TrainingConfig::timing_jitter, "Max per-episode onset shift (ticks) applied by train_epoch")
         
         // Checkpointing
         .def_readwrite("checkpoints_enable", &TrainingConfig::checkpoints_enable)
         .def_readwrite("ckpt_l0", &TrainingConfig::ckpt_l0)
         .def_readwrite("ckpt_l1", &TrainingConfig::ckpt_l1)
         .def_readwrite("ckpt_l2", &TrainingConfig::ckpt_l2)
+        .def_readwrite("checkpoint_path", &TrainingConfig::checkpoint_path,
+                      "File train_epoch writes the trainer state to (empty = off)")
+        .def_readwrite("checkpoint_every", &TrainingConfig::checkpoint_every,
+                      "Epochs between on-disk checkpoints")
         
         // Revert/rollback
         .def_readwrite("revert_enable", &TrainingConfig::revert_enable)
@@ -180,6 +344,36 @@ void bind_training(py::module &m) {
              py::call_guard<py::gil_scoped_release>(),
              "Evaluate network on single episode (GIL released)")
         
+        .def("evaluate_dataset", [](Trainer &self, const gds::Dataset &dataset, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", [](Trainer &self, const enc::FeatureDataset &dataset, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EncodedDataset (its evaluation draws), encoding episodes on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", [](Trainer &self, const world::EventWorld &dataset, const TrainingConfig &config) {
+            world::WorldSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EventWorld's clips (variant 0), synthesizing them on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", static_cast<DatasetMetrics (Trainer::*)(const std::vector<Trainer::EpisodeData> &, const TrainingConfig &)>(&Trainer::evaluateDataset),
+             py::arg("dataset"), py::arg("config"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Evaluate every episode from the network's current state, in parallel lanes over\n"
+             "config.batch_threads workers (GIL released); the network is left as it was")
+        
         .def("train_batch", [](Trainer &self, 
                                 const std::vector<Trainer::EpisodeData> &batch,
                                 const TrainingConfig &config) {
@@ -189,7 +383,31 @@ void bind_training(py::module &m) {
         py::arg("batch"), py::arg("config"),
         "Train on a batch of episodes (GIL released)")
         
-        .def("train_epoch", &Trainer::trainEpoch,
+        .def("train_epoch", [](Trainer &self, const gds::Dataset &dataset, int epochs, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", [](Trainer &self, const enc::FeatureDataset &dataset, int epochs, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on an EncodedDataset, encoding each epoch's spikes on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", [](Trainer &self, const world::EventWorld &dataset, int epochs, const TrainingConfig &config) {
+            world::WorldSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on an EventWorld, synthesizing clips on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", static_cast<void (Trainer::*)(const std::vector<Trainer::EpisodeData> &, int, const TrainingConfig &)>(&Trainer::trainEpoch),
              py::arg("dataset"), py::arg("epochs"), py::arg("config"),
              py::call_guard<py::gil_scoped_release>(),
              "Train for multiple epochs (GIL released)\n\n"
@@ -205,6 +423,54 @@ void bind_training(py::module &m) {
         .def("revert_checkpoint", &Trainer::revertCheckpoint,
              "Revert to last checkpoint (if checkpointing enabled)")
         
+        .def("epochs_completed", &Trainer::epochsCompleted,
+             "Epochs trained so far (including those of a loaded checkpoint)")
+        
+        .def("save_checkpoint", [](Trainer &self, const std::string &path) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.saveCheckpoint(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Write the full trainer state (network, optimizer, RNG, counters, history) to a file")
+        
+        .def("load_checkpoint", [](Trainer &self, const std::string &path) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.loadCheckpoint(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Resume from a checkpoint file; the network must be built from the same file")
+        
+        .def("profile", &Trainer::profile,
+             "Profiling counters since construction or the last reset_profile()")
+        
+        .def("reset_profile", &Trainer::resetProfile)
+        
+        .def("set_thread_pool", &Trainer::setThreadPool, py::arg("pool"),
+             "Run batch workers on this ThreadPool (None: back to TrainingConfig.pool_threads)")
+        .def("set_telemetry", &Trainer::setTelemetry, py::arg("sink"),
+             "Send batch/epoch/phase records to a TelemetryExporter instead of printing batches (None: detach)")
+        
+        .def("flush_checkpoints", [](Trainer &self) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.flushCheckpoints(error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        "Wait until checkpoints written by train_epoch (config.checkpoint_path) are on disk")
+        
         .def("__repr__", [](const Trainer &t) {
             return "<Trainer>";
         });
@@ -235,6 +501,36 @@ void bind_training(py::module &m) {
              py::call_guard<py::gil_scoped_release>(),
              "Evaluate network on single episode (GIL released)")
         
+        .def("evaluate_dataset", [](RateGDTrainer &self, const gds::Dataset &dataset, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", [](RateGDTrainer &self, const enc::FeatureDataset &dataset, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EncodedDataset (its evaluation draws), encoding episodes on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", [](RateGDTrainer &self, const world::EventWorld &dataset, const TrainingConfig &config) {
+            world::WorldSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EventWorld's clips (variant 0), synthesizing them on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", static_cast<DatasetMetrics (RateGDTrainer::*)(const std::vector<Trainer::EpisodeData> &, const TrainingConfig &)>(&RateGDTrainer::evaluateDataset),
+             py::arg("dataset"), py::arg("config"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Evaluate every episode from the network's current state, in parallel lanes over\n"
+             "config.batch_threads workers (GIL released); the network is left as it was")
+        
         .def("train_batch", [](RateGDTrainer &self, 
                                 const std::vector<Trainer::EpisodeData> &batch,
                                 const TrainingConfig &config) {
@@ -244,7 +540,31 @@ void bind_training(py::module &m) {
         py::arg("batch"), py::arg("config"),
         "Train on a batch of episodes (GIL released)")
         
-        .def("train_epoch", &RateGDTrainer::trainEpoch,
+        .def("train_epoch", [](RateGDTrainer &self, const gds::Dataset &dataset, int epochs, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", [](RateGDTrainer &self, const enc::FeatureDataset &dataset, int epochs, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on an EncodedDataset, encoding each epoch's spikes on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", [](RateGDTrainer &self, const world::EventWorld &dataset, int epochs, const TrainingConfig &config) {
+            world::WorldSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on an EventWorld, synthesizing clips on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", static_cast<void (RateGDTrainer::*)(const std::vector<Trainer::EpisodeData> &, int, const TrainingConfig &)>(&RateGDTrainer::trainEpoch),
              py::arg("dataset"), py::arg("epochs"), py::arg("config"),
              py::call_guard<py::gil_scoped_release>(),
              "Train for multiple epochs (GIL released)")
@@ -255,7 +575,306 @@ void bind_training(py::module &m) {
         .def("get_epoch_margin_history", &RateGDTrainer::getEpochMarginHistory,
              "Get margin history over epochs")
         
+        .def("epochs_completed", &RateGDTrainer::epochsCompleted,
+             "Epochs trained so far (including those of a loaded checkpoint)")
+        
+        .def("save_checkpoint", [](RateGDTrainer &self, const std::string &path) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.saveCheckpoint(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Write the full trainer state (network, optimizer, RNG, counters, history) to a file")
+        
+        .def("load_checkpoint", [](RateGDTrainer &self, const std::string &path) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.loadCheckpoint(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Resume from a checkpoint file; the network must be built from the same file")
+        
+        .def("profile", &RateGDTrainer::profile,
+             "Profiling counters since construction or the last reset_profile()")
+        
+        .def("reset_profile", &RateGDTrainer::resetProfile)
+        
+        .def("set_thread_pool", &RateGDTrainer::setThreadPool, py::arg("pool"),
+             "Run batch workers on this ThreadPool (None: back to TrainingConfig.pool_threads)")
+        .def("set_telemetry", &RateGDTrainer::setTelemetry, py::arg("sink"),
+             "Send batch/epoch/phase records to a TelemetryExporter instead of printing batches (None: detach)")
+        
+        .def("flush_checkpoints", [](RateGDTrainer &self) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.flushCheckpoints(error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        "Wait until checkpoints written by train_epoch (config.checkpoint_path) are on disk")
+        
         .def("__repr__", [](const RateGDTrainer &t) {
             return "<RateGDTrainer (gradient-based)>";
         });
+
+    // BpttTrainer class - surrogate-gradient backprop through time
+    py::class_<BpttTrainer, std::shared_ptr<BpttTrainer>>(m, "BpttTrainer",
+        "Surrogate-gradient BPTT trainer (windowed, checkpointed backward pass; see GradConfig.bptt_window)\n\n"
+        "Example:\n"
+        "    >>> trainer = BpttTrainer(network)\n"
+        "    >>> trainer.train_epoch(dataset, epochs=100, config=cfg)\n")
+        
+        .def(py::init<Glia&>(),
+             py::arg("network"),
+             "Create a BPTT trainer for a network")
+        
+        .def("reseed", &BpttTrainer::reseed,
+             py::arg("seed"),
+             "Set random seed for reproducibility")
+        
+        .def("evaluate", &BpttTrainer::evaluate,
+             py::arg("sequence"), py::arg("config"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Evaluate network on single episode (GIL released)")
+        
+        .def("evaluate_dataset", [](BpttTrainer &self, const gds::Dataset &dataset, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", [](BpttTrainer &self, const enc::FeatureDataset &dataset, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EncodedDataset (its evaluation draws), encoding episodes on a prefetch thread (GIL released)")
+        
+        .def("evaluate_dataset", static_cast<DatasetMetrics (BpttTrainer::*)(const std::vector<Trainer::EpisodeData> &, const TrainingConfig &)>(&BpttTrainer::evaluateDataset),
+             py::arg("dataset"), py::arg("config"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Evaluate every episode from the network's current state, in parallel lanes over\n"
+             "config.batch_threads workers (GIL released); the network is left as it was")
+        
+        .def("train_batch", [](BpttTrainer &self, 
+                                const std::vector<Trainer::EpisodeData> &batch,
+                                const TrainingConfig &config) {
+            py::gil_scoped_release release;
+            self.trainBatch(batch, config, nullptr);
+        },
+        py::arg("batch"), py::arg("config"),
+        "Train on a batch of episodes (GIL released)")
+        
+        .def("train_epoch", [](BpttTrainer &self, const gds::Dataset &dataset, int epochs, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", [](BpttTrainer &self, const enc::FeatureDataset &dataset, int epochs, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            self.trainEpoch(source, epochs, config);
+        },
+        py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Train on an EncodedDataset, encoding each epoch's spikes on a prefetch thread (GIL released)")
+        
+        .def("train_epoch", static_cast<void (BpttTrainer::*)(const std::vector<Trainer::EpisodeData> &, int, const TrainingConfig &)>(&BpttTrainer::trainEpoch),
+             py::arg("dataset"), py::arg("epochs"), py::arg("config"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Train for multiple epochs (GIL released)")
+        
+        .def("get_epoch_acc_history", &BpttTrainer::getEpochAccHistory,
+             "Get accuracy history over epochs")
+        
+        .def("get_epoch_margin_history", &BpttTrainer::getEpochMarginHistory,
+             "Get margin history over epochs")
+        
+        .def("epochs_completed", &BpttTrainer::epochsCompleted,
+             "Epochs trained so far (including those of a loaded checkpoint)")
+        
+        .def("save_checkpoint", [](BpttTrainer &self, const std::string &path) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.saveCheckpoint(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Write the full trainer state (network, optimizer, RNG, counters, history) to a file")
+        
+        .def("load_checkpoint", [](BpttTrainer &self, const std::string &path) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.loadCheckpoint(path, error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        py::arg("path"),
+        "Resume from a checkpoint file; the network must be built from the same file")
+        
+        .def("profile", &BpttTrainer::profile,
+             "Profiling counters since construction or the last reset_profile()")
+        
+        .def("reset_profile", &BpttTrainer::resetProfile)
+        
+        .def("set_thread_pool", &BpttTrainer::setThreadPool, py::arg("pool"),
+             "Run batch workers on this ThreadPool (None: back to TrainingConfig.pool_threads)")
+        .def("set_telemetry", &BpttTrainer::setTelemetry, py::arg("sink"),
+             "Send batch/epoch/phase records to a TelemetryExporter instead of printing batches (None: detach)")
+        
+        .def("flush_checkpoints", [](BpttTrainer &self) {
+            std::string error;
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.flushCheckpoints(error);
+            }
+            if (!ok) throw std::runtime_error(error);
+        },
+        "Wait until checkpoints written by train_epoch (config.checkpoint_path) are on disk")
+        
+        .def("__repr__", [](const BpttTrainer &t) {
+            return "<BpttTrainer (surrogate-gradient BPTT)>";
+        });
+    
+    // OnlineTrainer - continuous learning on a pushed event stream
+    py::class_<OnlineTrainer::Limits>(m, "OnlineLimits", "Bounds of OnlineTrainer's pending queues")
+        .def(py::init<>())
+        .def_readwrite("max_pending_inputs", &OnlineTrainer::Limits::max_pending_inputs)
+        .def_readwrite("max_pending_rewards", &OnlineTrainer::Limits::max_pending_rewards, "Labels included")
+        .def_readwrite("max_reward_delay", &OnlineTrainer::Limits::max_reward_delay,
+                       "Ticks a reward may arrive late before it is dropped");
+    
+    py::class_<OnlineTrainer::Stats>(m, "OnlineStats", "Counters of an OnlineTrainer")
+        .def_readonly("ticks", &OnlineTrainer::Stats::ticks)
+        .def_readonly("inputs", &OnlineTrainer::Stats::inputs, "Inputs injected")
+        .def_readonly("late_inputs", &OnlineTrainer::Stats::late_inputs, "Pushed for a tick already run (injected at the next)")
+        .def_readonly("dropped_inputs", &OnlineTrainer::Stats::dropped_inputs, "Queue full")
+        .def_readonly("rewards", &OnlineTrainer::Stats::rewards, "Rewards and labels applied")
+        .def_readonly("dropped_rewards", &OnlineTrainer::Stats::dropped_rewards, "Queue full or too late")
+        .def_readonly("last_reward", &OnlineTrainer::Stats::last_reward, "As applied, after the baseline")
+        .def("__repr__", [](const OnlineTrainer::Stats &s) {
+            return "<OnlineStats ticks=" + std::to_string(s.ticks) + " inputs=" + std::to_string(s.inputs) +
+                   " rewards=" + std::to_string(s.rewards) + ">";
+        });
+    
+    py::class_<OnlineTrainer, std::shared_ptr<OnlineTrainer>>(m, "OnlineTrainer",
+        "Reward-modulated learning on an unbounded stream: the network steps continuously and\n"
+        "inputs, rewards and labels are pushed with their tick (pushes may come from other threads)\n\n"
+        "Example:\n"
+        "    >>> online = OnlineTrainer(network, cfg)\n"
+        "    >>> online.push_input(t, 'S0', 80.0)\n"
+        "    >>> online.push_label(t + 30, 'O1')\n"
+        "    >>> online.advance_to(t + 40)\n")
+        
+        .def(py::init<Glia&, const TrainingConfig &>(),
+             py::arg("network"), py::arg("config") = TrainingConfig(),
+             "Learn on a network with lr, elig_lambda, reward shaping, detector and decay settings from config")
+        
+        .def_property("config", &OnlineTrainer::getConfig, &OnlineTrainer::setConfig)
+        .def_property("limits", &OnlineTrainer::getLimits, &OnlineTrainer::setLimits)
+        .def_property_readonly("now", &OnlineTrainer::now, "Next tick to run (ticks run so far)")
+        
+        .def("push_input", static_cast<bool (OnlineTrainer::*)(int64_t, int, float)>(&OnlineTrainer::pushInput),
+             py::arg("tick"), py::arg("handle"), py::arg("value"),
+             "Queue input into a sensory handle before a tick; False if the queue is full")
+        .def("push_input", static_cast<bool (OnlineTrainer::*)(int64_t, const std::string &, float)>(&OnlineTrainer::pushInput),
+             py::arg("tick"), py::arg("neuron_id"), py::arg("value"),
+             "Queue input into a sensory neuron before a tick; False if the queue is full")
+        .def("push_reward", &OnlineTrainer::pushReward, py::arg("tick"), py::arg("reward"),
+             "Queue a reward for a tick, applied once it has run")
+        .def("push_label", &OnlineTrainer::pushLabel, py::arg("tick"), py::arg("target_id"),
+             "Queue the correct output at a tick, rewarded per config.reward_mode")
+        
+        .def("step", &OnlineTrainer::step, py::call_guard<py::gil_scoped_release>(),
+             "Run one tick and apply the rewards due (GIL released)")
+        .def("advance", &OnlineTrainer::advance, py::arg("ticks"), py::call_guard<py::gil_scoped_release>(),
+             "Run a number of ticks (GIL released, so other threads can push meanwhile)")
+        .def("advance_to", &OnlineTrainer::advanceTo, py::arg("tick"), py::call_guard<py::gil_scoped_release>(),
+             "Run until now == tick (GIL released)")
+        
+        .def("winner", &OnlineTrainer::winner, "Current leading output ('' if none)")
+        .def("margin", &OnlineTrainer::margin)
+        .def("output_rate", &OnlineTrainer::outputRate, py::arg("neuron_id"), "EMA rate of an output")
+        .def("stats", &OnlineTrainer::getStats)
+        .def("profile", &OnlineTrainer::profile,
+             "Profiling counters since construction or the last reset_profile()")
+        .def("reset_profile", &OnlineTrainer::resetProfile)
+        
+        .def("__repr__", [](const OnlineTrainer &t) {
+            return "<OnlineTrainer now=" + std::to_string(t.now()) + ">";
+        });
+    
+    py::class_<EnsembleEvaluator, std::shared_ptr<EnsembleEvaluator>>(m, "EnsembleEvaluator",
+        "Evaluate several networks on the same episodes in one pass, decoding each episode's\n"
+        "inputs once for all of them. Each network is scored as its trainer's evaluate_dataset\n"
+        "would score it; the networks need the same sensory neuron IDs.\n\n"
+        "Example:\n"
+        "    >>> ens = glia.EnsembleEvaluator([net_a, net_b, net_c])\n"
+        "    >>> m = ens.evaluate_dataset(val_set, cfg)\n"
+        "    >>> m.members[1].accuracy, m.vote.accuracy\n")
+        
+        .def(py::init([](const std::vector<Glia *> &networks) {
+            std::shared_ptr<EnsembleEvaluator> e = std::make_shared<EnsembleEvaluator>();
+            std::string err;
+            if (!e->bind(networks, err)) throw std::invalid_argument(err);
+            return e;
+        }), py::arg("networks"), py::keep_alive<1, 2>(),
+        "Evaluate these networks (kept alive by the evaluator; don't add or remove neurons while it's in use)")
+        
+        .def_property_readonly("size", &EnsembleEvaluator::size)
+        .def("set_thread_pool", &EnsembleEvaluator::setThreadPool, py::arg("pool"),
+             "Run tasks on this ThreadPool (None: ThreadPool.shared())")
+        
+        .def("evaluate_dataset", static_cast<EnsembleMetrics (EnsembleEvaluator::*)(const std::vector<Trainer::EpisodeData> &, const TrainingConfig &)>(&EnsembleEvaluator::evaluateDataset),
+             py::arg("dataset"), py::arg("config"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Evaluate every episode on every network, over config.batch_threads workers (GIL released)")
+        .def("evaluate_dataset", [](EnsembleEvaluator &self, const gds::Dataset &dataset, const TrainingConfig &config) {
+            gds::DatasetSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate a SpikeDataset, decoding episodes on a prefetch thread (GIL released)")
+        .def("evaluate_dataset", [](EnsembleEvaluator &self, const enc::FeatureDataset &dataset, const TrainingConfig &config) {
+            enc::EncodedSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EncodedDataset (its evaluation draws), encoding episodes on a prefetch thread (GIL released)")
+        .def("evaluate_dataset", [](EnsembleEvaluator &self, const world::EventWorld &dataset, const TrainingConfig &config) {
+            world::WorldSource source(dataset);
+            return self.evaluateDataset(source, config);
+        },
+        py::arg("dataset"), py::arg("config"),
+        py::call_guard<py::gil_scoped_release>(),
+        "Evaluate an EventWorld's clips (variant 0), synthesizing them on a prefetch thread (GIL released)")
+        
+        .def("profile", &EnsembleEvaluator::profile,
+             "Profiling counters of the evaluations so far")
+        .def("__repr__", [](const EnsembleEvaluator &e) {
+            return "<EnsembleEvaluator networks=" + std::to_string(e.size()) + ">";
+        });
 }
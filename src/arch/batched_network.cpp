@@ -0,0 +1,350 @@
+#include "batched_network.h"
+#include "compiled_network.h"
+#include "input_sequence.h"
+#include "neuron.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <iostream>
+
+bool BatchedNetwork::build(const CompiledNetwork &net, int lanes)
+{
+    if (lanes < 1 || !net.isBound()) return false;
+    // lanes run plain Lif with delay 1; callers fall back to stepping the network itself
+    if (!net.basicDynamics()) return false;
+
+    const int n = net.size();
+    const int B = lanes;
+    num_lanes = B;
+    num_neurons = n;
+
+    // shared, not copied: the block is immutable and refreshWeights() copies on write
+    topo = net.topology();
+
+    // rebuilt per batch by the trainers: keep the ID index while the sensory neurons are the same
+    bool same_sensory = static_cast<int>(sensory_ids.size()) == net.num_sensory;
+    for (int i = 0; same_sensory && i < net.num_sensory; ++i) same_sensory = sensory_ids[i] == net.neuronAt(i)->getId();
+    if (!same_sensory)
+    {
+        sensory_index.clear();
+        sensory_ids.resize(net.num_sensory);
+        for (int i = 0; i < net.num_sensory; ++i)
+        {
+            sensory_ids[i] = net.neuronAt(i)->getId();
+            sensory_index[sensory_ids[i]] = i;
+        }
+    }
+
+    const size_t total = static_cast<size_t>(n) * B;
+    threshold.resize(total);
+    leak.resize(total);
+    resting.resize(total);
+    value_state.resize(total);
+    delta.resize(total);
+    on_deck.resize(total);
+    refractory.resize(total);
+    fired_flags.resize(total);
+    fired_mask.assign(membrane::maskWords(static_cast<int>(total)), 0);
+
+    for (int i = 0; i < n; ++i)
+    {
+        const float v = net.valueAt(i);
+        for (int b = 0; b < B; ++b)
+        {
+            const size_t k = static_cast<size_t>(i) * B + b;
+            threshold[k] = net.threshold[i];
+            leak[k] = net.leak[i];
+            resting[k] = net.resting[i];
+            value_state[k] = v;
+            delta[k] = net.delta[i];
+            on_deck[k] = net.on_deck[i];
+            refractory[k] = net.refractory[i];
+            fired_flags[k] = net.fired[i];
+        }
+    }
+
+    lanes_fired.reserve(B);
+    trace.clear();
+    recorded_ticks = 0;
+    device_dirty = true;
+    return true;
+}
+
+bool BatchedNetwork::setDevice(bool on)
+{
+    use_device = on && !device_failed && DeviceNetwork::available();
+    if (use_device && !device) device.reset(new DeviceNetwork());
+    device_dirty = true;
+    return use_device;
+}
+
+int BatchedNetwork::sensoryIndex(const std::string &id) const
+{
+    auto it = sensory_index.find(id);
+    return it == sensory_index.end() ? -1 : it->second;
+}
+
+/*
+Same two passes as CompiledNetwork::step(), over [neuron][lane] arrays. The membrane
+pass treats all n*B elements alike; delivery walks sources in tick order, and for each
+source adds its weights to every lane that fired (dense over lanes when many fired,
+per lane otherwise). Either way each (target, lane) sums its inputs in source order,
+so every lane matches a standalone compiled run exactly.
+*/
+void BatchedNetwork::step()
+{
+    const int B = num_lanes;
+    membrane::Arrays a;
+    a.n = num_neurons * B;
+    a.value = value_state.data();
+    a.delta = delta.data();
+    a.on_deck = on_deck.data();
+    a.refractory = refractory.data();
+    a.fired = fired_flags.data();
+    a.fired_mask = fired_mask.data();
+    a.threshold = threshold.data();
+    a.leak = leak.data();
+    a.resting = resting.data();
+    GLIA_PROF_COUNT(ticks, B);
+    const int num_fired = membrane::update(a, simd);
+    GLIA_PROF_COUNT(spikes, num_fired);
+    if (num_fired == 0) return;
+
+    float *d = delta.data();
+    float *od = on_deck.data();
+    const uint8_t *f = fired_flags.data();
+    const CompiledTopology &g = *topo;
+    const int *offs = g.row_offsets.data();
+    const int *split = g.row_split.data();
+    const int *tgt = g.targets.data();
+    const float *w = g.weights.data();
+
+    for (int s = 0; s < num_neurons; ++s)
+    {
+        const uint8_t *fs = f + static_cast<size_t>(s) * B;
+        lanes_fired.clear();
+        for (int b = 0; b < B; ++b)
+            if (fs[b]) lanes_fired.push_back(b);
+        if (lanes_fired.empty()) continue;
+        GLIA_PROF_COUNT(synaptic_events, lanes_fired.size() * static_cast<size_t>(offs[s + 1] - offs[s]));
+
+        if (static_cast<int>(lanes_fired.size()) * 8 >= B)
+        {
+            // dense over lanes (vectorized); silent lanes add +0, which is exact since
+            // staged inputs are never -0
+            for (int e = offs[s]; e < split[s]; ++e) membrane::addWhereFired(d + static_cast<size_t>(tgt[e]) * B, fs, w[e], B, simd);
+            for (int e = split[s]; e < offs[s + 1]; ++e) membrane::addWhereFired(od + static_cast<size_t>(tgt[e]) * B, fs, w[e], B, simd);
+        }
+        else
+        {
+            for (int e = offs[s]; e < split[s]; ++e)
+            {
+                float *dst = d + static_cast<size_t>(tgt[e]) * B;
+                for (int b : lanes_fired) dst[b] += w[e];
+            }
+            for (int e = split[s]; e < offs[s + 1]; ++e)
+            {
+                float *dst = od + static_cast<size_t>(tgt[e]) * B;
+                for (int b : lanes_fired) dst[b] += w[e];
+            }
+        }
+    }
+}
+
+void BatchedNetwork::run(const InputSequence *const *seqs, int count, int ticks)
+{
+    GLIA_PROF_SCOPE(Step);
+    const int B = num_lanes;
+    const int lanes_in = std::max(0, std::min(B, count));
+    beginRecording(ticks);
+
+    inputs.resize(lanes_in);
+    cursors.clear();
+    for (int b = 0; b < lanes_in; ++b)
+    {
+        inputs[b].compile(*seqs[b], sensory_ids);
+        cursors.push_back(SequenceCursor(*seqs[b]));
+    }
+    if (use_device)
+    {
+        if (runOnDevice(lanes_in)) return;
+        std::cerr << "Warning: device run failed (" << DeviceNetwork::name() << "), continuing on the CPU" << std::endl;
+        use_device = false;
+        device_failed = true;
+        for (int b = 0; b < lanes_in; ++b) cursors[b] = SequenceCursor(*seqs[b]);
+    }
+    for (int t = 0; t < recorded_ticks; ++t)
+    {
+        for (int b = 0; b < lanes_in; ++b)
+        {
+            const CompiledInputSequence::Span in = inputs[b].at(cursors[b].tick);
+            for (int k = 0; k < in.size; ++k) inject(in.handles[k], b, in.values[k]);
+        }
+        recordStep(t);
+        for (int b = 0; b < lanes_in; ++b) cursors[b].advance();
+    }
+}
+
+void BatchedNetwork::beginRecording(int ticks)
+{
+    recorded_ticks = std::max(0, ticks);
+    trace.assign(static_cast<size_t>(num_lanes) * recorded_ticks * num_neurons, 0);
+}
+
+void BatchedNetwork::recordStep(int t)
+{
+    const int B = num_lanes;
+    const int n = num_neurons;
+    step();
+    if (t < 0 || t >= recorded_ticks) return;
+    for (int b = 0; b < B; ++b)
+    {
+        uint8_t *row = trace.data() + (static_cast<size_t>(b) * recorded_ticks + t) * n;
+        for (int i = 0; i < n; ++i) row[i] = fired_flags[static_cast<size_t>(i) * B + b];
+    }
+}
+
+void BatchedNetwork::run(const std::vector<InputSequence> &seqs, int ticks)
+{
+    std::vector<const InputSequence *> ptrs(seqs.size());
+    for (size_t b = 0; b < seqs.size(); ++b) ptrs[b] = &seqs[b];
+    run(ptrs.data(), static_cast<int>(ptrs.size()), ticks);
+}
+
+/*
+Incoming edges of every target for the device's pull delivery: sources ascending and,
+per source, in CSR row order, which is the order step() adds them in. A new topology
+block with the same structure (a weight refresh) only re-gathers the weights.
+*/
+void BatchedNetwork::pullTopology()
+{
+    if (pulled == topo) return;
+    const CompiledTopology &g = *topo;
+    const bool same_structure = pulled && pulled->row_offsets == g.row_offsets && pulled->targets == g.targets;
+    pulled = topo;
+    const int E = g.numEdges();
+    if (same_structure)
+    {
+        for (int k = 0; k < E; ++k) in_weights[k] = g.weights[in_edge[k]];
+        return;
+    }
+
+    const int n = num_neurons;
+    in_offsets.assign(n + 1, 0);
+    for (int e = 0; e < E; ++e) ++in_offsets[g.targets[e] + 1];
+    for (int t = 0; t < n; ++t) in_offsets[t + 1] += in_offsets[t];
+    std::vector<int> next(in_offsets.begin(), in_offsets.end() - 1);
+    in_split = next; // grows past the edges from earlier sources
+    in_sources.resize(E);
+    in_edge.resize(E);
+    in_weights.resize(E);
+    for (int s = 0; s < n; ++s)
+    {
+        for (int e = g.row_offsets[s]; e < g.row_offsets[s + 1]; ++e)
+        {
+            const int t = g.targets[e];
+            const int k = next[t]++;
+            in_sources[k] = s;
+            in_edge[k] = e;
+            in_weights[k] = g.weights[e];
+            if (s < t) ++in_split[t];
+        }
+    }
+    pulled_structure_changed = true;
+}
+
+bool BatchedNetwork::runOnDevice(int lanes_in)
+{
+    const int B = num_lanes;
+    const int n = num_neurons;
+    const int T = recorded_ticks;
+    if (device_dirty)
+    {
+        pullTopology();
+        DeviceNetwork::Model m;
+        m.neurons = n;
+        m.lanes = B;
+        m.in_offsets = in_offsets.data();
+        m.in_split = in_split.data();
+        m.in_sources = in_sources.data();
+        m.in_weights = in_weights.data();
+        m.edges = static_cast<int>(in_sources.size());
+        m.threshold = threshold.data();
+        m.leak = leak.data();
+        m.resting = resting.data();
+        if (!device->upload(m, pulled_structure_changed)) return false;
+        pulled_structure_changed = false;
+        device_dirty = false;
+    }
+
+    // every tick's input per lane, following the cursors as the CPU loop does
+    input_offsets.assign(static_cast<size_t>(T) * B + 1, 0);
+    input_handles.clear();
+    input_values.clear();
+    for (int t = 0; t < T; ++t)
+    {
+        for (int b = 0; b < B; ++b)
+        {
+            if (b < lanes_in)
+            {
+                const CompiledInputSequence::Span in = inputs[b].at(cursors[b].tick);
+                input_handles.insert(input_handles.end(), in.handles, in.handles + in.size);
+                input_values.insert(input_values.end(), in.values, in.values + in.size);
+            }
+            input_offsets[static_cast<size_t>(t) * B + b + 1] = static_cast<int>(input_handles.size());
+        }
+        for (int b = 0; b < lanes_in; ++b) cursors[b].advance();
+    }
+    DeviceNetwork::Inputs in;
+    in.ticks = T;
+    in.offsets = input_offsets.data();
+    in.handles = input_handles.data();
+    in.values = input_values.data();
+
+    DeviceNetwork::State st;
+    st.value = value_state.data();
+    st.delta = delta.data();
+    st.on_deck = on_deck.data();
+    st.refractory = refractory.data();
+    st.fired = fired_flags.data();
+
+    const int W = device->words();
+    packed_trace.resize(std::max<size_t>(1, static_cast<size_t>(T) * B * W));
+    if (!device->run(in, st, packed_trace.data())) return false;
+
+    GLIA_PROF_COUNT(ticks, static_cast<size_t>(B) * T);
+    for (int t = 0; t < T; ++t)
+    {
+        for (int b = 0; b < B; ++b)
+        {
+            const uint64_t *bits = packed_trace.data() + (static_cast<size_t>(t) * B + b) * W;
+            uint8_t *row = trace.data() + (static_cast<size_t>(b) * recorded_ticks + t) * n;
+            for (int i = 0; i < n; ++i) row[i] = static_cast<uint8_t>((bits[i >> 6] >> (i & 63)) & 1);
+#if defined(GLIA_PROFILE)
+            for (int i = 0; i < n; ++i)
+                if (row[i])
+                {
+                    GLIA_PROF_COUNT(spikes, 1);
+                    GLIA_PROF_COUNT(synaptic_events, topo->row_offsets[i + 1] - topo->row_offsets[i]);
+                }
+#endif
+        }
+    }
+    return true;
+}
+
+void BatchedNetwork::storeLane(CompiledNetwork &net, int lane) const
+{
+    if (lane < 0 || lane >= num_lanes || net.size() != num_neurons) return;
+    net.settle();
+    const int B = num_lanes;
+    for (int i = 0; i < num_neurons; ++i)
+    {
+        const size_t k = static_cast<size_t>(i) * B + lane;
+        net.value[i] = value_state[k];
+        net.delta[i] = delta[k];
+        net.on_deck[i] = on_deck[k];
+        net.refractory[i] = refractory[k];
+        net.fired[i] = fired_flags[k];
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef __batched_network_h__
+#define __batched_network_h__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "membrane_kernels.h"
+#include "input_sequence.h"
+#include "device_network.h"
+
+class CompiledNetwork;
+struct CompiledTopology;
+
+/*
+B independent copies ("lanes") of one compiled network simulated in lockstep.
+
+Topology and weights are shared with the CompiledNetwork (one reference-counted
+CompiledTopology, not a copy per lane or per replica); parameters and dynamic state are stored as
+[neuron][lane] (element i*B + b), so the membrane pass runs over all lanes with the
+SIMD kernels and spike delivery touches each edge once for all lanes that fired.
+Each lane behaves exactly like CompiledNetwork::step() run on its own copy of the
+state it was built from.
+
+Used by the trainers to run a batch of episodes in one pass: run() records which
+neurons fired on every tick of every lane, and firedAt() hands a recorded tick to the
+per-episode bookkeeping. A built network is only read by firedAt()/fired()/value(), so
+several threads may each run their own BatchedNetwork from the same CompiledNetwork.
+
+With setDevice(true) and a GPU backend in the build (see device_network.h), run()
+simulates all ticks on the device and copies back only the bit-packed spikes and the
+final state; everything else, step() included, stays on the CPU. Results are the same.
+*/
+class BatchedNetwork
+{
+public:
+    BatchedNetwork() {}
+
+    // share the topology of `net` and copy its parameters and current state into
+    // `lanes` lanes
+    bool build(const CompiledNetwork &net, int lanes);
+
+    int lanes() const { return num_lanes; }
+    int size() const { return num_neurons; }
+
+    // index of a sensory neuron in tick order, or -1
+    int sensoryIndex(const std::string &id) const;
+    // sensory neuron IDs in index order
+    const std::vector<std::string> &sensoryIds() const { return sensory_ids; }
+
+    // stage input for a neuron in one lane (like Neuron::receive)
+    void inject(int neuron, int lane, float amt) { on_deck[neuron * num_lanes + lane] += amt; }
+
+    // advance every lane by one tick
+    void step();
+
+    bool fired(int neuron, int lane) const { return fired_flags[neuron * num_lanes + lane] != 0; }
+    float value(int neuron, int lane) const { return value_state[neuron * num_lanes + lane]; }
+
+    // run one episode per lane: seqs[b] is replayed from its start into lane b (as
+    // reset() then advance() every tick would, the sequences are only read) for `ticks`
+    // ticks. Fired flags of every tick are recorded.
+    void run(const InputSequence *const *seqs, int count, int ticks);
+    void run(const std::vector<InputSequence> &seqs, int ticks);
+    int recordedTicks() const { return recorded_ticks; }
+
+    // run() in parts, for callers that inject themselves: beginRecording(ticks) clears
+    // the record, then recordStep(t) for t = 0..ticks-1 steps every lane and records tick t
+    void beginRecording(int ticks);
+    void recordStep(int t);
+
+    // fired flags (one byte per neuron, tick order) lane `lane` had after tick `tick`
+    // of run()
+    const uint8_t *firedAt(int lane, int tick) const
+    {
+        return trace.data() + (static_cast<size_t>(lane) * recorded_ticks + tick) * num_neurons;
+    }
+
+    // overwrite the dynamic state of `net` with the current state of one lane
+    void storeLane(CompiledNetwork &net, int lane) const;
+
+    void setSimdLevel(membrane::SimdLevel level) { simd = membrane::clamp(level); }
+
+    // run() on the GPU backend if DeviceNetwork::available(); returns whether it will be.
+    // A device error prints a warning and falls back to the CPU for good.
+    bool setDevice(bool on);
+    bool onDevice() const { return use_device; }
+
+private:
+    int num_lanes = 0;
+    int num_neurons = 0;
+    membrane::SimdLevel simd = membrane::detect();
+
+    // shared topology (CSR, forward edges first; see CompiledNetwork)
+    std::shared_ptr<const CompiledTopology> topo;
+    std::vector<std::string> sensory_ids; // in sensory index order
+    std::unordered_map<std::string, int> sensory_index;
+
+    // [neuron][lane]
+    std::vector<float> threshold;
+    std::vector<float> leak;
+    std::vector<float> resting;
+    std::vector<float> value_state;
+    std::vector<float> delta;
+    std::vector<float> on_deck;
+    std::vector<int> refractory;
+    std::vector<uint8_t> fired_flags;
+    std::vector<uint64_t> fired_mask;
+
+    std::vector<int> lanes_fired; // delivery scratch
+    std::vector<CompiledInputSequence> inputs; // per lane, for run()
+    std::vector<SequenceCursor> cursors;
+
+    // fired flags per recorded tick, [lane][tick][neuron]
+    std::vector<uint8_t> trace;
+    int recorded_ticks = 0;
+
+    // GPU backend (setDevice)
+    bool runOnDevice(int lanes_in);
+    void pullTopology(); // incoming-edge form of topo for DeviceNetwork::Model
+    bool use_device = false;
+    bool device_failed = false;
+    bool device_dirty = true; // model changed since the last upload
+    std::unique_ptr<DeviceNetwork> device;
+    std::shared_ptr<const CompiledTopology> pulled; // topology the in_* arrays were built from
+    bool pulled_structure_changed = true;
+    std::vector<int> in_offsets, in_split, in_sources, in_edge; // in_edge: CSR index of each slot
+    std::vector<float> in_weights;
+    std::vector<int> input_offsets, input_handles; // [tick][lane] input ranges of a run
+    std::vector<float> input_values;
+    std::vector<uint64_t> packed_trace; // [tick][lane][word]
+};
+
+#endif
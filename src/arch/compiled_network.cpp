@@ -0,0 +1,1090 @@
+#include "compiled_network.h"
+#include "neuron.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// value after dt idle ticks of V = leak*V (the max(0, .) clamp is a no-op for V >= 0, leak >= 0)
+inline float decayed(float v, float leak, long long dt)
+{
+    if (dt <= 0 || v == 0.0f || leak == 1.0f) return v;
+    if (leak == 0.0f) return 0.0f;
+    if (dt == 1) return leak * v;
+    return static_cast<float>(v * std::pow(static_cast<double>(leak), static_cast<double>(dt)));
+}
+
+// index of the lowest set bit (bits != 0)
+inline int lowestBit(uint64_t bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int k = 0;
+    while (!(bits & 1)) { bits >>= 1; ++k; }
+    return k;
+#endif
+}
+
+// neuron ID without its trailing digits ("H12" -> "H"), the group key of dense projections
+inline std::string idPrefix(const std::string &id)
+{
+    size_t end = id.size();
+    while (end > 0 && id[end - 1] >= '0' && id[end - 1] <= '9') --end;
+    return id.substr(0, end);
+}
+
+/*
+Split g's CSR edges into dense projections between runs of same-prefix handles and the
+remaining sparse rows. A pair of groups qualifies when its targets lie entirely after
+(or entirely before) its sources and at least min_density of the possible edges exist.
+*/
+void buildDense(CompiledTopology &g, const std::vector<Neuron *> &order, float min_density)
+{
+    g.clearDense();
+    const int n = static_cast<int>(order.size());
+    if (min_density <= 0.0f || n == 0) return;
+
+    std::vector<int> group_begin;
+    std::vector<int> group_of(n);
+    std::string prev;
+    for (int i = 0; i < n; ++i)
+    {
+        std::string key = idPrefix(order[i]->getId());
+        if (i == 0 || key != prev) group_begin.push_back(i);
+        group_of[i] = static_cast<int>(group_begin.size()) - 1;
+        prev.swap(key);
+    }
+    const int groups = static_cast<int>(group_begin.size());
+    group_begin.push_back(n);
+
+    // edges per (source group, target group)
+    std::vector<long long> count(static_cast<size_t>(groups) * groups, 0);
+    for (int s = 0; s < n; ++s)
+        for (int e = g.row_offsets[s]; e < g.row_offsets[s + 1]; ++e)
+            ++count[static_cast<size_t>(group_of[s]) * groups + group_of[g.targets[e]]];
+
+    std::vector<int> proj_of(static_cast<size_t>(groups) * groups, -1);
+    std::vector<int> dense_offsets(groups + 1, 0);
+    size_t dense_size = 0;
+    for (int sg = 0; sg < groups; ++sg)
+    {
+        dense_offsets[sg] = static_cast<int>(g.dense.size());
+        for (int tg = 0; tg < groups; ++tg)
+        {
+            if (tg == sg) continue; // a group to itself has targets on both sides
+            const long long edges = count[static_cast<size_t>(sg) * groups + tg];
+            const long long rows = group_begin[sg + 1] - group_begin[sg];
+            const long long cols = group_begin[tg + 1] - group_begin[tg];
+            if (edges == 0 || static_cast<double>(edges) < min_density * static_cast<double>(rows * cols)) continue;
+            CompiledTopology::DenseProjection p;
+            p.src_begin = group_begin[sg];
+            p.src_end = group_begin[sg + 1];
+            p.dst_begin = group_begin[tg];
+            p.dst_end = group_begin[tg + 1];
+            p.forward = tg > sg;
+            p.offset = dense_size;
+            dense_size += static_cast<size_t>(rows * cols);
+            proj_of[static_cast<size_t>(sg) * groups + tg] = static_cast<int>(g.dense.size());
+            g.dense.push_back(p);
+        }
+    }
+    dense_offsets[groups] = static_cast<int>(g.dense.size());
+    if (g.dense.empty()) return;
+
+    g.dense_weights.assign(dense_size, 0.0f);
+    g.group_of.swap(group_of);
+    g.group_dense_offsets.swap(dense_offsets);
+    g.sparse_offsets.assign(n + 1, 0);
+    g.sparse_split.assign(n, 0);
+    g.edge_home.resize(g.targets.size());
+    for (int s = 0; s < n; ++s)
+    {
+        g.sparse_offsets[s] = static_cast<int>(g.sparse_targets.size());
+        for (int e = g.row_offsets[s]; e < g.row_offsets[s + 1]; ++e)
+        {
+            if (e == g.row_split[s]) g.sparse_split[s] = static_cast<int>(g.sparse_targets.size());
+            const int t = g.targets[e];
+            const int p = proj_of[static_cast<size_t>(g.group_of[s]) * groups + g.group_of[t]];
+            if (p >= 0)
+            {
+                const CompiledTopology::DenseProjection &d = g.dense[p];
+                const size_t k = d.offset + static_cast<size_t>(s - d.src_begin) * (d.dst_end - d.dst_begin) +
+                                 (t - d.dst_begin);
+                g.edge_home[e] = -1 - static_cast<int>(k);
+            }
+            else
+            {
+                g.edge_home[e] = static_cast<int>(g.sparse_targets.size());
+                g.sparse_targets.push_back(t);
+                g.sparse_weights.push_back(0.0f);
+            }
+        }
+        if (g.row_split[s] == g.row_offsets[s + 1]) g.sparse_split[s] = static_cast<int>(g.sparse_targets.size());
+    }
+    g.sparse_offsets[n] = static_cast<int>(g.sparse_targets.size());
+    g.syncDense();
+}
+
+} // namespace
+
+void CompiledTopology::syncDense()
+{
+    if (dense.empty()) return;
+    for (size_t e = 0; e < edge_home.size(); ++e)
+    {
+        const int home = edge_home[e];
+        if (home >= 0)
+            sparse_weights[home] = weights[e];
+        else
+            dense_weights[static_cast<size_t>(-1 - home)] = weights[e];
+    }
+}
+
+void CompiledTopology::clearDense()
+{
+    dense.clear();
+    dense_weights.clear();
+    group_of.clear();
+    group_dense_offsets.clear();
+    sparse_offsets.clear();
+    sparse_split.clear();
+    sparse_targets.clear();
+    sparse_weights.clear();
+    edge_home.clear();
+}
+
+/*
+Worker threads of the parallel step. run(job) calls job(k) for every k < size(), k = 0
+on the calling thread, and returns when all calls are done. A step runs two jobs back to
+back, so workers spin briefly for the next one before blocking.
+*/
+class CompiledNetwork::StepTeam
+{
+public:
+    explicit StepTeam(int threads) : count(threads)
+    {
+        for (int k = 1; k < count; ++k) workers.emplace_back(&StepTeam::work, this, k);
+    }
+    ~StepTeam()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            generation.fetch_add(1);
+        }
+        cv.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    int size() const { return count; }
+
+    void run(const std::function<void(int)> &f)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &f;
+            pending.store(count - 1);
+            generation.fetch_add(1);
+        }
+        cv.notify_all();
+        f(0);
+        for (int spin = 0; pending.load(std::memory_order_acquire) > 0; ++spin)
+            if (spin > 1000) std::this_thread::yield();
+    }
+
+private:
+    void work(int k)
+    {
+        unsigned seen = 0;
+        for (;;)
+        {
+            for (int spin = 0; spin < 20000 && generation.load(std::memory_order_acquire) == seen; ++spin) {}
+            const std::function<void(int)> *f;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return generation.load() != seen; });
+                seen = generation.load();
+                if (stop) return;
+                f = job;
+            }
+            (*f)(k);
+            pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    const int count;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<unsigned> generation{0};
+    std::atomic<int> pending{0};
+    const std::function<void(int)> *job = nullptr;
+    bool stop = false;
+};
+
+CompiledNetwork::CompiledNetwork() {}
+
+CompiledNetwork::~CompiledNetwork()
+{
+    release();
+}
+
+bool CompiledNetwork::build(const std::vector<Neuron *> &order, int num_sensory)
+{
+    const int n = static_cast<int>(order.size());
+
+    // index lookup for edge targets
+    std::unordered_map<const Neuron *, int> index_of;
+    index_of.reserve(order.size());
+    for (int i = 0; i < n; ++i)
+    {
+        if (!order[i] || !order[i]->usesTick())
+        {
+            release();
+            return false;
+        }
+        index_of[order[i]] = i;
+    }
+
+    std::vector<float> new_threshold(n), new_leak(n), new_resting(n);
+    std::vector<float> new_value(n), new_delta(n), new_on_deck(n), new_adaptation(n);
+    std::vector<int> new_refractory(n), new_refractory_period(n);
+    std::vector<uint8_t> new_fired(n);
+    // a new block: the previous one may still be held by replicas
+    std::shared_ptr<CompiledTopology> new_edges = std::make_shared<CompiledTopology>();
+    std::vector<int> &new_offsets = new_edges->row_offsets;
+    std::vector<int> &new_split = new_edges->row_split;
+    std::vector<int> &new_targets = new_edges->targets;
+    std::vector<float> &new_weights = new_edges->weights;
+    new_offsets.assign(n + 1, 0);
+    new_split.assign(n, 0);
+    std::vector<int> new_edge_slot;
+
+    size_t edge_count = 0;
+    bool any_delay = false;
+    int new_rows = 0; // ring depth: the longest delay, or input a neuron still has staged
+    for (const auto &src : order)
+    {
+        edge_count += src->getConnections().size();
+        any_delay = any_delay || src->hasDelays();
+        if (src->compiled == this) new_rows = std::max(new_rows, later_rows);
+        else new_rows = std::max(new_rows, static_cast<int>(src->later.size()));
+    }
+    std::vector<int> &new_delays = new_edges->delays;
+    new_targets.reserve(edge_count);
+    new_weights.reserve(edge_count);
+    new_edge_slot.reserve(edge_count);
+    std::vector<std::pair<int, int>> row; // (sort key, position in the connection map)
+
+    for (int i = 0; i < n; ++i)
+    {
+        const Neuron &src = *order[i];
+        new_threshold[i] = src.threshold;
+        new_leak[i] = src.balancer;
+        new_resting[i] = src.resting;
+        new_refractory_period[i] = src.refractory_period;
+
+        // carry dynamic state: from our arrays if already bound here, else from the neuron
+        if (src.compiled == this)
+        {
+            new_value[i] = valueAt(src.slot);
+            new_delta[i] = delta[src.slot];
+            new_on_deck[i] = on_deck[src.slot];
+            new_refractory[i] = refractory[src.slot];
+            new_fired[i] = fired[src.slot];
+            new_adaptation[i] = adaptation[src.slot];
+        }
+        else
+        {
+            new_value[i] = src.value;
+            new_delta[i] = src.delta;
+            new_on_deck[i] = src.on_deck;
+            new_refractory[i] = src.refractory;
+            new_fired[i] = src.just_fired ? 1 : 0;
+            new_adaptation[i] = src.adaptation;
+        }
+
+        // forward edges (target later in tick order) first, then the rest, each part by
+        // target handle so delivery writes ascending addresses. Each target appears once
+        // per row, so this does not change any summation order.
+        const int row_begin = static_cast<int>(new_targets.size());
+        new_offsets[i] = row_begin;
+        row.clear();
+        int forward = 0;
+        for (const auto &kv : src.connections)
+        {
+            const Neuron *dst = kv.second.second;
+            if (!dst) continue; // fire() skips null targets as well
+            auto it = index_of.find(dst);
+            if (it == index_of.end())
+            {
+                // edge into a neuron this network does not own; keep the reference path
+                release();
+                return false;
+            }
+            if (it->second > i) ++forward;
+            // backward targets are keyed past every handle so they sort after the forward ones
+            row.push_back(std::make_pair(it->second > i ? it->second : n + it->second, static_cast<int>(row.size())));
+        }
+        std::sort(row.begin(), row.end());
+        new_targets.resize(row_begin + row.size());
+        new_weights.resize(new_targets.size());
+        const size_t slot_base = new_edge_slot.size();
+        new_edge_slot.resize(slot_base + row.size());
+        for (size_t p = 0; p < row.size(); ++p)
+        {
+            new_targets[row_begin + p] = row[p].first < n ? row[p].first : row[p].first - n;
+            new_edge_slot[slot_base + row[p].second] = row_begin + static_cast<int>(p);
+        }
+        if (any_delay) new_delays.resize(new_targets.size(), 1);
+        int k = 0;
+        for (const auto &kv : src.connections)
+        {
+            if (!kv.second.second) continue;
+            const int e = new_edge_slot[slot_base + k++];
+            new_weights[e] = kv.second.first;
+            if (any_delay)
+            {
+                new_delays[e] = src.getDelay(kv.first);
+                new_edges->max_delay = std::max(new_edges->max_delay, new_delays[e]);
+            }
+        }
+        new_split[i] = row_begin + forward;
+    }
+    new_offsets[n] = static_cast<int>(new_targets.size());
+    new_rows = std::max(new_rows, new_edges->max_delay - 1);
+    // projections deliver into delta/on_deck only
+    buildDense(*new_edges, order, new_delays.empty() ? dense_min_density : 0.0f);
+
+    // input staged beyond on_deck, re-based so the ring starts at row 0
+    std::vector<float> new_later(static_cast<size_t>(new_rows) * n, 0.0f);
+    std::vector<float> pending;
+    for (int i = 0; i < n && new_rows > 0; ++i)
+    {
+        const Neuron &src = *order[i];
+        if (src.compiled == this) pendingInput(src.slot, pending);
+        else
+        {
+            pending.resize(src.later.size());
+            for (size_t r = 0; r < pending.size(); ++r) pending[r] = src.later[(src.later_head + r) % src.later.size()];
+        }
+        for (size_t r = 0; r < pending.size(); ++r) new_later[r * n + i] = pending[r];
+    }
+
+    // unbind neurons that are no longer part of the order (state already copied above)
+    for (Neuron *nb : bound)
+    {
+        if (index_of.find(nb) == index_of.end())
+        {
+            nb->value = valueAt(nb->slot);
+            nb->delta = delta[nb->slot];
+            nb->on_deck = on_deck[nb->slot];
+            nb->refractory = refractory[nb->slot];
+            nb->just_fired = fired[nb->slot] != 0;
+            nb->adaptation = adaptation[nb->slot];
+            pendingInput(nb->slot, nb->later);
+            nb->later_head = 0;
+            nb->compiled = nullptr;
+            nb->slot = -1;
+        }
+    }
+
+    // assigned rather than swapped: while the neuron count is unchanged the arrays keep
+    // their storage, so views handed out by the Python bindings stay valid across rebuilds
+    this->num_sensory = num_sensory;
+    threshold.assign(new_threshold.begin(), new_threshold.end());
+    leak.assign(new_leak.begin(), new_leak.end());
+    resting.assign(new_resting.begin(), new_resting.end());
+    refractory_period.assign(new_refractory_period.begin(), new_refractory_period.end());
+    value.assign(new_value.begin(), new_value.end());
+    delta.assign(new_delta.begin(), new_delta.end());
+    on_deck.assign(new_on_deck.begin(), new_on_deck.end());
+    refractory.assign(new_refractory.begin(), new_refractory.end());
+    fired.assign(new_fired.begin(), new_fired.end());
+    adaptation.assign(new_adaptation.begin(), new_adaptation.end());
+    fired_mask.assign(membrane::maskWords(n), 0);
+    later.swap(new_later);
+    later_rows = new_rows;
+    later_head = 0;
+    edges.swap(new_edges);
+    edge_slot.swap(new_edge_slot);
+
+    bound.assign(n, nullptr);
+    for (int i = 0; i < n; ++i)
+    {
+        Neuron *nb = order[i];
+        nb->compiled = this;
+        nb->slot = i;
+        bound[i] = nb;
+    }
+
+    // values were materialized above; the next event-driven step starts from scratch
+    event_mode = false;
+    partitions_dirty = true;
+    topology_dirty = false;
+    weights_dirty = false;
+    return true;
+}
+
+void CompiledNetwork::release()
+{
+    settle();
+    for (size_t i = 0; i < bound.size(); ++i)
+    {
+        Neuron *nb = bound[i];
+        if (!nb || nb->compiled != this) continue;
+        nb->value = value[i];
+        nb->delta = delta[i];
+        nb->on_deck = on_deck[i];
+        nb->refractory = refractory[i];
+        nb->just_fired = fired[i] != 0;
+        nb->adaptation = adaptation[i];
+        pendingInput(static_cast<int>(i), nb->later);
+        nb->later_head = 0;
+        nb->compiled = nullptr;
+        nb->slot = -1;
+    }
+    bound.clear();
+    topology_dirty = true;
+    weights_dirty = false;
+}
+
+void CompiledNetwork::refreshWeights()
+{
+    // copy-on-write: replicas built from the current block keep seeing its weights
+    if (edges.use_count() > 1) edges = std::make_shared<CompiledTopology>(*edges);
+    std::vector<float> &weights = edges->weights;
+
+    // same traversal as build(); edge_slot maps map-order edges to CSR positions
+    size_t k = 0;
+    for (Neuron *src : bound)
+    {
+        for (const auto &kv : src->connections)
+        {
+            if (!kv.second.second) continue;
+            weights[edge_slot[k++]] = kv.second.first;
+        }
+    }
+    edges->syncDense();
+    weights_dirty = false;
+}
+
+float *CompiledNetwork::mutableWeights()
+{
+    if (edges.use_count() > 1) edges = std::make_shared<CompiledTopology>(*edges);
+    // edits through the pointer would not reach the projections; step() uses the CSR
+    // arrays until the next build
+    edges->clearDense();
+    partitions_dirty = true;
+    return edges->weights.data();
+}
+
+void CompiledNetwork::setDenseProjections(float min_density)
+{
+    dense_min_density = min_density > 0.0f ? min_density : 0.0f;
+    topology_dirty = true;
+}
+
+void CompiledNetwork::setThreads(int threads)
+{
+    num_threads = threads > 1 ? threads : 1;
+    partitions_dirty = true;
+}
+
+void CompiledNetwork::storeToNeurons()
+{
+    for (size_t i = 0; i < bound.size(); ++i)
+    {
+        Neuron *nb = bound[i];
+        nb->threshold = threshold[i];
+        nb->balancer = leak[i];
+        nb->resting = resting[i];
+        nb->refractory_period = refractory_period[i];
+    }
+    if (weights_dirty) return;
+    const std::vector<float> &weights = edges->weights;
+    size_t k = 0;
+    for (Neuron *src : bound)
+    {
+        for (auto &kv : src->connections)
+        {
+            if (!kv.second.second) continue;
+            kv.second.first = weights[edge_slot[k++]];
+        }
+    }
+}
+
+void CompiledNetwork::step()
+{
+    if (event_mode) settle();
+
+    const int n = size();
+    membrane::Arrays a;
+    a.n = n;
+    a.value = value.data();
+    a.delta = delta.data();
+    a.on_deck = on_deck.data();
+    a.refractory = refractory.data();
+    a.fired = fired.data();
+    a.fired_mask = fired_mask.data();
+    a.threshold = threshold.data();
+    a.leak = leak.data();
+    a.resting = resting.data();
+    a.model = model;
+    a.refractory_period = refractory_period.data();
+    a.adaptation = adaptation.data();
+
+    if (num_threads > 1 && later_rows == 0)
+    {
+        if (partitions_dirty) buildPartitions();
+        if (partitions.size() > 1)
+        {
+            stepParallel();
+            return;
+        }
+    }
+
+    // phase 1: membrane update for every neuron (vectorized)
+    const int num_fired = membrane::update(a, simd);
+    GLIA_PROF_COUNT(spikes, num_fired);
+    if (later_rows > 0)
+    {
+        // the ring's next row moves into on_deck, as later[] does in Neuron::tick()
+        float *row = later.data() + static_cast<size_t>(later_head) * n;
+        for (int i = 0; i < n; ++i) on_deck[i] = row[i];
+        std::fill(row, row + n, 0.0f);
+        later_head = (later_head + 1) % later_rows;
+    }
+    if (num_fired == 0) return;
+    if (!edges->delays.empty())
+    {
+        deliverDelayed();
+        return;
+    }
+
+    // phase 2: deliver spikes in ascending source order. Neuron::tick() order means a
+    // spike from s reaches targets later in the order (t > s) next tick, so it goes
+    // into the already-shifted delta[t]; other targets get it in on_deck[t]. Walking
+    // sources in order keeps each target's summation order identical.
+    float *d = delta.data();
+    float *od = on_deck.data();
+    const int *offs = edges->row_offsets.data();
+    const int *split = edges->row_split.data();
+    const int *tgt = edges->targets.data();
+    const float *w = edges->weights.data();
+    const int words = membrane::maskWords(n);
+    if (edges->hasDense())
+    {
+        // same walk; each source adds its rows of the dense projections (+0 where an
+        // edge is missing) and its remaining sparse edges, so per-target sums still
+        // see the sources in ascending order
+        const CompiledTopology &g = *edges;
+        offs = g.sparse_offsets.data();
+        split = g.sparse_split.data();
+        tgt = g.sparse_targets.data();
+        w = g.sparse_weights.data();
+        for (int wi = 0; wi < words; ++wi)
+        {
+            uint64_t bits = fired_mask[wi];
+            while (bits)
+            {
+                const int s = wi * 64 + lowestBit(bits);
+                bits &= bits - 1;
+                GLIA_PROF_COUNT(synaptic_events, g.row_offsets[s + 1] - g.row_offsets[s]);
+                const int grp = g.group_of[s];
+                for (int p = g.group_dense_offsets[grp]; p < g.group_dense_offsets[grp + 1]; ++p)
+                {
+                    const CompiledTopology::DenseProjection &proj = g.dense[p];
+                    const int width = proj.dst_end - proj.dst_begin;
+                    const float *row = g.dense_weights.data() + proj.offset + static_cast<size_t>(s - proj.src_begin) * width;
+                    membrane::addRow((proj.forward ? d : od) + proj.dst_begin, row, width, simd);
+                }
+                for (int e = offs[s]; e < split[s]; ++e) d[tgt[e]] += w[e];
+                for (int e = split[s]; e < offs[s + 1]; ++e) od[tgt[e]] += w[e];
+            }
+        }
+        return;
+    }
+    for (int wi = 0; wi < words; ++wi)
+    {
+        uint64_t bits = fired_mask[wi];
+        while (bits)
+        {
+            const int s = wi * 64 + lowestBit(bits);
+            bits &= bits - 1;
+            GLIA_PROF_COUNT(synaptic_events, edges->row_offsets[s + 1] - edges->row_offsets[s]);
+            for (int e = offs[s]; e < split[s]; ++e) d[tgt[e]] += w[e];
+            for (int e = split[s]; e < offs[s + 1]; ++e) od[tgt[e]] += w[e];
+        }
+    }
+}
+
+/*
+Delivery with per-edge delays. After the tick, input reaches a target from delta (next
+tick), on_deck (the tick after) or ring row k (k + 2 ticks on). A forward edge of
+delay d lands d - 1 positions along, since its target has ticked after the source as
+in Neuron::tick(), a backward edge d positions along; delay 1 is step()'s delta/on_deck
+split. Sources are walked in ascending order, so each target sums in the same order.
+*/
+void CompiledNetwork::deliverDelayed()
+{
+    const int n = size();
+    float *d = delta.data();
+    float *od = on_deck.data();
+    const int *offs = edges->row_offsets.data();
+    const int *split = edges->row_split.data();
+    const int *tgt = edges->targets.data();
+    const float *w = edges->weights.data();
+    const int *dl = edges->delays.data();
+    for (int wi = 0; wi < membrane::maskWords(n); ++wi)
+    {
+        uint64_t bits = fired_mask[wi];
+        while (bits)
+        {
+            const int s = wi * 64 + lowestBit(bits);
+            bits &= bits - 1;
+            GLIA_PROF_COUNT(synaptic_events, offs[s + 1] - offs[s]);
+            for (int e = offs[s]; e < offs[s + 1]; ++e)
+            {
+                const int pos = e < split[s] ? dl[e] - 1 : dl[e];
+                if (pos == 0) d[tgt[e]] += w[e];
+                else if (pos == 1) od[tgt[e]] += w[e];
+                else later[static_cast<size_t>((later_head + pos - 2) % later_rows) * n + tgt[e]] += w[e];
+            }
+        }
+    }
+}
+
+// grow the ring to at least `rows`, re-based to row 0 (pending input keeps its tick)
+void CompiledNetwork::reserveLater(int rows)
+{
+    if (rows <= later_rows) return;
+    const int n = size();
+    std::vector<float> grown(static_cast<size_t>(rows) * n, 0.0f);
+    for (int r = 0; r < later_rows; ++r)
+    {
+        const float *src = later.data() + static_cast<size_t>((later_head + r) % later_rows) * n;
+        std::copy(src, src + n, grown.begin() + static_cast<size_t>(r) * n);
+    }
+    later.swap(grown);
+    later_rows = rows;
+    later_head = 0;
+}
+
+void CompiledNetwork::pendingInput(int i, std::vector<float> &out) const
+{
+    out.resize(later_rows);
+    for (int r = 0; r < later_rows; ++r)
+        out[r] = later[static_cast<size_t>((later_head + r) % later_rows) * size() + i];
+}
+
+/*
+Partitions for the parallel step: contiguous handle ranges starting on 64-neuron
+boundaries (so each owns whole fired_mask words), cut where the running cost of
+membrane updates (1 per neuron) and incoming edges reaches the next 1/P of the total.
+Ranges in tick order follow the S/H/O layering of the networks we build. Every
+partition keeps its own index of the edges into it, which is what lets delivery run
+without locks or a merge step.
+*/
+void CompiledNetwork::buildPartitions()
+{
+    partitions_dirty = false;
+    partitions.clear();
+    const int n = size();
+    const int blocks = membrane::maskWords(n);
+    const int parts = std::min(num_threads, blocks);
+    if (parts < 2)
+    {
+        team.reset();
+        return;
+    }
+
+    const CompiledTopology &g = *edges;
+    const bool dense = g.hasDense();
+    const std::vector<int> &offs = dense ? g.sparse_offsets : g.row_offsets;
+    const std::vector<int> &split = dense ? g.sparse_split : g.row_split;
+    const std::vector<int> &tgt = dense ? g.sparse_targets : g.targets;
+
+    // cost per 64-neuron block: its neurons plus every edge into them (dense included)
+    std::vector<double> block_cost(blocks, 0.0);
+    for (int i = 0; i < n; ++i) block_cost[i >> 6] += 1.0;
+    for (int t : g.targets) block_cost[t >> 6] += 1.0;
+    double total = 0.0;
+    for (double c : block_cost) total += c;
+
+    std::vector<int> bounds(1, 0);
+    double acc = 0.0;
+    for (int b = 0; b < blocks && static_cast<int>(bounds.size()) < parts; ++b)
+    {
+        acc += block_cost[b];
+        // leave at least one block for each remaining partition
+        const int remaining = parts - static_cast<int>(bounds.size());
+        if ((acc >= total * bounds.size() / parts && b + 1 < blocks) || blocks - (b + 1) == remaining)
+            bounds.push_back((b + 1) * 64);
+    }
+    bounds.push_back(n);
+
+    partitions.resize(bounds.size() - 1);
+    std::vector<int> owner(n);
+    for (size_t p = 0; p < partitions.size(); ++p)
+    {
+        Partition &part = partitions[p];
+        part.lo = bounds[p];
+        part.hi = std::min(bounds[p + 1], n);
+        for (int i = part.lo; i < part.hi; ++i) owner[i] = static_cast<int>(p);
+        part.offs.assign(n + 1, 0);
+        part.split.assign(n, 0);
+        part.edge.clear();
+    }
+    for (int s = 0; s < n; ++s)
+    {
+        for (Partition &part : partitions) part.offs[s] = static_cast<int>(part.edge.size());
+        for (int e = offs[s]; e < split[s]; ++e) partitions[owner[tgt[e]]].edge.push_back(e);
+        for (Partition &part : partitions) part.split[s] = static_cast<int>(part.edge.size());
+        for (int e = split[s]; e < offs[s + 1]; ++e) partitions[owner[tgt[e]]].edge.push_back(e);
+    }
+    for (Partition &part : partitions) part.offs[n] = static_cast<int>(part.edge.size());
+
+    if (!team || team->size() != static_cast<int>(partitions.size()))
+        team.reset(new StepTeam(static_cast<int>(partitions.size())));
+}
+
+// delivery of this tick's spikes into [p.lo, p.hi), in ascending source order
+void CompiledNetwork::deliverPartition(Partition &p)
+{
+    const CompiledTopology &g = *edges;
+    const bool dense = g.hasDense();
+    const int *tgt = dense ? g.sparse_targets.data() : g.targets.data();
+    const float *w = dense ? g.sparse_weights.data() : g.weights.data();
+    const int *po = p.offs.data();
+    const int *ps = p.split.data();
+    const int *pe = p.edge.data();
+    float *d = delta.data();
+    float *od = on_deck.data();
+    const int words = membrane::maskWords(size());
+    for (int wi = 0; wi < words; ++wi)
+    {
+        uint64_t bits = fired_mask[wi];
+        while (bits)
+        {
+            const int s = wi * 64 + lowestBit(bits);
+            bits &= bits - 1;
+            if (dense)
+            {
+                const int grp = g.group_of[s];
+                for (int q = g.group_dense_offsets[grp]; q < g.group_dense_offsets[grp + 1]; ++q)
+                {
+                    const CompiledTopology::DenseProjection &proj = g.dense[q];
+                    const int lo = std::max(proj.dst_begin, p.lo), hi = std::min(proj.dst_end, p.hi);
+                    if (lo >= hi) continue;
+                    const int width = proj.dst_end - proj.dst_begin;
+                    const float *row = g.dense_weights.data() + proj.offset + static_cast<size_t>(s - proj.src_begin) * width;
+                    membrane::addRow((proj.forward ? d : od) + lo, row + (lo - proj.dst_begin), hi - lo, simd);
+                }
+            }
+            for (int k = po[s]; k < ps[s]; ++k) d[tgt[pe[k]]] += w[pe[k]];
+            for (int k = ps[s]; k < po[s + 1]; ++k) od[tgt[pe[k]]] += w[pe[k]];
+        }
+    }
+}
+
+/*
+Parallel tick: the same two phases as step(), each split over the partitions. The
+membrane pass of a partition writes only its own neurons and mask words; delivery
+starts once every partition has finished it, since any neuron may feed any partition.
+*/
+void CompiledNetwork::stepParallel()
+{
+    const int parts = static_cast<int>(partitions.size());
+    std::function<void(int)> update = [&](int k) {
+        Partition &p = partitions[k];
+        membrane::Arrays a;
+        a.n = p.hi - p.lo;
+        a.value = value.data() + p.lo;
+        a.delta = delta.data() + p.lo;
+        a.on_deck = on_deck.data() + p.lo;
+        a.refractory = refractory.data() + p.lo;
+        a.fired = fired.data() + p.lo;
+        a.fired_mask = fired_mask.data() + (p.lo >> 6);
+        a.threshold = threshold.data() + p.lo;
+        a.leak = leak.data() + p.lo;
+        a.resting = resting.data() + p.lo;
+        a.model = model;
+        a.refractory_period = refractory_period.data() + p.lo;
+        a.adaptation = adaptation.data() + p.lo;
+        p.fired_count = membrane::update(a, simd);
+    };
+    team->run(update);
+
+    int num_fired = 0;
+    for (int k = 0; k < parts; ++k) num_fired += partitions[k].fired_count;
+    GLIA_PROF_COUNT(spikes, num_fired);
+    if (num_fired == 0) return;
+#if defined(GLIA_PROFILE)
+    for (int wi = 0; wi < membrane::maskWords(size()); ++wi)
+        for (uint64_t bits = fired_mask[wi]; bits; bits &= bits - 1)
+        {
+            const int s = wi * 64 + lowestBit(bits);
+            GLIA_PROF_COUNT(synaptic_events, edges->row_offsets[s + 1] - edges->row_offsets[s]);
+        }
+#endif
+
+    std::function<void(int)> deliver = [&](int k) { deliverPartition(partitions[k]); };
+    team->run(deliver);
+}
+
+/*
+Event-driven tick
+
+Two phases that reproduce step()'s ordering: first every visited neuron stages its
+input and updates its membrane; then the fan-out of each neuron that fired is
+delivered in ascending source order. A spike from s to a target later in tick order
+(t > s) lands in delta[t] (seen next tick, as in step() where t ticks after s), any
+other target gets it in on_deck[t] (seen one tick later). Neurons that were not
+visited have no staged input, so skipping them only defers their leak, which is
+applied in closed form the next time they are visited or read.
+*/
+void CompiledNetwork::stepEventDriven()
+{
+    if (later_rows > 0 || model.kind != membrane::NeuronModel::Lif)
+    {
+        step();
+        return;
+    }
+    const int n = size();
+    if (!event_mode)
+    {
+        // start with every neuron active; settled ones drop out after one tick
+        last_tick.assign(n, now);
+        queued.assign(n, 1);
+        active.resize(n);
+        for (int i = 0; i < n; ++i) active[i] = i;
+        event_mode = true;
+    }
+
+    float *v = value.data();
+    float *d = delta.data();
+    float *od = on_deck.data();
+    int *refr = refractory.data();
+    uint8_t *f = fired.data();
+    const float *thr = threshold.data();
+    const float *lk = leak.data();
+    const float *rest = resting.data();
+    const int *offs = edges->row_offsets.data();
+    const int *split = edges->row_split.data();
+    const int *tgt = edges->targets.data();
+    const float *w = edges->weights.data();
+
+    processing.swap(active);
+    active.clear();
+    spiked.clear();
+    const long long tick = now + 1;
+
+    // phase 1: membrane update for visited neurons
+    for (int i : processing)
+    {
+        queued[i] = 0;
+        f[i] = 0;
+
+        float vi = decayed(v[i], lk[i], now - last_tick[i]);
+        last_tick[i] = tick;
+
+        float incoming = d[i];
+        d[i] = od[i];
+        od[i] = 0.0f;
+
+        if (refr[i] > 0)
+        {
+            refr[i] -= 1;
+        }
+        else
+        {
+            vi = lk[i] * vi + incoming;
+            if (vi < 0) vi = 0;
+            if (vi > thr[i])
+            {
+                f[i] = 1;
+                vi = rest[i];
+                spiked.push_back(i);
+            }
+        }
+        v[i] = vi;
+
+        if (!isQuiescent(i)) enqueue(i);
+    }
+
+    // phase 2: deliver spikes in tick order so per-target sums match step()
+    std::sort(spiked.begin(), spiked.end());
+    GLIA_PROF_COUNT(spikes, spiked.size());
+    for (int s : spiked)
+    {
+        GLIA_PROF_COUNT(synaptic_events, offs[s + 1] - offs[s]);
+        for (int e = offs[s]; e < split[s]; ++e)
+        {
+            d[tgt[e]] += w[e];
+            enqueue(tgt[e]);
+        }
+        for (int e = split[s]; e < offs[s + 1]; ++e)
+        {
+            od[tgt[e]] += w[e];
+            enqueue(tgt[e]);
+        }
+    }
+
+    now = tick;
+}
+
+bool CompiledNetwork::isAtRest() const
+{
+    if (event_mode)
+    {
+        // neurons off the active list settled when last visited and got no input since
+        for (int i : active)
+            if (!isQuiescent(i)) return false;
+        return true;
+    }
+    const bool adapts = model.kind == membrane::NeuronModel::AdaptiveThreshold;
+    if (adapts && !(model.adapt_decay >= 0.0f && model.adapt_decay <= 1.0f)) return false;
+    for (int i = 0; i < size(); ++i)
+    {
+        if (!isQuiescent(i)) return false;
+        // a negative offset lowers the threshold, at most by its current size
+        if (adapts && adaptation[i] < 0.0f && value[i] > threshold[i] + adaptation[i]) return false;
+    }
+    for (float x : later)
+        if (x != 0.0f) return false;
+    return true;
+}
+
+void CompiledNetwork::fastForward(long long ticks)
+{
+    if (ticks <= 0) return;
+    if (event_mode)
+    {
+        now += ticks; // idle neurons decay when next visited
+        return;
+    }
+    // decayed(), with leak^ticks computed once per run of equal leaks
+    float cached_leak = 0.0f;
+    double factor = 0.0;
+    for (int i = 0; i < size(); ++i)
+    {
+        const float v = value[i], lk = leak[i];
+        if (ticks == 1 || v == 0.0f || lk == 0.0f || lk == 1.0f)
+        {
+            value[i] = decayed(v, lk, ticks);
+            continue;
+        }
+        if (lk != cached_leak)
+        {
+            cached_leak = lk;
+            factor = std::pow(static_cast<double>(lk), static_cast<double>(ticks));
+        }
+        value[i] = static_cast<float>(v * factor);
+    }
+    if (model.kind == membrane::NeuronModel::AdaptiveThreshold)
+    {
+        for (float &a : adaptation) a = decayed(a, model.adapt_decay, ticks);
+    }
+    if (later_rows > 0) later_head = static_cast<int>((later_head + ticks) % later_rows);
+}
+
+void CompiledNetwork::settle()
+{
+    if (!event_mode) return;
+    for (int i = 0; i < size(); ++i)
+        value[i] = decayed(value[i], leak[i], now - last_tick[i]);
+    event_mode = false;
+    active.clear();
+    processing.clear();
+}
+
+void CompiledNetwork::resetState()
+{
+    std::copy(resting.begin(), resting.end(), value.begin());
+    std::fill(delta.begin(), delta.end(), 0.0f);
+    std::fill(on_deck.begin(), on_deck.end(), 0.0f);
+    std::fill(refractory.begin(), refractory.end(), 0);
+    std::fill(fired.begin(), fired.end(), 0);
+    std::fill(fired_mask.begin(), fired_mask.end(), 0);
+    std::fill(adaptation.begin(), adaptation.end(), 0.0f);
+    std::fill(later.begin(), later.end(), 0.0f);
+    later_head = 0;
+    // at rest nothing is pending: the next event-driven step starts over with every neuron
+    event_mode = false;
+    active.clear();
+    processing.clear();
+}
+
+/*
+A neuron can be skipped while it has nothing staged, is not refractory, did not just
+fire, and plain decay V = leak*V cannot take it over threshold.
+*/
+bool CompiledNetwork::isQuiescent(int i) const
+{
+    return fired[i] == 0 && refractory[i] == 0 && delta[i] == 0.0f && on_deck[i] == 0.0f &&
+           leak[i] >= 0.0f && leak[i] <= 1.0f && value[i] >= 0.0f && value[i] <= threshold[i];
+}
+
+void CompiledNetwork::materialize(int i)
+{
+    if (!event_mode) return;
+    value[i] = decayed(value[i], leak[i], now - last_tick[i]);
+    last_tick[i] = now;
+}
+
+void CompiledNetwork::enqueue(int i)
+{
+    if (!event_mode || queued[i]) return;
+    queued[i] = 1;
+    active.push_back(i);
+}
+
+float CompiledNetwork::valueAt(int i) const
+{
+    if (!event_mode) return value[i];
+    return decayed(value[i], leak[i], now - last_tick[i]);
+}
+
+void CompiledNetwork::setValue(int i, float v)
+{
+    materialize(i);
+    value[i] = v;
+    enqueue(i);
+}
+
+void CompiledNetwork::setThresholdAt(int i, float t)
+{
+    threshold[i] = t;
+    enqueue(i);
+}
+
+void CompiledNetwork::setLeakAt(int i, float l)
+{
+    // pending decay was accrued under the old leak
+    materialize(i);
+    leak[i] = l;
+    enqueue(i);
+}
+
+void CompiledNetwork::stage(int i, float transmission, int delay)
+{
+    if (delay > 1)
+    {
+        reserveLater(delay - 1);
+        later[static_cast<size_t>((later_head + delay - 2) % later_rows) * size() + i] += transmission;
+        return;
+    }
+    on_deck[i] += transmission;
+    enqueue(i);
+}
@@ -0,0 +1,275 @@
+#ifndef __compiled_network_h__
+#define __compiled_network_h__
+
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include "membrane_kernels.h"
+
+class Neuron;
+
+/*
+Outgoing edges of a compiled network in CSR form: the edges of neuron i are
+[row_offsets[i], row_offsets[i+1]) in targets/weights, forward edges (target later in
+tick order) first, up to row_split[i].
+
+A published topology is treated as immutable. CompiledNetwork hands it out as a
+shared_ptr<const CompiledTopology>, so batched replicas, trainer workers and inference
+models share one copy of the edges and only own their per-neuron state; a weight refresh
+while someone else still holds the block writes into a fresh copy (copy-on-write). The
+one exception is mutableWeights(), which backs the writable weight view of the Python
+bindings.
+*/
+struct CompiledTopology
+{
+    std::vector<int> row_offsets;
+    std::vector<int> row_split; // first edge of row i whose target is not after i
+    std::vector<int> targets;
+    std::vector<float> weights;
+
+    // synaptic delay of each edge in ticks, empty when every edge has the default delay
+    // of 1. Delayed networks are stepped by the serial CompiledNetwork::step() alone (no
+    // dense projections, partitions or event-driven ticks), and the batched and
+    // inference engines refuse them (max_delay > 1).
+    std::vector<int> delays;
+    int max_delay = 1;
+
+    int numEdges() const { return static_cast<int>(targets.size()); }
+
+    /*
+    Dense projections: the edges from one group of neurons (a run of handles with the
+    same ID prefix, e.g. S*, H*, O*) to another that are dense enough (see
+    CompiledNetwork::setDenseProjections), stored as a row-major [source][target] matrix
+    with +0 for missing edges, so a spike is delivered by adding one row. Only used by
+    CompiledNetwork::step(); every edge stays in the CSR arrays above, and the
+    sparse_* arrays hold the CSR rows without the edges the projections cover.
+    */
+    struct DenseProjection
+    {
+        int src_begin, src_end; // source handles
+        int dst_begin, dst_end; // target handles
+        bool forward;           // every target is after every source (delta, not on_deck)
+        size_t offset;          // first element in dense_weights
+    };
+    std::vector<DenseProjection> dense;
+    std::vector<float> dense_weights;
+    std::vector<int> group_of;            // group of each handle (empty without projections)
+    std::vector<int> group_dense_offsets; // projections of group g: [offsets[g], offsets[g+1])
+    std::vector<int> sparse_offsets, sparse_split, sparse_targets;
+    std::vector<float> sparse_weights;
+    std::vector<int> edge_home; // CSR edge -> sparse_weights index, or -1 - dense_weights index
+
+    bool hasDense() const { return !dense.empty(); }
+    // copy `weights` into the projections and sparse rows
+    void syncDense();
+    // drop the projections (step() falls back to the CSR arrays)
+    void clearDense();
+};
+
+/*
+Flat, index-based form of a Glia network used by the simulation hot loop.
+
+Neurons are numbered in tick order (sensory neurons first, then interneurons/outputs),
+parameters and dynamic state are stored as struct-of-arrays, and outgoing edges are
+stored in a shared CompiledTopology. Each row holds the edges to neurons later in tick
+order first (up to row_split[i]), then the rest, which is what spike delivery needs to
+reproduce Neuron::tick()'s staging (see step()).
+
+While a network is compiled its Neuron objects are "bound": their dynamic state
+(value, staged input, refractory counter, fired flag) lives in these arrays and the
+Neuron accessors read/write through to them. Structural edits and weight edits made
+through Neuron mark the compiled form dirty so Glia can refresh it before the next step.
+*/
+class CompiledNetwork
+{
+public:
+    CompiledNetwork();
+    ~CompiledNetwork();
+
+    // bound neurons hold raw pointers into this object
+    CompiledNetwork(const CompiledNetwork &) = delete;
+    CompiledNetwork &operator=(const CompiledNetwork &) = delete;
+
+    // (re)build from neurons in tick order; dynamic state is carried over from the
+    // neurons (or from the previous compiled arrays) so rebuilding never perturbs a run.
+    // Returns false if the network cannot be compiled (non-tick neurons or edges that
+    // leave the neuron set); in that case nothing is bound.
+    bool build(const std::vector<Neuron *> &order, int num_sensory);
+
+    // copy dynamic state back into the neurons and unbind them
+    void release();
+
+    // refresh the weight array from the neurons' connection maps (topology unchanged);
+    // copies the topology first if it is shared
+    void refreshWeights();
+
+    // weights of the current edge block for in-place edits; the block is made unique
+    // first, so replicas built earlier keep their weights
+    float *mutableWeights();
+
+    // copy parameters (threshold, leak, resting) and weights edited in the arrays back
+    // into the neurons; weights are skipped if the neurons' own weights changed since
+    // the last refresh (those edits win, as they would on the next step)
+    void storeToNeurons();
+
+    // advance every neuron by one tick; identical to calling Neuron::tick() in order.
+    // The membrane pass uses the widest SIMD variant the CPU supports.
+    void step();
+
+    // threads step() runs on (1 = serial, the default). The neurons are split into
+    // contiguous ranges of handles, balanced by membrane and delivery work; each thread
+    // updates its range's membranes and then delivers every spike's edges into its own
+    // range, walking sources in ascending order. Threads never write the same target,
+    // and each target sums its inputs in the serial order, so results are identical to
+    // a serial step. Networks too small to give every thread a 64-neuron block use
+    // fewer threads. stepEventDriven() and networks with delays stay serial.
+    void setThreads(int threads);
+    int getThreads() const { return num_threads; }
+
+    // force a narrower membrane kernel (e.g. Scalar to cross-check); clamped to what
+    // the CPU supports
+    void setSimdLevel(membrane::SimdLevel level) { simd = membrane::clamp(level); }
+    membrane::SimdLevel getSimdLevel() const { return simd; }
+
+    // step() delivers the edges between two ID-prefix groups as a dense projection
+    // when at least `min_density` of the possible edges exist and the targets all lie
+    // on one side of the sources in tick order; other edges (e.g. sparse recurrent
+    // H->H) stay in CSR. 0 turns projections off. Results are identical either way.
+    // Takes effect on the next build.
+    void setDenseProjections(float min_density);
+    float getDenseProjections() const { return dense_min_density; }
+
+    // neuron model of the membrane pass (see membrane_kernels.h); Lif by default.
+    // Takes effect on the next step.
+    void setNeuronModel(const membrane::ModelParams &m) { model = m; }
+    const membrane::ModelParams &getNeuronModel() const { return model; }
+
+    // true while the network runs the dynamics BatchedNetwork, InferenceModel and the
+    // device kernels implement: the Lif model and delay 1 on every edge
+    bool basicDynamics() const { return model.kind == membrane::NeuronModel::Lif && edges->max_delay <= 1; }
+
+    // advance by one tick visiting only neurons that can change: those with staged
+    // input, a refractory count, a spike last tick, or parameters that keep them from
+    // settling. Idle neurons are decayed lazily (value *= leak^dt) when next visited.
+    // Spikes keep the 1-tick staging of step(); results match it exactly when every
+    // leak is 0 or 1 and otherwise up to float rounding of the closed-form decay.
+    // Networks with delayed input (later_rows > 0) or a model other than Lif take a
+    // plain step() instead.
+    void stepEventDriven();
+
+    // true if, without new input, no neuron can fire again and every membrane only
+    // decays: nothing staged (delta, on_deck, delayed input), no refractory count, no
+    // spike last tick, leak in [0, 1] and 0 <= value <= threshold (plus any negative
+    // adaptation). O(neurons), O(pending) in event-driven mode.
+    bool isAtRest() const;
+
+    // advance `ticks` ticks without input in closed form, as the event-driven core decays
+    // idle neurons (value *= leak^ticks, adaptation *= adapt_decay^ticks). Matches
+    // `ticks` steps up to float rounding of the decay; only valid while isAtRest().
+    void fastForward(long long ticks);
+
+    // apply pending lazy decay to every neuron and drop the event-driven bookkeeping
+    // (called before a dense step and before state is copied out)
+    void settle();
+
+    // put every neuron at rest: value = resting, nothing staged (on_deck, delayed input),
+    // no refractory count, adaptation or spike. Parameters and weights are kept.
+    void resetState();
+
+    // accessors used by bound neurons; they keep the lazy bookkeeping consistent
+    float valueAt(int i) const;
+    void setValue(int i, float v);
+    void setThresholdAt(int i, float t);
+    void setLeakAt(int i, float l);
+    void stage(int i, float transmission, int delay = 1); // on_deck[i] += transmission for delay 1
+
+    // input staged for neuron i beyond on_deck, nearest tick first (Neuron::later order)
+    void pendingInput(int i, std::vector<float> &out) const;
+
+    bool isBound() const { return !bound.empty(); }
+    bool topologyDirty() const { return topology_dirty; }
+    bool weightsDirty() const { return weights_dirty; }
+    void markTopologyDirty() { topology_dirty = true; }
+    void markWeightsDirty() { weights_dirty = true; }
+
+    int size() const { return static_cast<int>(value.size()); }
+    int numEdges() const { return edges->numEdges(); }
+
+    // current edges; holders keep this version even when weights are refreshed later
+    std::shared_ptr<const CompiledTopology> topology() const { return edges; }
+    const CompiledTopology &csr() const { return *edges; }
+
+    // neuron i in tick order
+    Neuron *neuronAt(int i) const { return bound[i]; }
+
+    int num_sensory = 0;
+
+    // parameters
+    std::vector<float> threshold;
+    std::vector<float> leak;
+    std::vector<float> resting;
+    std::vector<int> refractory_period;
+
+    // dynamic state
+    std::vector<float> value;
+    std::vector<float> delta;   // input applied this tick
+    std::vector<float> on_deck; // input staged for next tick
+    std::vector<int> refractory;
+    std::vector<uint8_t> fired;
+    std::vector<uint64_t> fired_mask; // bit i set if neuron i fired (dense step only)
+    std::vector<float> adaptation;    // AdaptiveThreshold threshold offsets
+
+    // input for delays > 1: later_rows rows of size() values, row (later_head + k) %
+    // later_rows moves into on_deck k + 1 ticks from now. Empty without delays.
+    std::vector<float> later;
+    int later_rows = 0;
+    int later_head = 0;
+
+private:
+    // parallel step (see setThreads): one partition per thread, owning handles [lo, hi).
+    // offs/split/edge list, per source, the edges into the partition (indices into the
+    // CSR arrays step() uses: the sparse_* rows when the topology has dense projections),
+    // forward edges up to split[s] as in the full rows.
+    struct Partition
+    {
+        int lo = 0, hi = 0;
+        std::vector<int> offs, split, edge;
+        int fired_count = 0;
+    };
+    class StepTeam;
+    void buildPartitions();
+    void stepParallel();
+    void deliverPartition(Partition &p);
+    void deliverDelayed(); // step()'s delivery for topologies with delays
+    void reserveLater(int rows);
+
+    int num_threads = 1;
+    std::vector<Partition> partitions;
+    bool partitions_dirty = true; // rebuilt on the next parallel step
+    std::unique_ptr<StepTeam> team;
+
+    // event-driven bookkeeping: value[i] is current as of the end of tick last_tick[i]
+    bool isQuiescent(int i) const;
+    void materialize(int i);
+    void enqueue(int i);
+
+    std::shared_ptr<CompiledTopology> edges = std::make_shared<CompiledTopology>();
+    std::vector<Neuron *> bound;
+    std::vector<int> edge_slot; // CSR position of each edge in connection-map order
+    bool topology_dirty = true;
+    bool weights_dirty = false;
+    membrane::SimdLevel simd = membrane::detect();
+    float dense_min_density = 0.25f;
+    membrane::ModelParams model;
+
+    bool event_mode = false;
+    long long now = 0; // ticks completed in event-driven mode
+    std::vector<long long> last_tick;
+    std::vector<uint8_t> queued;
+    std::vector<int> active;     // neurons to visit next tick
+    std::vector<int> processing; // neurons being visited this tick
+    std::vector<int> spiked;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "device_network.h"
+
+// Without GLIA_CUDA there is no device: BatchedNetwork checks available() and runs on
+// the CPU. With it, device_network.cu provides these definitions instead.
+#if !defined(GLIA_CUDA)
+
+struct DeviceNetwork::Buffers
+{
+};
+
+DeviceNetwork::DeviceNetwork() {}
+
+DeviceNetwork::~DeviceNetwork() {}
+
+bool DeviceNetwork::available() { return false; }
+
+const char *DeviceNetwork::name() { return "none"; }
+
+bool DeviceNetwork::upload(const Model &, bool) { return false; }
+
+bool DeviceNetwork::run(const Inputs &, State &, uint64_t *) { return false; }
+
+#endif
@@ -0,0 +1,220 @@
+// CUDA backend of DeviceNetwork (compiled with GLIA_CUDA; see device_network.h)
+
+#include "device_network.h"
+
+#include <cuda_runtime.h>
+
+#include <string>
+
+namespace
+{
+
+// grow-only device array
+template <typename T>
+struct DeviceArray
+{
+    T *ptr = nullptr;
+    size_t cap = 0;
+
+    ~DeviceArray()
+    {
+        if (ptr) cudaFree(ptr);
+    }
+    bool reserve(size_t n)
+    {
+        if (n <= cap) return true;
+        if (ptr) cudaFree(ptr);
+        ptr = nullptr;
+        cap = 0;
+        if (cudaMalloc(reinterpret_cast<void **>(&ptr), n * sizeof(T)) != cudaSuccess) return false;
+        cap = n;
+        return true;
+    }
+    bool put(const T *host, size_t n)
+    {
+        if (!reserve(n ? n : 1)) return false;
+        return !n || cudaMemcpy(ptr, host, n * sizeof(T), cudaMemcpyHostToDevice) == cudaSuccess;
+    }
+    bool get(T *host, size_t n) const
+    {
+        return !n || cudaMemcpy(host, ptr, n * sizeof(T), cudaMemcpyDeviceToHost) == cudaSuccess;
+    }
+};
+
+const int block_size = 256;
+
+inline int blocks(size_t n) { return static_cast<int>((n + block_size - 1) / block_size); }
+
+// one thread per lane: the tick's inputs of a lane in injection order
+__global__ void injectKernel(int lanes, int tick, const int *offsets, const int *handles, const float *values, float *on_deck)
+{
+    const int b = blockIdx.x * blockDim.x + threadIdx.x;
+    if (b >= lanes) return;
+    const int slot = tick * lanes + b;
+    for (int k = offsets[slot]; k < offsets[slot + 1]; ++k)
+    {
+        float *dst = on_deck + static_cast<size_t>(handles[k]) * lanes + b;
+        *dst = __fadd_rn(*dst, values[k]);
+    }
+}
+
+// membrane::update for one (neuron, lane); __fmul_rn/__fadd_rn keep nvcc from fusing
+// leak*V + incoming into an FMA, which would round differently from the CPU
+__global__ void membraneKernel(size_t total, float *value, float *delta, float *on_deck, int *refractory, uint8_t *fired,
+                               const float *threshold, const float *leak, const float *resting)
+{
+    const size_t i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (i >= total) return;
+    fired[i] = 0;
+    const float incoming = delta[i];
+    delta[i] = on_deck[i];
+    on_deck[i] = 0.0f;
+    if (refractory[i] > 0)
+    {
+        refractory[i] -= 1;
+        return;
+    }
+    float v = __fadd_rn(__fmul_rn(leak[i], value[i]), incoming);
+    if (v < 0) v = 0;
+    if (v > threshold[i])
+    {
+        fired[i] = 1;
+        v = resting[i];
+    }
+    value[i] = v;
+}
+
+// pull delivery for one (target, lane): firing sources in source order, as the CPU pass
+// adds them
+__global__ void deliverKernel(size_t total, int lanes, const int *in_offsets, const int *in_split, const int *in_sources,
+                              const float *in_weights, const uint8_t *fired, float *delta, float *on_deck)
+{
+    const size_t k = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (k >= total) return;
+    const int t = static_cast<int>(k / lanes);
+    const int b = static_cast<int>(k - static_cast<size_t>(t) * lanes);
+    const int begin = in_offsets[t], split = in_split[t], end = in_offsets[t + 1];
+    if (begin == end) return;
+    float d = delta[k];
+    for (int e = begin; e < split; ++e)
+        if (fired[static_cast<size_t>(in_sources[e]) * lanes + b]) d = __fadd_rn(d, in_weights[e]);
+    delta[k] = d;
+    float o = on_deck[k];
+    for (int e = split; e < end; ++e)
+        if (fired[static_cast<size_t>(in_sources[e]) * lanes + b]) o = __fadd_rn(o, in_weights[e]);
+    on_deck[k] = o;
+}
+
+// one thread per (lane, word) of the tick's trace rows
+__global__ void packKernel(int neurons, int lanes, int words, const uint8_t *fired, uint64_t *rows)
+{
+    const int k = blockIdx.x * blockDim.x + threadIdx.x;
+    if (k >= lanes * words) return;
+    const int b = k / words, w = k - b * words;
+    uint64_t bits = 0;
+    const int end = min(neurons, (w + 1) * 64);
+    for (int i = w * 64; i < end; ++i)
+        if (fired[static_cast<size_t>(i) * lanes + b]) bits |= uint64_t(1) << (i & 63);
+    rows[static_cast<size_t>(b) * words + w] = bits;
+}
+
+} // namespace
+
+struct DeviceNetwork::Buffers
+{
+    DeviceArray<int> in_offsets, in_split, in_sources;
+    DeviceArray<float> in_weights;
+    DeviceArray<float> threshold, leak, resting;
+    DeviceArray<float> value, delta, on_deck;
+    DeviceArray<int> refractory;
+    DeviceArray<uint8_t> fired;
+    DeviceArray<int> input_offsets, input_handles;
+    DeviceArray<float> input_values;
+    DeviceArray<uint64_t> trace;
+};
+
+DeviceNetwork::DeviceNetwork() {}
+
+DeviceNetwork::~DeviceNetwork() {}
+
+bool DeviceNetwork::available()
+{
+    static const bool found = [] {
+        int count = 0;
+        return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+    }();
+    return found;
+}
+
+const char *DeviceNetwork::name()
+{
+    static const std::string label = [] {
+        cudaDeviceProp prop;
+        int dev = 0;
+        if (!available() || cudaGetDevice(&dev) != cudaSuccess || cudaGetDeviceProperties(&prop, dev) != cudaSuccess) return std::string("none");
+        return std::string("cuda: ") + prop.name;
+    }();
+    return label.c_str();
+}
+
+bool DeviceNetwork::upload(const Model &m, bool topology_changed)
+{
+    if (!available()) return false;
+    if (!buffers)
+    {
+        buffers.reset(new Buffers());
+        topology_changed = true;
+    }
+    Buffers &d = *buffers;
+    if (m.neurons != neurons) topology_changed = true;
+    neurons = m.neurons;
+    lanes = m.lanes;
+    const size_t total = static_cast<size_t>(neurons) * lanes;
+    bool ok = true;
+    if (topology_changed)
+    {
+        ok = ok && d.in_offsets.put(m.in_offsets, neurons + 1);
+        ok = ok && d.in_split.put(m.in_split, neurons);
+        ok = ok && d.in_sources.put(m.in_sources, m.edges);
+    }
+    ok = ok && d.in_weights.put(m.in_weights, m.edges);
+    ok = ok && d.threshold.put(m.threshold, total) && d.leak.put(m.leak, total) && d.resting.put(m.resting, total);
+    ok = ok && d.value.reserve(total) && d.delta.reserve(total) && d.on_deck.reserve(total);
+    ok = ok && d.refractory.reserve(total) && d.fired.reserve(total);
+    if (!ok) buffers.reset(); // start over (and re-send the topology) next time
+    return ok;
+}
+
+bool DeviceNetwork::run(const Inputs &in, State &s, uint64_t *trace)
+{
+    if (!buffers || neurons == 0) return false;
+    Buffers &d = *buffers;
+    const size_t total = static_cast<size_t>(neurons) * lanes;
+    const int W = words();
+    const size_t slots = static_cast<size_t>(in.ticks) * lanes;
+    const int entries = in.ticks > 0 ? in.offsets[slots] : 0;
+
+    bool ok = d.value.put(s.value, total) && d.delta.put(s.delta, total) && d.on_deck.put(s.on_deck, total);
+    ok = ok && d.refractory.put(s.refractory, total) && d.fired.put(s.fired, total);
+    ok = ok && d.input_offsets.put(in.offsets, slots + 1);
+    ok = ok && d.input_handles.put(in.handles, entries) && d.input_values.put(in.values, entries);
+    ok = ok && d.trace.reserve(slots * W > 0 ? slots * W : 1);
+    if (!ok) return false;
+
+    for (int t = 0; t < in.ticks; ++t)
+    {
+        injectKernel<<<blocks(lanes), block_size>>>(lanes, t, d.input_offsets.ptr, d.input_handles.ptr, d.input_values.ptr, d.on_deck.ptr);
+        membraneKernel<<<blocks(total), block_size>>>(total, d.value.ptr, d.delta.ptr, d.on_deck.ptr, d.refractory.ptr, d.fired.ptr,
+                                                      d.threshold.ptr, d.leak.ptr, d.resting.ptr);
+        deliverKernel<<<blocks(total), block_size>>>(total, lanes, d.in_offsets.ptr, d.in_split.ptr, d.in_sources.ptr, d.in_weights.ptr,
+                                                     d.fired.ptr, d.delta.ptr, d.on_deck.ptr);
+        packKernel<<<blocks(static_cast<size_t>(lanes) * W), block_size>>>(neurons, lanes, W, d.fired.ptr,
+                                                                            d.trace.ptr + static_cast<size_t>(t) * lanes * W);
+    }
+    if (cudaGetLastError() != cudaSuccess || cudaDeviceSynchronize() != cudaSuccess) return false;
+
+    // the trace first: if that fails the host state is still untouched
+    if (!d.trace.get(trace, slots * W)) return false;
+    return d.value.get(s.value, total) && d.delta.get(s.delta, total) && d.on_deck.get(s.on_deck, total) &&
+           d.refractory.get(s.refractory, total) && d.fired.get(s.fired, total);
+}
@@ -0,0 +1,91 @@
+#ifndef __device_network_h__
+#define __device_network_h__
+
+#include <cstdint>
+#include <memory>
+
+/*
+GPU backend for BatchedNetwork::run(): the lanes of a lockstep batch are simulated on
+the device for all ticks of the episode, and only the spikes (bit-packed, one row of
+words per tick and lane) and the final state come back to the host.
+
+Built when GLIA_CUDA is defined (CMake option GLIA_CUDA, device_network.cu); otherwise
+available() is false and BatchedNetwork stays on the CPU. The host hands over the same
+[neuron][lane] arrays BatchedNetwork keeps, plus the topology in pull form: incoming
+edges of every target, ordered by source handle (then by their position in the source's
+CSR row), with the edges from earlier sources (staged into delta) before the rest (into
+on_deck). Each (target, lane) then adds the weights of its firing sources in the order
+the CPU delivery pass does, and the membrane pass keeps multiply and add separate, so
+results are bit-identical to BatchedNetwork::step().
+
+Not thread-safe; one instance per BatchedNetwork.
+*/
+class DeviceNetwork
+{
+public:
+    struct Model
+    {
+        int neurons = 0;
+        int lanes = 0;
+        // incoming edges of target t: [in_offsets[t], in_offsets[t+1]), delta part up to in_split[t]
+        const int *in_offsets = nullptr;
+        const int *in_split = nullptr;
+        const int *in_sources = nullptr;
+        const float *in_weights = nullptr;
+        int edges = 0;
+        // [neuron][lane]
+        const float *threshold = nullptr;
+        const float *leak = nullptr;
+        const float *resting = nullptr;
+    };
+
+    // dynamic state, [neuron][lane]; uploaded before and downloaded after a run
+    struct State
+    {
+        float *value = nullptr;
+        float *delta = nullptr;
+        float *on_deck = nullptr;
+        int *refractory = nullptr;
+        uint8_t *fired = nullptr;
+    };
+
+    // per-tick input: entries of (tick t, lane b) are [offsets[t*lanes+b], offsets[t*lanes+b+1]),
+    // in injection order
+    struct Inputs
+    {
+        int ticks = 0;
+        const int *offsets = nullptr;
+        const int *handles = nullptr;
+        const float *values = nullptr;
+    };
+
+    DeviceNetwork();
+    ~DeviceNetwork();
+    DeviceNetwork(const DeviceNetwork &) = delete;
+    DeviceNetwork &operator=(const DeviceNetwork &) = delete;
+
+    // a usable device was found (and the build has a backend)
+    static bool available();
+    // backend and device, e.g. "cuda: NVIDIA A100", or "none"
+    static const char *name();
+
+    // Copy the model to the device. Topology arrays are only re-sent when `topology_changed`
+    // (weights always are). False if there is no device or it ran out of memory.
+    bool upload(const Model &model, bool topology_changed);
+
+    // Run `in.ticks` ticks from `state` (read before, overwritten after). Bit-packed fired
+    // flags go to `trace`: words() uint64 per (tick, lane), [tick][lane][word], bit i%64 of
+    // word i/64 for neuron i. False on a device error (`state` is left as it was unless
+    // copying it back failed).
+    bool run(const Inputs &in, State &state, uint64_t *trace);
+
+    int words() const { return (neurons + 63) / 64; }
+
+private:
+    struct Buffers; // device allocations (device_network.cu)
+    std::unique_ptr<Buffers> buffers;
+    int neurons = 0;
+    int lanes = 0;
+};
+
+#endif
@@ -1,27 +1,85 @@
 #include "glia.h"
 #include "neuron.h"
+#include "gnet_format.h"
+#include "profiling.h"
+#include "thread_pool.h"
+#include "random_streams.h"
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <random>
 #include <cmath>
+#include <functional>
+#include <cstdlib>
+#include <new>
+
+#if defined(GLIA_PROFILE) && defined(GLIA_PROFILE_ALLOCATIONS)
+// allocation counter of prof::Stats (see profiling.h); the array and sized forms forward here
+void *operator new(std::size_t n)
+{
+	++prof::allocationCount();
+	if (void *p = std::malloc(n ? n : 1)) return p;
+	throw std::bad_alloc();
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // free() is right: the new above is malloc()
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+#endif
+
+// neuron of a mapping by ID (null if absent)
+template <class Map>
+static Neuron *findMapped(const Map &mapping, const std::string &id)
+{
+	nid::Key key;
+	if (!nid::find(id, key)) return nullptr;
+	auto it = mapping.find(key);
+	return it == mapping.end() ? nullptr : it->second;
+}
+
+// Append to `out` (as base + column) each of the `n` columns except `skip`, each kept with
+// probability p: the gap to the next kept column is geometric, so only kept columns cost
+// a draw.
+static void sampleColumns(std::mt19937 &rng, int n, float p, int skip, int base, std::vector<int> &out)
+{
+	const int m = skip >= 0 ? n - 1 : n; // candidates, `skip` left out
+	if (m <= 0 || p <= 0.0f) return;
+	auto column = [&](int i) { return base + (skip >= 0 && i >= skip ? i + 1 : i); };
+	if (p >= 1.0f)
+	{
+		for (int i = 0; i < m; ++i) out.push_back(column(i));
+		return;
+	}
+	std::uniform_real_distribution<double> U01(0.0, 1.0);
+	const double log_q = std::log1p(-static_cast<double>(p));
+	for (double i = -1.0;;)
+	{
+		i += 1.0 + std::floor(std::log(1.0 - U01(rng)) / log_q);
+		if (i >= m) break;
+		out.push_back(column(static_cast<int>(i)));
+	}
+}
 
 
-Glia::Glia()
+Glia::Glia() : arena(std::make_shared<NeuronArena>())
 {
 }
 
 Glia::~Glia()
 {
-    // shared_ptr handles cleanup automatically
+    // unbind neurons first: they may outlive the network (handles from Python keep the arena)
+    compiled.release();
+    // the arena frees the neurons once no handle refers to it
     sensory_neurons.clear();
     neurons.clear();
     sensory_mapping.clear();
     neuron_mapping.clear();
 }
 
-Glia::Glia(int num_sensory, int num_neurons)
+Glia::Glia(int num_sensory, int num_neurons) : arena(std::make_shared<NeuronArena>())
 {
 	// sensory neurons
 	for (int i = 0; i < num_sensory; i++)
@@ -29,11 +87,11 @@ Glia::Glia(int num_sensory, int num_neurons)
 		// ID string
 		std::string id = "S" + std::to_string(i);
 
-		// Neuron object (managed via shared_ptr)
-		auto neuron = std::make_shared<Neuron>(id, num_sensory + num_neurons, 70.f, 1, 4, 100.f, true);
+		// Neuron object (owned by the arena)
+		auto neuron = arena->create(id, num_sensory + num_neurons, 70.f, 1, 4, 100.f, true);
 		sensory_neurons.push_back(neuron);
 		// mapping
-		sensory_mapping[id] = neuron;
+		sensory_mapping[neuron->getKey()] = neuron;
 	}
 
 	// interneurons (N* prefix by default)
@@ -41,27 +99,142 @@ Glia::Glia(int num_sensory, int num_neurons)
 	for (int i = 0; i < num_neurons; i++)
 	{
 		std::string id = "N" + std::to_string(i);
-		auto neuron = std::make_shared<Neuron>(id, num_sensory + num_neurons, 70.f, 1, 4, 100.0f, true);
+		auto neuron = arena->create(id, num_sensory + num_neurons, 70.f, 1, 4, 100.0f, true);
 		neurons.push_back(neuron);
-		neuron_mapping[id] = neuron;
+		neuron_mapping[neuron->getKey()] = neuron;
 	}
 }
 
+Glia::Glia(const Glia &other)
+	: arena(std::make_shared<NeuronArena>()), step_mode(other.step_mode), build_seed_set(other.build_seed_set), build_seed(other.build_seed),
+	  build_threads(other.build_threads)
+{
+	compiled.setSimdLevel(other.compiled.getSimdLevel());
+	compiled.setDenseProjections(other.compiled.getDenseProjections());
+	compiled.setThreads(other.compiled.getThreads());
+	compiled.setNeuronModel(other.compiled.getNeuronModel());
+	for (const auto &n : other.sensory_neurons)
+	{
+		Neuron *copy = arena->create(n->cloneUnconnected());
+		sensory_neurons.push_back(copy);
+		sensory_mapping[copy->getKey()] = copy;
+	}
+	for (const auto &n : other.neurons)
+	{
+		Neuron *copy = arena->create(n->cloneUnconnected());
+		neurons.push_back(copy);
+		neuron_mapping[copy->getKey()] = copy;
+	}
+
+	// rewire in the same order; edges to neurons outside the network keep their target
+	auto rewire = [this](const std::vector<Neuron *> &src, const std::vector<Neuron *> &dst)
+	{
+		for (size_t i = 0; i < src.size(); ++i)
+		{
+			for (const auto &kv : src[i]->getConnections())
+			{
+				Neuron *to = neuronByKey(kv.first);
+				if (!to) to = kv.second.second;
+				if (to) dst[i]->addConnection(kv.second.first, to, src[i]->getDelay(kv.first));
+			}
+		}
+	};
+	rewire(other.sensory_neurons, sensory_neurons);
+	rewire(other.neurons, neurons);
+}
+
 void Glia::step()
 {
+	GLIA_PROF_SCOPE(Step);
+	GLIA_PROF_COUNT(ticks, 1);
+	if (step_mode != StepMode::Reference && ensureCompiled())
+	{
+		if (step_mode == StepMode::EventDriven) compiled.stepEventDriven();
+		else compiled.step();
+		if (spike_recorder) recordSpikes();
+		return;
+	}
+
+	// reference path: neurons hold their own state
+	if (compiled.isBound()) compiled.release();
+
 	// call tick on every neuron
+	const membrane::ModelParams &model = compiled.getNeuronModel();
 	for (auto itr = sensory_neurons.begin(); itr != sensory_neurons.end(); ++itr)
 	{
-		(*itr)->tick();
+		(*itr)->tick(model);
 	}
 	for (auto itr = neurons.begin(); itr != neurons.end(); ++itr)
 	{
-		(*itr)->tick();
+		(*itr)->tick(model);
 	}
+	if (spike_recorder) recordSpikes();
+}
+
+bool Glia::isAtRest()
+{
+	return step_mode != StepMode::Reference && ensureCompiled() && compiled.isAtRest();
+}
+
+bool Glia::fastForward(int ticks)
+{
+	if (ticks <= 0) return true;
+	if (!isAtRest()) return false;
+	GLIA_PROF_SCOPE(Step);
+	GLIA_PROF_COUNT(ticks, ticks);
+	compiled.fastForward(ticks);
+	if (spike_recorder) spike_recorder->recordSilent(ticks, getNeuronCount());
+	return true;
+}
+
+void Glia::setStepMode(StepMode mode)
+{
+	step_mode = mode;
+	if (mode == StepMode::Reference && compiled.isBound()) compiled.release();
+}
+
+bool Glia::ensureCompiled()
+{
+	if (compiled.isBound() && !compiled.topologyDirty())
+	{
+		if (compiled.weightsDirty()) compiled.refreshWeights();
+		return true;
+	}
+	if (compile_failed) return false;
+
+	std::vector<Neuron *> order;
+	order.reserve(sensory_neurons.size() + neurons.size());
+	order.insert(order.end(), sensory_neurons.begin(), sensory_neurons.end());
+	order.insert(order.end(), neurons.begin(), neurons.end());
+	if (!compiled.build(order, static_cast<int>(sensory_neurons.size())))
+	{
+		compile_failed = true;
+		return false;
+	}
+	return true;
+}
+
+void Glia::invalidateCompiled()
+{
+	compiled.markTopologyDirty();
+	compile_failed = false;
+	structure_stamp = Neuron::nextStructureStamp();
+}
+
+void Glia::invalidateHandles()
+{
+	invalidateCompiled();
+	order_stamp = structure_stamp;
 }
 
 void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
 {
+	if (gnet::isGnetFile(filepath))
+	{
+		loadNetworkFromBinary(filepath, verbose);
+		return;
+	}
+
 	std::ifstream file(filepath);
 	if (!file.is_open())
 	{
@@ -86,6 +259,8 @@ void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
         float thr_S = 100.0f, leak_S = 1.0f;
         float thr_H = 45.0f,  leak_H = 0.90f;
         float thr_O = 55.0f,  leak_O = 1.0f;
+        bool has_seed = false;
+        uint64_t seed = 0;
     } nn;
     bool has_newnet = false;
 
@@ -115,6 +290,8 @@ void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
             std::string m; iss >> m; if (!m.empty()) nn.init = m;
         } else if (cmd == "EXCIT_RATIO") {
             float r = 0.0f; iss >> r; if (r > 0.0f) nn.excit_ratio = r;
+        } else if (cmd == "SEED") {
+            unsigned long long v = 0; if (iss >> v) { nn.seed = v; nn.has_seed = true; }
         } else if (cmd == "W_SCALE") {
             float s = 1.0f; iss >> s; if (s > 0.0f) nn.w_scale = s;
         } else if (cmd == "THRESHOLDS") {
@@ -127,80 +304,89 @@ void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
     }
 
     if (has_newnet) {
-        auto make_neuron = [&](const std::string &id, float thr, float leak) -> std::shared_ptr<Neuron> {
+        auto make_neuron = [&](const std::string &id, float thr, float leak) -> Neuron * {
             int comp = (int)(sensory_neurons.size() + neurons.size()) + 1;
-            auto n = std::make_shared<Neuron>(id, comp, /*resting*/0.0f, /*leak*/leak, /*refractory*/4, /*threshold*/thr, /*tick*/true);
+            auto n = arena->create(id, comp, /*resting*/0.0f, /*leak*/leak, /*refractory*/4, /*threshold*/thr, /*tick*/true);
             n->setThreshold(thr); n->setLeak(leak); n->setResting(0.0f);
-            if (!id.empty() && id[0] == 'S') { sensory_neurons.push_back(n); sensory_mapping[id] = n; }
-            else { neurons.push_back(n); neuron_mapping[id] = n; }
+            if (!id.empty() && id[0] == 'S') { sensory_neurons.push_back(n); sensory_mapping[n->getKey()] = n; }
+            else { neurons.push_back(n); neuron_mapping[n->getKey()] = n; }
             return n;
         };
 
-        std::vector<std::shared_ptr<Neuron>> Svec; Svec.reserve(nn.S);
-        std::vector<std::shared_ptr<Neuron>> Hvec; Hvec.reserve(nn.H);
-        std::vector<std::shared_ptr<Neuron>> Ovec; Ovec.reserve(nn.O);
-        std::shared_ptr<Neuron> Npool = nullptr;
+        std::vector<Neuron *> Svec; Svec.reserve(nn.S);
+        std::vector<Neuron *> Hvec; Hvec.reserve(nn.H);
+        std::vector<Neuron *> Ovec; Ovec.reserve(nn.O);
+        Neuron *Npool = nullptr;
 
         for (int i=0;i<nn.S;++i) Svec.push_back(make_neuron("S"+std::to_string(i), nn.thr_S, nn.leak_S));
         for (int i=0;i<nn.H;++i) Hvec.push_back(make_neuron("H"+std::to_string(i), nn.thr_H, nn.leak_H));
         for (int i=0;i<nn.O;++i) Ovec.push_back(make_neuron("O"+std::to_string(i), nn.thr_O, nn.leak_O));
         if (nn.pool) Npool = make_neuron("N0", 40.0f, 0.80f);
 
-        std::random_device rd; std::mt19937 rng(rd());
-        std::uniform_real_distribution<float> U01(0.0f, 1.0f);
-
-        struct Edge { std::shared_ptr<Neuron> from; std::shared_ptr<Neuron> to; bool is_pool_edge; };
-        std::vector<Edge> edges;
-        auto maybe_connect = [&](std::shared_ptr<Neuron> a, std::shared_ptr<Neuron> b, float dens){ if (a && b && U01(rng) < dens) { a->addConnection(0.0f, b); edges.push_back({a,b,false}); } };
-
-        // S->H, S->O
-        for (auto &s : Svec) for (auto &h : Hvec) maybe_connect(s,h,nn.dens_SH);
-        for (auto &s : Svec) for (auto &o : Ovec) maybe_connect(s,o,nn.dens_SO);
-        // H->H (no self), H->O
-        for (auto &h1 : Hvec) for (auto &h2 : Hvec) if (h1!=h2) maybe_connect(h1,h2,nn.dens_HH);
-        for (auto &h : Hvec) for (auto &o : Ovec) maybe_connect(h,o,nn.dens_HO);
+        // Random graph as CSR over source rows (S then H) and target columns (H then O).
+        // A row samples each block (S->H, S->O, H->H without self, H->O) by geometric
+        // skipping, so cost is per edge instead of per candidate pair, with RNGs seeded
+        // from (seed, row): rows are independent and can be built on any number of
+        // threads with the same result.
+        const uint64_t seed = nn.has_seed ? nn.seed : build_seed_set ? build_seed : std::random_device()();
+        const int rows = nn.S + nn.H;
+        std::vector<int> row_offsets(rows + 1, 0);
+        std::vector<int> targets;
+        std::vector<int> fanin(nn.H + nn.O, 0);
+        const int T = std::max(1, std::min(build_threads, rows));
+        auto parallel_rows = [&](const std::function<void(int, int, int)> &f) {
+            ThreadPool::shared()->parallelFor(T, [&](int t) { f(t, rows * t / T, rows * (t + 1) / T); });
+        };
 
-        if (Npool) {
-            for (auto &o : Ovec) { o->addConnection(+20.0f, Npool); edges.push_back({o,Npool,true}); }
-            for (auto &o : Ovec) { Npool->addConnection(-25.0f, o); edges.push_back({Npool,o,true}); }
+        // targets of each row, per thread in row order, then concatenated
+        std::vector<std::vector<int>> chunk_targets(T);
+        parallel_rows([&](int t, int lo, int hi) {
+            std::vector<int> &out = chunk_targets[t];
+            for (int r = lo; r < hi; ++r) {
+                std::mt19937 rng(static_cast<uint32_t>(rstream::mix(seed, 2 * static_cast<uint64_t>(r))));
+                const bool from_s = r < nn.S;
+                const int self = from_s ? -1 : r - nn.S;
+                sampleColumns(rng, nn.H, from_s ? nn.dens_SH : nn.dens_HH, self, 0, out);
+                sampleColumns(rng, nn.O, from_s ? nn.dens_SO : nn.dens_HO, -1, nn.H, out);
+                row_offsets[r + 1] = static_cast<int>(out.size());
+            }
+        });
+        for (int t = 0, base = 0; t < T; ++t) {
+            const int lo = rows * t / T, hi = rows * (t + 1) / T;
+            for (int r = lo; r < hi; ++r) row_offsets[r + 1] += base;
+            base += static_cast<int>(chunk_targets[t].size());
+            targets.insert(targets.end(), chunk_targets[t].begin(), chunk_targets[t].end());
+            std::vector<int>().swap(chunk_targets[t]);
         }
+        for (int c : targets) ++fanin[c];
 
-        // fan-in per target for init scaling
-        std::map<std::shared_ptr<Neuron>, int> fanin;
-        for (const auto &e : edges) { if (!e.is_pool_edge) fanin[e.to] += 1; }
-
-        // Assign random weights
-        for (const auto &e : edges) {
-            if (e.is_pool_edge) continue; // keep pool edges fixed
-            int fin = std::max(1, fanin[e.to]);
-            float limit = std::sqrt(6.0f / (float)fin); // default He-like
-            if (nn.init == "xavier") limit = std::sqrt(6.0f / (float)fin);
-            limit *= nn.w_scale;
-            std::uniform_real_distribution<float> U(-limit, +limit);
-            float w = U(rng);
-            if (U01(rng) > nn.excit_ratio) w = -std::fabs(w); else w = +std::fabs(w);
-            e.from->setTransmitter(e.to->getId(), w);
-        }
+        // weights: uniform in +-sqrt(6 / fan-in) * W_SCALE, sign by EXCIT_RATIO (xavier
+        // currently uses the same limit). Each row only writes its own source neuron's
+        // connections, so rows are materialized on the same threads.
+        parallel_rows([&](int, int lo, int hi) {
+            std::uniform_real_distribution<float> U01(0.0f, 1.0f);
+            for (int r = lo; r < hi; ++r) {
+                Neuron *from = r < nn.S ? Svec[r] : Hvec[r - nn.S];
+                std::mt19937 rng(static_cast<uint32_t>(rstream::mix(seed, 2 * static_cast<uint64_t>(r) + 1)));
+                for (int k = row_offsets[r]; k < row_offsets[r + 1]; ++k) {
+                    const float limit = std::sqrt(6.0f / (float)std::max(1, fanin[targets[k]])) * nn.w_scale;
+                    std::uniform_real_distribution<float> U(-limit, +limit);
+                    float w = U(rng);
+                    if (U01(rng) > nn.excit_ratio) w = -std::fabs(w); else w = +std::fabs(w);
+                    const int c = targets[k];
+                    from->addConnection(w, c < nn.H ? Hvec[c] : Ovec[c - nn.H]);
+                }
+            }
+        });
 
-        // Sanitize: remove any accidental null-pointer connections before use
-        int null_edge_count = 0;
-        for (auto &src : sensory_neurons) {
-            std::vector<std::string> bad;
-            const auto &conns = src->getConnections();
-            for (const auto &kv : conns) { if (kv.second.second == nullptr) { bad.push_back(kv.first); null_edge_count++; } }
-            for (const auto &to_id : bad) src->removeConnection(to_id);
-        }
-        for (auto &src : neurons) {
-            std::vector<std::string> bad;
-            const auto &conns = src->getConnections();
-            for (const auto &kv : conns) { if (kv.second.second == nullptr) { bad.push_back(kv.first); null_edge_count++; } }
-            for (const auto &to_id : bad) src->removeConnection(to_id);
+        // pool edges keep fixed weights
+        if (Npool) {
+            for (auto &o : Ovec) o->addConnection(+20.0f, Npool);
+            for (auto &o : Ovec) Npool->addConnection(-25.0f, o);
         }
 
+        invalidateHandles();
         if (verbose) {
-            if (null_edge_count > 0) {
-                std::cout << "Sanitized null connections: " << null_edge_count << std::endl;
-            }
             std::cout << "NEWNET built: S=" << nn.S << " H=" << nn.H << " O=" << nn.O << (nn.pool?" + pool":"") << std::endl;
             std::cout << "Network configuration loaded from " << filepath << std::endl;
         }
@@ -214,16 +400,16 @@ void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
         std::string cmd; iss >> cmd;
         if (cmd == "NEURON") {
             std::string id; float threshold, leak, resting; iss >> id >> threshold >> leak >> resting;
-            auto neuron = getNeuronById(id);
+            Neuron *neuron = neuronById(id);
             if (neuron) {
                 neuron->setThreshold(threshold);
                 neuron->setLeak(leak);
                 neuron->setResting(resting);
             } else {
                 int total_neurons = (int)(sensory_neurons.size() + neurons.size());
-                auto new_neuron = std::make_shared<Neuron>(id, total_neurons + 1, resting, leak, 4, threshold, true);
-                if (!id.empty() && id[0] == 'S') { sensory_neurons.push_back(new_neuron); sensory_mapping[id] = new_neuron; }
-                else { neurons.push_back(new_neuron); neuron_mapping[id] = new_neuron; }
+                auto new_neuron = arena->create(id, total_neurons + 1, resting, leak, 4, threshold, true);
+                if (!id.empty() && id[0] == 'S') { sensory_neurons.push_back(new_neuron); sensory_mapping[new_neuron->getKey()] = new_neuron; }
+                else { neurons.push_back(new_neuron); neuron_mapping[new_neuron->getKey()] = new_neuron; }
                 if (verbose) {
                     std::cout << "Created neuron " << id << ": threshold=" << threshold
                               << ", leak=" << leak << ", resting=" << resting << std::endl;
@@ -231,9 +417,16 @@ void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
             }
         } else if (cmd == "CONNECTION") {
             std::string from_id, to_id; float weight; iss >> from_id >> to_id >> weight;
-            addConnection(from_id, to_id, weight);
+            int delay; // optional synaptic delay in ticks
+            if (!(iss >> delay)) delay = 1;
+            if (delay < 1) {
+                std::cerr << "Warning: delay " << delay << " of " << from_id << " -> " << to_id << " raised to 1" << std::endl;
+                delay = 1;
+            }
+            addConnection(from_id, to_id, weight, delay);
         }
     }
+    invalidateHandles();
     if (verbose) {
         std::cout << "Network configuration loaded from " << filepath << std::endl;
     }
@@ -241,6 +434,13 @@ void Glia::configureNetworkFromFile(std::string filepath, bool verbose)
 
 void Glia::saveNetworkToFile(std::string filepath)
 {
+	const std::string ext = ".gnet";
+	if (filepath.size() >= ext.size() && filepath.compare(filepath.size() - ext.size(), ext.size(), ext) == 0)
+	{
+		saveNetworkToBinary(filepath);
+		return;
+	}
+
 	std::ofstream file(filepath);
 	if (!file.is_open())
 	{
@@ -277,7 +477,10 @@ void Glia::saveNetworkToFile(std::string filepath)
 		const auto &conns = src->getConnections();
 		for (const auto &kv : conns)
 		{
-			file << "CONNECTION " << src->getId() << " " << kv.first << " " << kv.second.first << "\n";
+			file << "CONNECTION " << src->getId() << " " << nid::name(kv.first) << " " << kv.second.first;
+			const int delay = src->getDelay(kv.first);
+			if (delay > 1) file << " " << delay;
+			file << "\n";
 		}
 	}
 	for (const auto &src : neurons)
@@ -285,7 +488,10 @@ void Glia::saveNetworkToFile(std::string filepath)
 		const auto &conns = src->getConnections();
 		for (const auto &kv : conns)
 		{
-			file << "CONNECTION " << src->getId() << " " << kv.first << " " << kv.second.first << "\n";
+			file << "CONNECTION " << src->getId() << " " << nid::name(kv.first) << " " << kv.second.first;
+			const int delay = src->getDelay(kv.first);
+			if (delay > 1) file << " " << delay;
+			file << "\n";
 		}
 	}
 
@@ -293,6 +499,144 @@ void Glia::saveNetworkToFile(std::string filepath)
 	std::cout << "Network saved to " << filepath << std::endl;
 }
 
+bool Glia::loadNetworkFromBinary(const std::string &filepath, bool verbose)
+{
+	gnet::MappedFile file;
+	if (!file.open(filepath))
+	{
+		std::cerr << "Error: Could not open network file: " << filepath << std::endl;
+		return false;
+	}
+	gnet::View view;
+	std::string error;
+	if (!view.check(file, error))
+	{
+		std::cerr << "Error: Invalid .gnet file " << filepath << ": " << error << std::endl;
+		return false;
+	}
+
+	const uint32_t n = view.header->num_neurons;
+	std::vector<Neuron *> by_index(n);
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const gnet::NeuronRecord &r = view.neurons[i];
+		const std::string id = view.id(i);
+		Neuron *neuron = neuronById(id);
+		if (neuron)
+		{
+			neuron->setThreshold(r.threshold);
+			neuron->setLeak(r.leak);
+			neuron->setResting(r.resting);
+		}
+		else
+		{
+			int total_neurons = (int)(sensory_neurons.size() + neurons.size());
+			neuron = arena->create(id, total_neurons + 1, r.resting, r.leak, 4, r.threshold, true);
+			if (r.flags & gnet::Sensory) { sensory_neurons.push_back(neuron); sensory_mapping[neuron->getKey()] = neuron; }
+			else { neurons.push_back(neuron); neuron_mapping[neuron->getKey()] = neuron; }
+		}
+		by_index[i] = neuron;
+	}
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		for (uint64_t k = view.row_offsets[i]; k < view.row_offsets[i + 1]; ++k)
+			by_index[i]->addConnection(view.weights[k], by_index[view.targets[k]]);
+	}
+	invalidateHandles();
+
+	if (verbose)
+	{
+		std::cout << "Network configuration loaded from " << filepath
+				  << " (" << n << " neurons, " << view.header->num_edges << " connections)" << std::endl;
+	}
+	return true;
+}
+
+void Glia::buildTables(gnet::Tables &t, int &skipped) const
+{
+	t.num_sensory = static_cast<uint32_t>(sensory_neurons.size());
+	std::unordered_map<nid::Key, uint32_t> index;
+	auto add_neuron = [&](const Neuron *nrn, bool sensory)
+	{
+		index[nrn->getKey()] = static_cast<uint32_t>(t.neurons.size());
+		gnet::NeuronRecord r;
+		r.threshold = nrn->getThreshold();
+		r.leak = nrn->getLeak();
+		r.resting = nrn->getResting();
+		r.flags = sensory ? gnet::Sensory : 0u;
+		r.id_offset = static_cast<uint32_t>(t.strings.size());
+		r.id_length = static_cast<uint32_t>(nrn->getId().size());
+		t.strings += nrn->getId();
+		t.neurons.push_back(r);
+	};
+	for (const auto &nrn : sensory_neurons) add_neuron(nrn, true);
+	for (const auto &nrn : neurons) add_neuron(nrn, false);
+
+	// edges to neurons outside this network cannot be stored
+	skipped = 0;
+	t.row_offsets.reserve(t.neurons.size() + 1);
+	t.row_offsets.push_back(0);
+	auto add_row = [&](const Neuron *src)
+	{
+		for (const auto &kv : src->getConnections())
+		{
+			auto it = index.find(kv.first);
+			if (it == index.end()) { skipped++; continue; }
+			t.targets.push_back(it->second);
+			t.weights.push_back(kv.second.first);
+		}
+		t.row_offsets.push_back(t.targets.size());
+	};
+	for (const auto &src : sensory_neurons) add_row(src);
+	for (const auto &src : neurons) add_row(src);
+}
+
+bool Glia::saveNetworkToBinary(const std::string &filepath)
+{
+	if (hasDelays())
+	{
+		std::cerr << "Error: .gnet files have no synaptic delays; save " << filepath << " as .net" << std::endl;
+		return false;
+	}
+	gnet::Tables t;
+	int skipped = 0;
+	buildTables(t, skipped);
+	if (!gnet::write(filepath, t))
+	{
+		std::cerr << "Error: Could not write network file: " << filepath << std::endl;
+		return false;
+	}
+	if (skipped > 0)
+		std::cerr << "Warning: " << skipped << " connections to unknown neurons not saved" << std::endl;
+	std::cout << "Network saved to " << filepath << std::endl;
+	return true;
+}
+
+bool Glia::saveFrozen(const std::string &filepath, float min_weight, bool reorder)
+{
+	if (hasDelays())
+	{
+		std::cerr << "Error: .gnet files have no synaptic delays; can't freeze to " << filepath << std::endl;
+		return false;
+	}
+	gnet::Tables t;
+	int skipped = 0;
+	buildTables(t, skipped);
+	gnet::FreezeOptions options;
+	options.min_weight = min_weight;
+	options.reorder = reorder;
+	gnet::FreezeStats stats;
+	if (!gnet::write(filepath, gnet::freeze(t, options, &stats)))
+	{
+		std::cerr << "Error: Could not write network file: " << filepath << std::endl;
+		return false;
+	}
+	std::cout << "Frozen network saved to " << filepath << ": " << stats.neurons_after << "/" << stats.neurons_before
+			  << " neurons, " << stats.edges_after << "/" << stats.edges_before << " connections ("
+			  << stats.edges_pruned << " below " << min_weight << ")" << std::endl;
+	return true;
+}
+
 void Glia::printNetwork()
 {
 	// Print connections by reading directly from neuron objects
@@ -301,7 +645,7 @@ void Glia::printNetwork()
 		std::cout << n->getId() << std::endl;
 		for (const auto &kv : n->getConnections())
 		{
-			std::cout << "\t" << n->getId() << ": --[" << kv.second.first << "]--> " << kv.first << std::endl;
+			std::cout << "\t" << n->getId() << ": --[" << kv.second.first << "]--> " << nid::name(kv.first) << std::endl;
 		}
 	}
 	for (const auto &n : neurons)
@@ -309,34 +653,24 @@ void Glia::printNetwork()
 		std::cout << n->getId() << std::endl;
 		for (const auto &kv : n->getConnections())
 		{
-			std::cout << "\t" << n->getId() << ": --[" << kv.second.first << "]--> " << kv.first << std::endl;
+			std::cout << "\t" << n->getId() << ": --[" << kv.second.first << "]--> " << nid::name(kv.first) << std::endl;
 		}
 	}
 }
 
-void Glia::addConnection(std::string from_id, std::string to_id, float weight)
+void Glia::addConnection(std::string from_id, std::string to_id, float weight, int delay)
 {
     // get neuron objects
-    std::shared_ptr<Neuron> from = nullptr;
-    std::shared_ptr<Neuron> to = nullptr;
+    Neuron *from = nullptr;
+    Neuron *to = nullptr;
 
     // get "from" object based on prefix: S* is sensory, anything else is regular neuron
-    if (!from_id.empty() && from_id[0] == 'S') {
-        auto it = sensory_mapping.find(from_id);
-        if (it != sensory_mapping.end()) from = it->second;
-    } else {
-        auto it = neuron_mapping.find(from_id);
-        if (it != neuron_mapping.end()) from = it->second;
-    }
+    if (!from_id.empty() && from_id[0] == 'S') from = findMapped(sensory_mapping, from_id);
+    else from = findMapped(neuron_mapping, from_id);
 
     // get "to" object based on prefix
-    if (!to_id.empty() && to_id[0] == 'S') {
-        auto it = sensory_mapping.find(to_id);
-        if (it != sensory_mapping.end()) to = it->second;
-    } else {
-        auto it = neuron_mapping.find(to_id);
-        if (it != neuron_mapping.end()) to = it->second;
-    }
+    if (!to_id.empty() && to_id[0] == 'S') to = findMapped(sensory_mapping, to_id);
+    else to = findMapped(neuron_mapping, to_id);
 
     if (!from || !to) {
         std::cerr << "Warning: addConnection skipped for missing neuron(s): " << from_id << " -> " << to_id << std::endl;
@@ -344,31 +678,220 @@ void Glia::addConnection(std::string from_id, std::string to_id, float weight)
     }
 
     // add connection to neuron object
-    from->addConnection(weight, to);
+    from->addConnection(weight, to, delay);
+    invalidateCompiled();
+}
+
+void Glia::resetState()
+{
+	// a bound neuron's state lives in the compiled arrays; neurons added since the last
+	// build (topology dirty) still hold their own, which the rebuild copies in
+	if (compiled.isBound()) compiled.resetState();
+	if (!compiled.isBound() || compiled.topologyDirty())
+		forEachNeuron([](Neuron &n) { n.resetState(); });
 }
 
 // apply "stimuli" to sensory neurons
 void Glia::injectSensory(const std::string &id, float amt)
 {
-	auto it = sensory_mapping.find(id);
-	if (it != sensory_mapping.end())
+	if (auto n = findMapped(sensory_mapping, id))
 	{
 		// std::cout << "injecting " << amt << " into " << id << std::endl;
-		it->second->receive(amt);
-		// std::cout << it->second->getValue() << std::endl;
+		n->receive(amt);
+		// std::cout << n->getValue() << std::endl;
+	}
+}
+
+int Glia::getNeuronHandle(const std::string &id) const
+{
+	nid::Key key;
+	if (!nid::find(id, key)) return -1;
+	int h = 0;
+	for (const auto &n : sensory_neurons)
+	{
+		if (n->getKey() == key) return h;
+		++h;
+	}
+	for (const auto &n : neurons)
+	{
+		if (n->getKey() == key) return h;
+		++h;
+	}
+	return -1;
+}
+
+std::vector<int> Glia::getNeuronHandles(const std::vector<std::string> &ids) const
+{
+	std::unordered_map<std::string, int> index;
+	index.reserve(sensory_neurons.size() + neurons.size());
+	int h = 0;
+	for (const auto &n : sensory_neurons) index.emplace(n->getId(), h++);
+	for (const auto &n : neurons) index.emplace(n->getId(), h++);
+
+	std::vector<int> out(ids.size(), -1);
+	for (size_t i = 0; i < ids.size(); ++i)
+	{
+		auto it = index.find(ids[i]);
+		if (it != index.end()) out[i] = it->second;
+	}
+	return out;
+}
+
+Neuron *Glia::neuronAtHandle(int handle) const
+{
+	const int s = static_cast<int>(sensory_neurons.size());
+	if (handle < 0) return nullptr;
+	if (handle < s) return sensory_neurons[handle];
+	if (handle - s < static_cast<int>(neurons.size())) return neurons[handle - s];
+	return nullptr;
+}
+
+void Glia::injectSensory(int handle, float amt)
+{
+	if (handle >= 0 && handle < (int)sensory_neurons.size())
+		sensory_neurons[handle]->receive(amt);
+}
+
+void Glia::injectSensoryBatch(const int *handles, const float *values, int n)
+{
+	const int s = static_cast<int>(sensory_neurons.size());
+	for (int i = 0; i < n; ++i)
+	{
+		if (handles[i] >= 0 && handles[i] < s)
+			sensory_neurons[handles[i]]->receive(values[i]);
+	}
+}
+
+bool Glia::didFire(int handle) const
+{
+	Neuron *n = neuronAtHandle(handle);
+	return n && n->didFire();
+}
+
+void Glia::getFiredMask(std::vector<uint64_t> &mask) const
+{
+	const int total = getNeuronCount();
+	mask.assign((total + 63) / 64, 0);
+	int h = 0;
+	for (const auto &n : sensory_neurons)
+	{
+		if (n->didFire()) mask[h >> 6] |= uint64_t(1) << (h & 63);
+		++h;
+	}
+	for (const auto &n : neurons)
+	{
+		if (n->didFire()) mask[h >> 6] |= uint64_t(1) << (h & 63);
+		++h;
+	}
+}
+
+void Glia::runDense(const float *inputs, int rows, int width, int ticks, uint8_t *raster, int *counts)
+{
+	const int total = getNeuronCount();
+	const int s = std::min(width, static_cast<int>(sensory_neurons.size()));
+	for (int t = 0; t < ticks; ++t)
+	{
+		if (t < rows)
+		{
+			const float *row = inputs + static_cast<size_t>(t) * width;
+			for (int j = 0; j < s; ++j)
+				if (row[j] != 0.0f) sensory_neurons[j]->receive(row[j]);
+		}
+		step();
+		recordFired(raster ? raster + static_cast<size_t>(t) * total : nullptr, counts);
+	}
+}
+
+void Glia::runSparse(const int *event_ticks, const int *handles, const float *values, int n, int ticks, uint8_t *raster, int *counts)
+{
+	if (ticks <= 0) return;
+	// bucket events by tick (stable, so same-tick events keep their order)
+	std::vector<int> offsets(ticks + 1, 0);
+	for (int k = 0; k < n; ++k)
+		if (event_ticks[k] >= 0 && event_ticks[k] < ticks) offsets[event_ticks[k] + 1]++;
+	for (int t = 0; t < ticks; ++t) offsets[t + 1] += offsets[t];
+	std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+	std::vector<int> order(offsets[ticks]);
+	for (int k = 0; k < n; ++k)
+		if (event_ticks[k] >= 0 && event_ticks[k] < ticks) order[fill[event_ticks[k]]++] = k;
+
+	const int total = getNeuronCount();
+	for (int t = 0; t < ticks; ++t)
+	{
+		for (int i = offsets[t]; i < offsets[t + 1]; ++i) injectSensory(handles[order[i]], values[order[i]]);
+		step();
+		recordFired(raster ? raster + static_cast<size_t>(t) * total : nullptr, counts);
+	}
+}
+
+void Glia::recordFired(uint8_t *row, int *counts)
+{
+	if (!row && !counts) return;
+	const int total = getNeuronCount();
+	if (step_mode != StepMode::Reference && compiled.isBound() && compiled.size() == total)
+	{
+		// handles are compiled indices
+		const uint8_t *f = compiled.fired.data();
+		if (row) std::copy(f, f + total, row);
+		if (counts)
+			for (int h = 0; h < total; ++h) counts[h] += f[h];
+		return;
+	}
+	int h = 0;
+	forEachNeuron([&](Neuron &nr) {
+		const uint8_t f = nr.didFire() ? 1 : 0;
+		if (row) row[h] = f;
+		if (counts) counts[h] += f;
+		++h;
+	});
+}
+
+void Glia::recordSpikes()
+{
+	const int total = getNeuronCount();
+	if (step_mode != StepMode::Reference && compiled.isBound() && compiled.size() == total)
+	{
+		spike_recorder->record(compiled.fired.data(), total);
+		return;
 	}
+	recorder_scratch.resize(total);
+	recordFired(recorder_scratch.data(), nullptr);
+	spike_recorder->record(recorder_scratch.data(), total);
 }
 
 // access neuron by ID (for configuration)
 std::shared_ptr<Neuron> Glia::getNeuronById(const std::string &id)
+{
+	nid::Key key;
+	if (!nid::find(id, key)) return nullptr; // no neuron ever had this ID
+	return getNeuronByKey(key);
+}
+
+Neuron *Glia::neuronById(const std::string &id) const
+{
+	nid::Key key;
+	return nid::find(id, key) ? neuronByKey(key) : nullptr;
+}
+
+std::shared_ptr<Neuron> Glia::getNeuronByKey(nid::Key key)
+{
+	return handle(neuronByKey(key));
+}
+
+std::shared_ptr<Neuron> Glia::handle(Neuron *n) const
+{
+	return n ? std::shared_ptr<Neuron>(arena, n) : nullptr;
+}
+
+Neuron *Glia::neuronByKey(nid::Key key) const
 {
 	// Check sensory neurons first
-	auto it_s = sensory_mapping.find(id);
+	auto it_s = sensory_mapping.find(key);
 	if (it_s != sensory_mapping.end())
 		return it_s->second;
 
 	// Check interneurons
-	auto it_n = neuron_mapping.find(id);
+	auto it_n = neuron_mapping.find(key);
 	if (it_n != neuron_mapping.end())
 		return it_n->second;
 
@@ -377,13 +900,43 @@ std::shared_ptr<Neuron> Glia::getNeuronById(const std::string &id)
 	return nullptr;
 }
 
+std::shared_ptr<Neuron> Glia::addNeuron(const std::string &id, float threshold, float leak)
+{
+	if (id.empty() || id[0] == 'S') return nullptr;
+	Neuron *existing = neuronById(id);
+	if (existing) return handle(existing);
+	const int comp = static_cast<int>(sensory_neurons.size() + neurons.size()) + 1;
+	Neuron *n = arena->create(id, comp, 0.0f, leak, 4, threshold, true);
+	n->setThreshold(threshold);
+	n->setLeak(leak);
+	n->setResting(0.0f);
+	neurons.push_back(n);
+	neuron_mapping[n->getKey()] = n;
+	invalidateHandles();
+	return handle(n);
+}
+
+void Glia::reorderNeurons()
+{
+	gnet::Tables t;
+	int skipped = 0;
+	buildTables(t, skipped);
+	const std::vector<uint32_t> order = gnet::layerOrder(t);
+	const size_t s = sensory_neurons.size();
+	std::vector<Neuron *> reordered;
+	reordered.reserve(neurons.size());
+	for (size_t p = s; p < order.size(); ++p) reordered.push_back(neurons[order[p] - s]);
+	neurons.swap(reordered);
+	invalidateHandles();
+}
+
 // get all sensory neuron IDs
 std::vector<std::string> Glia::getSensoryNeuronIDs() const
 {
 	std::vector<std::string> ids;
 	for (const auto& kv : sensory_mapping)
 	{
-		ids.push_back(kv.first);
+		ids.push_back(nid::name(kv.first));
 	}
 	return ids;
 }
@@ -406,6 +959,15 @@ std::vector<std::string> Glia::getAllNeuronIDs() const
 	return ids;
 }
 
+std::vector<nid::Key> Glia::getAllNeuronKeys() const
+{
+	std::vector<nid::Key> keys;
+	keys.reserve(sensory_neurons.size() + neurons.size());
+	for (const auto &n : sensory_neurons) keys.push_back(n->getKey());
+	for (const auto &n : neurons) keys.push_back(n->getKey());
+	return keys;
+}
+
 void Glia::getState(std::vector<std::string> &ids,
                     std::vector<float> &values,
                     std::vector<float> &thresholds,
@@ -444,7 +1006,7 @@ void Glia::setState(const std::vector<std::string> &ids,
 	}
 	
 	for (size_t i = 0; i < ids.size(); ++i) {
-		auto n = getNeuronById(ids[i]);
+		Neuron *n = neuronById(ids[i]);
 		if (n) {
 			n->setThreshold(thresholds[i]);
 			n->setLeak(leaks[i]);
@@ -471,7 +1033,7 @@ void Glia::getWeights(std::vector<std::string> &from_ids,
 		const auto &conns = src->getConnections();
 		for (const auto &kv : conns) {
 			from_ids.push_back(src->getId());
-			to_ids.push_back(kv.first);
+			to_ids.push_back(nid::name(kv.first));
 			weights.push_back(kv.second.first);
 		}
 	}
@@ -481,7 +1043,7 @@ void Glia::getWeights(std::vector<std::string> &from_ids,
 		const auto &conns = src->getConnections();
 		for (const auto &kv : conns) {
 			from_ids.push_back(src->getId());
-			to_ids.push_back(kv.first);
+			to_ids.push_back(nid::name(kv.first));
 			weights.push_back(kv.second.first);
 		}
 	}
@@ -497,22 +1059,29 @@ void Glia::setWeights(const std::vector<std::string> &from_ids,
 	}
 	
 	for (size_t i = 0; i < from_ids.size(); ++i) {
-		auto from = getNeuronById(from_ids[i]);
-		auto to = getNeuronById(to_ids[i]);
+		Neuron *from = neuronById(from_ids[i]);
+		Neuron *to = neuronById(to_ids[i]);
 		
 		if (from && to) {
 			const auto &conns = from->getConnections();
-			if (conns.find(to_ids[i]) != conns.end()) {
+			if (conns.find(to->getKey()) != conns.end()) {
 				// Connection exists, update weight
-				from->setTransmitter(to_ids[i], weights[i]);
+				from->setTransmitter(to->getKey(), weights[i]);
 			} else {
 				// Create new connection
 				from->addConnection(weights[i], to);
+				invalidateCompiled();
 			}
 		}
 	}
 }
 
+void Glia::commitCompiledEdits()
+{
+	// arrays from before a pending rebuild no longer line up with the connection maps
+	if (compiled.isBound() && !compiled.topologyDirty()) compiled.storeToNeurons();
+}
+
 int Glia::getConnectionCount() const
 {
 	int count = 0;
@@ -524,3 +1093,23 @@ int Glia::getConnectionCount() const
 	}
 	return count;
 }
+
+bool Glia::hasDelays() const
+{
+	for (const auto &n : sensory_neurons)
+		if (n->hasDelays()) return true;
+	for (const auto &n : neurons)
+		if (n->hasDelays()) return true;
+	return false;
+}
+
+uint64_t Glia::getStructureVersion() const
+{
+	// stamps only grow, so the newest one changes with any edit to this network
+	uint64_t v = structure_stamp;
+	for (const auto &n : sensory_neurons)
+		v = std::max(v, n->getStructureStamp());
+	for (const auto &n : neurons)
+		v = std::max(v, n->getStructureStamp());
+	return v;
+}
@@ -5,8 +5,16 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <cstdint>
+
+#include "compiled_network.h"
+#include "neuron_ids.h"
+#include "spike_recorder.h"
+
+namespace gnet { struct Tables; }
 
 class Neuron;
+class NeuronArena;
 
 /*
 Class representing
@@ -19,14 +27,86 @@ public:
 	Glia(int num_sensory, int num_neurons);
 	~Glia();
 
+	// deep copy: new neurons with the same parameters, dynamic state, connections,
+	// step mode, SIMD level and step threads; the compiled form is rebuilt on the first step. The
+	// spike recorder is not copied.
+	// Cheaper than re-reading a .net file when many copies of one network are needed.
+	Glia(const Glia &other);
+	Glia &operator=(const Glia &) = delete;
+
 	// tick/step function
 	void step();
 
+	// Quiescence fast-forward: when no neuron can fire again without new input
+	// (CompiledNetwork::isAtRest()), `ticks` silent steps reduce to closed-form leak, so
+	// fastForward() advances them in one O(neurons) pass (O(pending) event-driven) and
+	// feeds the spike recorder empty ticks. It returns false and does nothing when the
+	// network is not at rest, can't be compiled or runs in Reference mode; the caller then
+	// steps as usual. Membranes match stepping up to float rounding of leak^ticks.
+	// Inject nothing in between: skipped ticks have no input.
+	bool isAtRest();
+	bool fastForward(int ticks);
+
+	// simulation engine used by step():
+	//   Compiled  - flat SoA/CSR core (default); falls back to Reference when the
+	//               network cannot be compiled (e.g. non-tick neurons)
+	//   EventDriven - compiled core that only visits neurons with pending input or
+	//               recent spikes; idle neurons decay lazily (leak^dt), so cost per
+	//               tick scales with activity rather than network size
+	//   Reference - per-object Neuron::tick() loop
+	enum class StepMode { Compiled, EventDriven, Reference };
+	void setStepMode(StepMode mode);
+	StepMode getStepMode() const { return step_mode; }
+
+	// membrane kernel used by the compiled core; defaults to the widest the CPU
+	// supports, and can be narrowed (e.g. to Scalar) to cross-check results
+	void setSimdLevel(membrane::SimdLevel level) { compiled.setSimdLevel(level); }
+	membrane::SimdLevel getSimdLevel() const { return compiled.getSimdLevel(); }
+
+	// minimum density at which the compiled core delivers the edges between two ID-prefix
+	// groups (e.g. S->H, H->O) as a dense projection instead of CSR; 0 disables
+	void setDenseProjections(float min_density) { compiled.setDenseProjections(min_density); }
+	float getDenseProjections() const { return compiled.getDenseProjections(); }
+
+	// threads a compiled step runs on (1 = serial); results don't depend on it. Pays off
+	// for large networks; event-driven and reference steps stay serial
+	void setStepThreads(int threads) { compiled.setThreads(threads); }
+	int getStepThreads() const { return compiled.getThreads(); }
+
+	// neuron model of every step mode (see membrane_kernels.h): Lif (default),
+	// LifRefractory (firing starts each neuron's refractory period) or AdaptiveThreshold.
+	// EventDriven steps as Compiled under the other models, and batched training and
+	// InferenceModel need Lif.
+	void setNeuronModel(const membrane::ModelParams &model) { compiled.setNeuronModel(model); }
+	const membrane::ModelParams &getNeuronModel() const { return compiled.getNeuronModel(); }
+
+	// compiled form, built/refreshed on demand (nullptr if the network can't be compiled);
+	// used by BatchedNetwork to replicate the network and write lane state back
+	CompiledNetwork *getCompiled() { return ensureCompiled() ? &compiled : nullptr; }
+
     // file handling to load/save networks
     // verbose: if true (default), prints creation/loading info
+    // the binary .gnet format is detected by its magic when loading and chosen by the
+    // .gnet extension when saving
     void configureNetworkFromFile(std::string filepath, bool verbose = true);
+
+	// random graphs of NEWNET files: seed used when the file has no SEED line (otherwise
+	// std::random_device), and row chunks sampled in parallel (on ThreadPool::shared());
+	// the graph only depends on the seed
+	void setBuildSeed(uint64_t seed) { build_seed = seed; build_seed_set = true; }
+	void setBuildThreads(int threads) { build_threads = threads > 0 ? threads : 1; }
 	void saveNetworkToFile(std::string filepath);
 
+	// binary .gnet format (see gnet_format.h); false (with a message on cerr) on failure.
+	// Loading merges into the network like the text loader: existing IDs are updated.
+	bool loadNetworkFromBinary(const std::string &filepath, bool verbose = true);
+	// Synaptic delays are text-only: networks with delays are refused.
+	bool saveNetworkToBinary(const std::string &filepath);
+	// inference copy in .gnet form (see gnet::freeze): edges with |weight| < min_weight
+	// and neurons that can't affect an output dropped, the rest renumbered by layer
+	// (reorder). The network itself is unchanged.
+	bool saveFrozen(const std::string &filepath, float min_weight = 0.0f, bool reorder = true);
+
 	// debug printing
 	void printNetwork();
 
@@ -43,8 +123,59 @@ public:
 	// apply "stimuli" to sensory neurons
 	void injectSensory(const std::string &id, float amt);
 
+	// put every neuron at rest (value = resting) and drop staged input, refractory counts,
+	// adaptation and the last tick's spikes, as after loading; parameters and weights stay.
+	// Fills of the compiled arrays, no per-neuron work once the network is compiled, so
+	// episodes can start from the same state without reloading the network.
+	void resetState();
+
+	// Handles: a neuron's position in tick order (its index in getAllNeuronIDs(); sensory
+	// neurons come first, so a sensory handle is also its sensory index). They stay valid
+	// until neurons are added, removed or reordered; resolve IDs once and use these in
+	// per-tick loops.
+	int getNeuronHandle(const std::string &id) const; // -1 if unknown
+	std::vector<int> getNeuronHandles(const std::vector<std::string> &ids) const;
+	int getSensoryCount() const { return static_cast<int>(sensory_neurons.size()); }
+
+	// inject by handle; handles that are not sensory are ignored, like unknown IDs above
+	void injectSensory(int handle, float amt);
+	void injectSensoryBatch(const int *handles, const float *values, int n);
+
+	// firing of the last step by handle; the mask has bit (h % 64) of word h / 64 set
+	// for each neuron h that fired
+	bool didFire(int handle) const;
+	void getFiredMask(std::vector<uint64_t> &mask) const;
+
+	// Run `ticks` steps in one call, injecting input from arrays and recording spikes.
+	//   runDense:  before tick t < rows, inputs[t * width + j] goes into sensory handle j
+	//              (zeros are skipped); later ticks get no input
+	//   runSparse: event k puts values[k] into handles[k] before tick event_ticks[k], in
+	//              event order; events outside [0, ticks) are ignored
+	// raster (ticks x getNeuronCount(), by handle) receives the fired flags after every
+	// tick and counts (getNeuronCount()) is incremented per spike; either may be null.
+	void runDense(const float *inputs, int rows, int width, int ticks, uint8_t *raster, int *counts);
+	void runSparse(const int *event_ticks, const int *handles, const float *values, int n, int ticks, uint8_t *raster, int *counts);
+
+	// spike recorder fed after every step (see spike_recorder.h); nullptr detaches
+	void setSpikeRecorder(std::shared_ptr<SpikeRecorder> recorder) { spike_recorder = std::move(recorder); }
+	std::shared_ptr<SpikeRecorder> getSpikeRecorder() const { return spike_recorder; }
+
 	// access neuron by ID (for configuration)
 	std::shared_ptr<Neuron> getNeuronById(const std::string &id);
+	std::shared_ptr<Neuron> getNeuronByKey(nid::Key key); // by interned ID (see neuron_ids.h)
+
+	// interneuron `id` (as NEWNET makes them: resting 0, refractory 4), appended after the
+	// others, i.e. with the next handle; the existing neuron if the ID is taken. IDs starting
+	// with 'S' are rejected (sensory neurons come first in handle order): nullptr.
+	std::shared_ptr<Neuron> addNeuron(const std::string &id, float threshold, float leak);
+
+	// Renumber the interneurons and outputs in layer order (gnet::layerOrder: distance
+	// from the inputs, then ID prefix), so spike delivery writes to neighbouring state.
+	// Only moves a neuron where every edge stays on its side of the tick order, so spike
+	// timing is unchanged; inputs may be summed in another order. IDs and sensory handles
+	// stay; other handles change (re-resolve them, as after adding neurons; see
+	// getNeuronOrderVersion()).
+	void reorderNeurons();
 	
 	// get all sensory neuron IDs
 	std::vector<std::string> getSensoryNeuronIDs() const;
@@ -56,6 +187,8 @@ public:
 	 * @return Vector of neuron IDs (sensory neurons first, then interneurons)
 	 */
 	std::vector<std::string> getAllNeuronIDs() const;
+	// the same as interned keys (see neuron_ids.h), by handle
+	std::vector<nid::Key> getAllNeuronKeys() const;
 	
 	/**
 	 * @brief Get network state as flat arrays
@@ -100,6 +233,14 @@ public:
 	                const std::vector<std::string> &to_ids,
 	                const std::vector<float> &weights);
 	
+	/**
+	 * @brief Copy edits made directly in the compiled arrays into the neurons
+	 * @note The Python views write thresholds, leaks, resting values and weights in
+	 *       place; call this before save(), copying, or editing the same values
+	 *       through Neuron, which would otherwise not see them
+	 */
+	void commitCompiledEdits();
+	
 	/**
 	 * @brief Get total neuron count
 	 * @return Total number of neurons (sensory + internal)
@@ -112,14 +253,67 @@ public:
 	 */
 	int getConnectionCount() const;
 
+	// true if any connection has a synaptic delay > 1 (CONNECTION ... <delay> in .net)
+	bool hasDelays() const;
+
+	// changes whenever connections are added or removed or neurons are loaded or
+	// reordered (weights and parameters aside); compare for equality, e.g. to tell if an
+	// index of the edges is still current. O(neurons).
+	uint64_t getStructureVersion() const;
+
+	// changes whenever neurons are loaded, added or reordered, i.e. when a handle may
+	// name another neuron; caches by handle (IDs, outputs, per-neuron state) are current
+	// while it is unchanged. O(1).
+	uint64_t getNeuronOrderVersion() const { return order_stamp; }
+
 private:
-	// vectors of neuron objects (managed via shared_ptr for Python bindings)
-	std::vector<std::shared_ptr<Neuron>> sensory_neurons;
-	std::vector<std::shared_ptr<Neuron>> neurons;
-	std::map<std::string, std::shared_ptr<Neuron>> sensory_mapping;
-	std::map<std::string, std::shared_ptr<Neuron>> neuron_mapping;
+	// every neuron of the network, owned by the arena (see neuron.h); the vectors and
+	// mappings below point into it
+	std::shared_ptr<NeuronArena> arena;
+	std::vector<Neuron *> sensory_neurons;
+	std::vector<Neuron *> neurons;
+	// by interned ID, in ID order
+	std::map<nid::Key, Neuron *, nid::ByName> sensory_mapping;
+	std::map<nid::Key, Neuron *, nid::ByName> neuron_mapping;
+
+	// a handle to one of this network's neurons that keeps the arena alive (null for null)
+	std::shared_ptr<Neuron> handle(Neuron *n) const;
+	Neuron *neuronByKey(nid::Key key) const; // null if absent
+	Neuron *neuronById(const std::string &id) const;
+
+	// compiled simulation core (see compiled_network.h)
+	CompiledNetwork compiled;
+	StepMode step_mode = StepMode::Compiled;
+	bool compile_failed = false; // last build was rejected; retried after structural changes
+	uint64_t structure_stamp = 0; // Neuron::nextStructureStamp() of the last Glia-level structural change
+	uint64_t order_stamp = 0;     // structure_stamp when handles were last (re)assigned
+
+	std::shared_ptr<SpikeRecorder> spike_recorder;
+	std::vector<uint8_t> recorder_scratch; // fired flags of the reference path
+
+	// NEWNET construction (see setBuildSeed)
+	bool build_seed_set = false;
+	uint64_t build_seed = 0;
+	int build_threads = 1;
+
+	// build/refresh the compiled form if needed; false if the network can't be compiled
+	bool ensureCompiled();
+	// mark the compiled form stale after Glia-level structural changes
+	void invalidateCompiled();
+	// invalidateCompiled() after neurons were loaded, added or reordered
+	void invalidateHandles();
+
+	// neuron by handle, nullptr if out of range
+	Neuron *neuronAtHandle(int handle) const;
+	// fired flags of the last step into row / counts (either may be null)
+	void recordFired(uint8_t *row, int *counts);
+	// hand the last step's fired flags to the spike recorder
+	void recordSpikes();
+
+	// the network as .gnet tables; `skipped` counts edges to neurons outside it
+	void buildTables(gnet::Tables &t, int &skipped) const;
 
 	// helper function for config
-	void addConnection(std::string from_id, std::string to_id, float weight);
+	void addConnection(std::string from_id, std::string to_id, float weight, int delay = 1);
 };
 #endif
@@ -0,0 +1,353 @@
+#include "gnet_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gnet
+{
+
+static uint64_t align8(uint64_t x) { return (x + 7) & ~static_cast<uint64_t>(7); }
+
+MappedFile::~MappedFile()
+{
+#if !defined(_WIN32)
+    if (mapped) munmap(const_cast<unsigned char *>(bytes), length);
+#endif
+}
+
+bool MappedFile::open(const std::string &path)
+{
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    bytes = static_cast<const unsigned char *>(p);
+    length = static_cast<size_t>(st.st_size);
+    mapped = true;
+    return true;
+#else
+    std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return false;
+    std::streamoff n = in.tellg();
+    if (n <= 0) return false;
+    buffer.resize(static_cast<size_t>(n));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(buffer.data()), n)) return false;
+    bytes = buffer.data();
+    length = buffer.size();
+    return true;
+#endif
+}
+
+bool isGnetFile(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char m[4];
+    if (!in.read(m, 4)) return false;
+    return std::memcmp(m, magic, 4) == 0;
+}
+
+/*
+Sections are written in file order with zero padding up to each 8-byte boundary.
+*/
+bool write(const std::string &path, const Tables &t)
+{
+    const uint64_t n = t.neurons.size();
+    const uint64_t e = t.targets.size();
+    if (t.row_offsets.size() != n + 1 || t.weights.size() != e) return false;
+
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, magic, 4);
+    h.version = version;
+    h.num_neurons = static_cast<uint32_t>(n);
+    h.num_sensory = t.num_sensory;
+    h.num_edges = e;
+    h.string_bytes = t.strings.size();
+    h.neurons_offset = align8(sizeof(Header));
+    h.strings_offset = align8(h.neurons_offset + n * sizeof(NeuronRecord));
+    h.rows_offset = align8(h.strings_offset + h.string_bytes);
+    h.targets_offset = align8(h.rows_offset + (n + 1) * sizeof(uint64_t));
+    h.weights_offset = align8(h.targets_offset + e * sizeof(uint32_t));
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    uint64_t pos = 0;
+    auto put = [&](uint64_t offset, const void *data, uint64_t bytes) {
+        static const char zeros[8] = {0};
+        while (pos < offset)
+        {
+            uint64_t pad = offset - pos < 8 ? offset - pos : 8;
+            out.write(zeros, static_cast<std::streamsize>(pad));
+            pos += pad;
+        }
+        if (bytes) out.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+        pos += bytes;
+    };
+    put(0, &h, sizeof(h));
+    put(h.neurons_offset, t.neurons.data(), n * sizeof(NeuronRecord));
+    put(h.strings_offset, t.strings.data(), h.string_bytes);
+    put(h.rows_offset, t.row_offsets.data(), (n + 1) * sizeof(uint64_t));
+    put(h.targets_offset, t.targets.data(), e * sizeof(uint32_t));
+    put(h.weights_offset, t.weights.data(), e * sizeof(float));
+    return static_cast<bool>(out);
+}
+
+namespace
+{
+
+char prefixOf(const Tables &t, uint32_t i) { return t.neurons[i].id_length ? t.strings[t.neurons[i].id_offset] : '\0'; }
+
+// neurons `order` of t (old indices, in their new order) with the edges keep_edge(k)
+// accepts between them; rows by target
+template <class KeepEdge>
+Tables select(const Tables &t, const std::vector<uint32_t> &order, KeepEdge keep_edge)
+{
+    std::vector<uint32_t> renumber(t.neurons.size(), UINT32_MAX);
+    for (size_t p = 0; p < order.size(); ++p) renumber[order[p]] = static_cast<uint32_t>(p);
+
+    Tables out;
+    out.num_sensory = 0;
+    out.row_offsets.push_back(0);
+    std::vector<std::pair<uint32_t, float>> row;
+    for (uint32_t i : order)
+    {
+        NeuronRecord r = t.neurons[i];
+        r.id_offset = static_cast<uint32_t>(out.strings.size());
+        out.strings.append(t.strings, t.neurons[i].id_offset, t.neurons[i].id_length);
+        out.neurons.push_back(r);
+        if (i < t.num_sensory) out.num_sensory++;
+
+        row.clear();
+        for (uint64_t k = t.row_offsets[i]; k < t.row_offsets[i + 1]; ++k)
+            if (renumber[t.targets[k]] != UINT32_MAX && keep_edge(k)) row.push_back(std::make_pair(renumber[t.targets[k]], t.weights[k]));
+        std::sort(row.begin(), row.end());
+        for (const auto &e : row)
+        {
+            out.targets.push_back(e.first);
+            out.weights.push_back(e.second);
+        }
+        out.row_offsets.push_back(out.targets.size());
+    }
+    return out;
+}
+
+// hops from the nearest sensory neuron or neuron that fires without input (-1: never fires)
+std::vector<int> layers(const Tables &t, const std::function<bool(uint64_t)> &edge)
+{
+    const uint32_t n = static_cast<uint32_t>(t.neurons.size());
+    std::vector<int> layer(n, -1);
+    std::vector<uint32_t> queue;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const NeuronRecord &r = t.neurons[i];
+        if (i < t.num_sensory || r.threshold < 0.0f || r.resting > r.threshold)
+        {
+            layer[i] = 0;
+            queue.push_back(i);
+        }
+    }
+    for (size_t q = 0; q < queue.size(); ++q)
+    {
+        const uint32_t i = queue[q];
+        for (uint64_t k = t.row_offsets[i]; k < t.row_offsets[i + 1]; ++k)
+        {
+            if (!edge(k) || layer[t.targets[k]] >= 0) continue;
+            layer[t.targets[k]] = layer[i] + 1;
+            queue.push_back(t.targets[k]);
+        }
+    }
+    return layer;
+}
+
+} // namespace
+
+std::vector<uint32_t> layerOrder(const Tables &t)
+{
+    const uint32_t n = static_cast<uint32_t>(t.neurons.size());
+    const std::vector<int> layer = layers(t, [](uint64_t) { return true; });
+
+    // an edge between two non-sensory neurons is a constraint "lower old index first"
+    std::vector<std::vector<uint32_t>> after(n);
+    std::vector<int> waiting(n, 0);
+    for (uint32_t i = t.num_sensory; i < n; ++i)
+    {
+        for (uint64_t k = t.row_offsets[i]; k < t.row_offsets[i + 1]; ++k)
+        {
+            const uint32_t j = t.targets[k];
+            if (j == i || j < t.num_sensory) continue;
+            const uint32_t a = std::min(i, j), b = std::max(i, j);
+            after[a].push_back(b);
+            waiting[b]++;
+        }
+    }
+    typedef std::pair<std::pair<int, char>, uint32_t> Key; // (layer, prefix), old index
+    auto key = [&](uint32_t i) {
+        return Key(std::make_pair(layer[i] < 0 ? std::numeric_limits<int>::max() : layer[i], prefixOf(t, i)), i);
+    };
+    std::priority_queue<Key, std::vector<Key>, std::greater<Key>> ready;
+    for (uint32_t i = t.num_sensory; i < n; ++i)
+        if (waiting[i] == 0) ready.push(key(i));
+
+    std::vector<uint32_t> order;
+    order.reserve(n);
+    for (uint32_t i = 0; i < t.num_sensory && i < n; ++i) order.push_back(i);
+    while (!ready.empty())
+    {
+        const uint32_t i = ready.top().second;
+        ready.pop();
+        order.push_back(i);
+        for (uint32_t j : after[i])
+            if (--waiting[j] == 0) ready.push(key(j));
+    }
+    return order;
+}
+
+Tables freeze(const Tables &t, const FreezeOptions &options, FreezeStats *stats)
+{
+    const uint32_t n = static_cast<uint32_t>(t.neurons.size());
+    std::function<bool(uint64_t)> kept_edge = [&](uint64_t k) { return t.weights[k] != 0.0f && !(std::fabs(t.weights[k]) < options.min_weight); };
+
+    // reverse edges of the pruned graph
+    std::vector<uint64_t> in_offsets(n + 1, 0);
+    std::vector<uint32_t> in_sources;
+    uint64_t pruned_count = 0;
+    for (uint32_t i = 0; i < n; ++i)
+        for (uint64_t k = t.row_offsets[i]; k < t.row_offsets[i + 1]; ++k)
+        {
+            if (!kept_edge(k)) { pruned_count++; continue; }
+            in_offsets[t.targets[k] + 1]++;
+        }
+    for (uint32_t i = 0; i < n; ++i) in_offsets[i + 1] += in_offsets[i];
+    in_sources.resize(in_offsets[n]);
+    {
+        std::vector<uint64_t> fill(in_offsets.begin(), in_offsets.end() - 1);
+        for (uint32_t i = 0; i < n; ++i)
+            for (uint64_t k = t.row_offsets[i]; k < t.row_offsets[i + 1]; ++k)
+                if (kept_edge(k)) in_sources[fill[t.targets[k]]++] = i;
+    }
+
+    const std::vector<int> layer = layers(t, kept_edge);
+
+    // reaches an output
+    std::vector<char> useful(n, 0);
+    std::vector<uint32_t> queue;
+    for (uint32_t i = 0; i < n; ++i)
+        if (prefixOf(t, i) == 'O') { useful[i] = 1; queue.push_back(i); }
+    for (size_t q = 0; q < queue.size(); ++q)
+        for (uint64_t k = in_offsets[queue[q]]; k < in_offsets[queue[q] + 1]; ++k)
+            if (!useful[in_sources[k]]) { useful[in_sources[k]] = 1; queue.push_back(in_sources[k]); }
+
+    std::vector<uint32_t> kept;
+    for (uint32_t i = 0; i < n; ++i)
+        if (i < t.num_sensory || prefixOf(t, i) == 'O' || (layer[i] >= 0 && useful[i])) kept.push_back(i);
+
+    Tables out = select(t, kept, kept_edge);
+    if (options.reorder) out = select(out, layerOrder(out), [](uint64_t) { return true; });
+
+    if (stats)
+    {
+        stats->neurons_before = n;
+        stats->neurons_after = static_cast<uint32_t>(out.neurons.size());
+        stats->edges_before = t.targets.size();
+        stats->edges_after = out.targets.size();
+        stats->edges_pruned = pruned_count;
+    }
+    return out;
+}
+
+bool View::check(const MappedFile &file, std::string &error)
+{
+    const uint64_t size = file.size();
+    if (size < sizeof(Header))
+    {
+        error = "file too small";
+        return false;
+    }
+    header = reinterpret_cast<const Header *>(file.data());
+    if (std::memcmp(header->magic, magic, 4) != 0)
+    {
+        error = "bad magic";
+        return false;
+    }
+    if (header->version != version)
+    {
+        error = "unsupported version " + std::to_string(header->version);
+        return false;
+    }
+
+    const uint64_t n = header->num_neurons;
+    const uint64_t e = header->num_edges;
+    auto inside = [&](uint64_t offset, uint64_t bytes) {
+        return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+    };
+    if (!inside(header->neurons_offset, n * sizeof(NeuronRecord)) ||
+        !inside(header->strings_offset, header->string_bytes) ||
+        !inside(header->rows_offset, (n + 1) * sizeof(uint64_t)) ||
+        !inside(header->targets_offset, e * sizeof(uint32_t)) ||
+        !inside(header->weights_offset, e * sizeof(float)) ||
+        header->num_sensory > n)
+    {
+        error = "section out of bounds";
+        return false;
+    }
+
+    const unsigned char *base = file.data();
+    neurons = reinterpret_cast<const NeuronRecord *>(base + header->neurons_offset);
+    strings = reinterpret_cast<const char *>(base + header->strings_offset);
+    row_offsets = reinterpret_cast<const uint64_t *>(base + header->rows_offset);
+    targets = reinterpret_cast<const uint32_t *>(base + header->targets_offset);
+    weights = reinterpret_cast<const float *>(base + header->weights_offset);
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        const NeuronRecord &r = neurons[i];
+        if (r.id_length == 0 || static_cast<uint64_t>(r.id_offset) + r.id_length > header->string_bytes)
+        {
+            error = "bad neuron id";
+            return false;
+        }
+        if (row_offsets[i] > row_offsets[i + 1])
+        {
+            error = "bad edge rows";
+            return false;
+        }
+    }
+    if (row_offsets[0] != 0 || row_offsets[n] != e)
+    {
+        error = "bad edge rows";
+        return false;
+    }
+    for (uint64_t k = 0; k < e; ++k)
+    {
+        if (targets[k] >= n)
+        {
+            error = "edge target out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace gnet
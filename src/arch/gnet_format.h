@@ -0,0 +1,153 @@
+#ifndef __gnet_format_h__
+#define __gnet_format_h__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+Binary network format (.gnet), the fast counterpart of the text .net format.
+
+Layout (little-endian, every section 8-byte aligned, offsets from the file start):
+
+    Header        magic "GNET", version, counts and section offsets
+    NeuronRecord  one per neuron in network order (sensory neurons first)
+    strings       neuron IDs, concatenated (no terminators)
+    row_offsets   uint64[num_neurons + 1], CSR rows of outgoing edges
+    targets       uint32[num_edges], target neuron index
+    weights       float[num_edges]
+
+Edges of a row are in connection-map order, as in saveNetworkToFile(). A file is read
+through MappedFile (mmap where available), so loading costs one pass over the arrays
+and no text parsing.
+*/
+namespace gnet
+{
+
+const char magic[4] = {'G', 'N', 'E', 'T'};
+const uint32_t version = 1;
+
+enum NeuronFlags : uint32_t { Sensory = 1u };
+
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t num_neurons;
+    uint32_t num_sensory;
+    uint64_t num_edges;
+    uint64_t string_bytes;
+    uint64_t neurons_offset;
+    uint64_t strings_offset;
+    uint64_t rows_offset;
+    uint64_t targets_offset;
+    uint64_t weights_offset;
+};
+
+struct NeuronRecord
+{
+    float threshold;
+    float leak;
+    float resting;
+    uint32_t flags;
+    uint32_t id_offset; // into the string table
+    uint32_t id_length;
+};
+
+// in-memory form used for writing
+struct Tables
+{
+    std::vector<NeuronRecord> neurons;
+    std::string strings;
+    std::vector<uint64_t> row_offsets;
+    std::vector<uint32_t> targets;
+    std::vector<float> weights;
+    uint32_t num_sensory = 0;
+};
+
+// read-only view of a whole file (mmap on POSIX, a buffer elsewhere)
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    const unsigned char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<unsigned char> buffer;
+};
+
+// true if the file starts with the .gnet magic
+bool isGnetFile(const std::string &path);
+
+bool write(const std::string &path, const Tables &t);
+
+/*
+Freezing a trained network for inference (Glia::saveFrozen()):
+
+- prune: edges with |weight| < min_weight (and exact zeros) are dropped;
+- fold: neurons that can't affect an output are dropped with their edges. A neuron is
+  kept if it is sensory (S*) or an output (O*), or if it reaches an output and is reached
+  from a sensory neuron or a neuron that fires without input (threshold < 0 or
+  resting > threshold); everything else never fires or never matters;
+- reorder: interneurons and outputs are renumbered by their distance from the inputs
+  (then ID prefix, then old position), so a layer's rows and state are contiguous. The
+  order is only changed where it keeps every edge on the same side of the tick order
+  (a target before its source still gets the spike one tick later), so the dynamics are
+  those of the pruned network; only the order in which a neuron's inputs are summed
+  may change.
+
+Sensory neurons keep their order and IDs are kept, so frozen files drop into the same
+input and readout code.
+*/
+struct FreezeOptions
+{
+    float min_weight = 0.0f;
+    bool reorder = true;
+};
+
+struct FreezeStats
+{
+    uint32_t neurons_before = 0, neurons_after = 0;
+    uint64_t edges_before = 0, edges_after = 0;
+    uint64_t edges_pruned = 0; // by magnitude; the rest of the dropped edges went with a neuron
+};
+
+Tables freeze(const Tables &t, const FreezeOptions &options, FreezeStats *stats = nullptr);
+
+// The reorder step on its own (also used by Glia::reorderNeurons()): a permutation of t's
+// neurons, order[new index] = old index, with the sensory neurons first and unchanged
+std::vector<uint32_t> layerOrder(const Tables &t);
+
+/*
+Validated pointers into a mapped file. check() verifies the header, that every
+section lies inside the file, that rows are monotonic and that IDs and targets are in
+range, so the accessors can be used without further checks.
+*/
+struct View
+{
+    const Header *header = nullptr;
+    const NeuronRecord *neurons = nullptr;
+    const char *strings = nullptr;
+    const uint64_t *row_offsets = nullptr;
+    const uint32_t *targets = nullptr;
+    const float *weights = nullptr;
+
+    // on failure `error` says why
+    bool check(const MappedFile &file, std::string &error);
+
+    std::string id(uint32_t i) const { return std::string(strings + neurons[i].id_offset, neurons[i].id_length); }
+};
+
+} // namespace gnet
+
+#endif
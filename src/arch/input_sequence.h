@@ -3,11 +3,15 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cctype>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 
 // =====================================================================================
 // InputSequence - Defines a sequence of sensory inputs over time for testing
@@ -27,27 +31,19 @@ public:
     // Add an input event at a specific tick
     void addEvent(int tick, const std::string& neuron_id, float value) {
         // Find or create event at this tick
-        InputEvent* event = nullptr;
-        for (auto& e : events) {
-            if (e.tick == tick) {
-                event = &e;
-                break;
-            }
-        }
-        if (!event) {
+        auto it = event_index.find(tick);
+        if (it == event_index.end()) {
+            it = event_index.emplace(tick, events.size()).first;
             events.push_back(InputEvent(tick));
-            event = &events.back();
+            if (tick > max_tick) max_tick = tick;
         }
-        event->inputs[neuron_id] = value;
+        events[it->second].inputs[neuron_id] = value;
     }
     
-    // Get inputs for the current tick
+    // Get inputs for the current tick (a copy; hot loops should use CompiledInputSequence)
     std::map<std::string, float> getCurrentInputs() const {
-        for (const auto& event : events) {
-            if (event.tick == current_tick) {
-                return event.inputs;
-            }
-        }
+        auto it = event_index.find(current_tick);
+        if (it != event_index.end()) return events[it->second].inputs;
         return std::map<std::string, float>();  // No inputs this tick
     }
     
@@ -66,20 +62,37 @@ public:
     
     // Getters
     int getCurrentTick() const { return current_tick; }
-    int getMaxTick() const {
-        int max_tick = 0;
-        for (const auto& event : events) {
-            if (event.tick > max_tick) max_tick = event.tick;
-        }
-        return max_tick;
-    }
+    int getMaxTick() const { return max_tick; }
     bool isLooping() const { return loop; }
     void setLoop(bool l) { loop = l; }
     bool isEmpty() const { return events.empty(); }
+    // events in insertion order, one per tick
+    const std::vector<InputEvent> &getEvents() const { return events; }
     
+    // Move every event by dt ticks (timing jitter); events that would land before tick 0
+    // are dropped
+    void shiftTicks(int dt) {
+        if (dt == 0) return;
+        size_t kept = 0;
+        event_index.clear();
+        max_tick = 0;
+        for (size_t i = 0; i < events.size(); ++i) {
+            const int t = events[i].tick + dt;
+            if (t < 0) continue;
+            if (kept != i) events[kept] = std::move(events[i]);
+            events[kept].tick = t;
+            event_index.emplace(t, kept);
+            if (t > max_tick) max_tick = t;
+            ++kept;
+        }
+        events.resize(kept, InputEvent(0));
+    }
+
     // Clear all events
     void clear() {
         events.clear();
+        event_index.clear();
+        max_tick = 0;
         current_tick = 0;
     }
     
@@ -133,8 +146,140 @@ public:
 
 private:
     std::vector<InputEvent> events;
+    std::unordered_map<int, size_t> event_index; // tick -> position in events
+    int max_tick = 0;
     int current_tick;
     bool loop;
 };
 
+// =====================================================================================
+// SequenceCursor - the tick position of InputSequence::reset()/advance(), kept outside it
+// =====================================================================================
+
+// Lets any number of readers replay one const InputSequence (looping included) without
+// copying it; getCurrentTick() of the sequence after the same advance() calls equals tick.
+struct SequenceCursor {
+    int tick = 0;
+    int max_tick = 0;
+    bool loop = false;
+
+    explicit SequenceCursor(const InputSequence &seq) : max_tick(seq.getMaxTick()), loop(seq.isLooping()) {}
+    void advance() {
+        tick++;
+        if (loop && tick > max_tick) tick = 0;
+    }
+};
+
+// =====================================================================================
+// CompiledInputSequence - an InputSequence resolved against a network's sensory neurons
+// =====================================================================================
+
+/*
+Inputs sorted by tick with a per-tick offset table, so the inputs of a tick are a
+contiguous range found in O(1) without building a map. IDs are resolved once at
+compile() to sensory handles (see Glia::getNeuronHandle); inputs to IDs that are not
+sensory neurons are dropped, as injectSensory() ignores them. Within a tick, inputs
+keep the InputSequence (ID) order.
+
+Handles and values are separate arrays, so a tick can go straight to
+Glia::injectSensoryBatch(span.handles, span.values, span.size).
+
+Ticks are InputSequence ticks: callers that loop follow InputSequence::getCurrentTick().
+Recompiling reuses the arrays and keeps the ID index while the sensory IDs are the same,
+so one instance can be compiled per episode without allocating.
+*/
+class CompiledInputSequence {
+public:
+    struct Span {
+        const int *handles = nullptr;
+        const float *values = nullptr;
+        int size = 0;
+    };
+
+    // sensory_ids: the network's sensory neuron IDs in handle (tick) order
+    void compile(const InputSequence &seq, const std::vector<std::string> &sensory_ids) {
+        if (sensory_ids != indexed_ids) {
+            indexed_ids = sensory_ids;
+            index.clear();
+            for (size_t i = 0; i < sensory_ids.size(); ++i) index.emplace(sensory_ids[i], static_cast<int>(i));
+        }
+
+        const auto &events = seq.getEvents();
+        sorted.clear();
+        for (const auto &e : events) if (e.tick >= 0) sorted.push_back(&e);
+        std::sort(sorted.begin(), sorted.end(), [](const InputEvent *a, const InputEvent *b) { return a->tick < b->tick; });
+
+        num_ticks = sorted.empty() ? 0 : sorted.back()->tick + 1;
+        offsets.assign(static_cast<size_t>(num_ticks) + 1, 0);
+        handles.clear();
+        values.clear();
+        size_t next = 0;
+        for (int t = 0; t < num_ticks; ++t) {
+            offsets[t] = static_cast<int>(handles.size());
+            if (next < sorted.size() && sorted[next]->tick == t) {
+                for (const auto &kv : sorted[next]->inputs) {
+                    auto it = index.find(kv.first);
+                    if (it == index.end()) continue;
+                    handles.push_back(it->second);
+                    values.push_back(kv.second);
+                }
+                ++next;
+            }
+        }
+        offsets[num_ticks] = static_cast<int>(handles.size());
+    }
+
+    // from flat, tick-sorted events (e.g. an episode of a packed dataset): event k goes
+    // to channel_handle[channels[k]] at ticks[k], -1 handles are dropped
+    void compileEvents(const uint32_t *ticks, const uint32_t *channels, const float *vals, size_t n,
+                       const std::vector<int> &channel_handle) {
+        num_ticks = n ? static_cast<int>(ticks[n - 1]) + 1 : 0;
+        offsets.assign(static_cast<size_t>(num_ticks) + 1, 0);
+        handles.clear();
+        values.clear();
+        size_t k = 0;
+        for (int t = 0; t < num_ticks; ++t) {
+            offsets[t] = static_cast<int>(handles.size());
+            for (; k < n && static_cast<int>(ticks[k]) == t; ++k) {
+                const int h = channel_handle[channels[k]];
+                if (h < 0) continue;
+                handles.push_back(h);
+                values.push_back(vals[k]);
+            }
+        }
+        offsets[num_ticks] = static_cast<int>(handles.size());
+    }
+
+    // inputs of `tick` (empty outside the sequence)
+    Span at(int tick) const {
+        Span s;
+        if (tick < 0 || tick >= num_ticks) return s;
+        s.handles = handles.data() + offsets[tick];
+        s.values = values.data() + offsets[tick];
+        s.size = offsets[tick + 1] - offsets[tick];
+        return s;
+    }
+
+    int numTicks() const { return num_ticks; }
+    size_t numInputs() const { return handles.size(); }
+
+    // first tick >= `tick` with inputs (INT_MAX if there is none)
+    int nextInput(int tick) const {
+        for (int t = std::max(0, tick); t < num_ticks; ++t)
+            if (offsets[t + 1] > offsets[t]) return t;
+        return INT_MAX;
+    }
+
+private:
+    int num_ticks = 0;
+    std::vector<int> offsets; // inputs of tick t are [offsets[t], offsets[t+1])
+    std::vector<int> handles;
+    std::vector<float> values;
+
+    // compile() scratch
+    std::vector<std::string> indexed_ids; // IDs `index` was built from
+    std::unordered_map<std::string, int> index;
+    std::vector<const InputEvent *> sorted;
+};
+
 #endif // _INPUT_SEQUENCE_H_
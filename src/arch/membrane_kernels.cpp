@@ -0,0 +1,486 @@
+#include "membrane_kernels.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GLIA_MEMBRANE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define GLIA_MEMBRANE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// leak*V and +incoming must round separately to match Neuron::tick(); GCC would
+// otherwise fuse the vector multiply-add wherever the target has FMA (e.g. avx512f)
+#if defined(__GNUC__) && !defined(__clang__)
+#define GLIA_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define GLIA_NO_FP_CONTRACT
+#endif
+
+namespace membrane
+{
+
+namespace
+{
+
+// Model policies: what a spike leaves behind besides the reset to resting
+struct LifPolicy
+{
+    static const bool sets_refractory = false;
+    static const bool adapts = false;
+};
+
+struct RefractoryPolicy
+{
+    static const bool sets_refractory = true; // refractory = refractory_period
+    static const bool adapts = false;
+};
+
+struct AdaptivePolicy
+{
+    static const bool sets_refractory = false;
+    static const bool adapts = true; // threshold + adaptation, which decays and grows per spike
+};
+
+// neuron i of the pass, identical to the first half of Neuron::tick()
+template <class M>
+GLIA_NO_FP_CONTRACT inline bool updateOne(const Arrays &a, int i)
+{
+    a.fired[i] = 0;
+
+    float incoming = a.delta[i];
+    a.delta[i] = a.on_deck[i];
+    a.on_deck[i] = 0.0f;
+
+    float adapt = 0.0f;
+    if (M::adapts)
+    {
+        adapt = a.model.adapt_decay * a.adaptation[i];
+        a.adaptation[i] = adapt;
+    }
+
+    if (a.refractory[i] > 0)
+    {
+        a.refractory[i] -= 1;
+        return false;
+    }
+
+    float v = a.leak[i] * a.value[i] + incoming;
+    if (v < 0) v = 0;
+    bool fire = M::adapts ? v > a.threshold[i] + adapt : v > a.threshold[i];
+    if (fire)
+    {
+        a.fired[i] = 1;
+        v = a.resting[i];
+        if (M::sets_refractory) a.refractory[i] = a.refractory_period[i];
+        if (M::adapts) a.adaptation[i] = adapt + a.model.adapt_step;
+    }
+    a.value[i] = v;
+    return fire;
+}
+
+template <class M>
+GLIA_NO_FP_CONTRACT int updateScalarRange(const Arrays &a, int begin, int end)
+{
+    int count = 0;
+    for (int i = begin; i < end; ++i)
+    {
+        if (updateOne<M>(a, i))
+        {
+            a.fired_mask[i >> 6] |= uint64_t(1) << (i & 63);
+            ++count;
+        }
+    }
+    return count;
+}
+
+inline void addWhereFiredScalar(float *dst, const uint8_t *fired, float w, int begin, int end)
+{
+    for (int b = begin; b < end; ++b)
+        if (fired[b]) dst[b] += w;
+}
+
+inline void addRowScalar(float *dst, const float *row, int begin, int end)
+{
+    for (int j = begin; j < end; ++j)
+        dst[j] += row[j];
+}
+
+#if defined(GLIA_MEMBRANE_X86)
+
+// byte k of spread[b] is bit k of b (x86 is little-endian)
+struct SpreadTable
+{
+    uint64_t bytes[256];
+    SpreadTable()
+    {
+        for (int b = 0; b < 256; ++b)
+        {
+            uint64_t s = 0;
+            for (int k = 0; k < 8; ++k)
+                if (b & (1 << k)) s |= uint64_t(1) << (8 * k);
+            bytes[b] = s;
+        }
+    }
+};
+
+const SpreadTable &spread()
+{
+    static const SpreadTable table;
+    return table;
+}
+
+inline void storeFiredBytes(uint8_t *dst, unsigned bits)
+{
+    std::memcpy(dst, &spread().bytes[bits & 0xffu], 8);
+}
+
+inline int popcount32(unsigned x) { return __builtin_popcount(x); }
+
+template <class M>
+__attribute__((target("avx2"))) GLIA_NO_FP_CONTRACT int updateAVX2(const Arrays &a)
+{
+    const int vec_end = a.n & ~7;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i zero_i = _mm256_setzero_si256();
+    const __m256 decay = _mm256_set1_ps(a.model.adapt_decay);
+    const __m256 step = _mm256_set1_ps(a.model.adapt_step);
+    int count = 0;
+
+    for (int i = 0; i < vec_end; i += 8)
+    {
+        __m256 v = _mm256_loadu_ps(a.value + i);
+        __m256 incoming = _mm256_loadu_ps(a.delta + i);
+        _mm256_storeu_ps(a.delta + i, _mm256_loadu_ps(a.on_deck + i));
+        _mm256_storeu_ps(a.on_deck + i, zero);
+
+        __m256 thr = _mm256_loadu_ps(a.threshold + i);
+        __m256 adapt = zero;
+        if (M::adapts)
+        {
+            adapt = _mm256_mul_ps(decay, _mm256_loadu_ps(a.adaptation + i));
+            thr = _mm256_add_ps(thr, adapt);
+        }
+
+        // refractory lanes count down and keep their value
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.refractory + i));
+        __m256i refr_i = _mm256_cmpgt_epi32(r, zero_i);
+        r = _mm256_add_epi32(r, refr_i);
+        __m256 refr = _mm256_castsi256_ps(refr_i);
+
+        __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a.leak + i), v), incoming);
+        x = _mm256_andnot_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), x);
+        __m256 fire = _mm256_andnot_ps(refr, _mm256_cmp_ps(x, thr, _CMP_GT_OQ));
+        x = _mm256_blendv_ps(x, _mm256_loadu_ps(a.resting + i), fire);
+        x = _mm256_blendv_ps(x, v, refr);
+        _mm256_storeu_ps(a.value + i, x);
+
+        if (M::sets_refractory)
+            r = _mm256_blendv_epi8(r, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a.refractory_period + i)), _mm256_castps_si256(fire));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(a.refractory + i), r);
+        if (M::adapts) _mm256_storeu_ps(a.adaptation + i, _mm256_blendv_ps(adapt, _mm256_add_ps(adapt, step), fire));
+
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_ps(fire));
+        storeFiredBytes(a.fired + i, bits);
+        a.fired_mask[i >> 6] |= uint64_t(bits) << (i & 63);
+        count += popcount32(bits);
+    }
+    return count + updateScalarRange<M>(a, vec_end, a.n);
+}
+
+template <class M>
+__attribute__((target("avx512f"))) GLIA_NO_FP_CONTRACT int updateAVX512(const Arrays &a)
+{
+    const int vec_end = a.n & ~15;
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512i zero_i = _mm512_setzero_si512();
+    const __m512i one_i = _mm512_set1_epi32(1);
+    const __m512 decay = _mm512_set1_ps(a.model.adapt_decay);
+    const __m512 step = _mm512_set1_ps(a.model.adapt_step);
+    int count = 0;
+
+    for (int i = 0; i < vec_end; i += 16)
+    {
+        __m512 v = _mm512_loadu_ps(a.value + i);
+        __m512 incoming = _mm512_loadu_ps(a.delta + i);
+        _mm512_storeu_ps(a.delta + i, _mm512_loadu_ps(a.on_deck + i));
+        _mm512_storeu_ps(a.on_deck + i, zero);
+
+        __m512 thr = _mm512_loadu_ps(a.threshold + i);
+        __m512 adapt = zero;
+        if (M::adapts)
+        {
+            adapt = _mm512_mul_ps(decay, _mm512_loadu_ps(a.adaptation + i));
+            thr = _mm512_add_ps(thr, adapt);
+        }
+
+        __m512i r = _mm512_loadu_si512(a.refractory + i);
+        __mmask16 refr = _mm512_cmpgt_epi32_mask(r, zero_i);
+        r = _mm512_mask_sub_epi32(r, refr, r, one_i);
+
+        __m512 x = _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(a.leak + i), v), incoming);
+        x = _mm512_mask_mov_ps(x, _mm512_cmp_ps_mask(x, zero, _CMP_LT_OQ), zero);
+        __mmask16 fire = _mm512_mask_cmp_ps_mask(static_cast<__mmask16>(~refr), x, thr, _CMP_GT_OQ);
+        x = _mm512_mask_mov_ps(x, fire, _mm512_loadu_ps(a.resting + i));
+        x = _mm512_mask_mov_ps(x, refr, v);
+        _mm512_storeu_ps(a.value + i, x);
+
+        if (M::sets_refractory) r = _mm512_mask_mov_epi32(r, fire, _mm512_loadu_si512(a.refractory_period + i));
+        _mm512_storeu_si512(a.refractory + i, r);
+        if (M::adapts) _mm512_storeu_ps(a.adaptation + i, _mm512_mask_add_ps(adapt, fire, adapt, step));
+
+        unsigned bits = static_cast<unsigned>(fire);
+        storeFiredBytes(a.fired + i, bits);
+        storeFiredBytes(a.fired + i + 8, bits >> 8);
+        a.fired_mask[i >> 6] |= uint64_t(bits) << (i & 63);
+        count += popcount32(bits);
+    }
+    return count + updateScalarRange<M>(a, vec_end, a.n);
+}
+
+__attribute__((target("avx2"))) void addWhereFiredAVX2(float *dst, const uint8_t *fired, float w, int n)
+{
+    const int vec_end = n & ~7;
+    const __m256 wv = _mm256_set1_ps(w);
+    const __m256i zero_i = _mm256_setzero_si256();
+    for (int b = 0; b < vec_end; b += 8)
+    {
+        __m256i f = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(fired + b)));
+        __m256 on = _mm256_castsi256_ps(_mm256_cmpgt_epi32(f, zero_i));
+        _mm256_storeu_ps(dst + b, _mm256_add_ps(_mm256_loadu_ps(dst + b), _mm256_and_ps(on, wv)));
+    }
+    addWhereFiredScalar(dst, fired, w, vec_end, n);
+}
+
+__attribute__((target("avx512f"))) void addWhereFiredAVX512(float *dst, const uint8_t *fired, float w, int n)
+{
+    const int vec_end = n & ~15;
+    const __m512 wv = _mm512_set1_ps(w);
+    const __m128i zero_b = _mm_setzero_si128();
+    for (int b = 0; b < vec_end; b += 16)
+    {
+        __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fired + b));
+        __mmask16 on = static_cast<__mmask16>(~_mm_movemask_epi8(_mm_cmpeq_epi8(f, zero_b)));
+        _mm512_storeu_ps(dst + b, _mm512_mask_add_ps(_mm512_loadu_ps(dst + b), on, _mm512_loadu_ps(dst + b), wv));
+    }
+    addWhereFiredScalar(dst, fired, w, vec_end, n);
+}
+
+__attribute__((target("avx2"))) void addRowAVX2(float *dst, const float *row, int n)
+{
+    const int vec_end = n & ~7;
+    for (int j = 0; j < vec_end; j += 8)
+        _mm256_storeu_ps(dst + j, _mm256_add_ps(_mm256_loadu_ps(dst + j), _mm256_loadu_ps(row + j)));
+    addRowScalar(dst, row, vec_end, n);
+}
+
+__attribute__((target("avx512f"))) void addRowAVX512(float *dst, const float *row, int n)
+{
+    const int vec_end = n & ~15;
+    for (int j = 0; j < vec_end; j += 16)
+        _mm512_storeu_ps(dst + j, _mm512_add_ps(_mm512_loadu_ps(dst + j), _mm512_loadu_ps(row + j)));
+    addRowScalar(dst, row, vec_end, n);
+}
+
+#endif // GLIA_MEMBRANE_X86
+
+#if defined(GLIA_MEMBRANE_NEON)
+
+template <class M>
+GLIA_NO_FP_CONTRACT int updateNEON(const Arrays &a)
+{
+    const int vec_end = a.n & ~3;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const int32x4_t zero_i = vdupq_n_s32(0);
+    const float32x4_t decay = vdupq_n_f32(a.model.adapt_decay);
+    const float32x4_t step = vdupq_n_f32(a.model.adapt_step);
+    const uint32_t lane_bits_init[4] = {1u, 2u, 4u, 8u};
+    const uint32x4_t lane_bits = vld1q_u32(lane_bits_init);
+    int count = 0;
+
+    for (int i = 0; i < vec_end; i += 4)
+    {
+        float32x4_t v = vld1q_f32(a.value + i);
+        float32x4_t incoming = vld1q_f32(a.delta + i);
+        vst1q_f32(a.delta + i, vld1q_f32(a.on_deck + i));
+        vst1q_f32(a.on_deck + i, zero);
+
+        float32x4_t thr = vld1q_f32(a.threshold + i);
+        float32x4_t adapt = zero;
+        if (M::adapts)
+        {
+            adapt = vmulq_f32(decay, vld1q_f32(a.adaptation + i));
+            thr = vaddq_f32(thr, adapt);
+        }
+
+        int32x4_t r = vld1q_s32(a.refractory + i);
+        uint32x4_t refr = vcgtq_s32(r, zero_i);
+        r = vaddq_s32(r, vreinterpretq_s32_u32(refr));
+
+        float32x4_t x = vaddq_f32(vmulq_f32(vld1q_f32(a.leak + i), v), incoming);
+        x = vbslq_f32(vcltq_f32(x, zero), zero, x);
+        uint32x4_t fire = vbicq_u32(vcgtq_f32(x, thr), refr);
+        x = vbslq_f32(fire, vld1q_f32(a.resting + i), x);
+        x = vbslq_f32(refr, v, x);
+        vst1q_f32(a.value + i, x);
+
+        if (M::sets_refractory) r = vbslq_s32(fire, vld1q_s32(a.refractory_period + i), r);
+        vst1q_s32(a.refractory + i, r);
+        if (M::adapts) vst1q_f32(a.adaptation + i, vbslq_f32(fire, vaddq_f32(adapt, step), adapt));
+
+        unsigned bits = vaddvq_u32(vandq_u32(fire, lane_bits));
+        for (int k = 0; k < 4; ++k) a.fired[i + k] = static_cast<uint8_t>((bits >> k) & 1u);
+        a.fired_mask[i >> 6] |= uint64_t(bits) << (i & 63);
+        count += __builtin_popcount(bits);
+    }
+    return count + updateScalarRange<M>(a, vec_end, a.n);
+}
+
+void addWhereFiredNEON(float *dst, const uint8_t *fired, float w, int n)
+{
+    const int vec_end = n & ~3;
+    const float32x4_t wv = vdupq_n_f32(w);
+    for (int b = 0; b < vec_end; b += 4)
+    {
+        const uint32_t lanes_init[4] = {fired[b], fired[b + 1], fired[b + 2], fired[b + 3]};
+        uint32x4_t on = vtstq_u32(vld1q_u32(lanes_init), vdupq_n_u32(0xffu));
+        float32x4_t add = vreinterpretq_f32_u32(vandq_u32(on, vreinterpretq_u32_f32(wv)));
+        vst1q_f32(dst + b, vaddq_f32(vld1q_f32(dst + b), add));
+    }
+    addWhereFiredScalar(dst, fired, w, vec_end, n);
+}
+
+void addRowNEON(float *dst, const float *row, int n)
+{
+    const int vec_end = n & ~3;
+    for (int j = 0; j < vec_end; j += 4)
+        vst1q_f32(dst + j, vaddq_f32(vld1q_f32(dst + j), vld1q_f32(row + j)));
+    addRowScalar(dst, row, vec_end, n);
+}
+
+#endif // GLIA_MEMBRANE_NEON
+
+SimdLevel probe()
+{
+#if defined(GLIA_MEMBRANE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+#endif
+#if defined(GLIA_MEMBRANE_NEON)
+    return SimdLevel::NEON;
+#endif
+    return SimdLevel::Scalar;
+}
+
+} // namespace
+
+SimdLevel detect()
+{
+    static const SimdLevel level = probe();
+    return level;
+}
+
+SimdLevel clamp(SimdLevel level)
+{
+    SimdLevel best = detect();
+    switch (level)
+    {
+    case SimdLevel::AVX512:
+        return best == SimdLevel::AVX512 ? level : clamp(SimdLevel::AVX2);
+    case SimdLevel::AVX2:
+        return (best == SimdLevel::AVX512 || best == SimdLevel::AVX2) ? level : SimdLevel::Scalar;
+    case SimdLevel::NEON:
+        return best == SimdLevel::NEON ? level : SimdLevel::Scalar;
+    default:
+        return SimdLevel::Scalar;
+    }
+}
+
+const char *name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    case SimdLevel::NEON: return "neon";
+    default: return "scalar";
+    }
+}
+
+const char *name(NeuronModel model)
+{
+    switch (model)
+    {
+    case NeuronModel::LifRefractory: return "lif_refractory";
+    case NeuronModel::AdaptiveThreshold: return "adaptive_threshold";
+    default: return "lif";
+    }
+}
+
+namespace
+{
+
+template <class M>
+int updateModel(const Arrays &a, SimdLevel level)
+{
+    switch (level)
+    {
+#if defined(GLIA_MEMBRANE_X86)
+    case SimdLevel::AVX512: return updateAVX512<M>(a);
+    case SimdLevel::AVX2: return updateAVX2<M>(a);
+#endif
+#if defined(GLIA_MEMBRANE_NEON)
+    case SimdLevel::NEON: return updateNEON<M>(a);
+#endif
+    default: return updateScalarRange<M>(a, 0, a.n);
+    }
+}
+
+} // namespace
+
+int update(const Arrays &a, SimdLevel level)
+{
+    std::memset(a.fired_mask, 0, sizeof(uint64_t) * maskWords(a.n));
+    switch (a.model.kind)
+    {
+    case NeuronModel::LifRefractory: return updateModel<RefractoryPolicy>(a, level);
+    case NeuronModel::AdaptiveThreshold: return updateModel<AdaptivePolicy>(a, level);
+    default: return updateModel<LifPolicy>(a, level);
+    }
+}
+
+void addWhereFired(float *dst, const uint8_t *fired, float w, int n, SimdLevel level)
+{
+    switch (level)
+    {
+#if defined(GLIA_MEMBRANE_X86)
+    case SimdLevel::AVX512: addWhereFiredAVX512(dst, fired, w, n); return;
+    case SimdLevel::AVX2: addWhereFiredAVX2(dst, fired, w, n); return;
+#endif
+#if defined(GLIA_MEMBRANE_NEON)
+    case SimdLevel::NEON: addWhereFiredNEON(dst, fired, w, n); return;
+#endif
+    default: addWhereFiredScalar(dst, fired, w, 0, n); return;
+    }
+}
+
+void addRow(float *dst, const float *row, int n, SimdLevel level)
+{
+    switch (level)
+    {
+#if defined(GLIA_MEMBRANE_X86)
+    case SimdLevel::AVX512: addRowAVX512(dst, row, n); return;
+    case SimdLevel::AVX2: addRowAVX2(dst, row, n); return;
+#endif
+#if defined(GLIA_MEMBRANE_NEON)
+    case SimdLevel::NEON: addRowNEON(dst, row, n); return;
+#endif
+    default: addRowScalar(dst, row, 0, n); return;
+    }
+}
+
+} // namespace membrane
@@ -0,0 +1,83 @@
+#ifndef __membrane_kernels_h__
+#define __membrane_kernels_h__
+
+#include <cstdint>
+
+/*
+Membrane update pass of the compiled core, on struct-of-arrays neuron state.
+
+For every neuron i this does exactly what one Neuron::tick() does before delivering
+spikes: clear the fired flag, shift staged input (incoming = delta, delta = on_deck,
+on_deck = 0), then either count down the refractory period or apply
+V = max(0, leak*V + incoming) and reset to resting when V > threshold.
+
+The neuron model (ModelParams) decides what a spike leaves behind. Lif, the default, is
+the update above. LifRefractory also starts the neuron's refractory period when it
+fires. AdaptiveThreshold keeps a per-neuron threshold offset a: every tick
+a = adapt_decay*a, the neuron fires when V > threshold + a, and a spike adds adapt_step.
+Each model is a compile-time policy in membrane_kernels.cpp and every variant below is
+instantiated per model, so the loops never branch on it; a new model is a policy and a
+case in update().
+
+Fired neurons are reported twice: as bytes in `fired` and as a bitmask (bit i%64 of
+word i/64) so the delivery pass can walk spikes in ascending order without scanning
+every neuron. Vector variants are chosen at runtime from the CPU features and give
+bit-identical results to the scalar loop (multiply and add are kept separate, as in
+Neuron::tick()).
+*/
+namespace membrane
+{
+
+enum class SimdLevel { Scalar, AVX2, AVX512, NEON };
+
+enum class NeuronModel { Lif, LifRefractory, AdaptiveThreshold };
+
+struct ModelParams
+{
+    NeuronModel kind = NeuronModel::Lif;
+    float adapt_decay = 0.9f; // AdaptiveThreshold only
+    float adapt_step = 10.0f;
+};
+
+struct Arrays
+{
+    int n = 0;
+    float *value = nullptr;
+    float *delta = nullptr;
+    float *on_deck = nullptr;
+    int *refractory = nullptr;
+    uint8_t *fired = nullptr;
+    uint64_t *fired_mask = nullptr; // (n + 63) / 64 words, overwritten
+    const float *threshold = nullptr;
+    const float *leak = nullptr;
+    const float *resting = nullptr;
+    ModelParams model;
+    const int *refractory_period = nullptr; // LifRefractory
+    float *adaptation = nullptr;            // AdaptiveThreshold
+};
+
+// widest variant this CPU (and this build) supports
+SimdLevel detect();
+
+// `level` clamped to what is supported, so callers can force a narrower path
+SimdLevel clamp(SimdLevel level);
+
+const char *name(SimdLevel level);
+const char *name(NeuronModel model);
+
+// run the update pass; returns the number of neurons that fired
+int update(const Arrays &a, SimdLevel level);
+
+inline int maskWords(int n) { return (n + 63) / 64; }
+
+// dst[b] += w for every b < n with fired[b] != 0: delivery of one edge to a row of
+// lanes (see BatchedNetwork). Silent lanes get +0, which leaves staged inputs unchanged.
+void addWhereFired(float *dst, const uint8_t *fired, float w, int n, SimdLevel level);
+
+// dst[j] += row[j] for j < n: delivery of one source's row of a dense projection (see
+// CompiledTopology). Missing edges are +0 in the row and leave staged inputs unchanged.
+void addRow(float *dst, const float *row, int n, SimdLevel level);
+
+} // namespace membrane
+
+#endif
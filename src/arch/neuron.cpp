@@ -1,6 +1,8 @@
 #include <string>
 #include "neuron.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
 
@@ -24,7 +26,7 @@ Neuron::Neuron(const std::string id,
                const float threshold = 0,
                const bool tick = true)
 {
-    this->id = id;
+    this->key = nid::intern(id);
     this->value = resting;
     this->resting = resting;
     this->balancer = balancer;
@@ -44,21 +46,66 @@ Neuron::~Neuron()
 {
 }
 
+/*
+Creates an unbound copy of this cell with the same parameters and dynamic state (read
+through the compiled arrays if bound) but no connections
+*/
+Neuron Neuron::cloneUnconnected() const
+{
+    Neuron copy(*this);
+    copy.connections.clear();
+    copy.delays.clear();
+    copy.compiled = nullptr;
+    copy.slot = -1;
+    if (this->compiled)
+    {
+        copy.value = this->compiled->valueAt(this->slot);
+        copy.delta = this->compiled->delta[this->slot];
+        copy.on_deck = this->compiled->on_deck[this->slot];
+        copy.refractory = this->compiled->refractory[this->slot];
+        copy.just_fired = this->compiled->fired[this->slot] != 0;
+        copy.adaptation = this->compiled->adaptation[this->slot];
+        this->compiled->pendingInput(this->slot, copy.later);
+        copy.later_head = 0;
+    }
+    return copy;
+}
+
 /*
 Updates the weight of the transmission for a given cell connection
 
 PARAMS:
-    id: ID string of the receiving cell of the connection to modify
+    id / to: ID string or key of the receiving cell of the connection to modify
     new_transmitter: new value to send when this cell fires
 */
-void Neuron::setTransmitter(std::string id, float new_transmitter)
+void Neuron::setTransmitter(const std::string &id, float new_transmitter)
+{
+    nid::Key to;
+    if (nid::find(id, to)) setTransmitter(to, new_transmitter);
+}
+
+void Neuron::setTransmitter(nid::Key to, float new_transmitter)
 {
-    auto it = this->connections.find(id);
+    auto it = this->connections.find(to);
     if (it != this->connections.end()) {
         it->second.first = new_transmitter;
+        if (this->compiled) this->compiled->markWeightsDirty();
     }
 }
 
+/*
+Updates the weights of all connections at once, in connection (receiving ID) order
+
+PARAMS:
+    transmitters: one new value per connection, as many as getConnections().size()
+*/
+void Neuron::setTransmitters(const float *transmitters)
+{
+    if (this->connections.empty()) return;
+    for (auto &kv : this->connections) kv.second.first = *transmitters++;
+    if (this->compiled) this->compiled->markWeightsDirty();
+}
+
 /*
 Updates the voltage at which to fire the cell
 
@@ -68,6 +115,7 @@ PARAMS:
 void Neuron::setThreshold(float new_threshold)
 {
     this->threshold = new_threshold;
+    if (this->compiled) this->compiled->setThresholdAt(this->slot, new_threshold);
 }
 
 /*
@@ -79,6 +127,7 @@ PARAMS:
 void Neuron::setLeak(float new_leak)
 {
     this->balancer = new_leak;
+    if (this->compiled) this->compiled->setLeakAt(this->slot, new_leak);
 }
 
 /*
@@ -92,6 +141,23 @@ void Neuron::setResting(float new_resting)
     this->resting = new_resting;
     // Also reset current voltage to new resting to avoid transients
     this->value = new_resting;
+    if (this->compiled)
+    {
+        this->compiled->resting[this->slot] = new_resting;
+        this->compiled->setValue(this->slot, new_resting);
+    }
+}
+
+/*
+Updates the refractory period started by each firing (NeuronModel::LifRefractory)
+
+PARAMS:
+    new_period: ticks the cell stays inactive after firing
+*/
+void Neuron::setRefractoryPeriod(int new_period)
+{
+    this->refractory_period = new_period;
+    if (this->compiled) this->compiled->refractory_period[this->slot] = new_period;
 }
 
 /*
@@ -99,11 +165,63 @@ Adds a connection from the axon of this cell to the dendrite of another
 
 PARAMS:
     transmitter: value to send when this cell fires
-    neuron: shared_ptr to the receiving cell
+    neuron: the receiving cell (not owned: cells of a network share its NeuronArena)
+    delay: ticks until the receiving cell sees the transmission (at least 1)
 */
-void Neuron::addConnection(float transmitter, std::shared_ptr<Neuron> neuron)
+void Neuron::addConnection(float transmitter, Neuron *neuron, int delay)
 {
-    this->connections[neuron->id] = std::make_pair(transmitter, neuron);
+    this->connections[neuron->key] = std::make_pair(transmitter, neuron);
+    if (delay > 1) this->delays[neuron->key] = delay;
+    else this->delays.erase(neuron->key);
+    this->structure_stamp = nextStructureStamp();
+    if (this->compiled) this->compiled->markTopologyDirty();
+}
+
+/*
+Removes the connection to a given cell, if present
+
+PARAMS:
+    to: ID string or key of the receiving cell
+*/
+void Neuron::removeConnection(const std::string &to)
+{
+    nid::Key k;
+    if (nid::find(to, k)) removeConnection(k);
+}
+
+void Neuron::removeConnection(nid::Key to)
+{
+    this->delays.erase(to);
+    if (this->connections.erase(to) == 0) return;
+    this->structure_stamp = nextStructureStamp();
+    if (this->compiled) this->compiled->markTopologyDirty();
+}
+
+/*
+Next value of the process-wide counter behind getStructureStamp()
+*/
+uint64_t Neuron::nextStructureStamp()
+{
+    static std::atomic<uint64_t> counter(0);
+    return ++counter;
+}
+
+/*
+Synaptic delay of the connection to a given cell (1 if there is none)
+
+PARAMS:
+    to: ID string or key of the receiving cell
+*/
+int Neuron::getDelay(const std::string &to) const
+{
+    nid::Key k;
+    return nid::find(to, k) ? getDelay(k) : 1;
+}
+
+int Neuron::getDelay(nid::Key to) const
+{
+    auto it = this->delays.find(to);
+    return it == this->delays.end() ? 1 : it->second;
 }
 
 /*
@@ -111,16 +229,36 @@ Receive a voltage pulse from another cell
 
 PARAMS:
     transmission: voltage being sent
+    delay: synaptic delay in ticks; 1 stages it for the next tick (ignored without tick)
 */
-void Neuron::receive(float transmission)
+void Neuron::receive(float transmission, int delay)
 {
     // std::cout << "received " << transmission << std::endl;
+    if (this->compiled)
+    {
+        // bound neurons are always tick-based; stage into the compiled arrays
+        this->compiled->stage(this->slot, transmission, delay);
+        return;
+    }
     if (this->using_tick)
     {
         // When using tick-based updates, stage the input for next tick
-        // DO NOT apply immediately - this maintains 1-tick synaptic delay
-        this->on_deck += transmission;
-        return;  // Exit early - tick() will handle the voltage update
+        // DO NOT apply immediately - this maintains the synaptic delay
+        if (delay <= 1)
+        {
+            this->on_deck += transmission;
+            return;  // Exit early - tick() will handle the voltage update
+        }
+        // longer delays wait in the ring and move into on_deck delay - 1 ticks from now
+        const size_t depth = static_cast<size_t>(delay - 1);
+        if (this->later.size() < depth)
+        {
+            std::rotate(this->later.begin(), this->later.begin() + this->later_head, this->later.end());
+            this->later.resize(depth, 0.0f);
+            this->later_head = 0;
+        }
+        this->later[(this->later_head + depth - 1) % this->later.size()] += transmission;
+        return;
     }
 
     // Non-tick mode: apply voltage immediately
@@ -147,10 +285,32 @@ void Neuron::receive(float transmission)
     }
 }
 
+/*
+Return to rest: resting value, nothing staged, no refractory count, adaptation or spike.
+Only this object's fields; the state of a bound neuron is reset in its CompiledNetwork.
+*/
+void Neuron::resetState()
+{
+    this->value = this->resting;
+    this->delta = 0;
+    this->on_deck = 0;
+    this->refractory = 0;
+    this->adaptation = 0;
+    std::fill(this->later.begin(), this->later.end(), 0.0f);
+    this->later_head = 0;
+    this->just_fired = false;
+}
+
 /*
 Tick update, make any actions based on state of the cell
+
+This is the reference (per-object) update used when the parent network is not
+compiled; compiled networks advance all neurons at once in CompiledNetwork::step().
+
+PARAMS:
+    model: neuron model of the network (see membrane_kernels.h)
 */
-void Neuron::tick()
+void Neuron::tick(const membrane::ModelParams &model)
 {
     // track fire status for training
     this->just_fired = false;
@@ -159,6 +319,15 @@ void Neuron::tick()
     float incoming = this->delta;
     this->delta = this->on_deck;
     this->on_deck = 0;
+    if (!this->later.empty())
+    {
+        this->on_deck = this->later[this->later_head];
+        this->later[this->later_head] = 0;
+        this->later_head = (this->later_head + 1) % static_cast<int>(this->later.size());
+    }
+
+    const bool adaptive = model.kind == membrane::NeuronModel::AdaptiveThreshold;
+    if (adaptive) this->adaptation = model.adapt_decay * this->adaptation;
 
     // if on refractory, decrement period
     if (this->refractory > 0)
@@ -174,9 +343,11 @@ void Neuron::tick()
     if (this->value < 0) this->value = 0;  // max(0, ...)
 
     // if voltage threshold met, fire
-    if (this->value > this->threshold)
+    if (adaptive ? this->value > this->threshold + this->adaptation : this->value > this->threshold)
     {
         this->fire();
+        if (model.kind == membrane::NeuronModel::LifRefractory) this->refractory = this->refractory_period;
+        if (adaptive) this->adaptation += model.adapt_step;
     }
     // else, move towards resting voltage
     // else if (this->value > this->resting)
@@ -222,9 +393,9 @@ void Neuron::fire()
     // send transmissions
     for (auto itr = connections.begin(); itr != connections.end(); ++itr)
     {
-        auto dst = itr->second.second;  // shared_ptr<Neuron>
+        Neuron *dst = itr->second.second;
         if (!dst) continue;
-        dst->receive(itr->second.first);
+        dst->receive(itr->second.first, delays.empty() ? 1 : getDelay(itr->first));
     }
     // this->refractory = this->refractory_period;
 }
\ No newline at end of file
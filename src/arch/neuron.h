@@ -1,39 +1,72 @@
 #ifndef __neuron_h__
 #define __neuron_h__
 
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <string>
 #include <memory>
+#include <utility>
+#include <vector>
+
+#include "compiled_network.h"
+#include "neuron_ids.h"
 /*
 Class representing a single neuron cell, each connecting to various other cells that it forwards its message to
 */
 class Neuron
 {
 public:
+    // receiving cells by key, in ID order (the edge order of every compiled or indexed form);
+    // the pointers don't own their cells, which live in the network's NeuronArena
+    typedef std::map<nid::Key, std::pair<float, Neuron *>, nid::ByName> ConnectionMap;
+
     // constructors and destructor
     Neuron(const std::string id, const int complexity, const float resting, const float balancer, const int refractory, const float threshold, const bool tick);
     ~Neuron();
 
+    // copy of this cell's parameters and dynamic state, unbound and without connections
+    // (used by Glia's copy constructor, which rewires the copies)
+    Neuron cloneUnconnected() const;
+
     // getters/setters
-    float getValue() const { return value; };
-    void setTransmitter(std::string id, float new_transmitter);
+    float getValue() const { return compiled ? compiled->valueAt(slot) : value; };
+    void setTransmitter(const std::string &id, float new_transmitter);
+    void setTransmitter(nid::Key to, float new_transmitter);
+    void setTransmitters(const float *transmitters); // one per connection, in getConnections() order
     float getThreshold() const { return threshold; };
     void setThreshold(float new_threshold);
     float getLeak() const { return balancer; };
     void setLeak(float new_leak);
     float getResting() const { return resting; };
     void setResting(float new_resting);
+    int getRefractoryPeriod() const { return refractory_period; };
+    void setRefractoryPeriod(int new_period); // used by NeuronModel::LifRefractory
 
     // modifiers
-    void addConnection(float transmitter, std::shared_ptr<Neuron> neuron);
-    void receive(float transmission);
-    void tick();
+    // delay: ticks until the target sees the spike (1 = the next tick, the default)
+    void addConnection(float transmitter, Neuron *neuron, int delay = 1);
+    void receive(float transmission, int delay = 1);
+    void tick(const membrane::ModelParams &model = membrane::ModelParams());
+    // back to rest, as CompiledNetwork::resetState(); a bound neuron's live state is in
+    // the compiled arrays, so Glia::resetState() resets those
+    void resetState();
 
     // training
-    const std::string &getId() const { return id; }
-    const std::map<std::string, std::pair<float, std::shared_ptr<Neuron>>> &getConnections() const { return connections; }
-    void removeConnection(const std::string &to) { connections.erase(to); }
-    bool didFire() const { return just_fired; }
+    const std::string &getId() const { return nid::name(key); }
+    nid::Key getKey() const { return key; }
+    const ConnectionMap &getConnections() const { return connections; }
+    void removeConnection(const std::string &to);
+    void removeConnection(nid::Key to);
+    int getDelay(const std::string &to) const;
+    int getDelay(nid::Key to) const;
+    bool hasDelays() const { return !delays.empty(); }
+    // stamp of the last connection added or removed here (0 if none); stamps come from one
+    // process-wide counter, so a later edit anywhere gets a larger one (see Glia::getStructureVersion)
+    uint64_t getStructureStamp() const { return structure_stamp; }
+    static uint64_t nextStructureStamp();
+    bool didFire() const { return compiled ? compiled->fired[slot] != 0 : just_fired; }
+    bool usesTick() const { return using_tick; }
 
 private:
     // member variables
@@ -47,19 +80,52 @@ private:
                                                                    // changes are then shifted into delta, then are applied
                                                                    */
     int refractory;                                                // current refractory state of the cell
-    int refractory_period;                                         // refractory period after each firing
+    int refractory_period;                                         // refractory period after each firing (LifRefractory model)
+    float adaptation = 0;                                          // threshold offset of the AdaptiveThreshold model
     float threshold;                                               // voltage threshold at which the cell fires
     int complexity;                                                // represents the complexity of the circuit - how many neurons there are
     bool using_tick;                                               // states whether tick is being used
-    std::string id;                                                // unique ID of the cell
-    std::map<std::string, std::pair<float, std::shared_ptr<Neuron>>> connections; // map of all cells whose dendrites receive from this cells axon
-    // key is ID of the receiving cell, value is a pair containing the transmission and a shared_ptr to the receiving cell
+    nid::Key key;                                                  // interned unique ID of the cell
+    ConnectionMap connections;                                     // map of all cells whose dendrites receive from this cells axon
+    // key is the receiving cell's, value is a pair containing the transmission and a pointer to the receiving cell
+    std::map<nid::Key, int> delays;                                // synaptic delay of the connections whose delay is > 1
+    std::vector<float> later;                                      // ring of input staged beyond on_deck: later[(later_head + k) % size]
+    int later_head = 0;                                            // moves into on_deck k + 1 ticks from now
+    uint64_t structure_stamp = 0;                                  // see getStructureStamp()
 
     // training
     bool just_fired = false; // states whether neuron fired this step
 
+    // compiled form this neuron is bound to (owned by the parent Glia); while bound,
+    // dynamic state lives in compiled arrays at index `slot`
+    friend class CompiledNetwork;
+    CompiledNetwork *compiled = nullptr;
+    int slot = -1;
+
     // member functions
     void fire();
 };
 
+/*
+Storage of a network's neurons. Cells never move once created and live as long as the
+arena, so edges between them are plain pointers and recurrent loops are no reference
+cycles: the arena frees every cell at once. Glia holds its arena through a shared_ptr,
+and the handles it gives out (getNeuronById(), Python's Neuron) share that ownership, so
+a cell held from Python outlives the network along with the cells it connects to.
+*/
+class NeuronArena
+{
+public:
+    template <class... Args>
+    Neuron *create(Args &&...args)
+    {
+        cells.emplace_back(std::forward<Args>(args)...);
+        return &cells.back();
+    }
+    size_t size() const { return cells.size(); }
+
+private:
+    std::deque<Neuron> cells; // deque: appending never moves the others
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "neuron_ids.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace nid
+{
+
+namespace
+{
+
+// Strings live in chunks that never move: chunk c holds keys
+// [kFirst * (2^c - 1), kFirst * (2^(c+1) - 1)), so 24 chunks cover every uint32 key and
+// a reader finds a string without the lock
+const int kFirstBits = 8;
+const uint32_t kFirst = 1u << kFirstBits;
+const int kChunks = 32 - kFirstBits;
+
+struct Hash
+{
+    size_t operator()(const std::string *s) const { return std::hash<std::string>()(*s); }
+};
+
+struct Equal
+{
+    bool operator()(const std::string *a, const std::string *b) const { return *a == *b; }
+};
+
+struct Table
+{
+    std::mutex lock;
+    std::atomic<std::string *> chunks[kChunks];
+    std::unordered_map<const std::string *, Key, Hash, Equal> keys; // points into chunks
+    Key next = 0;
+
+    Table()
+    {
+        for (int c = 0; c < kChunks; ++c) chunks[c].store(nullptr, std::memory_order_relaxed);
+    }
+};
+
+Table &table()
+{
+    static Table *t = new Table(); // never destroyed: neurons may outlive static destructors
+    return *t;
+}
+
+inline int chunkOf(Key k, uint32_t &offset)
+{
+    const uint64_t j = static_cast<uint64_t>(k) + kFirst;
+    int bit = 32;
+    while (!(j >> bit)) --bit;
+    offset = static_cast<uint32_t>(j - (uint64_t(1) << bit));
+    return bit - kFirstBits;
+}
+
+} // namespace
+
+Key intern(const std::string &id)
+{
+    Table &t = table();
+    std::lock_guard<std::mutex> g(t.lock);
+    auto it = t.keys.find(&id);
+    if (it != t.keys.end()) return it->second;
+
+    const Key k = t.next++;
+    uint32_t offset;
+    const int c = chunkOf(k, offset);
+    std::string *chunk = t.chunks[c].load(std::memory_order_relaxed);
+    if (!chunk)
+    {
+        chunk = new std::string[static_cast<size_t>(kFirst) << c];
+        t.chunks[c].store(chunk, std::memory_order_release);
+    }
+    chunk[offset] = id;
+    t.keys.emplace(&chunk[offset], k);
+    return k;
+}
+
+bool find(const std::string &id, Key &out)
+{
+    Table &t = table();
+    std::lock_guard<std::mutex> g(t.lock);
+    auto it = t.keys.find(&id);
+    if (it == t.keys.end()) return false;
+    out = it->second;
+    return true;
+}
+
+const std::string &name(Key k)
+{
+    uint32_t offset;
+    const int c = chunkOf(k, offset);
+    return table().chunks[c].load(std::memory_order_acquire)[offset];
+}
+
+size_t count()
+{
+    Table &t = table();
+    std::lock_guard<std::mutex> g(t.lock);
+    return t.next;
+}
+
+} // namespace nid
@@ -0,0 +1,50 @@
+#ifndef __neuron_ids_h__
+#define __neuron_ids_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+Interned neuron IDs. Every ID string is stored once per process and named by a dense
+uint32 key, assigned the first time the string is interned (in practice when a neuron
+with that ID is created). Neurons, connection maps, network mappings and snapshot
+topologies hold keys; strings are materialized only at file and Python boundaries.
+
+The table is process-wide, so the same ID has the same key in every network (copies,
+evolution's population, snapshots restored into another net). Interning and find() take
+a lock; name() is lock-free. Keys are never released: the table grows with the number of
+distinct IDs ever used, not with the number of neurons.
+
+Keys are in creation order, not ID order. Maps that must iterate in ID order (connection
+maps, whose order is the edge order everywhere) compare keys with ByName.
+
+    nid::Key k = nid::intern("H12");
+    const std::string &id = nid::name(k); // "H12"
+*/
+namespace nid
+{
+
+typedef uint32_t Key;
+
+// key of `id`, interning it on first use
+Key intern(const std::string &id);
+
+// key of `id` if it was ever interned (without interning it)
+bool find(const std::string &id, Key &out);
+
+// the ID of a key returned by intern(); the reference stays valid for the process
+const std::string &name(Key k);
+
+// distinct IDs interned so far
+size_t count();
+
+// orders keys by their IDs
+struct ByName
+{
+    bool operator()(Key a, Key b) const { return a != b && name(a) < name(b); }
+};
+
+} // namespace nid
+
+#endif
@@ -4,9 +4,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <cmath>
 
 // =====================================================================================
 // Pluggable Output Detector Interface + EMA Implementation
@@ -43,7 +45,9 @@ public:
     EMAOutputDetector(float alpha = 0.05f, OutputDetectorOptions opts = {})
         : alpha(alpha), options(opts) {}
 
-    void reset() override { rates.clear(); }
+    // zeroes the rates in place (same as clearing them: unseen IDs read as 0), so a
+    // detector reused across episodes keeps its map nodes
+    void reset() override { for (auto &kv : rates) kv.second = 0.0f; }
 
     void update(const std::string &neuron_id, bool fired) override {
         if (rates.find(neuron_id) == rates.end()) rates[neuron_id] = 0.0f;
@@ -82,4 +86,282 @@ private:
     OutputDetectorOptions options;
 };
 
+/*
+Detectors over a fixed set of output slots, bound once to the outputs' IDs and Glia
+handles (Glia::getNeuronHandles). A tick updates every slot in one pass from the
+network's fired flags (a Glia::getFiredMask() bitmask or one byte per handle). Each slot
+has a score (its "rate"); the winner is the first slot with the highest score, subject
+to threshold/default_id, and the margin is top score minus second, from one top-2 scan.
+
+decided(ticks_left) tells whether the winner can still change if the episode ran
+ticks_left more ticks, so callers can stop early. The string interface is kept as an
+adapter: IDs are looked up among the slots, unknown IDs are ignored / read as 0.
+*/
+class SlotDetector : public IOutputDetector
+{
+public:
+    explicit SlotDetector(OutputDetectorOptions opts = {}) : options(opts) {}
+
+    // bind slot i to ids[i] / handles[i]; state is reset
+    void setOutputs(const std::vector<std::string> &ids, const std::vector<int> &handles) {
+        slot_ids = ids;
+        slot_handles = handles;
+        slot_handles.resize(slot_ids.size(), -1);
+        scores.assign(slot_ids.size(), 0.0f);
+        fired.assign(slot_ids.size(), 0.0f);
+        resize();
+        reset();
+    }
+    const std::vector<std::string> &outputIds() const { return slot_ids; }
+    const std::vector<int> &outputHandles() const { return slot_handles; }
+    int size() const { return static_cast<int>(scores.size()); }
+
+    // one tick: mask bit h set if handle h fired
+    void updateFromMask(const uint64_t *mask) {
+        for (size_t i = 0; i < slot_handles.size(); ++i) {
+            const int h = slot_handles[i];
+            fired[i] = (h >= 0 && ((mask[h >> 6] >> (h & 63)) & 1u)) ? 1.0f : 0.0f;
+        }
+        step();
+    }
+    // one tick: flags[h] != 0 if handle h fired
+    void updateFromFlags(const uint8_t *flags) {
+        for (size_t i = 0; i < slot_handles.size(); ++i) {
+            const int h = slot_handles[i];
+            fired[i] = (h >= 0 && flags[h]) ? 1.0f : 0.0f;
+        }
+        step();
+    }
+    // `ticks` ticks in which no output fired (a Glia::fastForward() stretch)
+    virtual void advanceSilent(int ticks) {
+        std::fill(fired.begin(), fired.end(), 0.0f);
+        for (int n = 0; n < ticks; ++n) step();
+    }
+
+    // start of the decision window (after warmup); window detectors restart here
+    virtual void beginDecision() {}
+    // true if no further ticks (at most ticks_left) can change winnerSlot()
+    virtual bool decided(int ticks_left) const { (void)ticks_left; return false; }
+
+    float rate(int slot) const { return scores[slot]; }
+
+    // slot with the highest score (first on ties), or -1 if none reaches the threshold
+    int winnerSlot() const {
+        int best = -1;
+        float max_score = -1.0f;
+        for (int i = 0; i < size(); ++i) {
+            if (scores[i] > max_score) { max_score = scores[i]; best = i; }
+        }
+        return max_score < options.threshold ? -1 : best;
+    }
+    std::string winner() const {
+        const int w = winnerSlot();
+        return w < 0 ? options.default_id : slot_ids[w];
+    }
+    // top score minus second-highest score (0 with fewer than two slots)
+    float margin() const {
+        if (size() < 2) return 0.0f;
+        float top1 = scores[0] > scores[1] ? scores[0] : scores[1];
+        float top2 = scores[0] > scores[1] ? scores[1] : scores[0];
+        for (int i = 2; i < size(); ++i) {
+            if (scores[i] > top1) { top2 = top1; top1 = scores[i]; }
+            else if (scores[i] > top2) { top2 = scores[i]; }
+        }
+        return top1 - top2;
+    }
+
+    // IOutputDetector adapter; update() advances that one slot by a tick
+    void update(const std::string &neuron_id, bool f) override {
+        const int i = slotOf(neuron_id);
+        if (i >= 0) updateSlot(i, f);
+    }
+    std::string predict(const std::vector<std::string> &output_ids) const override {
+        if (output_ids == slot_ids) return winner();
+        std::string max_id;
+        float max_rate = -1.0f;
+        for (const auto &id : output_ids) {
+            float r = getRate(id);
+            if (r > max_rate) { max_rate = r; max_id = id; }
+        }
+        return max_rate < options.threshold ? options.default_id : max_id;
+    }
+    float getRate(const std::string &neuron_id) const override {
+        const int i = slotOf(neuron_id);
+        return i >= 0 ? scores[i] : 0.0f;
+    }
+    float getMargin(const std::vector<std::string> &output_ids) const override {
+        if (output_ids == slot_ids) return margin();
+        if (output_ids.size() < 2) return 0.0f;
+        std::vector<float> vals; vals.reserve(output_ids.size());
+        for (const auto &id : output_ids) vals.push_back(getRate(id));
+        std::sort(vals.rbegin(), vals.rend());
+        return vals[0] - vals[1];
+    }
+
+protected:
+    OutputDetectorOptions options;
+    std::vector<std::string> slot_ids;
+    std::vector<int> slot_handles;
+    std::vector<float> scores; // per slot
+    std::vector<float> fired;  // 0/1 per slot for the current tick
+
+    // size per-slot state after setOutputs()
+    virtual void resize() {}
+    // advance every slot by one tick from `fired`
+    virtual void step() { for (int i = 0; i < size(); ++i) updateSlot(i, fired[i] != 0.0f); }
+    virtual void updateSlot(int slot, bool f) = 0;
+
+    // index of the highest score (first on ties) and the highest score among the others
+    int leader(float &runner_up) const {
+        int best = 0;
+        for (int i = 1; i < size(); ++i) if (scores[i] > scores[best]) best = i;
+        runner_up = -1.0f;
+        for (int i = 0; i < size(); ++i) if (i != best && scores[i] > runner_up) runner_up = scores[i];
+        return best;
+    }
+
+private:
+    int slotOf(const std::string &id) const {
+        for (size_t i = 0; i < slot_ids.size(); ++i) if (slot_ids[i] == id) return static_cast<int>(i);
+        return -1;
+    }
+};
+
+// EMA firing rates; the same rates, winner and margin as EMAOutputDetector
+class EMASlotDetector : public SlotDetector
+{
+public:
+    EMASlotDetector(float alpha = 0.05f, OutputDetectorOptions opts = {})
+        : SlotDetector(opts), alpha(alpha) {}
+
+    void reset() override { std::fill(scores.begin(), scores.end(), 0.0f); }
+
+    // silent ticks only decay the rates: r *= (1-alpha)^ticks, in one multiply (the same
+    // as ticks updates up to float rounding)
+    void advanceSilent(int ticks) override {
+        if (ticks <= 1) { SlotDetector::advanceSilent(ticks); return; }
+        const double k = std::pow(static_cast<double>(1.0f - alpha), static_cast<double>(ticks));
+        for (float &r : scores) r = static_cast<float>(r * k);
+    }
+
+    // with no further spikes the leader decays by k = (1-alpha)^n, while any other output
+    // can at most rise to r*k + (1 - k)
+    bool decided(int ticks_left) const override {
+        if (size() == 0) return false;
+        float runner_up;
+        const int w = leader(runner_up);
+        if (size() == 1) return true;
+        float k = 1.0f;
+        for (int n = 0; n < ticks_left; ++n) k *= 1.0f - alpha;
+        const float lead = scores[w] * k, chase = runner_up * k + (1.0f - k);
+        return lead > chase && lead >= options.threshold;
+    }
+
+protected:
+    void step() override {
+        const float a = alpha, keep = 1.0f - alpha;
+        float *r = scores.data();
+        const float *f = fired.data();
+        for (size_t i = 0; i < scores.size(); ++i) r[i] = keep * r[i] + a * f[i];
+    }
+    void updateSlot(int slot, bool f) override { scores[slot] = (1.0f - alpha) * scores[slot] + alpha * (f ? 1.0f : 0.0f); }
+
+private:
+    float alpha;
+};
+
+// Spike count over the last `window` ticks of each slot; the score is count / window.
+class WindowCountDetector : public SlotDetector
+{
+public:
+    explicit WindowCountDetector(int window = 50, OutputDetectorOptions opts = {})
+        : SlotDetector(opts), window(window > 0 ? window : 1) {}
+
+    void reset() override {
+        std::fill(ring.begin(), ring.end(), 0);
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(filled.begin(), filled.end(), 0);
+        std::fill(scores.begin(), scores.end(), 0.0f);
+    }
+    void beginDecision() override { reset(); }
+
+    // the leader loses at most the spikes that leave its window, any other output gains
+    // at most one spike per tick
+    bool decided(int ticks_left) const override {
+        if (size() == 0) return false;
+        float runner_up;
+        const int w = leader(runner_up);
+        const int drop = std::min(counts[w], std::max(0, filled[w] + ticks_left - window));
+        const int lead = counts[w] - drop;
+        if (static_cast<float>(lead) / window < options.threshold) return false;
+        for (int i = 0; i < size(); ++i) {
+            if (i == w) continue;
+            const int chase = std::min(window, counts[i] + ticks_left);
+            if (chase > lead || (chase == lead && i < w)) return false;
+        }
+        return true;
+    }
+
+protected:
+    void resize() override {
+        ring.assign(static_cast<size_t>(size()) * window, 0);
+        counts.assign(size(), 0);
+        filled.assign(size(), 0);
+    }
+    void updateSlot(int slot, bool f) override {
+        uint8_t &cell = ring[static_cast<size_t>(slot) * window + filled[slot] % window];
+        if (filled[slot] >= window) counts[slot] -= cell;
+        cell = f ? 1 : 0;
+        counts[slot] += cell;
+        filled[slot]++;
+        scores[slot] = static_cast<float>(counts[slot]) / window;
+    }
+
+private:
+    int window;
+    std::vector<uint8_t> ring; // [slot][window], slot's last `window` ticks
+    std::vector<int> counts;   // spikes in the ring
+    std::vector<int> filled;   // ticks seen since reset
+};
+
+// Time to first spike: a slot that first fired t ticks after reset scores
+// 1 - t / window (earlier is better), one that hasn't fired scores 0.
+class FirstSpikeDetector : public SlotDetector
+{
+public:
+    explicit FirstSpikeDetector(int window = 50, OutputDetectorOptions opts = {})
+        : SlotDetector(opts), window(window > 0 ? window : 1) {}
+
+    void reset() override {
+        std::fill(ticks.begin(), ticks.end(), 0);
+        std::fill(scores.begin(), scores.end(), 0.0f);
+    }
+    void beginDecision() override { reset(); }
+    void advanceSilent(int n) override { for (int &t : ticks) t += n; }
+
+    // once an output has fired, later first spikes score lower
+    bool decided(int ticks_left) const override {
+        (void)ticks_left;
+        if (size() == 0) return false;
+        float runner_up;
+        const int w = leader(runner_up);
+        return scores[w] > kLate && scores[w] >= options.threshold;
+    }
+
+protected:
+    void resize() override { ticks.assign(size(), 0); }
+    void updateSlot(int slot, bool f) override {
+        if (f && scores[slot] == 0.0f) {
+            const float score = 1.0f - static_cast<float>(ticks[slot]) / window;
+            scores[slot] = score > kLate ? score : kLate;
+        }
+        ticks[slot]++;
+    }
+
+private:
+    static constexpr float kLate = 1e-6f; // score of first spikes at or after `window` ticks (ties)
+    int window;
+    std::vector<int> ticks; // ticks seen since reset
+};
+
 #endif // __output_detection_h__
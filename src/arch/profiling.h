@@ -0,0 +1,210 @@
+#ifndef __profiling_h__
+#define __profiling_h__
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+/*
+Hot-path profiling: per-phase wall time and event counters for the simulation core, the
+trainers and the evolution engine.
+
+Everything is compiled out unless GLIA_PROFILE is defined (CMake option GLIA_PROFILE);
+the macros below then expand to nothing and Stats stays zero. When enabled, code records
+into the Stats bound to the current thread (GLIA_PROF_BIND), so nothing is shared between
+threads: the trainers bind their own Stats on the calling thread and one per worker, and
+merge the workers' after joining. Phase times of worker threads are summed, so with
+several workers they can add up to more than the wall time.
+
+Allocation counting replaces the global operator new, so it needs GLIA_PROFILE_ALLOCATIONS
+as well (the replacement lives in glia.cpp); it is meant for executables, not for the
+Python module.
+*/
+namespace prof {
+
+enum Phase
+{
+    Inject,      // sensory input of a tick
+    Step,        // network simulation (Glia::step, lockstep BatchedNetwork runs)
+    Detector,    // output detector updates
+    Eligibility, // firing rates and eligibility traces
+    Delta,       // per-edge deltas / gradients from an episode
+    Apply,       // weight updates
+    PruneGrow,   // structural plasticity
+    Plasticity,  // intrinsic plasticity (threshold/leak) and inactivity pruning
+    Checkpoint,  // in-memory snapshots and on-disk checkpoint serialization
+    Evaluate,    // evolution: validation of an individual (includes its episodes' phases)
+    Mutate,      // evolution: building mutated children
+    NumPhases
+};
+
+inline const char *phaseName(int p)
+{
+    static const char *names[NumPhases] = {"inject", "step", "detector", "eligibility", "delta",
+                                           "apply", "prune_grow", "plasticity", "checkpoint",
+                                           "evaluate", "mutate"};
+    return p >= 0 && p < NumPhases ? names[p] : "";
+}
+
+struct Stats
+{
+    double seconds[NumPhases];
+    uint64_t calls[NumPhases];
+    uint64_t ticks;           // network steps (one per lane in lockstep runs)
+    uint64_t spikes;
+    uint64_t synaptic_events; // out-edges of neurons that fired
+    uint64_t edges_touched;   // per-edge trainer work (traces, deltas, updates)
+    uint64_t allocations;     // operator new calls (GLIA_PROFILE_ALLOCATIONS only)
+
+    Stats() { reset(); }
+
+    void reset()
+    {
+        for (int p = 0; p < NumPhases; ++p) { seconds[p] = 0.0; calls[p] = 0; }
+        ticks = spikes = synaptic_events = edges_touched = allocations = 0;
+    }
+
+    void merge(const Stats &o)
+    {
+        for (int p = 0; p < NumPhases; ++p) { seconds[p] += o.seconds[p]; calls[p] += o.calls[p]; }
+        ticks += o.ticks;
+        spikes += o.spikes;
+        synaptic_events += o.synaptic_events;
+        edges_touched += o.edges_touched;
+        allocations += o.allocations;
+    }
+
+    // what was recorded after `earlier` (a copy of this object taken before)
+    Stats since(const Stats &earlier) const
+    {
+        Stats d;
+        for (int p = 0; p < NumPhases; ++p) { d.seconds[p] = seconds[p] - earlier.seconds[p]; d.calls[p] = calls[p] - earlier.calls[p]; }
+        d.ticks = ticks - earlier.ticks;
+        d.spikes = spikes - earlier.spikes;
+        d.synaptic_events = synaptic_events - earlier.synaptic_events;
+        d.edges_touched = edges_touched - earlier.edges_touched;
+        d.allocations = allocations - earlier.allocations;
+        return d;
+    }
+
+    double spikesPerTick() const { return ticks ? static_cast<double>(spikes) / static_cast<double>(ticks) : 0.0; }
+
+    // one line: phases with recorded time (ms), then the counters
+    std::string summary() const
+    {
+        std::ostringstream os;
+        os.precision(4);
+        for (int p = 0; p < NumPhases; ++p)
+            if (calls[p]) os << phaseName(p) << "=" << seconds[p] * 1e3 << "ms ";
+        os << "ticks=" << ticks << " spikes/tick=" << spikesPerTick() << " syn_events=" << synaptic_events
+           << " edges_touched=" << edges_touched;
+        if (allocations) os << " allocs=" << allocations;
+        return os.str();
+    }
+};
+
+#if defined(GLIA_PROFILE)
+
+inline bool enabled() { return true; }
+
+// operator new calls on this thread (counted with GLIA_PROFILE_ALLOCATIONS)
+inline uint64_t &allocationCount()
+{
+    static thread_local uint64_t n = 0;
+    return n;
+}
+
+// allocationCount() when the current sink last started counting
+inline uint64_t &allocationBase()
+{
+    static thread_local uint64_t n = 0;
+    return n;
+}
+
+// Stats the current thread records into (nullptr: none)
+inline Stats *&sink()
+{
+    static thread_local Stats *s = nullptr;
+    return s;
+}
+
+// credits the allocations counted since the sink was bound (or last flushed) to it; call
+// before reading the bound Stats mid-scope
+inline void flush()
+{
+    const uint64_t now = allocationCount();
+    if (sink()) sink()->allocations += now - allocationBase();
+    allocationBase() = now;
+}
+
+// makes `s` the thread's sink for the enclosing scope; re-binding the current sink is a
+// no-op. Allocations go to the innermost bound Stats only.
+class Bind
+{
+public:
+    explicit Bind(Stats *s) : prev(sink()), active(s != sink())
+    {
+        if (active) swapTo(s);
+    }
+    ~Bind()
+    {
+        if (active) swapTo(prev);
+    }
+    Bind(const Bind &) = delete;
+    Bind &operator=(const Bind &) = delete;
+
+private:
+    static void swapTo(Stats *next)
+    {
+        flush();
+        sink() = next;
+    }
+    Stats *prev;
+    bool active;
+};
+
+// adds the enclosing scope's wall time to a phase of the thread's sink
+class Scope
+{
+public:
+    explicit Scope(Phase p) : s(sink()), phase(p)
+    {
+        if (s) t0 = std::chrono::steady_clock::now();
+    }
+    ~Scope()
+    {
+        if (!s) return;
+        s->seconds[phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        s->calls[phase] += 1;
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    Stats *s;
+    Phase phase;
+    std::chrono::steady_clock::time_point t0;
+};
+
+#define GLIA_PROF_CAT_(a, b) a##b
+#define GLIA_PROF_CAT(a, b) GLIA_PROF_CAT_(a, b)
+#define GLIA_PROF_BIND(stats) ::prof::Bind GLIA_PROF_CAT(glia_prof_bind_, __LINE__)(stats)
+#define GLIA_PROF_SCOPE(phase) ::prof::Scope GLIA_PROF_CAT(glia_prof_scope_, __LINE__)(::prof::phase)
+#define GLIA_PROF_COUNT(field, n) \
+    do { if (::prof::Stats *glia_prof_s_ = ::prof::sink()) glia_prof_s_->field += static_cast<uint64_t>(n); } while (0)
+
+#else
+
+inline bool enabled() { return false; }
+inline void flush() {}
+
+#define GLIA_PROF_BIND(stats) ((void)0)
+#define GLIA_PROF_SCOPE(phase) ((void)0)
+#define GLIA_PROF_COUNT(field, n) ((void)0)
+
+#endif
+
+} // namespace prof
+
+#endif
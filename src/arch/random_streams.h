@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+/*
+Counter-based random streams. A stream is named by a key hashed from a seed and the
+coordinates of what it is for, e.g. (seed, Shuffle, epoch) or (seed, Breed, generation,
+child), and draw i of it is a pure function of (key, i): SplitMix64's output for the
+state key + (i + 1) * gamma. Work keyed this way gives the same numbers in any order and
+on any number of threads, so parallel runs can be checked bit for bit against serial ones,
+and a checkpoint only needs the seed and the counters that name the streams.
+
+Draws are turned into numbers here rather than by <random>'s distributions, whose
+algorithms differ between standard libraries; integers and uniform reals are then the same
+on every platform (normal() goes through the C math library).
+
+    rstream::Stream rng(rstream::key(seed, rstream::Shuffle, epoch));
+    rstream::shuffle(order.begin(), order.end(), rng);
+*/
+namespace rstream {
+
+// what a stream is for, as the first coordinate of its key
+enum Purpose : uint64_t {
+    Shuffle = 1,      // (epoch): episode order
+    WeightJitter,     // (call, row): weight_jitter_std noise at the start of trainEpoch()
+    TimingJitter,     // (epoch, episode): onset shifts of timing_jitter
+    GrowEdges,        // (structural pass): new edges of grow_edges
+    SeedJitter,       // (individual): mutation of evolution's initial population
+    Breed,            // (generation, child) or (evaluation): parent choice and mutation
+    SweepDraw,        // (trial): values of a random-search trial
+    Encode,           // (epoch, episode): Poisson spikes of an encoded episode
+    WorldClip,        // (clip, variant): objects of a mini-world clip
+};
+
+const uint64_t golden_gamma = 0x9E3779B97F4A7C15ull; // SplitMix64's increment
+
+// SplitMix64 finalizer
+inline uint64_t finalize(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// seed of sub-stream `stream` of `seed`
+inline uint64_t mix(uint64_t seed, uint64_t stream) { return finalize(seed + golden_gamma * (stream + 1)); }
+
+inline uint64_t key(uint64_t seed, uint64_t purpose, uint64_t a = 0, uint64_t b = 0) {
+    return mix(mix(mix(seed, purpose), a), b);
+}
+
+class Stream {
+public:
+    typedef uint64_t result_type;
+    explicit Stream(uint64_t key) : state(key) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+    result_type operator()() { state += golden_gamma; return finalize(state); }
+    void discard(uint64_t n) { state += golden_gamma * n; }
+
+    // uniform in [0, 1), 53 bits
+    double uniform() { return static_cast<double>((*this)() >> 11) * (1.0 / 9007199254740992.0); }
+    // uniform in [lo, hi)
+    float uniform(float lo, float hi) { return lo + static_cast<float>(uniform()) * (hi - lo); }
+    // uniform in [0, n), unbiased (Lemire's multiply-and-reject); 0 for n == 0
+    uint32_t below(uint32_t n) {
+        if (n == 0) return 0;
+        uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * n;
+        if (static_cast<uint32_t>(m) < n) {
+            const uint32_t t = static_cast<uint32_t>(-n) % n;
+            while (static_cast<uint32_t>(m) < t) m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * n;
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+    // uniform in [lo, hi]
+    int between(int lo, int hi) { return lo + static_cast<int>(below(static_cast<uint32_t>(hi - lo) + 1u)); }
+    bool coin() { return ((*this)() >> 63) != 0; }
+    // N(mean, stddev) by Box-Muller, two draws per value
+    float normal(float mean, float stddev) {
+        const double u1 = 1.0 - uniform(), u2 = uniform();
+        return mean + stddev * static_cast<float>(std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2));
+    }
+
+private:
+    uint64_t state;
+};
+
+// Fisher-Yates
+template <class It>
+void shuffle(It first, It last, Stream &rng) {
+    const std::ptrdiff_t n = last - first;
+    for (std::ptrdiff_t i = n - 1; i > 0; --i) {
+        const std::ptrdiff_t j = static_cast<std::ptrdiff_t>(rng.below(static_cast<uint32_t>(i + 1)));
+        if (j != i) std::swap(first[i], first[j]);
+    }
+}
+
+} // namespace rstream
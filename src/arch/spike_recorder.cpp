@@ -0,0 +1,202 @@
+#include "spike_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+const char spk_magic[4] = {'G', 'S', 'P', 'K'};
+const uint32_t spk_version = 1;
+
+uint64_t align8(uint64_t x) { return (x + 7) & ~static_cast<uint64_t>(7); }
+} // namespace
+
+SpikeRecorder::SpikeRecorder(Mode mode, int capacity)
+    : record_mode(mode), cap(capacity > 0 ? capacity : 1)
+{
+    if (record_mode == Mode::Events) events.resize(cap);
+}
+
+void SpikeRecorder::setNeurons(const std::vector<int> &handles)
+{
+    subset = handles;
+    cols = -1;
+    row_words = 0;
+    rows.clear();
+    if (!subset.empty()) setColumns(static_cast<int>(subset.size()));
+    clear();
+}
+
+void SpikeRecorder::setColumns(int n)
+{
+    cols = n;
+    row_words = (n + 63) / 64;
+    if (record_mode == Mode::Raster) rows.assign(static_cast<size_t>(cap) * row_words, 0);
+}
+
+void SpikeRecorder::clear()
+{
+    start = held = 0;
+    tick_count = dropped_count = spike_count = 0;
+}
+
+int SpikeRecorder::nextSlot()
+{
+    if (held < cap) return (start + held++) % cap;
+    const int slot = start;
+    start = (start + 1) % cap;
+    ++dropped_count;
+    return slot;
+}
+
+void SpikeRecorder::record(const uint8_t *fired, int n)
+{
+    const int32_t tick = static_cast<int32_t>(tick_count++);
+    if (record_mode == Mode::Events)
+    {
+        auto push = [&](int h) {
+            Spike &s = events[nextSlot()];
+            s.tick = tick;
+            s.neuron = h;
+            ++spike_count;
+        };
+        if (!subset.empty())
+        {
+            for (int h : subset)
+                if (h >= 0 && h < n && fired[h]) push(h);
+            return;
+        }
+        // spikes are sparse: skip 8 quiet neurons at a time
+        int h = 0;
+        for (; h + 8 <= n; h += 8)
+        {
+            uint64_t block;
+            std::memcpy(&block, fired + h, 8);
+            if (!block) continue;
+            for (int k = h; k < h + 8; ++k)
+                if (fired[k]) push(k);
+        }
+        for (; h < n; ++h)
+            if (fired[h]) push(h);
+        return;
+    }
+
+    if (cols < 0) setColumns(n);
+    uint64_t *row = &rows[static_cast<size_t>(nextSlot()) * row_words];
+    std::fill(row, row + row_words, 0);
+    if (!subset.empty())
+    {
+        for (int c = 0; c < cols; ++c)
+        {
+            const int h = subset[c];
+            if (h >= 0 && h < n && fired[h])
+            {
+                row[c >> 6] |= uint64_t(1) << (c & 63);
+                ++spike_count;
+            }
+        }
+        return;
+    }
+    const int m = std::min(n, cols);
+    for (int c = 0; c < m; ++c)
+        if (fired[c])
+        {
+            row[c >> 6] |= uint64_t(1) << (c & 63);
+            ++spike_count;
+        }
+}
+
+void SpikeRecorder::recordSilent(long long ticks, int n)
+{
+    if (ticks <= 0) return;
+    tick_count += ticks;
+    if (record_mode == Mode::Events) return;
+
+    if (cols < 0) setColumns(n);
+    if (ticks >= cap)
+    {
+        // the ring ends up all silent rows; the older ones were dropped on the way
+        dropped_count += held + ticks - cap;
+        std::fill(rows.begin(), rows.end(), 0);
+        start = 0;
+        held = cap;
+        return;
+    }
+    for (long long k = 0; k < ticks; ++k)
+    {
+        uint64_t *row = &rows[static_cast<size_t>(nextSlot()) * row_words];
+        std::fill(row, row + row_words, 0);
+    }
+}
+
+void SpikeRecorder::linearize()
+{
+    if (start == 0) return;
+    if (record_mode == Mode::Events)
+        std::rotate(events.begin(), events.begin() + start, events.end());
+    else
+        std::rotate(rows.begin(), rows.begin() + static_cast<size_t>(start) * row_words, rows.end());
+    start = 0; // a ring only wraps when full, so the rotated data fills the buffer
+}
+
+const SpikeRecorder::Spike *SpikeRecorder::spikes()
+{
+    if (record_mode != Mode::Events) return nullptr;
+    linearize();
+    return events.data();
+}
+
+const uint64_t *SpikeRecorder::raster()
+{
+    if (record_mode != Mode::Raster) return nullptr;
+    linearize();
+    return rows.data();
+}
+
+long long SpikeRecorder::firstTick() const
+{
+    return record_mode == Mode::Raster ? tick_count - held : (held ? events[start].tick : 0);
+}
+
+bool SpikeRecorder::save(const std::string &path, std::string &error)
+{
+    linearize();
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, spk_magic, 4);
+    h.version = spk_version;
+    h.mode = record_mode == Mode::Events ? 0u : 1u;
+    h.num_neurons = static_cast<uint32_t>(subset.size());
+    h.columns = static_cast<uint32_t>(std::max(cols, 0));
+    h.words = static_cast<uint32_t>(row_words);
+    h.count = static_cast<uint64_t>(held);
+    h.first_tick = firstTick();
+    h.ticks = static_cast<uint64_t>(tick_count);
+    h.dropped = static_cast<uint64_t>(dropped_count);
+
+    std::vector<uint32_t> ids(subset.begin(), subset.end());
+    const uint64_t neurons_offset = align8(sizeof(Header));
+    const uint64_t data_offset = align8(neurons_offset + ids.size() * sizeof(uint32_t));
+    const void *data = record_mode == Mode::Events ? static_cast<const void *>(events.data()) : static_cast<const void *>(rows.data());
+    const uint64_t data_bytes = record_mode == Mode::Events ? h.count * sizeof(Spike) : h.count * h.words * sizeof(uint64_t);
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    static const char zeros[8] = {0};
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(zeros, static_cast<std::streamsize>(neurons_offset - sizeof(Header)));
+    if (!ids.empty()) out.write(reinterpret_cast<const char *>(ids.data()), static_cast<std::streamsize>(ids.size() * sizeof(uint32_t)));
+    out.write(zeros, static_cast<std::streamsize>(data_offset - neurons_offset - ids.size() * sizeof(uint32_t)));
+    if (data_bytes) out.write(static_cast<const char *>(data), static_cast<std::streamsize>(data_bytes));
+    if (!out)
+    {
+        error = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef __spike_recorder_h__
+#define __spike_recorder_h__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+In-engine spike recording, attached to a network with Glia::setSpikeRecorder(). After
+every step the network hands the recorder its fired flags (by handle), so capturing
+activity costs one pass over the fired array in C++ instead of a didFire() poll per
+neuron per tick from the host.
+
+Two layouts, both fixed-size rings that overwrite the oldest data when full (counted in
+dropped()):
+
+    Events  (tick, handle) pairs, capacity = spikes kept; suits sparse activity
+    Raster  one bit-packed row per tick, capacity = ticks kept; bit (c % 64) of word
+            c / 64 is set if column c fired (the layout of Glia::getFiredMask)
+
+Recording can be limited to a subset of handles (setNeurons); raster columns then follow
+the subset's order, while events keep the network handle. Without a subset a raster has
+one column per neuron of the first recorded step; handles beyond that are not recorded.
+
+Ticks count the steps recorded since construction or clear(). spikes() and raster()
+rotate the ring in place so the oldest entry comes first and return pointers into it,
+which stay valid until the next record() or clear().
+
+save() writes a compact binary file (little-endian, 8-byte aligned sections):
+
+    Header    magic "GSPK", version, mode, counts
+    neurons   uint32[num_neurons], the recorded subset (empty: all handles)
+    data      Spike[count] (Events) or uint64[count * words] (Raster), oldest first
+*/
+class SpikeRecorder
+{
+public:
+    enum class Mode { Events, Raster };
+
+    struct Spike
+    {
+        int32_t tick;
+        int32_t neuron;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t mode; // 0 = Events, 1 = Raster
+        uint32_t num_neurons;
+        uint32_t columns;
+        uint32_t words;
+        uint64_t count; // spikes (Events) or rows (Raster)
+        int64_t first_tick;
+        uint64_t ticks;
+        uint64_t dropped;
+    };
+
+    // capacity: spikes (Events) or ticks (Raster) kept; at least 1
+    SpikeRecorder(Mode mode, int capacity);
+
+    Mode mode() const { return record_mode; }
+    int capacity() const { return cap; }
+
+    // record only these handles (empty: all); clears what was recorded so far
+    void setNeurons(const std::vector<int> &handles);
+    const std::vector<int> &neurons() const { return subset; }
+
+    // drop everything recorded and restart the tick count at 0
+    void clear();
+
+    // append one tick: fired[h] != 0 if handle h fired (n flags)
+    void record(const uint8_t *fired, int n);
+    // append `ticks` ticks in which none of the n neurons fired (Glia::fastForward())
+    void recordSilent(long long ticks, int n);
+
+    long long ticks() const { return tick_count; }
+    long long dropped() const { return dropped_count; }
+    long long totalSpikes() const { return spike_count; }
+
+    // Events: spikes kept, oldest first
+    const Spike *spikes();
+    int numSpikes() const { return record_mode == Mode::Events ? held : 0; }
+
+    // Raster: rows kept (consecutive ticks from firstTick()), oldest first
+    const uint64_t *raster();
+    int numRows() const { return record_mode == Mode::Raster ? held : 0; }
+    int columns() const { return cols; }
+    int words() const { return row_words; }
+    long long firstTick() const;
+
+    // false (with a message in error) if the file can't be written
+    bool save(const std::string &path, std::string &error);
+
+private:
+    void setColumns(int n);
+    int nextSlot(); // physical slot for a new entry, overwriting the oldest when full
+    void linearize();
+
+    Mode record_mode;
+    int cap;
+    std::vector<int> subset;
+    int cols = -1; // raster columns; -1 until known
+    int row_words = 0;
+
+    std::vector<Spike> events;
+    std::vector<uint64_t> rows;
+    int start = 0; // slot of the oldest entry
+    int held = 0;
+
+    long long tick_count = 0;
+    long long dropped_count = 0;
+    long long spike_count = 0;
+};
+
+#endif
@@ -0,0 +1,384 @@
+#include "telemetry.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace telemetry
+{
+
+namespace
+{
+
+const char *const kind_names[NumKinds] = {"batch", "epoch", "phase", "individual", "generation"};
+
+const char *const field_names[NumKinds][kValues] = {
+    {"epoch", "batch", "episodes", "accuracy", "margin"},
+    {"epoch", "accuracy", "margin", "seconds", "ticks", "spikes", "spikes_per_sec", "edges_grown", "edges_pruned", "edges"},
+    {"step", "phase", "seconds", "calls"},
+    {"generation", "index", "accuracy", "margin", "edges", "ticks", "seconds", "stopped"},
+    {"generation", "best_fitness", "best_accuracy", "best_margin", "best_edges",
+     "mean_fitness", "mean_accuracy", "mean_margin", "mean_edges", "median_fitness"}};
+
+const int drain_ms = 20;
+
+double clockSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CSV columns after kind and time: every field name once, in first-use order
+const std::vector<std::string> &csvColumns()
+{
+    static const std::vector<std::string> cols = []() {
+        std::vector<std::string> c;
+        for (int k = 0; k < static_cast<int>(NumKinds); ++k)
+            for (int i = 0; i < fieldCount(k); ++i)
+            {
+                bool seen = false;
+                for (const std::string &s : c) seen = seen || s == field_names[k][i];
+                if (!seen) c.push_back(field_names[k][i]);
+            }
+        return c;
+    }();
+    return cols;
+}
+
+void appendNumber(std::string &out, double x)
+{
+    char buf[32];
+    if (x == static_cast<double>(static_cast<long long>(x)) && x > -1e15 && x < 1e15)
+        std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(x));
+    else
+        std::snprintf(buf, sizeof(buf), "%.6g", x);
+    out += buf;
+}
+
+// a field's value as text: the phase name for Phase records, else the number
+void appendField(std::string &out, const Record &r, int i, bool quote)
+{
+    if (r.kind == Phase && i == 1)
+    {
+        if (quote) out += '"';
+        out += prof::phaseName(static_cast<int>(r.v[i]));
+        if (quote) out += '"';
+    }
+    else
+    {
+        appendNumber(out, r.v[i]);
+    }
+}
+
+} // namespace
+
+const char *kindName(int kind) { return kind >= 0 && kind < static_cast<int>(NumKinds) ? kind_names[kind] : ""; }
+
+const char *fieldName(int kind, int i)
+{
+    if (kind < 0 || kind >= static_cast<int>(NumKinds) || i < 0 || i >= kValues || !field_names[kind][i]) return "";
+    return field_names[kind][i];
+}
+
+int fieldCount(int kind)
+{
+    int n = 0;
+    while (n < kValues && *fieldName(kind, n)) ++n;
+    return n;
+}
+
+Record batchRecord(int epoch, int batch, int episodes, double accuracy, double margin)
+{
+    Record r(Batch);
+    r.v[0] = epoch;
+    r.v[1] = batch;
+    r.v[2] = episodes;
+    r.v[3] = accuracy;
+    r.v[4] = margin;
+    return r;
+}
+
+Record epochRecord(int epoch, double accuracy, double margin, double seconds, const prof::Stats &profile,
+                   uint64_t edges_grown, uint64_t edges_pruned, int edges)
+{
+    Record r(Epoch);
+    r.v[0] = epoch;
+    r.v[1] = accuracy;
+    r.v[2] = margin;
+    r.v[3] = seconds;
+    r.v[4] = static_cast<double>(profile.ticks);
+    r.v[5] = static_cast<double>(profile.spikes);
+    r.v[6] = seconds > 0.0 ? static_cast<double>(profile.spikes) / seconds : 0.0;
+    r.v[7] = static_cast<double>(edges_grown);
+    r.v[8] = static_cast<double>(edges_pruned);
+    r.v[9] = edges;
+    return r;
+}
+
+void emitPhases(Sink &sink, int step, const prof::Stats &profile)
+{
+    for (int p = 0; p < prof::NumPhases; ++p)
+    {
+        if (!profile.calls[p]) continue;
+        Record r(Phase);
+        r.v[0] = step;
+        r.v[1] = p;
+        r.v[2] = profile.seconds[p];
+        r.v[3] = static_cast<double>(profile.calls[p]);
+        sink.emit(r);
+    }
+}
+
+Exporter::Exporter(size_t capacity) : start(clockSeconds())
+{
+    size_t n = 2;
+    while (n < capacity) n <<= 1;
+    ring = std::vector<Cell>(n);
+    for (size_t i = 0; i < n; ++i) ring[i].seq.store(i, std::memory_order_relaxed);
+    mask = n - 1;
+}
+
+Exporter::~Exporter() { close(); }
+
+bool Exporter::open(const std::string &target)
+{
+    close();
+    const std::string tcp = "tcp://";
+    csv = false;
+    failed = false;
+    if (target.compare(0, tcp.size(), tcp) == 0)
+    {
+#if !defined(_WIN32)
+        const std::string hostport = target.substr(tcp.size());
+        const size_t colon = hostport.rfind(':');
+        if (colon == std::string::npos)
+        {
+            std::cerr << "Warning: telemetry target " << target << " has no port" << std::endl;
+            return false;
+        }
+        const std::string host = hostport.substr(0, colon), port = hostport.substr(colon + 1);
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *list = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &list) == 0)
+        {
+            for (addrinfo *a = list; a && fd < 0; a = a->ai_next)
+            {
+                fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+                {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+            freeaddrinfo(list);
+        }
+        if (fd < 0)
+        {
+            std::cerr << "Warning: cannot connect telemetry to " << hostport << std::endl;
+            return false;
+        }
+#else
+        std::cerr << "Warning: telemetry sockets need POSIX sockets" << std::endl;
+        return false;
+#endif
+    }
+    else
+    {
+        std::unique_ptr<std::ofstream> f(new std::ofstream(target.c_str(), std::ios::trunc));
+        if (!f->is_open())
+        {
+            std::cerr << "Warning: cannot write telemetry to " << target << std::endl;
+            return false;
+        }
+        csv = target.size() >= 4 && target.compare(target.size() - 4, 4, ".csv") == 0;
+        if (csv)
+        {
+            *f << "kind,time";
+            for (const std::string &c : csvColumns()) *f << "," << c;
+            *f << "\n";
+        }
+        file = std::move(f);
+    }
+    target_name = target;
+    stopping = false;
+    running = true;
+    worker = std::thread(&Exporter::run, this);
+    return true;
+}
+
+void Exporter::close()
+{
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    running = false;
+    file.reset();
+#if !defined(_WIN32)
+    if (fd >= 0) ::close(fd);
+#endif
+    fd = -1;
+}
+
+void Exporter::emit(const Record &r)
+{
+    if (!running.load(std::memory_order_acquire))
+    {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // bounded multi-producer ring: a cell is free for position p when its seq is p, and
+    // holds a record for the consumer when its seq is p + 1
+    uint64_t pos = head.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+    {
+        cell = &ring[pos & mask];
+        const uint64_t seq = cell->seq.load(std::memory_order_acquire);
+        if (seq == pos)
+        {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (seq < pos)
+        {
+            dropped_count.fetch_add(1, std::memory_order_relaxed); // full
+            return;
+        }
+        else
+        {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+    cell->record = r;
+    cell->record.time = clockSeconds() - start;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    accepted.fetch_add(1, std::memory_order_release);
+}
+
+void Exporter::flush()
+{
+    if (!running) return;
+    const uint64_t target = accepted.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> g(lock);
+    flush_requested = true;
+    wake.notify_all();
+    drained.wait(g, [&]() { return consumed.load() >= target || !running; });
+}
+
+bool Exporter::pop(Record &r)
+{
+    Cell &cell = ring[tail & mask];
+    if (cell.seq.load(std::memory_order_acquire) != tail + 1) return false;
+    r = cell.record;
+    cell.seq.store(tail + mask + 1, std::memory_order_release);
+    ++tail;
+    return true;
+}
+
+void Exporter::run()
+{
+    Record r;
+    for (;;)
+    {
+        bool any = false;
+        while (pop(r))
+        {
+            write(r);
+            consumed.fetch_add(1);
+            any = true;
+        }
+        if (any && file) file->flush();
+        std::unique_lock<std::mutex> g(lock);
+        drained.notify_all();
+        if (stopping && consumed.load() >= accepted.load()) return;
+        if (!flush_requested) wake.wait_for(g, std::chrono::milliseconds(drain_ms));
+        flush_requested = false;
+    }
+}
+
+void Exporter::write(const Record &r)
+{
+    if (failed || r.kind >= NumKinds)
+    {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    line.clear();
+    const int n = fieldCount(r.kind);
+    if (csv)
+    {
+        line += kindName(r.kind);
+        line += ',';
+        appendNumber(line, r.time);
+        for (const std::string &c : csvColumns())
+        {
+            line += ',';
+            for (int i = 0; i < n; ++i)
+                if (c == field_names[r.kind][i]) appendField(line, r, i, false);
+        }
+    }
+    else
+    {
+        line += "{\"kind\":\"";
+        line += kindName(r.kind);
+        line += "\",\"time\":";
+        appendNumber(line, r.time);
+        for (int i = 0; i < n; ++i)
+        {
+            line += ",\"";
+            line += field_names[r.kind][i];
+            line += "\":";
+            appendField(line, r, i, true);
+        }
+        line += '}';
+    }
+    line += '\n';
+    const bool ok = file ? static_cast<bool>(file->write(line.data(), static_cast<std::streamsize>(line.size()))) : send(line);
+    if (!ok)
+    {
+        std::cerr << "Warning: telemetry to " << target_name << " failed; dropping further records" << std::endl;
+        failed = true;
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    written_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Exporter::send(const std::string &text)
+{
+#if !defined(_WIN32)
+#if defined(MSG_NOSIGNAL)
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < text.size())
+    {
+        const ssize_t k = ::send(fd, text.data() + sent, text.size() - sent, flags);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        sent += static_cast<size_t>(k);
+    }
+    return true;
+#else
+    (void)text;
+    return false;
+#endif
+}
+
+} // namespace telemetry
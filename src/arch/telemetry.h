@@ -0,0 +1,158 @@
+#ifndef __telemetry_h__
+#define __telemetry_h__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiling.h"
+
+/*
+Run telemetry: progress records of the trainers and the evolution engine, handed to a
+Sink attached with Trainer::setTelemetry() / EvolutionEngine::setTelemetry(). With a sink
+attached, per-batch progress goes to it instead of the console.
+
+A record is a fixed-size POD: a kind, a timestamp and up to kValues numbers whose names
+depend on the kind (fieldName()):
+
+    Batch       epoch, batch, episodes, accuracy, margin
+    Epoch       epoch, accuracy, margin, seconds, ticks, spikes, spikes_per_sec,
+                edges_grown, edges_pruned, edges
+    Phase       step, phase, seconds, calls       (per profiling phase, GLIA_PROFILE only;
+                                                   step is the epoch or the generation)
+    Individual  generation, index, accuracy, margin, edges, ticks, seconds, stopped
+    Generation  generation, best_fitness, best_accuracy, best_margin, best_edges,
+                mean_fitness, mean_accuracy, mean_margin, mean_edges, median_fitness
+
+Epochs and generations count from 1. ticks and spikes come from the profiling counters
+(profiling.h), so they are zero unless built with GLIA_PROFILE.
+
+Exporter is the sink that writes records from a background thread. emit() only copies the
+record into a bounded lock-free ring (any number of threads may emit at once); the
+exporter thread drains it every few milliseconds and formats it as JSON lines or CSV into
+a file, or as JSON lines to a TCP socket. A full ring drops the record (counted in
+dropped()) rather than blocking the emitting thread.
+
+    auto ex = std::make_shared<telemetry::Exporter>();
+    ex->open("run.jsonl");                  // or "run.csv", "tcp://host:9000"
+    trainer.setTelemetry(ex);
+*/
+namespace telemetry
+{
+
+enum Kind : uint32_t
+{
+    Batch,
+    Epoch,
+    Phase,
+    Individual,
+    Generation,
+    NumKinds
+};
+
+const int kValues = 10;
+
+struct Record
+{
+    Kind kind;
+    double time;        // seconds since the sink was created (set by the sink)
+    double v[kValues];  // named by fieldName(kind, i); unused ones are 0
+
+    explicit Record(Kind k = Batch) : kind(k), time(0.0)
+    {
+        for (int i = 0; i < kValues; ++i) v[i] = 0.0;
+    }
+};
+
+// "batch", "epoch", ...
+const char *kindName(int kind);
+// name of v[i] for a kind; "" past its last field
+const char *fieldName(int kind, int i);
+// fields used by a kind
+int fieldCount(int kind);
+
+// records the trainers emit
+Record batchRecord(int epoch, int batch, int episodes, double accuracy, double margin);
+Record epochRecord(int epoch, double accuracy, double margin, double seconds, const prof::Stats &profile,
+                   uint64_t edges_grown, uint64_t edges_pruned, int edges);
+
+// receives records; emit() may be called from several threads at once
+class Sink
+{
+public:
+    virtual ~Sink() {}
+    virtual void emit(const Record &r) = 0;
+    // wait until the records emitted so far are delivered
+    virtual void flush() {}
+};
+
+// one Phase record per phase that ran in a profile (e.g. an epoch's Stats::since())
+void emitPhases(Sink &sink, int step, const prof::Stats &profile);
+
+class Exporter : public Sink
+{
+public:
+    // capacity: records buffered between drains (rounded up to a power of two)
+    explicit Exporter(size_t capacity = 8192);
+    ~Exporter();
+    Exporter(const Exporter &) = delete;
+    Exporter &operator=(const Exporter &) = delete;
+
+    // start exporting to `target`: "tcp://host:port" streams JSON lines to a socket, a path
+    // ending in ".csv" is written as CSV (one header row, every field of every kind as a
+    // column), any other path as JSON lines. A previous target is closed first. False
+    // (with a warning on cerr) if it can't be opened.
+    bool open(const std::string &target);
+    // write what was emitted, then close the target and stop the thread
+    void close();
+    bool isOpen() const { return running.load(); }
+
+    // lock-free; the record is dropped if the exporter isn't open or the ring is full
+    void emit(const Record &r) override;
+    void flush() override;
+
+    uint64_t written() const { return written_count.load(); }
+    uint64_t dropped() const { return dropped_count.load(); }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint64_t> seq;
+        Record record;
+    };
+
+    void run();
+    bool pop(Record &r);
+    void write(const Record &r);
+    bool send(const std::string &text);
+
+    std::vector<Cell> ring;
+    uint64_t mask;
+    std::atomic<uint64_t> head{0};  // next slot to fill
+    uint64_t tail = 0;              // next slot to drain (exporter thread only)
+    std::atomic<uint64_t> accepted{0}, consumed{0}, written_count{0}, dropped_count{0};
+    double start;                   // steady clock, seconds
+
+    std::atomic<bool> running{false};
+    bool csv = false;
+    int fd = -1;                    // socket (tcp targets)
+    std::string target_name;
+    std::unique_ptr<std::ostream> file;
+    bool failed = false;            // a write failed; later records are dropped
+    std::string line;               // formatting buffer
+
+    std::mutex lock;
+    std::condition_variable wake, drained;
+    bool stopping = false;
+    bool flush_requested = false;
+    std::thread worker;
+};
+
+} // namespace telemetry
+
+#endif
@@ -0,0 +1,182 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+// pool and worker index of the current thread (-1: not a worker)
+thread_local ThreadPool *current_pool = nullptr;
+thread_local int current_worker = -1;
+
+std::mutex shared_lock;
+std::shared_ptr<ThreadPool> shared_pool;
+
+int defaultThreads()
+{
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    return hw > 0 ? hw : 1;
+}
+} // namespace
+
+ThreadPool::ThreadPool(int threads)
+{
+    const int n = (threads > 0 ? threads : defaultThreads()) - 1;
+    for (int k = 0; k < n; ++k) queues.emplace_back(new Worker());
+    for (int k = 0; k < n; ++k) workers.emplace_back(&ThreadPool::workerLoop, this, k);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> g(sleep_lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto &t : workers) t.join();
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::shared()
+{
+    std::lock_guard<std::mutex> g(shared_lock);
+    if (!shared_pool) shared_pool = std::make_shared<ThreadPool>();
+    return shared_pool;
+}
+
+void ThreadPool::setSharedThreads(int threads)
+{
+    std::shared_ptr<ThreadPool> next = std::make_shared<ThreadPool>(threads);
+    std::shared_ptr<ThreadPool> prev;
+    {
+        std::lock_guard<std::mutex> g(shared_lock);
+        prev.swap(shared_pool);
+        shared_pool = next;
+    }
+    // prev (if last) joins its workers here, outside the lock
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::resolve(const std::shared_ptr<ThreadPool> &pool, int threads, std::shared_ptr<ThreadPool> &owned)
+{
+    if (pool) return pool;
+    if (threads > 0)
+    {
+        if (!owned || owned->size() != threads) owned = std::make_shared<ThreadPool>(threads);
+        return owned;
+    }
+    return shared();
+}
+
+void ThreadPool::runTask(const Task &t)
+{
+    Group &g = *t.group;
+    try
+    {
+        for (int i = g.next++; i < g.n; i = g.next++) (*g.f)(i);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lk(g.lock);
+        if (!g.error) g.error = std::current_exception();
+        g.next = g.n; // skip what is left
+    }
+    // under the lock, so the owner can't see 0 and free the group while we still use it
+    std::lock_guard<std::mutex> lk(g.lock);
+    if (g.pending.fetch_sub(1) == 1) g.done.notify_all();
+}
+
+bool ThreadPool::tryRun(int self)
+{
+    Task t;
+    bool found = false;
+    if (self >= 0)
+    {
+        // own tasks newest first (nested work), then steal the oldest of the others'
+        Worker &w = *queues[self];
+        std::lock_guard<std::mutex> g(w.lock);
+        if (!w.tasks.empty())
+        {
+            t = w.tasks.back();
+            w.tasks.pop_back();
+            found = true;
+        }
+    }
+    for (size_t k = 1; !found && k <= queues.size(); ++k)
+    {
+        Worker &w = *queues[(std::max(self, 0) + k) % queues.size()];
+        std::lock_guard<std::mutex> g(w.lock);
+        if (!w.tasks.empty())
+        {
+            t = w.tasks.front();
+            w.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        std::lock_guard<std::mutex> g(inject_lock);
+        if (!injected.empty())
+        {
+            t = injected.front();
+            injected.pop_front();
+            found = true;
+        }
+    }
+    if (!found) return false;
+    queued.fetch_sub(1);
+    runTask(t);
+    return true;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    current_pool = this;
+    current_worker = index;
+    for (;;)
+    {
+        if (tryRun(index)) continue;
+        std::unique_lock<std::mutex> lk(sleep_lock);
+        wake.wait(lk, [&] { return stop || queued.load() > 0; });
+        if (stop) return;
+    }
+}
+
+void ThreadPool::parallelFor(int n, const std::function<void(int)> &f, int max_parallel)
+{
+    if (n <= 0) return;
+    int runners = std::min(n, max_parallel > 0 ? std::min(max_parallel, size()) : size());
+    if (runners <= 1)
+    {
+        for (int i = 0; i < n; ++i) f(i);
+        return;
+    }
+
+    Group g;
+    g.n = n;
+    g.f = &f;
+    g.pending = runners;
+    const int self = current_pool == this ? current_worker : -1;
+    {
+        std::lock_guard<std::mutex> lk(self >= 0 ? queues[self]->lock : inject_lock);
+        std::deque<Task> &q = self >= 0 ? queues[self]->tasks : injected;
+        for (int k = 1; k < runners; ++k) q.push_back(Task{&g});
+    }
+    queued.fetch_add(runners - 1);
+    {
+        // a worker between its empty check and wait() holds this lock; taking it makes
+        // sure it sees the new count or gets the notification
+        std::lock_guard<std::mutex> lk(sleep_lock);
+    }
+    if (runners == 2) wake.notify_one();
+    else wake.notify_all();
+
+    // our share, then help with whatever is queued until every runner has finished
+    runTask(Task{&g});
+    while (g.pending.load() > 0)
+    {
+        if (tryRun(self)) continue;
+        std::unique_lock<std::mutex> lk(g.lock);
+        g.done.wait_for(lk, std::chrono::microseconds(200), [&] { return g.pending.load() == 0; });
+    }
+    std::lock_guard<std::mutex> lk(g.lock); // the last runner may still hold it
+    if (g.error) std::rethrow_exception(g.error);
+}
@@ -0,0 +1,91 @@
+#ifndef __thread_pool_h__
+#define __thread_pool_h__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Work-stealing thread pool shared by the parallel parts of the library: batch workers of
+the trainers, individuals of EvolutionEngine, sessions of InferenceServer and NEWNET
+construction. Passing one pool around (e.g. an EvolutionEngine hands its pool to the
+trainers of its individuals) keeps nested parallelism within the pool's threads instead
+of multiplying them.
+
+Every worker owns a deque: it pushes and pops its own tasks at the back and steals from
+the front of the others'. parallelFor() called from a worker pushes onto that worker's
+deque; from any other thread the tasks go to a shared queue. The caller then runs tasks
+itself until its own are done, so a nested parallelFor never blocks a worker (no
+deadlock) and never adds threads.
+
+A pool of size N has N - 1 workers; the calling thread is the N-th. shared() is the
+process-wide default (one thread per core) used by everything that is not given a pool.
+*/
+class ThreadPool
+{
+public:
+    // threads: total parallelism including the caller (< 1: one per core)
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // f(i) for every i < n, at most max_parallel (< 1: size()) at a time; indices are
+    // claimed in order by whichever thread is free. Returns when all are done and
+    // rethrows the first exception a call threw.
+    void parallelFor(int n, const std::function<void(int)> &f, int max_parallel = 0);
+
+    // process-wide pool; setSharedThreads() replaces it for later callers (holders of the
+    // previous one keep it)
+    static std::shared_ptr<ThreadPool> shared();
+    static void setSharedThreads(int threads);
+
+    // pool to use for a configured size: `pool` if set, else `threads` > 0 makes (and
+    // caches in `owned`) a private pool of that size, else shared()
+    static std::shared_ptr<ThreadPool> resolve(const std::shared_ptr<ThreadPool> &pool, int threads, std::shared_ptr<ThreadPool> &owned);
+
+private:
+    struct Group
+    {
+        std::atomic<int> pending{0};
+        std::atomic<int> next{0};
+        int n = 0;
+        const std::function<void(int)> *f = nullptr;
+        std::mutex lock; // guards error, signals done
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    struct Task
+    {
+        Group *group;
+    };
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(int index);
+    bool tryRun(int self); // run one queued task; false if none was found
+    static void runTask(const Task &t);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Worker>> queues; // one per worker
+    std::mutex inject_lock;
+    std::deque<Task> injected; // tasks from threads outside the pool
+
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<int> queued{0}; // tasks in any queue
+    bool stop = false;
+};
+
+#endif
@@ -0,0 +1,470 @@
+// Simulation microbenchmarks (glia_bench)
+// Times Glia::step() across sizes and input rates, input injection, per-episode trainer
+// cost, .net/.gnet load and save, and EvolutionEngine generations, and replays golden
+// reference traces against every simulation engine (engine_diff.h); writes one JSON
+// document so runs of different releases can be diffed.
+//
+//   glia_bench [--quick] [--out results.json] [--workdir DIR] [--seed N] [--filter NAME]
+//              [--examples DIR] [--diff NET[,SEQ] ...] [--diff-tol X]
+//              [--golden-out DIR] [--golden-in DIR]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <thread>
+
+#include "../arch/glia.h"
+#include "../arch/neuron.h"
+#include "../arch/input_sequence.h"
+#include "../train/trainer.h"
+#include "../train/training_config.h"
+#include "../train/gradient/rate_gd_trainer.h"
+#include "../evo/evolution_engine.h"
+#include "engine_diff.h"
+
+struct Args {
+    bool quick = false;           // smaller sizes and shorter timing windows (CI smoke run)
+    std::string out;              // JSON destination (default: stdout)
+    std::string workdir = ".";    // scratch .net/.gnet files, removed afterwards
+    unsigned int seed = 12345u;
+    std::string filter;           // only run benchmarks whose name contains this
+    // differential: networks with an optional .seq each (NET or NET,SEQ); default the
+    // example networks under `examples`, plus a generated one with random input
+    std::vector<std::string> diff_nets;
+    std::string examples = "examples";
+    float diff_tol = 1e-4f;       // relative membrane tolerance
+    std::string golden_out;       // write the reference traces here
+    std::string golden_in;        // compare against traces written by --golden-out instead
+};
+
+static bool parse_args(int argc, char** argv, Args &a) {
+    for (int i = 1; i < argc; ++i) {
+        std::string k = argv[i];
+        auto next = [&](std::string &out){ if (i+1>=argc) return false; out = argv[++i]; return true; };
+        if (k == "--quick") { a.quick = true; }
+        else if (k == "--out") { if (!next(a.out)) return false; }
+        else if (k == "--workdir") { if (!next(a.workdir)) return false; }
+        else if (k == "--seed") { std::string v; if (!next(v)) return false; a.seed = static_cast<unsigned int>(std::strtoul(v.c_str(), nullptr, 10)); }
+        else if (k == "--filter") { if (!next(a.filter)) return false; }
+        else if (k == "--diff") { std::string v; if (!next(v)) return false; a.diff_nets.push_back(v); }
+        else if (k == "--examples") { if (!next(a.examples)) return false; }
+        else if (k == "--diff-tol") { std::string v; if (!next(v)) return false; a.diff_tol = std::strtof(v.c_str(), nullptr); }
+        else if (k == "--golden-out") { if (!next(a.golden_out)) return false; }
+        else if (k == "--golden-in") { if (!next(a.golden_in)) return false; }
+        else return false;
+    }
+    return true;
+}
+
+typedef std::chrono::steady_clock Clock;
+static double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// One JSON result object: {"name": ..., "params": {...}, <metrics>}
+class Result {
+public:
+    explicit Result(const std::string &name) : name(name) {}
+    Result &param(const std::string &k, double v) { params.push_back(field(k, v)); return *this; }
+    Result &param(const std::string &k, const std::string &v) { params.push_back("\"" + k + "\": \"" + v + "\""); return *this; }
+    Result &metric(const std::string &k, double v) { metrics.push_back(field(k, v)); return *this; }
+    std::string json() const {
+        std::string s = "{\"name\": \"" + name + "\", \"params\": {";
+        for (size_t i = 0; i < params.size(); ++i) s += (i ? ", " : "") + params[i];
+        s += "}";
+        for (const auto &m : metrics) s += ", " + m;
+        return s + "}";
+    }
+private:
+    static std::string field(const std::string &k, double v) {
+        std::ostringstream os; os.precision(9); os << "\"" << k << "\": " << v; return os.str();
+    }
+    std::string name;
+    std::vector<std::string> params, metrics;
+};
+
+// Run body() repeatedly (after one untimed warmup call) until min_seconds have passed;
+// returns seconds per call
+template <class F>
+static double timePerCall(double min_seconds, F body) {
+    body();
+    long long calls = 0;
+    Clock::time_point t0 = Clock::now();
+    double elapsed = 0.0;
+    do { body(); ++calls; elapsed = secondsSince(t0); } while (elapsed < min_seconds);
+    return elapsed / static_cast<double>(calls);
+}
+
+struct NetShape { int S, H, O; };
+
+static std::string newnetText(const NetShape &n, unsigned int seed) {
+    std::ostringstream os;
+    os << "NEWNET S=" << n.S << " H=" << n.H << " O=" << n.O << "\n"
+       << "DENSITY S->H 0.6\nDENSITY H->H 0.1\nDENSITY H->O 0.6\n"
+       << "INIT he\nEXCIT_RATIO 0.8\nW_SCALE 50\n"
+       << "SEED " << seed << "\n"
+       << "THRESHOLDS S 100 H 40 O 45\nLEAK S 1.0 H 0.85 O 1.0\n";
+    return os.str();
+}
+
+static std::string writeNewnet(const Args &a, const NetShape &n, const std::string &tag) {
+    const std::string path = a.workdir + "/glia_bench_" + tag + ".net";
+    std::ofstream f(path.c_str());
+    f << newnetText(n, a.seed);
+    return f ? path : std::string();
+}
+
+// Poisson-style episode: each sensory neuron gets a supra-threshold input with probability
+// `rate` per tick
+static InputSequence randomSequence(const std::vector<std::string> &sensory, int ticks, double rate, std::mt19937 &rng) {
+    InputSequence seq;
+    std::bernoulli_distribution on(rate);
+    for (int t = 0; t < ticks; ++t)
+        for (const auto &id : sensory)
+            if (on(rng)) seq.addEvent(t, id, 150.0f);
+    return seq;
+}
+
+static std::vector<Trainer::EpisodeData> randomEpisodes(Glia &net, int count, int ticks, double rate, std::mt19937 &rng) {
+    std::vector<std::string> sensory = net.getSensoryNeuronIDs();
+    std::vector<Trainer::EpisodeData> out(count);
+    for (int i = 0; i < count; ++i) {
+        out[i].seq = randomSequence(sensory, ticks, rate, rng);
+        out[i].target_id = "O" + std::to_string(i % 2);
+    }
+    return out;
+}
+
+static TrainingConfig benchConfig(int ticks) {
+    TrainingConfig cfg;
+    cfg.warmup_ticks = ticks / 4;
+    cfg.decision_window = ticks - ticks / 4;
+    return cfg;
+}
+
+// ticks/s and synaptic events/s of Glia::step() with `rate` of the sensory neurons driven per tick
+static void benchStep(const Args &a, const std::string &net_path, const NetShape &shape, double rate, int threads, std::vector<Result> &out) {
+    Glia net; net.configureNetworkFromFile(net_path, false);
+    net.setStepThreads(threads);
+    CompiledNetwork *cn = net.getCompiled();
+    if (!cn) return;
+    const std::vector<int> &offs = cn->csr().row_offsets;
+    const int S = net.getSensoryCount();
+    std::mt19937 rng(a.seed);
+    std::bernoulli_distribution on(rate);
+    // pre-drawn input pattern, cycled, so drawing isn't part of the timing
+    const int pattern_ticks = 256;
+    std::vector<std::vector<int> > pattern(pattern_ticks);
+    for (auto &tick : pattern)
+        for (int h = 0; h < S; ++h) if (on(rng)) tick.push_back(h);
+    std::vector<float> values(S, 150.0f);
+
+    std::vector<uint64_t> mask;
+    long long ticks = 0, spikes = 0, events = 0;
+    const double secs = timePerCall(a.quick ? 0.2 : 1.0, [&]() {
+        const std::vector<int> &in = pattern[ticks % pattern_ticks];
+        net.injectSensoryBatch(in.data(), values.data(), static_cast<int>(in.size()));
+        net.step();
+        net.getFiredMask(mask);
+        for (size_t w = 0; w < mask.size(); ++w)
+            for (uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+                int b = 0; while (!((bits >> b) & 1)) ++b;
+                const int h = static_cast<int>(w * 64) + b;
+                ++spikes;
+                events += offs[h + 1] - offs[h];
+            }
+        ++ticks;
+    });
+    const double per_tick_events = ticks ? static_cast<double>(events) / ticks : 0.0;
+    out.push_back(Result("step")
+        .param("sensory", shape.S).param("hidden", shape.H).param("outputs", shape.O)
+        .param("input_rate", rate).param("edges", cn->numEdges()).param("threads", threads)
+        .metric("ticks_per_s", 1.0 / secs)
+        .metric("synaptic_events_per_s", per_tick_events / secs)
+        .metric("spikes_per_tick", ticks ? static_cast<double>(spikes) / ticks : 0.0));
+}
+
+// InputSequence injection: compiling an episode to handles, injecting it by handle, and
+// the per-tick ID lookup path (getCurrentInputs + injectSensory by ID)
+static void benchInput(const Args &a, const std::string &net_path, const NetShape &shape, std::vector<Result> &out) {
+    Glia net; net.configureNetworkFromFile(net_path, false);
+    const std::vector<std::string> sensory = net.getSensoryNeuronIDs();
+    const int ticks = 100; const double rate = 0.1;
+    std::mt19937 rng(a.seed);
+    InputSequence seq = randomSequence(sensory, ticks, rate, rng);
+    long long n_events = 0;
+    for (const auto &e : seq.getEvents()) n_events += static_cast<long long>(e.inputs.size());
+    const double min_s = a.quick ? 0.1 : 0.5;
+
+    CompiledInputSequence compiled;
+    const double compile_s = timePerCall(min_s, [&]() { compiled.compile(seq, sensory); });
+    const double batch_s = timePerCall(min_s, [&]() {
+        for (int t = 0; t < ticks; ++t) {
+            const CompiledInputSequence::Span in = compiled.at(t);
+            net.injectSensoryBatch(in.handles, in.values, in.size);
+        }
+    });
+    const double by_id_s = timePerCall(min_s, [&]() {
+        seq.reset();
+        for (int t = 0; t < ticks; ++t) {
+            for (const auto &kv : seq.getCurrentInputs()) net.injectSensory(kv.first, kv.second);
+            seq.advance();
+        }
+    });
+    const double per_event = n_events ? 1e9 / static_cast<double>(n_events) : 0.0;
+    out.push_back(Result("input_injection")
+        .param("sensory", shape.S).param("ticks", ticks).param("input_rate", rate).param("events", static_cast<double>(n_events))
+        .metric("compile_ns_per_event", compile_s * per_event)
+        .metric("inject_batch_ns_per_event", batch_s * per_event)
+        .metric("inject_by_id_ns_per_event", by_id_s * per_event));
+}
+
+// Trainer::computeEpisodeDelta and one RateGDTrainer episode (trainBatch of one, i.e.
+// computeEpisodeGrad plus the optimizer step) per call
+static void benchEpisodes(const Args &a, const std::string &net_path, const NetShape &shape, std::vector<Result> &out) {
+    const int ticks = 100;
+    const TrainingConfig cfg = benchConfig(ticks);
+    const double min_s = a.quick ? 0.2 : 1.0;
+    {
+        Glia net; net.configureNetworkFromFile(net_path, false);
+        std::mt19937 rng(a.seed);
+        std::vector<Trainer::EpisodeData> eps = randomEpisodes(net, 1, ticks, 0.1, rng);
+        Trainer tr(net);
+        tr.refreshEdges();
+        EpisodeMetrics m;
+        const double s = timePerCall(min_s, [&]() { tr.computeEpisodeDelta(eps[0].seq, cfg, eps[0].target_id, &m); });
+        out.push_back(Result("hebbian_episode_delta")
+            .param("sensory", shape.S).param("hidden", shape.H).param("ticks", ticks).param("edges", net.getConnectionCount())
+            .metric("ms_per_episode", s * 1e3));
+    }
+    {
+        Glia net; net.configureNetworkFromFile(net_path, false);
+        std::mt19937 rng(a.seed);
+        std::vector<Trainer::EpisodeData> eps = randomEpisodes(net, 1, ticks, 0.1, rng);
+        RateGDTrainer tr(net);
+        const double s = timePerCall(min_s, [&]() { tr.trainBatch(eps, cfg); });
+        out.push_back(Result("rate_gd_episode_grad")
+            .param("sensory", shape.S).param("hidden", shape.H).param("ticks", ticks).param("edges", net.getConnectionCount())
+            .metric("ms_per_episode", s * 1e3));
+    }
+}
+
+// save and load of the text .net and binary .gnet formats
+static void benchFiles(const Args &a, const std::string &net_path, const NetShape &shape, std::vector<Result> &out) {
+    Glia net; net.configureNetworkFromFile(net_path, false);
+    const double min_s = a.quick ? 0.1 : 0.5;
+    const char *exts[] = { ".net", ".gnet" };
+    for (const char *ext : exts) {
+        const std::string path = a.workdir + "/glia_bench_io" + ext;
+        const double save_s = timePerCall(min_s, [&]() { net.saveNetworkToFile(path); });
+        const double load_s = timePerCall(min_s, [&]() { Glia g; g.configureNetworkFromFile(path, false); });
+        std::ifstream f(path.c_str(), std::ios::binary | std::ios::ate);
+        const double bytes = f ? static_cast<double>(f.tellg()) : 0.0;
+        f.close();
+        std::remove(path.c_str());
+        out.push_back(Result("file_io")
+            .param("format", std::string(ext + 1)).param("sensory", shape.S).param("hidden", shape.H)
+            .param("edges", net.getConnectionCount()).param("bytes", bytes)
+            .metric("save_ms", save_s * 1e3).metric("load_ms", load_s * 1e3));
+    }
+}
+
+// EvolutionEngine wall time per generation
+static void benchEvolution(const Args &a, const std::string &net_path, const NetShape &shape, std::vector<Result> &out) {
+    Glia probe; probe.configureNetworkFromFile(net_path, false);
+    std::mt19937 rng(a.seed);
+    const int ticks = 60;
+    std::vector<Trainer::EpisodeData> train = randomEpisodes(probe, 8, ticks, 0.1, rng);
+    std::vector<Trainer::EpisodeData> val = randomEpisodes(probe, 4, ticks, 0.1, rng);
+    TrainingConfig cfg = benchConfig(ticks);
+    EvolutionEngine::Config ec;
+    ec.population = 8; ec.elite = 2; ec.parents_pool = 4; ec.train_epochs = 1;
+    ec.generations = a.quick ? 2 : 4;
+    ec.seed = a.seed;
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    ec.threads = hw > 0 ? hw : 1;
+
+    std::vector<double> gen_s;
+    Clock::time_point last;
+    EvolutionEngine::Callbacks cbs;
+    cbs.on_generation = [&](int, const EvolutionEngine::NetSnapshot &, const EvoMetrics &) {
+        gen_s.push_back(secondsSince(last));
+        last = Clock::now();
+    };
+    EvolutionEngine engine(net_path, train, val, cfg, ec, cbs);
+    last = Clock::now();
+    engine.run();
+    if (gen_s.empty()) return;
+    double sum = 0.0;
+    for (double s : gen_s) sum += s;
+    out.push_back(Result("evolution_generation")
+        .param("sensory", shape.S).param("hidden", shape.H).param("population", ec.population)
+        .param("train_episodes", static_cast<double>(train.size())).param("threads", ec.threads)
+        .metric("generations", static_cast<double>(gen_s.size()))
+        .metric("s_per_generation", sum / static_cast<double>(gen_s.size())));
+}
+
+// Golden-trace check of one network: the reference engine's spikes and membranes per tick
+// (or a trace saved by --golden-out) against every other engine of this build, with the
+// first divergent tick and the speedup over the reference side by side
+static void benchDifferential(const Args &a, const std::string &label, const std::string &net_path, const std::string &seq_path,
+                              std::vector<Result> &out, std::vector<std::string> &table) {
+    Glia net;
+    net.setBuildSeed(a.seed);
+    net.configureNetworkFromFile(net_path, false);
+    if (net.getNeuronCount() == 0) { std::cerr << "differential: cannot load " << net_path << "\n"; return; }
+    const std::vector<std::string> sensory = net.getSensoryNeuronIDs();
+    InputSequence seq;
+    int ticks = a.quick ? 100 : 300;
+    if (!seq_path.empty()) {
+        if (!seq.loadFromFile(seq_path)) return;
+        ticks = seq.getMaxTick() + 1 + 50; // and a tail to watch the network settle
+    } else {
+        std::mt19937 rng(a.seed);
+        seq = randomSequence(sensory, ticks, 0.1, rng);
+    }
+    CompiledInputSequence in;
+    in.compile(seq, sensory);
+
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<std::unique_ptr<engine_diff::Engine>> engines = engine_diff::makeEngines(net, hw);
+    std::string err;
+    engine_diff::Trace golden;
+    const std::string trace_file = "/" + label + ".trace";
+    if (!a.golden_in.empty()) {
+        if (!engine_diff::load(a.golden_in + trace_file, golden, err)) { std::cerr << "differential: " << err << "\n"; return; }
+    } else {
+        golden = engine_diff::record(*engines[0], in, ticks);
+    }
+    if (!a.golden_out.empty() && !engine_diff::save(a.golden_out + trace_file, golden, err))
+        std::cerr << "differential: " << err << "\n";
+
+    const double min_s = a.quick ? 0.1 : 0.5;
+    double ref_s = 0.0;
+    for (auto &e : engines) {
+        const engine_diff::Divergence d = engine_diff::compare(golden, engine_diff::record(*e, in, ticks), a.diff_tol);
+        const double s = engine_diff::timeRun(*e, in, ticks, min_s);
+        if (e == engines.front()) ref_s = s;
+        const double speedup = s > 0.0 ? ref_s / s : 0.0;
+        out.push_back(Result("differential")
+            .param("net", label).param("engine", e->name()).param("exact", e->exact() ? 1.0 : 0.0)
+            .param("neurons", net.getNeuronCount()).param("edges", net.getConnectionCount()).param("ticks", ticks)
+            .metric("first_spike_divergence_tick", d.shape_mismatch ? -2.0 : d.first_spike_tick)
+            .metric("spike_mismatches", static_cast<double>(d.spike_mismatches))
+            .metric("first_value_divergence_tick", d.first_value_tick)
+            .metric("max_value_diff", d.values_compared ? d.max_value_diff : -1.0)
+            .metric("ms_per_run", s * 1e3)
+            .metric("speedup", speedup));
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-18s %-16s %10s %10s %10.3g %10.3f %8.2fx%s", label.c_str(), e->name().c_str(),
+                      d.shape_mismatch ? "shape" : d.first_spike_tick < 0 ? "-" : std::to_string(d.first_spike_tick).c_str(),
+                      !d.values_compared ? "n/a" : d.first_value_tick < 0 ? "-" : std::to_string(d.first_value_tick).c_str(),
+                      d.values_compared ? d.max_value_diff : 0.0, s * 1e3, speedup, e->exact() ? "" : " (approx.)");
+        table.push_back(line);
+    }
+}
+
+int main(int argc, char** argv) {
+    Args a;
+    if (!parse_args(argc, argv, a)) {
+        std::cerr << "Usage: glia_bench [--quick] [--out results.json] [--workdir DIR] [--seed N] [--filter NAME]\n"
+                  << "                  [--examples DIR] [--diff NET[,SEQ] ...] [--diff-tol X] [--golden-out DIR] [--golden-in DIR]\n";
+        return 2;
+    }
+    auto enabled = [&](const char *name) { return a.filter.empty() || std::string(name).find(a.filter) != std::string::npos; };
+
+    std::vector<NetShape> sizes;
+    if (a.quick) { NetShape s1 = {32, 128, 10}, s2 = {128, 512, 10}; sizes.push_back(s1); sizes.push_back(s2); }
+    else { NetShape s1 = {64, 256, 10}, s2 = {256, 1024, 10}, s3 = {1024, 4096, 10}; sizes.push_back(s1); sizes.push_back(s2); sizes.push_back(s3); }
+    const double rates[] = { 0.02, 0.1, 0.3 };
+    const NetShape mid = sizes[sizes.size() / 2];
+
+    // the library reports loads, saves and generations on stdout; keep that out of the JSON
+    std::ostringstream sink;
+    std::streambuf *cout_buf = std::cout.rdbuf(sink.rdbuf());
+
+    std::vector<Result> results;
+    std::vector<std::string> scratch;
+    auto netFor = [&](const NetShape &s) {
+        const std::string path = writeNewnet(a, s, std::to_string(s.S) + "x" + std::to_string(s.H));
+        if (path.empty()) { std::cerr << "Cannot write to --workdir " << a.workdir << "\n"; std::exit(1); }
+        scratch.push_back(path);
+        return path;
+    };
+
+    if (enabled("step"))
+        for (const NetShape &s : sizes) {
+            const std::string path = netFor(s);
+            for (double r : rates) benchStep(a, path, s, r, 1, results);
+        }
+    // intra-step threads on the largest network
+    const int hw = static_cast<int>(std::thread::hardware_concurrency());
+    if (enabled("step") && hw > 1) {
+        const NetShape big = sizes.back();
+        benchStep(a, netFor(big), big, 0.1, hw, results);
+    }
+    const std::string mid_path = netFor(mid);
+    if (enabled("input_injection")) benchInput(a, mid_path, mid, results);
+    if (enabled("episode")) benchEpisodes(a, mid_path, mid, results);
+    if (enabled("file_io")) benchFiles(a, mid_path, mid, results);
+    if (enabled("evolution")) { const NetShape small = sizes[0]; benchEvolution(a, netFor(small), small, results); }
+    std::vector<std::string> diff_table;
+    if (enabled("differential")) {
+        std::vector<std::pair<std::string, std::string> > nets; // (net, seq)
+        for (const auto &d : a.diff_nets) {
+            const size_t comma = d.find(',');
+            nets.push_back(comma == std::string::npos ? std::make_pair(d, std::string()) : std::make_pair(d.substr(0, comma), d.substr(comma + 1)));
+        }
+        if (nets.empty()) {
+            const std::string &ex = a.examples;
+            nets.push_back(std::make_pair(ex + "/3class/nets/3class_network.net", ex + "/3class/seqs/test_class1_10pct.seq"));
+            nets.push_back(std::make_pair(ex + "/seq_digits_poisson/data/digits_default.net",
+                                          ex + "/seq_digits_poisson/data/test/sklearn_digits_poisson_data_000000.seq"));
+            nets.push_back(std::make_pair(ex + "/mini-world/nets/mini_world_newnet.net", ex + "/mini-world/data/run1/seq/clip_00000.seq"));
+            // examples that aren't there (e.g. run outside the repository) are skipped
+            for (size_t i = 0; i < nets.size();) {
+                if (std::ifstream(nets[i].first.c_str()) && std::ifstream(nets[i].second.c_str())) ++i;
+                else nets.erase(nets.begin() + i);
+            }
+            nets.push_back(std::make_pair(mid_path, std::string()));
+        }
+        for (const auto &n : nets) {
+            std::string label = n.first.substr(n.first.find_last_of("/\\") + 1);
+            label = label.substr(0, label.find('.'));
+            benchDifferential(a, label, n.first, n.second, results, diff_table);
+        }
+    }
+    for (const auto &p : scratch) std::remove(p.c_str());
+    std::cout.rdbuf(cout_buf);
+    if (!diff_table.empty()) {
+        // first divergent ticks: "-" none, "n/a" no membranes in float units
+        char head[256];
+        std::snprintf(head, sizeof(head), "%-18s %-16s %10s %10s %10s %10s %9s", "net", "engine", "spike_div", "value_div", "max|dv|", "ms/run", "speedup");
+        std::cerr << head << "\n";
+        for (const auto &l : diff_table) std::cerr << l << "\n";
+    }
+
+    std::ostringstream js;
+    js << "{\n  \"benchmark\": \"glia_bench\",\n  \"version\": 1,\n"
+       << "  \"quick\": " << (a.quick ? "true" : "false") << ",\n"
+       << "  \"seed\": " << a.seed << ",\n"
+       << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+       << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+        js << "    " << results[i].json() << (i + 1 < results.size() ? ",\n" : "\n");
+    js << "  ]\n}\n";
+
+    if (a.out.empty()) { std::cout << js.str(); return 0; }
+    std::ofstream f(a.out.c_str());
+    f << js.str();
+    if (!f) { std::cerr << "Cannot write " << a.out << "\n"; return 1; }
+    std::cerr << "Wrote " << results.size() << " results to " << a.out << "\n";
+    return 0;
+}
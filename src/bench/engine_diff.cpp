@@ -0,0 +1,306 @@
+#include "engine_diff.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "../arch/glia.h"
+#include "../arch/neuron.h"
+#include "../arch/compiled_network.h"
+#include "../arch/batched_network.h"
+#include "../serve/inference_server.h"
+
+namespace engine_diff
+{
+
+namespace
+{
+
+const char trace_magic[4] = {'G', 'T', 'R', 'C'};
+const uint32_t trace_version = 1;
+
+struct TraceHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t ticks;
+    uint32_t neurons;
+    uint32_t has_values;
+    uint32_t reserved;
+};
+
+// a Glia copy in one step mode (Glia::step(), as callers drive it)
+class GliaEngine : public Engine
+{
+public:
+    GliaEngine(const std::string &name, const Glia &src, Glia::StepMode mode) : Engine(name), net(src)
+    {
+        net.setStepMode(mode);
+    }
+    Glia &network() { return net; }
+
+    int size() const override { return net.getNeuronCount(); }
+    void reset() override { net.resetState(); }
+    void inject(const int *handles, const float *values, int n) override { net.injectSensoryBatch(handles, values, n); }
+    void step() override { net.step(); }
+    void fired(uint8_t *out) const override
+    {
+        net.getFiredMask(mask);
+        const int n = net.getNeuronCount();
+        for (int h = 0; h < n; ++h) out[h] = static_cast<uint8_t>((mask[h >> 6] >> (h & 63)) & 1u);
+    }
+    bool values(float *out) const override
+    {
+        // Neuron::getValue() reads the compiled arrays while they are bound
+        int h = 0;
+        const_cast<Glia &>(net).forEachNeuron([&](Neuron &n) { out[h++] = n.getValue(); });
+        return true;
+    }
+
+private:
+    Glia net;
+    mutable std::vector<uint64_t> mask;
+};
+
+// lane 0 of a one-lane BatchedNetwork, rebuilt from a copy of the network kept at rest
+class BatchedEngine : public Engine
+{
+public:
+    BatchedEngine(const std::string &name, const Glia &src) : Engine(name), net(src) {}
+    bool init()
+    {
+        CompiledNetwork *cn = net.getCompiled();
+        return cn && batch.build(*cn, 1);
+    }
+
+    int size() const override { return batch.size(); }
+    void reset() override { batch.build(*net.getCompiled(), 1); }
+    void inject(const int *handles, const float *values, int n) override
+    {
+        for (int k = 0; k < n; ++k) batch.inject(handles[k], 0, values[k]);
+    }
+    void step() override { batch.step(); }
+    void fired(uint8_t *out) const override
+    {
+        for (int i = 0; i < batch.size(); ++i) out[i] = batch.fired(i, 0) ? 1 : 0;
+    }
+    bool values(float *out) const override
+    {
+        for (int i = 0; i < batch.size(); ++i) out[i] = batch.value(i, 0);
+        return true;
+    }
+
+private:
+    Glia net; // never stepped
+    BatchedNetwork batch;
+};
+
+// an InferenceSession on a model built from the network (quantized if bits > 0)
+class InferenceEngine : public Engine
+{
+public:
+    InferenceEngine(const std::string &name, std::shared_ptr<const InferenceModel> model)
+        : Engine(name, model->weightBits() == 0), n(model->size()), session(model, OutputDetectorConfig(), 1) {}
+
+    int size() const override { return n; }
+    void reset() override { session.reset(); }
+    void inject(const int *handles, const float *values, int count) override { session.inject(handles, values, count); }
+    void step() override { session.step(); }
+    void fired(uint8_t *out) const override { std::memcpy(out, session.fired(), static_cast<size_t>(n)); }
+    bool values(float *) const override { return false; }
+
+private:
+    int n;
+    InferenceSession session;
+};
+
+void runTicks(Engine &e, const CompiledInputSequence &in, int ticks)
+{
+    for (int t = 0; t < ticks; ++t)
+    {
+        const CompiledInputSequence::Span s = in.at(t);
+        if (s.size) e.inject(s.handles, s.values, s.size);
+        e.step();
+    }
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<Engine>> makeEngines(Glia &net, int step_threads)
+{
+    std::vector<std::unique_ptr<Engine>> out;
+    net.resetState();
+    out.emplace_back(new GliaEngine("reference", net, Glia::StepMode::Reference));
+
+    CompiledNetwork *cn = net.getCompiled();
+    if (!cn) return out;
+
+    GliaEngine *scalar = new GliaEngine("compiled_scalar", net, Glia::StepMode::Compiled);
+    scalar->network().setSimdLevel(membrane::SimdLevel::Scalar);
+    scalar->network().setDenseProjections(0.0f);
+    out.emplace_back(scalar);
+
+    GliaEngine *csr = new GliaEngine("compiled_csr", net, Glia::StepMode::Compiled);
+    csr->network().setDenseProjections(0.0f);
+    out.emplace_back(csr);
+    out.emplace_back(new GliaEngine("compiled", net, Glia::StepMode::Compiled));
+    if (step_threads > 1)
+    {
+        GliaEngine *mt = new GliaEngine("compiled_threads", net, Glia::StepMode::Compiled);
+        mt->network().setStepThreads(step_threads);
+        out.emplace_back(mt);
+    }
+    out.emplace_back(new GliaEngine("event_driven", net, Glia::StepMode::EventDriven));
+
+    if (!cn->basicDynamics()) return out;
+    std::unique_ptr<BatchedEngine> batched(new BatchedEngine("batched", net));
+    if (batched->init()) out.emplace_back(batched.release());
+
+    const int bits[] = {0, 16, 8};
+    for (int b : bits)
+    {
+        std::shared_ptr<InferenceModel> model = std::make_shared<InferenceModel>();
+        if (!model->build(net)) break;
+        if (b > 0 && !model->quantize(b)) continue;
+        out.emplace_back(new InferenceEngine(b > 0 ? "inference_int" + std::to_string(b) : std::string("inference"), model));
+    }
+    return out;
+}
+
+Trace record(Engine &e, const CompiledInputSequence &in, int ticks)
+{
+    e.reset();
+    Trace t;
+    t.ticks = std::max(0, ticks);
+    t.neurons = e.size();
+    const size_t n = static_cast<size_t>(t.neurons);
+    t.fired.assign(static_cast<size_t>(t.ticks) * n, 0);
+    t.value.assign(static_cast<size_t>(t.ticks) * n, 0.0f);
+    bool has_values = true;
+    for (int k = 0; k < t.ticks; ++k)
+    {
+        const CompiledInputSequence::Span s = in.at(k);
+        if (s.size) e.inject(s.handles, s.values, s.size);
+        e.step();
+        e.fired(t.fired.data() + k * n);
+        if (has_values) has_values = e.values(t.value.data() + k * n);
+    }
+    if (!has_values) t.value.clear();
+    return t;
+}
+
+double timeRun(Engine &e, const CompiledInputSequence &in, int ticks, double min_seconds)
+{
+    typedef std::chrono::steady_clock Clock;
+    double total = 0.0;
+    long long runs = 0;
+    do
+    {
+        e.reset();
+        const Clock::time_point t0 = Clock::now();
+        runTicks(e, in, ticks);
+        total += std::chrono::duration<double>(Clock::now() - t0).count();
+        ++runs;
+    } while (total < min_seconds);
+    return total / static_cast<double>(runs);
+}
+
+Divergence compare(const Trace &golden, const Trace &t, float tolerance)
+{
+    Divergence d;
+    if (golden.ticks != t.ticks || golden.neurons != t.neurons)
+    {
+        d.shape_mismatch = true;
+        return d;
+    }
+    const int n = golden.neurons;
+    d.values_compared = !golden.value.empty() && !t.value.empty();
+    for (int k = 0; k < golden.ticks; ++k)
+    {
+        const size_t row = static_cast<size_t>(k) * n;
+        for (int i = 0; i < n; ++i)
+        {
+            if (golden.fired[row + i] == t.fired[row + i]) continue;
+            ++d.spike_mismatches;
+            if (d.first_spike_tick < 0) { d.first_spike_tick = k; d.first_spike_neuron = i; }
+        }
+        if (!d.values_compared || (d.first_spike_tick >= 0 && d.first_spike_tick < k)) continue;
+        for (int i = 0; i < n; ++i)
+        {
+            const float a = golden.value[row + i], b = t.value[row + i];
+            const float diff = std::fabs(a - b);
+            if (d.first_spike_tick < 0) d.max_value_diff = std::max(d.max_value_diff, diff);
+            if (d.first_value_tick < 0 && diff > tolerance * std::max(1.0f, std::fabs(a)))
+            {
+                d.first_value_tick = k;
+                d.first_value_neuron = i;
+            }
+        }
+    }
+    return d;
+}
+
+bool save(const std::string &path, const Trace &t, std::string &error)
+{
+    TraceHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, trace_magic, 4);
+    h.version = trace_version;
+    h.ticks = static_cast<uint32_t>(t.ticks);
+    h.neurons = static_cast<uint32_t>(t.neurons);
+    h.has_values = t.value.empty() ? 0u : 1u;
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char *>(t.fired.data()), static_cast<std::streamsize>(t.fired.size()));
+    if (h.has_values)
+        out.write(reinterpret_cast<const char *>(t.value.data()), static_cast<std::streamsize>(t.value.size() * sizeof(float)));
+    if (!out)
+    {
+        error = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool load(const std::string &path, Trace &t, std::string &error)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in.is_open())
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    TraceHeader h;
+    if (!in.read(reinterpret_cast<char *>(&h), sizeof(h)) || std::memcmp(h.magic, trace_magic, 4) != 0)
+    {
+        error = path + " is not a trace file";
+        return false;
+    }
+    if (h.version != trace_version)
+    {
+        error = path + ": unsupported trace version " + std::to_string(h.version);
+        return false;
+    }
+    t.ticks = static_cast<int>(h.ticks);
+    t.neurons = static_cast<int>(h.neurons);
+    const size_t cells = static_cast<size_t>(h.ticks) * h.neurons;
+    t.fired.assign(cells, 0);
+    t.value.assign(h.has_values ? cells : 0, 0.0f);
+    in.read(reinterpret_cast<char *>(t.fired.data()), static_cast<std::streamsize>(cells));
+    if (h.has_values) in.read(reinterpret_cast<char *>(t.value.data()), static_cast<std::streamsize>(cells * sizeof(float)));
+    if (!in)
+    {
+        error = path + " is truncated";
+        return false;
+    }
+    return true;
+}
+
+} // namespace engine_diff
@@ -0,0 +1,107 @@
+#ifndef __engine_diff_h__
+#define __engine_diff_h__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../arch/input_sequence.h"
+
+class Glia;
+
+/*
+Differential checks of the simulation engines against the per-object reference loop
+(Glia::StepMode::Reference, Neuron::tick()). A Trace is the fired flags and membrane
+values of every neuron after every tick of one input sequence; the reference run's trace
+is the golden one, and every other engine replays the same inputs from the same state and
+is compared tick by tick: spikes must match exactly, membranes within a relative tolerance
+(kernels sum inputs in other orders, so they differ by float rounding). Once one spike
+differs everything after it may, so the first divergent tick is what is reported.
+
+Golden traces can be saved and loaded, to compare a build's engines (its reference
+included) against traces recorded by another build.
+
+    std::vector<std::unique_ptr<engine_diff::Engine>> engines = engine_diff::makeEngines(net, 4);
+    CompiledInputSequence in; in.compile(seq, net.getSensoryNeuronIDs());
+    engine_diff::Trace golden = engine_diff::record(*engines[0], in, ticks);
+    for (auto &e : engines)
+        engine_diff::Divergence d = engine_diff::compare(golden, engine_diff::record(*e, in, ticks), 1e-4f);
+*/
+namespace engine_diff
+{
+
+struct Trace
+{
+    int ticks = 0;
+    int neurons = 0;
+    std::vector<uint8_t> fired; // [tick][neuron], handle order
+    std::vector<float> value;   // [tick][neuron]; empty if the engine can't report membranes
+};
+
+// where a trace first departs from the golden one; ticks are -1 where it doesn't
+struct Divergence
+{
+    int first_spike_tick = -1;
+    int first_spike_neuron = -1;
+    long long spike_mismatches = 0; // (tick, neuron) pairs whose fired flags differ
+    int first_value_tick = -1;      // first tick a membrane is off by more than the tolerance
+    int first_value_neuron = -1;
+    float max_value_diff = 0.0f;    // largest |difference| before the first spike divergence
+    bool values_compared = false;   // both traces had membranes
+    bool shape_mismatch = false;    // different tick or neuron counts: nothing compared
+};
+
+// One simulation engine on one network, started from the network's state at rest
+class Engine
+{
+public:
+    virtual ~Engine() {}
+    const std::string &name() const { return label; }
+    // expected to match the reference (fixed-point engines aren't)
+    bool exact() const { return is_exact; }
+    // neurons, in handle order
+    virtual int size() const = 0;
+
+    // back to the initial state
+    virtual void reset() = 0;
+    // stage input for the next tick into sensory handles
+    virtual void inject(const int *handles, const float *values, int n) = 0;
+    virtual void step() = 0;
+    // fired flags of the last tick, one byte per neuron in handle order
+    virtual void fired(uint8_t *out) const = 0;
+    // membranes after the last tick; false if the engine has none in float units
+    virtual bool values(float *out) const = 0;
+
+protected:
+    explicit Engine(const std::string &name, bool exact = true) : label(name), is_exact(exact) {}
+
+private:
+    std::string label;
+    bool is_exact;
+};
+
+// The engines of this build on copies of `net`: reference first, then compiled_scalar
+// (scalar kernel, CSR delivery only), compiled_csr, compiled (default: widest kernel and
+// dense projections), compiled_threads (if step_threads > 1), event_driven, batched (one
+// BatchedNetwork lane), inference (InferenceSession) and inference_int16/_int8 (fixed
+// point; spikes only, and not expected to match exactly). Engines the network can't run
+// (e.g. it can't be compiled) are left out. `net` is put at rest.
+std::vector<std::unique_ptr<Engine>> makeEngines(Glia &net, int step_threads);
+
+// reset() and run `ticks` ticks of `in`, recording every tick
+Trace record(Engine &e, const CompiledInputSequence &in, int ticks);
+// reset() and run `ticks` ticks of `in` until min_seconds have passed (at least once);
+// seconds per run, resets not counted
+double timeRun(Engine &e, const CompiledInputSequence &in, int ticks, double min_seconds);
+
+// membranes match if |a - b| <= tolerance * max(1, |a|)
+Divergence compare(const Trace &golden, const Trace &t, float tolerance);
+
+// binary trace file; false (with `error` set) on failure
+bool save(const std::string &path, const Trace &t, std::string &error);
+bool load(const std::string &path, Trace &t, std::string &error);
+
+} // namespace engine_diff
+
+#endif
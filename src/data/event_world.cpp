@@ -0,0 +1,468 @@
+#include "event_world.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "spike_dataset.h"
+
+namespace world
+{
+
+const char *name(Polarity p)
+{
+    switch (p)
+    {
+    case Polarity::On: return "on";
+    case Polarity::Off: return "off";
+    default: return "both";
+    }
+}
+
+bool parsePolarity(const std::string &s, Polarity &out)
+{
+    if (s == "both") out = Polarity::Both;
+    else if (s == "on") out = Polarity::On;
+    else if (s == "off") out = Polarity::Off;
+    else return false;
+    return true;
+}
+
+// =====================================================================================
+// Settings
+// =====================================================================================
+
+namespace
+{
+
+bool parseNumber(const std::string &s, double &out)
+{
+    if (s.empty()) return false;
+    char *end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return end && *end == '\0' && std::isfinite(out);
+}
+
+bool parseInt(const std::string &s, long long &out)
+{
+    double d;
+    if (!parseNumber(s, d) || d != std::floor(d) || std::fabs(d) > 9e15) return false;
+    out = static_cast<long long>(d);
+    return true;
+}
+
+// A flat JSON object's members as (key, value text) pairs: strings unescaped, other
+// values (numbers, true, false, null) as written
+bool parseFlatObject(const std::string &text, std::vector<std::pair<std::string, std::string>> &out, std::string &error)
+{
+    size_t i = 0;
+    auto skip = [&]() { while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) ++i; };
+    auto string = [&](std::string &s) {
+        s.clear();
+        for (++i; i < text.size() && text[i] != '"'; ++i)
+        {
+            if (text[i] == '\\' && i + 1 < text.size())
+            {
+                const char c = text[++i];
+                s += c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+            }
+            else
+            {
+                s += text[i];
+            }
+        }
+        if (i >= text.size()) return false;
+        ++i;
+        return true;
+    };
+
+    skip();
+    if (i >= text.size() || text[i] != '{')
+    {
+        error = "expected a JSON object";
+        return false;
+    }
+    ++i;
+    for (;;)
+    {
+        skip();
+        if (i < text.size() && text[i] == '}') return true;
+        std::string key, value;
+        if (i >= text.size() || text[i] != '"' || !string(key))
+        {
+            error = "expected a key at offset " + std::to_string(i);
+            return false;
+        }
+        skip();
+        if (i >= text.size() || text[i] != ':')
+        {
+            error = "expected ':' after \"" + key + "\"";
+            return false;
+        }
+        ++i;
+        skip();
+        if (i < text.size() && text[i] == '"')
+        {
+            if (!string(value))
+            {
+                error = "unterminated string for \"" + key + "\"";
+                return false;
+            }
+        }
+        else
+        {
+            const size_t start = i;
+            while (i < text.size() && text[i] != ',' && text[i] != '}' && !std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+            value = text.substr(start, i - start);
+            if (value.empty() || value[0] == '[' || value[0] == '{')
+            {
+                error = "\"" + key + "\" is not a number, string or literal";
+                return false;
+            }
+        }
+        out.push_back(std::make_pair(key, value));
+        skip();
+        if (i < text.size() && text[i] == ',')
+        {
+            ++i;
+            continue;
+        }
+        if (i < text.size() && text[i] == '}') return true;
+        error = "expected ',' or '}' after \"" + key + "\"";
+        return false;
+    }
+}
+
+std::string quoted(const std::string &s)
+{
+    std::string q = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\') q += '\\';
+        q += c;
+    }
+    return q + "\"";
+}
+
+std::string number(double x, int digits)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.*g", digits, x);
+    std::string s = buf;
+    if (s.find_first_of(".eEn") == std::string::npos) s += ".0"; // a float, as json.dump writes it
+    return s;
+}
+
+} // namespace
+
+bool setOption(WorldConfig &cfg, const std::string &key_in, const std::string &value, std::string &error)
+{
+    std::string key = key_in;
+    std::replace(key.begin(), key.end(), '-', '_');
+    double d = 0.0;
+    long long n = 0;
+    auto real = [&](double lo) {
+        if (!parseNumber(value, d) || d < lo) error = key + ": expected a number >= " + number(lo, 6) + ", got '" + value + "'";
+        return error.empty();
+    };
+    auto integer = [&](long long lo) {
+        if (!parseInt(value, n) || n < lo) error = key + ": expected an integer >= " + std::to_string(lo) + ", got '" + value + "'";
+        return error.empty();
+    };
+    error.clear();
+
+    if (key == "seed") { if (integer(0)) cfg.seed = static_cast<uint64_t>(n); }
+    else if (key == "clips") { if (integer(0)) cfg.clips = static_cast<int>(n); }
+    else if (key == "width") { if (integer(1)) cfg.width = static_cast<int>(n); }
+    else if (key == "height") { if (integer(1)) cfg.height = static_cast<int>(n); }
+    else if (key == "fps") { if (real(1e-9)) cfg.fps = d; }
+    else if (key == "duration_s") { if (real(0.0)) cfg.duration_s = d; }
+    else if (key == "bin_ms") { if (integer(1)) cfg.bin_ms = static_cast<int>(n); }
+    else if (key == "event_threshold") { if (real(0.0)) cfg.event_threshold = static_cast<float>(d); }
+    else if (key == "polarity")
+    {
+        if (!parsePolarity(value, cfg.polarity)) error = "polarity: expected both, on or off, got '" + value + "'";
+    }
+    else if (key == "max_events_per_bin")
+    {
+        if (value.empty() || value == "null" || value == "None") cfg.max_events_per_bin = -1;
+        else if (integer(0)) cfg.max_events_per_bin = static_cast<int>(n);
+    }
+    else if (key == "max_objects") { if (integer(1)) cfg.max_objects = static_cast<int>(n); }
+    else if (key == "size_min") { if (integer(0)) cfg.size_min = static_cast<int>(n); }
+    else if (key == "size_max") { if (integer(0)) cfg.size_max = static_cast<int>(n); }
+    else if (key == "speed_min") { if (real(0.0)) cfg.speed_min = static_cast<float>(d); }
+    else if (key == "speed_max") { if (real(0.0)) cfg.speed_max = static_cast<float>(d); }
+    else if (key == "brightness_min") { if (real(-1.0)) cfg.brightness_min = static_cast<float>(d); }
+    else if (key == "brightness_max") { if (real(-1.0)) cfg.brightness_max = static_cast<float>(d); }
+    else if (key == "bg_drift") { if (real(-1e9)) cfg.bg_drift = static_cast<float>(d); }
+    else if (key == "id_prefix") cfg.id_prefix = value;
+    else if (key == "injection_scale") { if (real(-1e30)) cfg.injection_scale = static_cast<float>(d); }
+    else if (key == "fresh_per_epoch")
+    {
+        if (value == "true" || value == "1") cfg.fresh_per_epoch = true;
+        else if (value == "false" || value == "0") cfg.fresh_per_epoch = false;
+        else error = "fresh_per_epoch: expected true or false, got '" + value + "'";
+    }
+    else if (key == "out" || key == "dataset" || key == "no_seq") {}
+    else error = "unknown setting '" + key_in + "'";
+    return error.empty();
+}
+
+bool loadConfig(const std::string &path, WorldConfig &cfg, std::string &error)
+{
+    std::ifstream f(path.c_str());
+    if (!f.is_open())
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << f.rdbuf();
+    std::vector<std::pair<std::string, std::string>> members;
+    if (!parseFlatObject(text.str(), members, error))
+    {
+        error = path + ": " + error;
+        return false;
+    }
+    for (const auto &kv : members)
+    {
+        if (!setOption(cfg, kv.first, kv.second, error))
+        {
+            error = path + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool saveConfig(const std::string &path, const WorldConfig &cfg, std::string &error)
+{
+    std::ofstream f(path.c_str(), std::ios::trunc);
+    if (!f.is_open())
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    // event_world.py's keys and order
+    f << "{\n"
+      << "  \"seed\": " << cfg.seed << ",\n"
+      << "  \"clips\": " << cfg.clips << ",\n"
+      << "  \"width\": " << cfg.width << ",\n"
+      << "  \"height\": " << cfg.height << ",\n"
+      << "  \"fps\": " << number(cfg.fps, 15) << ",\n"
+      << "  \"duration_s\": " << number(cfg.duration_s, 15) << ",\n"
+      << "  \"bin_ms\": " << cfg.bin_ms << ",\n"
+      << "  \"event_threshold\": " << number(cfg.event_threshold, 6) << ",\n"
+      << "  \"polarity\": " << quoted(name(cfg.polarity)) << ",\n"
+      << "  \"max_events_per_bin\": " << (cfg.max_events_per_bin < 0 ? std::string("null") : std::to_string(cfg.max_events_per_bin)) << ",\n"
+      << "  \"max_objects\": " << cfg.max_objects << ",\n"
+      << "  \"size_min\": " << cfg.size_min << ",\n"
+      << "  \"size_max\": " << cfg.size_max << ",\n"
+      << "  \"speed_min\": " << number(cfg.speed_min, 6) << ",\n"
+      << "  \"speed_max\": " << number(cfg.speed_max, 6) << ",\n"
+      << "  \"brightness_min\": " << number(cfg.brightness_min, 6) << ",\n"
+      << "  \"brightness_max\": " << number(cfg.brightness_max, 6) << ",\n"
+      << "  \"bg_drift\": " << number(cfg.bg_drift, 6) << ",\n"
+      << "  \"id_prefix\": " << quoted(cfg.id_prefix) << ",\n"
+      << "  \"injection_scale\": " << number(cfg.injection_scale, 6) << ",\n"
+      << "  \"fresh_per_epoch\": " << (cfg.fresh_per_epoch ? "true" : "false") << "\n"
+      << "}\n";
+    if (!f)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+// =====================================================================================
+// EventWorld
+// =====================================================================================
+
+namespace
+{
+
+struct Object
+{
+    bool circle;
+    int size;          // radius or half-side
+    float brightness;
+    double x, y;       // center
+    double vx, vy;
+};
+
+// uniform in [lo, hi] for either order of the bounds, as Python's random.uniform
+double uniform(rstream::Stream &rng, double lo, double hi) { return lo + (hi - lo) * rng.uniform(); }
+
+void render(const std::vector<Object> &objs, double bg, int W, int H, std::vector<float> &frame)
+{
+    std::fill(frame.begin(), frame.end(), static_cast<float>(std::min(1.0, std::max(0.0, bg))));
+    for (const Object &o : objs)
+    {
+        const double s = o.size;
+        const int x0 = std::max(0, static_cast<int>(std::ceil(o.x - s)));
+        const int x1 = std::min(W - 1, static_cast<int>(std::floor(o.x + s)));
+        const int y0 = std::max(0, static_cast<int>(std::ceil(o.y - s)));
+        const int y1 = std::min(H - 1, static_cast<int>(std::floor(o.y + s)));
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                if (o.circle && (x - o.x) * (x - o.x) + (y - o.y) * (y - o.y) > s * s) continue;
+                float &p = frame[static_cast<size_t>(y) * W + x];
+                p = std::min(1.0f, std::max(0.0f, p + o.brightness));
+            }
+        }
+    }
+}
+
+// move by one frame, bouncing off the borders
+void step(std::vector<Object> &objs, double &bg, const WorldConfig &cfg)
+{
+    const double dt = 1.0 / cfg.fps;
+    for (Object &o : objs)
+    {
+        o.x += o.vx * dt;
+        o.y += o.vy * dt;
+        if (o.x - o.size < 0 && o.vx < 0) o.vx = -o.vx;
+        if (o.x + o.size > cfg.width - 1 && o.vx > 0) o.vx = -o.vx;
+        if (o.y - o.size < 0 && o.vy < 0) o.vy = -o.vy;
+        if (o.y + o.size > cfg.height - 1 && o.vy > 0) o.vy = -o.vy;
+    }
+    if (cfg.bg_drift != 0.0f) bg = std::min(1.0, std::max(0.0, bg + cfg.bg_drift * dt));
+}
+
+} // namespace
+
+EventWorld::EventWorld(const WorldConfig &c) : cfg(c)
+{
+    const size_t n = static_cast<size_t>(std::max(0, cfg.width)) * std::max(0, cfg.height) * 2;
+    channel_ids.resize(n);
+    for (size_t k = 0; k < n; ++k) channel_ids[k] = cfg.id_prefix + std::to_string(k);
+}
+
+int EventWorld::durationTicks() const
+{
+    return static_cast<int>(std::ceil(cfg.duration_s * 1000.0 / std::max(1, cfg.bin_ms)));
+}
+
+int EventWorld::clip(size_t i, uint64_t variant, EpisodeData &out) const
+{
+    out.seq.clear();
+    out.seq.setLoop(false);
+    const int W = cfg.width, H = cfg.height;
+
+    rstream::Stream rng(rstream::key(cfg.seed, rstream::WorldClip, i, variant));
+    std::vector<Object> objs(static_cast<size_t>(rng.between(1, std::max(1, cfg.max_objects))));
+    for (Object &o : objs)
+    {
+        o.circle = rng.coin();
+        o.size = rng.between(std::min(cfg.size_min, cfg.size_max), std::max(cfg.size_min, cfg.size_max));
+        o.brightness = static_cast<float>(uniform(rng, cfg.brightness_min, cfg.brightness_max));
+        // keep away from the borders a bit
+        o.x = uniform(rng, o.size + 1, W - 1 - o.size - 1);
+        o.y = uniform(rng, o.size + 1, H - 1 - o.size - 1);
+        const double speed = uniform(rng, cfg.speed_min, cfg.speed_max);
+        const double theta = uniform(rng, 0.0, 6.283185307179586);
+        o.vx = speed * std::cos(theta);
+        o.vy = speed * std::sin(theta);
+    }
+    out.target_id = "O" + std::to_string(objs.size());
+
+    // frame t is diffed against frame t - 1 as it is rendered; a (tick, channel) pair
+    // becomes one event however many frames of the tick fire it
+    const int steps = static_cast<int>(std::lround(cfg.duration_s * cfg.fps));
+    const bool on = cfg.polarity != Polarity::Off, off = cfg.polarity != Polarity::On;
+    const float thr = cfg.event_threshold;
+    std::vector<float> prev(static_cast<size_t>(W) * H), cur(prev.size());
+    std::vector<int> last_tick(channel_ids.size(), -1);
+    double bg = 0.0;
+    for (int t = 0; t < steps; ++t)
+    {
+        render(objs, bg, W, H, cur);
+        step(objs, bg, cfg);
+        if (t > 0 && cfg.max_events_per_bin != 0)
+        {
+            const int tick = static_cast<int>(std::floor(t / cfg.fps * 1000.0 / cfg.bin_ms));
+            for (size_t p = 0; p < cur.size(); ++p)
+            {
+                const float delta = cur[p] - prev[p];
+                size_t c;
+                if (on && delta >= thr) c = p * 2;
+                else if (off && delta <= -thr) c = p * 2 + 1;
+                else continue;
+                if (last_tick[c] == tick) continue;
+                last_tick[c] = tick;
+                out.seq.addEvent(tick, channel_ids[c], cfg.injection_scale);
+            }
+        }
+        prev.swap(cur);
+    }
+    return static_cast<int>(objs.size());
+}
+
+bool EventWorld::writeDataset(const std::string &path, std::string &error, const std::shared_ptr<ThreadPool> &pool,
+                              std::vector<int> *objects) const
+{
+    const std::shared_ptr<ThreadPool> workers = pool ? pool : ThreadPool::shared();
+    const size_t n = size();
+    std::vector<int> counts(n, 0);
+
+    gds::Writer writer;
+    // every sensor channel, in channel order, so the table doesn't depend on which pixels fired
+    for (const std::string &id : channel_ids) writer.channel(id);
+
+    // clips are synthesized a block at a time, so only one block's sequences are held
+    const size_t block = static_cast<size_t>(std::max(64, 4 * workers->size()));
+    std::vector<EpisodeData> episodes(std::min(block, n));
+    char clip_name[32];
+    for (size_t start = 0; start < n; start += block)
+    {
+        const int k = static_cast<int>(std::min(block, n - start));
+        workers->parallelFor(k, [&](int j) { counts[start + j] = clip(start + j, 0, episodes[j]); });
+        for (int j = 0; j < k; ++j)
+        {
+            std::snprintf(clip_name, sizeof(clip_name), "clip_%05lu", static_cast<unsigned long>(start + j));
+            writer.add(episodes[j].seq, episodes[j].target_id, clip_name);
+        }
+    }
+    if (!writer.write(path))
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    if (objects) objects->swap(counts);
+    return true;
+}
+
+bool writeCounts(const std::string &path, const std::vector<int> &objects, int duration_ticks, std::string &error)
+{
+    std::ofstream f(path.c_str(), std::ios::trunc);
+    if (!f.is_open())
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    f << "clip_id,tick,true_count\n";
+    for (size_t c = 0; c < objects.size(); ++c)
+        for (int t = 0; t < duration_ticks; ++t) f << c << ',' << t << ',' << objects[c] << '\n';
+    if (!f)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+void WorldSource::load(size_t i, EpisodeData &out)
+{
+    const bool fresh = world.config().fresh_per_epoch && epoch != EpisodeSource::kEvaluation;
+    world.clip(i, fresh ? epoch + 1 : 0, out);
+}
+
+} // namespace world
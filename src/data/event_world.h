@@ -0,0 +1,143 @@
+#ifndef __event_world_h__
+#define __event_world_h__
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../arch/input_sequence.h"
+#include "../arch/random_streams.h"
+#include "../arch/thread_pool.h"
+#include "../train/episode_source.h"
+
+/*
+The event-camera mini-world of examples/mini-world/generator/event_world.py in C++: up to
+max_objects circles and squares bouncing over a background, rendered at fps, with an ON
+(OFF) event wherever a pixel brightens (darkens) by event_threshold between two frames.
+Events are binned into ticks of bin_ms and drive sensory neuron
+id_prefix + ((y * width + x) * 2 + polarity), polarity 0 = ON, 1 = OFF, with
+injection_scale. A clip is the episode "clip_%05d" with target "O<objects>". The settings
+are event_world.py's, under the same config.json keys.
+
+Clip i's objects come from the stream (seed, WorldClip, i, variant), so a clip is the same
+whichever thread synthesizes it: writeDataset() synthesizes clips in parallel and adds
+them in clip order, and the file doesn't depend on the thread count. They are not Python's
+`random` draws, so clips match event_world.py's in distribution, not event for event.
+Frames are not kept (no npz/ output); only the previous one is, to diff against.
+
+WorldSource streams clips to the trainers instead: each is synthesized on the training
+pipeline's prefetch thread as it's loaded. With fresh_per_epoch, training epoch e sees
+variant e + 1 of every clip (new objects and motion), while evaluations see variant 0,
+which is what writeDataset() writes.
+
+    world::WorldConfig cfg;
+    std::string err;
+    if (!world::loadConfig("data/run1/config.json", cfg, err)) std::cerr << err << std::endl;
+    world::EventWorld w(cfg);
+    w.writeDataset("run1/episodes.gds", err);
+    world::WorldSource source(w);
+    trainer.trainEpoch(source, 10, train_cfg);
+*/
+namespace world
+{
+
+enum class Polarity
+{
+    Both,
+    On,
+    Off
+};
+
+// "both", "on", "off"
+const char *name(Polarity p);
+bool parsePolarity(const std::string &s, Polarity &out);
+
+struct WorldConfig
+{
+    uint64_t seed = 0;
+    int clips = 5;
+    int width = 32;
+    int height = 32;
+    double fps = 200.0;
+    double duration_s = 3.0;
+    int bin_ms = 10;                 // ms per tick
+    float event_threshold = 0.12f;   // brightness change that makes an event
+    Polarity polarity = Polarity::Both;
+    // events kept per (tick, channel); a clip keeps one per pair anyway (as a .seq
+    // replays), so only 0 (none) changes anything. < 0: no cap
+    int max_events_per_bin = -1;
+    int max_objects = 3;
+    int size_min = 3;                // radius (circle) or half-side (square), pixels
+    int size_max = 6;
+    float speed_min = 20.0f;         // pixels per second
+    float speed_max = 80.0f;
+    float brightness_min = 0.6f;
+    float brightness_max = 1.0f;
+    float bg_drift = 0.0f;           // background change per second
+    std::string id_prefix = "S";
+    float injection_scale = 200.0f;
+    bool fresh_per_epoch = false;    // WorldSource: new clips every training epoch
+};
+
+// Set one setting from text, by its config.json key ("duration_s") or flag spelling
+// ("duration-s"); max_events_per_bin takes "null" or "" for no cap. Keys of event_world.py
+// that don't describe clips ("out", "dataset", "no_seq") are accepted and ignored. False
+// (with `error` set) on an unknown key or a bad value.
+bool setOption(WorldConfig &cfg, const std::string &key, const std::string &value, std::string &error);
+
+// Read a config.json as event_world.py writes it (one flat JSON object) over `cfg`
+bool loadConfig(const std::string &path, WorldConfig &cfg, std::string &error);
+// Write the settings as config.json
+bool saveConfig(const std::string &path, const WorldConfig &cfg, std::string &error);
+
+class EventWorld
+{
+public:
+    explicit EventWorld(const WorldConfig &cfg = WorldConfig());
+
+    const WorldConfig &config() const { return cfg; }
+    size_t size() const { return cfg.clips > 0 ? static_cast<size_t>(cfg.clips) : 0; }
+    // ticks a clip spans: ceil(duration_s * 1000 / bin_ms)
+    int durationTicks() const;
+    // sensory neuron IDs by channel, (y * width + x) * 2 + polarity
+    const std::vector<std::string> &channels() const { return channel_ids; }
+
+    // Synthesize variant `variant` of clip i into `out` (replacing its events); returns
+    // its object count. Safe to call from several threads at once.
+    int clip(size_t i, uint64_t variant, EpisodeData &out) const;
+
+    // Synthesize clips 0..size()-1 (variant 0) on `pool` (null: ThreadPool::shared()) and
+    // write them as a .gds dataset; `objects`, if given, receives each clip's object count.
+    // False (with `error` set) if the file can't be written.
+    bool writeDataset(const std::string &path, std::string &error,
+                      const std::shared_ptr<ThreadPool> &pool = nullptr,
+                      std::vector<int> *objects = nullptr) const;
+
+private:
+    WorldConfig cfg;
+    std::vector<std::string> channel_ids;
+};
+
+// Per-tick object counts as labels/labels_counts.csv ("clip_id,tick,true_count"), which
+// examples/mini-world/evaluator/evaluate_counts.py and tools/seq_pack.py read
+bool writeCounts(const std::string &path, const std::vector<int> &objects, int duration_ticks, std::string &error);
+
+// A world as a trainer episode source (see the top of this file)
+class WorldSource : public EpisodeSource
+{
+public:
+    explicit WorldSource(const EventWorld &w) : world(w) {}
+    size_t size() const override { return world.size(); }
+    void beginEpoch(uint64_t e) override { epoch = e; }
+    void load(size_t i, EpisodeData &out) override;
+
+private:
+    const EventWorld &world;
+    uint64_t epoch = EpisodeSource::kEvaluation;
+};
+
+} // namespace world
+
+#endif
@@ -0,0 +1,336 @@
+#include "spike_dataset.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gds
+{
+
+static uint64_t align8(uint64_t x) { return (x + 7) & ~static_cast<uint64_t>(7); }
+
+bool isDatasetFile(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char m[4];
+    if (!in.read(m, 4)) return false;
+    return std::memcmp(m, magic, 4) == 0;
+}
+
+// =====================================================================================
+// Writer
+// =====================================================================================
+
+StringRef Writer::addString(const std::string &s)
+{
+    StringRef r;
+    r.offset = static_cast<uint32_t>(strings.size());
+    r.length = static_cast<uint32_t>(s.size());
+    strings += s;
+    return r;
+}
+
+uint32_t Writer::channel(const std::string &id)
+{
+    auto it = channel_index_of.find(id);
+    if (it != channel_index_of.end()) return it->second;
+    const uint32_t c = static_cast<uint32_t>(channel_refs.size());
+    channel_refs.push_back(addString(id));
+    channel_index_of.emplace(id, c);
+    return c;
+}
+
+uint32_t Writer::label(const std::string &id)
+{
+    auto it = label_index_of.find(id);
+    if (it != label_index_of.end()) return it->second;
+    const uint32_t l = static_cast<uint32_t>(label_refs.size());
+    label_refs.push_back(addString(id));
+    label_index_of.emplace(id, l);
+    return l;
+}
+
+void Writer::add(const InputSequence &seq, const std::string &label_id, const std::string &name)
+{
+    // ticks ascending; within a tick the event's map already gives ID order and one
+    // value per ID
+    std::vector<const InputEvent *> sorted;
+    sorted.reserve(seq.getEvents().size());
+    for (const auto &e : seq.getEvents()) if (e.tick >= 0) sorted.push_back(&e);
+    std::sort(sorted.begin(), sorted.end(), [](const InputEvent *a, const InputEvent *b) { return a->tick < b->tick; });
+
+    for (const InputEvent *e : sorted)
+    {
+        for (const auto &kv : e->inputs)
+        {
+            ticks.push_back(static_cast<uint32_t>(e->tick));
+            channel_index.push_back(channel(kv.first));
+            values.push_back(kv.second);
+        }
+    }
+    event_offsets.push_back(ticks.size());
+
+    EpisodeRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.label = label(label_id);
+    r.flags = seq.isLooping() ? Loop : 0u;
+    r.duration = sorted.empty() ? 0u : static_cast<uint32_t>(sorted.back()->tick) + 1u;
+    r.name = addString(name);
+    episodes.push_back(r);
+}
+
+/*
+Sections are written in file order with zero padding up to each 8-byte boundary, as in
+gnet::write().
+*/
+bool Writer::write(const std::string &path) const
+{
+    const uint64_t n = episodes.size();
+    const uint64_t e = ticks.size();
+
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, magic, 4);
+    h.version = version;
+    h.num_episodes = n;
+    h.num_events = e;
+    h.num_channels = static_cast<uint32_t>(channel_refs.size());
+    h.num_labels = static_cast<uint32_t>(label_refs.size());
+    h.string_bytes = strings.size();
+    h.channels_offset = align8(sizeof(Header));
+    h.labels_offset = align8(h.channels_offset + h.num_channels * sizeof(StringRef));
+    h.strings_offset = align8(h.labels_offset + h.num_labels * sizeof(StringRef));
+    h.episodes_offset = align8(h.strings_offset + h.string_bytes);
+    h.event_offsets_offset = align8(h.episodes_offset + n * sizeof(EpisodeRecord));
+    h.ticks_offset = align8(h.event_offsets_offset + (n + 1) * sizeof(uint64_t));
+    h.channel_index_offset = align8(h.ticks_offset + e * sizeof(uint32_t));
+    h.values_offset = align8(h.channel_index_offset + e * sizeof(uint32_t));
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    uint64_t pos = 0;
+    auto put = [&](uint64_t offset, const void *data, uint64_t bytes) {
+        static const char zeros[8] = {0};
+        while (pos < offset)
+        {
+            uint64_t pad = offset - pos < 8 ? offset - pos : 8;
+            out.write(zeros, static_cast<std::streamsize>(pad));
+            pos += pad;
+        }
+        if (bytes) out.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+        pos += bytes;
+    };
+    put(0, &h, sizeof(h));
+    put(h.channels_offset, channel_refs.data(), h.num_channels * sizeof(StringRef));
+    put(h.labels_offset, label_refs.data(), h.num_labels * sizeof(StringRef));
+    put(h.strings_offset, strings.data(), h.string_bytes);
+    put(h.episodes_offset, episodes.data(), n * sizeof(EpisodeRecord));
+    put(h.event_offsets_offset, event_offsets.data(), (n + 1) * sizeof(uint64_t));
+    put(h.ticks_offset, ticks.data(), e * sizeof(uint32_t));
+    put(h.channel_index_offset, channel_index.data(), e * sizeof(uint32_t));
+    put(h.values_offset, values.data(), e * sizeof(float));
+    return static_cast<bool>(out);
+}
+
+bool packLabelsCsv(const std::string &dir, const std::string &out_path, std::string &error, size_t *packed)
+{
+    const std::string sep = (!dir.empty() && dir.back() != '/' && dir.back() != '\\') ? "/" : "";
+    std::ifstream f((dir + sep + "labels.csv").c_str());
+    if (!f.is_open())
+    {
+        error = "could not open " + dir + sep + "labels.csv";
+        return false;
+    }
+    auto trim = [](std::string &s) {
+        while (!s.empty() && (s.front() == '"' || s.front() == ' ')) s.erase(s.begin());
+        while (!s.empty() && (s.back() == '"' || s.back() == ' ' || s.back() == '\r')) s.pop_back();
+    };
+
+    Writer w;
+    InputSequence seq;
+    std::string line;
+    bool header = true;
+    while (std::getline(f, line))
+    {
+        if (line.empty()) continue;
+        if (header)
+        {
+            header = false;
+            continue;
+        }
+        std::istringstream iss(line);
+        std::string fname, label_str;
+        if (!std::getline(iss, fname, ',') || !std::getline(iss, label_str)) continue;
+        trim(fname);
+        trim(label_str);
+        if (!seq.loadFromFile(dir + sep + fname))
+        {
+            std::cerr << "packLabelsCsv: skipping " << fname << std::endl;
+            continue;
+        }
+        w.add(seq, "O" + std::to_string(std::atoi(label_str.c_str())), fname);
+    }
+    if (!w.write(out_path))
+    {
+        error = "could not write " + out_path;
+        return false;
+    }
+    if (packed) *packed = w.size();
+    return true;
+}
+
+// =====================================================================================
+// Dataset
+// =====================================================================================
+
+bool Dataset::open(const std::string &path, std::string &error)
+{
+    header = nullptr;
+    if (!file.open(path))
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    const uint64_t size = file.size();
+    if (size < sizeof(Header))
+    {
+        error = "file too small";
+        return false;
+    }
+    const Header *h = reinterpret_cast<const Header *>(file.data());
+    if (std::memcmp(h->magic, magic, 4) != 0)
+    {
+        error = "bad magic";
+        return false;
+    }
+    if (h->version != version)
+    {
+        error = "unsupported version " + std::to_string(h->version);
+        return false;
+    }
+
+    const uint64_t n = h->num_episodes;
+    const uint64_t e = h->num_events;
+    auto inside = [&](uint64_t offset, uint64_t count, uint64_t item) {
+        return offset % 8 == 0 && offset <= size && count <= (size - offset) / item;
+    };
+    if (!inside(h->channels_offset, h->num_channels, sizeof(StringRef)) ||
+        !inside(h->labels_offset, h->num_labels, sizeof(StringRef)) ||
+        !inside(h->strings_offset, h->string_bytes, 1) ||
+        !inside(h->episodes_offset, n, sizeof(EpisodeRecord)) ||
+        n + 1 == 0 || !inside(h->event_offsets_offset, n + 1, sizeof(uint64_t)) ||
+        !inside(h->ticks_offset, e, sizeof(uint32_t)) ||
+        !inside(h->channel_index_offset, e, sizeof(uint32_t)) ||
+        !inside(h->values_offset, e, sizeof(float)))
+    {
+        error = "section out of bounds";
+        return false;
+    }
+
+    const unsigned char *base = file.data();
+    const StringRef *channel_refs = reinterpret_cast<const StringRef *>(base + h->channels_offset);
+    const StringRef *label_refs = reinterpret_cast<const StringRef *>(base + h->labels_offset);
+    strings = reinterpret_cast<const char *>(base + h->strings_offset);
+    records = reinterpret_cast<const EpisodeRecord *>(base + h->episodes_offset);
+    event_offsets = reinterpret_cast<const uint64_t *>(base + h->event_offsets_offset);
+    ticks = reinterpret_cast<const uint32_t *>(base + h->ticks_offset);
+    channel_index = reinterpret_cast<const uint32_t *>(base + h->channel_index_offset);
+    values = reinterpret_cast<const float *>(base + h->values_offset);
+
+    auto good = [&](const StringRef &r) { return static_cast<uint64_t>(r.offset) + r.length <= h->string_bytes; };
+    channel_ids.clear();
+    label_ids.clear();
+    for (uint32_t c = 0; c < h->num_channels; ++c)
+    {
+        if (!good(channel_refs[c]) || channel_refs[c].length == 0)
+        {
+            error = "bad channel id";
+            return false;
+        }
+        channel_ids.emplace_back(strings + channel_refs[c].offset, channel_refs[c].length);
+    }
+    for (uint32_t l = 0; l < h->num_labels; ++l)
+    {
+        if (!good(label_refs[l]))
+        {
+            error = "bad label id";
+            return false;
+        }
+        label_ids.emplace_back(strings + label_refs[l].offset, label_refs[l].length);
+    }
+
+    if (event_offsets[0] != 0 || event_offsets[n] != e)
+    {
+        error = "bad event rows";
+        return false;
+    }
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        if (records[i].label >= h->num_labels || !good(records[i].name))
+        {
+            error = "bad episode record";
+            return false;
+        }
+        if (event_offsets[i] > event_offsets[i + 1])
+        {
+            error = "bad event rows";
+            return false;
+        }
+        for (uint64_t k = event_offsets[i]; k < event_offsets[i + 1]; ++k)
+        {
+            if (channel_index[k] >= h->num_channels || ticks[k] > 0x7fffffffu ||
+                (k > event_offsets[i] && ticks[k] < ticks[k - 1]))
+            {
+                error = "bad events in episode " + std::to_string(i);
+                return false;
+            }
+        }
+    }
+    header = h;
+    return true;
+}
+
+Dataset::Events Dataset::events(size_t i) const
+{
+    Events ev;
+    const uint64_t lo = event_offsets[i];
+    ev.ticks = ticks + lo;
+    ev.channels = channel_index + lo;
+    ev.values = values + lo;
+    ev.size = static_cast<size_t>(event_offsets[i + 1] - lo);
+    return ev;
+}
+
+std::vector<int> Dataset::bind(const std::vector<std::string> &sensory_ids) const
+{
+    std::unordered_map<std::string, int> index;
+    index.reserve(sensory_ids.size());
+    for (size_t i = 0; i < sensory_ids.size(); ++i) index.emplace(sensory_ids[i], static_cast<int>(i));
+    std::vector<int> handles(channel_ids.size(), -1);
+    for (size_t c = 0; c < channel_ids.size(); ++c)
+    {
+        auto it = index.find(channel_ids[c]);
+        if (it != index.end()) handles[c] = it->second;
+    }
+    return handles;
+}
+
+void Dataset::compile(size_t i, const std::vector<int> &channel_handles, CompiledInputSequence &out) const
+{
+    const Events ev = events(i);
+    out.compileEvents(ev.ticks, ev.channels, ev.values, ev.size, channel_handles);
+}
+
+void Dataset::toSequence(size_t i, InputSequence &out) const
+{
+    out.clear();
+    out.setLoop(loops(i));
+    const Events ev = events(i);
+    for (size_t k = 0; k < ev.size; ++k)
+        out.addEvent(static_cast<int>(ev.ticks[k]), channel_ids[ev.channels[k]], ev.values[k]);
+}
+
+} // namespace gds
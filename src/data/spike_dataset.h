@@ -0,0 +1,191 @@
+#ifndef __spike_dataset_h__
+#define __spike_dataset_h__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "../arch/gnet_format.h"
+#include "../arch/input_sequence.h"
+#include "../train/episode_source.h"
+
+/*
+Packed spike dataset (.gds): many labeled episodes of sparse sensory input in one file,
+the binary counterpart of a directory of .seq files plus labels.csv.
+
+Layout (little-endian, every section 8-byte aligned, offsets from the file start):
+
+    Header         magic "GDST", version, counts and section offsets
+    channels       StringRef[num_channels], sensory neuron IDs the inputs go to
+    labels         StringRef[num_labels], target output IDs (e.g. "O3")
+    strings        channel IDs, label IDs and episode names, concatenated
+    episodes       EpisodeRecord[num_episodes]
+    event_offsets  uint64[num_episodes + 1], events of episode i are
+                   [event_offsets[i], event_offsets[i+1])
+    ticks          uint32[num_events], non-decreasing within an episode
+    channel_index  uint32[num_events], into the channel table
+    values         float[num_events]
+
+Within a tick, events are in channel ID order with one event per channel (the order
+and merging of InputSequence), so an episode replays exactly like the .seq it was
+packed from. Files are read through gnet::MappedFile: open() validates the tables once
+and episodes are then compiled straight from the mapped arrays, with no text parsing.
+*/
+namespace gds
+{
+
+const char magic[4] = {'G', 'D', 'S', 'T'};
+const uint32_t version = 1;
+
+enum EpisodeFlags : uint32_t { Loop = 1u };
+
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t num_episodes;
+    uint64_t num_events;
+    uint32_t num_channels;
+    uint32_t num_labels;
+    uint64_t string_bytes;
+    uint64_t channels_offset;
+    uint64_t labels_offset;
+    uint64_t strings_offset;
+    uint64_t episodes_offset;
+    uint64_t event_offsets_offset;
+    uint64_t ticks_offset;
+    uint64_t channel_index_offset;
+    uint64_t values_offset;
+};
+
+struct StringRef
+{
+    uint32_t offset; // into the string table
+    uint32_t length;
+};
+
+struct EpisodeRecord
+{
+    uint32_t label;    // into the label table
+    uint32_t flags;    // EpisodeFlags
+    uint32_t duration; // ticks (last input tick + 1 unless the source said more)
+    uint32_t reserved;
+    StringRef name;    // e.g. the source .seq file name; may be empty
+};
+
+// true if the file starts with the .gds magic
+bool isDatasetFile(const std::string &path);
+
+// Builds a dataset in memory, then writes it in one go.
+class Writer
+{
+public:
+    // index of a channel / label ID, added on first use
+    uint32_t channel(const std::string &id);
+    uint32_t label(const std::string &id);
+
+    // append one episode as InputSequence would replay it (events at negative ticks,
+    // which a compiled sequence drops, are skipped)
+    void add(const InputSequence &seq, const std::string &label, const std::string &name = std::string());
+
+    size_t size() const { return episodes.size(); }
+    bool write(const std::string &path) const;
+
+private:
+    StringRef addString(const std::string &s);
+
+    std::string strings;
+    std::vector<StringRef> channel_refs;
+    std::vector<StringRef> label_refs;
+    std::unordered_map<std::string, uint32_t> channel_index_of;
+    std::unordered_map<std::string, uint32_t> label_index_of;
+    std::vector<EpisodeRecord> episodes;
+    std::vector<uint64_t> event_offsets = std::vector<uint64_t>(1, 0);
+    std::vector<uint32_t> ticks;
+    std::vector<uint32_t> channel_index;
+    std::vector<float> values;
+};
+
+// Pack the .seq files listed in <dir>/labels.csv ("filename,label" with a header line;
+// label k becomes target "O<k>" as in the digits example) into `out_path`. Files that
+// fail to load are reported on cerr and skipped. False (with `error` set) if labels.csv
+// can't be read or the output can't be written.
+bool packLabelsCsv(const std::string &dir, const std::string &out_path, std::string &error, size_t *packed = nullptr);
+
+/*
+Read-only, memory-mapped dataset. Episode accessors take an index in [0, size()) and
+are safe to call from several threads at once.
+*/
+class Dataset
+{
+public:
+    // map and validate a .gds file; on failure `error` says why
+    bool open(const std::string &path, std::string &error);
+
+    size_t size() const { return header ? static_cast<size_t>(header->num_episodes) : 0; }
+    size_t numEvents() const { return header ? static_cast<size_t>(header->num_events) : 0; }
+    const std::vector<std::string> &channels() const { return channel_ids; }
+    const std::vector<std::string> &labels() const { return label_ids; }
+
+    const std::string &label(size_t i) const { return label_ids[records[i].label]; }
+    uint32_t labelIndex(size_t i) const { return records[i].label; }
+    std::string name(size_t i) const { return std::string(strings + records[i].name.offset, records[i].name.length); }
+    uint32_t duration(size_t i) const { return records[i].duration; }
+    bool loops(size_t i) const { return (records[i].flags & Loop) != 0; }
+
+    struct Events
+    {
+        const uint32_t *ticks = nullptr;
+        const uint32_t *channels = nullptr;
+        const float *values = nullptr;
+        size_t size = 0;
+    };
+    Events events(size_t i) const;
+
+    // sensory handle of every channel for a network with these sensory IDs (handle
+    // order), -1 where the network has no such sensory neuron
+    std::vector<int> bind(const std::vector<std::string> &sensory_ids) const;
+
+    // episode i compiled for the network `channel_handles` came from (see bind())
+    void compile(size_t i, const std::vector<int> &channel_handles, CompiledInputSequence &out) const;
+
+    // episode i as an InputSequence, for APIs that take one (e.g. the trainers)
+    void toSequence(size_t i, InputSequence &out) const;
+    // episode i with its target ID
+    void toEpisode(size_t i, EpisodeData &out) const
+    {
+        toSequence(i, out.seq);
+        out.target_id = label(i);
+    }
+
+private:
+    gnet::MappedFile file;
+    const Header *header = nullptr;
+    const EpisodeRecord *records = nullptr;
+    const char *strings = nullptr;
+    const uint64_t *event_offsets = nullptr;
+    const uint32_t *ticks = nullptr;
+    const uint32_t *channel_index = nullptr;
+    const float *values = nullptr;
+    std::vector<std::string> channel_ids;
+    std::vector<std::string> label_ids;
+};
+
+// A dataset as a trainer episode source: episodes are decoded as the pipeline needs
+// them, so training never holds more than its prefetched batches in memory.
+class DatasetSource : public EpisodeSource
+{
+public:
+    explicit DatasetSource(const Dataset &dataset) : ds(dataset) {}
+    size_t size() const override { return ds.size(); }
+    void load(size_t i, EpisodeData &out) override { ds.toEpisode(i, out); }
+
+private:
+    const Dataset &ds;
+};
+
+} // namespace gds
+
+#endif
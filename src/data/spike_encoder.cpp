@@ -0,0 +1,141 @@
+#include "spike_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace enc
+{
+
+const char *name(Encoding e)
+{
+    switch (e)
+    {
+    case Encoding::Rate: return "rate";
+    case Encoding::Latency: return "latency";
+    default: return "poisson";
+    }
+}
+
+bool parseEncoding(const std::string &s, Encoding &out)
+{
+    if (s == "poisson") out = Encoding::Poisson;
+    else if (s == "rate") out = Encoding::Rate;
+    else if (s == "latency") out = Encoding::Latency;
+    else return false;
+    return true;
+}
+
+void encode(const float *features, const std::vector<std::string> &channels, const EncoderConfig &cfg,
+            rstream::Stream &rng, InputSequence &out)
+{
+    out.clear();
+    out.setLoop(false);
+    const int T = std::max(0, cfg.duration);
+    const int tick_max = cfg.tick_max < 0 ? T - 1 : cfg.tick_max;
+    const int tick_range = std::max(1, tick_max - cfg.tick_min + 1);
+    for (size_t c = 0; c < channels.size(); ++c)
+    {
+        const float f = std::min(1.0f, std::max(0.0f, features[c]));
+        if (f < cfg.min_intensity) continue;
+        switch (cfg.encoding)
+        {
+        case Encoding::Poisson:
+        {
+            const double rate = static_cast<double>(f) * cfg.max_rate;
+            if (rate <= 0.0) break;
+            const double p = rate < 1.0 ? rate : 1.0 - std::exp(-rate);
+            for (int t = 0; t < T; ++t)
+                if (rng.uniform() < p) out.addEvent(t, channels[c], cfg.amp);
+            break;
+        }
+        case Encoding::Rate:
+        {
+            const float amount = f * cfg.amp;
+            if (amount == 0.0f) break;
+            for (int t = 0; t < T; ++t) out.addEvent(t, channels[c], amount);
+            break;
+        }
+        case Encoding::Latency:
+            out.addEvent(cfg.tick_min + static_cast<int>(std::lround((1.0 - f) * (tick_range - 1))), channels[c], cfg.amp);
+            break;
+        }
+    }
+}
+
+// =====================================================================================
+// FeatureDataset
+// =====================================================================================
+
+FeatureDataset::FeatureDataset(size_t dim, const EncoderConfig &c) : width(dim), cfg(c)
+{
+    defaultChannels();
+}
+
+void FeatureDataset::defaultChannels()
+{
+    channel_ids.resize(width);
+    for (size_t f = 0; f < width; ++f) channel_ids[f] = "S" + std::to_string(f);
+}
+
+void FeatureDataset::add(const float *features, const std::string &target_id)
+{
+    data.insert(data.end(), features, features + width);
+    targets.push_back(target_id);
+}
+
+bool FeatureDataset::loadCsv(const std::string &path, std::string &error)
+{
+    std::ifstream f(path.c_str());
+    if (!f.is_open())
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    data.clear();
+    targets.clear();
+    std::vector<float> row;
+    std::string line, cell;
+    size_t line_no = 0;
+    bool sized = false;
+    while (std::getline(f, line))
+    {
+        ++line_no;
+        if (line_no == 1 || line.empty() || line == "\r") continue;
+        std::istringstream iss(line);
+        std::string label;
+        if (!std::getline(iss, label, ',')) continue;
+        row.clear();
+        while (std::getline(iss, cell, ',')) row.push_back(static_cast<float>(std::atof(cell.c_str())));
+        if (!sized)
+        {
+            width = row.size();
+            sized = true;
+        }
+        else if (row.size() != width)
+        {
+            error = path + ":" + std::to_string(line_no) + ": " + std::to_string(row.size()) +
+                    " features, expected " + std::to_string(width);
+            return false;
+        }
+        while (!label.empty() && (label.back() == ' ' || label.back() == '"')) label.pop_back();
+        while (!label.empty() && (label.front() == ' ' || label.front() == '"')) label.erase(label.begin());
+        const bool numeric = !label.empty() && label.find_first_not_of("0123456789") == std::string::npos;
+        targets.push_back(numeric ? "O" + std::to_string(std::atoi(label.c_str())) : label);
+        data.insert(data.end(), row.begin(), row.end());
+    }
+    if (channel_ids.size() != width) defaultChannels();
+    return true;
+}
+
+void FeatureDataset::toEpisode(size_t i, uint64_t epoch, EpisodeData &out) const
+{
+    const uint64_t e = (cfg.fresh_per_epoch || epoch == EpisodeSource::kEvaluation) ? epoch : 0;
+    rstream::Stream rng(rstream::key(cfg.seed, rstream::Encode, e, i));
+    encode(features(i), channel_ids, cfg, rng, out.seq);
+    out.target_id = targets[i];
+}
+
+} // namespace enc
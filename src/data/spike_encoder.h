@@ -0,0 +1,131 @@
+#ifndef __spike_encoder_h__
+#define __spike_encoder_h__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../arch/input_sequence.h"
+#include "../arch/random_streams.h"
+#include "../train/episode_source.h"
+
+/*
+Spike encoders run at load time: a dataset of raw feature vectors (a float per input
+channel, in [0, 1]) whose episodes are encoded into spikes as the training pipeline
+loads them, instead of being materialized as .seq files (examples/make_glia_seqs.py)
+and parsed back. A dataset holds its features and labels only, 4 bytes per feature.
+
+The encodings are those of make_glia_seqs.py. Feature f of an episode drives channel f:
+
+    Poisson  each tick, an event of amp with probability max_rate * f (for rates >= 1,
+             1 - exp(-rate): the chance of one or more Poisson spikes, which a .seq
+             merges into one event)
+    Rate     each tick, an event of f * amp
+    Latency  one event of amp at tick_min + round((1 - f) * (tick_max - tick_min)), so
+             brighter features fire earlier
+
+over ticks [0, duration). Features below min_intensity (and zero rates) send nothing;
+features are clamped to [0, 1].
+
+Poisson draws of episode i come from the stream (seed, Encode, epoch, i), so an episode is
+the same whichever thread or batch loads it, and with fresh_per_epoch every training
+epoch sees a new sample of it (free augmentation). Evaluation draws use the epoch
+EpisodeSource::kEvaluation, the same in every evaluation.
+
+    enc::FeatureDataset ds(64);
+    ds.add(pixels, "O3");                // or ds.loadCsv("train/features.csv", err)
+    enc::EncodedSource source(ds);
+    trainer.trainEpoch(source, 10, cfg); // fresh Poisson spikes every epoch
+*/
+namespace enc
+{
+
+enum class Encoding
+{
+    Poisson,
+    Rate,
+    Latency
+};
+
+// "poisson", "rate", "latency"
+const char *name(Encoding e);
+bool parseEncoding(const std::string &s, Encoding &out);
+
+struct EncoderConfig
+{
+    Encoding encoding = Encoding::Poisson;
+    int duration = 50;          // ticks of an episode
+    float amp = 200.0f;         // input per event (Rate: scaled by the feature)
+    float max_rate = 0.5f;      // Poisson: expected spikes per tick at feature 1
+    float min_intensity = 0.0f; // features below send nothing
+    int tick_min = 0;           // Latency: tick of feature 1
+    int tick_max = -1;          // Latency: tick of feature 0 (-1: duration - 1)
+    uint64_t seed = 0;          // of the Poisson streams
+    bool fresh_per_epoch = true; // Poisson: redraw every training epoch (else epoch 0's spikes always)
+};
+
+// Encode `features` (one per channel) into `out`, replacing its events; Poisson draws
+// come from `rng`
+void encode(const float *features, const std::vector<std::string> &channels, const EncoderConfig &cfg,
+            rstream::Stream &rng, InputSequence &out);
+
+// Labeled feature vectors of one width, stored flat. Episode accessors are safe to call
+// from several threads at once.
+class FeatureDataset
+{
+public:
+    // channel f is sensory neuron "S<f>" unless setChannels() says otherwise
+    explicit FeatureDataset(size_t dim = 0, const EncoderConfig &cfg = EncoderConfig());
+
+    void add(const float *features, const std::string &target_id);
+    void reserve(size_t episodes) { data.reserve(episodes * width); targets.reserve(episodes); }
+
+    // Replace the contents with a CSV of "label,f0,f1,..." lines after a header line; a
+    // numeric label k becomes target "O<k>" (as in gds::packLabelsCsv), others are kept.
+    // The width is the first row's. False (with `error` set) on an unreadable file or a
+    // row of another width.
+    bool loadCsv(const std::string &path, std::string &error);
+
+    size_t size() const { return targets.size(); }
+    size_t dim() const { return width; }
+    const float *features(size_t i) const { return data.data() + i * width; }
+    const std::string &label(size_t i) const { return targets[i]; }
+
+    const std::vector<std::string> &channels() const { return channel_ids; }
+    void setChannels(const std::vector<std::string> &ids) { channel_ids = ids; }
+
+    const EncoderConfig &config() const { return cfg; }
+    void setConfig(const EncoderConfig &c) { cfg = c; }
+
+    // episode i as drawn in `epoch` (see the top of this file)
+    void toEpisode(size_t i, uint64_t epoch, EpisodeData &out) const;
+
+private:
+    void defaultChannels();
+
+    size_t width = 0;
+    std::vector<float> data; // episode i's features are [i * width, (i + 1) * width)
+    std::vector<std::string> targets;
+    std::vector<std::string> channel_ids;
+    EncoderConfig cfg;
+};
+
+// A feature dataset as a trainer episode source, encoding each episode as the pipeline
+// loads it for the epoch the trainer announces (beginEpoch())
+class EncodedSource : public EpisodeSource
+{
+public:
+    explicit EncodedSource(const FeatureDataset &dataset) : ds(dataset) {}
+    size_t size() const override { return ds.size(); }
+    void beginEpoch(uint64_t e) override { epoch = e; }
+    void load(size_t i, EpisodeData &out) override { ds.toEpisode(i, epoch, out); }
+
+private:
+    const FeatureDataset &ds;
+    uint64_t epoch = EpisodeSource::kEvaluation;
+};
+
+} // namespace enc
+
+#endif
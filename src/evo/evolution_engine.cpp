@@ -1,8 +1,39 @@
 #include "evolution_engine.h"
+#include "genome_ops.h"
+#include "remote.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// lineage spill file records: id, parent, mate, gen, edges, fitness, acc, margin, ticks in
+// native byte order (the file only lives as long as the run)
+template <class Node>
+void writeLineageRecord(std::ostream &out, const Node &n) {
+    const int32_t i[5] = {n.id, n.parent_id, n.mate_id, n.gen, n.m.edges};
+    const double d[4] = {n.m.fitness, n.m.acc, n.m.margin, n.m.ticks};
+    out.write(reinterpret_cast<const char *>(i), sizeof(i));
+    out.write(reinterpret_cast<const char *>(d), sizeof(d));
+}
+
+template <class Node>
+bool readLineageRecord(std::istream &in, Node &n) {
+    int32_t i[5];
+    double d[4];
+    if (!in.read(reinterpret_cast<char *>(i), sizeof(i)) || !in.read(reinterpret_cast<char *>(d), sizeof(d))) return false;
+    n.id = i[0]; n.parent_id = i[1]; n.mate_id = i[2]; n.gen = i[3]; n.m.edges = i[4];
+    n.m.fitness = d[0]; n.m.acc = d[1]; n.m.margin = d[2]; n.m.ticks = d[3];
+    return true;
+}
+
+} // namespace
 
 EvolutionEngine::EvolutionEngine(const std::string &net_path,
                                  const std::vector<Trainer::EpisodeData> &train_set,
@@ -10,11 +41,14 @@ EvolutionEngine::EvolutionEngine(const std::string &net_path,
                                  const TrainingConfig &train_cfg,
                                  const Config &evo_cfg,
                                  const Callbacks &cbs)
-    : net_path(net_path), train_set(train_set), val_set(val_set), train_cfg(train_cfg), evo_cfg(evo_cfg), cbs(cbs), rng(evo_cfg.seed)
+    : net_path(net_path), train_set(train_set), val_set(val_set), train_cfg(train_cfg), evo_cfg(evo_cfg), cbs(cbs),
+      innovations(new genome_ops::Innovations())
 {
-    Glia net; net.configureNetworkFromFile(net_path, /*verbose=*/false);
-    base_edges = countEdges(net);
+    base_net.setBuildSeed(evo_cfg.seed);
+    base_net.configureNetworkFromFile(net_path, /*verbose=*/false);
+    base_edges = countEdges(base_net);
     if (base_edges <= 0) base_edges = 1;
+    for (const auto &ex : this->val_set) val_items.push_back(&ex);
 }
 
 int EvolutionEngine::countEdges(Glia &net) const {
@@ -23,47 +57,140 @@ int EvolutionEngine::countEdges(Glia &net) const {
     return cnt;
 }
 
-void EvolutionEngine::applyMutation(Glia &net) {
-    if (evo_cfg.sigma_w > 0.0f) {
-        std::normal_distribution<float> nd(0.0f, evo_cfg.sigma_w);
-        net.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                float w = kv.second.first + nd(rng);
-                from.setTransmitter(kv.first, w);
-            }
-        });
+// Child of `parent` (crossed with `mate` if given, parent being the fitter): Gaussian
+// jitter, then each structural mutation with its probability. Works on the flat genome;
+// no network is built.
+EvolutionEngine::NetSnapshot EvolutionEngine::breed(const NetSnapshot &parent, const NetSnapshot *mate, rstream::Stream &rng) {
+    genome_ops::Genome g = mate ? genome_ops::crossover(parent, *mate, evo_cfg.crossover_rows, rng) : genome_ops::Genome(parent);
+    genome_ops::jitter(g, evo_cfg.sigma_w, evo_cfg.sigma_thr, evo_cfg.sigma_leak, rng);
+    if (evo_cfg.p_add_edge > 0.0f && rng.uniform() < evo_cfg.p_add_edge) genome_ops::addEdge(g, rng);
+    if (evo_cfg.p_remove_edge > 0.0f && rng.uniform() < evo_cfg.p_remove_edge) genome_ops::removeEdge(g, rng);
+    if (evo_cfg.p_add_neuron > 0.0f && rng.uniform() < evo_cfg.p_add_neuron) genome_ops::addNeuron(g, *innovations, rng);
+    return compact(g.snapshot(parent));
+}
+
+rstream::Stream EvolutionEngine::breedStream(int gen, int index) const {
+    return rstream::Stream(rstream::key(evo_cfg.seed, rstream::Breed, static_cast<uint64_t>(gen), static_cast<uint64_t>(index)));
+}
+
+bool EvolutionEngine::crossoverDraw(rstream::Stream &rng) const {
+    return evo_cfg.crossover_rate > 0.0f && rng.uniform() < evo_cfg.crossover_rate;
+}
+
+EvoMetrics EvolutionEngine::evaluate(Trainer &tr, Glia &net, double race_acc) const {
+    // Accuracy + avg margin on validation set (fitness is mapped by the caller), every
+    // episode from the trained network's state in parallel lanes (Trainer::evaluateDataset);
+    // detector type and early exit come from train_cfg.detector. Racing evaluates a block
+    // of lanes per worker at a time and checks between blocks.
+    const size_t total = val_set.size();
+    const size_t block = race_acc >= 0.0 ? static_cast<size_t>(dataset_eval::kEvalLanes) * static_cast<size_t>(std::max(1, train_cfg.batch_threads)) : std::max<size_t>(total, 1);
+    DatasetMetrics dm;
+    EvoMetrics em;
+    for (size_t run = 0; run < total; run += block) {
+        // racing: even all of the rest right wouldn't reach race_acc (same division as acc below)
+        if (race_acc >= 0.0 && static_cast<double>(dm.num_correct + total - run) / static_cast<double>(total) < race_acc) {
+            em.stopped = true;
+            break;
+        }
+        tr.evaluateEpisodes(val_items.data() + run, std::min(block, total - run), train_cfg, dm);
+        dm.finish();
     }
-    if (evo_cfg.sigma_thr > 0.0f) {
-        std::normal_distribution<float> nd(0.0f, evo_cfg.sigma_thr);
-        net.forEachNeuron([&](Neuron &n){ n.setThreshold(n.getThreshold() + nd(rng)); });
+    const size_t run = dm.size();
+    em.acc = (total == 0) ? 0.0 : static_cast<double>(dm.num_correct) / static_cast<double>(total);
+    em.margin = (total == 0) ? 0.0 : dm.mean_margin * static_cast<double>(run) / static_cast<double>(total);
+    em.ticks = dm.mean_ticks;
+    em.edges = countEdges(net);
+    return em;
+}
+
+EvolutionEngine::Trained EvolutionEngine::train(Individual &ind, int gen, int index) const {
+    Trained t;
+    t.net.reset(new Glia(base_net));
+    t.tr.reset(new Trainer(*t.net));
+    t.tr->reseed(evo_cfg.seed + gen * 1000 + index);
+    t.tr->setThreadPool(run_pool);
+    restoreNet(*t.net, ind.genome);
+    if (!train_set.empty() && evo_cfg.train_epochs > 0) t.tr->trainEpoch(train_set, evo_cfg.train_epochs, train_cfg);
+    return t;
+}
+
+void EvolutionEngine::finish(Individual &ind, Trained &t, int gen, int index, double seconds) const {
+    ind.profile.merge(t.tr->profile());
+    if (evo_cfg.lamarckian) ind.genome = captureNet(*t.net, &ind.genome);
+    if (telemetry_sink) {
+        telemetry::Record r(telemetry::Individual);
+        r.v[0] = gen + 1; r.v[1] = index;
+        r.v[2] = ind.m.acc; r.v[3] = ind.m.margin; r.v[4] = ind.m.edges; r.v[5] = ind.m.ticks;
+        r.v[6] = seconds;
+        r.v[7] = ind.m.stopped ? 1.0 : 0.0;
+        telemetry_sink->emit(r);
     }
-    if (evo_cfg.sigma_leak > 0.0f) {
-        std::normal_distribution<float> nd(0.0f, evo_cfg.sigma_leak);
-        net.forEachNeuron([&](Neuron &n){
-            float v = n.getLeak() + nd(rng);
-            if (v < 0.0f) v = 0.0f;
-            if (v > 1.0f) v = 1.0f;
-            n.setLeak(v);
-        });
+}
+
+void EvolutionEngine::trainAndEvaluate(Individual &ind, int gen, int index) const {
+    GLIA_PROF_BIND(&ind.profile);
+    const auto t0 = std::chrono::steady_clock::now();
+    Trained t = train(ind, gen, index);
+    {
+        GLIA_PROF_SCOPE(Evaluate);
+        ind.m = evaluate(*t.tr, *t.net, ind.race_acc);
     }
+    finish(ind, t, gen, index, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
 }
 
-EvoMetrics EvolutionEngine::evaluate(Trainer &tr, Glia &net) {
-    // Accuracy + avg margin on validation set
-    size_t total = 0, correct = 0; double sum_margin = 0.0;
-    for (const auto &ex : val_set) {
-        EpisodeMetrics m = tr.evaluate(const_cast<InputSequence&>(ex.seq), train_cfg);
-        total += 1;
-        if (m.winner_id == ex.target_id) correct += 1;
-        sum_margin += static_cast<double>(m.margin);
+void EvolutionEngine::trainThenEvaluateTogether(std::vector<Individual> &pop, const std::vector<int> &todo, int gen, int threads,
+                                                prof::Stats &profile) const {
+    const int N = static_cast<int>(todo.size());
+    std::vector<Trained> trained(N);
+    std::vector<double> seconds(N, 0.0);
+    run_pool->parallelFor(N, [&](int k) {
+        GLIA_PROF_BIND(&pop[todo[k]].profile);
+        const auto t0 = std::chrono::steady_clock::now();
+        trained[k] = train(pop[todo[k]], gen, todo[k]);
+        seconds[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }, threads);
+
+    std::vector<Glia *> nets(N);
+    for (int k = 0; k < N; ++k) nets[k] = trained[k].net.get();
+    EnsembleEvaluator ens;
+    ens.setThreadPool(run_pool);
+    std::string err;
+    if (N > 0 && ens.bind(nets, err)) {
+        const auto t0 = std::chrono::steady_clock::now();
+        EnsembleMetrics em;
+        {
+            GLIA_PROF_BIND(&profile);
+            GLIA_PROF_SCOPE(Evaluate);
+            ens.evaluateEpisodes(val_items.data(), val_items.size(), train_cfg, em);
+            em.finish();
+        }
+        profile.merge(ens.profile());
+        // validation time is split evenly among the individuals
+        const double share = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / N;
+        for (int k = 0; k < N; ++k) {
+            const DatasetMetrics &dm = em.members[k];
+            EvoMetrics &m = pop[todo[k]].m;
+            m = EvoMetrics();
+            m.acc = dm.accuracy;
+            m.margin = dm.mean_margin;
+            m.ticks = dm.mean_ticks;
+            m.edges = countEdges(*nets[k]);
+            seconds[k] += share;
+        }
+    } else {
+        if (N > 0) std::cerr << "Warning: " << err << "; validating individuals one by one" << std::endl;
+        run_pool->parallelFor(N, [&](int k) {
+            Individual &ind = pop[todo[k]];
+            GLIA_PROF_BIND(&ind.profile);
+            const auto t0 = std::chrono::steady_clock::now();
+            {
+                GLIA_PROF_SCOPE(Evaluate);
+                ind.m = evaluate(*trained[k].tr, *trained[k].net, ind.race_acc);
+            }
+            seconds[k] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }, threads);
     }
-    EvoMetrics em;
-    em.acc = (total == 0) ? 0.0 : static_cast<double>(correct) / static_cast<double>(total);
-    em.margin = (total == 0) ? 0.0 : sum_margin / static_cast<double>(total);
-    em.edges = countEdges(net);
-    em.fitness = mapFitness(em);
-    return em;
+    run_pool->parallelFor(N, [&](int k) { finish(pop[todo[k]], trained[k], gen, todo[k], seconds[k]); }, threads);
 }
 
 double EvolutionEngine::mapFitness(const EvoMetrics &m) const {
@@ -79,6 +206,16 @@ EvolutionEngine::Result EvolutionEngine::run() {
     std::vector<Individual> pop;
     const int P = std::max(1, evo_cfg.population);
     pop.resize(P);
+    run_pool = ThreadPool::resolve(thread_pool, evo_cfg.pool_threads, owned_pool);
+    std::unique_ptr<evo_remote::Dispatcher> dispatcher;
+    if (evo_cfg.listen_port > 0) {
+        dispatcher.reset(new evo_remote::Dispatcher());
+        std::string err;
+        if (!dispatcher->start(evo_cfg.listen_port, fingerprint(), evo_cfg.worker_timeout, err)) {
+            std::cerr << "Warning: " << err << "; evaluating locally only" << std::endl;
+            dispatcher.reset();
+        }
+    }
 
     // Preamble: configuration summary
     std::cout << "Evolution start\n"
@@ -91,11 +228,36 @@ EvolutionEngine::Result EvolutionEngine::run() {
               << "  seed=" << evo_cfg.seed
               << "\n  fitness_weights(acc,margin,sparsity)=(" << evo_cfg.w_acc << "," << evo_cfg.w_margin << "," << evo_cfg.w_sparsity << ")"
               << "  lamarckian=" << (evo_cfg.lamarckian ? "1" : "0")
+              << "  threads=" << std::max(1, evo_cfg.threads)
               << "\n";
-    for (int i = 0; i < P; ++i) {
-        Glia net; net.configureNetworkFromFile(net_path, /*verbose=*/false);
-        if (i != 0) applyMutation(net);
+    if (dispatcher) std::cout << "  listening for workers on port " << evo_cfg.listen_port << "\n";
+    Result res;
+    double prev_best = -1e9;
+    int first_gen = 0;
+    if (resume_gen >= 0) {
+        pop.swap(resume_pop);
+        res = resume_res;
+        prev_best = resume_prev_best;
+        first_gen = resume_gen;
+        resume_gen = -1;
+        std::cout << "Resuming at generation " << (first_gen + 1) << "\n";
+    } else {
+        metrics_cache.clear();
+        race_cutoff = -1.0;
+        innovations->clear();
+    }
+    reported_profile = res.profile;
+    for (int i = 0; first_gen == 0 && i < P; ++i) {
+        // seeds are loaded from the file (not copied from base_net) so generated
+        // (NEWNET) topologies differ per individual, reproducibly unless the file has a SEED
+        Glia net; net.setBuildSeed(evo_cfg.seed + i); net.configureNetworkFromFile(net_path, /*verbose=*/false);
         pop[i].genome = captureNet(net);
+        if (i != 0) {
+            genome_ops::Genome g(pop[i].genome);
+            rstream::Stream rng(rstream::key(evo_cfg.seed, rstream::SeedJitter, static_cast<uint64_t>(i)));
+            genome_ops::jitter(g, evo_cfg.sigma_w, evo_cfg.sigma_thr, evo_cfg.sigma_leak, rng);
+            pop[i].genome = compact(g.snapshot(pop[i].genome));
+        }
         pop[i].m.edges = countEdges(net);
         // lineage seed node
         LineageNode node; node.id = next_node_id++; node.parent_id = -1; node.gen = 0; // metrics filled after eval
@@ -103,62 +265,73 @@ EvolutionEngine::Result EvolutionEngine::run() {
         pop[i].node_id = node.id;
     }
 
-    Result res;
-    double prev_best = -1e9;
+    // with Lamarckian inheritance training changes the genome, so a genome's metrics can't be reused
+    const bool cacheable = evo_cfg.fitness_cache && !evo_cfg.lamarckian;
+
+    // steady state replaces the generational loop below (pop holds its initial population)
+    if (evo_cfg.steady_state) runSteadyState(pop, first_gen, dispatcher.get(), res, prev_best);
 
-    for (int gen = 0; gen < std::max(1, evo_cfg.generations); ++gen) {
-        // Evaluate (with inner training)
+    for (int gen = first_gen; !evo_cfg.steady_state && gen < std::max(1, evo_cfg.generations); ++gen) {
+        GLIA_PROF_BIND(&res.profile);
+        // Evaluate (with inner training). Individuals are independent, so up to `threads`
+        // of them run at once on the pool, taking the next unevaluated index until the
+        // generation is done.
+        // With a dispatcher, workers take individuals from the same queue.
+        // Genomes the cache knows (unchanged elites) keep their metrics.
+        std::vector<int> todo;
+        int cached = 0;
         for (int i = 0; i < P; ++i) {
-            Glia net; net.configureNetworkFromFile(net_path, /*verbose=*/false);
-            Trainer tr(net); tr.reseed(evo_cfg.seed + gen * 1000 + i);
-            restoreNet(net, pop[i].genome);
-            if (!train_set.empty() && evo_cfg.train_epochs > 0) tr.trainEpoch(train_set, evo_cfg.train_epochs, train_cfg);
-            pop[i].m = evaluate(tr, net);
-            if (evo_cfg.lamarckian) pop[i].genome = captureNet(net);
+            auto hit = cacheable ? metrics_cache.find(pop[i].genome.hash()) : metrics_cache.end();
+            if (hit != metrics_cache.end()) {
+                pop[i].m = hit->second;
+                ++cached;
+                continue;
+            }
+            pop[i].race_acc = evo_cfg.race ? race_cutoff : -1.0;
+            todo.push_back(i);
+        }
+        const int N = static_cast<int>(todo.size());
+        const int T = std::max(1, std::min(evo_cfg.threads, P));
+        if (dispatcher) {
+            dispatcher->run(N,
+                [&](int k) { return jobMessage(pop[todo[k]], gen, todo[k]); },
+                [&](int k, const std::string &bytes) { return applyResult(pop[todo[k]], gen, todo[k], bytes); },
+                [&](int k) { trainAndEvaluate(pop[todo[k]], gen, todo[k]); },
+                *run_pool, evo_cfg.evaluate_locally ? T : 0);
+        } else if (evo_cfg.shared_evaluation) {
+            trainThenEvaluateTogether(pop, todo, gen, T, res.profile);
+        } else {
+            run_pool->parallelFor(N, [&](int k) { trainAndEvaluate(pop[todo[k]], gen, todo[k]); }, T);
+        }
+
+        for (int i = 0; i < P; ++i) {
+            res.profile.merge(pop[i].profile);
+            pop[i].profile.reset();
+            pop[i].m.fitness = mapFitness(pop[i].m);
             // update lineage metrics
             auto it = id_to_index.find(pop[i].node_id);
             if (it != id_to_index.end()) lineage[it->second].m = pop[i].m, lineage[it->second].gen = gen;
         }
+        spillLineage(next_node_id);
 
         std::sort(pop.begin(), pop.end(), [](const Individual &a, const Individual &b){ return a.m.fitness > b.m.fitness; });
-        const Individual &best = pop.front();
-        res.best_fitness_hist.push_back(best.m.fitness);
-        res.best_acc_hist.push_back(best.m.acc);
-        res.best_margin_hist.push_back(best.m.margin);
-        res.best_genome = best.genome;
-        // Population stats
-        std::vector<double> fits; fits.reserve(P);
-        std::vector<double> accs; accs.reserve(P);
-        std::vector<double> margins; margins.reserve(P);
-        std::vector<int> edges; edges.reserve(P);
-        double sum_f=0.0, sum_a=0.0, sum_m=0.0; long long sum_e=0;
+        int E = std::min(std::max(0, evo_cfg.elite), P);
+        int R = std::min(std::max(E, evo_cfg.parents_pool), P);
+        int stopped = 0;
+        if (cacheable) metrics_cache.clear();
         for (int i = 0; i < P; ++i) {
-            fits.push_back(pop[i].m.fitness);
-            accs.push_back(pop[i].m.acc);
-            margins.push_back(pop[i].m.margin);
-            edges.push_back(pop[i].m.edges);
-            sum_f += pop[i].m.fitness; sum_a += pop[i].m.acc; sum_m += pop[i].m.margin; sum_e += pop[i].m.edges;
-        }
-        auto median_of = [](std::vector<double> v){ if(v.empty()) return 0.0; size_t mid=v.size()/2; return v.size()%2? (std::nth_element(v.begin(), v.begin()+mid, v.end()), v[mid]) : (std::nth_element(v.begin(), v.begin()+mid-1, v.end()), (v[mid-1]+v[mid])*0.5); };
-        double mean_f = (P? sum_f / (double)P : 0.0);
-        double mean_a = (P? sum_a / (double)P : 0.0);
-        double mean_m = (P? sum_m / (double)P : 0.0);
-        double mean_e = (P? (double)sum_e / (double)P : 0.0);
-        double med_f = median_of(fits);
-        double d_best = (gen==0 || prev_best<-1e8) ? 0.0 : (best.m.fitness - prev_best);
-        prev_best = best.m.fitness;
-
-        std::cout << "Generation " << (gen+1) << "/" << std::max(1, evo_cfg.generations) << "\n"
-                  << "  Best : f=" << best.m.fitness << "  acc=" << best.m.acc << "  margin=" << best.m.margin << "  edges=" << best.m.edges << "\n"
-                  << "  Mean : f=" << mean_f          << "  acc=" << mean_a          << "  margin=" << mean_m          << "  edges=" << mean_e          << "\n"
-                  << "  Median f=" << med_f << "  Δbest=" << d_best << "\n"
-                  << "  Elites=" << std::min(std::max(0, evo_cfg.elite), P) << "  ParentsPool=" << std::min(std::max(0, evo_cfg.parents_pool), P) << "  Children=" << (P - std::min(std::max(0, evo_cfg.elite), P)) << "\n";
-
-        if (cbs.on_generation) cbs.on_generation(gen, best.genome, best.m);
+            if (pop[i].m.stopped) ++stopped;
+            else if (cacheable) metrics_cache[pop[i].genome.hash()] = pop[i].m;
+        }
+        race_cutoff = pop[0].m.acc;
+        for (int i = 1; i < std::max(1, R); ++i) race_cutoff = std::min(race_cutoff, pop[i].m.acc);
+        std::ostringstream detail;
+        detail << "Elites=" << E << "  ParentsPool=" << R << "  Children=" << (P - E);
+        if (evo_cfg.fitness_cache && !evo_cfg.lamarckian) detail << "  Cached=" << cached;
+        if (evo_cfg.race) detail << "  Stopped=" << stopped;
+        reportGeneration(gen, pop, detail.str(), res, prev_best);
 
         // Next generation: elites + mutated children from top parents_pool
-        int E = std::min(std::max(0, evo_cfg.elite), P);
-        int R = std::min(std::max(E, evo_cfg.parents_pool), P);
 
         std::vector<Individual> next;
         // Elites: copy genomes into new nodes linked to previous self
@@ -171,85 +344,584 @@ EvolutionEngine::Result EvolutionEngine::run() {
             next.push_back(std::move(child));
         }
 
-        std::uniform_int_distribution<int> dist_parent(0, R - 1);
         while ((int)next.size() < P) {
-            const Individual &parent = pop[dist_parent(rng)];
-            Glia net; net.configureNetworkFromFile(net_path, /*verbose=*/false);
-            Trainer tr(net); (void)tr; restoreNet(net, parent.genome);
-            applyMutation(net);
-            Individual child; child.genome = captureNet(net); child.m = {}; child.node_id = next_node_id++;
-            LineageNode node; node.id = child.node_id; node.parent_id = parent.node_id; node.gen = gen + 1; lineage.push_back(node); id_to_index[node.id] = (int)lineage.size() - 1;
+            GLIA_PROF_SCOPE(Mutate);
+            rstream::Stream rng = breedStream(gen + 1, static_cast<int>(next.size()));
+            const Individual *parent = &pop[rng.below(static_cast<uint32_t>(R))];
+            const Individual *mate = nullptr;
+            if (R > 1 && crossoverDraw(rng)) {
+                mate = &pop[rng.below(static_cast<uint32_t>(R))];
+                if (mate->m.fitness > parent->m.fitness) std::swap(parent, mate);
+            }
+            Individual child; child.genome = breed(parent->genome, mate ? &mate->genome : nullptr, rng); child.m = {}; child.node_id = next_node_id++;
+            LineageNode node; node.id = child.node_id; node.parent_id = parent->node_id; node.mate_id = mate ? mate->node_id : -1; node.gen = gen + 1; lineage.push_back(node); id_to_index[node.id] = (int)lineage.size() - 1;
             next.push_back(std::move(child));
         }
         pop.swap(next);
+
+        if (!evo_cfg.checkpoint_path.empty() && evo_cfg.checkpoint_every > 0 && (gen + 1) % evo_cfg.checkpoint_every == 0) {
+            GLIA_PROF_SCOPE(Checkpoint);
+            checkpoint_writer.submit(evo_cfg.checkpoint_path, serializeState(gen + 1, pop, res, prev_best));
+        }
     }
 
+    if (dispatcher) dispatcher->stop(); // workers' serveWorker() returns
+
     // Write lineage JSON if requested
     if (!evo_cfg.lineage_json.empty()) writeLineageJson(evo_cfg.lineage_json);
+    std::string err;
+    checkpoint_writer.flush(&err);
+    if (telemetry_sink) telemetry_sink->flush();
     return res;
 }
 
-EvolutionEngine::NetSnapshot EvolutionEngine::captureNet(Glia &net) const {
-    NetSnapshot s;
-    net.forEachNeuron([&](Neuron &n){
-        NeuronRec r{n.getId(), n.getThreshold(), n.getLeak()};
-        s.neurons.push_back(r);
-    });
-    net.forEachNeuron([&](Neuron &from){
-        const auto &conns = from.getConnections();
-        for (const auto &kv : conns) s.edges.push_back(EdgeRec{from.getId(), kv.first, kv.second.first});
-    });
-    return s;
+// History, console report and on_generation for generation `gen`; pop is sorted best first
+void EvolutionEngine::reportGeneration(int gen, const std::vector<Individual> &pop, const std::string &detail, Result &res, double &prev_best) {
+    const int P = static_cast<int>(pop.size());
+    const Individual &best = pop.front();
+    res.best_fitness_hist.push_back(best.m.fitness);
+    res.best_acc_hist.push_back(best.m.acc);
+    res.best_margin_hist.push_back(best.m.margin);
+    res.best_genome = best.genome;
+    // Population stats
+    std::vector<double> fits; fits.reserve(P);
+    std::vector<double> accs; accs.reserve(P);
+    std::vector<double> margins; margins.reserve(P);
+    std::vector<int> edges; edges.reserve(P);
+    double sum_f=0.0, sum_a=0.0, sum_m=0.0; long long sum_e=0;
+    for (int i = 0; i < P; ++i) {
+        fits.push_back(pop[i].m.fitness);
+        accs.push_back(pop[i].m.acc);
+        margins.push_back(pop[i].m.margin);
+        edges.push_back(pop[i].m.edges);
+        sum_f += pop[i].m.fitness; sum_a += pop[i].m.acc; sum_m += pop[i].m.margin; sum_e += pop[i].m.edges;
+    }
+    auto median_of = [](std::vector<double> v){ if(v.empty()) return 0.0; size_t mid=v.size()/2; return v.size()%2? (std::nth_element(v.begin(), v.begin()+mid, v.end()), v[mid]) : (std::nth_element(v.begin(), v.begin()+mid-1, v.end()), (v[mid-1]+v[mid])*0.5); };
+    double mean_f = (P? sum_f / (double)P : 0.0);
+    double mean_a = (P? sum_a / (double)P : 0.0);
+    double mean_m = (P? sum_m / (double)P : 0.0);
+    double mean_e = (P? (double)sum_e / (double)P : 0.0);
+    double med_f = median_of(fits);
+    double d_best = (gen==0 || prev_best<-1e8) ? 0.0 : (best.m.fitness - prev_best);
+    prev_best = best.m.fitness;
+
+    std::cout << "Generation " << (gen+1) << "/" << std::max(1, evo_cfg.generations) << "\n"
+              << "  Best : f=" << best.m.fitness << "  acc=" << best.m.acc << "  margin=" << best.m.margin << "  edges=" << best.m.edges << "\n"
+              << "  Mean : f=" << mean_f          << "  acc=" << mean_a          << "  margin=" << mean_m          << "  edges=" << mean_e          << "\n"
+              << "  Median f=" << med_f << "  Δbest=" << d_best << "\n"
+              << "  " << detail << "\n";
+    if (prof::enabled()) {
+        prof::flush();
+        std::cout << "  Profile: " << res.profile.summary() << "\n";
+    }
+
+    if (telemetry_sink) {
+        telemetry::Record r(telemetry::Generation);
+        r.v[0] = gen + 1;
+        r.v[1] = best.m.fitness; r.v[2] = best.m.acc; r.v[3] = best.m.margin; r.v[4] = best.m.edges;
+        r.v[5] = mean_f; r.v[6] = mean_a; r.v[7] = mean_m; r.v[8] = mean_e; r.v[9] = med_f;
+        telemetry_sink->emit(r);
+        prof::flush();
+        telemetry::emitPhases(*telemetry_sink, gen + 1, res.profile.since(reported_profile));
+        reported_profile = res.profile;
+    }
+
+    if (cbs.on_generation) cbs.on_generation(gen, best.genome, best.m);
+}
+
+/*
+Steady-state evolution: evaluations are numbered from first_gen * P to generations * P and
+run `threads` at a time (plus on workers) in that order. Evaluation j trains with the seed
+of (generation j / P, index j % P). The first P are `initial`; every later one is a child,
+bred when a thread picks it up, of a tournament winner from the population at that
+moment. A finished individual joins the population, which then drops its worst member
+once it holds more than P. Every P finished evaluations make a "generation": report,
+history, on_generation and checkpoint (of the population, which a resumed run evaluates
+again as its first P).
+*/
+void EvolutionEngine::runSteadyState(std::vector<Individual> &initial, int first_gen, evo_remote::Dispatcher *dispatcher, Result &res, double &prev_best) {
+    const int P = static_cast<int>(initial.size());
+    const int first = first_gen * P, last = std::max(1, evo_cfg.generations) * P;
+    const int K = std::max(1, evo_cfg.tournament_size);
+    std::mutex lock; // guards everything below and lineage
+    std::vector<Individual> pop; // evaluated, at most P
+    std::unordered_map<int, Individual> running; // by evaluation number; references stay valid
+    for (int i = 0; i < P; ++i) running[first + i] = initial[i];
+    int finished = first;
+
+    // the individual of evaluation j, bred on first use (a re-queued remote job reuses it)
+    auto individual = [&](int j) -> Individual & {
+        std::lock_guard<std::mutex> g(lock);
+        auto it = running.find(j);
+        if (it != running.end()) return it->second;
+        Individual &child = running[j];
+        GLIA_PROF_BIND(&child.profile);
+        GLIA_PROF_SCOPE(Mutate);
+        // before anything finished (only possible with remote workers) parents are initial ones
+        const std::vector<Individual> &pool = pop.empty() ? initial : pop;
+        rstream::Stream rng = breedStream(j / P, j % P);
+        const uint32_t n = static_cast<uint32_t>(pool.size());
+        auto tournament = [&]() {
+            const Individual *winner = &pool[rng.below(n)];
+            for (int k = 1; k < K; ++k) {
+                const Individual &other = pool[rng.below(n)];
+                if (other.m.fitness > winner->m.fitness) winner = &other;
+            }
+            return winner;
+        };
+        const Individual *parent = tournament();
+        const Individual *mate = nullptr;
+        if (pool.size() > 1 && crossoverDraw(rng)) {
+            mate = tournament();
+            if (mate->m.fitness > parent->m.fitness) std::swap(parent, mate);
+        }
+        child.genome = breed(parent->genome, mate ? &mate->genome : nullptr, rng);
+        child.node_id = next_node_id++;
+        if (evo_cfg.race && static_cast<int>(pop.size()) == P) {
+            child.race_acc = pop[0].m.acc;
+            for (const Individual &member : pop) child.race_acc = std::min(child.race_acc, member.m.acc);
+        }
+        LineageNode node; node.id = child.node_id; node.parent_id = parent->node_id; node.mate_id = mate ? mate->node_id : -1; node.gen = j / P; lineage.push_back(node); id_to_index[node.id] = (int)lineage.size() - 1;
+        return child;
+    };
+    auto insert = [&](int j) {
+        std::lock_guard<std::mutex> g(lock);
+        auto it = running.find(j);
+        Individual ind = std::move(it->second);
+        running.erase(it);
+        res.profile.merge(ind.profile);
+        ind.profile.reset();
+        ind.m.fitness = mapFitness(ind.m);
+        auto li = id_to_index.find(ind.node_id);
+        if (li != id_to_index.end()) lineage[li->second].m = ind.m;
+        pop.push_back(std::move(ind));
+        if (static_cast<int>(pop.size()) > P)
+            pop.erase(std::min_element(pop.begin(), pop.end(), [](const Individual &a, const Individual &b){ return a.m.fitness < b.m.fitness; }));
+        if (++finished % P != 0) return;
+
+        int pending = next_node_id;
+        for (const auto &kv : running) pending = std::min(pending, kv.second.node_id);
+        spillLineage(pending);
+        const int gen = finished / P - 1;
+        std::vector<Individual> sorted = pop;
+        std::sort(sorted.begin(), sorted.end(), [](const Individual &a, const Individual &b){ return a.m.fitness > b.m.fitness; });
+        std::ostringstream detail;
+        detail << "Evaluations=" << finished << "  Running=" << running.size() << "  Tournament=" << K;
+        if (evo_cfg.race) detail << "  Stopped(population)=" << std::count_if(pop.begin(), pop.end(), [](const Individual &m){ return m.m.stopped; });
+        reportGeneration(gen, sorted, detail.str(), res, prev_best);
+        if (!evo_cfg.checkpoint_path.empty() && evo_cfg.checkpoint_every > 0 && (gen + 1) % evo_cfg.checkpoint_every == 0) {
+            GLIA_PROF_SCOPE(Checkpoint);
+            checkpoint_writer.submit(evo_cfg.checkpoint_path, serializeState(gen + 1, sorted, res, prev_best));
+        }
+    };
+    auto evaluateLocally = [&](int k) {
+        const int j = first + k;
+        Individual &ind = individual(j);
+        trainAndEvaluate(ind, j / P, j % P);
+        insert(j);
+    };
+
+    GLIA_PROF_BIND(&res.profile);
+    const int T = std::max(1, std::min(evo_cfg.threads, P));
+    if (dispatcher) {
+        dispatcher->run(last - first,
+            [&](int k) { const int j = first + k; return jobMessage(individual(j), j / P, j % P); },
+            [&](int k, const std::string &bytes) {
+                const int j = first + k;
+                Individual *ind;
+                {
+                    std::lock_guard<std::mutex> g(lock);
+                    ind = &running.at(j);
+                }
+                if (!applyResult(*ind, j / P, j % P, bytes)) return false;
+                insert(j);
+                return true;
+            },
+            evaluateLocally, *run_pool, evo_cfg.evaluate_locally ? T : 0);
+    } else {
+        run_pool->parallelFor(last - first, evaluateLocally, T);
+    }
+}
+
+// Checkpoint layout: P, next generation, genomes (population then best), node IDs,
+// lineage, history, the previous best fitness, the fitness cache, the race cutoff and the
+// innovation table.
+// Metrics of the population aren't stored: the individuals of a new generation are always
+// still to be evaluated (or found in the cache).
+std::string EvolutionEngine::serializeState(int next_gen, const std::vector<Individual> &pop, const Result &res, double prev_best) const {
+    ckpt::Writer w("evolution");
+    w.i32(static_cast<int32_t>(pop.size()));
+    w.i32(next_gen);
+    std::vector<const NetSnapshot *> genomes;
+    std::vector<int> node_ids;
+    for (const Individual &ind : pop) {
+        genomes.push_back(&ind.genome);
+        node_ids.push_back(ind.node_id);
+    }
+    genomes.push_back(&res.best_genome);
+    w.snapshots(genomes);
+    w.vec(node_ids);
+    w.i32(next_node_id);
+    w.u64(lineage.size());
+    for (const LineageNode &n : lineage) {
+        w.i32(n.id);
+        w.i32(n.parent_id);
+        w.i32(n.mate_id);
+        w.i32(n.gen);
+        w.f64(n.m.fitness);
+        w.f64(n.m.acc);
+        w.f64(n.m.margin);
+        w.i32(n.m.edges);
+        w.f64(n.m.ticks);
+    }
+    w.vec(res.best_fitness_hist);
+    w.vec(res.best_acc_hist);
+    w.vec(res.best_margin_hist);
+    w.f64(prev_best);
+    w.u64(metrics_cache.size());
+    for (const auto &kv : metrics_cache) {
+        w.u64(kv.first);
+        w.f64(kv.second.acc);
+        w.f64(kv.second.margin);
+        w.i32(kv.second.edges);
+        w.f64(kv.second.ticks);
+    }
+    w.f64(race_cutoff);
+    innovations->write(w);
+    return w.release();
+}
+
+bool EvolutionEngine::loadCheckpoint(const std::string &path, std::string &error) {
+    ckpt::Reader r;
+    if (!r.open(path, "evolution")) {
+        error = r.error();
+        return false;
+    }
+    const int P = r.i32();
+    const int next_gen = r.i32();
+    std::vector<NetSnapshot> genomes = r.snapshots();
+    std::vector<int> node_ids = r.vec<int>();
+    const int next_id = r.i32();
+    const uint64_t num_nodes = r.u64();
+    std::vector<LineageNode> nodes;
+    for (uint64_t i = 0; i < num_nodes && r.ok(); ++i) {
+        LineageNode n;
+        n.id = r.i32();
+        n.parent_id = r.i32();
+        n.mate_id = r.i32();
+        n.gen = r.i32();
+        n.m.fitness = r.f64();
+        n.m.acc = r.f64();
+        n.m.margin = r.f64();
+        n.m.edges = r.i32();
+        n.m.ticks = r.f64();
+        nodes.push_back(n);
+    }
+    Result res;
+    res.best_fitness_hist = r.vec<double>();
+    res.best_acc_hist = r.vec<double>();
+    res.best_margin_hist = r.vec<double>();
+    const double prev_best = r.f64();
+    std::unordered_map<uint64_t, EvoMetrics> cache;
+    const uint64_t num_cached = r.u64();
+    for (uint64_t i = 0; i < num_cached && r.ok(); ++i) {
+        const uint64_t h = r.u64();
+        EvoMetrics m;
+        m.acc = r.f64();
+        m.margin = r.f64();
+        m.edges = r.i32();
+        m.ticks = r.f64();
+        cache[h] = m;
+    }
+    const double cutoff = r.f64();
+    genome_ops::Innovations inn;
+    inn.read(r);
+    if (r.ok() && (P != std::max(1, evo_cfg.population) || static_cast<int>(genomes.size()) != P + 1 || static_cast<int>(node_ids.size()) != P))
+        r.fail(path + " is a checkpoint of a population of " + std::to_string(P) + ", not " + std::to_string(std::max(1, evo_cfg.population)));
+    if (!r.ok()) {
+        error = r.error();
+        return false;
+    }
+
+    resume_pop.assign(P, Individual());
+    for (int i = 0; i < P; ++i) {
+        resume_pop[i].genome = compact(genomes[i]);
+        resume_pop[i].node_id = node_ids[i];
+    }
+    res.best_genome = compact(genomes[P]);
+    resume_res = res;
+    resume_prev_best = prev_best;
+    resume_gen = next_gen;
+    next_node_id = next_id;
+    lineage.swap(nodes);
+    metrics_cache.swap(cache);
+    race_cutoff = cutoff;
+    *innovations = inn;
+    id_to_index.clear();
+    for (size_t i = 0; i < lineage.size(); ++i) id_to_index[lineage[i].id] = static_cast<int>(i);
+
+    // nodes spilled before the checkpoint stay in the spill file, later ones are dropped
+    // (the resumed run spills them again)
+    lineage_spilling = false;
+    const std::string spill = lineageSpillPath();
+    if (evo_cfg.lineage_memory_mb > 0.0 && !spill.empty() && !lineage.empty()) {
+        // copied into spill + ".tmp", which then replaces the file
+        const std::string tmp = spill + ".tmp";
+        size_t kept = 0;
+        {
+            std::ifstream in(spill.c_str(), std::ios::binary);
+            std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+            LineageNode n;
+            while (readLineageRecord(in, n) && n.id < lineage.front().id) {
+                writeLineageRecord(out, n);
+                ++kept;
+            }
+            if (!out) kept = 0;
+        }
+        std::remove(spill.c_str()); // rename doesn't replace on Windows
+        lineage_spilling = kept > 0 && std::rename(tmp.c_str(), spill.c_str()) == 0;
+        if (!lineage_spilling) std::remove(tmp.c_str());
+    }
+    return true;
+}
+
+// Identity of what a worker's results depend on besides the genome: neuron IDs of the base
+// network (genomes carry the edges), the data, and the configuration that shapes training
+// and evaluation, hashed (FNV-1a) into a short string. Settings not listed here aren't
+// checked, so workers should run the coordinator's configuration.
+std::string EvolutionEngine::fingerprint() const {
+    ckpt::Writer w("evolution-fingerprint");
+    w.strs(base_net.getAllNeuronIDs());
+    for (const std::vector<Trainer::EpisodeData> *set : {&train_set, &val_set}) {
+        w.u64(set->size());
+        for (const Trainer::EpisodeData &ep : *set) {
+            w.str(ep.target_id);
+            w.u64(ep.seq.getEvents().size());
+            for (const InputEvent &e : ep.seq.getEvents()) {
+                w.i32(e.tick);
+                for (const auto &kv : e.inputs) { w.str(kv.first); w.f32(kv.second); }
+            }
+        }
+    }
+    w.u32(evo_cfg.seed);
+    w.i32(evo_cfg.train_epochs);
+    w.u32(evo_cfg.lamarckian ? 1u : 0u);
+    w.u32(evo_cfg.genome_fp16 ? 1u : 0u);
+    const TrainingConfig &c = train_cfg;
+    w.i32(c.warmup_ticks); w.i32(c.decision_window); w.i32(c.batch_size);
+    w.f32(c.lr); w.f32(c.elig_lambda); w.f32(c.weight_decay); w.f32(c.rate_alpha);
+    w.f32(c.margin_delta); w.f32(c.reward_pos); w.f32(c.reward_neg);
+    w.str(c.reward_mode); w.str(c.update_gating);
+    w.str(c.detector.type); w.f32(c.detector.alpha); w.f32(c.detector.threshold);
+    w.i32(c.grow_edges); w.f32(c.prune_epsilon); w.i32(c.timing_jitter);
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char ch : w.bytes()) { h ^= ch; h *= 1099511628211ull; }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
+    return hex;
+}
+
+std::string EvolutionEngine::jobMessage(const Individual &ind, int gen, int index) const {
+    ckpt::Writer w(evo_remote::coordinator_kind);
+    w.u32(evo_remote::Job);
+    w.i32(gen);
+    w.i32(index);
+    w.f64(ind.race_acc);
+    w.snapshots({&ind.genome});
+    return w.release();
+}
+
+// metrics, the individual's profile and, when Lamarckian, its trained genome
+std::string EvolutionEngine::resultMessage(const Individual &ind, int gen, int index) const {
+    ckpt::Writer w(evo_remote::worker_kind);
+    w.u32(evo_remote::Result);
+    w.i32(gen);
+    w.i32(index);
+    w.f64(ind.m.acc);
+    w.f64(ind.m.margin);
+    w.i32(ind.m.edges);
+    w.f64(ind.m.ticks);
+    w.u32(ind.m.stopped ? 1u : 0u);
+    const prof::Stats &s = ind.profile;
+    for (int p = 0; p < prof::NumPhases; ++p) { w.f64(s.seconds[p]); w.u64(s.calls[p]); }
+    w.u64(s.ticks); w.u64(s.spikes); w.u64(s.synaptic_events); w.u64(s.edges_touched); w.u64(s.allocations);
+    w.u32(evo_cfg.lamarckian ? 1u : 0u);
+    if (evo_cfg.lamarckian) w.snapshots({&ind.genome});
+    return w.release();
+}
+
+bool EvolutionEngine::applyResult(Individual &ind, int gen, int index, const std::string &bytes) const {
+    ckpt::Reader r;
+    if (!r.openBytes(bytes, evo_remote::worker_kind, "worker result") || r.u32() != evo_remote::Result) return false;
+    if (r.i32() != gen || r.i32() != index) return false;
+    EvoMetrics m;
+    m.acc = r.f64();
+    m.margin = r.f64();
+    m.edges = r.i32();
+    m.ticks = r.f64();
+    m.stopped = r.u32() != 0;
+    prof::Stats s;
+    for (int p = 0; p < prof::NumPhases; ++p) { s.seconds[p] = r.f64(); s.calls[p] = r.u64(); }
+    s.ticks = r.u64(); s.spikes = r.u64(); s.synaptic_events = r.u64(); s.edges_touched = r.u64(); s.allocations = r.u64();
+    std::vector<NetSnapshot> genome;
+    if (r.u32()) {
+        genome = r.snapshots();
+        if (genome.size() != 1 || genome[0].empty()) return false;
+    }
+    if (!r.ok()) return false;
+    ind.m = m;
+    ind.profile.merge(s);
+    if (!genome.empty()) ind.genome = compact(genome[0]);
+    return true;
+}
+
+bool EvolutionEngine::serveWorker(const std::string &host, int port, std::string &error) {
+    run_pool = ThreadPool::resolve(thread_pool, evo_cfg.pool_threads, owned_pool);
+    const std::string fp = fingerprint();
+    // one connection per evaluation thread; they block on the network, so they get their
+    // own threads rather than pool tasks (the trainers' batches still use the pool)
+    const int T = std::max(1, evo_cfg.threads);
+    std::vector<std::string> errors(T);
+    std::vector<char> finished(T, 0);
+    std::vector<std::thread> sessions;
+    for (int s = 1; s < T; ++s) sessions.emplace_back([&, s]() { finished[s] = workerSession(host, port, fp, errors[s]); });
+    finished[0] = workerSession(host, port, fp, errors[0]);
+    for (auto &t : sessions) t.join();
+    for (int s = 0; s < T; ++s)
+        if (finished[s]) return true;
+    error = errors[0];
+    return false;
+}
+
+// one connection: Hello, then jobs until Bye; reconnects while the coordinator was
+// reachable within the last reconnect_seconds
+bool EvolutionEngine::workerSession(const std::string &host, int port, const std::string &fp, std::string &error) const {
+    using evo_remote::Connection;
+    auto last_contact = std::chrono::steady_clock::now();
+    for (;;) {
+        Connection conn = Connection::connect(host, port, error);
+        std::string bytes;
+        ckpt::Reader r;
+        ckpt::Writer hello(evo_remote::worker_kind);
+        hello.u32(evo_remote::Hello);
+        hello.str(fp);
+        if (conn.valid() && conn.send(hello.release()) && conn.receive(bytes, 30.0, evo_remote::max_handshake) == Connection::Ok &&
+            r.openBytes(bytes, evo_remote::coordinator_kind, "coordinator message")) {
+            const uint32_t type = r.u32();
+            if (type == evo_remote::Reject) {
+                error = "rejected by the coordinator: " + r.str();
+                return false;
+            }
+            while (type == evo_remote::Welcome && conn.receive(bytes, -1.0, evo_remote::max_message) == Connection::Ok &&
+                   r.openBytes(bytes, evo_remote::coordinator_kind, "coordinator message")) {
+                last_contact = std::chrono::steady_clock::now();
+                const uint32_t t = r.u32();
+                if (t == evo_remote::Bye) return true;
+                const int gen = r.i32(), index = r.i32();
+                const double race_acc = r.f64();
+                std::vector<NetSnapshot> genome = r.snapshots();
+                if (t != evo_remote::Job || !r.ok() || genome.size() != 1 || genome[0].empty()) break;
+                Individual ind;
+                ind.genome = genome[0];
+                ind.race_acc = race_acc;
+                trainAndEvaluate(ind, gen, index);
+                if (!conn.send(resultMessage(ind, gen, index))) break;
+            }
+            last_contact = std::chrono::steady_clock::now();
+        }
+        if (std::chrono::steady_clock::now() - last_contact > std::chrono::duration<double>(evo_cfg.reconnect_seconds)) {
+            if (error.empty()) error = "lost the coordinator at " + host + ":" + std::to_string(port);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
+
+EvolutionEngine::NetSnapshot EvolutionEngine::captureNet(Glia &net, const NetSnapshot *prev) const {
+    return compact(NetworkSnapshot::capture(net, prev));
+}
+
+EvolutionEngine::NetSnapshot EvolutionEngine::compact(const NetSnapshot &s) const {
+    return evo_cfg.genome_fp16 ? s.halfPrecision() : s;
+}
+
+std::string EvolutionEngine::lineageSpillPath() const {
+    if (!evo_cfg.lineage_spill.empty()) return evo_cfg.lineage_spill;
+    return evo_cfg.lineage_json.empty() ? std::string() : evo_cfg.lineage_json + ".nodes";
+}
+
+void EvolutionEngine::spillLineage(int before) {
+    const double node_bytes = sizeof(LineageNode) + 32.0; // with its id_to_index entry
+    if (evo_cfg.lineage_memory_mb <= 0.0 || lineage.size() * node_bytes <= evo_cfg.lineage_memory_mb * 1048576.0) return;
+    size_t n = 0;
+    while (n < lineage.size() && lineage[n].id < before) ++n;
+    if (n == 0) return;
+    const std::string path = lineageSpillPath();
+    if (!path.empty()) {
+        std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | (lineage_spilling ? std::ios::app : std::ios::trunc));
+        for (size_t i = 0; i < n; ++i) writeLineageRecord(out, lineage[i]);
+        if (!out) std::cerr << "Warning: cannot write lineage to " << path << "; older nodes are dropped" << std::endl;
+        lineage_spilling = true;
+    }
+    for (size_t i = 0; i < n; ++i) id_to_index.erase(lineage[i].id);
+    lineage.erase(lineage.begin(), lineage.begin() + static_cast<std::ptrdiff_t>(n));
+    for (auto &kv : id_to_index) kv.second -= static_cast<int>(n);
 }
 
 void EvolutionEngine::restoreNet(Glia &net, const NetSnapshot &s) const {
-    // Build edge set for quick lookup
-    std::unordered_map<std::string, std::unordered_map<std::string,float>> edge_set;
-    for (const auto &e : s.edges) edge_set[e.from][e.to] = e.w;
-    // Remove edges not present
-    net.forEachNeuron([&](Neuron &from){
-        std::vector<std::string> to_remove;
-        const auto &conns = from.getConnections();
-        for (const auto &kv : conns) {
-            auto itf = edge_set.find(from.getId());
-            if (itf == edge_set.end() || itf->second.find(kv.first) == itf->second.end()) to_remove.push_back(kv.first);
-        }
-        for (const auto &tid : to_remove) from.removeConnection(tid);
-    });
-    // Restore/add edges
-    for (const auto &e : s.edges) {
-        auto from = net.getNeuronById(e.from);
-        auto to = net.getNeuronById(e.to);
-        if (!from || !to) continue;
-        const auto &conns = from->getConnections();
-        if (conns.find(e.to) == conns.end()) from->addConnection(e.w, to);
-        else from->setTransmitter(e.to, e.w);
-    }
-    // Restore neuron params
-    for (const auto &r : s.neurons) {
-        auto n = net.getNeuronById(r.id);
-        if (!n) continue;
-        n->setThreshold(r.thr);
-        n->setLeak(r.leak);
+    s.restore(net);
+}
+
+std::vector<EvolutionEngine::NeuronRec> EvolutionEngine::neuronRecords(const NetSnapshot &s) {
+    std::vector<NeuronRec> out;
+    if (s.empty()) return out;
+    const SnapshotTopology &t = s.topology();
+    out.reserve(t.keys.size());
+    for (int h = 0; h < t.numNeurons(); ++h) out.push_back(NeuronRec{t.id(h), s.thresholds()[h], s.leaks()[h]});
+    return out;
+}
+
+std::vector<EvolutionEngine::EdgeRec> EvolutionEngine::edgeRecords(const NetSnapshot &s) {
+    std::vector<EdgeRec> out;
+    if (s.empty()) return out;
+    const SnapshotTopology &t = s.topology();
+    std::vector<float> w;
+    s.weights(w);
+    out.reserve(t.targets.size());
+    for (int h = 0; h < t.numNeurons(); ++h) {
+        for (int k = t.row_offsets[h]; k < t.row_offsets[h + 1]; ++k) {
+            if (t.targets[k] >= t.numNeurons()) continue;
+            out.push_back(EdgeRec{t.id(h), t.id(t.targets[k]), w[k]});
+        }
     }
+    return out;
 }
 
 void EvolutionEngine::writeLineageJson(const std::string &path) const {
     std::ofstream jf(path.c_str(), std::ios::out | std::ios::trunc);
     if (!jf.is_open()) return;
     jf << "{\n  \"nodes\": [\n";
-    for (size_t i = 0; i < lineage.size(); ++i) {
-        const auto &n = lineage[i];
+    bool first = true;
+    auto node = [&](const LineageNode &n) {
+        if (!first) jf << ",\n";
+        first = false;
         jf << "    {\"id\": " << n.id
-           << ", \"parent\": " << n.parent_id
-           << ", \"gen\": " << n.gen
+           << ", \"parent\": " << n.parent_id;
+        if (n.mate_id >= 0) jf << ", \"mate\": " << n.mate_id;
+        jf << ", \"gen\": " << n.gen
            << ", \"fitness\": " << n.m.fitness
            << ", \"acc\": " << n.m.acc
            << ", \"margin\": " << n.m.margin
            << ", \"edges\": " << n.m.edges
            << "}";
-        if (i + 1 < lineage.size()) jf << ",";
-        jf << "\n";
+    };
+    // nodes moved to the spill file come first (they are the older ones)
+    if (lineage_spilling) {
+        std::ifstream in(lineageSpillPath().c_str(), std::ios::binary);
+        LineageNode n;
+        while (readLineageRecord(in, n)) node(n);
     }
+    for (const LineageNode &n : lineage) node(n);
+    if (!first) jf << "\n";
     jf << "  ]\n}\n";
 }
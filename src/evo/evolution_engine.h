@@ -16,19 +16,34 @@
 #include "../arch/input_sequence.h"
 #include "../train/trainer.h"
 #include "../train/training_config.h"
+#include "../train/network_snapshot.h"
+#include "../train/checkpoint.h"
+#include "../train/ensemble_eval.h"
+#include "../arch/profiling.h"
+#include "../arch/thread_pool.h"
+#include "../arch/telemetry.h"
+
+namespace evo_remote { class Dispatcher; }
+namespace genome_ops { class Innovations; }
 
 struct EvoMetrics {
     double fitness = -1e9;
     double acc = 0.0;
     double margin = 0.0;
     int edges = 0;
+    double ticks = 0.0;  // mean ticks per validation episode (less than U + W with early exit)
+    bool stopped = false; // validation cut short by racing; the skipped episodes count as wrong
 };
 
 class EvolutionEngine {
 public:
+    // genomes are index-based snapshots (shared topology, float arrays); the records are
+    // their ID-keyed form for callers that want one (e.g. the Python bindings)
+    typedef NetworkSnapshot NetSnapshot;
     struct EdgeRec { std::string from; std::string to; float w; };
     struct NeuronRec { std::string id; float thr; float leak; };
-    struct NetSnapshot { std::vector<NeuronRec> neurons; std::vector<EdgeRec> edges; };
+    static std::vector<NeuronRec> neuronRecords(const NetSnapshot &s);
+    static std::vector<EdgeRec> edgeRecords(const NetSnapshot &s);
     struct Config {
         int population = 8;
         int generations = 10;
@@ -41,6 +56,18 @@ public:
         float sigma_thr = 0.0f;
         float sigma_leak = 0.0f;
 
+        // Structural mutation (see genome_ops.h), per child: chance of one new edge, of
+        // one removed edge, and of one new hidden neuron splitting an edge. With
+        // w_sparsity > 0 the search can move to smaller networks.
+        float p_add_edge = 0.0f;
+        float p_remove_edge = 0.0f;
+        float p_add_neuron = 0.0f;
+        // Share of children bred from two parents: the fitter one's structure, with weights
+        // and parameters taken from either per edge, or (crossover_rows) per neuron along
+        // with its outgoing edges
+        float crossover_rate = 0.0f;
+        bool crossover_rows = false;
+
         // Fitness weights (default mapping)
         float w_acc = 1.0f;
         float w_margin = 0.5f;
@@ -54,6 +81,75 @@ public:
 
         // Optional: path to write lineage JSON (evolutionary tree)
         std::string lineage_json;   // if empty, skip writing
+
+        // Worker threads for evaluating a generation. Each individual is trained with its
+        // own Glia/Trainer seeded from (seed, generation, index), so results don't
+        // depend on this; fitness_fn is still called on the calling thread.
+        int threads = 1;
+        // Threads of the pool that runs individuals and their trainers' batch workers
+        // (0 = the process-wide pool; ignored when setThreadPool() was called). `threads`
+        // and TrainingConfig::batch_threads then only split the work; the pool bounds how
+        // much of it runs at once, also when both levels are parallel.
+        int pool_threads = 0;
+
+        // On-disk checkpoint (see checkpoint.h) of the population, lineage and history,
+        // written on a background thread every checkpoint_every generations; resume with
+        // loadCheckpoint() before run()
+        std::string checkpoint_path;   // if empty, skip writing
+        int checkpoint_every = 1;
+
+        // Distributed evaluation (see remote.h). listen_port > 0 makes run() a coordinator:
+        // worker processes (serveWorker()) built from the same network file, data and
+        // configuration connect to this port and evaluate individuals too. Their results
+        // equal local ones, so the run only gets faster; selection, mutation, lineage and
+        // checkpoints stay on the coordinator.
+        int listen_port = 0;
+        double worker_timeout = 600.0;   // seconds per individual before it is re-dispatched
+        bool evaluate_locally = true;    // coordinator also evaluates `threads` at a time
+        double reconnect_seconds = 60.0; // how long a worker keeps trying to (re)connect
+
+        // Steady-state (asynchronous) evolution: rather than waiting for a whole generation,
+        // a thread that finishes an individual adds it to the population (dropping the worst
+        // beyond `population`) and starts on a child of a tournament winner from the current
+        // population, so stragglers never leave threads or workers idle. The run is
+        // generations * population evaluations; reports, history, on_generation and
+        // checkpoints come every `population` of them. elite and parents_pool are unused,
+        // and with threads > 1 the result depends on which evaluations finish first.
+        bool steady_state = false;
+        int tournament_size = 3;
+
+        // Skipping work on individuals that can't matter. fitness_cache (non-Lamarckian runs,
+        // where training leaves the genome as it was) gives a genome of the previous
+        // generation, such as an elite, its metrics from then instead of training and
+        // validating it again. race stops validating an individual (between blocks of
+        // episodes, see evaluate()) as soon as it would stay below the cutoff accuracy even
+        // with every remaining episode right; the cutoff is
+        // the lowest accuracy among the previous generation's parents_pool (steady state: the
+        // population's worst). Racing looks at accuracy only, so with a large w_margin or
+        // w_sparsity it can drop an individual full validation would have kept.
+        bool fitness_cache = true;
+        bool race = false;
+
+        // Train a generation's individuals first, then validate them all in one
+        // EnsembleEvaluator pass over the validation set (ensemble_eval.h), which decodes
+        // each episode's inputs once for the whole generation instead of once per
+        // individual. Metrics are the same as validating one by one; race is not applied.
+        // Networks the evaluator can't run together fall back to validating each on its
+        // own; distributed runs (listen_port) and steady_state ignore this.
+        bool shared_evaluation = false;
+
+        // Memory of large populations. Genomes share their topology, and a child or trained
+        // genome that changed at most a quarter of its weights stores only those (see
+        // network_snapshot.h). genome_fp16 rounds every weight of a genome to fp16 when the
+        // genome is stored (full blocks are then kept in half precision, deltas as floats of
+        // the rounded values), so individuals train from and are judged on rounded weights,
+        // also after a checkpoint is loaded. lineage_memory_mb caps the lineage kept in
+        // memory (0 = no cap): past it, the nodes of evaluated individuals are appended to
+        // lineage_spill (default: lineage_json + ".nodes"; with neither set they are dropped)
+        // and read back when the lineage JSON is written.
+        bool genome_fp16 = false;
+        double lineage_memory_mb = 0.0;
+        std::string lineage_spill;
     };
 
     struct Callbacks {
@@ -70,6 +166,9 @@ public:
         std::vector<double> best_fitness_hist;
         std::vector<double> best_acc_hist;
         std::vector<double> best_margin_hist;
+        // phases and counters of the whole run, summed over individuals and worker threads
+        // (all zero unless built with GLIA_PROFILE, see profiling.h)
+        prof::Stats profile;
     };
 
     EvolutionEngine(const std::string &net_path,
@@ -79,37 +178,114 @@ public:
                     const Config &evo_cfg,
                     const Callbacks &cbs = {});
 
+    // Evolve from the seed population, or from the generation a loadCheckpoint() read
     Result run();
 
+    // Continue a checkpointed run: the next run() starts at the generation after the last
+    // one the file covers and, with the same configuration and data, finishes exactly as
+    // the interrupted run would have. False (with a message in `error`) if the file isn't
+    // an evolution checkpoint of this population size.
+    bool loadCheckpoint(const std::string &path, std::string &error);
+
+    // Be a worker of the coordinator at host:port (a run() with Config::listen_port): evaluate
+    // the individuals it sends, `threads` at a time, until it finishes its run. A dropped
+    // connection is retried for reconnect_seconds. False (with a message in `error`) if the
+    // coordinator can't be reached or rejects this engine's network, data or configuration.
+    bool serveWorker(const std::string &host, int port, std::string &error);
+
+    // pool for run() and the trainers it creates (see Config::pool_threads)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+
+    // Progress records (see telemetry.h): an Individual record per individual trained and
+    // validated in this process (emitted from the thread that ran it), then per generation
+    // a Generation record and, with GLIA_PROFILE, its Phase records. The console report
+    // per generation stays. nullptr detaches.
+    void setTelemetry(std::shared_ptr<telemetry::Sink> sink) { telemetry_sink = std::move(sink); }
+
 private:
     std::string net_path;
+    Glia base_net; // net_path parsed once; individuals are built as copies of it
     std::vector<Trainer::EpisodeData> train_set;
     std::vector<Trainer::EpisodeData> val_set;
+    std::vector<const Trainer::EpisodeData *> val_items; // into val_set, for Trainer::evaluateEpisodes
     TrainingConfig train_cfg;
     Config evo_cfg;
     Callbacks cbs;
-    std::mt19937 rng;
     int base_edges = 1;
 
-    struct Individual { NetSnapshot genome; EvoMetrics m; int node_id = -1; };
+    struct Individual {
+        NetSnapshot genome; EvoMetrics m; int node_id = -1; prof::Stats profile;
+        double race_acc = -1.0; // validation stops once accuracy can't reach this (< 0: never)
+    };
 
     struct LineageNode {
         int id = -1;
         int parent_id = -1; // -1 for seeds
+        int mate_id = -1;   // second parent of a crossover
         int gen = 0;
         EvoMetrics m;       // metrics as evaluated for this node
     };
 
     int countEdges(Glia &net) const;
-    void applyMutation(Glia &net);
-    EvoMetrics evaluate(Trainer &tr, Glia &net);
+    // parent choice and mutation of child `index` of generation `gen` draw from the stream
+    // (seed, Breed, gen, index) (see random_streams.h), so a child doesn't depend on its siblings
+    rstream::Stream breedStream(int gen, int index) const;
+    NetSnapshot breed(const NetSnapshot &parent, const NetSnapshot *mate, rstream::Stream &rng);
+    bool crossoverDraw(rstream::Stream &rng) const;
+    // an individual's network and the trainer that trained it
+    struct Trained {
+        std::unique_ptr<Glia> net;
+        std::unique_ptr<Trainer> tr;
+    };
+
+    EvoMetrics evaluate(Trainer &tr, Glia &net, double race_acc) const;
+    Trained train(Individual &ind, int gen, int index) const;
+    // after validation: trainer profile, Lamarckian genome, telemetry
+    void finish(Individual &ind, Trained &t, int gen, int index, double seconds) const;
+    void trainAndEvaluate(Individual &ind, int gen, int index) const;
+    // shared_evaluation: train pop[todo[k]] up to `threads` at a time, then validate together
+    void trainThenEvaluateTogether(std::vector<Individual> &pop, const std::vector<int> &todo, int gen, int threads, prof::Stats &profile) const;
     double mapFitness(const EvoMetrics &m) const;
-    NetSnapshot captureNet(Glia &net) const;
+    NetSnapshot captureNet(Glia &net, const NetSnapshot *prev = nullptr) const;
+    // a genome as the population stores it (genome_fp16)
+    NetSnapshot compact(const NetSnapshot &s) const;
     void restoreNet(Glia &net, const NetSnapshot &s) const;
     void writeLineageJson(const std::string &path) const;
+    void reportGeneration(int gen, const std::vector<Individual> &pop, const std::string &detail, Result &res, double &prev_best);
+    void runSteadyState(std::vector<Individual> &initial, int first_gen, evo_remote::Dispatcher *dispatcher, Result &res, double &prev_best);
+    std::string serializeState(int next_gen, const std::vector<Individual> &pop, const Result &res, double prev_best) const;
+
+    // distributed evaluation: what coordinator and workers must agree on, and the messages
+    std::string fingerprint() const;
+    std::string jobMessage(const Individual &ind, int gen, int index) const;
+    std::string resultMessage(const Individual &ind, int gen, int index) const;
+    bool applyResult(Individual &ind, int gen, int index, const std::string &bytes) const;
+    bool workerSession(const std::string &host, int port, const std::string &fp, std::string &error) const;
+
+    // fitness_cache: metrics of the last evaluated generation by genome hash; race cutoff
+    std::unordered_map<uint64_t, EvoMetrics> metrics_cache;
+    double race_cutoff = -1.0;
+    // IDs of neurons added by structural mutation (shared_ptr: genome_ops.h stays out of this header)
+    std::shared_ptr<genome_ops::Innovations> innovations;
 
     // Lineage bookkeeping
     int next_node_id = 0;
     std::vector<LineageNode> lineage;
     std::unordered_map<int,int> id_to_index; // node_id -> lineage index
+    // lineage_memory_mb: nodes below node ID `before` (all evaluated) move to the spill file
+    // once the lineage is over budget
+    std::string lineageSpillPath() const;
+    void spillLineage(int before);
+    bool lineage_spilling = false; // the spill file belongs to this run (else it is truncated first)
+
+    // state read by loadCheckpoint() for the next run()
+    int resume_gen = -1;
+    std::vector<Individual> resume_pop;
+    Result resume_res;
+    double resume_prev_best = -1e9;
+    ckpt::AsyncWriter checkpoint_writer;
+    std::shared_ptr<ThreadPool> thread_pool, owned_pool;
+    std::shared_ptr<ThreadPool> run_pool; // pool of the current run()
+    std::shared_ptr<telemetry::Sink> telemetry_sink; // see setTelemetry()
+    prof::Stats reported_profile; // Result::profile at the last Generation record
 };
@@ -0,0 +1,221 @@
+#include "genome_ops.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace genome_ops {
+
+Genome::Genome(const NetworkSnapshot &s) : threshold(s.thresholds()), leak(s.leaks()), topo(s.sharedTopology()) {
+    s.weights(weights);
+}
+
+int Genome::handleOf(nid::Key id) const {
+    const std::vector<nid::Key> &keys = topo->keys;
+    for (size_t h = 0; h < keys.size(); ++h)
+        if (keys[h] == id) return static_cast<int>(h);
+    return -1;
+}
+
+bool Genome::hasEdge(int from, int to) const {
+    const SnapshotTopology &t = *topo;
+    for (int k = t.row_offsets[from]; k < t.row_offsets[from + 1]; ++k)
+        if (t.targets[k] == to) return true;
+    return false;
+}
+
+int Genome::rowOf(int edge) const {
+    const std::vector<int> &ro = topo->row_offsets;
+    return static_cast<int>(std::upper_bound(ro.begin(), ro.end(), edge) - ro.begin()) - 1;
+}
+
+SnapshotTopology &Genome::edit() {
+    if (!owned) {
+        owned = std::make_shared<SnapshotTopology>(*topo);
+        owned->version = SnapshotTopology::nextVersion();
+        topo = owned;
+    }
+    return *owned;
+}
+
+void Genome::insertEdge(int from, int to, float w) {
+    SnapshotTopology &t = edit();
+    const int n = t.numNeurons();
+    int k = t.row_offsets[from];
+    const int hi = t.row_offsets[from + 1];
+    while (k < hi && (t.targets[k] >= n || nid::ByName()(t.keys[t.targets[k]], t.keys[to]))) ++k;
+    t.targets.insert(t.targets.begin() + k, to);
+    weights.insert(weights.begin() + k, w);
+    for (size_t h = from + 1; h < t.row_offsets.size(); ++h) ++t.row_offsets[h];
+}
+
+void Genome::eraseEdge(int edge) {
+    const int from = rowOf(edge);
+    SnapshotTopology &t = edit();
+    t.targets.erase(t.targets.begin() + edge);
+    weights.erase(weights.begin() + edge);
+    for (size_t h = from + 1; h < t.row_offsets.size(); ++h) --t.row_offsets[h];
+}
+
+int Genome::appendNeuron(nid::Key id, float thr, float lk) {
+    SnapshotTopology &t = edit();
+    const int n = t.numNeurons();
+    // targets outside the net are numbered keys.size()
+    for (int &tgt : t.targets)
+        if (tgt == n) tgt = n + 1;
+    t.keys.push_back(id);
+    t.row_offsets.push_back(t.row_offsets.back());
+    threshold.push_back(thr);
+    leak.push_back(lk);
+    return n;
+}
+
+NetworkSnapshot Genome::snapshot(const NetworkSnapshot &parent) const {
+    return NetworkSnapshot::derive(parent, topo, threshold, leak, weights);
+}
+
+nid::Key Innovations::splitNeuron(nid::Key from, nid::Key to) {
+    auto it = splits.find(std::make_pair(from, to));
+    if (it != splits.end()) return it->second;
+    const nid::Key id = nid::intern("Hx" + std::to_string(next++));
+    splits[std::make_pair(from, to)] = id;
+    return id;
+}
+
+void Innovations::write(ckpt::Writer &w) const {
+    std::vector<std::string> flat;
+    for (const auto &kv : splits) {
+        flat.push_back(nid::name(kv.first.first));
+        flat.push_back(nid::name(kv.first.second));
+        flat.push_back(nid::name(kv.second));
+    }
+    w.strs(flat);
+    w.i32(next);
+}
+
+void Innovations::read(ckpt::Reader &r) {
+    std::vector<std::string> flat = r.strs();
+    splits.clear();
+    for (size_t i = 0; i + 2 < flat.size(); i += 3)
+        splits[std::make_pair(nid::intern(flat[i]), nid::intern(flat[i + 1]))] = nid::intern(flat[i + 2]);
+    next = r.i32();
+}
+
+void Innovations::clear() {
+    splits.clear();
+    next = 0;
+}
+
+void jitter(Genome &g, float sigma_w, float sigma_thr, float sigma_leak, rstream::Stream &rng) {
+    if (sigma_w > 0.0f) {
+        for (float &w : g.weights) w = w + rng.normal(0.0f, sigma_w);
+    }
+    if (sigma_thr > 0.0f) {
+        for (float &t : g.threshold) t = t + rng.normal(0.0f, sigma_thr);
+    }
+    if (sigma_leak > 0.0f) {
+        for (float &l : g.leak) {
+            float v = l + rng.normal(0.0f, sigma_leak);
+            if (v < 0.0f) v = 0.0f;
+            if (v > 1.0f) v = 1.0f;
+            l = v;
+        }
+    }
+}
+
+bool addEdge(Genome &g, rstream::Stream &rng) {
+    const SnapshotTopology &t = g.topology();
+    const int n = g.numNeurons();
+    std::vector<int> sources, targets;
+    for (int h = 0; h < n; ++h) {
+        const std::string &id = t.id(h);
+        const char c = id.empty() ? '\0' : id[0];
+        if (c != 'O') sources.push_back(h);
+        if (c != 'S') targets.push_back(h);
+    }
+    if (sources.empty() || targets.empty()) return false;
+    for (int attempt = 0; attempt < 32; ++attempt) {
+        const int from = sources[rng.below(static_cast<uint32_t>(sources.size()))];
+        const int to = targets[rng.below(static_cast<uint32_t>(targets.size()))];
+        if (from == to || g.hasEdge(from, to)) continue;
+        double scale = 0.0;
+        for (float w : g.weights) scale += std::fabs(w);
+        scale = g.weights.empty() ? 1.0 : scale / static_cast<double>(g.weights.size());
+        const float sign = rng.coin() ? 1.0f : -1.0f;
+        g.insertEdge(from, to, sign * static_cast<float>(scale));
+        return true;
+    }
+    return false;
+}
+
+bool removeEdge(Genome &g, rstream::Stream &rng) {
+    if (g.numEdges() == 0) return false;
+    g.eraseEdge(static_cast<int>(rng.below(static_cast<uint32_t>(g.numEdges()))));
+    return true;
+}
+
+bool addNeuron(Genome &g, Innovations &innovations, rstream::Stream &rng) {
+    if (g.numEdges() == 0) return false;
+    const int k = static_cast<int>(rng.below(static_cast<uint32_t>(g.numEdges())));
+    const int n = g.numNeurons();
+    const int from = g.rowOf(k), to = g.topology().targets[k];
+    if (to >= n) return false;
+    const nid::Key id = innovations.splitNeuron(g.topology().keys[from], g.topology().keys[to]);
+    if (g.handleOf(id) >= 0) return false;
+    const float w = g.weights[k];
+    const float thr = g.threshold[to], lk = g.leak[to];
+    g.eraseEdge(k);
+    const int relay = g.appendNeuron(id, thr, lk);
+    g.insertEdge(from, relay, std::max(thr, 0.0f) * 1.25f + 1.0f);
+    g.insertEdge(relay, to, w);
+    return true;
+}
+
+Genome crossover(const NetworkSnapshot &a, const NetworkSnapshot &b, bool by_rows, rstream::Stream &rng) {
+    Genome child(a);
+    const Genome other(b);
+    const SnapshotTopology &ta = child.topology(), &tb = other.topology();
+    const int n = ta.numNeurons();
+
+    if (&ta == &tb) {
+        // same structure: aligned by index
+        for (int h = 0; h < n; ++h) {
+            const bool row_b = by_rows && rng.coin();
+            if (by_rows ? row_b : rng.coin()) {
+                child.threshold[h] = other.threshold[h];
+                child.leak[h] = other.leak[h];
+            }
+            for (int k = ta.row_offsets[h]; k < ta.row_offsets[h + 1]; ++k)
+                if (by_rows ? row_b : rng.coin()) child.weights[k] = other.weights[k];
+        }
+        return child;
+    }
+
+    // different structures: line neurons up by ID and edges by target ID within a row
+    std::unordered_map<nid::Key, int> b_handle;
+    for (int h = 0; h < tb.numNeurons(); ++h) b_handle.emplace(tb.keys[h], h);
+    const int nb = tb.numNeurons();
+    for (int h = 0; h < n; ++h) {
+        auto it = b_handle.find(ta.keys[h]);
+        const int hb = it == b_handle.end() ? -1 : it->second;
+        const bool row_b = by_rows && rng.coin();
+        if (hb >= 0 && (by_rows ? row_b : rng.coin())) {
+            child.threshold[h] = other.threshold[hb];
+            child.leak[h] = other.leak[hb];
+        }
+        for (int k = ta.row_offsets[h]; k < ta.row_offsets[h + 1]; ++k) {
+            const bool take_b = by_rows ? row_b : rng.coin();
+            if (!take_b || hb < 0 || ta.targets[k] >= n) continue;
+            const nid::Key to = ta.keys[ta.targets[k]];
+            for (int kb = tb.row_offsets[hb]; kb < tb.row_offsets[hb + 1]; ++kb) {
+                if (tb.targets[kb] < nb && tb.keys[tb.targets[kb]] == to) {
+                    child.weights[k] = other.weights[kb];
+                    break;
+                }
+            }
+        }
+    }
+    return child;
+}
+
+} // namespace genome_ops
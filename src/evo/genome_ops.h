@@ -0,0 +1,100 @@
+// Variation operators of EvolutionEngine on index-aligned genomes
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../arch/random_streams.h"
+#include "../train/network_snapshot.h"
+#include "../train/checkpoint.h"
+
+/*
+A Genome is the editable, flat form of a NetworkSnapshot: weights per edge, threshold and
+leak per handle, and the snapshot's shared topology, which is copied only when a
+structural operator changes it. Operators are passes over these arrays (no Glia is built
+or restored), and snapshot() turns the result back into a NetworkSnapshot that shares the
+parent's topology, and stores a delta, when it can.
+
+Rows keep the snapshot's order (targets by ID, as in a neuron's connection map), so a
+restore of an edited genome only touches the rows that changed. Added neurons get the
+next handles, which is where Glia::addNeuron() puts them when restore() creates them.
+
+Innovations names the neuron that splits an edge: the same split in two lineages makes
+the same neuron, so crossover can line their offspring up by ID (as NEAT's innovation
+numbers). Crossover keeps the structure of its first (fitter) parent and takes aligned
+weights and parameters from either: by edge or by row (a neuron with all its outgoing
+edges). Parents with the same topology are aligned by index.
+*/
+namespace genome_ops {
+
+class Genome {
+public:
+    explicit Genome(const NetworkSnapshot &s);
+
+    const SnapshotTopology &topology() const { return *topo; }
+    int numNeurons() const { return topo->numNeurons(); }
+    int numEdges() const { return topo->numEdges(); }
+    int handleOf(nid::Key id) const; // -1 if absent
+    bool hasEdge(int from, int to) const;
+    int rowOf(int edge) const; // source handle of an edge
+
+    // structural edits (copy the topology on first use)
+    void insertEdge(int from, int to, float w); // at its place in the row's ID order
+    void eraseEdge(int edge);
+    int appendNeuron(nid::Key id, float threshold, float leak); // new handle
+
+    // the genome as a snapshot; shares `parent`'s topology (and stores a delta on it) when
+    // the structure is the same
+    NetworkSnapshot snapshot(const NetworkSnapshot &parent) const;
+
+    std::vector<float> weights;   // per edge
+    std::vector<float> threshold; // per handle
+    std::vector<float> leak;
+
+private:
+    SnapshotTopology &edit();
+
+    std::shared_ptr<const SnapshotTopology> topo;
+    std::shared_ptr<SnapshotTopology> owned; // topo once edited (this genome's copy)
+};
+
+class Innovations {
+public:
+    // ID of the neuron splitting from -> to ("Hx<n>", assigned on first use)
+    nid::Key splitNeuron(nid::Key from, nid::Key to);
+
+    void write(ckpt::Writer &w) const;
+    void read(ckpt::Reader &r);
+    void clear();
+
+private:
+    std::map<std::pair<nid::Key, nid::Key>, nid::Key> splits;
+    int next = 0;
+};
+
+// Gaussian jitter of every weight, threshold and leak (clamped to [0, 1]) with the given
+// deviations (0: untouched), in handle/edge order
+void jitter(Genome &g, float sigma_w, float sigma_thr, float sigma_leak, rstream::Stream &rng);
+
+// One new edge between a non-output source and a non-sensory target that aren't connected
+// yet; its weight has the mean magnitude of the genome's weights and a random sign. False
+// if no free pair was found.
+bool addEdge(Genome &g, rstream::Stream &rng);
+
+// Remove a random edge; false if there is none
+bool removeEdge(Genome &g, rstream::Stream &rng);
+
+// Split a random edge from -> to with a hidden relay neuron n (threshold and leak of `to`):
+// from -> n strong enough to fire n, n -> to with the old weight. False if there is no
+// edge or the genome already has that split.
+bool addNeuron(Genome &g, Innovations &innovations, rstream::Stream &rng);
+
+// Child with a's structure; aligned weights and parameters come from a or b at random,
+// per edge or (by_rows) per neuron row
+Genome crossover(const NetworkSnapshot &a, const NetworkSnapshot &b, bool by_rows, rstream::Stream &rng);
+
+} // namespace genome_ops
@@ -0,0 +1,374 @@
+#include "remote.h"
+#include "../train/checkpoint.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace evo_remote {
+
+namespace {
+
+const double handshake_seconds = 30.0;
+
+std::string message(Message type) {
+    ckpt::Writer w(coordinator_kind);
+    w.u32(type);
+    return w.release();
+}
+
+} // namespace
+
+#if !defined(_WIN32)
+
+namespace {
+
+#if defined(MSG_NOSIGNAL)
+const int send_flags = MSG_NOSIGNAL;
+#else
+const int send_flags = 0;
+#endif
+
+void configure(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one)); // notice vanished peers eventually
+#if defined(SO_NOSIGPIPE)
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+
+// wait until fd is readable; false on timeout (deadline in the past: don't wait)
+bool waitReadable(int fd, bool forever, std::chrono::steady_clock::time_point deadline) {
+    for (;;) {
+        int ms = -1;
+        if (!forever) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) return false;
+            ms = static_cast<int>(std::min<long long>(left, 1000000));
+        }
+        pollfd p;
+        p.fd = fd;
+        p.events = POLLIN;
+        p.revents = 0;
+        const int r = poll(&p, 1, ms);
+        if (r > 0) return true;
+        if (r < 0 && errno != EINTR) return true; // let recv() report it
+    }
+}
+
+} // namespace
+
+Connection &Connection::operator=(Connection &&o) {
+    if (this != &o) {
+        close();
+        fd = o.fd;
+        o.fd = -1;
+    }
+    return *this;
+}
+
+Connection Connection::connect(const std::string &host, int port, std::string &error) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *list = nullptr;
+    const int r = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &list);
+    if (r != 0) {
+        error = "cannot resolve " + host + ": " + gai_strerror(r);
+        return Connection();
+    }
+    int fd = -1;
+    for (addrinfo *a = list; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    if (fd < 0) {
+        error = "cannot connect to " + host + ":" + std::to_string(port);
+        return Connection();
+    }
+    configure(fd);
+    return Connection(fd);
+}
+
+bool Connection::send(const std::string &bytes) {
+    if (fd < 0) return false;
+    const uint64_t n = bytes.size();
+    std::string frame(reinterpret_cast<const char *>(&n), sizeof(n));
+    frame += bytes;
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        const ssize_t k = ::send(fd, frame.data() + sent, frame.size() - sent, send_flags);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        sent += static_cast<size_t>(k);
+    }
+    return true;
+}
+
+Connection::Status Connection::receive(std::string &bytes, double timeout_s, uint64_t limit) {
+    if (fd < 0) return Closed;
+    const bool forever = timeout_s < 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<long long>(forever ? 0.0 : timeout_s * 1e6));
+    auto readExact = [&](char *dst, size_t n) -> Status {
+        size_t got = 0;
+        while (got < n) {
+            if (!waitReadable(fd, forever, deadline)) return Timeout;
+            const ssize_t k = ::recv(fd, dst + got, n - got, 0);
+            if (k < 0 && errno == EINTR) continue;
+            if (k <= 0) return Closed;
+            got += static_cast<size_t>(k);
+        }
+        return Ok;
+    };
+    uint64_t n = 0;
+    Status s = readExact(reinterpret_cast<char *>(&n), sizeof(n));
+    if (s != Ok) return s;
+    if (n > limit) return Closed;
+    bytes.resize(static_cast<size_t>(n));
+    return n ? readExact(&bytes[0], bytes.size()) : Ok;
+}
+
+void Connection::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+std::string Connection::peer() const {
+    sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) return "?";
+    char host[NI_MAXHOST], port[NI_MAXSERV];
+    if (getnameinfo(reinterpret_cast<sockaddr *>(&addr), len, host, sizeof(host), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV) != 0) return "?";
+    return std::string(host) + ":" + port;
+}
+
+bool Dispatcher::start(int port, const std::string &fp, double timeout_s, std::string &error) {
+    stop();
+    fingerprint = fp;
+    timeout = timeout_s;
+    stopping = false;
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        error = "cannot create a socket";
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+        error = "cannot listen on port " + std::to_string(port);
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    acceptor = std::thread(&Dispatcher::acceptLoop, this);
+    return true;
+}
+
+void Dispatcher::acceptLoop() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> g(lock);
+            if (stopping) return;
+        }
+        // poll in slices so stop() is noticed
+        if (!waitReadable(listen_fd, false, std::chrono::steady_clock::now() + std::chrono::milliseconds(200))) continue;
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+        configure(fd);
+        std::lock_guard<std::mutex> g(lock);
+        if (stopping) {
+            ::close(fd);
+            return;
+        }
+        // join the sessions that have returned, so a long run doesn't collect a thread
+        // per connection it ever accepted
+        for (std::thread::id id : finished) {
+            auto t = std::find_if(sessions.begin(), sessions.end(), [&](const std::thread &s) { return s.get_id() == id; });
+            t->join(); // it only has to exit: it recorded its id last
+            sessions.erase(t);
+        }
+        finished.clear();
+        sessions.emplace_back([this](Connection conn) {
+            serve(std::move(conn));
+            std::lock_guard<std::mutex> g(lock);
+            finished.push_back(std::this_thread::get_id());
+        }, Connection(fd));
+    }
+}
+
+void Dispatcher::stop() {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        if (listen_fd < 0 && !acceptor.joinable()) return;
+        stopping = true;
+    }
+    changed.notify_all();
+    if (acceptor.joinable()) acceptor.join();
+    for (auto &t : sessions) t.join(); // the acceptor is gone, so nothing adds to `sessions`
+    sessions.clear();
+    finished.clear();
+    if (listen_fd >= 0) ::close(listen_fd);
+    listen_fd = -1;
+}
+
+#else
+
+Connection &Connection::operator=(Connection &&o) {
+    fd = o.fd;
+    o.fd = -1;
+    return *this;
+}
+
+Connection Connection::connect(const std::string &, int, std::string &error) {
+    error = "distributed evolution needs POSIX sockets";
+    return Connection();
+}
+
+bool Connection::send(const std::string &) { return false; }
+
+Connection::Status Connection::receive(std::string &, double, uint64_t) { return Closed; }
+
+void Connection::close() { fd = -1; }
+
+std::string Connection::peer() const { return "?"; }
+
+bool Dispatcher::start(int, const std::string &, double, std::string &error) {
+    error = "distributed evolution needs POSIX sockets";
+    return false;
+}
+
+void Dispatcher::acceptLoop() {}
+
+void Dispatcher::stop() {}
+
+#endif
+
+void Dispatcher::serve(Connection conn) {
+    const std::string who = conn.peer();
+    std::string bytes;
+    ckpt::Reader r;
+    // anyone may connect, so nothing large is read before the fingerprint matched
+    if (conn.receive(bytes, handshake_seconds, max_handshake) != Connection::Ok || !r.openBytes(bytes, worker_kind, "message from " + who) || r.u32() != Hello)
+        return;
+    const std::string theirs = r.str();
+    if (theirs != fingerprint) {
+        ckpt::Writer w(coordinator_kind);
+        w.u32(Reject);
+        w.str("network, data or configuration differ from the coordinator's");
+        conn.send(w.release());
+        std::cerr << "Warning: rejected worker " << who << " (fingerprint mismatch)" << std::endl;
+        return;
+    }
+    if (!conn.send(message(Welcome))) return;
+    const int total = ++connected;
+    std::cout << "Worker " << who << " connected (" << total << " total)" << std::endl;
+
+    std::unique_lock<std::mutex> lk(lock);
+    for (;;) {
+        const int job = claim(lk);
+        if (job < 0) break;
+        const std::function<std::string(int)> &encode = *encode_fn;
+        const std::function<bool(int, const std::string &)> &decode = *decode_fn;
+        lk.unlock();
+        Connection::Status status = conn.send(encode(job)) ? conn.receive(bytes, timeout, max_message) : Connection::Closed;
+        const bool done = status == Connection::Ok && decode(job, bytes);
+        if (!done)
+            std::cerr << "Warning: worker " << who << (status == Connection::Timeout ? " timed out" : status == Connection::Closed ? " disconnected" : " sent a malformed result")
+                      << "; individual " << job << " re-queued" << std::endl;
+        lk.lock();
+        finish(job, done);
+        if (!done) {
+            --connected;
+            return;
+        }
+    }
+    lk.unlock();
+    --connected;
+    conn.send(message(Bye));
+}
+
+int Dispatcher::claim(std::unique_lock<std::mutex> &lk) {
+    changed.wait(lk, [&] { return stopping || (active && !queue.empty()); });
+    if (stopping) return -1;
+    const int job = queue.front();
+    queue.pop_front();
+    return job;
+}
+
+void Dispatcher::finish(int job, bool done) {
+    if (done) --remaining;
+    else queue.push_front(job); // first in line again
+    changed.notify_all();
+}
+
+void Dispatcher::run(int n,
+                     const std::function<std::string(int)> &encode,
+                     const std::function<bool(int, const std::string &)> &decode,
+                     const std::function<void(int)> &local,
+                     ThreadPool &pool,
+                     int local_parallel) {
+    if (n <= 0) return;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        encode_fn = &encode;
+        decode_fn = &decode;
+        queue.clear();
+        for (int i = 0; i < n; ++i) queue.push_back(i);
+        remaining = n;
+        active = true;
+    }
+    changed.notify_all();
+    if (local_parallel <= 0 && connected.load() == 0) std::cout << "Waiting for workers..." << std::endl;
+
+    // local runners take jobs from the same queue while it has any and then return: a
+    // runner must not wait on the pool, which may start it inside a job's nested
+    // parallelFor. Jobs a lost worker hands back later get a new round of runners.
+    auto runner = [&](int) {
+        std::unique_lock<std::mutex> lk(lock);
+        while (!queue.empty()) {
+            const int job = queue.front();
+            queue.pop_front();
+            lk.unlock();
+            local(job);
+            lk.lock();
+            finish(job, true);
+        }
+    };
+
+    std::unique_lock<std::mutex> lk(lock);
+    for (;;) {
+        changed.wait(lk, [&] { return remaining == 0 || (local_parallel > 0 && !queue.empty()); });
+        if (remaining == 0) break;
+        lk.unlock();
+        pool.parallelFor(local_parallel, runner, local_parallel);
+        lk.lock();
+    }
+    active = false;
+    encode_fn = nullptr;
+    decode_fn = nullptr;
+}
+
+} // namespace evo_remote
@@ -0,0 +1,133 @@
+// Coordinator/worker transport for distributed evolution (see EvolutionEngine::Config::listen_port
+// and EvolutionEngine::serveWorker)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../arch/thread_pool.h"
+
+/*
+Messages are ckpt::Writer buffers (see checkpoint.h) sent over TCP with a uint64 length
+prefix. The coordinator's are of kind "evo-coordinator", the workers' "evo-worker"; the
+first field is the message type:
+
+    worker       Hello(fingerprint)       after connecting
+    coordinator  Welcome | Reject(why)    the fingerprint must match the coordinator's
+    coordinator  Job(gen, index, race cutoff, genome)  one individual to train and evaluate
+    worker       Result(gen, index, metrics, genome)
+    coordinator  Bye                      the run is over
+
+A worker process evaluates one job per connection at a time and opens one connection per
+local evaluation thread. POSIX sockets only; on Windows connecting and listening fail.
+*/
+namespace evo_remote {
+
+enum Message : uint32_t { Hello = 1, Welcome = 2, Reject = 3, Job = 4, Result = 5, Bye = 6 };
+
+const char coordinator_kind[] = "evo-coordinator";
+const char worker_kind[] = "evo-worker";
+
+// receive() limits: handshakes carry a fingerprint, jobs and results a genome
+const uint64_t max_handshake = uint64_t(64) << 10;
+const uint64_t max_message = uint64_t(1) << 34;
+
+// one TCP stream of length-prefixed messages; closed on destruction
+class Connection {
+public:
+    enum Status { Ok, Closed, Timeout };
+
+    Connection() {}
+    explicit Connection(int socket_fd) : fd(socket_fd) {}
+    ~Connection() { close(); }
+    Connection(Connection &&o) : fd(o.fd) { o.fd = -1; }
+    Connection &operator=(Connection &&o);
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    // invalid (with a message in error) if the host can't be reached
+    static Connection connect(const std::string &host, int port, std::string &error);
+
+    bool valid() const { return fd >= 0; }
+    bool send(const std::string &bytes);
+    // next message; Timeout if none completed within timeout_s seconds (< 0: wait forever),
+    // Closed if the other end announces more than `limit` bytes
+    Status receive(std::string &bytes, double timeout_s, uint64_t limit);
+    void close();
+    // "host:port" of the other end
+    std::string peer() const;
+
+private:
+    int fd = -1;
+};
+
+/*
+Coordinator side: accepts workers on a port and runs batches of jobs on them. A job a
+worker doesn't answer within `timeout` seconds, or whose connection breaks, goes back
+to the queue and that connection is dropped (the worker process reconnects), so slow
+or dead machines only delay the jobs they held. Jobs may also run locally on the
+coordinator's pool; each job is held by one runner at a time, so every job's result is
+applied exactly once.
+*/
+class Dispatcher {
+public:
+    Dispatcher() {}
+    ~Dispatcher() { stop(); }
+    Dispatcher(const Dispatcher &) = delete;
+    Dispatcher &operator=(const Dispatcher &) = delete;
+
+    // listen on `port` for workers whose Hello carries `fingerprint`; false (with a message
+    // in error) if the port can't be bound
+    bool start(int port, const std::string &fingerprint, double timeout, std::string &error);
+    // send Bye to every worker and close
+    void stop();
+
+    int workers() const { return connected.load(); }
+
+    // Run jobs 0..n-1 and return when all are done. encode(i) builds job i's message,
+    // decode(i, bytes) applies a worker's Result (false: malformed, the job is re-queued);
+    // both are called on connection threads. When local_parallel > 0, up to that many
+    // jobs also run as local(i) on `pool`.
+    void run(int n,
+             const std::function<std::string(int)> &encode,
+             const std::function<bool(int, const std::string &)> &decode,
+             const std::function<void(int)> &local,
+             ThreadPool &pool,
+             int local_parallel);
+
+private:
+    void acceptLoop();
+    void serve(Connection conn);
+    int claim(std::unique_lock<std::mutex> &lock); // pending job or -1 (waits while none)
+    void finish(int job, bool done);
+
+    std::string fingerprint;
+    double timeout = 0.0;
+    int listen_fd = -1;
+    std::thread acceptor;
+    std::vector<std::thread> sessions;
+    std::vector<std::thread::id> finished; // sessions that returned, joined by the acceptor
+    std::atomic<int> connected{0};
+
+    std::mutex lock;
+    std::condition_variable changed;
+    bool stopping = false;
+    // current batch
+    bool active = false;
+    std::deque<int> queue;
+    int remaining = 0;
+    const std::function<std::string(int)> *encode_fn = nullptr;
+    const std::function<bool(int, const std::string &)> *decode_fn = nullptr;
+};
+
+} // namespace evo_remote
@@ -0,0 +1,238 @@
+#include "sweep_engine.h"
+#include "../train/gradient/rate_gd_trainer.h"
+#include "../train/gradient/bptt_trainer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+typedef void (*FieldSetter)(TrainingConfig &, double);
+struct Field { const char *name; FieldSetter set; };
+
+#define SWEEP_FLOAT(path) { #path, [](TrainingConfig &c, double v) { c.path = static_cast<float>(v); } }
+#define SWEEP_INT(path) { #path, [](TrainingConfig &c, double v) { c.path = static_cast<int>(std::lround(v)); } }
+
+const Field kFields[] = {
+    SWEEP_FLOAT(lr), SWEEP_FLOAT(elig_lambda), SWEEP_FLOAT(weight_decay), SWEEP_FLOAT(margin_delta),
+    SWEEP_FLOAT(reward_pos), SWEEP_FLOAT(reward_neg), SWEEP_FLOAT(reward_gain), SWEEP_FLOAT(reward_min),
+    SWEEP_FLOAT(reward_max), SWEEP_FLOAT(baseline_beta), SWEEP_FLOAT(r_target), SWEEP_FLOAT(rate_alpha),
+    SWEEP_FLOAT(eta_theta), SWEEP_FLOAT(eta_leak), SWEEP_FLOAT(prune_epsilon), SWEEP_FLOAT(init_weight),
+    SWEEP_FLOAT(weight_clip), SWEEP_FLOAT(weight_jitter_std), SWEEP_FLOAT(usage_boost_gain),
+    SWEEP_FLOAT(inactive_rate_threshold), SWEEP_FLOAT(revert_drop),
+    SWEEP_INT(warmup_ticks), SWEEP_INT(decision_window), SWEEP_INT(episode_ticks), SWEEP_INT(prune_patience),
+    SWEEP_INT(grow_edges), SWEEP_INT(batch_size), SWEEP_INT(timing_jitter), SWEEP_INT(inactive_rate_patience),
+    SWEEP_INT(prune_inactive_max),
+    SWEEP_FLOAT(detector.alpha), SWEEP_FLOAT(detector.threshold), SWEEP_FLOAT(detector.early_exit_margin),
+    SWEEP_INT(detector.window),
+    SWEEP_FLOAT(grad.temperature), SWEEP_FLOAT(grad.momentum), SWEEP_FLOAT(grad.adam_beta1),
+    SWEEP_FLOAT(grad.adam_beta2), SWEEP_FLOAT(grad.adam_eps), SWEEP_FLOAT(grad.clip_grad_norm),
+    SWEEP_FLOAT(grad.surrogate_beta), SWEEP_INT(grad.bptt_window),
+};
+
+#undef SWEEP_FLOAT
+#undef SWEEP_INT
+
+const Field *findField(const std::string &name) {
+    for (const Field &f : kFields)
+        if (name == f.name) return &f;
+    return nullptr;
+}
+
+} // namespace
+
+struct SweepEngine::Runner {
+    virtual ~Runner() {}
+    virtual void train(const std::vector<Trainer::EpisodeData> &data, int epochs, const TrainingConfig &cfg) = 0;
+    virtual DatasetMetrics evaluateDataset(const std::vector<Trainer::EpisodeData> &data, const TrainingConfig &cfg) = 0;
+    virtual std::vector<double> accHistory() const = 0;
+    virtual const prof::Stats &profile() const = 0;
+};
+
+template <class T>
+struct SweepEngine::TrainerRunner : SweepEngine::Runner {
+    Glia net;
+    T tr;
+    TrainerRunner(const Glia &base, unsigned int seed, const std::shared_ptr<ThreadPool> &pool) : net(base), tr(net) {
+        tr.reseed(seed);
+        tr.setThreadPool(pool);
+    }
+    void train(const std::vector<Trainer::EpisodeData> &data, int epochs, const TrainingConfig &cfg) override { tr.trainEpoch(data, epochs, cfg); }
+    DatasetMetrics evaluateDataset(const std::vector<Trainer::EpisodeData> &data, const TrainingConfig &cfg) override { return tr.evaluateDataset(data, cfg); }
+    std::vector<double> accHistory() const override { return tr.getEpochAccHistory(); }
+    const prof::Stats &profile() const override { return tr.profile(); }
+};
+
+SweepEngine::SweepEngine(const std::string &net_path,
+                         const std::vector<Trainer::EpisodeData> &train_set,
+                         const std::vector<Trainer::EpisodeData> &val_set,
+                         const TrainingConfig &base_cfg,
+                         const std::vector<Param> &space,
+                         const Config &sweep_cfg)
+    : train_set(train_set), val_set(val_set), base_cfg(base_cfg), sweep_cfg(sweep_cfg)
+{
+    base_net.setBuildSeed(sweep_cfg.seed);
+    base_net.configureNetworkFromFile(net_path, /*verbose=*/false);
+    for (const Param &p : space) {
+        if (findField(p.name)) this->space.push_back(p);
+        else std::cerr << "Warning: sweep parameter '" << p.name << "' is not a TrainingConfig field; ignored" << std::endl;
+    }
+    // trials training side by side mustn't overwrite each other's checkpoint file
+    this->base_cfg.checkpoint_path.clear();
+}
+
+std::vector<std::string> SweepEngine::fieldNames() {
+    std::vector<std::string> names;
+    for (const Field &f : kFields) names.push_back(f.name);
+    return names;
+}
+
+bool SweepEngine::setField(TrainingConfig &cfg, const std::string &name, double value) {
+    const Field *f = findField(name);
+    if (!f) return false;
+    f->set(cfg, value);
+    return true;
+}
+
+// Values of each trial, by param: the full grid (last param varying fastest) or
+// sweep_cfg.trials random draws
+std::vector<std::vector<double>> SweepEngine::drawConfigurations() {
+    std::vector<std::vector<double>> out;
+    if (sweep_cfg.trials <= 0) {
+        for (const Param &p : space) {
+            if (p.values.empty()) {
+                std::cerr << "Warning: sweep parameter '" << p.name << "' has no values for a grid search; set Config::trials to draw from its range" << std::endl;
+                return out;
+            }
+        }
+        std::vector<size_t> at(space.size(), 0);
+        while (true) {
+            std::vector<double> v(space.size());
+            for (size_t i = 0; i < space.size(); ++i) v[i] = space[i].values[at[i]];
+            out.push_back(v);
+            size_t i = space.size();
+            while (i > 0 && ++at[i - 1] == space[i - 1].values.size()) { at[i - 1] = 0; --i; }
+            if (i == 0) break;
+        }
+        return out;
+    }
+    for (int t = 0; t < sweep_cfg.trials; ++t) {
+        // trial t draws from its own stream, so it is the same whatever the number of trials
+        rstream::Stream rng(rstream::key(sweep_cfg.seed, rstream::SweepDraw, static_cast<uint64_t>(t)));
+        std::vector<double> v(space.size());
+        for (size_t i = 0; i < space.size(); ++i) {
+            const Param &p = space[i];
+            if (!p.values.empty()) {
+                v[i] = p.values[rng.below(static_cast<uint32_t>(p.values.size()))];
+            } else if (p.log_scale && p.lo > 0.0 && p.hi > 0.0) {
+                v[i] = std::exp(std::log(p.lo) + rng.uniform() * (std::log(p.hi) - std::log(p.lo)));
+            } else {
+                v[i] = p.lo + rng.uniform() * (p.hi - p.lo);
+            }
+        }
+        out.push_back(v);
+    }
+    return out;
+}
+
+std::unique_ptr<SweepEngine::Runner> SweepEngine::makeRunner(const Trial &t, const std::shared_ptr<ThreadPool> &pool) const {
+    const unsigned int seed = sweep_cfg.seed + static_cast<unsigned int>(t.index);
+    if (sweep_cfg.trainer == "rate_gd") return std::unique_ptr<Runner>(new TrainerRunner<RateGDTrainer>(base_net, seed, pool));
+    if (sweep_cfg.trainer == "bptt") return std::unique_ptr<Runner>(new TrainerRunner<BpttTrainer>(base_net, seed, pool));
+    return std::unique_ptr<Runner>(new TrainerRunner<Trainer>(base_net, seed, pool));
+}
+
+SweepEngine::Result SweepEngine::run() {
+    Result res;
+    if (sweep_cfg.trainer != "hebbian" && sweep_cfg.trainer != "rate_gd" && sweep_cfg.trainer != "bptt")
+        std::cerr << "Warning: unknown sweep trainer '" << sweep_cfg.trainer << "'; using hebbian" << std::endl;
+    const std::vector<std::vector<double>> configs = drawConfigurations();
+    const int N = static_cast<int>(configs.size());
+    res.trials.resize(N);
+    for (int t = 0; t < N; ++t) {
+        Trial &trial = res.trials[t];
+        trial.index = t;
+        trial.values = configs[t];
+        trial.config = base_cfg;
+        for (size_t i = 0; i < space.size(); ++i) setField(trial.config, space[i].name, trial.values[i]);
+    }
+    std::shared_ptr<ThreadPool> run_pool = ThreadPool::resolve(thread_pool, sweep_cfg.pool_threads, owned_pool);
+    const int T = std::max(1, sweep_cfg.threads);
+    const int eta = std::max(1, sweep_cfg.eta);
+    const int max_epochs = std::max(1, std::max(sweep_cfg.min_epochs, sweep_cfg.max_epochs));
+    int rung_epochs = eta > 1 ? std::max(1, sweep_cfg.min_epochs) : max_epochs;
+
+    std::cout << "Sweep start\n"
+              << "  trials=" << N << "  params=" << space.size()
+              << "  epochs=" << rung_epochs << ".." << max_epochs << "  eta=" << eta
+              << "  trainer=" << sweep_cfg.trainer << "  threads=" << T << "\n";
+
+    std::vector<std::unique_ptr<Runner>> runners(N);
+    std::vector<int> live(N);
+    for (int t = 0; t < N; ++t) live[t] = t;
+    auto lastAcc = [&](int t) { const std::vector<double> &h = res.trials[t].epoch_acc_hist; return h.empty() ? 0.0 : h.back(); };
+    auto retire = [&](int t) {
+        Trial &trial = res.trials[t];
+        if (runners[t]) trial.profile.merge(runners[t]->profile());
+        runners[t].reset();
+        res.profile.merge(trial.profile);
+        res.epochs_trained += static_cast<int>(trial.epoch_acc_hist.size());
+    };
+
+    for (int rung = 0; N > 0; ++rung) {
+        const int target = std::min(rung_epochs, max_epochs);
+        run_pool->parallelFor(static_cast<int>(live.size()), [&](int k) {
+            const int t = live[k];
+            Trial &trial = res.trials[t];
+            GLIA_PROF_BIND(&trial.profile);
+            if (!runners[t]) runners[t] = makeRunner(trial, run_pool);
+            const int done = static_cast<int>(trial.epoch_acc_hist.size());
+            if (!train_set.empty() && target > done) runners[t]->train(train_set, target - done, trial.config);
+            trial.epoch_acc_hist = runners[t]->accHistory();
+            trial.score = trial.epoch_acc_hist.empty() ? 0.0 : trial.epoch_acc_hist.back();
+        }, T);
+        res.rung_epochs.push_back(target);
+
+        // standings by the rung's accuracy (ties to the lower index)
+        std::stable_sort(live.begin(), live.end(), [&](int a, int b) { return lastAcc(a) > lastAcc(b); });
+        const bool last = target >= max_epochs;
+        const size_t keep = last ? live.size() : std::max<size_t>(1, live.size() / eta);
+        if (sweep_cfg.verbose) {
+            std::cout << "Rung " << rung << ": epochs=" << target << "  live=" << live.size()
+                      << "  best acc=" << lastAcc(live[0]) << " (trial " << live[0] << ")"
+                      << "  kept=" << keep << "\n";
+        }
+        if (last) break;
+        for (size_t k = keep; k < live.size(); ++k) {
+            res.trials[live[k]].pruned_at = rung;
+            retire(live[k]);
+        }
+        live.resize(keep);
+        std::sort(live.begin(), live.end());
+        rung_epochs *= eta;
+    }
+
+    // finished trials: accuracy on the validation set
+    if (!val_set.empty()) {
+        run_pool->parallelFor(static_cast<int>(live.size()), [&](int k) {
+            const int t = live[k];
+            Trial &trial = res.trials[t];
+            GLIA_PROF_BIND(&trial.profile);
+            GLIA_PROF_SCOPE(Evaluate);
+            trial.score = runners[t]->evaluateDataset(val_set, trial.config).accuracy;
+        }, T);
+    }
+    for (int t : live) {
+        retire(t);
+        if (res.best < 0 || res.trials[t].score > res.trials[res.best].score ||
+            (res.trials[t].score == res.trials[res.best].score && t < res.best)) res.best = t;
+    }
+    if (res.best >= 0) {
+        const Trial &b = res.trials[res.best];
+        std::cout << "Sweep done: best trial " << b.index << " score=" << b.score << " (";
+        for (size_t i = 0; i < space.size(); ++i) std::cout << (i ? " " : "") << space[i].name << "=" << b.values[i];
+        std::cout << ")  epochs trained=" << res.epochs_trained << "\n";
+    }
+    return res;
+}
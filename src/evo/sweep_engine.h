@@ -0,0 +1,116 @@
+// Hyperparameter sweeps for Glia trainers
+// - Grid or random search over TrainingConfig fields
+// - Trials run in parallel, each on its own copy of the network
+// - Successive halving: trials behind at a rung's epoch accuracy are dropped
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "../arch/glia.h"
+#include "../arch/profiling.h"
+#include "../arch/random_streams.h"
+#include "../arch/thread_pool.h"
+#include "../train/trainer.h"
+#include "../train/training_config.h"
+
+class SweepEngine {
+public:
+    // One searched field of TrainingConfig, by its name ("lr", "elig_lambda",
+    // "detector.alpha", "grad.temperature", ...; see fieldNames()). Integer fields take
+    // the value rounded.
+    struct Param {
+        std::string name;
+        std::vector<double> values;  // values to try; if empty, drawn from [lo, hi]
+        double lo = 0.0;
+        double hi = 1.0;
+        bool log_scale = false;      // draw log-uniformly (lo and hi > 0)
+    };
+
+    struct Config {
+        // Trials: 0 tries every combination of the params' values (all must have values);
+        // otherwise this many random configurations, each param drawn from its values or
+        // range
+        int trials = 0;
+
+        // Successive halving. Every live trial trains until min_epochs; the best 1/eta of
+        // them by their last epoch's training accuracy (Trainer::getEpochAccHistory())
+        // carry on to eta times as many epochs, and so on up to max_epochs. Trials keep
+        // their network and trainer between rungs, so a survivor trains exactly as it
+        // would have in one go. eta <= 1 trains every trial for max_epochs.
+        int min_epochs = 1;
+        int max_epochs = 9;
+        int eta = 3;
+
+        // "hebbian" (Trainer), "rate_gd" (RateGDTrainer) or "bptt" (BpttTrainer)
+        std::string trainer = "hebbian";
+
+        // Trial t's trainer is seeded with seed + t, and its random-search values come from
+        // the stream (seed, SweepDraw, t)
+        unsigned int seed = 123456u;
+
+        // Trials trained at once. Each has its own Glia/Trainer and the rung's order is by
+        // trial index, so results don't depend on this.
+        int threads = 1;
+        // Threads of the pool that runs trials and their trainers' batch workers (0 = the
+        // process-wide pool; ignored when setThreadPool() was called)
+        int pool_threads = 0;
+
+        bool verbose = false; // print each rung's standings
+    };
+
+    struct Trial {
+        int index = 0;
+        std::vector<double> values;        // by param, as applied
+        TrainingConfig config;             // the base configuration with the values applied
+        std::vector<double> epoch_acc_hist;
+        int pruned_at = -1;                // rung after which the trial was dropped (-1: ran to max_epochs)
+        double score = 0.0;                // validation accuracy (without val_set: last epoch accuracy)
+        prof::Stats profile;
+    };
+
+    struct Result {
+        std::vector<Trial> trials;         // by index
+        int best = -1;                     // index of the trial with the highest score among the finished ones
+        std::vector<int> rung_epochs;      // epochs at the end of each rung
+        int epochs_trained = 0;            // summed over trials
+        // phases and counters of the whole sweep, summed over trials and worker threads
+        // (all zero unless built with GLIA_PROFILE, see profiling.h)
+        prof::Stats profile;
+    };
+
+    // Params naming unknown fields are dropped with a warning.
+    SweepEngine(const std::string &net_path,
+                const std::vector<Trainer::EpisodeData> &train_set,
+                const std::vector<Trainer::EpisodeData> &val_set,
+                const TrainingConfig &base_cfg,
+                const std::vector<Param> &space,
+                const Config &sweep_cfg);
+
+    Result run();
+
+    // pool for run() and the trainers it creates (see Config::pool_threads)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+
+    // the TrainingConfig fields a Param can name, and setting one (false for an unknown name)
+    static std::vector<std::string> fieldNames();
+    static bool setField(TrainingConfig &cfg, const std::string &name, double value);
+
+private:
+    // a trial's network and trainer, alive while the trial is (one per trainer type)
+    struct Runner;
+    template <class T> struct TrainerRunner;
+
+    Glia base_net; // net_path parsed once; trials are built as copies of it
+    std::vector<Trainer::EpisodeData> train_set;
+    std::vector<Trainer::EpisodeData> val_set;
+    TrainingConfig base_cfg;
+    std::vector<Param> space;
+    Config sweep_cfg;
+    std::shared_ptr<ThreadPool> thread_pool, owned_pool;
+
+    std::vector<std::vector<double>> drawConfigurations();
+    std::unique_ptr<Runner> makeRunner(const Trial &t, const std::shared_ptr<ThreadPool> &pool) const;
+};
@@ -0,0 +1,826 @@
+#include "inference_server.h"
+#include "../arch/glia.h"
+#include "../arch/neuron.h"
+#include "../arch/compiled_network.h"
+#include "../arch/gnet_format.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// index of the lowest set bit (bits != 0)
+inline int lowestBit(uint64_t bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int k = 0;
+    while (!(bits & 1)) { bits >>= 1; ++k; }
+    return k;
+#endif
+}
+
+std::unique_ptr<SlotDetector> makeDetector(const OutputDetectorConfig &d, int decision_window)
+{
+    OutputDetectorOptions opts;
+    opts.threshold = d.threshold;
+    opts.default_id = d.default_id;
+    const int window = d.window > 0 ? d.window : decision_window;
+    if (d.type == "count") return std::unique_ptr<SlotDetector>(new WindowCountDetector(window, opts));
+    if (d.type == "first_spike") return std::unique_ptr<SlotDetector>(new FirstSpikeDetector(window, opts));
+    return std::unique_ptr<SlotDetector>(new EMASlotDetector(d.alpha, opts));
+}
+
+} // namespace
+
+// =====================================================================================
+// InferenceModel
+// =====================================================================================
+
+bool InferenceModel::build(Glia &net)
+{
+    CompiledNetwork *cn = net.getCompiled();
+    if (!cn)
+    {
+        std::cerr << "InferenceModel: network can't be compiled" << std::endl;
+        return false;
+    }
+    if (!cn->basicDynamics())
+    {
+        std::cerr << "InferenceModel: synaptic delays and neuron models other than lif are not supported" << std::endl;
+        return false;
+    }
+    const int n = cn->size();
+    num_neurons = n;
+    num_sensory = cn->num_sensory;
+
+    ids.resize(n);
+    for (int i = 0; i < n; ++i) ids[i] = cn->neuronAt(i)->getId();
+    indexIds();
+
+    std::shared_ptr<Params> p = std::make_shared<Params>();
+    p->threshold = cn->threshold;
+    p->leak = cn->leak;
+    p->resting = cn->resting;
+    p->init_value.resize(n);
+    for (int i = 0; i < n; ++i) p->init_value[i] = cn->valueAt(i);
+    p->init_delta = cn->delta;
+    p->init_on_deck = cn->on_deck;
+    p->init_refractory = cn->refractory;
+    params = p;
+    topo = cn->topology();
+    image.reset();
+    fixed.reset();
+    bindFloat();
+    bindFixed();
+    return true;
+}
+
+bool InferenceModel::load(const std::string &path)
+{
+    if (isImageFile(path)) return attach(path);
+    Glia net;
+    net.configureNetworkFromFile(path, false);
+    if (net.getAllNeuronIDs().empty())
+    {
+        std::cerr << "InferenceModel: no neurons loaded from " << path << std::endl;
+        return false;
+    }
+    return build(net);
+}
+
+void InferenceModel::indexIds()
+{
+    sensory_index.clear();
+    output_ids.clear();
+    output_handles.clear();
+    for (int i = 0; i < num_neurons; ++i)
+    {
+        if (i < num_sensory) sensory_index[ids[i]] = i;
+        if (!ids[i].empty() && ids[i][0] == 'O')
+        {
+            output_ids.push_back(ids[i]);
+            output_handles.push_back(i);
+        }
+    }
+}
+
+void InferenceModel::bindFloat()
+{
+    Arrays &a = arrays;
+    if (image) return; // attach() points into the mapping
+    a.threshold = params->threshold.data();
+    a.leak = params->leak.data();
+    a.resting = params->resting.data();
+    a.init_value = params->init_value.data();
+    a.init_delta = params->init_delta.data();
+    a.init_on_deck = params->init_on_deck.data();
+    a.init_refractory = params->init_refractory.data();
+    a.row_offsets = topo->row_offsets.data();
+    a.row_split = topo->row_split.data();
+    a.targets = topo->targets.data();
+    a.weights = topo->weights.data();
+    a.num_edges = topo->numEdges();
+}
+
+void InferenceModel::bindFixed()
+{
+    Arrays &a = arrays;
+    if (!fixed)
+    {
+        a.bits = 0;
+        return;
+    }
+    a.bits = fixed->bits;
+    a.scale = fixed->scale.data();
+    a.qthreshold = fixed->threshold.data();
+    a.qresting = fixed->resting.data();
+    a.qleak = fixed->leak.data();
+    a.qinit_value = fixed->init_value.data();
+    a.qinit_delta = fixed->init_delta.data();
+    a.qinit_on_deck = fixed->init_on_deck.data();
+    a.qweights = fixed->bits == 8 ? static_cast<const void *>(fixed->weights8.data()) : static_cast<const void *>(fixed->weights16.data());
+}
+
+// -------------------------------------------------------------------------------------
+// Model images (see inference_server.h)
+// -------------------------------------------------------------------------------------
+
+namespace {
+
+const char image_magic[4] = {'G', 'I', 'M', 'G'};
+const uint32_t image_version = 1;
+
+enum Section
+{
+    Threshold, Leak, Resting,
+    InitValue, InitDelta, InitOnDeck, InitRefractory,
+    RowOffsets, RowSplit, Targets, Weights,
+    IdOffsets, IdStrings,
+    QScale, QThreshold, QResting, QLeak, QInitValue, QInitDelta, QInitOnDeck, QWeights,
+    NumSections
+};
+
+struct ImageHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t num_neurons;
+    uint32_t num_sensory;
+    uint32_t num_edges;
+    uint32_t weight_bits;
+    uint64_t offset[NumSections];
+    uint64_t bytes[NumSections];
+};
+
+uint64_t align8(uint64_t x) { return (x + 7) & ~static_cast<uint64_t>(7); }
+
+// bytes section s must have for the header's counts
+uint64_t expectedBytes(int s, const ImageHeader &h)
+{
+    const uint64_t n = h.num_neurons, e = h.num_edges;
+    switch (s)
+    {
+    case RowOffsets: return (n + 1) * 4;
+    case Targets: case Weights: return e * 4;
+    case IdOffsets: return (n + 1) * 4;
+    case IdStrings: return h.bytes[IdStrings]; // checked against the offsets
+    case QWeights: return h.weight_bits ? e * (h.weight_bits / 8) : 0;
+    default: return s >= QScale ? (h.weight_bits ? n * 4 : 0) : n * 4;
+    }
+}
+
+} // namespace
+
+bool InferenceModel::isImageFile(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char m[4];
+    return in.read(m, 4) && std::memcmp(m, image_magic, 4) == 0;
+}
+
+bool InferenceModel::save(const std::string &path) const
+{
+    const Arrays &a = arrays;
+    const int n = num_neurons;
+    std::vector<uint32_t> id_offsets(n + 1, 0);
+    std::string strings;
+    for (int i = 0; i < n; ++i)
+    {
+        strings += ids[i];
+        id_offsets[i + 1] = static_cast<uint32_t>(strings.size());
+    }
+
+    ImageHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, image_magic, 4);
+    h.version = image_version;
+    h.num_neurons = static_cast<uint32_t>(n);
+    h.num_sensory = static_cast<uint32_t>(num_sensory);
+    h.num_edges = static_cast<uint32_t>(a.num_edges);
+    h.weight_bits = static_cast<uint32_t>(a.bits);
+    const void *data[NumSections] = {
+        a.threshold, a.leak, a.resting,
+        a.init_value, a.init_delta, a.init_on_deck, a.init_refractory,
+        a.row_offsets, a.row_split, a.targets, a.weights,
+        id_offsets.data(), strings.data(),
+        a.scale, a.qthreshold, a.qresting, a.qleak, a.qinit_value, a.qinit_delta, a.qinit_on_deck, a.qweights};
+    h.bytes[IdStrings] = strings.size();
+    uint64_t at = align8(sizeof(ImageHeader));
+    for (int s = 0; s < NumSections; ++s)
+    {
+        h.bytes[s] = expectedBytes(s, h);
+        h.offset[s] = at;
+        at = align8(at + h.bytes[s]);
+    }
+
+    // written beside the target and renamed over it: processes that have the old image
+    // attached (this model included) keep their mapping intact
+    const std::string tmp = path + ".tmp";
+    std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "InferenceModel: could not write " << tmp << std::endl;
+        return false;
+    }
+    const char zeros[8] = {0};
+    uint64_t written = 0;
+    auto put = [&](const void *p, uint64_t bytes, uint64_t offset) {
+        out.write(zeros, static_cast<std::streamsize>(offset - written)); // padding
+        if (bytes) out.write(static_cast<const char *>(p), static_cast<std::streamsize>(bytes));
+        written = offset + bytes;
+    };
+    put(&h, sizeof(h), 0);
+    for (int s = 0; s < NumSections; ++s) put(data[s], h.bytes[s], h.offset[s]);
+    put(nullptr, 0, at);
+    out.close();
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "InferenceModel: could not write " << path << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool InferenceModel::attach(const std::string &path)
+{
+    std::shared_ptr<gnet::MappedFile> file = std::make_shared<gnet::MappedFile>();
+    if (!file->open(path))
+    {
+        std::cerr << "InferenceModel: could not open " << path << std::endl;
+        return false;
+    }
+    auto fail = [&](const char *why) {
+        std::cerr << "InferenceModel: " << path << ": " << why << std::endl;
+        return false;
+    };
+    if (file->size() < sizeof(ImageHeader)) return fail("not a model image");
+    const unsigned char *base = file->data();
+    const ImageHeader &h = *reinterpret_cast<const ImageHeader *>(base);
+    if (std::memcmp(h.magic, image_magic, 4) != 0) return fail("not a model image");
+    if (h.version != image_version) return fail("unsupported image version");
+    if (h.weight_bits != 0 && h.weight_bits != 8 && h.weight_bits != 16) return fail("bad weight width");
+    if (h.num_sensory > h.num_neurons || h.num_neurons > INT32_MAX - 1 || h.num_edges > INT32_MAX) return fail("bad counts");
+    for (int s = 0; s < NumSections; ++s)
+    {
+        if (h.bytes[s] != expectedBytes(s, h) || h.offset[s] % 8 != 0 || h.offset[s] > file->size() ||
+            h.bytes[s] > file->size() - h.offset[s])
+            return fail("truncated or corrupt section");
+    }
+
+    const int n = static_cast<int>(h.num_neurons);
+    const int E = static_cast<int>(h.num_edges);
+    auto at = [&](int s) { return static_cast<const void *>(base + h.offset[s]); };
+    const int *offs = static_cast<const int *>(at(RowOffsets));
+    const int *split = static_cast<const int *>(at(RowSplit));
+    const int *tgt = static_cast<const int *>(at(Targets));
+    const uint32_t *id_offs = static_cast<const uint32_t *>(at(IdOffsets));
+    if (offs[0] != 0 || offs[n] != E || id_offs[0] != 0 || id_offs[n] != h.bytes[IdStrings]) return fail("bad row or ID offsets");
+    for (int i = 0; i < n; ++i)
+    {
+        if (offs[i + 1] < offs[i] || split[i] < offs[i] || split[i] > offs[i + 1] || id_offs[i + 1] < id_offs[i])
+            return fail("bad row or ID offsets");
+    }
+    for (int e = 0; e < E; ++e)
+    {
+        if (tgt[e] < 0 || tgt[e] >= n) return fail("edge target out of range");
+    }
+
+    num_neurons = n;
+    num_sensory = static_cast<int>(h.num_sensory);
+    const char *strings = static_cast<const char *>(at(IdStrings));
+    ids.resize(n);
+    for (int i = 0; i < n; ++i) ids[i].assign(strings + id_offs[i], id_offs[i + 1] - id_offs[i]);
+    indexIds();
+
+    params.reset();
+    topo.reset();
+    fixed.reset();
+    image = file;
+    Arrays &a = arrays;
+    a.threshold = static_cast<const float *>(at(Threshold));
+    a.leak = static_cast<const float *>(at(Leak));
+    a.resting = static_cast<const float *>(at(Resting));
+    a.init_value = static_cast<const float *>(at(InitValue));
+    a.init_delta = static_cast<const float *>(at(InitDelta));
+    a.init_on_deck = static_cast<const float *>(at(InitOnDeck));
+    a.init_refractory = static_cast<const int *>(at(InitRefractory));
+    a.row_offsets = offs;
+    a.row_split = split;
+    a.targets = tgt;
+    a.weights = static_cast<const float *>(at(Weights));
+    a.num_edges = E;
+    a.bits = static_cast<int>(h.weight_bits);
+    if (a.bits)
+    {
+        a.scale = static_cast<const float *>(at(QScale));
+        a.qthreshold = static_cast<const int32_t *>(at(QThreshold));
+        a.qresting = static_cast<const int32_t *>(at(QResting));
+        a.qleak = static_cast<const int32_t *>(at(QLeak));
+        a.qinit_value = static_cast<const int32_t *>(at(QInitValue));
+        a.qinit_delta = static_cast<const int32_t *>(at(QInitDelta));
+        a.qinit_on_deck = static_cast<const int32_t *>(at(QInitOnDeck));
+        a.qweights = at(QWeights);
+    }
+    return true;
+}
+
+int InferenceModel::sensoryHandle(const std::string &id) const
+{
+    auto it = sensory_index.find(id);
+    return it == sensory_index.end() ? -1 : it->second;
+}
+
+namespace {
+
+int32_t toFixed(double v)
+{
+    const double limit = 1073741824.0; // 2^30, headroom for sums
+    v = std::floor(v + 0.5);
+    return static_cast<int32_t>(std::max(-limit, std::min(limit, v)));
+}
+
+} // namespace
+
+bool InferenceModel::quantize(int weight_bits)
+{
+    if (weight_bits == 0)
+    {
+        fixed.reset();
+        bindFixed();
+        return true;
+    }
+    if ((weight_bits != 8 && weight_bits != 16) || !arrays.row_offsets) return false;
+    const Arrays &a = arrays;
+    const int n = num_neurons;
+    const int qmax = weight_bits == 8 ? 127 : 32767;
+
+    std::shared_ptr<Fixed> f = std::make_shared<Fixed>();
+    f->bits = weight_bits;
+
+    // largest incoming weight sets a neuron's units
+    std::vector<float> max_in(n, 0.0f);
+    for (int e = 0; e < a.num_edges; ++e)
+        max_in[a.targets[e]] = std::max(max_in[a.targets[e]], std::fabs(a.weights[e]));
+    f->scale.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        float unit = max_in[i] / qmax;
+        if (!(unit > 0.0f)) unit = std::max(std::fabs(a.threshold[i]), 1.0f) / 32767.0f;
+        f->scale[i] = unit;
+    }
+
+    f->threshold.resize(n);
+    f->resting.resize(n);
+    f->leak.resize(n);
+    f->init_value.resize(n);
+    f->init_delta.resize(n);
+    f->init_on_deck.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const double unit = f->scale[i];
+        // V > threshold holds for integer V exactly when V > floor(threshold / unit)
+        f->threshold[i] = toFixed(std::floor(a.threshold[i] / unit));
+        f->resting[i] = toFixed(a.resting[i] / unit);
+        f->leak[i] = toFixed(std::max(0.0f, std::min(1.0f, a.leak[i])) * 32768.0);
+        f->init_value[i] = toFixed(a.init_value[i] / unit);
+        f->init_delta[i] = toFixed(a.init_delta[i] / unit);
+        f->init_on_deck[i] = toFixed(a.init_on_deck[i] / unit);
+    }
+
+    const int edges = a.num_edges;
+    if (weight_bits == 8) f->weights8.resize(edges);
+    else f->weights16.resize(edges);
+    for (int e = 0; e < edges; ++e)
+    {
+        const int32_t q = std::max(-qmax, std::min(qmax, toFixed(a.weights[e] / f->scale[a.targets[e]])));
+        if (weight_bits == 8) f->weights8[e] = static_cast<int8_t>(q);
+        else f->weights16[e] = static_cast<int16_t>(q);
+    }
+    fixed = f;
+    bindFixed();
+    return true;
+}
+
+size_t InferenceModel::weightBytes() const
+{
+    const size_t edges = static_cast<size_t>(numEdges());
+    return arrays.bits ? edges * static_cast<size_t>(arrays.bits / 8) : edges * sizeof(float);
+}
+
+// =====================================================================================
+// InferenceSession
+// =====================================================================================
+
+InferenceSession::InferenceSession(std::shared_ptr<const InferenceModel> model, const OutputDetectorConfig &detector_cfg, int window)
+    : net(std::move(model)), decision_window(window), detector(makeDetector(detector_cfg, window))
+{
+    detector->setOutputs(net->output_ids, net->output_handles);
+    reset();
+}
+
+void InferenceSession::reset()
+{
+    const int n = net->num_neurons;
+    const InferenceModel::Arrays &a = net->arrays;
+    value.assign(a.init_value, a.init_value + n);
+    delta.assign(a.init_delta, a.init_delta + n);
+    on_deck.assign(a.init_on_deck, a.init_on_deck + n);
+    refractory.assign(a.init_refractory, a.init_refractory + n);
+    if (a.bits)
+    {
+        qvalue.assign(a.qinit_value, a.qinit_value + n);
+        qdelta.assign(a.qinit_delta, a.qinit_delta + n);
+        qon_deck.assign(a.qinit_on_deck, a.qinit_on_deck + n);
+    }
+    fired_flags.assign(n, 0);
+    fired_mask.assign(membrane::maskWords(n), 0);
+    detector->reset();
+    tick = 0;
+}
+
+void InferenceSession::inject(const int *handles, const float *values, int n)
+{
+    const int s = net->num_sensory;
+    if (net->arrays.bits)
+    {
+        const float *unit = net->arrays.scale;
+        for (int i = 0; i < n; ++i)
+        {
+            if (handles[i] >= 0 && handles[i] < s) qon_deck[handles[i]] += toFixed(values[i] / unit[handles[i]]);
+        }
+        return;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        if (handles[i] >= 0 && handles[i] < s) on_deck[handles[i]] += values[i];
+    }
+}
+
+/*
+Same two passes as CompiledNetwork::step(): the vectorized membrane update, then spike
+delivery in ascending source order (forward edges into delta, the rest into on_deck),
+on this session's state and the model's shared topology.
+*/
+void InferenceSession::step()
+{
+    const InferenceModel &m = *net;
+    const InferenceModel::Arrays &g = m.arrays;
+    if (g.bits)
+    {
+        if (g.bits == 8) stepFixed(static_cast<const int8_t *>(g.qweights));
+        else stepFixed(static_cast<const int16_t *>(g.qweights));
+        detector->updateFromMask(fired_mask.data());
+        ++tick;
+        return;
+    }
+    membrane::Arrays a;
+    a.n = m.num_neurons;
+    a.value = value.data();
+    a.delta = delta.data();
+    a.on_deck = on_deck.data();
+    a.refractory = refractory.data();
+    a.fired = fired_flags.data();
+    a.fired_mask = fired_mask.data();
+    a.threshold = g.threshold;
+    a.leak = g.leak;
+    a.resting = g.resting;
+    if (membrane::update(a, simd) > 0)
+    {
+        float *d = delta.data();
+        float *od = on_deck.data();
+        const int *offs = g.row_offsets;
+        const int *split = g.row_split;
+        const int *tgt = g.targets;
+        const float *w = g.weights;
+        const int words = membrane::maskWords(m.num_neurons);
+        for (int wi = 0; wi < words; ++wi)
+        {
+            uint64_t bits = fired_mask[wi];
+            while (bits)
+            {
+                const int s = wi * 64 + lowestBit(bits);
+                bits &= bits - 1;
+                for (int e = offs[s]; e < split[s]; ++e) d[tgt[e]] += w[e];
+                for (int e = split[s]; e < offs[s + 1]; ++e) od[tgt[e]] += w[e];
+            }
+        }
+    }
+    detector->updateFromMask(fired_mask.data());
+    ++tick;
+}
+
+/*
+step() of a quantized model: the membrane pass of membrane::update() in integers
+(V = max(0, leak*V + incoming) with leak in Q15, rounded to nearest), then delivery of
+the narrow weights, which are already in their targets' units.
+*/
+template <class W>
+void InferenceSession::stepFixed(const W *weights)
+{
+    const InferenceModel &m = *net;
+    const InferenceModel::Arrays &g = m.arrays;
+    const int n = m.num_neurons;
+    const int words = membrane::maskWords(n);
+    std::fill(fired_mask.begin(), fired_mask.end(), 0);
+    int count = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        fired_flags[i] = 0;
+        const int64_t incoming = qdelta[i];
+        qdelta[i] = qon_deck[i];
+        qon_deck[i] = 0;
+        if (refractory[i] > 0)
+        {
+            refractory[i] -= 1;
+            continue;
+        }
+        int64_t v = ((static_cast<int64_t>(g.qleak[i]) * qvalue[i] + 16384) >> 15) + incoming;
+        if (v < 0) v = 0;
+        if (v > g.qthreshold[i])
+        {
+            fired_flags[i] = 1;
+            fired_mask[i >> 6] |= uint64_t(1) << (i & 63);
+            ++count;
+            v = g.qresting[i];
+        }
+        qvalue[i] = static_cast<int32_t>(std::min<int64_t>(v, INT32_MAX));
+    }
+    if (count == 0) return;
+
+    int32_t *d = qdelta.data();
+    int32_t *od = qon_deck.data();
+    const int *offs = g.row_offsets;
+    const int *split = g.row_split;
+    const int *tgt = g.targets;
+    for (int wi = 0; wi < words; ++wi)
+    {
+        uint64_t bits = fired_mask[wi];
+        while (bits)
+        {
+            const int s = wi * 64 + lowestBit(bits);
+            bits &= bits - 1;
+            for (int e = offs[s]; e < split[s]; ++e) d[tgt[e]] += weights[e];
+            for (int e = split[s]; e < offs[s + 1]; ++e) od[tgt[e]] += weights[e];
+        }
+    }
+}
+
+InferenceDecision InferenceSession::decision() const
+{
+    InferenceDecision d;
+    d.winner_slot = detector->winnerSlot();
+    d.winner = detector->winner();
+    d.margin = detector->margin();
+    d.tick = tick;
+    d.decided = d.winner_slot >= 0 && detector->decided(decision_window);
+    return d;
+}
+
+// =====================================================================================
+// InferenceServer
+// =====================================================================================
+
+InferenceServer::InferenceServer(std::shared_ptr<const InferenceModel> model, const Config &config)
+    : net(std::move(model)), cfg(config)
+{
+}
+
+InferenceServer::~InferenceServer()
+{
+    stop();
+}
+
+int InferenceServer::open()
+{
+    std::shared_ptr<Stream> s = std::make_shared<Stream>(InferenceSession(net, cfg.detector, cfg.decision_window));
+    std::lock_guard<std::mutex> g(sessions_lock);
+    const int id = next_id++;
+    streams[id] = s;
+    return id;
+}
+
+void InferenceServer::close(int session)
+{
+    std::shared_ptr<Stream> s;
+    {
+        std::lock_guard<std::mutex> g(sessions_lock);
+        auto it = streams.find(session);
+        if (it == streams.end()) return;
+        s = it->second;
+        streams.erase(it);
+    }
+    // its queued ticks won't run (a worker that has already taken them finishes them)
+    std::lock_guard<std::mutex> g(s->queue_lock);
+    queued(-static_cast<long long>(s->tick_offsets.size() - 1));
+    s->tick_offsets.assign(1, 0);
+    s->handles.clear();
+    s->values.clear();
+}
+
+void InferenceServer::reset(int session)
+{
+    std::shared_ptr<Stream> s = find(session);
+    if (!s) return;
+    std::lock_guard<std::mutex> r(s->run_lock);
+    std::lock_guard<std::mutex> g(s->queue_lock);
+    s->session.reset();
+    queued(-static_cast<long long>(s->tick_offsets.size() - 1));
+    s->tick_offsets.assign(1, 0);
+    s->handles.clear();
+    s->values.clear();
+    s->last = InferenceDecision();
+}
+
+size_t InferenceServer::sessionCount() const
+{
+    std::lock_guard<std::mutex> g(sessions_lock);
+    return streams.size();
+}
+
+std::shared_ptr<InferenceServer::Stream> InferenceServer::find(int session) const
+{
+    std::lock_guard<std::mutex> g(sessions_lock);
+    auto it = streams.find(session);
+    return it == streams.end() ? nullptr : it->second;
+}
+
+bool InferenceServer::push(int session, const int *handles, const float *values, int n)
+{
+    const int offsets[2] = {0, n};
+    return pushTicks(session, offsets, handles, values, 1);
+}
+
+bool InferenceServer::pushTicks(int session, const int *offsets, const int *handles, const float *values, int ticks)
+{
+    std::shared_ptr<Stream> s = find(session);
+    if (!s) return false;
+    if (ticks <= 0) return true;
+    {
+        std::lock_guard<std::mutex> g(s->queue_lock);
+        const int base = static_cast<int>(s->handles.size());
+        s->handles.insert(s->handles.end(), handles, handles + offsets[ticks]);
+        s->values.insert(s->values.end(), values, values + offsets[ticks]);
+        for (int k = 1; k <= ticks; ++k) s->tick_offsets.push_back(base + offsets[k]);
+    }
+    queued(ticks);
+    return true;
+}
+
+bool InferenceServer::pushIds(int session, const std::vector<std::pair<std::string, float>> &inputs)
+{
+    std::vector<int> h;
+    std::vector<float> v;
+    h.reserve(inputs.size());
+    v.reserve(inputs.size());
+    for (const auto &kv : inputs)
+    {
+        h.push_back(net->sensoryHandle(kv.first));
+        v.push_back(kv.second);
+    }
+    return push(session, h.data(), v.data(), static_cast<int>(h.size()));
+}
+
+void InferenceServer::run(int id, Stream &s)
+{
+    std::lock_guard<std::mutex> r(s.run_lock);
+    {
+        // take the queued ticks; producers keep pushing into the emptied queue
+        std::lock_guard<std::mutex> g(s.queue_lock);
+        s.run_offsets.swap(s.tick_offsets);
+        s.run_handles.swap(s.handles);
+        s.run_values.swap(s.values);
+        s.tick_offsets.assign(1, 0);
+        s.handles.clear();
+        s.values.clear();
+    }
+    const int ticks = static_cast<int>(s.run_offsets.size()) - 1;
+    if (ticks <= 0) return;
+    queued(-ticks);
+    const int every = cfg.decision_every;
+    for (int k = 0; k < ticks; ++k)
+    {
+        const int lo = s.run_offsets[k];
+        s.session.inject(s.run_handles.data() + lo, s.run_values.data() + lo, s.run_offsets[k + 1] - lo);
+        s.session.step();
+        if (every > 0 && s.session.ticks() % every == 0)
+        {
+            InferenceDecision d = s.session.decision();
+            {
+                std::lock_guard<std::mutex> g(s.queue_lock);
+                s.last = d;
+            }
+            if (on_decision) on_decision(id, d);
+        }
+    }
+    if (every > 0)
+    {
+        // keep decision() current between reports
+        if (s.session.ticks() % every != 0)
+        {
+            InferenceDecision d = s.session.decision();
+            std::lock_guard<std::mutex> g(s.queue_lock);
+            s.last = d;
+        }
+        return;
+    }
+    InferenceDecision d = s.session.decision();
+    {
+        std::lock_guard<std::mutex> g(s.queue_lock);
+        s.last = d;
+    }
+    if (on_decision) on_decision(id, d);
+}
+
+void InferenceServer::process()
+{
+    std::vector<std::pair<int, std::shared_ptr<Stream>>> work;
+    {
+        std::lock_guard<std::mutex> g(sessions_lock);
+        work.reserve(streams.size());
+        for (const auto &kv : streams) work.push_back(kv);
+    }
+    // a fixed order (by id) keeps on_decision calls reproducible with one thread
+    std::sort(work.begin(), work.end(), [](const std::pair<int, std::shared_ptr<Stream>> &a, const std::pair<int, std::shared_ptr<Stream>> &b) { return a.first < b.first; });
+
+    ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool)
+        ->parallelFor(static_cast<int>(work.size()), [&](int i) { run(work[i].first, *work[i].second); }, std::max(1, cfg.threads));
+}
+
+InferenceDecision InferenceServer::decision(int session) const
+{
+    std::shared_ptr<Stream> s = find(session);
+    if (!s) return InferenceDecision();
+    std::lock_guard<std::mutex> g(s->queue_lock);
+    return s->last;
+}
+
+void InferenceServer::queued(long long ticks)
+{
+    queued_ticks += ticks;
+    if (ticks <= 0) return;
+    // taking the lock orders this with the driver's check, so the wakeup isn't lost
+    { std::lock_guard<std::mutex> g(wake_lock); }
+    wake.notify_one();
+}
+
+void InferenceServer::start()
+{
+    if (driver.joinable()) return;
+    {
+        std::lock_guard<std::mutex> g(wake_lock);
+        stopping = false;
+    }
+    driver = std::thread(&InferenceServer::drive, this);
+}
+
+void InferenceServer::stop()
+{
+    if (!driver.joinable()) return;
+    {
+        std::lock_guard<std::mutex> g(wake_lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    driver.join();
+}
+
+void InferenceServer::drive()
+{
+    std::unique_lock<std::mutex> g(wake_lock);
+    for (;;)
+    {
+        wake.wait(g, [&]() { return queued_ticks.load() > 0 || stopping; });
+        if (queued_ticks.load() <= 0) return; // stopping with nothing left
+        g.unlock();
+        process();
+        g.lock();
+    }
+}
@@ -0,0 +1,333 @@
+#ifndef __inference_server_h__
+#define __inference_server_h__
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "../arch/membrane_kernels.h"
+#include "../arch/compiled_network.h"
+#include "../arch/output_detection.h"
+#include "../arch/thread_pool.h"
+#include "../train/training_config.h"
+
+class Glia;
+namespace gnet { class MappedFile; }
+
+/*
+Immutable form of a trained network for serving: topology (CSR, forward edges first,
+as in CompiledNetwork), weights, neuron parameters, the initial dynamic state and the
+output neurons (IDs starting with 'O', in tick order). One model is shared by every
+session through a shared_ptr<const InferenceModel>; nothing in it changes after load,
+so any number of threads may read it.
+
+quantize() switches a model to fixed-point inference before it is shared: weights
+become int8 or int16 and membrane state int32, each neuron in its own units (scale[i],
+chosen so the largest incoming weight maps to the top of the weight range; neurons
+without incoming edges use their threshold). A weight is stored in its target's units,
+so delivery adds integers and the membrane pass is integer arithmetic with the leak in
+Q15. Thresholds, resting values and injected input are converted with the same scale.
+Weights take a quarter (int8) or half (int16) of the float traffic of spike delivery;
+decisions can differ from the float network where a membrane ends within rounding of
+its threshold, so check a model with glia_quantize (src/serve/quantize_main.cpp) on
+validation sequences before deploying it.
+
+save() writes a model as a flat image and attach() maps one read-only: the arrays are
+used in place, so every process that attaches the same image shares one copy of the
+topology, weights and parameters (page cache; put the file under /dev/shm for a
+RAM-backed segment) and allocates only its sessions' state. Layout (native byte order,
+images are for processes on one host; every section 8-byte aligned):
+
+    ImageHeader   magic "GIMG", version, counts, weight bits, section offsets and sizes
+    parameters    threshold, leak, resting (float[n])
+    initial state value, delta, on_deck (float[n]), refractory (int32[n])
+    topology      row_offsets (int32[n + 1]), row_split (int32[n]), targets (int32[E]),
+                  weights (float[E]), as in CompiledTopology
+    IDs           id_offsets (uint32[n + 1]) into the concatenated ID strings
+    fixed point   (weight_bits > 0) scale (float[n]), threshold, resting, leak, initial
+                  value, delta, on_deck (int32[n]), weights (int8/int16[E])
+*/
+class InferenceModel
+{
+public:
+    // snapshot of `net` as it is now (false if it can't be compiled)
+    bool build(Glia &net);
+    // load a .net/.gnet file and snapshot it, or attach() a model image
+    bool load(const std::string &path);
+
+    // write the model (quantized form included) as an image for attach(); false with a
+    // message if the file can't be written
+    bool save(const std::string &path) const;
+    // map an image written by save() (false with a message if it is missing or invalid).
+    // Copies of an attached model share the mapping; quantize() on one builds a private
+    // fixed-point form.
+    bool attach(const std::string &path);
+    bool attached() const { return image != nullptr; }
+
+    int size() const { return num_neurons; }
+    int numSensory() const { return num_sensory; }
+    int numEdges() const { return arrays.num_edges; }
+
+    const std::vector<std::string> &neuronIds() const { return ids; }
+    const std::vector<std::string> &outputIds() const { return output_ids; }
+    const std::vector<int> &outputHandles() const { return output_handles; }
+
+    // handle (tick order index) of a sensory neuron, or -1
+    int sensoryHandle(const std::string &id) const;
+
+    // fixed-point inference with 8 or 16 bit weights, 0 back to float; false for other
+    // widths. Call before sessions are opened.
+    bool quantize(int weight_bits);
+    int weightBits() const { return arrays.bits; }
+    // bytes of the weight array spike delivery reads
+    size_t weightBytes() const;
+
+private:
+    friend class InferenceSession;
+
+    int num_neurons = 0;
+    int num_sensory = 0;
+    std::vector<std::string> ids;
+    std::unordered_map<std::string, int> sensory_index;
+    std::vector<std::string> output_ids;
+    std::vector<int> output_handles;
+
+    // parameters and the dynamic state at build time (sessions start and reset from it)
+    struct Params
+    {
+        std::vector<float> threshold;
+        std::vector<float> leak;
+        std::vector<float> resting;
+        std::vector<float> init_value;
+        std::vector<float> init_delta;
+        std::vector<float> init_on_deck;
+        std::vector<int> init_refractory;
+    };
+    std::shared_ptr<const Params> params;
+
+    // the compiled network's edge block at build time (shared with it until its
+    // weights change; see CompiledTopology)
+    std::shared_ptr<const CompiledTopology> topo;
+
+    // mapping of an attached image, which then holds every array instead of params/topo
+    std::shared_ptr<const gnet::MappedFile> image;
+
+    // fixed-point form (see quantize()), shared by the sessions; null for float
+    struct Fixed
+    {
+        int bits = 0;
+        std::vector<float> scale; // value of one unit of neuron i's membrane
+        std::vector<int32_t> threshold;
+        std::vector<int32_t> resting;
+        std::vector<int32_t> leak; // Q15 (32768 = 1.0)
+        std::vector<int8_t> weights8; // per CSR edge, in units of its target (bits = 8)
+        std::vector<int16_t> weights16; // (bits = 16)
+        std::vector<int32_t> init_value;
+        std::vector<int32_t> init_delta;
+        std::vector<int32_t> init_on_deck;
+    };
+    std::shared_ptr<const Fixed> fixed;
+
+    // what sessions read, pointing into params/topo/fixed or into the image; shared
+    // storage, so copies of the model keep valid pointers
+    struct Arrays
+    {
+        const float *threshold = nullptr, *leak = nullptr, *resting = nullptr;
+        const float *init_value = nullptr, *init_delta = nullptr, *init_on_deck = nullptr;
+        const int *init_refractory = nullptr;
+        const int *row_offsets = nullptr, *row_split = nullptr, *targets = nullptr;
+        const float *weights = nullptr;
+        int num_edges = 0;
+
+        int bits = 0; // fixed point when > 0
+        const float *scale = nullptr;
+        const int32_t *qthreshold = nullptr, *qresting = nullptr, *qleak = nullptr;
+        const int32_t *qinit_value = nullptr, *qinit_delta = nullptr, *qinit_on_deck = nullptr;
+        const void *qweights = nullptr; // int8_t or int16_t per edge
+    };
+    Arrays arrays;
+
+    void indexIds(); // sensory_index and the outputs from ids
+    void bindFloat();
+    void bindFixed();
+    static bool isImageFile(const std::string &path);
+};
+
+// detector output of a session after its latest tick
+struct InferenceDecision
+{
+    std::string winner;   // detector winner (default_id / empty when abstaining)
+    int winner_slot = -1; // index into InferenceModel::outputIds(), -1 when abstaining
+    float margin = 0.0f;
+    long long tick = 0;   // ticks the session has run since open/reset
+    bool decided = false; // the detector's winner can't change within decision_window
+};
+
+/*
+Per-stream state: membrane state for every neuron of the model plus an output
+detector, about 22 bytes per neuron. step() is CompiledNetwork::step() on this state,
+so a session gives exactly the spikes a Glia copy of the network would (for a quantized
+model: the same passes in fixed point, on int32 state).
+*/
+class InferenceSession
+{
+public:
+    InferenceSession(std::shared_ptr<const InferenceModel> model, const OutputDetectorConfig &detector, int decision_window);
+
+    // back to the model's initial state; detector cleared
+    void reset();
+
+    // stage sparse input for the next tick (handles that are not sensory are ignored)
+    void inject(const int *handles, const float *values, int n);
+
+    // advance one tick and update the detector
+    void step();
+
+    InferenceDecision decision() const;
+    long long ticks() const { return tick; }
+    const uint8_t *fired() const { return fired_flags.data(); } // per neuron, last tick
+    const InferenceModel &model() const { return *net; }
+
+    membrane::SimdLevel simd = membrane::detect();
+
+private:
+    std::shared_ptr<const InferenceModel> net;
+    int decision_window;
+    long long tick = 0;
+
+    std::vector<float> value;
+    std::vector<float> delta;
+    std::vector<float> on_deck;
+    std::vector<int> refractory;
+    std::vector<uint8_t> fired_flags;
+    std::vector<uint64_t> fired_mask;
+    // state of a quantized model, in each neuron's units
+    std::vector<int32_t> qvalue;
+    std::vector<int32_t> qdelta;
+    std::vector<int32_t> qon_deck;
+
+    std::unique_ptr<SlotDetector> detector;
+
+    template <class W>
+    void stepFixed(const W *weights);
+};
+
+/*
+Many concurrent input streams over one shared model. Streams push sparse per-tick input
+into their session's queue from any thread; process() then runs every session's queued
+ticks, spreading sessions over up to `threads` workers (each session is advanced by one
+worker at a time, in the order its ticks were pushed), and reports decisions. Sessions
+can be opened, closed and reset from any thread, also while process() runs; process()
+itself is meant to be driven by one thread.
+
+Or start() it: a driver thread then calls process() whenever ticks are queued, so
+producers only push (a push holds the session's queue lock just to append, never while
+the session runs) and consumers only receive on_decision calls, every decision_every
+ticks of a session. Nothing of the caller is in the per-tick path.
+
+    InferenceServer server(model, cfg);
+    int s = server.open();
+    server.push(s, handles, values, n);   // one tick
+    server.process();                     // run queued ticks of all sessions
+    InferenceDecision d = server.decision(s);
+*/
+class InferenceServer
+{
+public:
+    struct Config
+    {
+        OutputDetectorConfig detector; // detector of every session
+        int decision_window = 50;      // horizon for InferenceDecision::decided
+        int threads = 1;               // sessions process() runs at once
+        int pool_threads = 0;          // pool they run on (0: ThreadPool::shared())
+        // > 0: on_decision after every decision_every-th tick of a session (counted from
+        // open/reset) instead of after the last of its queued ticks
+        int decision_every = 0;
+    };
+
+    InferenceServer(std::shared_ptr<const InferenceModel> model, const Config &cfg);
+    ~InferenceServer();
+    InferenceServer(const InferenceServer &) = delete;
+    InferenceServer &operator=(const InferenceServer &) = delete;
+
+    // new session; returns its id
+    int open();
+    void close(int session);
+    void reset(int session);
+    size_t sessionCount() const;
+
+    // queue one tick of input for a session (an empty tick is n = 0); false if unknown
+    bool push(int session, const int *handles, const float *values, int n);
+    bool pushIds(int session, const std::vector<std::pair<std::string, float>> &inputs);
+    // queue `ticks` ticks at once: inputs of tick k are [offsets[k], offsets[k + 1]) of
+    // handles/values (offsets[0] = 0)
+    bool pushTicks(int session, const int *offsets, const int *handles, const float *values, int ticks);
+
+    // run all queued ticks; on_decision (if set) is called on the worker that ran the
+    // session, once per session with queued ticks, after its last one
+    void process();
+    std::function<void(int session, const InferenceDecision &)> on_decision;
+
+    // latest decision of a session (default-constructed if unknown)
+    InferenceDecision decision(int session) const;
+
+    // background processing (see the top): start() launches the driver thread, stop() runs
+    // the ticks still queued, then joins it (the destructor stops too). Don't call
+    // process() while it runs.
+    void start();
+    void stop();
+    bool running() const { return driver.joinable(); }
+    // ticks pushed and not yet taken by a worker, over all sessions
+    long long queuedTicks() const { return queued_ticks.load(); }
+
+    const InferenceModel &model() const { return *net; }
+
+    // pool for process() (overrides Config::pool_threads)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+
+private:
+    struct Stream
+    {
+        explicit Stream(InferenceSession s) : session(std::move(s)) {}
+        InferenceSession session;
+        std::mutex run_lock;   // held while the session is advanced or reset
+        std::mutex queue_lock; // guards the queue and `last`
+        // queued ticks: inputs of tick k are [tick_offsets[k], tick_offsets[k+1])
+        std::vector<int> tick_offsets = std::vector<int>(1, 0);
+        std::vector<int> handles;
+        std::vector<float> values;
+        // drained copy processed by a worker (reused)
+        std::vector<int> run_offsets;
+        std::vector<int> run_handles;
+        std::vector<float> run_values;
+        InferenceDecision last;
+    };
+
+    std::shared_ptr<const InferenceModel> net;
+    Config cfg;
+    mutable std::mutex sessions_lock;
+    std::unordered_map<int, std::shared_ptr<Stream>> streams;
+    int next_id = 0;
+    std::shared_ptr<ThreadPool> thread_pool, owned_pool;
+
+    // background driver
+    std::thread driver;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<long long> queued_ticks{0};
+
+    std::shared_ptr<Stream> find(int session) const;
+    void run(int id, Stream &s);
+    void drive();
+    void queued(long long ticks);
+};
+
+#endif
@@ -0,0 +1,161 @@
+// Quantization check for inference models (glia_quantize)
+// Runs validation episodes through a network in float and with fixed-point int16 and
+// int8 weights (InferenceModel::quantize) and reports how often each quantized model's
+// detector decision matches the float one, plus accuracy when episodes have labels.
+// The float model gives the same spikes as the network's Glia, so agreement is
+// agreement with the trained network. Exits with 1 if a width falls below
+// --min-agreement, so it can gate a deployment.
+//
+//   glia_quantize --net trained.gnet [--bits 8|16] [--warmup U] [--window W]
+//                 [--detector ema|count|first_spike] [--alpha A] [--min-agreement F]
+//                 (--dataset val.gds | --labels DIR | a.seq b.seq ...)
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+
+#include "inference_server.h"
+#include "../arch/input_sequence.h"
+#include "../data/spike_dataset.h"
+
+struct Args {
+    std::string net;
+    std::vector<int> bits = {16, 8};
+    int warmup = 20;                // TrainingConfig::warmup_ticks
+    int window = 50;                // TrainingConfig::decision_window
+    OutputDetectorConfig detector;
+    double min_agreement = 0.0;
+    std::string dataset;            // .gds
+    std::string labels_dir;         // directory with labels.csv
+    std::vector<std::string> seqs;  // unlabeled .seq files
+};
+
+static bool parse_args(int argc, char** argv, Args &a) {
+    for (int i = 1; i < argc; ++i) {
+        std::string k = argv[i];
+        auto next = [&](std::string &out){ if (i+1>=argc) return false; out = argv[++i]; return true; };
+        std::string v;
+        if (k == "--net") { if (!next(a.net)) return false; }
+        else if (k == "--bits") { if (!next(v)) return false; a.bits.assign(1, std::atoi(v.c_str())); }
+        else if (k == "--warmup") { if (!next(v)) return false; a.warmup = std::atoi(v.c_str()); }
+        else if (k == "--window") { if (!next(v)) return false; a.window = std::atoi(v.c_str()); }
+        else if (k == "--detector") { if (!next(a.detector.type)) return false; }
+        else if (k == "--alpha") { if (!next(v)) return false; a.detector.alpha = static_cast<float>(std::atof(v.c_str())); }
+        else if (k == "--min-agreement") { if (!next(v)) return false; a.min_agreement = std::atof(v.c_str()); }
+        else if (k == "--dataset") { if (!next(a.dataset)) return false; }
+        else if (k == "--labels") { if (!next(a.labels_dir)) return false; }
+        else if (!k.empty() && k[0] == '-') return false;
+        else a.seqs.push_back(k);
+    }
+    return !a.net.empty();
+}
+
+struct Episode {
+    InputSequence seq;
+    std::string label; // empty when unknown
+};
+
+// "filename,label" rows after a header line; label k is target "O<k>" (see gds::packLabelsCsv)
+static bool loadLabels(const std::string &dir, std::vector<Episode> &out) {
+    const std::string sep = (!dir.empty() && dir.back() != '/' && dir.back() != '\\') ? "/" : "";
+    std::ifstream f((dir + sep + "labels.csv").c_str());
+    if (!f.is_open()) { std::cerr << "Error: could not open " << dir << sep << "labels.csv\n"; return false; }
+    std::string line;
+    bool header = true;
+    while (std::getline(f, line)) {
+        if (line.empty()) continue;
+        if (header) { header = false; continue; }
+        std::istringstream iss(line);
+        std::string fname, label;
+        if (!std::getline(iss, fname, ',') || !std::getline(iss, label)) continue;
+        Episode ep;
+        if (!ep.seq.loadFromFile(dir + sep + fname)) { std::cerr << "Warning: skipping " << fname << "\n"; continue; }
+        ep.label = "O" + std::to_string(std::atoi(label.c_str()));
+        out.push_back(ep);
+    }
+    return true;
+}
+
+// detector decision after warmup + window ticks of the episode
+static InferenceDecision decide(std::shared_ptr<const InferenceModel> model, const Args &a, const Episode &ep, std::vector<std::string> &sensory) {
+    InferenceSession session(model, a.detector, a.window);
+    CompiledInputSequence compiled;
+    compiled.compile(ep.seq, sensory);
+    SequenceCursor cursor(ep.seq);
+    for (int t = 0; t < a.warmup + a.window; ++t) {
+        CompiledInputSequence::Span in = compiled.at(cursor.tick);
+        session.inject(in.handles, in.values, in.size);
+        session.step();
+        cursor.advance();
+    }
+    return session.decision();
+}
+
+int main(int argc, char** argv) {
+    Args a;
+    if (!parse_args(argc, argv, a)) {
+        std::cerr << "Usage: glia_quantize --net FILE [--bits 8|16] [--warmup U] [--window W] [--detector TYPE] [--alpha A]\n"
+                     "                     [--min-agreement F] (--dataset FILE.gds | --labels DIR | FILE.seq ...)\n";
+        return 2;
+    }
+
+    std::vector<Episode> episodes;
+    if (!a.dataset.empty()) {
+        gds::Dataset ds;
+        std::string error;
+        if (!ds.open(a.dataset, error)) { std::cerr << "Error: " << a.dataset << ": " << error << "\n"; return 1; }
+        episodes.resize(ds.size());
+        for (size_t i = 0; i < ds.size(); ++i) {
+            ds.toSequence(i, episodes[i].seq);
+            episodes[i].label = ds.label(i);
+        }
+    }
+    if (!a.labels_dir.empty() && !loadLabels(a.labels_dir, episodes)) return 1;
+    for (const std::string &path : a.seqs) {
+        Episode ep;
+        if (!ep.seq.loadFromFile(path)) { std::cerr << "Warning: skipping " << path << "\n"; continue; }
+        episodes.push_back(ep);
+    }
+    if (episodes.empty()) { std::cerr << "Error: no validation episodes\n"; return 1; }
+
+    std::shared_ptr<InferenceModel> reference = std::make_shared<InferenceModel>();
+    if (!reference->load(a.net)) return 1;
+    std::vector<std::string> sensory(reference->neuronIds().begin(), reference->neuronIds().begin() + reference->numSensory());
+
+    std::vector<InferenceDecision> expected(episodes.size());
+    size_t labeled = 0, correct = 0;
+    for (size_t i = 0; i < episodes.size(); ++i) {
+        expected[i] = decide(reference, a, episodes[i], sensory);
+        if (!episodes[i].label.empty()) { labeled++; correct += expected[i].winner == episodes[i].label; }
+    }
+
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << a.net << ": " << reference->size() << " neurons, " << reference->numEdges() << " edges, "
+              << episodes.size() << " episodes\n";
+    std::cout << "  float  weights " << reference->weightBytes() << " B";
+    if (labeled) std::cout << "  accuracy " << static_cast<double>(correct) / labeled;
+    std::cout << "\n";
+
+    bool ok = true;
+    for (int bits : a.bits) {
+        std::shared_ptr<InferenceModel> q = std::make_shared<InferenceModel>(*reference);
+        if (!q->quantize(bits)) { std::cerr << "Error: --bits must be 8 or 16\n"; return 2; }
+        size_t agree = 0, q_correct = 0;
+        for (size_t i = 0; i < episodes.size(); ++i) {
+            const InferenceDecision d = decide(q, a, episodes[i], sensory);
+            agree += d.winner == expected[i].winner;
+            if (!episodes[i].label.empty()) q_correct += d.winner == episodes[i].label;
+        }
+        const double agreement = static_cast<double>(agree) / episodes.size();
+        std::cout << "  int" << bits << (bits < 10 ? "   " : "  ") << "weights " << q->weightBytes() << " B  agreement " << agreement;
+        if (labeled) std::cout << "  accuracy " << static_cast<double>(q_correct) / labeled;
+        std::cout << "\n";
+        if (agreement < a.min_agreement) ok = false;
+    }
+    return ok ? 0 : 1;
+}
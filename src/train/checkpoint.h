@@ -0,0 +1,448 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <memory>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "../arch/glia.h"
+#include "../arch/compiled_network.h"
+#include "edge_index.h"
+#include "network_snapshot.h"
+
+/*
+On-disk checkpoints of long training and evolution runs, so a preempted job resumes
+where it stopped instead of from the start.
+
+A file is the magic "GCKP", a format version and a kind string ("hebbian", "rate_gd",
+"evolution", or a runner's own), followed by the writer's fields in the order it wrote
+them: fixed-size values and arrays are stored raw (little-endian, as in .gnet), strings
+and arrays with a uint64 length. Random state is the seed and counters that key the
+random streams (random_streams.h). Snapshots are written with their topologies once per
+distinct topology. Files of older versions (1 with mt19937 states, 2 and 3 without
+delayed input or threshold adaptation) aren't read.
+
+Writer serializes into memory, which is cheap next to an epoch or a generation, and
+AsyncWriter puts the bytes on disk from a background thread: the file is written next to
+its destination, flushed to the device and renamed over it, so a checkpoint on disk is
+always complete. The loop that submits never waits for the disk.
+
+    ckpt::Writer w("hebbian");
+    trainer.saveState(w);
+    writer.submit("run.gckpt", w.release());
+*/
+namespace ckpt {
+
+const char magic[4] = {'G', 'C', 'K', 'P'};
+const uint32_t version = 4;
+
+class Writer {
+public:
+    explicit Writer(const std::string &kind) {
+        raw(magic, sizeof(magic));
+        u32(version);
+        str(kind);
+    }
+
+    void u32(uint32_t v) { raw(&v, sizeof(v)); }
+    void i32(int32_t v) { raw(&v, sizeof(v)); }
+    void u64(uint64_t v) { raw(&v, sizeof(v)); }
+    void f32(float v) { raw(&v, sizeof(v)); }
+    void f64(double v) { raw(&v, sizeof(v)); }
+    void str(const std::string &s) {
+        u64(s.size());
+        raw(s.data(), s.size());
+    }
+    // arrays of fixed-size values
+    template <class T>
+    void vec(const std::vector<T> &v) {
+        u64(v.size());
+        if (!v.empty()) raw(v.data(), v.size() * sizeof(T));
+    }
+    void strs(const std::vector<std::string> &v) {
+        u64(v.size());
+        for (const auto &s : v) str(s);
+    }
+
+    // full snapshots (deltas are resolved), each distinct topology written once
+    void snapshots(const std::vector<const NetworkSnapshot *> &list) {
+        std::vector<const SnapshotTopology *> topos;
+        std::vector<uint32_t> topo_of;
+        for (const NetworkSnapshot *s : list) {
+            if (s->empty()) {
+                topo_of.push_back(UINT32_MAX);
+                continue;
+            }
+            const SnapshotTopology *t = &s->topology();
+            size_t k = 0;
+            while (k < topos.size() && topos[k] != t) ++k;
+            if (k == topos.size()) topos.push_back(t);
+            topo_of.push_back(static_cast<uint32_t>(k));
+        }
+        u64(topos.size());
+        std::vector<std::string> ids;
+        for (const SnapshotTopology *t : topos) {
+            ids.clear();
+            for (int h = 0; h < t->numNeurons(); ++h) ids.push_back(t->id(h));
+            strs(ids);
+            vec(t->row_offsets);
+            vec(t->targets);
+        }
+        u64(list.size());
+        std::vector<float> w;
+        for (size_t i = 0; i < list.size(); ++i) {
+            u32(topo_of[i]);
+            if (topo_of[i] == UINT32_MAX) continue;
+            list[i]->weights(w);
+            vec(list[i]->thresholds());
+            vec(list[i]->leaks());
+            vec(w);
+        }
+    }
+
+    const std::string &bytes() const { return buf; }
+    std::string release() { return std::move(buf); }
+
+private:
+    void raw(const void *p, size_t n) { buf.append(static_cast<const char *>(p), n); }
+    std::string buf;
+};
+
+/*
+Reads a file back field by field. Reads past the end or of malformed data set fail()
+(with a message in error()) and return zeros/empty values, so a loader can read all its
+fields and check once at the end.
+*/
+class Reader {
+public:
+    // read `path` and check its header; false (see error()) if it isn't a `kind` checkpoint
+    bool open(const std::string &path, const std::string &kind) {
+        pos = 0;
+        failed = false;
+        message.clear();
+        std::ifstream f(path.c_str(), std::ios::in | std::ios::binary);
+        if (!f.is_open()) return fail("cannot open checkpoint " + path);
+        std::ostringstream os;
+        os << f.rdbuf();
+        return openBytes(os.str(), kind, path);
+    }
+    // the same for bytes a Writer produced (e.g. received as a message); `name` labels errors
+    bool openBytes(std::string bytes, const std::string &kind, const std::string &name) {
+        buf = std::move(bytes);
+        pos = 0;
+        failed = false;
+        message.clear();
+        char m[sizeof(magic)] = {0};
+        raw(m, sizeof(m));
+        if (failed || std::memcmp(m, magic, sizeof(magic)) != 0) return fail(name + " is not a checkpoint file");
+        const uint32_t v = u32();
+        if (v != version) return fail(name + ": unsupported checkpoint version " + std::to_string(v));
+        const std::string k = str();
+        if (k != kind) return fail(name + " is a '" + k + "' checkpoint, expected '" + kind + "'");
+        return !failed;
+    }
+
+    uint32_t u32() { uint32_t v = 0; raw(&v, sizeof(v)); return v; }
+    int32_t i32() { int32_t v = 0; raw(&v, sizeof(v)); return v; }
+    uint64_t u64() { uint64_t v = 0; raw(&v, sizeof(v)); return v; }
+    float f32() { float v = 0.0f; raw(&v, sizeof(v)); return v; }
+    double f64() { double v = 0.0; raw(&v, sizeof(v)); return v; }
+    std::string str() {
+        const uint64_t n = u64();
+        if (!fits(n, 1)) return std::string();
+        std::string s(buf, pos, static_cast<size_t>(n));
+        pos += static_cast<size_t>(n);
+        return s;
+    }
+    template <class T>
+    std::vector<T> vec() {
+        const uint64_t n = u64();
+        std::vector<T> v;
+        if (!fits(n, sizeof(T))) return v;
+        v.resize(static_cast<size_t>(n));
+        raw(v.data(), v.size() * sizeof(T));
+        return v;
+    }
+    std::vector<std::string> strs() {
+        const uint64_t n = u64();
+        std::vector<std::string> v;
+        if (!fits(n, sizeof(uint64_t))) return v;
+        v.reserve(static_cast<size_t>(n));
+        for (uint64_t i = 0; i < n && !failed; ++i) v.push_back(str());
+        return v;
+    }
+
+    // snapshots written by Writer::snapshots(); ones that share a topology share it again
+    std::vector<NetworkSnapshot> snapshots() {
+        std::vector<NetworkSnapshot> out;
+        const uint64_t num_topos = u64();
+        if (!fits(num_topos, 3 * sizeof(uint64_t))) return out;
+        std::vector<std::shared_ptr<const SnapshotTopology>> topos;
+        for (uint64_t k = 0; k < num_topos && !failed; ++k) {
+            std::shared_ptr<SnapshotTopology> t = std::make_shared<SnapshotTopology>();
+            for (const std::string &id : strs()) t->keys.push_back(nid::intern(id));
+            t->row_offsets = vec<int>();
+            t->targets = vec<int>();
+            const int n = t->numNeurons();
+            bool valid = t->row_offsets.size() == t->keys.size() + 1 && t->row_offsets.front() == 0 && t->row_offsets.back() == t->numEdges();
+            for (int h = 0; valid && h < n; ++h) valid = t->row_offsets[h] <= t->row_offsets[h + 1];
+            for (int k2 = 0; valid && k2 < t->numEdges(); ++k2) valid = t->targets[k2] >= 0 && t->targets[k2] <= n;
+            if (!failed && !valid) fail("malformed snapshot topology");
+            t->version = SnapshotTopology::nextVersion();
+            topos.push_back(t);
+        }
+        const uint64_t count = u64();
+        if (!fits(count, sizeof(uint32_t))) return out;
+        for (uint64_t i = 0; i < count && !failed; ++i) {
+            const uint32_t k = u32();
+            if (k == UINT32_MAX) {
+                out.push_back(NetworkSnapshot());
+                continue;
+            }
+            std::vector<float> thr = vec<float>(), leak = vec<float>(), w = vec<float>();
+            if (failed) break;
+            if (k >= topos.size() || thr.size() != topos[k]->keys.size() || leak.size() != thr.size() || w.size() != topos[k]->targets.size()) {
+                fail("malformed snapshot");
+                break;
+            }
+            out.push_back(NetworkSnapshot::fromParts(topos[k], std::move(thr), std::move(leak), std::move(w)));
+        }
+        return out;
+    }
+
+    // mark the file as unusable (e.g. a field doesn't fit the network); always false
+    bool fail(const std::string &why) {
+        if (!failed) message = why;
+        failed = true;
+        return false;
+    }
+    bool ok() const { return !failed; }
+    const std::string &error() const { return message; }
+
+private:
+    // n items of `size` bytes still fit in the file
+    bool fits(uint64_t n, size_t size) {
+        if (failed) return false;
+        if (n > (buf.size() - pos) / size) return fail("truncated checkpoint");
+        return true;
+    }
+    void raw(void *p, size_t n) {
+        if (failed) return;
+        if (n > buf.size() - pos) {
+            fail("truncated checkpoint");
+            return;
+        }
+        if (n) std::memcpy(p, buf.data() + pos, n);
+        pos += n;
+    }
+
+    std::string buf;
+    size_t pos = 0;
+    bool failed = false;
+    std::string message;
+};
+
+// Membrane values, staged input (including input still in a connection delay),
+// refractory counters, threshold adaptation and fired flags by handle: the part of a
+// network that carries over from one training episode to the next. Empty when the
+// network can't be compiled (it then has nothing a checkpoint could restore exactly).
+struct DynamicState {
+    std::vector<float> value, delta, on_deck;
+    std::vector<float> later; // delayed input, rows of value.size() arriving 2, 3, ... ticks from now
+    std::vector<int> refractory;
+    std::vector<uint8_t> fired;
+    std::vector<float> adaptation; // AdaptiveThreshold offsets (0 for other neuron models)
+
+    void capture(Glia &net) {
+        CompiledNetwork *cn = net.getCompiled();
+        if (!cn) {
+            *this = DynamicState();
+            return;
+        }
+        cn->settle();
+        value = cn->value;
+        delta = cn->delta;
+        on_deck = cn->on_deck;
+        // the ring unrolled from its head, so it restores into a ring of any size
+        const size_t n = value.size();
+        later.resize(static_cast<size_t>(cn->later_rows) * n);
+        for (int k = 0; k < cn->later_rows; ++k) {
+            const float *row = cn->later.data() + static_cast<size_t>((cn->later_head + k) % cn->later_rows) * n;
+            std::copy(row, row + n, later.begin() + static_cast<size_t>(k) * n);
+        }
+        refractory = cn->refractory;
+        fired = cn->fired;
+        adaptation = cn->adaptation;
+    }
+    // false if the state is of a network with another neuron count
+    bool apply(Glia &net) const {
+        if (value.empty()) return true;
+        CompiledNetwork *cn = net.getCompiled();
+        if (!cn || cn->size() != static_cast<int>(value.size())) return false;
+        cn->settle();
+        cn->value = value;
+        cn->delta = delta;
+        cn->on_deck = on_deck;
+        const int rows = std::max(cn->later_rows, static_cast<int>(later.size() / value.size()));
+        std::vector<float> ring(static_cast<size_t>(rows) * value.size(), 0.0f);
+        std::copy(later.begin(), later.end(), ring.begin());
+        cn->later.swap(ring);
+        cn->later_rows = rows;
+        cn->later_head = 0;
+        cn->refractory = refractory;
+        cn->fired = fired;
+        cn->adaptation = adaptation;
+        return true;
+    }
+    void write(Writer &w) const {
+        w.vec(value);
+        w.vec(delta);
+        w.vec(on_deck);
+        w.vec(later);
+        w.vec(refractory);
+        w.vec(fired);
+        w.vec(adaptation);
+    }
+    void read(Reader &r) {
+        value = r.vec<float>();
+        delta = r.vec<float>();
+        on_deck = r.vec<float>();
+        later = r.vec<float>();
+        refractory = r.vec<int>();
+        fired = r.vec<uint8_t>();
+        adaptation = r.vec<float>();
+        const size_t n = value.size();
+        if (delta.size() != n || on_deck.size() != n || refractory.size() != n || fired.size() != n || adaptation.size() != n || (n ? later.size() % n : later.size()) != 0) r.fail("malformed network state");
+    }
+};
+
+// Put a checkpointed network back: `s` must be of a network with the same neurons in the
+// same order (built from the same file), whose edges it then restores exactly, so
+// per-edge arrays saved alongside it line up with EdgeIndex again.
+inline bool restoreNetwork(Reader &r, Glia &net, const NetworkSnapshot &s, const DynamicState &state) {
+    if (s.empty()) return r.fail("checkpoint has no network");
+    if (net.getAllNeuronKeys() != s.topology().keys) return r.fail("checkpoint was taken from a network with other neurons");
+    s.restore(net);
+    EdgeIndex e;
+    e.build(net);
+    if (e.row_offsets != s.topology().row_offsets || e.targets != s.topology().targets) return r.fail("checkpoint edges don't fit the network");
+    if (!state.apply(net)) return r.fail("checkpoint network state doesn't fit the network");
+    return true;
+}
+
+// write `bytes` to `path` atomically: into path + ".tmp", flushed to disk, then renamed
+inline bool writeFile(const std::string &path, const std::string &bytes, std::string &error) {
+    const std::string tmp = path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        error = "cannot write " + tmp;
+        return false;
+    }
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size() && std::fflush(f) == 0;
+#if !defined(_WIN32)
+    ok = ok && ::fsync(fileno(f)) == 0;
+#endif
+    ok = std::fclose(f) == 0 && ok;
+#if defined(_WIN32)
+    if (ok) std::remove(path.c_str()); // rename doesn't replace on Windows
+#endif
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        error = "failed to write checkpoint " + path;
+        return false;
+    }
+    return true;
+}
+
+/*
+Writes submitted checkpoints on a background thread (started by the first submit()).
+submit() only hands over the bytes; if the previous file is still being written, the new
+one waits as the single pending write and replaces any older pending one, since only the
+latest checkpoint matters. Failures are reported on cerr and by flush().
+*/
+class AsyncWriter {
+public:
+    AsyncWriter() {}
+    ~AsyncWriter() {
+        flush();
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> g(lock);
+                stopping = true;
+            }
+            cv.notify_all();
+            worker.join();
+        }
+    }
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    void submit(const std::string &path, std::string bytes) {
+        {
+            std::lock_guard<std::mutex> g(lock);
+            pending_path = path;
+            pending.swap(bytes);
+            has_pending = true;
+        }
+        if (!worker.joinable()) worker = std::thread(&AsyncWriter::run, this);
+        cv.notify_all();
+    }
+
+    // wait until every submitted checkpoint is on disk; false if one failed since the
+    // last flush() (`error` says why)
+    bool flush(std::string *error = nullptr) {
+        std::unique_lock<std::mutex> g(lock);
+        cv.wait(g, [&]() { return !has_pending && !writing; });
+        const bool ok = last_error.empty();
+        if (error) *error = last_error;
+        last_error.clear();
+        return ok;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> g(lock);
+        for (;;) {
+            cv.wait(g, [&]() { return has_pending || stopping; });
+            if (!has_pending) return;
+            std::string path, bytes;
+            path.swap(pending_path);
+            bytes.swap(pending);
+            has_pending = false;
+            writing = true;
+            g.unlock();
+            std::string err;
+            const bool ok = writeFile(path, bytes, err);
+            if (!ok) std::cerr << err << std::endl;
+            g.lock();
+            if (!ok) last_error = err;
+            writing = false;
+            cv.notify_all();
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::thread worker;
+    std::string pending_path;
+    std::string pending;
+    bool has_pending = false;
+    bool writing = false;
+    bool stopping = false;
+    std::string last_error;
+};
+
+} // namespace ckpt
@@ -0,0 +1,158 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "../arch/glia.h"
+#include "../arch/compiled_network.h"
+#include "../arch/batched_network.h"
+#include "../arch/input_sequence.h"
+#include "../arch/profiling.h"
+#include "../arch/thread_pool.h"
+#include "episode_source.h"
+#include "checkpoint.h"
+#include "hebbian/training_config.h"
+
+/*
+Whole-dataset evaluation, shared by the trainers' evaluateDataset().
+
+Every episode starts from the network's state at the call, as in a lockstep batch, so the
+episodes are independent of each other and of their order: they run as BatchedNetwork
+lanes, at most kEvalLanes at a time per worker, over min(batch_threads, episodes) workers
+on the trainer's pool, and each lane's recorded spikes are scored on its worker. Neither
+the network (weights or state) nor the trainer change. A network BatchedNetwork can't
+simulate (CompiledNetwork::basicDynamics()) is evaluated one episode at a time with the
+trainer's evaluate(), its start state put back before each episode and at the end.
+
+    DatasetMetrics m = trainer.evaluateDataset(val_set, cfg);
+    std::cout << m.accuracy << " " << m.mean_margin << "\n";
+*/
+
+// Results of evaluateDataset(): per-episode winners and margins, and their summary
+struct DatasetMetrics {
+    std::vector<std::string> labels;  // the network's output IDs (O*), by handle
+
+    // per episode, in dataset order; winner and target index labels, -1 for no winner
+    // or an ID that isn't an output
+    std::vector<int> winner;
+    std::vector<int> target;
+    std::vector<float> margin;
+    std::vector<int> ticks;           // ticks run (less than warmup + window after an early exit)
+    std::vector<uint8_t> correct;     // winner ID == target ID
+
+    // confusion[t * (L + 1) + w]: episodes with target t won by w, L = labels.size();
+    // row and column L count the -1s
+    std::vector<int> confusion;
+    size_t num_correct = 0;
+    double accuracy = 0.0;
+    double mean_margin = 0.0;
+    double mean_ticks = 0.0;
+
+    size_t size() const { return winner.size(); }
+    void resize(size_t n) {
+        winner.resize(n, -1); target.resize(n, -1);
+        margin.resize(n, 0.0f); ticks.resize(n, 0); correct.resize(n, 0);
+    }
+    int labelIndex(const std::string &id) const {
+        for (size_t i = 0; i < labels.size(); ++i) if (labels[i] == id) return static_cast<int>(i);
+        return -1;
+    }
+    void record(size_t i, const std::string &winner_id, const std::string &target_id, float m, int t) {
+        winner[i] = winner_id.empty() ? -1 : labelIndex(winner_id);
+        target[i] = labelIndex(target_id);
+        margin[i] = m;
+        ticks[i] = t;
+        correct[i] = winner_id == target_id ? 1 : 0;
+    }
+    // the summary of the episodes recorded so far
+    void finish() {
+        const size_t L = labels.size(), n = size();
+        confusion.assign((L + 1) * (L + 1), 0);
+        num_correct = 0;
+        double sum_margin = 0.0, sum_ticks = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const size_t t = target[i] < 0 ? L : static_cast<size_t>(target[i]);
+            const size_t w = winner[i] < 0 ? L : static_cast<size_t>(winner[i]);
+            confusion[t * (L + 1) + w] += 1;
+            num_correct += correct[i];
+            sum_margin += static_cast<double>(margin[i]);
+            sum_ticks += ticks[i];
+        }
+        accuracy = n == 0 ? 0.0 : static_cast<double>(num_correct) / static_cast<double>(n);
+        mean_margin = n == 0 ? 0.0 : sum_margin / static_cast<double>(n);
+        mean_ticks = n == 0 ? 0.0 : sum_ticks / static_cast<double>(n);
+    }
+};
+
+namespace dataset_eval {
+
+// lanes of one BatchedNetwork run; bounds the recorded spikes to lanes x ticks x neurons bytes
+const int kEvalLanes = 64;
+
+inline int workers(size_t episodes, const TrainingConfig &cfg) {
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(std::max(1, cfg.batch_threads)), episodes)));
+}
+
+// Run eps[0..n) as lanes from the network's current state over workers(n, cfg) workers,
+// calling score(worker, bn, lane, k) for episode k once its lanes have run (on that
+// worker's thread; the worker's records go to `profile`). False, running nothing, if
+// BatchedNetwork can't simulate the network.
+template <class Score>
+bool runLanes(Glia &glia, const EpisodeData *const *eps, size_t n, const TrainingConfig &cfg,
+              ThreadPool &pool, std::vector<BatchedNetwork> &lane_nets, prof::Stats &profile, Score score) {
+    CompiledNetwork *cn = glia.getCompiled();
+    if (!cn || !cn->basicDynamics()) return false;
+    if (n == 0) return true;
+    const int W = workers(n, cfg);
+    if (static_cast<int>(lane_nets.size()) < W) lane_nets.resize(W);
+    std::vector<prof::Stats> profiles(W);
+    const int ticks = cfg.warmup_ticks + cfg.decision_window;
+    pool.parallelFor(W, [&](int w) {
+        GLIA_PROF_BIND(&profiles[w]);
+        const size_t lo = n * w / W, hi = n * (w + 1) / W;
+        BatchedNetwork &bn = lane_nets[w];
+        bn.setDevice(cfg.device_batch);
+        std::vector<const InputSequence *> seqs;
+        for (size_t b = lo; b < hi; b += kEvalLanes) {
+            const int lanes = static_cast<int>(std::min<size_t>(kEvalLanes, hi - b));
+            bn.build(*cn, lanes);
+            seqs.resize(lanes);
+            for (int l = 0; l < lanes; ++l) seqs[l] = &eps[b + l]->seq;
+            bn.run(seqs.data(), lanes, ticks);
+            for (int l = 0; l < lanes; ++l) score(w, static_cast<const BatchedNetwork &>(bn), l, b + l);
+        }
+    });
+    for (const prof::Stats &p : profiles) profile.merge(p);
+    return true;
+}
+
+// The fallback: evaluate(seq, k) on a copy of each episode's sequence in turn, the
+// network's dynamic state put back before each and at the end
+template <class Evaluate>
+void runSerial(Glia &glia, const EpisodeData *const *eps, size_t n, Evaluate evaluate) {
+    ckpt::DynamicState start;
+    start.capture(glia);
+    for (size_t k = 0; k < n; ++k) {
+        start.apply(glia);
+        InputSequence seq = eps[k]->seq;
+        evaluate(seq, k);
+    }
+    start.apply(glia);
+}
+
+// Hand the source's episodes in order to evaluate(items, n), in blocks loaded ahead by an
+// EpisodePipeline (in-memory episodes are passed in place)
+template <class Evaluate>
+void forEachBlock(EpisodeSource &source, const TrainingConfig &cfg, Evaluate evaluate) {
+    std::vector<size_t> order;
+    epochOrder(order, source.size(), false, 0, 0);
+    source.beginEpoch(EpisodeSource::kEvaluation);
+    EpisodePipeline pipeline(source, cfg.prefetch_batches);
+    pipeline.start(order, static_cast<size_t>(kEvalLanes) * static_cast<size_t>(std::max(1, cfg.batch_threads)));
+    EpisodePipeline::Batch b;
+    while (pipeline.next(b)) evaluate(b.items, b.size);
+}
+
+} // namespace dataset_eval
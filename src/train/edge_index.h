@@ -0,0 +1,219 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <string>
+
+#include "../arch/glia.h"
+#include "../arch/neuron.h"
+
+/*
+Flat index of a network's edges for the trainers. Rows are neurons by Glia handle (tick
+order) and a row's edges are in connection-map order, i.e. edge k is the k-th edge
+visited by forEachNeuron() + getConnections(). Per-edge training state (eligibility,
+deltas, usage, prune counters, optimizer moments) lives in arrays aligned with it, so the
+per-tick trace update is a pass over contiguous floats instead of "FROM|TO" map lookups.
+
+Targets that are not neurons of the network point at the extra slot numNeurons(), so
+per-neuron arrays indexed by target need numNeurons() + 1 entries (the last one 0).
+
+Structural plasticity edits the index in place (see structural_plasticity.h): removed
+edges are tombstoned, so every edge index stays valid, and new edges are queued until
+compactInto() merges both into a fresh index in one pass.
+*/
+struct EdgeIndex {
+    std::vector<int> row_offsets; // edges of neuron h are [row_offsets[h], row_offsets[h+1])
+    std::vector<int> sources;     // source handle per edge
+    std::vector<int> targets;     // target handle per edge
+    std::vector<float> weights;   // weight per edge when built (or at syncWeights()/storeWeights())
+    std::vector<int> in_offsets;  // edges into neuron h are in_edges[in_offsets[h] .. in_offsets[h+1])
+    std::vector<int> in_edges;    // edge indices grouped by target, sources in handle order
+
+    int numNeurons() const { return row_offsets.empty() ? 0 : static_cast<int>(row_offsets.size()) - 1; }
+    int numEdges() const { return static_cast<int>(targets.size()); }
+
+    // pending edits
+    struct NewEdge { int source, target; float weight; bool dropped; };
+    std::vector<uint8_t> dead;    // per edge, empty until the first tombstone
+    std::vector<int> removed;     // tombstoned edges, in the order they were removed
+    std::vector<NewEdge> added;   // queued edges (targets in the network), not in the rows yet;
+                                  // a dropped one is left out again
+
+    bool alive(int k) const { return dead.empty() || !dead[k]; }
+    bool edited() const { return !removed.empty() || !added.empty(); }
+    void tombstone(int k) {
+        if (dead.empty()) dead.assign(targets.size(), 0);
+        if (dead[k]) return;
+        dead[k] = 1;
+        removed.push_back(k);
+    }
+    void append(int source, int target, float weight) { added.push_back(NewEdge{source, target, weight, false}); }
+
+    void build(Glia &glia) {
+        // neuron -> handle as a sorted (pointer, handle) list; kept in `handle_scratch` so
+        // rebuilding an index doesn't allocate once it has grown to the network's size
+        std::vector<std::pair<const Neuron *, int>> &handle = handle_scratch;
+        handle.clear();
+        int n = 0;
+        glia.forEachNeuron([&](Neuron &nr){ handle.emplace_back(&nr, n++); });
+        std::sort(handle.begin(), handle.end());
+
+        row_offsets.assign(1, 0);
+        row_offsets.reserve(n + 1);
+        sources.clear();
+        targets.clear();
+        weights.clear();
+        int h = 0;
+        glia.forEachNeuron([&](Neuron &from){
+            for (const auto &kv : from.getConnections()) {
+                sources.push_back(h);
+                const Neuron *to = kv.second.second;
+                auto it = std::lower_bound(handle.begin(), handle.end(), std::make_pair(to, -1));
+                targets.push_back(it != handle.end() && it->first == to ? it->second : n);
+                weights.push_back(kv.second.first);
+            }
+            row_offsets.push_back(static_cast<int>(targets.size()));
+            ++h;
+        });
+        clearEdits();
+        buildInEdges();
+    }
+
+    // weights re-read from the network, whose edges must still be those of the index
+    void syncWeights(Glia &glia) {
+        int k = 0;
+        glia.forEachNeuron([&](Neuron &from){
+            for (const auto &kv : from.getConnections()) weights[k++] = kv.second.first;
+        });
+    }
+
+    // write `weights` back to the network (same topology), a row per neuron
+    void storeWeights(Glia &glia) const {
+        int h = 0;
+        glia.forEachNeuron([&](Neuron &from){
+            if (row_offsets[h + 1] > row_offsets[h]) from.setTransmitters(&weights[row_offsets[h]]);
+            ++h;
+        });
+    }
+
+    // `out` = this index with the pending edits applied, i.e. what build() gives once the
+    // network has them: rows stay in connection-map order, new edges placed by target ID
+    // (`keys`, the interned IDs by handle). from[k] = the edge of this index that became out's edge k, -1
+    // for a new one. One pass over the edges plus sorting the new ones. False (and `out`
+    // untouched) if a row with new edges also has an edge out of the network, whose place
+    // in the row can't be told from handles; build() from the network then.
+    bool compactInto(EdgeIndex &out, const std::vector<nid::Key> &keys, std::vector<int> &from) const {
+        const nid::ByName by_name;
+        const int n = numNeurons();
+        std::vector<int> &order = out.order_scratch;
+        order.clear();
+        for (size_t i = 0; i < added.size(); ++i)
+            if (!added[i].dropped) order.push_back(static_cast<int>(i));
+        std::sort(order.begin(), order.end(), [&](int a, int b){
+            if (added[a].source != added[b].source) return added[a].source < added[b].source;
+            return by_name(keys[added[a].target], keys[added[b].target]);
+        });
+        for (size_t i = 0; i < order.size(); ++i) {
+            const int h = added[order[i]].source;
+            if (i > 0 && added[order[i - 1]].source == h) continue;
+            for (int k = row_offsets[h]; k < row_offsets[h + 1]; ++k)
+                if (targets[k] == n && alive(k)) return false;
+        }
+
+        const int E = numEdges() - static_cast<int>(removed.size()) + static_cast<int>(order.size());
+        out.row_offsets.assign(1, 0);
+        out.row_offsets.reserve(n + 1);
+        out.sources.resize(E);
+        out.targets.resize(E);
+        out.weights.resize(E);
+        from.resize(E);
+        int e = 0;
+        size_t a = 0;
+        auto emitNew = [&](){
+            const NewEdge &ne = added[order[a++]];
+            out.sources[e] = ne.source; out.targets[e] = ne.target; out.weights[e] = ne.weight; from[e++] = -1;
+        };
+        for (int h = 0; h < n; ++h) {
+            for (int k = row_offsets[h]; k < row_offsets[h + 1]; ++k) {
+                if (!alive(k)) continue;
+                while (a < order.size() && added[order[a]].source == h && by_name(keys[added[order[a]].target], keys[targets[k]])) emitNew();
+                out.sources[e] = h; out.targets[e] = targets[k]; out.weights[e] = weights[k]; from[e++] = k;
+            }
+            while (a < order.size() && added[order[a]].source == h) emitNew();
+            out.row_offsets.push_back(e);
+        }
+        out.clearEdits();
+        out.buildInEdges();
+        return true;
+    }
+
+    // same neurons and edges (weights aside)
+    bool sameTopology(const EdgeIndex &o) const { return row_offsets == o.row_offsets && targets == o.targets; }
+
+private:
+    std::vector<std::pair<const Neuron *, int>> handle_scratch;
+    std::vector<int> fill_scratch;
+    std::vector<int> order_scratch;
+
+    void clearEdits() { dead.clear(); removed.clear(); added.clear(); }
+
+    void buildInEdges() {
+        const int n = numNeurons();
+        in_offsets.assign(n + 2, 0);
+        for (int t : targets) in_offsets[t + 1]++;
+        for (int i = 0; i <= n; ++i) in_offsets[i + 1] += in_offsets[i];
+        in_edges.assign(targets.size(), 0);
+        std::vector<int> &fill = fill_scratch;
+        fill.assign(in_offsets.begin(), in_offsets.end() - 1);
+        for (int k = 0; k < numEdges(); ++k) in_edges[fill[targets[k]]++] = k;
+    }
+};
+
+// Carry per-edge state (aligned with `prev`) over to `next`: edges present in both keep
+// their value, new edges get `fill`. If the neuron count changed, handles are not
+// comparable and everything is reset to `fill`.
+template <class T>
+void remapEdgeState(const EdgeIndex &prev, const EdgeIndex &next, std::vector<T> &state, T fill) {
+    std::vector<T> out(next.numEdges(), fill);
+    if (prev.numNeurons() == next.numNeurons() && static_cast<int>(state.size()) == prev.numEdges()) {
+        std::unordered_map<uint64_t, int> pos;
+        pos.reserve(prev.numEdges());
+        for (int k = 0; k < prev.numEdges(); ++k)
+            pos.emplace((static_cast<uint64_t>(prev.sources[k]) << 32) | static_cast<uint32_t>(prev.targets[k]), k);
+        for (int k = 0; k < next.numEdges(); ++k) {
+            auto it = pos.find((static_cast<uint64_t>(next.sources[k]) << 32) | static_cast<uint32_t>(next.targets[k]));
+            if (it != pos.end()) out[k] = state[it->second];
+        }
+    }
+    state.swap(out);
+}
+
+// Same after EdgeIndex::compactInto(): `from` maps each new edge to its old one (-1 for
+// new edges, which get `fill`), so this is a single pass.
+template <class T>
+void remapEdgeState(const std::vector<int> &from, std::vector<T> &state, T fill) {
+    std::vector<T> out(from.size(), fill);
+    for (size_t k = 0; k < from.size(); ++k)
+        if (from[k] >= 0) out[k] = state[from[k]];
+    state.swap(out);
+}
+
+// Carry per-neuron state by handle (aligned with the keys `prev`, plus `extra` trailing
+// slots) over to the handles of `next`, e.g. after Glia::reorderNeurons(): every neuron
+// keeps its value, new neurons and the trailing slots get `fill`.
+template <class T>
+void remapNeuronState(const std::vector<nid::Key> &prev, const std::vector<nid::Key> &next, std::vector<T> &state, T fill, size_t extra = 0) {
+    std::vector<T> out(next.size() + extra, fill);
+    if (state.size() == prev.size() + extra) {
+        std::unordered_map<nid::Key, size_t> pos;
+        pos.reserve(prev.size());
+        for (size_t h = 0; h < prev.size(); ++h) pos.emplace(prev[h], h);
+        for (size_t h = 0; h < next.size(); ++h) {
+            auto it = pos.find(next[h]);
+            if (it != pos.end()) out[h] = state[it->second];
+        }
+    }
+    state.swap(out);
+}
@@ -0,0 +1,337 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../arch/glia.h"
+#include "../arch/compiled_network.h"
+#include "../arch/batched_network.h"
+#include "../arch/input_sequence.h"
+#include "../arch/neuron_ids.h"
+#include "../arch/output_detection.h"
+#include "../arch/profiling.h"
+#include "../arch/thread_pool.h"
+#include "episode_source.h"
+#include "dataset_eval.h"
+#include "hebbian/training_config.h"
+
+/*
+Evaluation of several networks on the same episodes in one pass: the members of a
+population, saved checkpoints, or an ensemble. Each network is scored exactly as its own
+trainer's evaluateDataset() would score it (every episode from the network's current state,
+BatchedNetwork lanes, cfg's detector, warmup and decision window), but an episode's inputs
+are decoded once for all of them: sensory IDs are resolved and ticks bucketed against one
+channel table, and every network replays the same arrays (through a handle map if its
+sensory neurons are in another order).
+
+The work is split into (block of dataset_eval::kEvalLanes episodes, network) tasks over
+min(batch_threads, tasks) workers. A task runs one network's lanes over all ticks of the
+block, so that network's state stays in cache while the decoded block is shared. Lanes
+run on the CPU (TrainingConfig::device_batch is not used).
+
+The ensemble's answer is a majority vote: an episode's winner is the output ID most
+networks chose (abstentions don't vote; ties go to the larger summed margin), its margin
+the lead in votes as a share of the networks, and its ticks the most any network ran.
+
+    EnsembleEvaluator ens;
+    std::string err;
+    if (!ens.bind({&net_a, &net_b, &net_c}, err)) std::cerr << err << "\n";
+    EnsembleMetrics m = ens.evaluateDataset(val_set, cfg);
+    std::cout << m.members[1].accuracy << " " << m.vote.accuracy << "\n";
+*/
+
+// Results of EnsembleEvaluator: one DatasetMetrics per network (bind() order) and the vote's
+struct EnsembleMetrics {
+    std::vector<DatasetMetrics> members;
+    DatasetMetrics vote;
+
+    void finish() {
+        for (DatasetMetrics &m : members) m.finish();
+        vote.finish();
+    }
+};
+
+class EnsembleEvaluator {
+public:
+    // Evaluate these networks (not owned; they must outlive the evaluator and not change
+    // shape while bound). They must have the same sensory IDs, in any order, and be
+    // networks BatchedNetwork can simulate; false (with `error` set) otherwise.
+    bool bind(const std::vector<Glia *> &networks, std::string &error) {
+        nets.clear();
+        for (size_t k = 0; k < networks.size(); ++k) {
+            CompiledNetwork *cn = networks[k] ? networks[k]->getCompiled() : nullptr;
+            if (!cn || !cn->basicDynamics()) {
+                error = "network " + std::to_string(k) + " can't run as lanes (delays or a non-lif model)";
+                return false;
+            }
+        }
+        std::vector<std::string> ids0;
+        for (size_t k = 0; k < networks.size(); ++k) {
+            std::vector<std::string> ids = sensoryIds(*networks[k]);
+            if (k == 0) { ids0 = ids; continue; }
+            std::sort(ids.begin(), ids.end());
+            std::vector<std::string> sorted0 = ids0;
+            std::sort(sorted0.begin(), sorted0.end());
+            if (ids != sorted0) {
+                error = "network " + std::to_string(k) + " has other sensory neurons than network 0";
+                return false;
+            }
+        }
+        nets = networks;
+        return true;
+    }
+
+    size_t size() const { return nets.size(); }
+    const std::vector<Glia *> &networks() const { return nets; }
+
+    // pool the tasks run on (default ThreadPool::shared())
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+
+    EnsembleMetrics evaluateDataset(const std::vector<EpisodeData> &episodes, const TrainingConfig &cfg) {
+        VectorSource source(episodes);
+        return evaluateDataset(source, cfg);
+    }
+    // episodes of `source` loaded ahead by an EpisodePipeline, as Trainer::evaluateDataset()
+    EnsembleMetrics evaluateDataset(EpisodeSource &source, const TrainingConfig &cfg) {
+        EnsembleMetrics out;
+        dataset_eval::forEachBlock(source, cfg, [&](const EpisodeData *const *items, size_t n) { evaluateEpisodes(items, n, cfg, out); });
+        out.finish();
+        return out;
+    }
+
+    // Evaluate n episodes and append them to every member's metrics and the vote's (finish()
+    // is left to the caller)
+    void evaluateEpisodes(const EpisodeData *const *eps, size_t n, const TrainingConfig &cfg, EnsembleMetrics &out) {
+        GLIA_PROF_BIND(&profile_stats);
+        const size_t K = nets.size();
+        out.members.resize(K);
+        const size_t first = out.vote.size();
+        for (DatasetMetrics &m : out.members) m.resize(first + n);
+        out.vote.resize(first + n);
+        if (K == 0 || n == 0) return;
+
+        // per network: compiled form, outputs and the channel -> sensory handle map
+        std::vector<Member> members(K);
+        std::vector<std::string> channels = sensoryIds(*nets[0]);
+        std::unordered_map<std::string, int> channel_of;
+        for (size_t c = 0; c < channels.size(); ++c) channel_of.emplace(channels[c], static_cast<int>(c));
+        for (size_t k = 0; k < K; ++k) {
+            Member &mb = members[k];
+            mb.cn = nets[k]->getCompiled();
+            const std::vector<nid::Key> keys = nets[k]->getAllNeuronKeys();
+            for (size_t h = 0; h < keys.size(); ++h) {
+                const std::string &id = nid::name(keys[h]);
+                if (!id.empty() && id[0] == 'O') { mb.output_ids.push_back(id); mb.output_handles.push_back(static_cast<int>(h)); }
+            }
+            out.members[k].labels = mb.output_ids;
+            const int S = nets[k]->getSensoryCount();
+            mb.handle_of.assign(channels.size(), -1);
+            mb.identity = S == static_cast<int>(channels.size());
+            for (int h = 0; h < S; ++h) {
+                auto it = channel_of.find(nid::name(keys[h]));
+                if (it == channel_of.end()) continue;
+                mb.handle_of[it->second] = h;
+                mb.identity = mb.identity && it->second == h;
+            }
+        }
+        for (const Member &mb : members)
+            for (const std::string &id : mb.output_ids)
+                if (out.vote.labelIndex(id) < 0) out.vote.labels.push_back(id);
+
+        const size_t L = static_cast<size_t>(dataset_eval::kEvalLanes);
+        const size_t blocks = (n + L - 1) / L;
+        const size_t tasks = blocks * K;
+        const int W = static_cast<int>(std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(std::max(1, cfg.batch_threads)), tasks)));
+        if (static_cast<int>(work.size()) < W) work.resize(W);
+        const std::shared_ptr<ThreadPool> pool = thread_pool ? thread_pool : ThreadPool::shared();
+
+        // decode every episode once against the channel table
+        decoded.resize(n);
+        pool->parallelFor(W, [&](int w) {
+            for (size_t i = n * w / W; i < n * (w + 1) / W; ++i) decode(eps[i]->seq, channel_of, work[w], decoded[i]);
+        });
+
+        // (block, network) tasks, block-major: a block's networks read its inputs close together
+        const int U = cfg.warmup_ticks, Wd = cfg.decision_window, ticks = U + Wd;
+        std::atomic<size_t> next_task(0);
+        pool->parallelFor(W, [&](int w) {
+            GLIA_PROF_BIND(&work[w].profile);
+            Work &wk = work[w];
+            for (size_t task = next_task++; task < tasks; task = next_task++) {
+                const size_t b = task / K, k = task % K;
+                const size_t lo = b * L, hi = std::min(n, lo + L);
+                const int lanes = static_cast<int>(hi - lo);
+                const Member &mb = members[k];
+                BatchedNetwork &bn = wk.bn;
+                {
+                    GLIA_PROF_SCOPE(Step);
+                    bn.build(*mb.cn, lanes);
+                    bn.beginRecording(ticks);
+                    wk.cursors.clear();
+                    for (size_t i = lo; i < hi; ++i) wk.cursors.push_back(SequenceCursor(eps[i]->seq));
+                    for (int t = 0; t < ticks; ++t) {
+                        for (int l = 0; l < lanes; ++l) {
+                            const CompiledInputSequence::Span in = decoded[lo + l].at(wk.cursors[l].tick);
+                            if (mb.identity) {
+                                for (int e = 0; e < in.size; ++e) bn.inject(in.handles[e], l, in.values[e]);
+                            } else {
+                                for (int e = 0; e < in.size; ++e) {
+                                    const int h = mb.handle_of[in.handles[e]];
+                                    if (h >= 0) bn.inject(h, l, in.values[e]);
+                                }
+                            }
+                        }
+                        bn.recordStep(t);
+                        for (int l = 0; l < lanes; ++l) wk.cursors[l].advance();
+                    }
+                }
+                GLIA_PROF_SCOPE(Detector);
+                for (int l = 0; l < lanes; ++l) {
+                    SlotDetector &detector = wk.detectors.reset(cfg, mb.output_ids, mb.output_handles);
+                    int ran = ticks;
+                    for (int t = 0; t < U; ++t) detector.updateFromFlags(bn.firedAt(l, t));
+                    detector.beginDecision();
+                    for (int t = 0; t < Wd; ++t) {
+                        detector.updateFromFlags(bn.firedAt(l, U + t));
+                        if (settled(detector, cfg.detector, t, Wd)) {
+                            ran = U + t + 1;
+                            break;
+                        }
+                    }
+                    out.members[k].record(first + lo + l, detector.winner(), eps[lo + l]->target_id, detector.margin(), ran);
+                }
+            }
+        });
+        for (Work &wk : work) {
+            profile_stats.merge(wk.profile);
+            wk.profile.reset();
+        }
+
+        // the vote
+        std::vector<int> votes(out.vote.labels.size());
+        std::vector<float> margins(out.vote.labels.size());
+        for (size_t i = first; i < first + n; ++i) {
+            std::fill(votes.begin(), votes.end(), 0);
+            std::fill(margins.begin(), margins.end(), 0.0f);
+            int ran = 0;
+            for (const DatasetMetrics &m : out.members) {
+                ran = std::max(ran, m.ticks[i]);
+                if (m.winner[i] < 0) continue;
+                const int v = out.vote.labelIndex(m.labels[m.winner[i]]);
+                votes[v] += 1;
+                margins[v] += m.margin[i];
+            }
+            int best = -1, top = 0, second = 0;
+            for (size_t v = 0; v < votes.size(); ++v) {
+                if (votes[v] == 0) continue;
+                if (best < 0 || votes[v] > top || (votes[v] == top && margins[v] > margins[best])) {
+                    second = best < 0 ? 0 : top;
+                    best = static_cast<int>(v);
+                    top = votes[v];
+                } else {
+                    second = std::max(second, votes[v]);
+                }
+            }
+            const std::string winner = best < 0 ? cfg.detector.default_id : out.vote.labels[best];
+            out.vote.record(i, winner, eps[i - first]->target_id, static_cast<float>(top - second) / static_cast<float>(K), ran);
+        }
+    }
+
+    const prof::Stats &profile() const { return profile_stats; }
+
+private:
+    // a bound network's view for one evaluateEpisodes() call
+    struct Member {
+        CompiledNetwork *cn = nullptr;
+        std::vector<std::string> output_ids;
+        std::vector<int> output_handles;
+        std::vector<int> handle_of; // channel -> sensory handle (-1: none)
+        bool identity = false;      // handle_of[c] == c for every channel
+    };
+
+    // cfg.detector's detector over a network's outputs, rebuilt only when settings change
+    struct Detectors {
+        EMASlotDetector ema;
+        WindowCountDetector count;
+        FirstSpikeDetector first_spike;
+        OutputDetectorConfig built_cfg;
+        int built_window = 0;
+        bool built = false;
+
+        SlotDetector &reset(const TrainingConfig &cfg, const std::vector<std::string> &ids, const std::vector<int> &handles) {
+            const OutputDetectorConfig &d = cfg.detector;
+            const int window = d.window > 0 ? d.window : cfg.decision_window;
+            if (!built || built_cfg.alpha != d.alpha || built_cfg.threshold != d.threshold || built_cfg.default_id != d.default_id || built_window != window) {
+                OutputDetectorOptions opts; opts.threshold = d.threshold; opts.default_id = d.default_id;
+                ema = EMASlotDetector(d.alpha, opts);
+                count = WindowCountDetector(window, opts);
+                first_spike = FirstSpikeDetector(window, opts);
+                built_cfg = d;
+                built_window = window;
+                built = true;
+            }
+            SlotDetector &det = d.type == "count" ? static_cast<SlotDetector &>(count)
+                              : d.type == "first_spike" ? static_cast<SlotDetector &>(first_spike)
+                              : static_cast<SlotDetector &>(ema);
+            if (det.outputHandles() != handles || det.outputIds() != ids) det.setOutputs(ids, handles);
+            det.reset();
+            return det;
+        }
+    };
+
+    // a worker's scratch
+    struct Work {
+        BatchedNetwork bn;
+        std::vector<SequenceCursor> cursors;
+        Detectors detectors;
+        std::vector<const InputEvent *> sorted;
+        std::vector<uint32_t> ticks, channels;
+        std::vector<float> values;
+        std::vector<int> identity; // channel c -> c, for compileEvents()
+        prof::Stats profile;
+    };
+
+    static std::vector<std::string> sensoryIds(const Glia &net) {
+        const std::vector<nid::Key> keys = net.getAllNeuronKeys();
+        std::vector<std::string> ids;
+        for (int h = 0; h < net.getSensoryCount() && h < static_cast<int>(keys.size()); ++h) ids.push_back(nid::name(keys[h]));
+        return ids;
+    }
+
+    // seq's inputs as channel indices, tick-sorted, in InputSequence ID order within a tick
+    static void decode(const InputSequence &seq, const std::unordered_map<std::string, int> &channel_of, Work &wk, CompiledInputSequence &out) {
+        wk.sorted.clear();
+        for (const auto &e : seq.getEvents()) if (e.tick >= 0) wk.sorted.push_back(&e);
+        std::sort(wk.sorted.begin(), wk.sorted.end(), [](const InputEvent *a, const InputEvent *b) { return a->tick < b->tick; });
+        wk.ticks.clear(); wk.channels.clear(); wk.values.clear();
+        for (const InputEvent *e : wk.sorted) {
+            for (const auto &kv : e->inputs) {
+                auto it = channel_of.find(kv.first);
+                if (it == channel_of.end()) continue;
+                wk.ticks.push_back(static_cast<uint32_t>(e->tick));
+                wk.channels.push_back(static_cast<uint32_t>(it->second));
+                wk.values.push_back(kv.second);
+            }
+        }
+        if (wk.identity.size() != channel_of.size()) {
+            wk.identity.resize(channel_of.size());
+            for (size_t c = 0; c < wk.identity.size(); ++c) wk.identity[c] = static_cast<int>(c);
+        }
+        out.compileEvents(wk.ticks.data(), wk.channels.data(), wk.values.data(), wk.ticks.size(), wk.identity);
+    }
+
+    // Trainer::evaluate()'s early exit after decision tick t of W
+    static bool settled(const SlotDetector &detector, const OutputDetectorConfig &dc, int t, int W) {
+        return dc.early_exit && t + 1 < W && (detector.decided(W - t - 1) || (dc.early_exit_margin > 0.0f && detector.margin() >= dc.early_exit_margin));
+    }
+
+    std::vector<Glia *> nets;
+    std::vector<Work> work;
+    std::vector<CompiledInputSequence> decoded; // per episode of the current call
+    std::shared_ptr<ThreadPool> thread_pool;
+    prof::Stats profile_stats;
+};
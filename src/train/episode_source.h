@@ -0,0 +1,238 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "../arch/input_sequence.h"
+#include "../arch/random_streams.h"
+
+// Dataset item: an input sequence paired with a target output ID (e.g., "O0").
+struct EpisodeData {
+    InputSequence seq;
+    std::string target_id;
+};
+
+/*
+Where Trainer::trainEpoch() gets its episodes from. load() fills `out` with episode i,
+reusing its storage; the pipeline calls it from one producer thread at a time, so a
+source need not be thread-safe but must not be used elsewhere while an epoch runs.
+Sources whose episodes already sit in memory return them from data(), and the pipeline
+then hands out pointers to them instead of loading copies.
+
+beginEpoch() comes before the episodes of each training epoch, with the trainer's epoch
+counter, and before an evaluation with kEvaluation. Sources that draw their episodes
+(enc::EncodedSource, src/data/spike_encoder.h) key the draws by it; others ignore it.
+*/
+class EpisodeSource {
+public:
+    static const uint64_t kEvaluation = ~0ull;
+
+    virtual ~EpisodeSource() {}
+    virtual size_t size() const = 0;
+    virtual void load(size_t i, EpisodeData &out) = 0;
+    virtual const EpisodeData *data() const { return nullptr; }
+    virtual void beginEpoch(uint64_t epoch) { (void)epoch; }
+};
+
+// an in-memory dataset, not copied (it must outlive the source)
+class VectorSource : public EpisodeSource {
+public:
+    explicit VectorSource(const std::vector<EpisodeData> &episodes) : items(episodes) {}
+    size_t size() const override { return items.size(); }
+    void load(size_t i, EpisodeData &out) override { out = items[i]; }
+    const EpisodeData *data() const override { return items.data(); }
+
+private:
+    const std::vector<EpisodeData> &items;
+};
+
+// Episode indices of epoch `epoch` of a trainer seeded with `seed`: 0..n-1, shuffled (if
+// `shuffle`) from the stream (seed, Shuffle, epoch). An epoch's order doesn't depend on
+// the epochs before it, so it is the same however they were split across calls and
+// checkpoints.
+inline void epochOrder(std::vector<size_t> &order, size_t n, bool shuffle, uint64_t seed, uint64_t epoch) {
+    order.resize(n);
+    for (size_t i = 0; i < n; ++i) order[i] = i;
+    if (!shuffle) return;
+    rstream::Stream rng(rstream::key(seed, rstream::Shuffle, epoch));
+    rstream::shuffle(order.begin(), order.end(), rng);
+}
+
+/*
+Turns a source into the batches of one epoch. A background producer loads up to
+`prefetch` batches ahead into recycled slots (a bounded queue: it waits while all slots
+are full), applying timing jitter on the way, so loading overlaps simulation. Batches
+are views: in-memory episodes are handed out in place and loaded ones live in their slot
+until the next call to next(). With no jitter an in-memory source needs no producer and
+no copies at all; prefetch = 0 loads each batch in the calling thread.
+
+Jitter shifts every event of an episode by one offset drawn uniformly from
+[-timing_jitter, timing_jitter] (events moved before tick 0 are dropped). The offset of
+source episode i comes from the stream (timing_key, i) (see random_streams.h), so it
+doesn't depend on the order, batching or prefetching.
+
+    EpisodePipeline pipe(source, 2);
+    pipe.start(order, batch_size);
+    EpisodePipeline::Batch b;
+    while (pipe.next(b)) trainer.trainBatch(b.items, b.size, cfg);
+*/
+class EpisodePipeline {
+public:
+    struct Batch {
+        const EpisodeData *const *items = nullptr;
+        size_t size = 0;
+        size_t index = 0; // batch number within the epoch
+        const EpisodeData &operator[](size_t k) const { return *items[k]; }
+    };
+
+    explicit EpisodePipeline(EpisodeSource &src, int prefetch_batches = 2)
+        : source(src), prefetch(std::max(0, prefetch_batches)) {}
+    ~EpisodePipeline() { stop(); }
+    EpisodePipeline(const EpisodePipeline &) = delete;
+    EpisodePipeline &operator=(const EpisodePipeline &) = delete;
+
+    // begin an epoch over `episode_order` (indices into the source) in batches of
+    // batch_size; a running epoch is abandoned
+    void start(const std::vector<size_t> &episode_order, size_t batch_size, int timing_jitter = 0, uint64_t timing_key = 0) {
+        stop();
+        order = episode_order;
+        batch = std::max<size_t>(1, batch_size);
+        jitter = std::max(0, timing_jitter);
+        jitter_key = timing_key;
+        num_batches = (order.size() + batch - 1) / batch;
+        produced = 0;
+        held = -1;
+        done = false;
+        stopping = false;
+        ready.clear();
+        free_slots.clear();
+
+        in_place = source.data() != nullptr && jitter == 0;
+        threaded = !in_place && prefetch > 0 && num_batches > 1;
+        slots.resize(threaded ? prefetch + 1 : 1);
+        for (int s = static_cast<int>(slots.size()) - 1; s >= 0; --s) free_slots.push_back(s);
+        if (threaded) producer = std::thread(&EpisodePipeline::produce, this);
+    }
+
+    // next batch of the epoch, false after the last one; the previous batch is released
+    bool next(Batch &out) {
+        int s = -1;
+        if (!threaded) {
+            if (produced >= num_batches) return false;
+            s = 0;
+            fill(slots[0], produced++);
+        } else {
+            std::unique_lock<std::mutex> g(lock);
+            if (held >= 0) {
+                free_slots.push_back(held);
+                held = -1;
+                cv.notify_all();
+            }
+            cv.wait(g, [&]() { return !ready.empty() || done; });
+            if (ready.empty()) return false;
+            s = ready.front();
+            ready.pop_front();
+            held = s;
+        }
+        const Slot &slot = slots[s];
+        out.items = slot.ptrs.data();
+        out.size = slot.ptrs.size();
+        out.index = slot.index;
+        return true;
+    }
+
+    // end the epoch early and wait for the producer
+    void stop() {
+        if (producer.joinable()) {
+            {
+                std::lock_guard<std::mutex> g(lock);
+                stopping = true;
+            }
+            cv.notify_all();
+            producer.join();
+        }
+        threaded = false;
+        produced = num_batches;
+    }
+
+    size_t batches() const { return num_batches; }
+
+private:
+    struct Slot {
+        std::vector<EpisodeData> items; // loaded episodes (storage reused across batches)
+        std::vector<const EpisodeData *> ptrs;
+        size_t index = 0;
+    };
+
+    void fill(Slot &slot, size_t k) {
+        const size_t lo = k * batch, hi = std::min(order.size(), lo + batch);
+        slot.index = k;
+        slot.ptrs.resize(hi - lo);
+        if (in_place) {
+            const EpisodeData *data = source.data();
+            for (size_t i = lo; i < hi; ++i) slot.ptrs[i - lo] = data + order[i];
+            return;
+        }
+        if (slot.items.size() < hi - lo) slot.items.resize(hi - lo);
+        const EpisodeData *data = source.data();
+        for (size_t i = lo; i < hi; ++i) {
+            EpisodeData &ep = slot.items[i - lo];
+            if (data) ep = data[order[i]];
+            else source.load(order[i], ep);
+            if (jitter > 0) ep.seq.shiftTicks(rstream::Stream(rstream::mix(jitter_key, order[i])).between(-jitter, jitter));
+            slot.ptrs[i - lo] = &ep;
+        }
+    }
+
+    void produce() {
+        for (size_t k = 0; k < num_batches; ++k) {
+            int s;
+            {
+                std::unique_lock<std::mutex> g(lock);
+                cv.wait(g, [&]() { return !free_slots.empty() || stopping; });
+                if (stopping) return;
+                s = free_slots.back();
+                free_slots.pop_back();
+            }
+            fill(slots[s], k);
+            {
+                std::lock_guard<std::mutex> g(lock);
+                ready.push_back(s);
+            }
+            cv.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> g(lock);
+            done = true;
+        }
+        cv.notify_all();
+    }
+
+    EpisodeSource &source;
+    int prefetch;
+
+    // the epoch
+    std::vector<size_t> order;
+    size_t batch = 1;
+    size_t num_batches = 0;
+    int jitter = 0;
+    uint64_t jitter_key = 0;
+    bool in_place = false;
+    bool threaded = false;
+    size_t produced = 0; // batches filled (calling-thread mode)
+
+    std::vector<Slot> slots;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<int> ready;       // filled slots in batch order
+    std::vector<int> free_slots;
+    int held = -1;               // slot of the batch last returned by next()
+    bool done = false;
+    bool stopping = false;
+    std::thread producer;
+};
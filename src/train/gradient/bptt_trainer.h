@@ -0,0 +1,711 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "../hebbian/trainer.h" // for EpisodeMetrics, EpisodeData, and TrainingConfig via include chain
+#include "../../arch/glia.h"
+#include "../../arch/neuron.h"
+#include "../../arch/input_sequence.h"
+#include "../../arch/compiled_network.h"
+#include "../../arch/batched_network.h"
+#include "../../arch/profiling.h"
+#include "../../arch/thread_pool.h"
+#include "../../arch/telemetry.h"
+#include "../../arch/random_streams.h"
+#include "../edge_index.h"
+#include "../structural_plasticity.h"
+#include "../optimizer.h"
+#include "../checkpoint.h"
+#include "../dataset_eval.h"
+
+/*
+Surrogate-gradient backpropagation through time over the compiled engine.
+
+The forward pass is the engine's own: episodes run through Glia (or, for lockstep and
+threaded batches, BatchedNetwork lanes from the batch-start state, as in RateGDTrainer),
+and only their spike rasters are kept. The loss is RateGDTrainer's softmax cross-entropy
+over the outputs' EMA rates at the end of the episode, so evaluate() and the metrics read
+the same thing; every output spike gets dL/drate * alpha * (1 - alpha)^(ticks after it).
+
+The backward pass treats the network as the Lif update of membrane_kernels.h, with
+input that arrives one tick after a spike along edges to later neurons in tick order and
+two ticks after it along the others (see CompiledNetwork::step()):
+    a(t) = leak * u(t-1) + I(t),  v = max(0, a),  s = H(v - threshold),  u = s ? resting : v
+The spike uses the surrogate ds/dv = 1 / (scale * (1 + beta * |v - threshold| / scale)^2)
+with scale = |threshold| (GradConfig::surrogate_beta), and the reset is not
+differentiated. Spikes always come from the raster, so the gradient is exact for the
+recorded trajectory up to the surrogate. Neuron models other than Lif and synaptic
+delays are trained as if they were Lif with unit delays.
+
+Memory is bounded by GradConfig::bptt_window (K ticks): the forward recomputation keeps
+the membranes at the start of every window only, and the backward pass walks the windows
+from last to first, recomputing one window's membranes from its checkpoint at a time,
+so it holds (T/K + K) * N floats per episode instead of T * N. With bptt_truncate the
+adjoint is dropped at window boundaries (truncated BPTT); otherwise the result is full
+BPTT whatever K is. All episodes of a batch (a worker's lanes, with batch_threads > 1)
+are propagated together, [neuron][lane] like BatchedNetwork, so each edge is read once
+per tick for all of them. Gradients are reduced in batch order and don't depend on
+batch_threads.
+*/
+class BpttTrainer {
+public:
+    explicit BpttTrainer(Glia &net) : glia(net) {}
+    // seed of the random streams (see Trainer::reseed)
+    void reseed(unsigned int s) { seed = s; }
+    std::vector<double> getEpochAccHistory() const { return epoch_acc_hist; }
+    std::vector<double> getEpochMarginHistory() const { return epoch_margin_hist; }
+    int epochsCompleted() const { return static_cast<int>(epoch_acc_hist.size()); }
+    // see Trainer::profile()
+    const prof::Stats &profile() const { return profile_stats; }
+    void resetProfile() { profile_stats.reset(); }
+    // pool for batch workers (see Trainer::setThreadPool)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+    // progress records of trainEpoch() (see Trainer::setTelemetry)
+    void setTelemetry(std::shared_ptr<telemetry::Sink> sink) { telemetry_sink = std::move(sink); }
+
+    // On-disk checkpoints, as RateGDTrainer's
+    static const char *checkpointKind() { return "bptt"; }
+    void saveState(ckpt::Writer &w) {
+        refreshEdges();
+        NetworkSnapshot now = NetworkSnapshot::capture(glia);
+        w.snapshots(std::vector<const NetworkSnapshot *>(1, &now));
+        ckpt::DynamicState state; state.capture(glia); state.write(w);
+        w.u64(seed); w.u64(structure_passes);
+        w.vec(neuron_rate);
+        w.vec(adam_m); w.vec(adam_v); w.i32(adam_step);
+        w.vec(epoch_acc_hist); w.vec(epoch_margin_hist);
+    }
+    bool loadState(ckpt::Reader &r) {
+        std::vector<NetworkSnapshot> snaps = r.snapshots();
+        ckpt::DynamicState state; state.read(r);
+        const uint64_t stream_seed = r.u64(), passes = r.u64();
+        std::vector<float> rates = r.vec<float>();
+        std::vector<float> m = r.vec<float>(), v = r.vec<float>(); const int step = r.i32();
+        std::vector<double> acc = r.vec<double>(), margin = r.vec<double>();
+        if (!r.ok()) return false;
+        if (snaps.size() != 1) return r.fail("malformed trainer state");
+        const SnapshotTopology &t = snaps[0].topology();
+        if (m.size() != t.targets.size() || v.size() != t.targets.size() || rates.size() != t.keys.size() + 1) return r.fail("trainer state doesn't match its network");
+        if (!ckpt::restoreNetwork(r, glia, snaps[0], state)) return false;
+        refreshEdges();
+        adam_m.swap(m); adam_v.swap(v); adam_step = step;
+        neuron_rate.swap(rates);
+        seed = stream_seed; structure_passes = passes;
+        epoch_acc_hist.swap(acc); epoch_margin_hist.swap(margin);
+        return true;
+    }
+    bool saveCheckpoint(const std::string &path, std::string &error) {
+        ckpt::Writer w(checkpointKind()); saveState(w);
+        return ckpt::writeFile(path, w.bytes(), error);
+    }
+    bool loadCheckpoint(const std::string &path, std::string &error) {
+        ckpt::Reader r;
+        if (!r.open(path, checkpointKind()) || !loadState(r)) { error = r.error(); return false; }
+        return true;
+    }
+    bool flushCheckpoints(std::string &error) { return checkpoint_writer.flush(&error); }
+
+    EpisodeMetrics evaluate(InputSequence &seq, const TrainingConfig &cfg) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshNeurons();
+        neuron_rate.assign(glia.getNeuronCount() + 1, 0.0f);
+        seq.reset();
+        episode_inputs.compile(seq, sensory_ids);
+        const int U = cfg.warmup_ticks;
+        const int W = cfg.decision_window;
+        for (int t = 0; t < U + W; ++t) {
+            injectAt(seq.getCurrentTick());
+            glia.step();
+            GLIA_PROF_SCOPE(Detector);
+            int slot = 0;
+            glia.forEachNeuron([&](Neuron &n){ float &r = neuron_rate[slot++]; r = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (n.didFire() ? 1.0f : 0.0f); });
+            seq.advance();
+        }
+        EpisodeMetrics m;
+        fillMetrics(m, neuron_rate, U + W);
+        return m;
+    }
+
+    // Evaluate every episode of a dataset from the network's current state, as evaluate()
+    // reads it (see Trainer::evaluateDataset and dataset_eval.h); the network and the
+    // trainer are left as they were
+    DatasetMetrics evaluateDataset(const std::vector<Trainer::EpisodeData> &dataset, const TrainingConfig &cfg) {
+        VectorSource source(dataset);
+        return evaluateDataset(source, cfg);
+    }
+    DatasetMetrics evaluateDataset(EpisodeSource &source, const TrainingConfig &cfg) {
+        DatasetMetrics out;
+        dataset_eval::forEachBlock(source, cfg, [&](const Trainer::EpisodeData *const *items, size_t n) { evaluateEpisodes(items, n, cfg, out); });
+        out.finish();
+        return out;
+    }
+    // see Trainer::evaluateEpisodes
+    void evaluateEpisodes(const Trainer::EpisodeData *const *eps, size_t n, const TrainingConfig &cfg, DatasetMetrics &out) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshNeurons();
+        out.labels = output_ids;
+        const size_t first = out.size();
+        out.resize(first + n);
+        const int workers = dataset_eval::workers(n, cfg);
+        if (static_cast<int>(worker_ws.size()) < workers - 1) worker_ws.resize(workers - 1);
+        std::vector<EpisodeMetrics> worker_metrics(workers);
+        const int T = cfg.warmup_ticks + cfg.decision_window;
+        const float a = cfg.rate_alpha;
+        const bool lanes = dataset_eval::runLanes(glia, eps, n, cfg, *ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool), lane_nets, profile_stats,
+            [&](int w, const BatchedNetwork &bn, int lane, size_t k) {
+                GLIA_PROF_SCOPE(Detector);
+                std::vector<float> &r = (w == 0 ? ws : worker_ws[w - 1]).rates; // only the outputs' are read
+                r.assign(bn.size() + 1, 0.0f);
+                for (int t = 0; t < T; ++t) {
+                    const uint8_t *fired = bn.firedAt(lane, t);
+                    for (int h : output_handles) r[h] = (1.0f - a) * r[h] + a * (fired[h] ? 1.0f : 0.0f);
+                }
+                EpisodeMetrics &m = worker_metrics[w];
+                fillMetrics(m, r, T);
+                out.record(first + k, m.winner_id, eps[k]->target_id, m.margin, m.ticks_run);
+            });
+        if (!lanes) {
+            std::vector<float> rates = neuron_rate; // evaluate() restarts them
+            dataset_eval::runSerial(glia, eps, n, [&](InputSequence &seq, size_t k) {
+                const EpisodeMetrics m = evaluate(seq, cfg);
+                out.record(first + k, m.winner_id, eps[k]->target_id, m.margin, m.ticks_run);
+            });
+            neuron_rate.swap(rates);
+        }
+    }
+
+    void trainBatch(const std::vector<Trainer::EpisodeData> &batch,
+                    const TrainingConfig &cfg,
+                    std::vector<EpisodeMetrics> *batch_metrics_out = nullptr) {
+        batch_items.resize(batch.size());
+        for (size_t b = 0; b < batch.size(); ++b) batch_items[b] = &batch[b];
+        trainBatch(batch_items.data(), batch_items.size(), cfg, batch_metrics_out);
+    }
+
+    // Same over episodes held elsewhere (see Trainer::trainBatch); they are only read.
+    void trainBatch(const Trainer::EpisodeData *const *batch, size_t batch_size,
+                    const TrainingConfig &cfg,
+                    std::vector<EpisodeMetrics> *batch_metrics_out = nullptr) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshEdges();
+        if (batch_metrics_out) batch_metrics_out->resize(batch_size);
+        if (batch_size == 0) return;
+        CompiledNetwork *cn = glia.getCompiled();
+        if (!cn) {
+            // nothing to record spikes from: report the episodes, leave the weights
+            if (!warned_uncompiled) { std::cerr << "BpttTrainer: network can't be compiled; batches are evaluated without updates" << std::endl; warned_uncompiled = true; }
+            for (size_t b = 0; b < batch_size; ++b) {
+                InputSequence seq = batch[b]->seq;
+                EpisodeMetrics m = evaluate(seq, cfg);
+                if (batch_metrics_out) (*batch_metrics_out)[b] = m;
+            }
+            return;
+        }
+        runBatch(*cn, batch, batch_size, cfg);
+        // reduce in batch order, so the sum doesn't depend on how lanes were split
+        const int E = edges.numEdges();
+        sum_grad.assign(E, 0.0f);
+        for (int w = 0; w < active_workers; ++w) {
+            const BpttWorkspace &wk = workspace(w);
+            const int L = wk.lanes;
+            for (int k = 0; k < E; ++k) { const float *g = wk.egrad.data() + static_cast<size_t>(k) * L; float s = sum_grad[k]; for (int l = 0; l < L; ++l) s += g[l]; sum_grad[k] = s; }
+        }
+        if (batch_metrics_out) for (size_t b = 0; b < batch_size; ++b) (*batch_metrics_out)[b] = metrics[b];
+        applyGradients(sum_grad, 1.0f / static_cast<float>(batch_size), cfg);
+        postBatchPlasticity(cfg);
+    }
+
+    void trainEpoch(const std::vector<Trainer::EpisodeData> &dataset, int epochs, const TrainingConfig &cfg) {
+        VectorSource source(dataset);
+        trainEpoch(source, epochs, cfg);
+    }
+
+    // see Trainer::trainEpoch(EpisodeSource &, ...)
+    void trainEpoch(EpisodeSource &source, int epochs, const TrainingConfig &cfg) {
+        if (source.size() == 0 || epochs <= 0) return;
+        GLIA_PROF_BIND(&profile_stats);
+        if (cfg.weight_jitter_std > 0.0f) {
+            uint64_t row = 0; // as Trainer's: row r draws from (seed, WeightJitter, epoch, r)
+            glia.forEachNeuron([&](Neuron &from){
+                rstream::Stream g(rstream::key(seed, rstream::WeightJitter, epochsCompleted(), row++));
+                const auto &conns = from.getConnections();
+                for (const auto &kv : conns) { float w = kv.second.first; w += g.normal(0.0f, cfg.weight_jitter_std); from.setTransmitter(kv.first, w); }
+            });
+        }
+        std::vector<size_t> &order = episode_order;
+        EpisodePipeline pipeline(source, cfg.prefetch_batches);
+        for (int e = 0; e < epochs; ++e) {
+            const uint64_t epoch = static_cast<uint64_t>(epochsCompleted());
+            epochOrder(order, source.size(), cfg.shuffle, seed, epoch);
+            source.beginEpoch(epoch);
+            pipeline.start(order, static_cast<size_t>(std::max(1, cfg.batch_size)), cfg.timing_jitter, rstream::key(seed, rstream::TimingJitter, epoch));
+            prof::flush();
+            const prof::Stats epoch_start = profile_stats;
+            const auto epoch_t0 = std::chrono::steady_clock::now();
+            const uint64_t grown0 = structural.grownTotal(), pruned0 = structural.prunedTotal();
+            size_t epoch_total = 0, epoch_correct = 0; double epoch_margin_sum = 0.0;
+            EpisodePipeline::Batch batch; std::vector<EpisodeMetrics> bm; // reused across batches
+            while (pipeline.next(batch)) {
+                trainBatch(batch.items, batch.size, cfg, &bm);
+                // with a telemetry sink, batch progress goes to it instead of the console
+                const bool log_batch = cfg.verbose && cfg.log_every > 0 && ((e + 1) % cfg.log_every == 0);
+                if (log_batch || telemetry_sink) {
+                    int correct = 0; double avg_margin = 0.0;
+                    for (size_t k = 0; k < bm.size(); ++k) { avg_margin += bm[k].margin; if (k < batch.size && bm[k].winner_id == batch[k].target_id) correct++; }
+                    if (!bm.empty()) avg_margin /= static_cast<double>(bm.size());
+                    const double batch_acc = bm.empty() ? 0.0 : static_cast<double>(correct) / static_cast<double>(bm.size());
+                    if (telemetry_sink) telemetry_sink->emit(telemetry::batchRecord(static_cast<int>(epoch) + 1, static_cast<int>(batch.index) + 1, static_cast<int>(bm.size()), batch_acc, avg_margin));
+                    else std::cout << "Epoch " << (e + 1) << "/" << epochs
+                              << "  Batch " << (batch.index + 1) << "/" << pipeline.batches()
+                              << "  Acc=" << batch_acc
+                              << "  AvgMargin=" << avg_margin << std::endl;
+                }
+                for (size_t k = 0; k < bm.size() && k < batch.size; ++k) {
+                    epoch_total += 1; if (bm[k].winner_id == batch[k].target_id) epoch_correct += 1; epoch_margin_sum += static_cast<double>(bm[k].margin);
+                }
+            }
+            double epoch_acc = (epoch_total == 0) ? 0.0 : (static_cast<double>(epoch_correct) / static_cast<double>(epoch_total));
+            double epoch_margin = (epoch_total == 0) ? 0.0 : (epoch_margin_sum / static_cast<double>(epoch_total));
+            epoch_acc_hist.push_back(epoch_acc); epoch_margin_hist.push_back(epoch_margin);
+            if (!cfg.checkpoint_path.empty() && cfg.checkpoint_every > 0 && epochsCompleted() % cfg.checkpoint_every == 0) {
+                GLIA_PROF_SCOPE(Checkpoint);
+                ckpt::Writer w(checkpointKind()); saveState(w);
+                checkpoint_writer.submit(cfg.checkpoint_path, w.release());
+            }
+            if (telemetry_sink) {
+                prof::flush();
+                const prof::Stats d = profile_stats.since(epoch_start);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_t0).count();
+                telemetry_sink->emit(telemetry::epochRecord(epochsCompleted(), epoch_acc, epoch_margin, seconds, d,
+                                                            structural.grownTotal() - grown0, structural.prunedTotal() - pruned0, edges.numEdges()));
+                telemetry::emitPhases(*telemetry_sink, epochsCompleted(), d);
+            }
+            if (cfg.verbose && prof::enabled()) {
+                prof::flush();
+                std::cout << "Epoch " << (e + 1) << "/" << epochs << "  Profile: " << profile_stats.since(epoch_start).summary() << std::endl;
+            }
+        }
+        if (telemetry_sink) telemetry_sink->flush();
+    }
+
+private:
+    // dynamic state an episode starts from, by handle
+    struct StartState {
+        std::vector<float> value, delta, on_deck;
+        std::vector<int> refractory;
+        void capture(const CompiledNetwork &cn) { value = cn.value; delta = cn.delta; on_deck = cn.on_deck; refractory = cn.refractory; }
+    };
+    // per-worker scratch of backward(); per-lane arrays are [neuron][lane]
+    struct BpttWorkspace {
+        int lanes = 0;
+        std::vector<const uint8_t *> spikes; // fired flags of lane l after tick t: spikes[l * T + t]
+        std::vector<const InputSequence *> seqs;
+        std::vector<CompiledInputSequence> inputs; // per lane
+        std::vector<float> value0, delta0, on_deck0, leak, threshold, resting; // start state, parameters
+        std::vector<int> refractory0;
+        std::vector<float> u, in;          // membrane after the last recomputed tick, input of a tick
+        std::vector<float> checkpoints;    // u before each window
+        std::vector<float> v_window;       // v of every tick of the current window
+        std::vector<float> e_in[3];        // dL/dI of ticks t, t+1, t+2 (by t % 3)
+        std::vector<float> e_u, e_s;       // dL/du(t), dL/ds(t)
+        std::vector<float> g_out;          // dL/drate per output and lane
+        std::vector<float> egrad;          // [edge][lane]
+        std::vector<uint8_t> fired[4], fired_any[4]; // see firedLanes()
+        int fired_tick[4] = {-1, -1, -1, -1};
+        std::vector<float> rates, logits, exps, p;
+        prof::Stats profile; // a worker thread's records, merged after the batch
+    };
+
+    Glia &glia;
+    EdgeIndex edges;                // order of the per-edge arrays (see Trainer::refreshEdges)
+    EdgeIndex edges_next;           // rebuild scratch, swapped with `edges`
+    std::vector<float> neuron_rate; // EMA firing rate by handle (+ the extra slot)
+    uint64_t seed = 123456u;        // of the random streams (see reseed())
+    uint64_t structure_passes = 0;  // post-batch structural passes, keying grow_edges' streams
+    std::vector<double> epoch_acc_hist;
+    std::vector<double> epoch_margin_hist;
+    std::vector<size_t> episode_order;     // trainEpoch()'s episode indices of the epoch
+    // Adam optimizer state, per edge
+    std::vector<float> adam_m;
+    std::vector<float> adam_v;
+    int adam_step = 0;
+    std::vector<BatchedNetwork> lane_nets; // one per worker for lockstep/parallel batches
+    CompiledInputSequence episode_inputs;  // inputs of the episode being simulated
+    // neuron ID caches (see Trainer::refreshNeurons)
+    int cached_neuron_count = -1; uint64_t cached_neuron_order = ~0ull;
+    std::vector<nid::Key> neuron_keys; std::vector<std::string> sensory_ids, output_ids; std::vector<int> output_handles;
+    // reused across batches
+    BpttWorkspace ws; std::vector<BpttWorkspace> worker_ws; // worker 0 uses ws
+    int active_workers = 0;
+    std::vector<StartState> starts;        // per batch item on the sequential path, [0] otherwise
+    std::vector<uint8_t> trace;            // sequential path: [episode][tick][neuron]
+    std::vector<const Trainer::EpisodeData *> batch_items; // trainBatch(vector) view
+    std::vector<EpisodeMetrics> metrics;
+    std::vector<float> sum_grad;
+    bool warned_uncompiled = false;
+    StructuralPlasticity structural; std::vector<int> edge_from; // prune/grow pass (see Trainer::commitStructure)
+    uint64_t edges_version = ~0ull; // glia.getStructureVersion() `edges` is current for
+    ckpt::AsyncWriter checkpoint_writer; // on-disk checkpoints of trainEpoch()
+    prof::Stats profile_stats;           // see profile()
+    std::shared_ptr<ThreadPool> thread_pool, owned_pool; // see setThreadPool()
+    std::shared_ptr<telemetry::Sink> telemetry_sink;    // see setTelemetry()
+
+    static constexpr float kFlush = 1e-30f;
+
+    BpttWorkspace &workspace(int w) { return w == 0 ? ws : worker_ws[w - 1]; }
+
+    void refreshEdges() {
+        refreshNeurons();
+        const uint64_t version = glia.getStructureVersion();
+        if (version == edges_version && edges.numNeurons() == glia.getNeuronCount() && adam_m.size() == edges.targets.size() && adam_v.size() == edges.targets.size()) {
+            edges.syncWeights(glia); // unchanged since built or compacted: only the weights are stale
+            return;
+        }
+        edges_next.build(glia);
+        if (!edges_next.sameTopology(edges) || adam_m.size() != edges_next.targets.size() || adam_v.size() != edges_next.targets.size()) { remapEdgeState(edges, edges_next, adam_m, 0.0f); remapEdgeState(edges, edges_next, adam_v, 0.0f); }
+        if (neuron_rate.size() != static_cast<size_t>(edges_next.numNeurons()) + 1) neuron_rate.assign(edges_next.numNeurons() + 1, 0.0f);
+        std::swap(edges, edges_next); edges_version = version;
+    }
+    void refreshNeurons() {
+        if (glia.getNeuronCount() == cached_neuron_count && glia.getNeuronOrderVersion() == cached_neuron_order) return;
+        cached_neuron_count = glia.getNeuronCount(); cached_neuron_order = glia.getNeuronOrderVersion();
+        // rates follow their neuron to its new handle; the Adam moments are keyed by the old handles (see Trainer::refreshNeurons)
+        std::vector<nid::Key> keys = glia.getAllNeuronKeys();
+        remapNeuronState(neuron_keys, keys, neuron_rate, 0.0f, 1);
+        if (keys != neuron_keys) { adam_m.clear(); adam_v.clear(); }
+        neuron_keys.swap(keys);
+        sensory_ids.clear(); for (int h = 0; h < glia.getSensoryCount(); ++h) sensory_ids.push_back(nid::name(neuron_keys[h]));
+        output_ids.clear(); output_handles.clear();
+        for (size_t h = 0; h < neuron_keys.size(); ++h) { const std::string &id = nid::name(neuron_keys[h]); if (!id.empty() && id[0] == 'O') { output_ids.push_back(id); output_handles.push_back(static_cast<int>(h)); } }
+    }
+    // winner, margin and output rates from per-handle rates (as RateGDTrainer's)
+    void fillMetrics(EpisodeMetrics &m, const float *rates, int ticks) const {
+        float top1 = -1e9f, top2 = -1e9f; const std::string *win = nullptr;
+        if (m.rates.size() != output_ids.size()) m.rates.clear();
+        for (size_t i = 0; i < output_ids.size(); ++i) {
+            const std::string &id = output_ids[i];
+            float r = rates[output_handles[i]]; m.rates[id] = r; if (r > top1) { top2 = top1; top1 = r; win = &id; } else if (r > top2) { top2 = r; }
+        }
+        if (win) m.winner_id = *win; else m.winner_id.clear();
+        m.margin = (top1 > -1e8f && top2 > -1e8f) ? (top1 - top2) : 0.0f;
+        m.ticks_run = ticks;
+    }
+    void fillMetrics(EpisodeMetrics &m, const std::vector<float> &rates, int ticks) const { fillMetrics(m, rates.data(), ticks); }
+    void injectAt(int tick) {
+        GLIA_PROF_SCOPE(Inject);
+        const CompiledInputSequence::Span in = episode_inputs.at(tick);
+        glia.injectSensoryBatch(in.handles, in.values, in.size);
+    }
+    // the InputSequence tick a SequenceCursor is at after `t` advances
+    static int sequenceTick(const InputSequence &seq, int t) {
+        return seq.isLooping() && seq.getMaxTick() >= 0 ? t % (seq.getMaxTick() + 1) : t;
+    }
+
+    // Forward passes of a batch and the backward pass of every episode. Lockstep/threaded
+    // batches run as BatchedNetwork lanes from the batch-start state (see
+    // RateGDTrainer::runFromBatchStart); otherwise episodes run one after another through
+    // Glia and workers split the recorded episodes for the backward pass. Either way the
+    // network state afterwards is that of the last episode.
+    void runBatch(CompiledNetwork &cn, const Trainer::EpisodeData *const *batch, size_t batch_size, const TrainingConfig &cfg) {
+        const int B = static_cast<int>(batch_size);
+        const int T = cfg.warmup_ticks + cfg.decision_window;
+        const int N = edges.numNeurons();
+        const int workers = std::max(1, std::min(cfg.batch_threads, B));
+        const bool lockstep = (cfg.lockstep_batch || cfg.device_batch || cfg.batch_threads > 1) && B > 1 && cn.basicDynamics();
+        if (static_cast<int>(worker_ws.size()) < workers - 1) worker_ws.resize(workers - 1);
+        if (static_cast<int>(metrics.size()) < B) metrics.resize(B);
+        active_workers = workers;
+        cn.settle();
+        if (lockstep) {
+            if (static_cast<int>(lane_nets.size()) < workers) lane_nets.resize(workers);
+            if (starts.empty()) starts.resize(1);
+            starts[0].capture(cn);
+        } else {
+            // sequential forward passes, each from where the previous one ended
+            if (static_cast<int>(starts.size()) < B) starts.resize(B);
+            trace.resize(static_cast<size_t>(B) * T * N);
+            for (int b = 0; b < B; ++b) {
+                if (b > 0) { glia.getCompiled(); cn.settle(); } // rebound if the step mode released it
+                starts[b].capture(cn);
+                const InputSequence &seq = batch[b]->seq;
+                episode_inputs.compile(seq, sensory_ids);
+                for (int t = 0; t < T; ++t) {
+                    injectAt(sequenceTick(seq, t));
+                    glia.step();
+                    uint8_t *fired = trace.data() + (static_cast<size_t>(b) * T + t) * N;
+                    glia.forEachNeuron([&](Neuron &n){ *fired++ = n.didFire() ? 1 : 0; });
+                }
+            }
+            glia.getCompiled(); // parameters for the backward pass
+        }
+        auto work = [&](int w) {
+            const int lo = B * w / workers, hi = B * (w + 1) / workers, L = hi - lo;
+            BpttWorkspace &wk = workspace(w);
+            GLIA_PROF_BIND(&wk.profile);
+            wk.lanes = L;
+            wk.seqs.resize(L); wk.spikes.resize(static_cast<size_t>(L) * T);
+            for (int b = lo; b < hi; ++b) wk.seqs[b - lo] = &batch[b]->seq;
+            if (lockstep) {
+                BatchedNetwork &bn = lane_nets[w];
+                bn.setDevice(cfg.device_batch);
+                bn.build(cn, L);
+                bn.run(wk.seqs.data(), L, T);
+                for (int l = 0; l < L; ++l) for (int t = 0; t < T; ++t) wk.spikes[static_cast<size_t>(l) * T + t] = bn.firedAt(l, t);
+            } else {
+                for (int l = 0; l < L; ++l) for (int t = 0; t < T; ++t) wk.spikes[static_cast<size_t>(l) * T + t] = trace.data() + (static_cast<size_t>(lo + l) * T + t) * N;
+            }
+            backward(cn, batch, lo, cfg, wk, lockstep);
+        };
+        ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool)->parallelFor(workers, work);
+        for (int w = 0; w < workers; ++w) { BpttWorkspace &wk = workspace(w); profile_stats.merge(wk.profile); wk.profile.reset(); }
+        workspace(workers - 1).rates.swap(neuron_rate); // rates after the last episode
+        if (lockstep) lane_nets[workers - 1].storeLane(cn, lane_nets[workers - 1].lanes() - 1);
+    }
+
+    // fired flags of tick t as [neuron][lane] (a small cache: a tick is asked for up to
+    // three times in a row), plus whether any lane fired per neuron
+    const uint8_t *firedLanes(BpttWorkspace &wk, int t, int T, const uint8_t **any) {
+        const int N = edges.numNeurons(), L = wk.lanes;
+        const int slot = t & 3;
+        std::vector<uint8_t> &f = wk.fired[slot]; std::vector<uint8_t> &a = wk.fired_any[slot];
+        if (wk.fired_tick[slot] != t) {
+            f.resize(static_cast<size_t>(N) * L); a.assign(N, 0);
+            for (int l = 0; l < L; ++l) {
+                const uint8_t *s = wk.spikes[static_cast<size_t>(l) * T + t];
+                for (int i = 0; i < N; ++i) { f[static_cast<size_t>(i) * L + l] = s[i]; a[i] |= s[i]; }
+            }
+            wk.fired_tick[slot] = t;
+        }
+        *any = a.data();
+        return f.data();
+    }
+    // input of every lane at tick t (see the class comment), from the raster and the start state
+    void recomputeInput(BpttWorkspace &wk, int t, int T) {
+        const int N = edges.numNeurons(), L = wk.lanes;
+        float *in = wk.in.data();
+        if (t == 0) { std::copy(wk.delta0.begin(), wk.delta0.end(), wk.in.begin()); return; }
+        if (t == 1) std::copy(wk.on_deck0.begin(), wk.on_deck0.end(), wk.in.begin());
+        else std::fill(wk.in.begin(), wk.in.end(), 0.0f);
+        for (int l = 0; l < L; ++l) {
+            const CompiledInputSequence::Span ext = wk.inputs[l].at(sequenceTick(*wk.seqs[l], t - 1));
+            for (int x = 0; x < ext.size; ++x) in[static_cast<size_t>(ext.handles[x]) * L + l] += ext.values[x];
+        }
+        // spikes of t - 1 along edges to later neurons, of t - 2 along the others, each
+        // edge once for all lanes
+        const uint8_t *any1, *any2 = nullptr;
+        const uint8_t *f1 = firedLanes(wk, t - 1, T, &any1), *f2 = t >= 2 ? firedLanes(wk, t - 2, T, &any2) : nullptr;
+        for (int i = 0; i < N; ++i) {
+            const bool a1 = any1[i] != 0, a2 = f2 && any2[i] != 0;
+            if (!a1 && !a2) continue;
+            for (int k = edges.row_offsets[i]; k < edges.row_offsets[i + 1]; ++k) {
+                const int j = edges.targets[k];
+                if (!(j > i ? a1 : a2)) continue;
+                const uint8_t *f = (j > i ? f1 : f2) + static_cast<size_t>(i) * L; const float w = edges.weights[k];
+                float *dst = in + static_cast<size_t>(j) * L;
+                for (int l = 0; l < L; ++l) dst[l] += f[l] ? w : 0.0f;
+            }
+        }
+    }
+    // membranes of tick t from u (after t - 1): v goes to `v`, u moves to after t
+    void recomputeMembrane(BpttWorkspace &wk, int t, int T, float *v) {
+        const int N = edges.numNeurons(), L = wk.lanes;
+        recomputeInput(wk, t, T);
+        for (int l = 0; l < L; ++l) {
+            const uint8_t *s = wk.spikes[static_cast<size_t>(l) * T + t];
+            for (int i = 0; i < N; ++i) {
+                const size_t x = static_cast<size_t>(i) * L + l;
+                if (t < wk.refractory0[x]) { v[x] = wk.u[x]; continue; } // counting down: input is dropped
+                float a = wk.leak[i] * wk.u[x] + wk.in[x];
+                if (a < 0.0f) a = 0.0f;
+                v[x] = a;
+                wk.u[x] = s[i] ? wk.resting[i] : a;
+            }
+        }
+    }
+
+    // Backward pass of the wk.lanes episodes from batch[lo] on into wk.egrad; fills their metrics,
+    // and leaves the last lane's rates in wk.rates. Only reads the network (thread-safe).
+    void backward(const CompiledNetwork &cn, const Trainer::EpisodeData *const *batch, int lo,
+                  const TrainingConfig &cfg, BpttWorkspace &wk, bool shared_start) {
+        const int N = edges.numNeurons(), E = edges.numEdges(), L = wk.lanes;
+        const int T = cfg.warmup_ticks + cfg.decision_window;
+        const size_t NL = static_cast<size_t>(N) * L;
+        const int O = static_cast<int>(output_handles.size());
+        const float alpha = cfg.rate_alpha;
+        wk.egrad.assign(static_cast<size_t>(E) * L, 0.0f);
+        // rates, metrics and the loss gradient at the outputs
+        {
+            GLIA_PROF_SCOPE(Eligibility);
+            wk.g_out.assign(static_cast<size_t>(O) * L, 0.0f);
+            const float temp = cfg.grad.temperature > 0.0f ? cfg.grad.temperature : 1.0f;
+            for (int l = 0; l < L; ++l) {
+                std::vector<float> &rates = wk.rates; rates.assign(N + 1, 0.0f);
+                for (int t = 0; t < T; ++t) { const uint8_t *s = wk.spikes[static_cast<size_t>(l) * T + t]; for (int h = 0; h < N; ++h) rates[h] = (1.0f - alpha) * rates[h] + alpha * (s[h] ? 1.0f : 0.0f); }
+                fillMetrics(metrics[lo + l], rates, T);
+                if (O == 0) continue;
+                std::vector<float> &logits = wk.logits; logits.resize(O);
+                for (int o = 0; o < O; ++o) logits[o] = rates[output_handles[o]] / temp;
+                const float max_logit = *std::max_element(logits.begin(), logits.end());
+                std::vector<float> &exps = wk.exps; exps.resize(O); float sum_exp = 0.0f;
+                for (int o = 0; o < O; ++o) { exps[o] = std::exp(logits[o] - max_logit); sum_exp += exps[o]; }
+                const std::string &target = batch[lo + l]->target_id;
+                for (int o = 0; o < O; ++o) wk.g_out[static_cast<size_t>(o) * L + l] = (exps[o] / (sum_exp > 0.0f ? sum_exp : 1.0f) - (output_ids[o] == target ? 1.0f : 0.0f)) / temp;
+            }
+        }
+        GLIA_PROF_SCOPE(Delta);
+        GLIA_PROF_COUNT(edges_touched, static_cast<uint64_t>(E) * T * 2);
+        // start state and parameters, [neuron][lane]
+        wk.value0.resize(NL); wk.delta0.resize(NL); wk.on_deck0.resize(NL); wk.refractory0.resize(NL);
+        for (int l = 0; l < L; ++l) {
+            const StartState &st = starts[shared_start ? 0 : lo + l];
+            for (int i = 0; i < N; ++i) { const size_t x = static_cast<size_t>(i) * L + l; wk.value0[x] = st.value[i]; wk.delta0[x] = st.delta[i]; wk.on_deck0[x] = st.on_deck[i]; wk.refractory0[x] = st.refractory[i]; }
+        }
+        wk.leak.assign(cn.leak.begin(), cn.leak.begin() + N);
+        wk.threshold.assign(cn.threshold.begin(), cn.threshold.begin() + N);
+        wk.resting.assign(cn.resting.begin(), cn.resting.begin() + N);
+        if (wk.inputs.size() < static_cast<size_t>(L)) wk.inputs.resize(L);
+        for (int l = 0; l < L; ++l) wk.inputs[l].compile(*wk.seqs[l], sensory_ids);
+        for (int r = 0; r < 4; ++r) wk.fired_tick[r] = -1;
+        wk.in.resize(NL);
+
+        // forward recomputation: membranes before every window
+        const int K = cfg.grad.bptt_window > 0 ? std::min(cfg.grad.bptt_window, T) : T;
+        const int windows = T > 0 ? (T + K - 1) / K : 0;
+        wk.checkpoints.resize(static_cast<size_t>(windows) * NL);
+        wk.v_window.resize(static_cast<size_t>(K) * NL);
+        wk.u = wk.value0;
+        for (int t = 0; t < (windows - 1) * K; ++t) {
+            if (t % K == 0) std::copy(wk.u.begin(), wk.u.end(), wk.checkpoints.begin() + static_cast<size_t>(t / K) * NL);
+            recomputeMembrane(wk, t, T, wk.v_window.data()); // v is recomputed per window below
+        }
+        if (windows > 0) std::copy(wk.u.begin(), wk.u.end(), wk.checkpoints.begin() + static_cast<size_t>(windows - 1) * NL);
+
+        // backward, window by window from the last
+        for (int r = 0; r < 3; ++r) wk.e_in[r].assign(NL, 0.0f);
+        wk.e_u.assign(NL, 0.0f); wk.e_s.resize(NL);
+        const float beta = cfg.grad.surrogate_beta;
+        std::vector<float> decay(T); // alpha * (1 - alpha)^(T - 1 - t): d rate(T - 1) / d s(t)
+        for (int t = T - 1; t >= 0; --t) decay[t] = t == T - 1 ? alpha : decay[t + 1] * (1.0f - alpha);
+        for (int win = windows - 1; win >= 0; --win) {
+            const int t0 = win * K, t1 = std::min(T, t0 + K);
+            std::copy(wk.checkpoints.begin() + static_cast<size_t>(win) * NL, wk.checkpoints.begin() + static_cast<size_t>(win + 1) * NL, wk.u.begin());
+            for (int t = t0; t < t1; ++t) recomputeMembrane(wk, t, T, wk.v_window.data() + static_cast<size_t>(t - t0) * NL);
+            if (cfg.grad.bptt_truncate && t1 < T) {
+                // truncated: nothing flows back across the window boundary
+                for (int r = 0; r < 3; ++r) std::fill(wk.e_in[r].begin(), wk.e_in[r].end(), 0.0f);
+                std::fill(wk.e_u.begin(), wk.e_u.end(), 0.0f);
+            }
+            for (int t = t1 - 1; t >= t0; --t) {
+                const float *e1 = wk.e_in[(t + 1) % 3].data(), *e2 = wk.e_in[(t + 2) % 3].data();
+                float *e_in = wk.e_in[t % 3].data(); float *e_s = wk.e_s.data(); float *e_u = wk.e_u.data();
+                const float *v = wk.v_window.data() + static_cast<size_t>(t - t0) * NL;
+                // dL/ds(t): through the edges into the input of t + 1 (later targets) or t + 2
+                for (int i = 0; i < N; ++i) {
+                    float *es = e_s + static_cast<size_t>(i) * L;
+                    std::fill(es, es + L, 0.0f);
+                    for (int k = edges.row_offsets[i]; k < edges.row_offsets[i + 1]; ++k) {
+                        const int j = edges.targets[k]; const float w = edges.weights[k];
+                        const float *ej = (j > i ? e1 : e2) + static_cast<size_t>(j) * L;
+                        for (int l = 0; l < L; ++l) es[l] += w * ej[l];
+                    }
+                }
+                for (int o = 0; o < O; ++o) {
+                    float *es = e_s + static_cast<size_t>(output_handles[o]) * L; const float *g = wk.g_out.data() + static_cast<size_t>(o) * L;
+                    for (int l = 0; l < L; ++l) es[l] += g[l] * decay[t];
+                }
+                // through the membrane: dL/dI(t) and dL/du(t - 1)
+                for (int l = 0; l < L; ++l) {
+                    const uint8_t *s = wk.spikes[static_cast<size_t>(l) * T + t];
+                    for (int i = 0; i < N; ++i) {
+                        const size_t x = static_cast<size_t>(i) * L + l;
+                        if (t < wk.refractory0[x]) { e_in[x] = 0.0f; continue; } // u(t) = u(t - 1)
+                        const float thr = wk.threshold[i];
+                        const float scale = std::fabs(thr) > 1e-6f ? std::fabs(thr) : 1.0f;
+                        const float q = 1.0f + beta * std::fabs(v[x] - thr) / scale;
+                        float ev = e_s[x] / (scale * q * q);
+                        if (!s[i]) ev += e_u[x];
+                        // adjoints that decay into denormals are flushed; they would only
+                        // slow every later tick down
+                        const float ea = v[x] > 0.0f && std::fabs(ev) >= kFlush ? ev : 0.0f;
+                        e_in[x] = ea;
+                        e_u[x] = ea * wk.leak[i];
+                    }
+                }
+                // weights: dL/dw = dL/dI_target(t) * s_source(t - lag)
+                if (t >= 1) {
+                    const uint8_t *any1, *any2 = nullptr;
+                    const uint8_t *f1 = firedLanes(wk, t - 1, T, &any1), *f2 = t >= 2 ? firedLanes(wk, t - 2, T, &any2) : nullptr;
+                    for (int i = 0; i < N; ++i) {
+                        const bool a1 = any1[i] != 0, a2 = f2 && any2[i] != 0;
+                        if (!a1 && !a2) continue;
+                        for (int k = edges.row_offsets[i]; k < edges.row_offsets[i + 1]; ++k) {
+                            const int j = edges.targets[k];
+                            if (!(j > i ? a1 : a2)) continue;
+                            const uint8_t *f = (j > i ? f1 : f2) + static_cast<size_t>(i) * L;
+                            const float *ej = e_in + static_cast<size_t>(j) * L; float *g = wk.egrad.data() + static_cast<size_t>(k) * L;
+                            for (int l = 0; l < L; ++l) g[l] += f[l] ? ej[l] : 0.0f;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void applyGradients(const std::vector<float> &grad,
+                        float scale,
+                        const TrainingConfig &cfg) {
+        GLIA_PROF_SCOPE(Apply);
+        GLIA_PROF_COUNT(edges_touched, grad.size());
+        // as RateGDTrainer::applyGradients (see optimizer.h)
+        const int E = edges.numEdges();
+        float *w = edges.weights.data();
+        const float clip_scale = optim::clipFactor(grad.data(), E, scale, cfg.grad.clip_grad_norm);
+        bool use_adam = (cfg.grad.optimizer == "adam");
+        bool use_adamw = (cfg.grad.optimizer == "adamw");
+        if (use_adam || use_adamw) {
+            adam_step = std::max(1, adam_step + 1);
+            optim::AdamParams p;
+            p.lr = cfg.lr; p.beta1 = cfg.grad.adam_beta1; p.beta2 = cfg.grad.adam_beta2; p.eps = cfg.grad.adam_eps;
+            p.weight_decay = cfg.weight_decay; p.decoupled = use_adamw; p.weight_clip = cfg.weight_clip;
+            optim::adam(w, adam_m.data(), adam_v.data(), grad.data(), E, scale, clip_scale, adam_step, p);
+        } else {
+            optim::sgd(w, grad.data(), E, scale, clip_scale, cfg.lr, cfg.weight_decay, cfg.weight_clip);
+        }
+        edges.storeWeights(glia);
+    }
+
+    void postBatchPlasticity(const TrainingConfig &cfg) {
+        {
+            GLIA_PROF_SCOPE(PruneGrow);
+            structural.begin(glia, edges, neuron_keys);
+            for (int k = 0; k < edges.numEdges(); ++k) if (std::fabs(edges.weights[k]) < cfg.prune_epsilon) structural.prune(k);
+            const uint64_t pass = structure_passes++;
+            if (cfg.grow_edges > 0 && !neuron_keys.empty()) {
+                rstream::Stream rng(rstream::key(seed, rstream::GrowEdges, pass));
+                const uint32_t n = static_cast<uint32_t>(neuron_keys.size());
+                int grown = 0; int attempts = 0;
+                while (grown < cfg.grow_edges && attempts < cfg.grow_edges * 20) {
+                    attempts++;
+                    const int from = static_cast<int>(rng.below(n)); const int to = static_cast<int>(rng.below(n));
+                    if (!cfg.topology.edgeAllowed(nid::name(neuron_keys[from]), nid::name(neuron_keys[to]))) continue;
+                    if (from == to || structural.exists(from, to)) continue;
+                    float w = cfg.init_weight * (rng.coin() ? 1.0f : -1.0f);
+                    structural.grow(from, to, w);
+                    grown++;
+                }
+            }
+            if (structural.commit(glia, edges_next, edge_from)) {
+                remapEdgeState(edge_from, adam_m, 0.0f); remapEdgeState(edge_from, adam_v, 0.0f);
+                std::swap(edges, edges_next); edges_version = glia.getStructureVersion();
+            }
+        }
+        GLIA_PROF_SCOPE(Plasticity);
+        int h = 0;
+        glia.forEachNeuron([&](Neuron &n){ float r = neuron_rate[h++]; if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target)); if (cfg.eta_leak != 0.0f) { float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r); if (new_leak < 0.0f) new_leak = 0.0f; if (new_leak > 1.0f) new_leak = 1.0f; n.setLeak(new_leak); }});
+    }
+};
@@ -6,290 +6,526 @@
 #include <random>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
 
 #include "../hebbian/trainer.h" // for EpisodeMetrics, EpisodeData, and TrainingConfig via include chain
 #include "../../arch/glia.h"
 #include "../../arch/neuron.h"
 #include "../../arch/output_detection.h"
 #include "../../arch/input_sequence.h"
+#include "../../arch/batched_network.h"
+#include "../../arch/profiling.h"
+#include "../../arch/thread_pool.h"
+#include "../../arch/telemetry.h"
+#include "../../arch/random_streams.h"
+#include "../edge_index.h"
+#include "../structural_plasticity.h"
+#include "../optimizer.h"
+#include "../checkpoint.h"
+#include "../dataset_eval.h"
 
 class RateGDTrainer {
 public:
-    explicit RateGDTrainer(Glia &net) : glia(net), rng(123456u) {}
-    void reseed(unsigned int s) { rng.seed(s); }
+    explicit RateGDTrainer(Glia &net) : glia(net) {}
+    // seed of the random streams (see Trainer::reseed)
+    void reseed(unsigned int s) { seed = s; }
     std::vector<double> getEpochAccHistory() const { return epoch_acc_hist; }
     std::vector<double> getEpochMarginHistory() const { return epoch_margin_hist; }
+    int epochsCompleted() const { return static_cast<int>(epoch_acc_hist.size()); }
+    // see Trainer::profile()
+    const prof::Stats &profile() const { return profile_stats; }
+    void resetProfile() { profile_stats.reset(); }
+    // pool for batch workers (see Trainer::setThreadPool)
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+    // progress records of trainEpoch() (see Trainer::setTelemetry)
+    void setTelemetry(std::shared_ptr<telemetry::Sink> sink) { telemetry_sink = std::move(sink); }
+
+    // On-disk checkpoints, as Trainer's: the network (with its dynamic state), the stream
+    // seed and structural pass count, rates, the Adam moments and step and the epoch history
+    static const char *checkpointKind() { return "rate_gd"; }
+    void saveState(ckpt::Writer &w) {
+        refreshEdges();
+        NetworkSnapshot now = NetworkSnapshot::capture(glia);
+        w.snapshots(std::vector<const NetworkSnapshot *>(1, &now));
+        ckpt::DynamicState state; state.capture(glia); state.write(w);
+        w.u64(seed); w.u64(structure_passes);
+        w.vec(neuron_rate);
+        w.vec(adam_m); w.vec(adam_v); w.i32(adam_step);
+        w.vec(epoch_acc_hist); w.vec(epoch_margin_hist);
+    }
+    bool loadState(ckpt::Reader &r) {
+        std::vector<NetworkSnapshot> snaps = r.snapshots();
+        ckpt::DynamicState state; state.read(r);
+        const uint64_t stream_seed = r.u64(), passes = r.u64();
+        std::vector<float> rates = r.vec<float>();
+        std::vector<float> m = r.vec<float>(), v = r.vec<float>(); const int step = r.i32();
+        std::vector<double> acc = r.vec<double>(), margin = r.vec<double>();
+        if (!r.ok()) return false;
+        if (snaps.size() != 1) return r.fail("malformed trainer state");
+        const SnapshotTopology &t = snaps[0].topology();
+        if (m.size() != t.targets.size() || v.size() != t.targets.size() || rates.size() != t.keys.size() + 1) return r.fail("trainer state doesn't match its network");
+        if (!ckpt::restoreNetwork(r, glia, snaps[0], state)) return false;
+        refreshEdges();
+        adam_m.swap(m); adam_v.swap(v); adam_step = step;
+        neuron_rate.swap(rates);
+        seed = stream_seed; structure_passes = passes;
+        epoch_acc_hist.swap(acc); epoch_margin_hist.swap(margin);
+        return true;
+    }
+    bool saveCheckpoint(const std::string &path, std::string &error) {
+        ckpt::Writer w(checkpointKind()); saveState(w);
+        return ckpt::writeFile(path, w.bytes(), error);
+    }
+    bool loadCheckpoint(const std::string &path, std::string &error) {
+        ckpt::Reader r;
+        if (!r.open(path, checkpointKind()) || !loadState(r)) { error = r.error(); return false; }
+        return true;
+    }
+    bool flushCheckpoints(std::string &error) { return checkpoint_writer.flush(&error); }
 
     EpisodeMetrics evaluate(InputSequence &seq, const TrainingConfig &cfg) {
-        std::vector<std::string> output_ids = collectOutputIDs();
-        neuron_rate.clear();
+        GLIA_PROF_BIND(&profile_stats);
+        refreshNeurons();
+        neuron_rate.assign(glia.getNeuronCount() + 1, 0.0f);
         seq.reset();
+        compileInputs(seq);
         const int U = cfg.warmup_ticks;
         const int W = cfg.decision_window;
         for (int t = 0; t < U + W; ++t) {
             injectFromSequence(seq);
             glia.step();
-            glia.forEachNeuron([&](Neuron &n){ bool f = n.didFire(); std::string nid = n.getId(); float r = 0.0f; auto itnr = neuron_rate.find(nid); if (itnr != neuron_rate.end()) r = itnr->second; float newr = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (f ? 1.0f : 0.0f); if (itnr != neuron_rate.end()) itnr->second = newr; else neuron_rate.emplace(nid, newr); });
+            GLIA_PROF_SCOPE(Detector);
+            int slot = 0;
+            glia.forEachNeuron([&](Neuron &n){ float &r = neuron_rate[slot++]; r = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (n.didFire() ? 1.0f : 0.0f); });
             seq.advance();
         }
         EpisodeMetrics m;
-        float top1 = -1e9f, top2 = -1e9f; std::string win;
-        for (const auto &id : output_ids) {
-            float r = 0.0f; auto it = neuron_rate.find(id); if (it != neuron_rate.end()) r = it->second;
-            m.rates[id] = r;
-            if (r > top1) { top2 = top1; top1 = r; win = id; }
-            else if (r > top2) { top2 = r; }
+        fillMetrics(m, neuron_rate, U + W);
+        return m;
+    }
+
+    // Evaluate every episode of a dataset from the network's current state, as evaluate()
+    // reads it (see Trainer::evaluateDataset and dataset_eval.h); the network and the
+    // trainer are left as they were
+    DatasetMetrics evaluateDataset(const std::vector<Trainer::EpisodeData> &dataset, const TrainingConfig &cfg) {
+        VectorSource source(dataset);
+        return evaluateDataset(source, cfg);
+    }
+    DatasetMetrics evaluateDataset(EpisodeSource &source, const TrainingConfig &cfg) {
+        DatasetMetrics out;
+        dataset_eval::forEachBlock(source, cfg, [&](const Trainer::EpisodeData *const *items, size_t n) { evaluateEpisodes(items, n, cfg, out); });
+        out.finish();
+        return out;
+    }
+    // see Trainer::evaluateEpisodes
+    void evaluateEpisodes(const Trainer::EpisodeData *const *eps, size_t n, const TrainingConfig &cfg, DatasetMetrics &out) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshNeurons();
+        out.labels = output_ids;
+        const size_t first = out.size();
+        out.resize(first + n);
+        const int workers = dataset_eval::workers(n, cfg);
+        if (static_cast<int>(worker_ws.size()) < workers - 1) worker_ws.resize(workers - 1);
+        std::vector<EpisodeMetrics> worker_metrics(workers);
+        const int T = cfg.warmup_ticks + cfg.decision_window;
+        const float a = cfg.rate_alpha;
+        const bool lanes = dataset_eval::runLanes(glia, eps, n, cfg, *ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool), lane_nets, profile_stats,
+            [&](int w, const BatchedNetwork &bn, int lane, size_t k) {
+                GLIA_PROF_SCOPE(Detector);
+                std::vector<float> &r = (w == 0 ? ws : worker_ws[w - 1]).rates; // only the outputs' are read
+                r.assign(bn.size() + 1, 0.0f);
+                for (int t = 0; t < T; ++t) {
+                    const uint8_t *fired = bn.firedAt(lane, t);
+                    for (int h : output_handles) r[h] = (1.0f - a) * r[h] + a * (fired[h] ? 1.0f : 0.0f);
+                }
+                EpisodeMetrics &m = worker_metrics[w];
+                fillMetrics(m, r, T);
+                out.record(first + k, m.winner_id, eps[k]->target_id, m.margin, m.ticks_run);
+            });
+        if (!lanes) {
+            std::vector<float> rates = neuron_rate; // evaluate() restarts them
+            dataset_eval::runSerial(glia, eps, n, [&](InputSequence &seq, size_t k) {
+                const EpisodeMetrics m = evaluate(seq, cfg);
+                out.record(first + k, m.winner_id, eps[k]->target_id, m.margin, m.ticks_run);
+            });
+            neuron_rate.swap(rates);
         }
-        m.winner_id = win;
-        m.margin = (top1 > -1e8f && top2 > -1e8f) ? (top1 - top2) : 0.0f;
-        m.ticks_run = U + W; return m;
     }
 
     void trainBatch(const std::vector<Trainer::EpisodeData> &batch,
                     const TrainingConfig &cfg,
                     std::vector<EpisodeMetrics> *batch_metrics_out = nullptr) {
-        std::unordered_map<std::string, float> sum_grad;
-        if (batch_metrics_out) batch_metrics_out->clear();
-        for (const auto &item : batch) {
-            InputSequence seq = item.seq;
-            EpisodeMetrics m;
-            auto g = computeEpisodeGrad(seq, cfg, item.target_id, &m);
-            for (const auto &kv : g) sum_grad[kv.first] += kv.second;
-            if (batch_metrics_out) batch_metrics_out->push_back(m);
+        batch_items.resize(batch.size());
+        for (size_t b = 0; b < batch.size(); ++b) batch_items[b] = &batch[b];
+        trainBatch(batch_items.data(), batch_items.size(), cfg, batch_metrics_out);
+    }
+
+    // Same over episodes held elsewhere (see Trainer::trainBatch); they are only read.
+    void trainBatch(const Trainer::EpisodeData *const *batch, size_t batch_size,
+                    const TrainingConfig &cfg,
+                    std::vector<EpisodeMetrics> *batch_metrics_out = nullptr) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshEdges();
+        const int E = edges.numEdges();
+        sum_grad.assign(E, 0.0f);
+        if (batch_metrics_out) batch_metrics_out->resize(batch_size);
+        // Lockstep/parallel: every episode starts from the batch-start state; gradients are
+        // still reduced in batch order, so results don't depend on batch_threads.
+        const bool from_start = (cfg.lockstep_batch || cfg.device_batch || cfg.batch_threads > 1) && batch_size > 1 && runFromBatchStart(batch, batch_size, cfg);
+        for (size_t b = 0; b < batch_size; ++b) {
+            const Trainer::EpisodeData &item = *batch[b];
+            const std::vector<float> &g = from_start ? grads[b] : grads[0];
+            if (!from_start) computeEpisodeGrad(item.seq, cfg, item.target_id, metrics[0], neuron_rate, grads[0], ws);
+            const EpisodeMetrics &m = from_start ? metrics[b] : metrics[0];
+            for (int k = 0; k < E; ++k) sum_grad[k] += g[k];
+            if (batch_metrics_out) (*batch_metrics_out)[b] = m;
         }
-        float scale = batch.empty() ? 1.0f : (1.0f / static_cast<float>(batch.size()));
+        float scale = batch_size == 0 ? 1.0f : (1.0f / static_cast<float>(batch_size));
         applyGradients(sum_grad, scale, cfg);
         postBatchPlasticity(cfg);
     }
 
-    void trainEpoch(std::vector<Trainer::EpisodeData> dataset, int epochs, const TrainingConfig &cfg) {
-        if (dataset.empty() || epochs <= 0) return;
+    void trainEpoch(const std::vector<Trainer::EpisodeData> &dataset, int epochs, const TrainingConfig &cfg) {
+        VectorSource source(dataset);
+        trainEpoch(source, epochs, cfg);
+    }
+
+    // see Trainer::trainEpoch(EpisodeSource &, ...)
+    void trainEpoch(EpisodeSource &source, int epochs, const TrainingConfig &cfg) {
+        if (source.size() == 0 || epochs <= 0) return;
+        GLIA_PROF_BIND(&profile_stats);
         if (cfg.weight_jitter_std > 0.0f) {
-            std::normal_distribution<float> nd(0.0f, cfg.weight_jitter_std);
+            uint64_t row = 0; // as Trainer's: row r draws from (seed, WeightJitter, epoch, r)
             glia.forEachNeuron([&](Neuron &from){
+                rstream::Stream g(rstream::key(seed, rstream::WeightJitter, epochsCompleted(), row++));
                 const auto &conns = from.getConnections();
-                for (const auto &kv : conns) { float w = kv.second.first; w += nd(rng); from.setTransmitter(kv.first, w); }
+                for (const auto &kv : conns) { float w = kv.second.first; w += g.normal(0.0f, cfg.weight_jitter_std); from.setTransmitter(kv.first, w); }
             });
         }
+        std::vector<size_t> &order = episode_order;
+        EpisodePipeline pipeline(source, cfg.prefetch_batches);
         for (int e = 0; e < epochs; ++e) {
-            if (cfg.shuffle) std::shuffle(dataset.begin(), dataset.end(), rng);
+            const uint64_t epoch = static_cast<uint64_t>(epochsCompleted());
+            epochOrder(order, source.size(), cfg.shuffle, seed, epoch);
+            source.beginEpoch(epoch);
+            pipeline.start(order, static_cast<size_t>(std::max(1, cfg.batch_size)), cfg.timing_jitter, rstream::key(seed, rstream::TimingJitter, epoch));
+            prof::flush();
+            const prof::Stats epoch_start = profile_stats;
+            const auto epoch_t0 = std::chrono::steady_clock::now();
+            const uint64_t grown0 = structural.grownTotal(), pruned0 = structural.prunedTotal();
             size_t epoch_total = 0, epoch_correct = 0; double epoch_margin_sum = 0.0;
-            for (size_t i = 0; i < dataset.size(); i += std::max(1, cfg.batch_size)) {
-                size_t j = std::min(dataset.size(), i + static_cast<size_t>(std::max(1, cfg.batch_size)));
-                std::vector<Trainer::EpisodeData> batch(dataset.begin() + i, dataset.begin() + j);
-                std::vector<EpisodeMetrics> bm; trainBatch(batch, cfg, &bm);
-                if (cfg.verbose && cfg.log_every > 0 && ((e + 1) % cfg.log_every == 0)) {
+            EpisodePipeline::Batch batch; std::vector<EpisodeMetrics> bm; // reused across batches
+            while (pipeline.next(batch)) {
+                trainBatch(batch.items, batch.size, cfg, &bm);
+                // with a telemetry sink, batch progress goes to it instead of the console
+                const bool log_batch = cfg.verbose && cfg.log_every > 0 && ((e + 1) % cfg.log_every == 0);
+                if (log_batch || telemetry_sink) {
                     int correct = 0; double avg_margin = 0.0;
-                    for (size_t k = 0; k < bm.size(); ++k) { avg_margin += bm[k].margin; if (k < batch.size() && bm[k].winner_id == batch[k].target_id) correct++; }
+                    for (size_t k = 0; k < bm.size(); ++k) { avg_margin += bm[k].margin; if (k < batch.size && bm[k].winner_id == batch[k].target_id) correct++; }
                     if (!bm.empty()) avg_margin /= static_cast<double>(bm.size());
-                    std::cout << "Epoch " << (e + 1) << "/" << epochs
-                              << "  Batch " << (i / std::max(1, cfg.batch_size) + 1) << "/"
-                              << ((dataset.size() + std::max(1, cfg.batch_size) - 1) / std::max(1, cfg.batch_size))
-                              << "  Acc=" << (bm.empty() ? 0.0 : (static_cast<double>(correct) / bm.size()))
+                    const double batch_acc = bm.empty() ? 0.0 : static_cast<double>(correct) / static_cast<double>(bm.size());
+                    if (telemetry_sink) telemetry_sink->emit(telemetry::batchRecord(static_cast<int>(epoch) + 1, static_cast<int>(batch.index) + 1, static_cast<int>(bm.size()), batch_acc, avg_margin));
+                    else std::cout << "Epoch " << (e + 1) << "/" << epochs
+                              << "  Batch " << (batch.index + 1) << "/" << pipeline.batches()
+                              << "  Acc=" << batch_acc
                               << "  AvgMargin=" << avg_margin << std::endl;
                 }
-                for (size_t k = 0; k < bm.size() && k < batch.size(); ++k) {
+                for (size_t k = 0; k < bm.size() && k < batch.size; ++k) {
                     epoch_total += 1; if (bm[k].winner_id == batch[k].target_id) epoch_correct += 1; epoch_margin_sum += static_cast<double>(bm[k].margin);
                 }
             }
             double epoch_acc = (epoch_total == 0) ? 0.0 : (static_cast<double>(epoch_correct) / static_cast<double>(epoch_total));
             double epoch_margin = (epoch_total == 0) ? 0.0 : (epoch_margin_sum / static_cast<double>(epoch_total));
             epoch_acc_hist.push_back(epoch_acc); epoch_margin_hist.push_back(epoch_margin);
+            if (!cfg.checkpoint_path.empty() && cfg.checkpoint_every > 0 && epochsCompleted() % cfg.checkpoint_every == 0) {
+                GLIA_PROF_SCOPE(Checkpoint);
+                ckpt::Writer w(checkpointKind()); saveState(w);
+                checkpoint_writer.submit(cfg.checkpoint_path, w.release());
+            }
+            if (telemetry_sink) {
+                prof::flush();
+                const prof::Stats d = profile_stats.since(epoch_start);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_t0).count();
+                telemetry_sink->emit(telemetry::epochRecord(epochsCompleted(), epoch_acc, epoch_margin, seconds, d,
+                                                            structural.grownTotal() - grown0, structural.prunedTotal() - pruned0, edges.numEdges()));
+                telemetry::emitPhases(*telemetry_sink, epochsCompleted(), d);
+            }
+            if (cfg.verbose && prof::enabled()) {
+                prof::flush();
+                std::cout << "Epoch " << (e + 1) << "/" << epochs << "  Profile: " << profile_stats.since(epoch_start).summary() << std::endl;
+            }
         }
+        if (telemetry_sink) telemetry_sink->flush();
     }
 
 private:
+    // Backward pass of computeEpisodeGrad as far as it depends on topology only: neurons in
+    // BFS order from the outputs along inbound edges (non-decreasing distance, so every
+    // g_rate a sweep step reads is final), each with its edges into strictly closer neurons.
+    struct BackpropSchedule {
+        std::vector<int> dist;          // hops to the nearest output per handle, -1 if none
+        std::vector<int> order;         // non-output neurons that reach an output, BFS order
+        std::vector<int> sweep_offsets; // edges of order[i] are sweep_edges[sweep_offsets[i] .. sweep_offsets[i+1])
+        std::vector<int> sweep_edges;   // in connection-map order
+        std::vector<int> grad_edges;    // edges whose target reaches an output
+        std::vector<int> queue;         // BFS scratch
+    };
+    // per-thread scratch of computeEpisodeGrad (see Trainer::EpisodeWorkspace)
+    struct GradWorkspace {
+        std::vector<float> rates, elig, g_rate, phi_prime, logits, exps, p;
+        std::vector<const InputSequence *> seqs; // a worker's chunk of the batch
+        prof::Stats profile; // a worker thread's records, merged after the batch
+    };
+
     Glia &glia;
-    std::unordered_map<std::string, float> neuron_rate;
-    std::mt19937 rng;
+    EdgeIndex edges;                // order of the per-edge arrays (see Trainer::refreshEdges)
+    EdgeIndex edges_next;           // rebuild scratch, swapped with `edges`
+    std::vector<float> neuron_rate; // EMA firing rate by handle (+ the extra slot)
+    uint64_t seed = 123456u;        // of the random streams (see reseed())
+    uint64_t structure_passes = 0;  // post-batch structural passes, keying grow_edges' streams
     std::vector<double> epoch_acc_hist;
     std::vector<double> epoch_margin_hist;
-    // Adam optimizer state
-    std::unordered_map<std::string, float> adam_m;
-    std::unordered_map<std::string, float> adam_v;
+    std::vector<size_t> episode_order;     // trainEpoch()'s episode indices of the epoch
+    // Adam optimizer state, per edge
+    std::vector<float> adam_m;
+    std::vector<float> adam_v;
     int adam_step = 0;
+    std::vector<BatchedNetwork> lane_nets; // one per worker for lockstep/parallel batches
+    CompiledInputSequence episode_inputs;  // inputs of the episode being simulated
+    // neuron ID caches (see Trainer::refreshNeurons)
+    int cached_neuron_count = -1; uint64_t cached_neuron_order = ~0ull;
+    std::vector<nid::Key> neuron_keys; std::vector<std::string> sensory_ids, output_ids; std::vector<int> output_handles;
+    // reused across episodes and batches
+    GradWorkspace ws; std::vector<GradWorkspace> worker_ws; // worker 0 uses ws
+    std::vector<const Trainer::EpisodeData *> batch_items; // trainBatch(vector) view
+    std::vector<std::vector<float>> grads = std::vector<std::vector<float>>(1); // per batch item; [0] on the sequential path
+    std::vector<EpisodeMetrics> metrics = std::vector<EpisodeMetrics>(1);
+    std::vector<float> sum_grad;
+    StructuralPlasticity structural; std::vector<int> edge_from; // prune/grow pass (see Trainer::commitStructure)
+    uint64_t edges_version = ~0ull; // glia.getStructureVersion() `edges` is current for
+    // bumped by every structural edit (prune/grow here, or one refreshEdges() detects);
+    // `schedule` is rebuilt when it falls behind
+    int topology_version = 0;
+    int schedule_version = -1;
+    BackpropSchedule schedule;
+    ckpt::AsyncWriter checkpoint_writer; // on-disk checkpoints of trainEpoch()
+    prof::Stats profile_stats;           // see profile()
+    std::shared_ptr<ThreadPool> thread_pool, owned_pool; // see setThreadPool()
+    std::shared_ptr<telemetry::Sink> telemetry_sink;    // see setTelemetry()
 
-    static inline std::string edge_key(const std::string &a, const std::string &b) { return a + "|" + b; }
-
-    std::vector<std::string> collectOutputIDs() {
-        std::vector<std::string> ids; glia.forEachNeuron([&](Neuron &n){ const std::string &id = n.getId(); if (!id.empty() && id[0] == 'O') ids.push_back(id); }); return ids;
+    void refreshEdges() {
+        refreshNeurons();
+        const uint64_t version = glia.getStructureVersion();
+        if (version == edges_version && edges.numNeurons() == glia.getNeuronCount() && adam_m.size() == edges.targets.size() && adam_v.size() == edges.targets.size()) {
+            edges.syncWeights(glia); // unchanged since built or compacted: only the weights are stale
+        } else {
+            edges_next.build(glia);
+            if (!edges_next.sameTopology(edges)) ++topology_version;
+            if (!edges_next.sameTopology(edges) || adam_m.size() != edges_next.targets.size() || adam_v.size() != edges_next.targets.size()) { remapEdgeState(edges, edges_next, adam_m, 0.0f); remapEdgeState(edges, edges_next, adam_v, 0.0f); }
+            if (neuron_rate.size() != static_cast<size_t>(edges_next.numNeurons()) + 1) neuron_rate.assign(edges_next.numNeurons() + 1, 0.0f);
+            std::swap(edges, edges_next); edges_version = version;
+        }
+        if (schedule_version != topology_version) buildSchedule();
     }
-    std::vector<std::string> collectAllIDs() {
-        std::vector<std::string> ids; glia.forEachNeuron([&](Neuron &n){ ids.push_back(n.getId()); }); return ids;
+    void buildSchedule() {
+        BackpropSchedule &bp = schedule; const int N = edges.numNeurons();
+        bp.dist.assign(N + 1, -1); bp.queue.clear(); size_t qi = 0;
+        for (int h : output_handles) { bp.dist[h] = 0; bp.queue.push_back(h); }
+        while (qi < bp.queue.size()) {
+            const int u = bp.queue[qi++];
+            for (int i = edges.in_offsets[u]; i < edges.in_offsets[u + 1]; ++i) { const int pred = edges.sources[edges.in_edges[i]]; if (bp.dist[pred] < 0) { bp.dist[pred] = bp.dist[u] + 1; bp.queue.push_back(pred); } }
+        }
+        bp.order.assign(bp.queue.begin() + std::min(output_handles.size(), bp.queue.size()), bp.queue.end());
+        bp.sweep_offsets.assign(1, 0); bp.sweep_edges.clear(); bp.grad_edges.clear();
+        for (int j : bp.order) {
+            for (int k = edges.row_offsets[j]; k < edges.row_offsets[j + 1]; ++k) { const int dt = bp.dist[edges.targets[k]]; if (dt >= 0 && dt < bp.dist[j]) bp.sweep_edges.push_back(k); }
+            bp.sweep_offsets.push_back(static_cast<int>(bp.sweep_edges.size()));
+        }
+        for (int k = 0; k < edges.numEdges(); ++k) if (bp.dist[edges.targets[k]] >= 0) bp.grad_edges.push_back(k);
+        schedule_version = topology_version;
+    }
+    void refreshNeurons() {
+        if (glia.getNeuronCount() == cached_neuron_count && glia.getNeuronOrderVersion() == cached_neuron_order) return;
+        cached_neuron_count = glia.getNeuronCount(); cached_neuron_order = glia.getNeuronOrderVersion();
+        // rates follow their neuron to its new handle; the Adam moments are keyed by the old handles (see Trainer::refreshNeurons)
+        std::vector<nid::Key> keys = glia.getAllNeuronKeys();
+        remapNeuronState(neuron_keys, keys, neuron_rate, 0.0f, 1);
+        if (keys != neuron_keys) { adam_m.clear(); adam_v.clear(); }
+        neuron_keys.swap(keys);
+        sensory_ids.clear(); for (int h = 0; h < glia.getSensoryCount(); ++h) sensory_ids.push_back(nid::name(neuron_keys[h]));
+        output_ids.clear(); output_handles.clear();
+        for (size_t h = 0; h < neuron_keys.size(); ++h) { const std::string &id = nid::name(neuron_keys[h]); if (!id.empty() && id[0] == 'O') { output_ids.push_back(id); output_handles.push_back(static_cast<int>(h)); } }
+    }
+    // winner, margin and output rates from per-handle rates (reuses m.rates' nodes when the keys match)
+    void fillMetrics(EpisodeMetrics &m, const std::vector<float> &rates, int ticks) const {
+        float top1 = -1e9f, top2 = -1e9f; const std::string *win = nullptr;
+        if (m.rates.size() != output_ids.size()) m.rates.clear();
+        for (size_t i = 0; i < output_ids.size(); ++i) {
+            const std::string &id = output_ids[i];
+            float r = rates[output_handles[i]]; m.rates[id] = r; if (r > top1) { top2 = top1; top1 = r; win = &id; } else if (r > top2) { top2 = r; }
+        }
+        if (win) m.winner_id = *win; else m.winner_id.clear();
+        m.margin = (top1 > -1e8f && top2 > -1e8f) ? (top1 - top2) : 0.0f;
+        m.ticks_run = ticks;
     }
-    void injectFromSequence(InputSequence &seq) {
-        auto inputs = seq.getCurrentInputs(); for (const auto &kv : inputs) glia.injectSensory(kv.first, kv.second);
+    // Compute every episode's gradient from the current network state, split into contiguous
+    // chunks over min(batch_threads, batch size) workers (see Trainer::runFromBatchStart).
+    // Afterwards neuron_rate and the network state are those of the last episode. False if
+    // the network can't be compiled or has dynamics BatchedNetwork lacks (CompiledNetwork::basicDynamics()).
+    bool runFromBatchStart(const Trainer::EpisodeData *const *batch, size_t batch_size, const TrainingConfig &cfg) {
+        CompiledNetwork *cn = glia.getCompiled();
+        if (!cn || !cn->basicDynamics()) return false;
+        const int B = static_cast<int>(batch_size);
+        const int workers = std::max(1, std::min(cfg.batch_threads, B));
+        if (static_cast<int>(lane_nets.size()) < workers) lane_nets.resize(workers);
+        if (static_cast<int>(worker_ws.size()) < workers - 1) worker_ws.resize(workers - 1);
+        if (grads.size() < batch_size) grads.resize(batch_size);
+        if (metrics.size() < batch_size) metrics.resize(batch_size);
+        auto work = [&](int w) {
+            const int lo = B * w / workers, hi = B * (w + 1) / workers;
+            GradWorkspace &wk = w == 0 ? ws : worker_ws[w - 1];
+            GLIA_PROF_BIND(&wk.profile);
+            BatchedNetwork &bn = lane_nets[w];
+            bn.setDevice(cfg.device_batch);
+            bn.build(*cn, hi - lo);
+            wk.seqs.resize(hi - lo);
+            for (int b = lo; b < hi; ++b) wk.seqs[b - lo] = &batch[b]->seq;
+            bn.run(wk.seqs.data(), hi - lo, cfg.warmup_ticks + cfg.decision_window);
+            for (int b = lo; b < hi; ++b) computeEpisodeGrad(*wk.seqs[b - lo], cfg, batch[b]->target_id, metrics[b], wk.rates, grads[b], wk, &bn, b - lo);
+        };
+        ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool)->parallelFor(workers, work);
+        for (int w = 0; w < workers; ++w) { GradWorkspace &wk = w == 0 ? ws : worker_ws[w - 1]; profile_stats.merge(wk.profile); wk.profile.reset(); }
+        (workers == 1 ? ws : worker_ws[workers - 2]).rates.swap(neuron_rate); // rates after the last episode
+        lane_nets[workers - 1].storeLane(*cn, lane_nets[workers - 1].lanes() - 1);
+        return true;
     }
-    void updateDetector(IOutputDetector &detector, const std::vector<std::string> &output_ids) {
-        for (const auto &id : output_ids) { auto n = glia.getNeuronById(id); if (n) detector.update(id, n->didFire()); }
+    // resolve an episode's inputs against the sensory neurons (after seq.reset())
+    void compileInputs(const InputSequence &seq) { episode_inputs.compile(seq, sensory_ids); }
+    // inject the inputs of seq's current tick; seq must be the one last compiled
+    void injectFromSequence(const InputSequence &seq) { injectAt(seq.getCurrentTick()); }
+    void injectAt(int tick) {
+        GLIA_PROF_SCOPE(Inject);
+        const CompiledInputSequence::Span in = episode_inputs.at(tick);
+        glia.injectSensoryBatch(in.handles, in.values, in.size);
     }
 
-    std::unordered_map<std::string, float> computeEpisodeGrad(InputSequence &seq,
-                                                              const TrainingConfig &cfg,
-                                                              const std::string &target_id,
-                                                              EpisodeMetrics *out) {
-        std::vector<std::string> output_ids = collectOutputIDs();
-        neuron_rate.clear(); seq.reset();
-        std::unordered_map<std::string, float> elig;
+    void computeEpisodeGrad(const InputSequence &seq,
+                            const TrainingConfig &cfg,
+                            const std::string &target_id,
+                            EpisodeMetrics &m,
+                            std::vector<float> &rates,
+                            std::vector<float> &grad,
+                            GradWorkspace &work,
+                            const BatchedNetwork *replay = nullptr,
+                            int replay_lane = 0) {
+        // rates: per-neuron EMA rates by handle, reset here. With `replay` the spikes come
+        // from that lane of a finished BatchedNetwork run and the network is only read
+        // (thread-safe). The gradient is per edge of `edges`; buffers come from `work`.
+        const int N = edges.numNeurons(); const int E = edges.numEdges();
+        const int *tgt = edges.targets.data();
+        rates.assign(N + 1, 0.0f); SequenceCursor cursor(seq);
+        if (!replay) compileInputs(seq);
+        // every edge of a source gets the same update (e = lambda * e + rate[source], from 0),
+        // so one trace per source stands for its whole row
+        std::vector<float> &elig = work.elig; elig.assign(N + 1, 0.0f);
         const int U = cfg.warmup_ticks; const int W = cfg.decision_window;
         for (int t = 0; t < U + W; ++t) {
-            injectFromSequence(seq); glia.step();
-            std::unordered_map<std::string, bool> fired;
-            glia.forEachNeuron([&](Neuron &n){ bool f = n.didFire(); std::string nid = n.getId(); fired.emplace(nid, f); float r = 0.0f; auto itnr = neuron_rate.find(nid); if (itnr != neuron_rate.end()) r = itnr->second; float newr = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (f ? 1.0f : 0.0f); if (itnr != neuron_rate.end()) itnr->second = newr; else neuron_rate.emplace(nid, newr); });
-            glia.forEachNeuron([&](Neuron &from){ std::string from_id = from.getId(); const auto &conns = from.getConnections(); for (const auto &kv : conns) { std::string to_id = kv.first; std::string k = edge_key(from_id, to_id); float e_prev = 0.0f; auto itE = elig.find(k); if (itE != elig.end()) e_prev = itE->second; float pre = 0.0f; auto itPre = neuron_rate.find(from_id); if (itPre != neuron_rate.end()) pre = itPre->second; float e_new = cfg.elig_lambda * e_prev + pre; if (itE != elig.end()) itE->second = e_new; else elig.emplace(std::move(k), e_new); }});
-            seq.advance();
-        }
-        EpisodeMetrics m;
-        float top1 = -1e9f, top2 = -1e9f; std::string win;
-        for (const auto &id : output_ids) {
-            float r = 0.0f; auto it = neuron_rate.find(id); if (it != neuron_rate.end()) r = it->second; m.rates[id] = r; if (r > top1) { top2 = top1; top1 = r; win = id; } else if (r > top2) { top2 = r; }
+            const uint8_t *replayed = nullptr;
+            if (replay) replayed = replay->firedAt(replay_lane, t); else { injectAt(cursor.tick); glia.step(); }
+            GLIA_PROF_SCOPE(Eligibility);
+            int slot = 0;
+            if (replayed) { for (int h = 0; h < N; ++h) rates[h] = (1.0f - cfg.rate_alpha) * rates[h] + cfg.rate_alpha * (replayed[h] ? 1.0f : 0.0f); }
+            else glia.forEachNeuron([&](Neuron &n){ float &r = rates[slot++]; r = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (n.didFire() ? 1.0f : 0.0f); });
+            for (int h = 0; h < N; ++h) elig[h] = cfg.elig_lambda * elig[h] + rates[h];
+            cursor.advance();
         }
-        m.winner_id = win; m.margin = (top1 > -1e8f && top2 > -1e8f) ? (top1 - top2) : 0.0f;
-        m.ticks_run = U + W;
-        if (out) *out = m;
-        std::unordered_map<std::string, float> grad;
+        fillMetrics(m, rates, U + W);
+        GLIA_PROF_SCOPE(Delta);
+        GLIA_PROF_COUNT(edges_touched, schedule.sweep_edges.size() + schedule.grad_edges.size());
+        grad.assign(E, 0.0f);
         if (!output_ids.empty()) {
-            std::vector<float> logits; logits.reserve(output_ids.size());
+            std::vector<float> &logits = work.logits; logits.clear();
             float T = (cfg.grad.temperature > 0.0f ? cfg.grad.temperature : 1.0f);
-            for (const auto &id : output_ids) {
-                float r = 0.0f; auto itnr = neuron_rate.find(id); if (itnr != neuron_rate.end()) r = itnr->second;
-                logits.push_back(r / T);
-            }
+            for (size_t i = 0; i < output_ids.size(); ++i) logits.push_back(rates[output_handles[i]] / T);
             float max_logit = *std::max_element(logits.begin(), logits.end());
-            std::vector<float> exps(logits.size()); float sum_exp = 0.0f;
+            std::vector<float> &exps = work.exps; exps.resize(logits.size()); float sum_exp = 0.0f;
             for (size_t i = 0; i < logits.size(); ++i) { exps[i] = std::exp(logits[i] - max_logit); sum_exp += exps[i]; }
-            std::vector<float> p(logits.size()); for (size_t i = 0; i < logits.size(); ++i) p[i] = exps[i] / (sum_exp > 0.0f ? sum_exp : 1.0f);
-            std::unordered_map<std::string, float> g_rate;
-            for (size_t i = 0; i < output_ids.size(); ++i) { g_rate[output_ids[i]] = p[i]; }
-            for (size_t i = 0; i < output_ids.size(); ++i) { if (output_ids[i] == target_id) { g_rate[output_ids[i]] -= 1.0f; break; } }
-            for (auto &kv : g_rate) kv.second *= (1.0f / T);
-
-            std::unordered_map<std::string, std::vector<std::pair<std::string, float>>> outgoing;
-            std::unordered_map<std::string, std::vector<std::string>> inbound;
-            glia.forEachNeuron([&](Neuron &from){ std::string from_id = from.getId(); const auto &conns = from.getConnections(); for (const auto &kv : conns) { std::string to_id = kv.first; float w = kv.second.first; auto it_out = outgoing.find(from_id); if (it_out == outgoing.end()) it_out = outgoing.emplace(from_id, std::vector<std::pair<std::string,float>>{}).first; it_out->second.emplace_back(to_id, w); auto it_in = inbound.find(to_id); if (it_in == inbound.end()) it_in = inbound.emplace(to_id, std::vector<std::string>{}).first; it_in->second.emplace_back(from_id); }});
+            std::vector<float> &p = work.p; p.resize(logits.size()); for (size_t i = 0; i < logits.size(); ++i) p[i] = exps[i] / (sum_exp > 0.0f ? sum_exp : 1.0f);
+            // g_rate: dLoss/drate per handle, defined where the neuron reaches an output
+            std::vector<float> &g_rate = work.g_rate; g_rate.assign(N + 1, 0.0f);
+            for (size_t i = 0; i < output_ids.size(); ++i) { g_rate[output_handles[i]] = p[i]; }
+            for (size_t i = 0; i < output_ids.size(); ++i) { if (output_ids[i] == target_id) { g_rate[output_handles[i]] -= 1.0f; break; } }
+            for (size_t i = 0; i < output_ids.size(); ++i) g_rate[output_handles[i]] *= (1.0f / T);
 
-            std::unordered_map<std::string, float> phi_prime;
-            glia.forEachNeuron([&](Neuron &n){ std::string nid = n.getId(); float rloc = 0.0f; auto itn = neuron_rate.find(nid); if (itn != neuron_rate.end()) rloc = itn->second; if (rloc < 0.0f) rloc = 0.0f; if (rloc > 1.0f) rloc = 1.0f; float eps = 0.05f; if (rloc < eps) rloc = eps; if (rloc > 1.0f - eps) rloc = 1.0f - eps; phi_prime.emplace(nid, rloc * (1.0f - rloc)); });
+            std::vector<float> &phi_prime = work.phi_prime; phi_prime.assign(N + 1, 0.0f);
+            for (int h = 0; h < N; ++h) { float rloc = rates[h]; if (rloc < 0.0f) rloc = 0.0f; if (rloc > 1.0f) rloc = 1.0f; float eps = 0.05f; if (rloc < eps) rloc = eps; if (rloc > 1.0f - eps) rloc = 1.0f - eps; phi_prime[h] = rloc * (1.0f - rloc); }
 
-            std::map<std::string, int> dist;
-            std::vector<std::string> q; q.reserve(outgoing.size()); size_t qi = 0;
-            for (const auto &id : output_ids) { dist.emplace(id, 0); q.push_back(id); }
-            while (qi < q.size()) {
-                const std::string &u = q[qi++];
-                auto it_in = inbound.find(u);
-                if (it_in != inbound.end()) {
-                    int du = 0; auto itu = dist.find(u); if (itu != dist.end()) du = itu->second;
-                    for (const auto &pred : it_in->second) {
-                        if (dist.find(pred) == dist.end()) { dist.emplace(pred, du + 1); q.push_back(pred); }
-                    }
-                }
-            }
-            std::vector<std::pair<std::string,int>> order; order.reserve(dist.size());
-            for (const auto &kv : dist) { if (kv.second > 0) order.push_back(kv); }
-            std::sort(order.begin(), order.end(), [](const std::pair<std::string,int> &a, const std::pair<std::string,int> &b){ return a.second < b.second; });
-            for (const auto &pr : order) {
-                const std::string &j = pr.first; int dj = pr.second;
+            // backward sweep over the cached schedule (see buildSchedule)
+            const BackpropSchedule &bp = schedule;
+            for (size_t i = 0; i < bp.order.size(); ++i) {
+                const int j = bp.order[i];
                 float acc = 0.0f;
-                auto it_out = outgoing.find(j);
-                if (it_out != outgoing.end()) {
-                    for (const auto &edge : it_out->second) {
-                        const std::string &k = edge.first; float w = edge.second;
-                        auto itdk = dist.find(k); if (itdk == dist.end()) continue;
-                        if (itdk->second < dj) {
-                            float gk = 0.0f; auto itgk = g_rate.find(k); if (itgk != g_rate.end()) gk = itgk->second;
-                            float phip = 0.0f; auto itpp = phi_prime.find(k); if (itpp != phi_prime.end()) phip = itpp->second;
-                            acc += w * phip * gk;
-                        }
-                    }
-                }
-                auto itgj = g_rate.find(j); if (itgj != g_rate.end()) itgj->second += acc; else g_rate.emplace(j, acc);
+                for (int x = bp.sweep_offsets[i]; x < bp.sweep_offsets[i + 1]; ++x) { const int k = bp.sweep_edges[x]; const int t = tgt[k]; acc += edges.weights[k] * phi_prime[t] * g_rate[t]; }
+                g_rate[j] += acc;
             }
-
-            glia.forEachNeuron([&](Neuron &from){ const auto &conns = from.getConnections(); for (const auto &kv : conns) { const std::string &to_id = kv.first; const std::string k = edge_key(from.getId(), to_id); float e = 0.0f; auto itE = elig.find(k); if (itE != elig.end()) e = itE->second; auto itg = g_rate.find(to_id); if (itg != g_rate.end()) { float phip = 0.0f; auto itpp = phi_prime.find(to_id); if (itpp != phi_prime.end()) phip = itpp->second; float delta = itg->second * phip * e; auto itgr = grad.find(k); if (itgr != grad.end()) itgr->second += delta; else grad.emplace(k, delta); } }});
+            for (int k : bp.grad_edges) { const int t = tgt[k]; grad[k] = g_rate[t] * phi_prime[t] * elig[edges.sources[k]]; }
         }
-        return grad;
     }
 
-    void applyGradients(const std::unordered_map<std::string, float> &grad,
+    void applyGradients(const std::vector<float> &grad,
                         float scale,
                         const TrainingConfig &cfg) {
-        // Optional gradient norm clipping (global L2 over provided grad map)
-        float clip_scale = 1.0f;
-        if (cfg.grad.clip_grad_norm > 0.0f) {
-            double sumsq = 0.0; for (const auto &kv : grad) { double g = (double)kv.second * (double)scale; sumsq += g * g; }
-            double norm = std::sqrt(std::max(1e-30, sumsq));
-            if (norm > (double)cfg.grad.clip_grad_norm) {
-                clip_scale = (float)((double)cfg.grad.clip_grad_norm / norm);
-            }
-        }
+        GLIA_PROF_SCOPE(Apply);
+        GLIA_PROF_COUNT(edges_touched, grad.size());
+        // one pass over the flat weights of the index (current since refreshEdges()), then
+        // a row at a time back into the network (see optimizer.h)
+        const int E = edges.numEdges();
+        float *w = edges.weights.data();
+        // optional gradient norm clipping (global L2 over all edges)
+        const float clip_scale = optim::clipFactor(grad.data(), E, scale, cfg.grad.clip_grad_norm);
         bool use_adam = (cfg.grad.optimizer == "adam");
         bool use_adamw = (cfg.grad.optimizer == "adamw");
-        if (use_adam || use_adamw) adam_step = std::max(1, adam_step + 1);
-        glia.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                const std::string &to_id = kv.first;
-                const std::string k = edge_key(from.getId(), to_id);
-                float w = kv.second.first;
-                auto itg = grad.find(k);
-                float g = (itg != grad.end()) ? (itg->second * scale * clip_scale) : 0.0f;
-                if (use_adam || use_adamw) {
-                    float b1 = cfg.grad.adam_beta1;
-                    float b2 = cfg.grad.adam_beta2;
-                    float eps = cfg.grad.adam_eps > 0.0f ? cfg.grad.adam_eps : 1e-8f;
-                    float m = 0.0f, v = 0.0f;
-                    auto itm = adam_m.find(k); if (itm != adam_m.end()) m = itm->second;
-                    auto itv = adam_v.find(k); if (itv != adam_v.end()) v = itv->second;
-                    m = b1 * m + (1.0f - b1) * g;
-                    v = b2 * v + (1.0f - b2) * (g * g);
-                    adam_m[k] = m; adam_v[k] = v;
-                    double bias1 = 1.0 - std::pow((double)b1, (double)adam_step);
-                    double bias2 = 1.0 - std::pow((double)b2, (double)adam_step);
-                    double mhat = (double)m / (bias1 > 1e-20 ? bias1 : 1.0);
-                    double vhat = (double)v / (bias2 > 1e-20 ? bias2 : 1.0);
-                    // AdamW: decoupled weight decay as separate step scaled by lr
-                    if (use_adamw && cfg.weight_decay > 0.0f) {
-                        w -= cfg.lr * cfg.weight_decay * w;
-                    }
-                    // Parameter update
-                    w -= cfg.lr * (float)(mhat / (std::sqrt(vhat) + (double)eps));
-                } else {
-                    w -= cfg.lr * g;
-                }
-                // Coupled L2 decay for SGD/Adam only (AdamW handled above)
-                if (!use_adamw && cfg.weight_decay > 0.0f) {
-                    w -= cfg.weight_decay * w;
-                }
-                if (cfg.weight_clip > 0.0f) {
-                    float c = cfg.weight_clip; if (w > c) w = c; else if (w < -c) w = -c;
-                }
-                from.setTransmitter(to_id, w);
-            }
-        });
+        if (use_adam || use_adamw) {
+            adam_step = std::max(1, adam_step + 1);
+            optim::AdamParams p;
+            p.lr = cfg.lr; p.beta1 = cfg.grad.adam_beta1; p.beta2 = cfg.grad.adam_beta2; p.eps = cfg.grad.adam_eps;
+            p.weight_decay = cfg.weight_decay; p.decoupled = use_adamw; p.weight_clip = cfg.weight_clip;
+            optim::adam(w, adam_m.data(), adam_v.data(), grad.data(), E, scale, clip_scale, adam_step, p);
+        } else {
+            optim::sgd(w, grad.data(), E, scale, clip_scale, cfg.lr, cfg.weight_decay, cfg.weight_clip);
+        }
+        edges.storeWeights(glia);
     }
 
     void postBatchPlasticity(const TrainingConfig &cfg) {
-        std::vector<std::pair<std::string,std::string>> to_remove; glia.forEachNeuron([&](Neuron &from){ const auto &conns = from.getConnections(); for (const auto &kv : conns) { const std::string &to_id = kv.first; const std::string k = edge_key(from.getId(), to_id); float w = kv.second.first; if (std::fabs(w) < cfg.prune_epsilon) to_remove.emplace_back(from.getId(), to_id); }});
-        for (auto &edge : to_remove) { auto from = glia.getNeuronById(edge.first); if (from) from->removeConnection(edge.second); }
-        if (cfg.grow_edges > 0) {
-            std::vector<std::string> all_ids = collectAllIDs(); std::uniform_int_distribution<size_t> dist_idx(0, all_ids.size() ? all_ids.size() - 1 : 0); std::uniform_real_distribution<float> dist_sign(-1.0f, 1.0f);
-            int grown = 0; int attempts = 0;
-            while (grown < cfg.grow_edges && attempts < cfg.grow_edges * 20) {
-                attempts++;
-                const std::string &from_id = all_ids[dist_idx(rng)];
-                const std::string &to_id = all_ids[dist_idx(rng)];
-                if (!cfg.topology.edgeAllowed(from_id, to_id)) continue;
-                if (from_id == to_id) continue;
-                auto from = glia.getNeuronById(from_id);
-                auto to = glia.getNeuronById(to_id);
-                if (!from || !to) continue;
-                const auto &conns = from->getConnections();
-                if (conns.find(to_id) != conns.end()) continue;
-                float w = cfg.init_weight * (dist_sign(rng) >= 0 ? 1.0f : -1.0f);
-                from->addConnection(w, to);
-                grown++;
+        {
+            GLIA_PROF_SCOPE(PruneGrow);
+            // edits go through the edge index, which is compacted rather than rebuilt (see structural_plasticity.h)
+            structural.begin(glia, edges, neuron_keys);
+            int k = 0; glia.forEachNeuron([&](Neuron &from){ for (const auto &kv : from.getConnections()) { const int ek = k++; edges.weights[ek] = kv.second.first; if (std::fabs(kv.second.first) < cfg.prune_epsilon) structural.prune(ek); }});
+            const uint64_t pass = structure_passes++;
+            if (cfg.grow_edges > 0 && !neuron_keys.empty()) {
+                rstream::Stream rng(rstream::key(seed, rstream::GrowEdges, pass));
+                const uint32_t n = static_cast<uint32_t>(neuron_keys.size());
+                int grown = 0; int attempts = 0;
+                while (grown < cfg.grow_edges && attempts < cfg.grow_edges * 20) {
+                    attempts++;
+                    const int from = static_cast<int>(rng.below(n)); const int to = static_cast<int>(rng.below(n));
+                    if (!cfg.topology.edgeAllowed(nid::name(neuron_keys[from]), nid::name(neuron_keys[to]))) continue;
+                    if (from == to || structural.exists(from, to)) continue;
+                    float w = cfg.init_weight * (rng.coin() ? 1.0f : -1.0f);
+                    structural.grow(from, to, w);
+                    grown++;
+                }
+            }
+            if (structural.commit(glia, edges_next, edge_from)) {
+                remapEdgeState(edge_from, adam_m, 0.0f); remapEdgeState(edge_from, adam_v, 0.0f);
+                std::swap(edges, edges_next); edges_version = glia.getStructureVersion();
+                ++topology_version;
             }
         }
-        glia.forEachNeuron([&](Neuron &n){ float r = neuron_rate[n.getId()]; if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target)); if (cfg.eta_leak != 0.0f) { float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r); if (new_leak < 0.0f) new_leak = 0.0f; if (new_leak > 1.0f) new_leak = 1.0f; n.setLeak(new_leak); }});
+        GLIA_PROF_SCOPE(Plasticity);
+        int h = 0;
+        glia.forEachNeuron([&](Neuron &n){ float r = neuron_rate[h++]; if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target)); if (cfg.eta_leak != 0.0f) { float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r); if (new_leak < 0.0f) new_leak = 0.0f; if (new_leak > 1.0f) new_leak = 1.0f; n.setLeak(new_leak); }});
     }
 };
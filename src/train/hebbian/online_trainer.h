@@ -0,0 +1,317 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "../../arch/glia.h"
+#include "../../arch/output_detection.h"
+#include "../../arch/profiling.h"
+#include "../edge_index.h"
+#include "../optimizer.h"
+#include "trainer.h"
+#include "training_config.h"
+
+/*
+Reward-modulated learning on an unbounded event stream, with no episodes: the network
+steps continuously and inputs, rewards and labels are pushed with the tick they belong to.
+Ticks count step() calls since construction; now() is the next tick to run.
+
+Each tick, the inputs due are injected, the network steps, and the eligibility traces of
+Trainer advance: firing rates by cfg.rate_alpha, and on a spike of source h
+    e = lambda^(t - t_last) * e + post[target]
+over h's edges only (see Trainer::SparseElig; here with 64-bit ticks and no episode end).
+Outputs (O*) are followed by an EMA detector (cfg.detector alpha, threshold, default_id).
+
+A reward stamped with tick t is applied once tick t has run, to the traces as they are then:
+    w += lr * r * e, then weight_decay and weight_clip
+with r centered by the advantage baseline (use_advantage_baseline, baseline_beta). A reward
+that arrives after its tick is applied after the next one, so its traces carry the decay
+of the delay; one more than Limits::max_reward_delay ticks late is dropped. A label
+becomes a reward through Trainer::computeReward() against the detector's current winner,
+margin and rates, with no_update_if_satisfied and update_gating as in episode training.
+
+Memory is bounded: a trace per edge, a rate per neuron, and at most Limits::max_pending_*
+queued pushes (further ones are dropped and counted). Pushes take a lock, so producers
+may run on other threads while one thread steps; configuration changes go between steps.
+
+    OnlineTrainer online(net, cfg);
+    online.pushInput(t, net.getNeuronHandle("S0"), 80.0f);
+    online.pushLabel(t + 30, "O1");     // or pushReward(t + 30, 1.0f)
+    online.advanceTo(t + 40);
+*/
+class OnlineTrainer {
+public:
+    struct Limits {
+        size_t max_pending_inputs = 1u << 16;
+        size_t max_pending_rewards = 1u << 12;  // labels included
+        int64_t max_reward_delay = 1000;        // ticks
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t inputs = 0;          // injected
+        uint64_t late_inputs = 0;     // pushed for a tick already run; injected at the next
+        uint64_t dropped_inputs = 0;  // queue full
+        uint64_t rewards = 0;         // applied, labels included
+        uint64_t dropped_rewards = 0; // queue full, or more than max_reward_delay late
+        float last_reward = 0.0f;     // as applied (after the baseline)
+    };
+
+    explicit OnlineTrainer(Glia &net, const TrainingConfig &cfg = TrainingConfig()) : glia(net), config(cfg) {}
+
+    const TrainingConfig &getConfig() const { return config; }
+    void setConfig(const TrainingConfig &cfg) { config = cfg; }
+    const Limits &getLimits() const { return limits; }
+    void setLimits(const Limits &l) { std::lock_guard<std::mutex> g(lock); limits = l; }
+
+    int64_t now() const { return tick.load(); }
+
+    // Queue `value` into sensory handle `handle` before tick `at`; false if dropped
+    bool pushInput(int64_t at, int handle, float value) {
+        std::lock_guard<std::mutex> g(lock);
+        if (pending_inputs.size() >= limits.max_pending_inputs) { stats.dropped_inputs++; return false; }
+        if (at < tick.load()) stats.late_inputs++;
+        pending_inputs.push(PendingInput{at, push_order++, handle, value});
+        return true;
+    }
+    bool pushInput(int64_t at, const std::string &id, float value) {
+        return pushInput(at, glia.getNeuronHandle(id), value);
+    }
+
+    // Queue reward r for tick `at`; false if dropped
+    bool pushReward(int64_t at, float r) { return pushPendingReward(PendingReward{at, 0, r, std::string()}); }
+    // Queue the correct output at tick `at`, rewarded per cfg.reward_mode; false if dropped
+    bool pushLabel(int64_t at, const std::string &target_id) { return pushPendingReward(PendingReward{at, 0, 0.0f, target_id}); }
+
+    // Run one tick, then apply the rewards due
+    void step() {
+        GLIA_PROF_BIND(&profile_stats);
+        refresh();
+        const int64_t t = tick.load();
+        {
+            std::lock_guard<std::mutex> g(lock);
+            while (!pending_inputs.empty() && pending_inputs.top().tick <= t) { due_inputs.push_back(pending_inputs.top()); pending_inputs.pop(); }
+            while (!pending_rewards.empty() && pending_rewards.top().tick <= t) { due_rewards.push_back(pending_rewards.top()); pending_rewards.pop(); }
+            stats.inputs += due_inputs.size();
+        }
+        {
+            GLIA_PROF_SCOPE(Inject);
+            for (const PendingInput &in : due_inputs) glia.injectSensory(in.handle, in.value);
+        }
+        due_inputs.clear();
+
+        glia.step();
+        glia.getFiredMask(fired_mask);
+        {
+            GLIA_PROF_SCOPE(Eligibility);
+            const int N = edges.numNeurons();
+            const float a = config.rate_alpha;
+            for (int h = 0; h < N; ++h) {
+                const bool f = (fired_mask[h >> 6] >> (h & 63)) & 1u;
+                rates[h] = (1.0f - a) * rates[h] + a * (f ? 1.0f : 0.0f);
+                post[h] = config.elig_post_use_rate ? rates[h] : (f ? 1.0f : 0.0f);
+            }
+            for (int h = 0; h < N; ++h) if ((fired_mask[h >> 6] >> (h & 63)) & 1u) fire(h, t);
+        }
+        {
+            GLIA_PROF_SCOPE(Detector);
+            detector.updateFromMask(fired_mask.data());
+        }
+        tick.store(t + 1);
+
+        for (const PendingReward &r : due_rewards) applyReward(r, t);
+        due_rewards.clear();
+        std::lock_guard<std::mutex> g(lock);
+        stats.ticks++;
+    }
+
+    void advance(int64_t ticks) { for (int64_t i = 0; i < ticks; ++i) step(); }
+    // step until now() == t
+    void advanceTo(int64_t t) { while (tick.load() < t) step(); }
+
+    // the detector's current decision over the outputs
+    std::string winner() const { return detector.winner(); }
+    float margin() const { return detector.margin(); }
+    float outputRate(const std::string &id) const { return detector.getRate(id); }
+
+    Stats getStats() const { std::lock_guard<std::mutex> g(lock); return stats; }
+    const prof::Stats &profile() const { return profile_stats; }
+    void resetProfile() { profile_stats.reset(); }
+
+private:
+    struct PendingInput {
+        int64_t tick;
+        uint64_t order; // push order, breaking ties so a tick's inputs go in as pushed
+        int handle;
+        float value;
+    };
+    struct PendingReward {
+        int64_t tick;
+        uint64_t order;
+        float reward;
+        std::string target_id; // non-empty: a label
+    };
+    template <class T> struct Later {
+        bool operator()(const T &a, const T &b) const { return a.tick != b.tick ? a.tick > b.tick : a.order > b.order; }
+    };
+
+    bool pushPendingReward(PendingReward r) {
+        std::lock_guard<std::mutex> g(lock);
+        if (pending_rewards.size() >= limits.max_pending_rewards) { stats.dropped_rewards++; return false; }
+        r.order = push_order++;
+        pending_rewards.push(std::move(r));
+        return true;
+    }
+
+    // rebuild the edge index, traces and output slots after the network changed
+    void refresh() {
+        const int count = glia.getNeuronCount();
+        if (count != cached_neuron_count || glia.getNeuronOrderVersion() != cached_neuron_order) {
+            cached_neuron_count = count;
+            cached_neuron_order = glia.getNeuronOrderVersion();
+            // rates follow their neuron to its new handle (neurons may have been reordered)
+            std::vector<nid::Key> keys = glia.getAllNeuronKeys();
+            remapNeuronState(neuron_keys, keys, rates, 0.0f);
+            neuron_keys.swap(keys);
+            output_ids.clear();
+            output_handles.clear();
+            for (size_t h = 0; h < neuron_keys.size(); ++h) {
+                const std::string &id = nid::name(neuron_keys[h]);
+                if (!id.empty() && id[0] == 'O') { output_ids.push_back(id); output_handles.push_back(static_cast<int>(h)); }
+            }
+            post.assign(count, 0.0f);
+        }
+        const OutputDetectorConfig &d = config.detector;
+        if (!detector_built || detector_cfg.alpha != d.alpha || detector_cfg.threshold != d.threshold || detector_cfg.default_id != d.default_id) {
+            OutputDetectorOptions opts; opts.threshold = d.threshold; opts.default_id = d.default_id;
+            detector = EMASlotDetector(d.alpha, opts);
+            detector_cfg = d;
+            detector_built = true;
+        }
+        if (detector.outputHandles() != output_handles || detector.outputIds() != output_ids) detector.setOutputs(output_ids, output_handles);
+
+        const uint64_t version = glia.getStructureVersion();
+        if (version != edges_version || edges.numNeurons() != count) {
+            // traces of a changed topology start over
+            edges.build(glia);
+            edges_version = version;
+            elig.assign(edges.numEdges(), 0.0f);
+            delta.assign(edges.numEdges(), 0.0f);
+            last.assign(count, -1);
+        }
+        if (lam_pow.empty() || lam_pow_lambda != config.elig_lambda) {
+            lam_pow.assign(kPowTable, 1.0f);
+            for (size_t n = 1; n < lam_pow.size(); ++n) lam_pow[n] = lam_pow[n - 1] * config.elig_lambda;
+            lam_pow_lambda = config.elig_lambda;
+        }
+    }
+
+    float decay(int64_t ticks) const {
+        return ticks < static_cast<int64_t>(lam_pow.size()) ? lam_pow[ticks] : static_cast<float>(std::pow(static_cast<double>(config.elig_lambda), static_cast<double>(ticks)));
+    }
+
+    void fire(int h, int64_t t) {
+        const float k = last[h] < 0 ? 0.0f : decay(t - last[h]);
+        float *e = elig.data();
+        const int *tgt = edges.targets.data();
+        for (int i = edges.row_offsets[h]; i < edges.row_offsets[h + 1]; ++i) e[i] = k * e[i] + post[tgt[i]];
+        GLIA_PROF_COUNT(edges_touched, edges.row_offsets[h + 1] - edges.row_offsets[h]);
+        last[h] = t;
+    }
+
+    // bring every trace to tick t
+    void catchUp(int64_t t) {
+        for (int h = 0; h < static_cast<int>(last.size()); ++h) {
+            if (last[h] < 0 || last[h] >= t) continue;
+            const float k = decay(t - last[h]);
+            for (int i = edges.row_offsets[h]; i < edges.row_offsets[h + 1]; ++i) elig[i] *= k;
+            last[h] = t;
+        }
+    }
+
+    void applyReward(const PendingReward &r, int64_t t) {
+        if (t - r.tick > limits.max_reward_delay) {
+            std::lock_guard<std::mutex> g(lock);
+            stats.dropped_rewards++;
+            return;
+        }
+        GLIA_PROF_SCOPE(Delta);
+        float raw = r.reward;
+        int gate = -1; // target handle of the updated edges, -1 for all
+        bool satisfied = false;
+        if (!r.target_id.empty()) {
+            label_metrics.winner_id = detector.winner();
+            label_metrics.margin = detector.margin();
+            if (label_metrics.rates.size() != output_ids.size()) label_metrics.rates.clear();
+            for (size_t i = 0; i < output_ids.size(); ++i) label_metrics.rates[output_ids[i]] = detector.rate(static_cast<int>(i));
+            raw = Trainer::computeReward(label_metrics, config, r.target_id);
+            satisfied = config.no_update_if_satisfied && label_metrics.winner_id == r.target_id && label_metrics.margin >= config.margin_delta;
+            if (config.update_gating == "winner_only" && !label_metrics.winner_id.empty()) gate = glia.getNeuronHandle(label_metrics.winner_id);
+            else if (config.update_gating == "target_only") gate = glia.getNeuronHandle(r.target_id);
+        }
+        float reward = raw;
+        if (config.use_advantage_baseline) {
+            reward = raw - reward_baseline;
+            reward_baseline = (1.0f - config.baseline_beta) * reward_baseline + config.baseline_beta * raw;
+        }
+        if (satisfied) reward = 0.0f;
+
+        catchUp(t);
+        const int E = edges.numEdges();
+        const float scale = config.lr * reward;
+        for (int k = 0; k < E; ++k) delta[k] = (gate < 0 || edges.targets[k] == gate) ? scale * elig[k] : 0.0f;
+        {
+            GLIA_PROF_SCOPE(Apply);
+            edges.syncWeights(glia);
+            optim::addScaled(edges.weights.data(), delta.data(), E, 1.0f, config.weight_decay, config.weight_clip);
+            edges.storeWeights(glia);
+        }
+        std::lock_guard<std::mutex> g(lock);
+        stats.rewards++;
+        stats.last_reward = reward;
+    }
+
+    static const size_t kPowTable = 1024; // lambda^d tabulated for gaps below this
+
+    Glia &glia;
+    TrainingConfig config;
+    Limits limits;
+
+    // pending pushes (guarded by `lock`, as are `stats`)
+    mutable std::mutex lock;
+    std::priority_queue<PendingInput, std::vector<PendingInput>, Later<PendingInput>> pending_inputs;
+    std::priority_queue<PendingReward, std::vector<PendingReward>, Later<PendingReward>> pending_rewards;
+    uint64_t push_order = 0;
+    Stats stats;
+    std::atomic<int64_t> tick{0};
+
+    // the stepping thread's state
+    EdgeIndex edges;
+    uint64_t edges_version = ~0ull;
+    int cached_neuron_count = -1;
+    uint64_t cached_neuron_order = ~0ull; // glia.getNeuronOrderVersion() the caches below are current for
+    std::vector<nid::Key> neuron_keys;    // interned IDs by handle
+    std::vector<std::string> output_ids;
+    std::vector<int> output_handles;
+    EMASlotDetector detector;
+    OutputDetectorConfig detector_cfg;
+    bool detector_built = false;
+    std::vector<float> rates;       // EMA firing rate by handle
+    std::vector<float> post;
+    std::vector<float> elig;        // per edge of `edges`
+    std::vector<float> delta;
+    std::vector<int64_t> last;      // last tick each source's traces were brought to, -1 before its first spike
+    std::vector<float> lam_pow;
+    float lam_pow_lambda = 0.0f;
+    float reward_baseline = 0.0f;
+    EpisodeMetrics label_metrics;
+    std::vector<uint64_t> fired_mask;
+    std::vector<PendingInput> due_inputs;
+    std::vector<PendingReward> due_rewards;
+    prof::Stats profile_stats;
+};
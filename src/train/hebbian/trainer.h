@@ -6,12 +6,25 @@
 #include <random>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "../../arch/glia.h"
 #include "../../arch/neuron.h"
 #include "../../arch/output_detection.h"
 #include "../../arch/input_sequence.h"
+#include "../../arch/batched_network.h"
+#include "../../arch/profiling.h"
+#include "../../arch/thread_pool.h"
+#include "../../arch/telemetry.h"
+#include "../../arch/random_streams.h"
+#include "../edge_index.h"
+#include "../structural_plasticity.h"
+#include "../optimizer.h"
+#include "../episode_source.h"
+#include "../network_snapshot.h"
+#include "../checkpoint.h"
+#include "../dataset_eval.h"
 #include "training_config.h"
 
 struct EpisodeMetrics {
@@ -23,114 +36,472 @@ struct EpisodeMetrics {
 
 class Trainer {
 public:
-    explicit Trainer(Glia &net) : glia(net), rng(123456u) {}
-    void reseed(unsigned int s) { rng.seed(s); }
+    explicit Trainer(Glia &net) : glia(net) {}
+    // seed of the trainer's random streams (see random_streams.h): shuffling, jitter and
+    // grown edges are keyed by it and by the epoch or structural pass they are for
+    void reseed(unsigned int s) { seed = s; }
     bool revertCheckpoint() { return revertOneCheckpoint(); }
     // Training history getters (copies)
     std::vector<double> getEpochAccHistory() const { return epoch_acc_hist; }
     std::vector<double> getEpochMarginHistory() const { return epoch_margin_hist; }
+    int epochsCompleted() const { return static_cast<int>(epoch_acc_hist.size()); }
+
+    // Time per phase and event counts of everything this trainer ran (including its
+    // glia.step() calls and worker threads) since construction or resetProfile(); all zero
+    // unless built with GLIA_PROFILE (see profiling.h)
+    const prof::Stats &profile() const { return profile_stats; }
+    void resetProfile() { profile_stats.reset(); }
+
+    // Pool that runs batch workers (see thread_pool.h); without one, cfg.pool_threads > 0
+    // gives the trainer a private pool of that size and 0 uses ThreadPool::shared().
+    // EvolutionEngine passes its own so individuals and their batches share threads.
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { thread_pool = std::move(pool); }
+
+    // Progress records (see telemetry.h) of trainEpoch(): one per batch, one per epoch and,
+    // with GLIA_PROFILE, one per phase of the epoch. Batch progress then no longer goes to
+    // the console. nullptr detaches.
+    void setTelemetry(std::shared_ptr<telemetry::Sink> sink) { telemetry_sink = std::move(sink); }
+
+    // On-disk checkpoints (see checkpoint.h). The state is everything the next epoch
+    // depends on: the network (edges, weights, parameters and dynamic state), the stream
+    // seed and structural pass count, reward baseline, rates, prune/inactivity counters,
+    // epoch history and the in-memory checkpoints. Loading it into a trainer on a network
+    // built from the same file makes the next trainEpoch() train what the interrupted run
+    // would have.
+    static const char *checkpointKind() { return "hebbian"; }
+    void saveState(ckpt::Writer &w) {
+        refreshEdges();
+        Snapshot now = captureSnapshot();
+        std::vector<const Snapshot *> snaps(1, &now);
+        for (const std::vector<Snapshot> *level : {&ckpt_l0, &ckpt_l1, &ckpt_l2}) {
+            w.u32(static_cast<uint32_t>(level->size()));
+            for (const Snapshot &s : *level) snaps.push_back(&s);
+        }
+        w.snapshots(snaps);
+        ckpt::DynamicState state;
+        state.capture(glia);
+        state.write(w);
+        w.u64(seed);
+        w.u64(structure_passes);
+        w.f32(reward_baseline);
+        w.vec(neuron_rate);
+        w.vec(prune_counter);
+        std::vector<std::pair<std::string, int>> inactive;
+        for (size_t h = 0; h < inactive_counter.size(); ++h)
+            if (inactive_counter[h] != 0) inactive.emplace_back(nid::name(neuron_keys[h]), inactive_counter[h]);
+        std::sort(inactive.begin(), inactive.end());
+        std::vector<std::string> inactive_ids;
+        std::vector<int> inactive_counts;
+        for (const auto &p : inactive) { inactive_ids.push_back(p.first); inactive_counts.push_back(p.second); }
+        w.strs(inactive_ids);
+        w.vec(inactive_counts);
+        w.vec(epoch_acc_hist);
+        w.vec(epoch_margin_hist);
+    }
+    // false (see r.error()) if the state can't be read or is of another network, which
+    // is then left as it was
+    bool loadState(ckpt::Reader &r) {
+        uint32_t levels[3];
+        for (uint32_t &n : levels) n = r.u32();
+        std::vector<Snapshot> snaps = r.snapshots();
+        ckpt::DynamicState state;
+        state.read(r);
+        const uint64_t stream_seed = r.u64();
+        const uint64_t passes = r.u64();
+        const float baseline = r.f32();
+        std::vector<float> rates = r.vec<float>();
+        std::vector<int> counters = r.vec<int>();
+        std::vector<std::string> inactive_ids = r.strs();
+        std::vector<int> inactive_counts = r.vec<int>();
+        std::vector<double> acc = r.vec<double>(), margin = r.vec<double>();
+        if (!r.ok()) return false;
+        if (snaps.size() != 1 + static_cast<size_t>(levels[0]) + levels[1] + levels[2] || inactive_ids.size() != inactive_counts.size())
+            return r.fail("malformed trainer state");
+        if (counters.size() != snaps[0].topology().targets.size() || rates.size() != snaps[0].topology().keys.size() + 1)
+            return r.fail("trainer state doesn't match its network");
+        if (!ckpt::restoreNetwork(r, glia, snaps[0], state)) return false;
+        refreshEdges();
+        prune_counter.swap(counters);
+        neuron_rate.swap(rates);
+        inactive_counter.assign(neuron_keys.size(), 0);
+        for (size_t i = 0; i < inactive_ids.size(); ++i) {
+            const int h = glia.getNeuronHandle(inactive_ids[i]);
+            if (h >= 0) inactive_counter[h] = inactive_counts[i];
+        }
+        seed = stream_seed;
+        structure_passes = passes;
+        reward_baseline = baseline;
+        epoch_acc_hist.swap(acc);
+        epoch_margin_hist.swap(margin);
+        std::vector<Snapshot> *dst[3] = {&ckpt_l0, &ckpt_l1, &ckpt_l2};
+        size_t k = 1;
+        for (int l = 0; l < 3; ++l) {
+            dst[l]->assign(snaps.begin() + k, snaps.begin() + k + levels[l]);
+            k += levels[l];
+        }
+        return true;
+    }
+    // synchronous save/load of a whole checkpoint file; false with a message in `error`
+    bool saveCheckpoint(const std::string &path, std::string &error) {
+        ckpt::Writer w(checkpointKind());
+        saveState(w);
+        return ckpt::writeFile(path, w.bytes(), error);
+    }
+    bool loadCheckpoint(const std::string &path, std::string &error) {
+        ckpt::Reader r;
+        if (!r.open(path, checkpointKind()) || !loadState(r)) {
+            error = r.error();
+            return false;
+        }
+        return true;
+    }
+    // wait for checkpoints trainEpoch() handed to the background writer
+    bool flushCheckpoints(std::string &error) { return checkpoint_writer.flush(&error); }
 
     // Evaluate a single episode using the provided input sequence and config.
     EpisodeMetrics evaluate(InputSequence &seq, const TrainingConfig &cfg) {
-        // Collect output neuron IDs (O*)
-        std::vector<std::string> output_ids = collectOutputIDs();
-
-        // Detector setup
-        OutputDetectorOptions opts; opts.threshold = cfg.detector.threshold; opts.default_id = cfg.detector.default_id;
-        EMAOutputDetector detector(cfg.detector.alpha, opts);
-        detector.reset();
+        GLIA_PROF_BIND(&profile_stats);
+        // Output neuron IDs (O*) and detector, reused across episodes
+        refreshNeurons();
+        SlotDetector &detector = resetDetector(ws, cfg);
 
         // Reset sequence
         seq.reset();
+        compileInputs(seq);
+        next_input = -1;
+        last_step_fired = false;
+
+        const OutputDetectorConfig &dc = cfg.detector;
+        const bool fast_forward = dc.fast_forward && !seq.isLooping();
 
         // Warmup (U)
         const int U = cfg.warmup_ticks;
-        for (int t = 0; t < U; ++t) {
+        for (int t = 0; t < U;) {
+            const int silent = fast_forward ? silentTicks(seq, U - t) : 0;
+            if (silent > 0) {
+                detector.advanceSilent(silent);
+                skipSilent(seq, silent);
+                t += silent;
+                continue;
+            }
             injectFromSequence(seq);
             glia.step();
-            updateDetector(detector, output_ids);
+            updateDetectorFromStep(detector);
             seq.advance();
+            ++t;
         }
 
-        // Decision window (W)
+        // Decision window (W), optionally cut short once the winner is settled
         const int W = cfg.decision_window;
-        for (int t = 0; t < W; ++t) {
+        detector.beginDecision();
+        int ticks = U + W;
+        for (int t = 0; t < W;) {
+            int silent = fast_forward ? silentTicks(seq, W - t) : 0;
+            if (silent > 0) {
+                // with early exit the detector goes a tick at a time, so the run stops where
+                // a stepped one would
+                bool settled = false;
+                if (dc.early_exit) {
+                    for (int k = 0; k < silent; ++k) {
+                        detector.advanceSilent(1);
+                        if (decisionSettled(detector, dc, t + k, W)) {
+                            settled = true;
+                            silent = k + 1;
+                            break;
+                        }
+                    }
+                } else {
+                    detector.advanceSilent(silent);
+                }
+                skipSilent(seq, silent);
+                t += silent;
+                if (settled) {
+                    ticks = U + t;
+                    break;
+                }
+                continue;
+            }
             injectFromSequence(seq);
             glia.step();
-            updateDetector(detector, output_ids);
+            updateDetectorFromStep(detector);
             seq.advance();
+            if (decisionSettled(detector, dc, t, W)) {
+                ticks = U + t + 1;
+                break;
+            }
+            ++t;
         }
 
         // Compile metrics
         EpisodeMetrics m;
-        m.winner_id = detector.predict(output_ids);
-        m.margin = detector.getMargin(output_ids);
-        for (const auto &id : output_ids) {
-            m.rates[id] = detector.getRate(id);
-        }
-        m.ticks_run = U + W;
+        m.winner_id = detector.winner();
+        m.margin = detector.margin();
+        fillRates(m, detector);
+        m.ticks_run = ticks;
         return m;
     }
 
-    // Dataset item: an input sequence paired with a target output ID (e.g., "O0").
-    struct EpisodeData {
-        InputSequence seq;
-        std::string target_id;
+    typedef ::EpisodeData EpisodeData; // see episode_source.h
+
+    // Evaluate every episode of a dataset, each from the network's current state, with
+    // evaluate()'s detector and early exit (see dataset_eval.h). Episodes run as parallel
+    // lanes over cfg.batch_threads workers; the network and the trainer are left as they were.
+    DatasetMetrics evaluateDataset(const std::vector<EpisodeData> &dataset, const TrainingConfig &cfg) {
+        VectorSource source(dataset);
+        return evaluateDataset(source, cfg);
+    }
+    DatasetMetrics evaluateDataset(EpisodeSource &source, const TrainingConfig &cfg) {
+        DatasetMetrics out;
+        dataset_eval::forEachBlock(source, cfg, [&](const EpisodeData *const *items, size_t n) { evaluateEpisodes(items, n, cfg, out); });
+        out.finish();
+        return out;
+    }
+
+    // Evaluate n episodes as evaluateDataset() does and append them to `out` (finish() is
+    // left to the caller, which can stop between parts of a dataset)
+    void evaluateEpisodes(const EpisodeData *const *eps, size_t n, const TrainingConfig &cfg, DatasetMetrics &out) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshNeurons();
+        out.labels = output_ids;
+        const size_t first = out.size();
+        out.resize(first + n);
+        const int workers = dataset_eval::workers(n, cfg);
+        if (static_cast<int>(worker_ws.size()) < workers - 1) worker_ws.resize(workers - 1);
+        const int U = cfg.warmup_ticks, W = cfg.decision_window;
+        const bool lanes = dataset_eval::runLanes(glia, eps, n, cfg, *ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool), lane_nets, profile_stats,
+            [&](int w, const BatchedNetwork &bn, int lane, size_t k) {
+                GLIA_PROF_SCOPE(Detector);
+                SlotDetector &detector = resetDetector(w == 0 ? ws : worker_ws[w - 1], cfg);
+                int ticks = U + W;
+                for (int t = 0; t < U; ++t) detector.updateFromFlags(bn.firedAt(lane, t));
+                detector.beginDecision();
+                for (int t = 0; t < W; ++t) {
+                    detector.updateFromFlags(bn.firedAt(lane, U + t));
+                    if (decisionSettled(detector, cfg.detector, t, W)) {
+                        ticks = U + t + 1;
+                        break;
+                    }
+                }
+                out.record(first + k, detector.winner(), eps[k]->target_id, detector.margin(), ticks);
+            });
+        if (!lanes) dataset_eval::runSerial(glia, eps, n, [&](InputSequence &seq, size_t k) {
+            const EpisodeMetrics m = evaluate(seq, cfg);
+            out.record(first + k, m.winner_id, eps[k]->target_id, m.margin, m.ticks_run);
+        });
+    }
+
+    // Compute target-specific margin: rate[target] - max(rate[others])
+    static inline float targetMargin(const std::map<std::string,float> &rates, const std::string &target_id) {
+        auto itT = rates.find(target_id);
+        float rT = (itT != rates.end()) ? itT->second : 0.0f;
+        float rMaxOther = 0.0f;
+        bool init = false;
+        for (const auto &kv : rates) {
+            if (kv.first == target_id) continue;
+            if (!init) { rMaxOther = kv.second; init = true; }
+            else if (kv.second > rMaxOther) rMaxOther = kv.second;
+        }
+        return rT - rMaxOther;
+    }
+
+    // Choose reward per config (also OnlineTrainer's, for labels). Modes:
+    //  - "binary": +reward_pos if (winner==target && margin>=delta) else reward_neg
+    //  - "margin_linear": clamp(gain * target_margin, [reward_min, reward_max])
+    //  - "softplus_margin": sigma(gain * (delta - target_margin)) in [0,1]
+    static inline float computeReward(const EpisodeMetrics &m, const TrainingConfig &cfg, const std::string &target_id) {
+        if (cfg.reward_mode == "margin_linear") {
+            float tm = targetMargin(m.rates, target_id);
+            float r = cfg.reward_gain * tm;
+            if (r < cfg.reward_min) r = cfg.reward_min;
+            if (r > cfg.reward_max) r = cfg.reward_max;
+            return r;
+        }
+        if (cfg.reward_mode == "softplus_margin") {
+            float tm = targetMargin(m.rates, target_id);
+            float x = cfg.reward_gain * (cfg.margin_delta - tm);
+            float r = 1.0f / (1.0f + std::exp(-x));
+            if (cfg.reward_min < cfg.reward_max) {
+                if (r < cfg.reward_min) r = cfg.reward_min;
+                if (r > cfg.reward_max) r = cfg.reward_max;
+            }
+            return r;
+        }
+        if (m.winner_id == target_id && m.margin >= cfg.margin_delta) return cfg.reward_pos;
+        return cfg.reward_neg;
+    }
+
+    // Eligibility traces and metrics of one simulated episode, before reward is applied.
+    struct EpisodeTrace {
+        EpisodeMetrics metrics;
+        std::vector<float> elig; // per edge of edgeIndex()
     };
 
+    // Eligibility traces updated only on spikes. With pre = 0 a trace just decays, so the
+    // edges of a source are touched only on the ticks it fires,
+    //   e = lambda^(t - t_last) * e + post[target],
+    // and finish() applies the decay still owed at the episode's last tick. Cost scales
+    // with spikes x fan-out instead of edges x ticks. lambda^d comes from a table built by
+    // repeated multiplication; for one-tick gaps this is exactly the dense update, longer
+    // gaps can differ from it in the last bit.
+    struct SparseElig {
+        std::vector<float> lam_pow; // lam_pow[d] = lambda^d
+        std::vector<int> last;      // last tick each source fired, -1 before its first spike
+
+        void reset(float lambda, int ticks, int neurons) {
+            lam_pow.assign(ticks + 2, 1.0f);
+            for (size_t d = 1; d < lam_pow.size(); ++d) lam_pow[d] = lam_pow[d - 1] * lambda;
+            last.assign(neurons, -1);
+        }
+        void fire(const EdgeIndex &edges, std::vector<float> &elig, int h, int t, const std::vector<float> &post) {
+            const float decay = lam_pow[t - last[h]];
+            const int *tgt = edges.targets.data();
+            float *e = elig.data();
+            for (int k = edges.row_offsets[h]; k < edges.row_offsets[h + 1]; ++k) e[k] = decay * e[k] + post[tgt[k]];
+            GLIA_PROF_COUNT(edges_touched, edges.row_offsets[h + 1] - edges.row_offsets[h]);
+            last[h] = t;
+        }
+        void finish(const EdgeIndex &edges, std::vector<float> &elig, int t_end) {
+            for (int h = 0; h < static_cast<int>(last.size()); ++h) {
+                if (last[h] < 0 || last[h] >= t_end) continue;
+                const float decay = lam_pow[t_end - last[h]];
+                for (int k = edges.row_offsets[h]; k < edges.row_offsets[h + 1]; ++k) elig[k] *= decay;
+            }
+        }
+    };
+
+    // Scratch for simulating episodes, kept by the trainer (one per worker thread) and
+    // reused so the steady-state episode loop doesn't allocate: buffers keep their
+    // capacity, and the detector and sequence copy are reset/assigned in place.
+    struct EpisodeWorkspace {
+        // one detector per OutputDetectorConfig::type; slots = the trainer's output_ids
+        EMASlotDetector ema;
+        WindowCountDetector count;
+        FirstSpikeDetector first_spike;
+        OutputDetectorConfig detector_cfg; // settings the detectors were built with
+        int detector_window = 0;
+        bool detector_built = false;
+        std::vector<uint8_t> fired; // per handle (+ the extra slot)
+        std::vector<uint64_t> fired_mask; // Glia::getFiredMask() (evaluate)
+        std::vector<float> post;
+        std::vector<float> rates;   // per-episode rates of a worker
+        SparseElig sparse;
+        std::vector<const InputSequence *> seqs; // a worker's chunk of the batch
+        prof::Stats profile;        // a worker thread's records, merged after the batch
+    };
+
+    // Edge order of every per-edge array below (deltas, usage, traces). trainBatch() and
+    // trainEpisode() refresh it; call refreshEdges() after changing the network yourself.
+    // The index is only rebuilt when Glia::getStructureVersion() says the edges changed
+    // since it was built or compacted (see commitStructure); otherwise its weights are
+    // re-read.
+    const EdgeIndex &edgeIndex() const { return edges; }
+    void refreshEdges() {
+        refreshNeurons();
+        const uint64_t version = glia.getStructureVersion();
+        if (version == edges_version && edges.numNeurons() == glia.getNeuronCount() && prune_counter.size() == edges.targets.size()) {
+            edges.syncWeights(glia);
+            return;
+        }
+        edges_next.build(glia);
+        if (!edges_next.sameTopology(edges) || prune_counter.size() != edges_next.targets.size()) remapEdgeState(edges, edges_next, prune_counter, 0);
+        if (edges_next.numNeurons() != edges.numNeurons() || neuron_rate.size() != static_cast<size_t>(edges_next.numNeurons()) + 1) neuron_rate.assign(edges_next.numNeurons() + 1, 0.0f);
+        std::swap(edges, edges_next);
+        edges_version = version;
+    }
+
     // Compute per-edge weight deltas for a single episode without mutating the network.
-    // Returns a map keyed by "FROM|TO" -> delta_w. Optionally emits EpisodeMetrics via out.
-    // Compute per-edge deltas for one episode. Reward policy is controlled by TrainingConfig.
-    std::unordered_map<std::string, float> computeEpisodeDelta(InputSequence &seq,
-                                                               const TrainingConfig &cfg,
-                                                               const std::string &target_id,
-                                                               EpisodeMetrics *out,
-                                                               std::unordered_map<std::string,float>* usage_out = nullptr) {
-        std::vector<std::string> output_ids = collectOutputIDs();
-        OutputDetectorOptions opts; opts.threshold = cfg.detector.threshold; opts.default_id = cfg.detector.default_id;
-        EMAOutputDetector detector(cfg.detector.alpha, opts);
-        detector.reset();
-        seq.reset();
+    // Returns delta_w per edge of edgeIndex(). Optionally emits EpisodeMetrics via out.
+    // Reward policy is controlled by TrainingConfig.
+    std::vector<float> computeEpisodeDelta(InputSequence &seq,
+                                           const TrainingConfig &cfg,
+                                           const std::string &target_id,
+                                           EpisodeMetrics *out,
+                                           std::vector<float>* usage_out = nullptr) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshNeurons();
+        runEpisode(seq, cfg, neuron_rate, seq_trace, ws);
+        if (out) *out = seq_trace.metrics;
+        std::vector<float> delta(edges.numEdges(), 0.0f);
+        deltaFromTrace(seq_trace, cfg, target_id, delta, usage_out);
+        return delta;
+    }
+
+    // Simulate one episode and accumulate eligibility traces, updating `rates` (the
+    // per-neuron EMA firing rates, by handle). If `replay` is given the spikes are read
+    // from lane `replay_lane` of a finished BatchedNetwork run instead of stepping the
+    // network; the network is then only read, so this may run on several threads at once.
+    // The sequence is only read (replayed from its start).
+    void runEpisode(const InputSequence &seq,
+                    const TrainingConfig &cfg,
+                    std::vector<float> &rates,
+                    EpisodeTrace &trace,
+                    EpisodeWorkspace &work,
+                    const BatchedNetwork *replay = nullptr,
+                    int replay_lane = 0) {
+        SlotDetector &detector = resetDetector(work, cfg);
+        SequenceCursor cursor(seq);
+        if (!replay) compileInputs(seq);
 
-        auto key_for = [](const std::string &a, const std::string &b){ return a + "|" + b; };
-        std::unordered_map<std::string, float> elig;
+        const int N = edges.numNeurons();
+        std::vector<float> &elig = trace.elig;
+        elig.assign(edges.numEdges(), 0.0f);
+        std::vector<uint8_t> &fired = work.fired;
+        std::vector<float> &post = work.post;
+        fired.assign(N + 1, 0);
+        post.assign(N + 1, 0.0f);
 
         const int U = cfg.warmup_ticks;
         const int W = cfg.decision_window;
+        SparseElig &sparse = work.sparse;
+        sparse.reset(cfg.elig_lambda, U + W, N);
 
         for (int t = 0; t < U + W; ++t) {
-            injectFromSequence(seq);
-            glia.step();
-
-            std::unordered_map<std::string, bool> fired;
-            glia.forEachNeuron([&](Neuron &n){
-                bool f = n.didFire();
-                fired[n.getId()] = f;
-                float r = neuron_rate[n.getId()];
-                neuron_rate[n.getId()] = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (f ? 1.0f : 0.0f);
-            });
+            if (replay) {
+                const uint8_t *replayed = replay->firedAt(replay_lane, t);
+                for (int h = 0; h < N; ++h) fired[h] = replayed[h];
+            } else {
+                injectAt(cursor.tick);
+                glia.step();
+                int slot = 0;
+                glia.forEachNeuron([&](Neuron &n){ fired[slot++] = n.didFire() ? 1 : 0; });
+            }
+            {
+                GLIA_PROF_SCOPE(Eligibility);
+                for (int h = 0; h < N; ++h)
+                    rates[h] = (1.0f - cfg.rate_alpha) * rates[h] + cfg.rate_alpha * (fired[h] ? 1.0f : 0.0f);
 
-            glia.forEachNeuron([&](Neuron &from){
-                const auto &conns = from.getConnections();
-                for (const auto &kv : conns) {
-                    const std::string &to_id = kv.first;
-                    float &e = elig[key_for(from.getId(), to_id)];
-                    float pre = fired[from.getId()] ? 1.0f : 0.0f;
-                    float post = cfg.elig_post_use_rate ? neuron_rate[to_id] : (fired[to_id] ? 1.0f : 0.0f);
-                    e = cfg.elig_lambda * e + pre * post;
-                }
-            });
+                // only the edges of sources that fired change beyond decay (pre = 1)
+                for (int h = 0; h < N; ++h) post[h] = cfg.elig_post_use_rate ? rates[h] : (fired[h] ? 1.0f : 0.0f);
+                for (int h = 0; h < N; ++h) if (fired[h]) sparse.fire(edges, elig, h, t, post);
+            }
 
-            updateDetector(detector, output_ids);
-            seq.advance();
+            {
+                GLIA_PROF_SCOPE(Detector);
+                if (t == U) detector.beginDecision();
+                detector.updateFromFlags(fired.data());
+            }
+            cursor.advance();
         }
+        sparse.finish(edges, elig, U + W - 1);
 
-        EpisodeMetrics m;
-        m.winner_id = detector.predict(output_ids);
-        m.margin = detector.getMargin(output_ids);
-        for (const auto &id : output_ids) m.rates[id] = detector.getRate(id);
+        EpisodeMetrics &m = trace.metrics;
+        m.winner_id = detector.winner();
+        m.margin = detector.margin();
+        fillRates(m, detector);
         m.ticks_run = U + W;
-        if (out) *out = m;
+    }
+
+    // Add an episode's per-edge deltas (aligned with edgeIndex()) to `delta`, and its
+    // eligibility to *usage_out. Updates the advantage baseline, so episodes must be
+    // passed in batch order.
+    void deltaFromTrace(const EpisodeTrace &trace,
+                        const TrainingConfig &cfg,
+                        const std::string &target_id,
+                        std::vector<float> &delta,
+                        std::vector<float>* usage_out = nullptr) {
+        GLIA_PROF_SCOPE(Delta);
+        GLIA_PROF_COUNT(edges_touched, edges.numEdges());
+        const EpisodeMetrics &m = trace.metrics;
 
         // Reward selection and shaping
         float reward_raw = computeReward(m, cfg, target_id);
@@ -144,233 +515,201 @@ public:
             reward = 0.0f;
         }
 
-        // Build delta map for existing edges only.
-        std::unordered_map<std::string, float> delta;
-        glia.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                const std::string &to_id = kv.first;
-                bool take = true;
-                if (cfg.update_gating == "winner_only") {
-                    if (!m.winner_id.empty()) take = (to_id == m.winner_id);
-                } else if (cfg.update_gating == "target_only") {
-                    take = (to_id == target_id);
-                }
-                if (!take) continue;
-                const std::string k = key_for(from.getId(), to_id);
-                float e = elig[k];
-                delta[k] += cfg.lr * reward * e;
-                if (usage_out) (*usage_out)[k] += e;
-            }
-        });
-
-        return delta;
+        // Deltas for the edges selected by update_gating; the rest are left alone.
+        const int gate = gatedTarget(cfg, m.winner_id, target_id);
+        delta.resize(edges.numEdges(), 0.0f);
+        if (usage_out) usage_out->resize(edges.numEdges(), 0.0f);
+        for (int k = 0; k < edges.numEdges(); ++k) {
+            if (gate != kAllEdges && edges.targets[k] != gate) continue;
+            const float e = trace.elig[k];
+            delta[k] += cfg.lr * reward * e;
+            if (usage_out) (*usage_out)[k] += e;
+        }
     }
 
-    // Apply accumulated per-edge deltas to the current network (scaled by `scale`),
-    // then apply weight decay.
-    void applyDeltas(const std::unordered_map<std::string, float> &delta,
+    // Apply accumulated per-edge deltas (aligned with edgeIndex()) to the current network
+    // (scaled by `scale`), then apply weight decay.
+    void applyDeltas(const std::vector<float> &delta,
                      float scale,
                      const TrainingConfig &cfg) {
-        auto key_for = [](const std::string &a, const std::string &b){ return a + "|" + b; };
-        glia.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                const std::string &to_id = kv.first;
-                const std::string k = key_for(from.getId(), to_id);
-                float w = kv.second.first;
-                auto it = delta.find(k);
-                if (it != delta.end()) {
-                    w += scale * it->second;
-                }
-                w -= cfg.weight_decay * w;
-                if (cfg.weight_clip > 0.0f) {
-                    float c = cfg.weight_clip;
-                    if (w > c) w = c; else if (w < -c) w = -c;
-                }
-                from.setTransmitter(to_id, w);
-            }
-        });
+        GLIA_PROF_SCOPE(Apply);
+        GLIA_PROF_COUNT(edges_touched, delta.size());
+        // the network's weights gathered into the index, one pass (see optimizer.h), stored back
+        edges.syncWeights(glia);
+        optim::addScaled(edges.weights.data(), delta.data(), edges.numEdges(), scale, cfg.weight_decay, cfg.weight_clip);
+        edges.storeWeights(glia);
     }
 
     // Train over a batch: accumulate per-episode deltas and apply once.
     void trainBatch(const std::vector<EpisodeData> &batch,
                     const TrainingConfig &cfg,
                     std::vector<EpisodeMetrics> *batch_metrics_out = nullptr) {
-        std::unordered_map<std::string, float> sum_delta;
-        std::unordered_map<std::string, float> sum_usage;
-        if (batch_metrics_out) batch_metrics_out->clear();
+        batch_items.resize(batch.size());
+        for (size_t b = 0; b < batch.size(); ++b) batch_items[b] = &batch[b];
+        trainBatch(batch_items.data(), batch_items.size(), cfg, batch_metrics_out);
+    }
+
+    // Same over episodes held elsewhere (e.g. an EpisodePipeline batch); they are only read.
+    void trainBatch(const EpisodeData *const *batch, size_t batch_size,
+                    const TrainingConfig &cfg,
+                    std::vector<EpisodeMetrics> *batch_metrics_out = nullptr) {
+        GLIA_PROF_BIND(&profile_stats);
+        refreshEdges();
+        const int E = edges.numEdges();
+        sum_delta.assign(E, 0.0f);
+        sum_usage.assign(E, 0.0f);
+        if (batch_metrics_out) batch_metrics_out->resize(batch_size);
         double sum_reward = 0.0;
-        for (const auto &item : batch) {
-            InputSequence seq = item.seq;
-            EpisodeMetrics m;
-            auto d = computeEpisodeDelta(seq, cfg, item.target_id, &m, &sum_usage);
-            for (const auto &kv : d) sum_delta[kv.first] += kv.second;
-            if (batch_metrics_out) batch_metrics_out->push_back(m);
+        // Lockstep/parallel: every episode starts from the batch-start state and rates;
+        // deltas are still reduced in batch order, so results don't depend on batch_threads.
+        const bool from_start = (cfg.lockstep_batch || cfg.device_batch || cfg.batch_threads > 1) && batch_size > 1 && runFromBatchStart(batch, batch_size, cfg, traces);
+        for (size_t b = 0; b < batch_size; ++b) {
+            const EpisodeData &item = *batch[b];
+            EpisodeTrace &trace = from_start ? traces[b] : seq_trace;
+            if (!from_start) runEpisode(item.seq, cfg, neuron_rate, trace, ws);
+            deltaFromTrace(trace, cfg, item.target_id, sum_delta, &sum_usage);
+            const EpisodeMetrics &m = trace.metrics;
+            if (batch_metrics_out) (*batch_metrics_out)[b] = m;
             sum_reward += static_cast<double>(computeReward(m, cfg, item.target_id));
         }
-        float scale = batch.empty() ? 1.0f : (1.0f / static_cast<float>(batch.size()));
+        float scale = batch_size == 0 ? 1.0f : (1.0f / static_cast<float>(batch_size));
         applyDeltas(sum_delta, scale, cfg);
 
-        if (cfg.usage_boost_gain != 0.0f && !batch.empty()) {
-            float avg_reward = static_cast<float>(sum_reward / static_cast<double>(batch.size()));
+        if (cfg.usage_boost_gain != 0.0f && batch_size > 0) {
+            GLIA_PROF_SCOPE(Apply);
+            float avg_reward = static_cast<float>(sum_reward / static_cast<double>(batch_size));
+            // edges.weights are current after applyDeltas()
+            for (int k = 0; k < E; ++k) {
+                float usage = sum_usage[k] / static_cast<float>(batch_size);
+                if (usage < 0.0f) usage = 0.0f;
+                if (usage > 1.0f) usage = 1.0f;
+                edges.weights[k] += cfg.usage_boost_gain * avg_reward * usage;
+            }
+            edges.storeWeights(glia);
+        }
+
+        // Prune/grow after batch; update prune counters and queue structural ops on the
+        // edge index (applied with the inactivity pruning below, in commitStructure()).
+        {
+            GLIA_PROF_SCOPE(PruneGrow);
+            structural.begin(glia, edges, neuron_keys);
+            int k = 0;
             glia.forEachNeuron([&](Neuron &from){
                 const auto &conns = from.getConnections();
                 for (const auto &kv : conns) {
-                    const std::string k = from.getId() + std::string("|") + kv.first;
-                    float usage = 0.0f;
-                    auto it = sum_usage.find(k);
-                    if (it != sum_usage.end()) usage = it->second / static_cast<float>(batch.size());
-                    if (usage < 0.0f) usage = 0.0f;
-                    if (usage > 1.0f) usage = 1.0f;
+                    const int ek = k++;
+                    int &c = prune_counter[ek];
                     float w = kv.second.first;
-                    w += cfg.usage_boost_gain * avg_reward * usage;
-                    from.setTransmitter(kv.first, w);
+                    edges.weights[ek] = w;
+                    if (std::fabs(w) < cfg.prune_epsilon) {
+                        c = c + 1;
+                        if (c >= cfg.prune_patience) structural.prune(ek);
+                    } else {
+                        c = 0;
+                    }
                 }
             });
-        }
-
-        // Prune/grow after batch; update prune counters and perform structural ops.
-        std::vector<std::pair<std::string,std::string>> to_remove;
-        auto key_for = [](const std::string &a, const std::string &b){ return a + "|" + b; };
-        glia.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                const std::string &to_id = kv.first;
-                const std::string k = key_for(from.getId(), to_id);
-                float w = kv.second.first;
-                if (std::fabs(w) < cfg.prune_epsilon) {
-                    int c = prune_counter[k];
-                    prune_counter[k] = c + 1;
-                    if (prune_counter[k] >= cfg.prune_patience) to_remove.emplace_back(from.getId(), to_id);
-                } else {
-                    prune_counter[k] = 0;
-                }
-            }
-        });
-        for (auto &edge : to_remove) {
-            auto from = glia.getNeuronById(edge.first);
-            if (from) from->removeConnection(edge.second);
-        }
-
-        if (cfg.grow_edges > 0) {
-            std::vector<std::string> all_ids = collectAllIDs();
-            std::uniform_int_distribution<size_t> dist_idx(0, all_ids.size() ? all_ids.size() - 1 : 0);
-            std::uniform_real_distribution<float> dist_sign(-1.0f, 1.0f);
-            int grown = 0;
-            int attempts = 0;
-            while (grown < cfg.grow_edges && attempts < cfg.grow_edges * 20) {
-                attempts++;
-                const std::string &from_id = all_ids[dist_idx(rng)];
-                const std::string &to_id = all_ids[dist_idx(rng)];
-                if (!cfg.topology.edgeAllowed(from_id, to_id)) continue;
-                if (from_id == to_id) continue;
-                auto from = glia.getNeuronById(from_id);
-                auto to = glia.getNeuronById(to_id);
-                if (!from || !to) continue;
-                const auto &conns = from->getConnections();
-                if (conns.find(to_id) != conns.end()) continue;
-                float w = cfg.init_weight * (dist_sign(rng) >= 0 ? 1.0f : -1.0f);
-                from->addConnection(w, to);
-                grown++;
-            }
+            growEdges(cfg);
         }
 
         // Intrinsic plasticity after batch using EMA rates tracked during episodes.
-        glia.forEachNeuron([&](Neuron &n){
-            float r = neuron_rate[n.getId()];
-            if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target));
-            if (cfg.eta_leak != 0.0f) {
-                float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r);
-                if (new_leak < 0.0f) new_leak = 0.0f;
-                if (new_leak > 1.0f) new_leak = 1.0f;
-                n.setLeak(new_leak);
-            }
-        });
-
-        if (cfg.inactive_rate_threshold > 0.0f && cfg.inactive_rate_patience > 0 && cfg.prune_inactive_max > 0) {
-            std::vector<std::pair<std::string,std::string>> to_remove_in;
-            std::vector<std::pair<std::string,std::string>> to_remove_out;
+        {
+            GLIA_PROF_SCOPE(Plasticity);
+            int h = 0;
             glia.forEachNeuron([&](Neuron &n){
-                const std::string id = n.getId();
-                float r = neuron_rate[id];
-                int &ctr = inactive_counter[id];
-                if (r < cfg.inactive_rate_threshold) ctr++; else ctr = 0;
-                if (ctr >= cfg.inactive_rate_patience) {
-                    if (cfg.prune_inactive_out) {
-                        const auto &conns = n.getConnections();
-                        std::vector<std::pair<std::string,float>> outs;
-                        for (const auto &kv : conns) outs.emplace_back(kv.first, kv.second.first);
-                        std::sort(outs.begin(), outs.end(), [](const std::pair<std::string,float> &a, const std::pair<std::string,float> &b){
-                            return std::fabs(a.second) < std::fabs(b.second);
-                        });
-                        int c = 0;
-                        for (auto &p : outs) { if (c++ >= cfg.prune_inactive_max) break; to_remove_out.emplace_back(id, p.first); }
-                    }
-                    if (cfg.prune_inactive_in) {
-                        std::vector<std::pair<std::string,float>> ins;
-                        glia.forEachNeuron([&](Neuron &from){
-                            const auto &conns = from.getConnections();
-                            auto it = conns.find(id);
-                            if (it != conns.end()) ins.emplace_back(from.getId(), it->second.first);
-                        });
-                        std::sort(ins.begin(), ins.end(), [](const std::pair<std::string,float> &a, const std::pair<std::string,float> &b){
-                            return std::fabs(a.second) < std::fabs(b.second);
-                        });
-                        int c = 0;
-                        for (auto &p : ins) { if (c++ >= cfg.prune_inactive_max) break; to_remove_in.emplace_back(p.first, id); }
-                    }
-                    ctr = 0; // reset after pruning trigger
+                float r = neuron_rate[h++];
+                if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target));
+                if (cfg.eta_leak != 0.0f) {
+                    float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r);
+                    if (new_leak < 0.0f) new_leak = 0.0f;
+                    if (new_leak > 1.0f) new_leak = 1.0f;
+                    n.setLeak(new_leak);
                 }
             });
-            for (auto &edge : to_remove_out) { auto from = glia.getNeuronById(edge.first); if (from) from->removeConnection(edge.second); }
-            for (auto &edge : to_remove_in) { auto from = glia.getNeuronById(edge.first); if (from) from->removeConnection(edge.second); }
+
+            // weakest edges out of / into neurons inactive for too long, from the index
+            // (edges into h via its inbound rows, not a scan of the network)
+            if (cfg.inactive_rate_threshold > 0.0f && cfg.inactive_rate_patience > 0 && cfg.prune_inactive_max > 0) {
+                for (h = 0; h < edges.numNeurons(); ++h) {
+                    int &ctr = inactive_counter[h];
+                    if (neuron_rate[h] < cfg.inactive_rate_threshold) ctr++; else ctr = 0;
+                    if (ctr >= cfg.inactive_rate_patience) {
+                        if (cfg.prune_inactive_out) structural.pruneWeakestOut(h, cfg.prune_inactive_max);
+                        if (cfg.prune_inactive_in) structural.pruneWeakestIn(h, cfg.prune_inactive_max);
+                        ctr = 0; // reset after pruning trigger
+                    }
+                }
+            }
+        }
+        {
+            GLIA_PROF_SCOPE(PruneGrow);
+            commitStructure();
         }
     }
 
     // Train for E epochs over the dataset, with optional shuffle and batching per config.
-    void trainEpoch(std::vector<EpisodeData> dataset, int epochs, const TrainingConfig &cfg) {
-        if (dataset.empty() || epochs <= 0) return;
+    void trainEpoch(const std::vector<EpisodeData> &dataset, int epochs, const TrainingConfig &cfg) {
+        VectorSource source(dataset);
+        trainEpoch(source, epochs, cfg);
+    }
+
+    // Same over any EpisodeSource. Episodes are shuffled by index and batches come from an
+    // EpisodePipeline (cfg.prefetch_batches ahead, with cfg.timing_jitter applied), so an
+    // in-memory dataset is never copied and a loaded one needn't fit in memory.
+    void trainEpoch(EpisodeSource &source, int epochs, const TrainingConfig &cfg) {
+        if (source.size() == 0 || epochs <= 0) return;
+        GLIA_PROF_BIND(&profile_stats);
         if (cfg.weight_jitter_std > 0.0f) {
-            std::normal_distribution<float> nd(0.0f, cfg.weight_jitter_std);
+            // row r draws from the stream (seed, WeightJitter, epoch, r)
+            uint64_t row = 0;
             glia.forEachNeuron([&](Neuron &from){
+                rstream::Stream g(rstream::key(seed, rstream::WeightJitter, epochsCompleted(), row++));
                 const auto &conns = from.getConnections();
                 for (const auto &kv : conns) {
                     float w = kv.second.first;
-                    w += nd(rng);
+                    w += g.normal(0.0f, cfg.weight_jitter_std);
                     from.setTransmitter(kv.first, w);
                 }
             });
         }
-        std::uniform_int_distribution<size_t> dist(0, dataset.size() - 1);
+        std::vector<size_t> &order = episode_order;
+        const size_t batch_size = static_cast<size_t>(std::max(1, cfg.batch_size));
+        EpisodePipeline pipeline(source, cfg.prefetch_batches);
         for (int e = 0; e < epochs; ++e) {
-            if (cfg.shuffle) {
-                std::shuffle(dataset.begin(), dataset.end(), rng);
-            }
+            const uint64_t epoch = static_cast<uint64_t>(epochsCompleted());
+            epochOrder(order, source.size(), cfg.shuffle, seed, epoch);
+            source.beginEpoch(epoch);
+            pipeline.start(order, batch_size, cfg.timing_jitter, rstream::key(seed, rstream::TimingJitter, epoch));
+            prof::flush();
+            const prof::Stats epoch_start = profile_stats;
+            const auto epoch_t0 = std::chrono::steady_clock::now();
+            const uint64_t grown0 = structural.grownTotal(), pruned0 = structural.prunedTotal();
             size_t epoch_total = 0;
             size_t epoch_correct = 0;
             double epoch_margin_sum = 0.0;
-            for (size_t i = 0; i < dataset.size(); i += std::max(1, cfg.batch_size)) {
-                size_t j = std::min(dataset.size(), i + static_cast<size_t>(std::max(1, cfg.batch_size)));
-                std::vector<EpisodeData> batch(dataset.begin() + i, dataset.begin() + j);
-                std::vector<EpisodeMetrics> bm;
-                trainBatch(batch, cfg, &bm);
-                if (cfg.verbose && cfg.log_every > 0 && ((e + 1) % cfg.log_every == 0)) {
+            EpisodePipeline::Batch batch;
+            std::vector<EpisodeMetrics> bm;
+            while (pipeline.next(batch)) {
+                trainBatch(batch.items, batch.size, cfg, &bm);
+                // with a telemetry sink, batch progress goes to it instead of the console
+                const bool log_batch = cfg.verbose && cfg.log_every > 0 && ((e + 1) % cfg.log_every == 0);
+                if (log_batch || telemetry_sink) {
                     int correct = 0;
                     double avg_margin = 0.0;
                     for (size_t k = 0; k < bm.size(); ++k) {
                         avg_margin += bm[k].margin;
-                        if (k < batch.size() && bm[k].winner_id == batch[k].target_id) correct++;
+                        if (k < batch.size && bm[k].winner_id == batch[k].target_id) correct++;
                     }
                     if (!bm.empty()) avg_margin /= static_cast<double>(bm.size());
-                    std::cout << "Epoch " << (e + 1) << "/" << epochs
-                              << "  Batch " << (i / std::max(1, cfg.batch_size) + 1) << "/"
-                              << ((dataset.size() + std::max(1, cfg.batch_size) - 1) / std::max(1, cfg.batch_size))
-                              << "  Acc=" << (bm.empty() ? 0.0 : (static_cast<double>(correct) / bm.size()))
+                    const double batch_acc = bm.empty() ? 0.0 : static_cast<double>(correct) / static_cast<double>(bm.size());
+                    if (telemetry_sink) telemetry_sink->emit(telemetry::batchRecord(static_cast<int>(epoch) + 1, static_cast<int>(batch.index) + 1, static_cast<int>(bm.size()), batch_acc, avg_margin));
+                    else std::cout << "Epoch " << (e + 1) << "/" << epochs
+                              << "  Batch " << (batch.index + 1) << "/" << pipeline.batches()
+                              << "  Acc=" << batch_acc
                               << "  AvgMargin=" << avg_margin
                               << std::endl;
                 }
-                for (size_t k = 0; k < bm.size() && k < batch.size(); ++k) {
+                for (size_t k = 0; k < bm.size() && k < batch.size; ++k) {
                     epoch_total += 1;
                     if (bm[k].winner_id == batch[k].target_id) epoch_correct += 1;
                     epoch_margin_sum += static_cast<double>(bm[k].margin);
@@ -380,7 +719,7 @@ public:
             double epoch_margin = (epoch_total == 0) ? 0.0 : (epoch_margin_sum / static_cast<double>(epoch_total));
             epoch_acc_hist.push_back(epoch_acc);
             epoch_margin_hist.push_back(epoch_margin);
-            if (cfg.checkpoints_enable) onEpochEndCapture(cfg);
+            if (cfg.checkpoints_enable) { GLIA_PROF_SCOPE(Checkpoint); onEpochEndCapture(cfg); }
             if (cfg.revert_enable) {
                 if (cfg.revert_metric == "accuracy") {
                     int w = std::max(1, cfg.revert_window);
@@ -402,53 +741,76 @@ public:
                     }
                 }
             }
+            if (!cfg.checkpoint_path.empty() && cfg.checkpoint_every > 0 && epochsCompleted() % cfg.checkpoint_every == 0) {
+                GLIA_PROF_SCOPE(Checkpoint);
+                ckpt::Writer w(checkpointKind());
+                saveState(w);
+                checkpoint_writer.submit(cfg.checkpoint_path, w.release());
+            }
+            if (telemetry_sink) {
+                prof::flush();
+                const prof::Stats d = profile_stats.since(epoch_start);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_t0).count();
+                telemetry_sink->emit(telemetry::epochRecord(epochsCompleted(), epoch_acc, epoch_margin, seconds, d,
+                                                            structural.grownTotal() - grown0, structural.prunedTotal() - pruned0, edges.numEdges()));
+                telemetry::emitPhases(*telemetry_sink, epochsCompleted(), d);
+            }
+            if (cfg.verbose && prof::enabled()) {
+                prof::flush();
+                std::cout << "Epoch " << (e + 1) << "/" << epochs << "  Profile: " << profile_stats.since(epoch_start).summary() << std::endl;
+            }
         }
+        if (telemetry_sink) telemetry_sink->flush();
     }
 
     EpisodeMetrics trainEpisode(InputSequence &seq, const TrainingConfig &cfg, const std::string &target_id) {
-        std::vector<std::string> output_ids = collectOutputIDs();
-        OutputDetectorOptions opts; opts.threshold = cfg.detector.threshold; opts.default_id = cfg.detector.default_id;
-        EMAOutputDetector detector(cfg.detector.alpha, opts);
-        detector.reset();
+        GLIA_PROF_BIND(&profile_stats);
+        refreshEdges();
+        SlotDetector &detector = resetDetector(ws, cfg);
         seq.reset();
+        compileInputs(seq);
 
-        std::unordered_map<std::string, float> elig;
-        auto key_for = [](const std::string &a, const std::string &b){ return a + "|" + b; };
+        const int N = edges.numNeurons();
+        std::vector<float> &elig = seq_trace.elig;
+        elig.assign(edges.numEdges(), 0.0f);
+        std::vector<uint8_t> &fired = ws.fired;
+        std::vector<float> &post = ws.post;
+        fired.assign(N + 1, 0);
+        post.assign(N + 1, 0.0f);
 
         const int U = cfg.warmup_ticks;
         const int W = cfg.decision_window;
+        SparseElig &sparse = ws.sparse;
+        sparse.reset(cfg.elig_lambda, U + W, N);
 
         for (int t = 0; t < U + W; ++t) {
             injectFromSequence(seq);
             glia.step();
 
-            std::unordered_map<std::string, bool> fired;
-            glia.forEachNeuron([&](Neuron &n){
-                bool f = n.didFire();
-                fired[n.getId()] = f;
-                float r = neuron_rate[n.getId()];
-                neuron_rate[n.getId()] = (1.0f - cfg.rate_alpha) * r + cfg.rate_alpha * (f ? 1.0f : 0.0f);
-            });
+            int slot = 0;
+            glia.forEachNeuron([&](Neuron &n){ fired[slot++] = n.didFire() ? 1 : 0; });
+            {
+                GLIA_PROF_SCOPE(Eligibility);
+                for (int h = 0; h < N; ++h)
+                    neuron_rate[h] = (1.0f - cfg.rate_alpha) * neuron_rate[h] + cfg.rate_alpha * (fired[h] ? 1.0f : 0.0f);
 
-            glia.forEachNeuron([&](Neuron &from){
-                const auto &conns = from.getConnections();
-                for (const auto &kv : conns) {
-                    const std::string &to_id = kv.first;
-                    float &e = elig[key_for(from.getId(), to_id)];
-                    float pre = fired[from.getId()] ? 1.0f : 0.0f;
-                    float post = cfg.elig_post_use_rate ? neuron_rate[to_id] : (fired[to_id] ? 1.0f : 0.0f);
-                    e = cfg.elig_lambda * e + pre * post;
-                }
-            });
+                for (int h = 0; h < N; ++h) post[h] = cfg.elig_post_use_rate ? neuron_rate[h] : (fired[h] ? 1.0f : 0.0f);
+                for (int h = 0; h < N; ++h) if (fired[h]) sparse.fire(edges, elig, h, t, post);
+            }
 
-            updateDetector(detector, output_ids);
+            {
+                GLIA_PROF_SCOPE(Detector);
+                if (t == U) detector.beginDecision();
+                detector.updateFromFlags(fired.data());
+            }
             seq.advance();
         }
+        sparse.finish(edges, elig, U + W - 1);
 
         EpisodeMetrics m;
-        m.winner_id = detector.predict(output_ids);
-        m.margin = detector.getMargin(output_ids);
-        for (const auto &id : output_ids) m.rates[id] = detector.getRate(id);
+        m.winner_id = detector.winner();
+        m.margin = detector.margin();
+        fillRates(m, detector);
         m.ticks_run = U + W;
 
         float reward_raw = computeReward(m, cfg, target_id);
@@ -462,198 +824,203 @@ public:
             reward = 0.0f;
         }
 
-        std::vector<std::pair<std::string,std::string>> to_remove;
-        glia.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                const std::string &to_id = kv.first;
-                bool take = true;
-                if (cfg.update_gating == "winner_only") {
-                    if (!m.winner_id.empty()) take = (to_id == m.winner_id);
-                } else if (cfg.update_gating == "target_only") {
-                    take = (to_id == target_id);
-                }
-                if (!take) continue;
-                std::string k = key_for(from.getId(), to_id);
-                float w = kv.second.first;
-                float e = elig[k];
-                w += cfg.lr * reward * e;
-                w -= cfg.weight_decay * w;
-                if (cfg.weight_clip > 0.0f) {
-                    float c = cfg.weight_clip;
-                    if (w > c) w = c; else if (w < -c) w = -c;
-                }
-                from.setTransmitter(to_id, w);
-                if (std::fabs(w) < cfg.prune_epsilon) {
-                    int c = prune_counter[k];
-                    prune_counter[k] = c + 1;
-                    if (prune_counter[k] >= cfg.prune_patience) to_remove.emplace_back(from.getId(), to_id);
-                } else {
-                    prune_counter[k] = 0;
+        {
+            GLIA_PROF_SCOPE(Apply);
+            structural.begin(glia, edges, neuron_keys);
+            const int gate = gatedTarget(cfg, m.winner_id, target_id);
+            int k = 0;
+            glia.forEachNeuron([&](Neuron &from){
+                const auto &conns = from.getConnections();
+                for (const auto &kv : conns) {
+                    const nid::Key to = kv.first;
+                    const int ek = k++;
+                    if (gate != kAllEdges && edges.targets[ek] != gate) continue;
+                    float w = kv.second.first;
+                    float e = elig[ek];
+                    w += cfg.lr * reward * e;
+                    w -= cfg.weight_decay * w;
+                    if (cfg.weight_clip > 0.0f) {
+                        float c = cfg.weight_clip;
+                        if (w > c) w = c; else if (w < -c) w = -c;
+                    }
+                    from.setTransmitter(to, w);
+                    edges.weights[ek] = w;
+                    int &c = prune_counter[ek];
+                    if (std::fabs(w) < cfg.prune_epsilon) {
+                        c = c + 1;
+                        if (c >= cfg.prune_patience) structural.prune(ek);
+                    } else {
+                        c = 0;
+                    }
                 }
-            }
-        });
+            });
+        }
 
-        for (auto &edge : to_remove) {
-            auto from = glia.getNeuronById(edge.first);
-            if (from) from->removeConnection(edge.second);
-        }
-
-        if (cfg.grow_edges > 0) {
-            std::vector<std::string> all_ids = collectAllIDs();
-            std::uniform_int_distribution<size_t> dist_idx(0, all_ids.size() ? all_ids.size() - 1 : 0);
-            std::uniform_real_distribution<float> dist_sign(-1.0f, 1.0f);
-            int grown = 0;
-            int attempts = 0;
-            while (grown < cfg.grow_edges && attempts < cfg.grow_edges * 20) {
-                attempts++;
-                const std::string &from_id = all_ids[dist_idx(rng)];
-                const std::string &to_id = all_ids[dist_idx(rng)];
-                if (!cfg.topology.edgeAllowed(from_id, to_id)) continue;
-                if (from_id == to_id) continue;
-                auto from = glia.getNeuronById(from_id);
-                auto to = glia.getNeuronById(to_id);
-                if (!from || !to) continue;
-                const auto &conns = from->getConnections();
-                if (conns.find(to_id) != conns.end()) continue;
-                float w = cfg.init_weight * (dist_sign(rng) >= 0 ? 1.0f : -1.0f);
-                from->addConnection(w, to);
-                grown++;
-            }
+        {
+            GLIA_PROF_SCOPE(PruneGrow);
+            growEdges(cfg);
+            commitStructure();
         }
 
-        glia.forEachNeuron([&](Neuron &n){
-            float r = neuron_rate[n.getId()];
-            if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target));
-            if (cfg.eta_leak != 0.0f) {
-                float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r);
-                if (new_leak < 0.0f) new_leak = 0.0f;
-                if (new_leak > 1.0f) new_leak = 1.0f;
-                n.setLeak(new_leak);
-            }
-        });
+        {
+            GLIA_PROF_SCOPE(Plasticity);
+            int h = 0;
+            glia.forEachNeuron([&](Neuron &n){
+                float r = neuron_rate[h++];
+                if (cfg.eta_theta != 0.0f) n.setThreshold(n.getThreshold() + cfg.eta_theta * (r - cfg.r_target));
+                if (cfg.eta_leak != 0.0f) {
+                    float new_leak = n.getLeak() + cfg.eta_leak * (cfg.r_target - r);
+                    if (new_leak < 0.0f) new_leak = 0.0f;
+                    if (new_leak > 1.0f) new_leak = 1.0f;
+                    n.setLeak(new_leak);
+                }
+            });
+        }
 
         return m;
     }
 
 private:
     Glia &glia;
-    std::unordered_map<std::string, float> neuron_rate;
-    std::map<std::string, int> prune_counter;
-    std::unordered_map<std::string, int> inactive_counter;
-    std::mt19937 rng;
+    EdgeIndex edges;                       // order of the per-edge arrays (see refreshEdges)
+    EdgeIndex edges_next;                  // rebuild scratch, swapped with `edges`
+    std::vector<float> neuron_rate;        // EMA firing rate by handle (+ the extra slot)
+    std::vector<int> prune_counter;        // per edge
+
+    // per-network caches (see refreshNeurons), stale once neurons are added or reordered
+    uint64_t cached_neuron_order = ~0ull;  // glia.getNeuronOrderVersion() they are current for
+    int cached_neuron_count = -1;
+    std::vector<nid::Key> neuron_keys;     // interned IDs by handle
+    std::vector<std::string> sensory_ids;  // IDs of the first getSensoryCount() handles
+    std::vector<std::string> output_ids;   // O* neurons in tick order
+    std::vector<int> output_handles;
+
+    // reused across episodes and batches
+    EpisodeWorkspace ws;
+    std::vector<EpisodeWorkspace> worker_ws;  // workers 1.. of runFromBatchStart
+    EpisodeTrace seq_trace;                   // trace of the sequential path
+    std::vector<EpisodeTrace> traces;         // per batch item (lockstep/parallel)
+    std::vector<const EpisodeData *> batch_items; // trainBatch(vector) view
+    std::vector<float> sum_delta;
+    std::vector<float> sum_usage;
+    StructuralPlasticity structural;       // prune/grow pass over `edges`
+    std::vector<int> edge_from;            // commitStructure(): old edge of each compacted one
+    uint64_t edges_version = ~0ull;        // glia.getStructureVersion() `edges` is current for
+    std::vector<int> inactive_counter;     // by handle: batches in a row below inactive_rate_threshold
+    uint64_t seed = 123456u;               // of the random streams (see reseed())
+    uint64_t structure_passes = 0;         // growEdges() calls, keying their streams
     std::vector<double> epoch_acc_hist;
     std::vector<double> epoch_margin_hist;
+    std::vector<size_t> episode_order;     // trainEpoch()'s episode indices of the epoch
     float reward_baseline = 0.0f;
+    std::vector<BatchedNetwork> lane_nets; // one per worker for lockstep/parallel batches
+    CompiledInputSequence episode_inputs;  // inputs of the episode being simulated
+    int next_input = -1;                   // silentTicks(): first input tick at or after the last query
+    bool last_step_fired = false;          // the last step (updateDetectorFromStep()) had spikes
 
-    struct EdgeRec { std::string from; std::string to; float w; };
-    struct NeuronRec { std::string id; float thr; float leak; };
-    struct Snapshot { std::vector<NeuronRec> neurons; std::vector<EdgeRec> edges; };
+    typedef NetworkSnapshot Snapshot;
     std::vector<Snapshot> ckpt_l0; // most recent level
     std::vector<Snapshot> ckpt_l1; // mid level
     std::vector<Snapshot> ckpt_l2; // oldest level
+    ckpt::AsyncWriter checkpoint_writer; // on-disk checkpoints of trainEpoch()
+    prof::Stats profile_stats;           // see profile()
+    std::shared_ptr<ThreadPool> thread_pool, owned_pool; // see setThreadPool()
+    std::shared_ptr<telemetry::Sink> telemetry_sink;    // see setTelemetry()
 
-    // Compute target-specific margin: rate[target] - max(rate[others])
-    static inline float targetMargin(const std::map<std::string,float> &rates, const std::string &target_id) {
-        auto itT = rates.find(target_id);
-        float rT = (itT != rates.end()) ? itT->second : 0.0f;
-        float rMaxOther = 0.0f;
-        bool init = false;
-        for (const auto &kv : rates) {
-            if (kv.first == target_id) continue;
-            if (!init) { rMaxOther = kv.second; init = true; }
-            else if (kv.second > rMaxOther) rMaxOther = kv.second;
+    // queue up to cfg.grow_edges random new edges on the structural pass; candidates are
+    // drawn as handles and skipped if the topology disallows them or they exist
+    void growEdges(const TrainingConfig &cfg) {
+        const uint64_t pass = structure_passes++;
+        if (cfg.grow_edges <= 0 || neuron_keys.empty()) return;
+        rstream::Stream rng(rstream::key(seed, rstream::GrowEdges, pass));
+        const uint32_t n = static_cast<uint32_t>(neuron_keys.size());
+        int grown = 0;
+        int attempts = 0;
+        while (grown < cfg.grow_edges && attempts < cfg.grow_edges * 20) {
+            attempts++;
+            const int from = static_cast<int>(rng.below(n));
+            const int to = static_cast<int>(rng.below(n));
+            if (!cfg.topology.edgeAllowed(nid::name(neuron_keys[from]), nid::name(neuron_keys[to]))) continue;
+            if (from == to || structural.exists(from, to)) continue;
+            float w = cfg.init_weight * (rng.coin() ? 1.0f : -1.0f);
+            structural.grow(from, to, w);
+            grown++;
         }
-        return rT - rMaxOther;
     }
 
-    // Choose reward per config. Modes:
-    //  - "binary": +reward_pos if (winner==target && margin>=delta) else reward_neg
-    //  - "margin_linear": clamp(gain * target_margin, [reward_min, reward_max])
-    //  - "softplus_margin": sigma(gain * (delta - target_margin)) in [0,1]
-    static inline float computeReward(const EpisodeMetrics &m, const TrainingConfig &cfg, const std::string &target_id) {
-        if (cfg.reward_mode == "margin_linear") {
-            float tm = targetMargin(m.rates, target_id);
-            float r = cfg.reward_gain * tm;
-            if (r < cfg.reward_min) r = cfg.reward_min;
-            if (r > cfg.reward_max) r = cfg.reward_max;
-            return r;
-        }
-        if (cfg.reward_mode == "softplus_margin") {
-            float tm = targetMargin(m.rates, target_id);
-            float x = cfg.reward_gain * (cfg.margin_delta - tm);
-            float r = 1.0f / (1.0f + std::exp(-x));
-            if (cfg.reward_min < cfg.reward_max) {
-                if (r < cfg.reward_min) r = cfg.reward_min;
-                if (r > cfg.reward_max) r = cfg.reward_max;
-            }
-            return r;
+    // apply the structural pass to the network; the index is compacted instead of rebuilt,
+    // so it stays current and the next refreshEdges() only re-reads weights
+    void commitStructure() {
+        if (!structural.commit(glia, edges_next, edge_from)) return;
+        remapEdgeState(edge_from, prune_counter, 0);
+        std::swap(edges, edges_next);
+        edges_version = glia.getStructureVersion();
+    }
+
+    // rebuild the neuron ID caches if neurons were added or reordered since the last call
+    void refreshNeurons() {
+        if (glia.getNeuronCount() == cached_neuron_count && glia.getNeuronOrderVersion() == cached_neuron_order) return;
+        cached_neuron_count = glia.getNeuronCount();
+        cached_neuron_order = glia.getNeuronOrderVersion();
+        std::vector<nid::Key> keys = glia.getAllNeuronKeys();
+        // rates and inactivity counters follow their neuron to its new handle; per-edge
+        // state is keyed by the old handles, so the next refreshEdges() starts it over
+        remapNeuronState(neuron_keys, keys, neuron_rate, 0.0f, 1);
+        remapNeuronState(neuron_keys, keys, inactive_counter, 0);
+        if (keys != neuron_keys) prune_counter.clear();
+        neuron_keys.swap(keys);
+        sensory_ids.clear();
+        for (int h = 0; h < glia.getSensoryCount(); ++h) sensory_ids.push_back(nid::name(neuron_keys[h]));
+        output_ids.clear();
+        output_handles.clear();
+        for (size_t h = 0; h < neuron_keys.size(); ++h) {
+            const std::string &id = nid::name(neuron_keys[h]);
+            if (!id.empty() && id[0] == 'O') { output_ids.push_back(id); output_handles.push_back(static_cast<int>(h)); }
         }
-        if (m.winner_id == target_id && m.margin >= cfg.margin_delta) return cfg.reward_pos;
-        return cfg.reward_neg;
     }
 
-    std::vector<std::string> collectOutputIDs() {
-        std::vector<std::string> ids;
-        glia.forEachNeuron([&](Neuron &n){
-            const std::string &id = n.getId();
-            if (!id.empty() && id[0] == 'O') ids.push_back(id);
-        });
-        return ids;
+    // evaluate()'s early exit after decision tick t of W: the winner can't change any more,
+    // or leads by early_exit_margin
+    static bool decisionSettled(const SlotDetector &detector, const OutputDetectorConfig &dc, int t, int W) {
+        return dc.early_exit && t + 1 < W && (detector.decided(W - t - 1) || (dc.early_exit_margin > 0.0f && detector.margin() >= dc.early_exit_margin));
     }
 
-    std::vector<std::string> collectAllIDs() {
-        std::vector<std::string> ids;
-        glia.forEachNeuron([&](Neuron &n){ ids.push_back(n.getId()); });
-        return ids;
+    // the workspace's detector for cfg.detector.type, reset for an episode (rebuilt only if
+    // the settings or the outputs changed)
+    SlotDetector &resetDetector(EpisodeWorkspace &work, const TrainingConfig &cfg) const {
+        const OutputDetectorConfig &d = cfg.detector;
+        const int window = d.window > 0 ? d.window : cfg.decision_window;
+        if (!work.detector_built || work.detector_cfg.alpha != d.alpha || work.detector_cfg.threshold != d.threshold || work.detector_cfg.default_id != d.default_id || work.detector_window != window) {
+            OutputDetectorOptions opts; opts.threshold = d.threshold; opts.default_id = d.default_id;
+            work.ema = EMASlotDetector(d.alpha, opts);
+            work.count = WindowCountDetector(window, opts);
+            work.first_spike = FirstSpikeDetector(window, opts);
+            work.detector_cfg = d;
+            work.detector_window = window;
+            work.detector_built = true;
+        }
+        SlotDetector &det = d.type == "count" ? static_cast<SlotDetector &>(work.count)
+                          : d.type == "first_spike" ? static_cast<SlotDetector &>(work.first_spike)
+                          : static_cast<SlotDetector &>(work.ema);
+        if (det.outputHandles() != output_handles || det.outputIds() != output_ids) det.setOutputs(output_ids, output_handles);
+        det.reset();
+        return det;
+    }
+
+    // m.rates = the detector's output rates, reusing the map's nodes when the keys match
+    void fillRates(EpisodeMetrics &m, const SlotDetector &detector) const {
+        if (m.rates.size() != output_ids.size()) m.rates.clear();
+        for (size_t i = 0; i < output_ids.size(); ++i) m.rates[output_ids[i]] = detector.rate(static_cast<int>(i));
     }
 
+    // against the latest checkpoint, so an unchanged topology is shared with it
     Snapshot captureSnapshot() {
-        Snapshot s;
-        glia.forEachNeuron([&](Neuron &n){
-            NeuronRec r{n.getId(), n.getThreshold(), n.getLeak()};
-            s.neurons.push_back(r);
-        });
-        glia.forEachNeuron([&](Neuron &from){
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                s.edges.push_back(EdgeRec{from.getId(), kv.first, kv.second.first});
-            }
-        });
-        return s;
-    }
-
-    void restoreSnapshot(const Snapshot &s) {
-        // Remove edges not in snapshot
-        std::unordered_map<std::string, std::unordered_map<std::string,float>> edge_set;
-        for (const auto &e : s.edges) edge_set[e.from][e.to] = e.w;
-        glia.forEachNeuron([&](Neuron &from){
-            std::vector<std::string> to_remove;
-            const auto &conns = from.getConnections();
-            for (const auto &kv : conns) {
-                auto itf = edge_set.find(from.getId());
-                if (itf == edge_set.end() || itf->second.find(kv.first) == itf->second.end()) to_remove.push_back(kv.first);
-            }
-            for (const auto &tid : to_remove) from.removeConnection(tid);
-        });
-        // Restore weights and add missing edges
-        for (const auto &e : s.edges) {
-            auto from = glia.getNeuronById(e.from);
-            auto to = glia.getNeuronById(e.to);
-            if (!from || !to) continue;
-            const auto &conns = from->getConnections();
-            if (conns.find(e.to) == conns.end()) from->addConnection(e.w, to);
-            else from->setTransmitter(e.to, e.w);
-        }
-        // Restore neuron params
-        for (const auto &r : s.neurons) {
-            auto n = glia.getNeuronById(r.id);
-            if (!n) continue;
-            n->setThreshold(r.thr);
-            n->setLeak(r.leak);
-        }
+        const Snapshot *prev = !ckpt_l0.empty() ? &ckpt_l0.back() : !ckpt_l1.empty() ? &ckpt_l1.back() : !ckpt_l2.empty() ? &ckpt_l2.back() : nullptr;
+        return NetworkSnapshot::capture(glia, prev);
     }
 
+    void restoreSnapshot(const Snapshot &s) { s.restore(glia); }
+
     void onEpochEndCapture(const TrainingConfig &cfg) {
         Snapshot s = captureSnapshot();
         ckpt_l0.push_back(std::move(s));
@@ -688,17 +1055,91 @@ private:
         return false;
     }
 
-    void injectFromSequence(InputSequence &seq) {
-        auto inputs = seq.getCurrentInputs();
-        for (const auto &kv : inputs) {
-            glia.injectSensory(kv.first, kv.second);
+    // Run every episode of the batch from the current network state and rates, split into
+    // contiguous chunks over min(batch_threads, batch size) workers on the thread pool
+    // (at most the pool's size run at once); each worker simulates
+    // its chunk in one BatchedNetwork and then builds the chunk's traces. Afterwards
+    // neuron_rate and the network state are those of the last episode. False if the
+    // network can't be compiled or has dynamics BatchedNetwork lacks (CompiledNetwork::basicDynamics()).
+    bool runFromBatchStart(const EpisodeData *const *batch, size_t batch_size, const TrainingConfig &cfg, std::vector<EpisodeTrace> &traces) {
+        CompiledNetwork *cn = glia.getCompiled();
+        if (!cn || !cn->basicDynamics()) return false;
+        const int B = static_cast<int>(batch_size);
+        const int workers = std::max(1, std::min(cfg.batch_threads, B));
+        if (static_cast<int>(lane_nets.size()) < workers) lane_nets.resize(workers);
+        if (static_cast<int>(worker_ws.size()) < workers - 1) worker_ws.resize(workers - 1);
+        if (traces.size() < batch_size) traces.resize(batch_size);
+
+        auto work = [&](int w) {
+            const int lo = B * w / workers, hi = B * (w + 1) / workers;
+            EpisodeWorkspace &wk = w == 0 ? ws : worker_ws[w - 1];
+            GLIA_PROF_BIND(&wk.profile);
+            BatchedNetwork &bn = lane_nets[w];
+            bn.setDevice(cfg.device_batch);
+            bn.build(*cn, hi - lo);
+            wk.seqs.resize(hi - lo);
+            for (int b = lo; b < hi; ++b) wk.seqs[b - lo] = &batch[b]->seq;
+            bn.run(wk.seqs.data(), hi - lo, cfg.warmup_ticks + cfg.decision_window);
+            for (int b = lo; b < hi; ++b) {
+                wk.rates = neuron_rate;  // batch-start rates; neuron_rate is only read here
+                runEpisode(*wk.seqs[b - lo], cfg, wk.rates, traces[b], wk, &bn, b - lo);
+            }
+        };
+        ThreadPool::resolve(thread_pool, cfg.pool_threads, owned_pool)->parallelFor(workers, work);
+        for (int w = 0; w < workers; ++w) {
+            EpisodeWorkspace &wk = w == 0 ? ws : worker_ws[w - 1];
+            profile_stats.merge(wk.profile); wk.profile.reset();
         }
+
+        (workers == 1 ? ws : worker_ws[workers - 2]).rates.swap(neuron_rate); // rates after the last episode
+        lane_nets[workers - 1].storeLane(*cn, lane_nets[workers - 1].lanes() - 1);
+        return true;
     }
 
-    void updateDetector(IOutputDetector &detector, const std::vector<std::string> &output_ids) {
-        for (const auto &id : output_ids) {
-            auto n = glia.getNeuronById(id);
-            if (n) detector.update(id, n->didFire());
-        }
+    // feed the last step's spikes to the detector (evaluate)
+    void updateDetectorFromStep(SlotDetector &detector) {
+        GLIA_PROF_SCOPE(Detector);
+        glia.getFiredMask(ws.fired_mask);
+        detector.updateFromMask(ws.fired_mask.data());
+        last_step_fired = false;
+        for (uint64_t w : ws.fired_mask) if (w) { last_step_fired = true; break; }
+    }
+
+    // update_gating as a target handle: kAllEdges, or only edges into that handle
+    static const int kAllEdges = -2;
+    int gatedTarget(const TrainingConfig &cfg, const std::string &winner_id, const std::string &target_id) const {
+        if (cfg.update_gating == "winner_only") return winner_id.empty() ? kAllEdges : glia.getNeuronHandle(winner_id);
+        if (cfg.update_gating == "target_only") return glia.getNeuronHandle(target_id);
+        return kAllEdges;
     }
+
+    // resolve an episode's inputs against the sensory neurons (after seq.reset())
+    void compileInputs(const InputSequence &seq) {
+        episode_inputs.compile(seq, sensory_ids);
+    }
+
+    // evaluate()'s fast-forward: the ticks from seq's current tick on (at most `limit`)
+    // without input, if there are at least two and the network is at rest, else 0. The
+    // next input tick is kept until it is passed, and rest (O(neurons)) is only checked
+    // after a tick without spikes, since a neuron that just fired isn't at rest.
+    int silentTicks(const InputSequence &seq, int limit) {
+        const int t = seq.getCurrentTick();
+        if (next_input < t) next_input = episode_inputs.nextInput(t);
+        const int gap = static_cast<int>(std::min<long long>(limit, static_cast<long long>(next_input) - t));
+        return gap >= 2 && !last_step_fired && glia.isAtRest() ? gap : 0;
+    }
+    // advance the network and seq over `ticks` silent ticks (silentTicks() said so)
+    void skipSilent(InputSequence &seq, int ticks) {
+        glia.fastForward(ticks);
+        for (int k = 0; k < ticks; ++k) seq.advance();
+    }
+
+    // inject the inputs of seq's current tick; seq must be the one last compiled
+    void injectFromSequence(const InputSequence &seq) { injectAt(seq.getCurrentTick()); }
+    void injectAt(int tick) {
+        GLIA_PROF_SCOPE(Inject);
+        const CompiledInputSequence::Span in = episode_inputs.at(tick);
+        glia.injectSensoryBatch(in.handles, in.values, in.size);
+    }
+
 };
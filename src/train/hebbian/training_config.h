@@ -3,11 +3,22 @@
 #include "../../arch/topology_policy.h"
 
 struct OutputDetectorConfig {
-    // "ema" for now; future: "softmax", "threshold", etc.
+    // "ema" (EMA firing rate), "count" (spike count over the last `window` ticks) or
+    // "first_spike" (earliest first spike in the decision window); anything else is "ema"
     std::string type = "ema";
     float alpha = 0.05f;      // EMA smoothing
     float threshold = 0.01f;  // Minimum activity to select a winner (else abstain)
     std::string default_id;   // Optional default when abstaining
+    int window = 0;           // count/first_spike window in ticks (0 = decision_window)
+    // Trainer::evaluate(): stop the decision window once the winner can no longer change
+    // in the remaining ticks, or (if early_exit_margin > 0) once margin >= early_exit_margin
+    bool early_exit = false;
+    float early_exit_margin = 0.0f;
+    // Trainer::evaluate(): skip stretches without input while the network is at rest in
+    // one Glia::fastForward() (closed-form leak, EMA rates decayed by (1-alpha)^ticks).
+    // Results match the tick-by-tick run up to float rounding of the decay; early exit
+    // still stops on the same tick. Ignored for looping sequences.
+    bool fast_forward = false;
 };
 
 struct GradConfig {
@@ -19,6 +30,12 @@ struct GradConfig {
     float adam_beta2 = 0.999f;
     float adam_eps = 1e-8f;
     float clip_grad_norm = 0.0f;
+    // BpttTrainer: ticks per backward window (membranes are checkpointed once per window
+    // and recomputed inside it; 0 = the whole episode), whether the gradient is cut at
+    // window boundaries (truncated BPTT), and the sharpness of the surrogate spike derivative
+    int bptt_window = 64;
+    bool bptt_truncate = false;
+    float surrogate_beta = 10.0f;
 };
 
 struct TrainingConfig {
@@ -61,13 +78,28 @@ struct TrainingConfig {
     // Batch/Epoch training
     int batch_size = 1;             // number of episodes per batch
     bool shuffle = true;            // shuffle dataset each epoch
+    // Simulate all episodes of a batch together (BatchedNetwork). Each episode then starts
+    // from the network state/rates at batch start instead of where the previous one ended.
+    bool lockstep_batch = false;
+    // Worker threads for a batch's episodes (>1 implies lockstep_batch semantics). The
+    // per-episode deltas are reduced in batch order, so results don't depend on this.
+    int batch_threads = 1;
+    // Threads of the trainer's pool for batch workers (0 = the process-wide pool, one
+    // thread per core; ignored when a pool is set with setThreadPool()).
+    int pool_threads = 0;
+    // Simulate lockstep batches on the GPU (builds with GLIA_CUDA, see device_network.h;
+    // implies lockstep_batch). Without a device the CPU runs them; results are the same.
+    bool device_batch = false;
+    // Batches trainEpoch() loads ahead on a background thread when its episodes have to be
+    // loaded or jittered (0 = load in the training thread).
+    int prefetch_batches = 2;
 
     // Logging and reproducibility
     bool verbose = false;           // print training progress
     int log_every = 1;              // print frequency (epochs)
     unsigned int seed = 123456u;    // random seed
     float weight_jitter_std = 0.0f; // stddev for one-time weight jitter at train start
-    int timing_jitter = 0;          // max onset jitter (ticks)
+    int timing_jitter = 0;          // max onset jitter (ticks), drawn per episode by trainEpoch()
 
     // Usage-based modulation (optional)
     float usage_boost_gain = 0.0f;  // extra scaling by edge activity (normalized eligibility)
@@ -82,6 +114,10 @@ struct TrainingConfig {
     int ckpt_l0 = 4;                // keep last N at level 0 (most recent)
     int ckpt_l1 = 2;                // keep N at level 1 (less recent)
     int ckpt_l2 = 1;                // keep N at level 2 (oldest)
+    // On-disk checkpoints (see checkpoint.h): trainEpoch() writes the full trainer state to
+    // checkpoint_path every checkpoint_every epochs, on a background thread
+    std::string checkpoint_path;    // empty = off
+    int checkpoint_every = 1;       // epochs (counted over the trainer's lifetime)
 
     // Revert/rollback triggers
     bool revert_enable = false;      // if true, revert when metrics drop
@@ -0,0 +1,361 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include "../arch/glia.h"
+#include "../arch/neuron.h"
+
+/*
+Neuron IDs (interned, see neuron_ids.h) and edge structure of a captured network: rows by handle (tick order), each
+row's edges in connection-map order (as EdgeIndex). Immutable once built and shared by
+every snapshot of the same structure; `version` identifies it, so two snapshots have the
+same neurons and edges exactly when their versions are equal.
+*/
+struct SnapshotTopology {
+    uint64_t version = 0;
+    std::vector<nid::Key> keys;    // by handle
+    std::vector<int> row_offsets;  // edges of h are [row_offsets[h], row_offsets[h+1])
+    std::vector<int> targets;      // target handle per edge (ids.size() if not a neuron of the net)
+
+    int numNeurons() const { return static_cast<int>(keys.size()); }
+    int numEdges() const { return static_cast<int>(targets.size()); }
+    const std::string &id(int h) const { return nid::name(keys[h]); }
+    bool sameStructure(const SnapshotTopology &o) const { return row_offsets == o.row_offsets && targets == o.targets && keys == o.keys; }
+
+    // a version no topology has had yet
+    static uint64_t nextVersion() {
+        static std::atomic<uint64_t> next(1);
+        return next++;
+    }
+};
+
+/*
+Weights and neuron parameters (threshold, leak) of a network at one point, by index
+instead of "FROM|TO" strings. A snapshot is a pair of shared, immutable blocks (the
+topology and the parameters), so copies are cheap and can be handed between threads.
+
+capture() against a previous snapshot of the same network shares its topology when the
+structure is unchanged and, when at most a quarter of the weights differ, stores only
+those (index, weight) pairs on top of it (chains are capped at kMaxDeltaChain; the base
+is kept alive by the delta). restore() copies every row's weights in one pass when the
+network still has the snapshot's edges, and only adds/removes connections for the rows
+that differ.
+
+halfPrecision() rounds the weights to IEEE fp16 (nearest even): a full block is then
+stored in half the bytes, a delta keeps its few changed weights as floats holding the
+rounded values. Either way the snapshot reads back the same weights.
+*/
+class NetworkSnapshot {
+public:
+    static const int kMaxDeltaChain = 8;
+
+    NetworkSnapshot() {}
+
+    static NetworkSnapshot capture(Glia &net, const NetworkSnapshot *prev = nullptr) {
+        std::shared_ptr<SnapshotTopology> t = std::make_shared<SnapshotTopology>();
+        std::shared_ptr<Params> p = std::make_shared<Params>();
+        std::vector<std::pair<const Neuron *, int>> handle;
+        int n = 0;
+        net.forEachNeuron([&](Neuron &nr){
+            handle.emplace_back(&nr, n++);
+            t->keys.push_back(nr.getKey());
+            p->threshold.push_back(nr.getThreshold());
+            p->leak.push_back(nr.getLeak());
+        });
+        std::sort(handle.begin(), handle.end());
+        t->row_offsets.assign(1, 0);
+        std::vector<float> w;
+        net.forEachNeuron([&](Neuron &from){
+            for (const auto &kv : from.getConnections()) {
+                const Neuron *to = kv.second.second;
+                auto it = std::lower_bound(handle.begin(), handle.end(), std::make_pair(to, -1));
+                t->targets.push_back(it != handle.end() && it->first == to ? it->second : n);
+                w.push_back(kv.second.first);
+            }
+            t->row_offsets.push_back(static_cast<int>(t->targets.size()));
+        });
+
+        if (prev && prev->topo && prev->topo->sameStructure(*t)) return assemble(prev->topo, p, w, prev);
+        t->version = SnapshotTopology::nextVersion();
+        return assemble(t, p, w, nullptr);
+    }
+
+    // a snapshot from edited arrays (see genome_ops.h): `topology` is prev's when the
+    // structure is unchanged, otherwise a new one (with a new version). Sharing and delta
+    // storage against prev work as in capture().
+    static NetworkSnapshot derive(const NetworkSnapshot &prev, std::shared_ptr<const SnapshotTopology> topology,
+                                  std::vector<float> thresholds, std::vector<float> leaks, std::vector<float> weights) {
+        std::shared_ptr<Params> p = std::make_shared<Params>();
+        p->threshold.swap(thresholds);
+        p->leak.swap(leaks);
+        const bool same = prev.topo && topology == prev.topo;
+        return assemble(std::move(topology), p, weights, same ? &prev : nullptr);
+    }
+
+    // a full snapshot from its parts (e.g. read back from a checkpoint file); thresholds
+    // and leaks are by handle, weights per edge of `topology`
+    static NetworkSnapshot fromParts(std::shared_ptr<const SnapshotTopology> topology, std::vector<float> thresholds,
+                                     std::vector<float> leaks, std::vector<float> weights) {
+        std::shared_ptr<Params> p = std::make_shared<Params>();
+        p->threshold.swap(thresholds);
+        p->leak.swap(leaks);
+        p->weights.swap(weights);
+        NetworkSnapshot s;
+        s.topo = std::move(topology);
+        s.params = p;
+        return s;
+    }
+
+    // write the snapshot's weights and parameters into `net`, adding and removing
+    // connections where its edges differ; neurons are matched by ID (interneurons `net`
+    // lacks are added)
+    void restore(Glia &net) const {
+        if (!topo) return;
+        const SnapshotTopology &t = *topo;
+        const int n = t.numNeurons();
+        std::vector<float> resolved;
+        const std::vector<float> *w = &params->weights;
+        if (params->base || !params->half.empty()) {
+            weights(resolved);
+            w = &resolved;
+        }
+
+        // the snapshot's neurons in `net`: by handle when the IDs still line up
+        std::vector<Neuron *> dst;
+        dst.reserve(n);
+        net.forEachNeuron([&](Neuron &nr){ dst.push_back(&nr); });
+        bool same_ids = static_cast<int>(dst.size()) == n;
+        for (int h = 0; same_ids && h < n; ++h) same_ids = dst[h]->getKey() == t.keys[h];
+        if (!same_ids) {
+            std::vector<Neuron *> all;
+            all.swap(dst);
+            dst.assign(n, nullptr);
+            for (int h = 0; h < n; ++h) {
+                auto nr = net.getNeuronByKey(t.keys[h]);
+                // neurons a structural mutation added (see genome_ops.h) are created
+                if (!nr) nr = net.addNeuron(t.id(h), params->threshold[h], params->leak[h]);
+                dst[h] = nr ? nr.get() : nullptr;
+            }
+            // neurons the snapshot doesn't have lose their connections
+            std::vector<const Neuron *> kept(dst.begin(), dst.end());
+            std::sort(kept.begin(), kept.end());
+            for (Neuron *nr : all) {
+                if (std::binary_search(kept.begin(), kept.end(), static_cast<const Neuron *>(nr))) continue;
+                std::vector<nid::Key> to;
+                for (const auto &kv : nr->getConnections()) to.push_back(kv.first);
+                for (nid::Key k : to) nr->removeConnection(k);
+            }
+        }
+
+        for (int h = 0; h < n; ++h) {
+            Neuron *from = dst[h];
+            if (!from) continue;
+            const int lo = t.row_offsets[h], hi = t.row_offsets[h + 1];
+            if (rowMatches(*from, lo, hi, dst)) from->setTransmitters(w->data() + lo);
+            else restoreRow(net, *from, lo, hi, *w);
+            from->setThreshold(params->threshold[h]);
+            from->setLeak(params->leak[h]);
+        }
+    }
+
+    bool empty() const { return !topo; }
+    const SnapshotTopology &topology() const { return *topo; }
+    std::shared_ptr<const SnapshotTopology> sharedTopology() const { return topo; }
+    const std::vector<float> &thresholds() const { return params->threshold; }
+    const std::vector<float> &leaks() const { return params->leak; }
+    // true if only the weights that changed since the base snapshot are stored
+    bool isDelta() const { return params && params->base != nullptr; }
+    // true if the weights are a full block stored in fp16
+    bool isHalf() const { return params && !params->half.empty(); }
+
+    // the same network with its weights rounded to fp16; a full block is stored that way.
+    // Snapshots already rounded are returned as they are.
+    NetworkSnapshot halfPrecision() const {
+        if (!params || !params->half.empty()) return *this;
+        std::shared_ptr<Params> p;
+        if (params->base) {
+            size_t k = 0;
+            while (k < params->changed_weights.size() && fromHalf(toHalf(params->changed_weights[k])) == params->changed_weights[k]) ++k;
+            if (k == params->changed_weights.size()) return *this;
+            p = std::make_shared<Params>(*params);
+            for (float &w : p->changed_weights) w = fromHalf(toHalf(w));
+        } else {
+            if (params->weights.empty()) return *this;
+            p = std::make_shared<Params>();
+            p->threshold = params->threshold;
+            p->leak = params->leak;
+            p->half.resize(params->weights.size());
+            for (size_t k = 0; k < p->half.size(); ++k) p->half[k] = toHalf(params->weights[k]);
+        }
+        NetworkSnapshot s;
+        s.topo = topo;
+        s.params = p;
+        return s;
+    }
+
+    // FNV-1a over neuron IDs, edges, weights, thresholds and leaks: equal for snapshots of
+    // the same network however they are stored (full or delta)
+    uint64_t hash() const {
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&h](const void *data, size_t n) {
+            const unsigned char *b = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ull; }
+        };
+        if (!topo) return h;
+        for (nid::Key k : topo->keys) mix(nid::name(k).c_str(), nid::name(k).size() + 1);
+        mix(topo->row_offsets.data(), topo->row_offsets.size() * sizeof(int));
+        mix(topo->targets.data(), topo->targets.size() * sizeof(int));
+        std::vector<float> w;
+        weights(w);
+        mix(w.data(), w.size() * sizeof(float));
+        mix(params->threshold.data(), params->threshold.size() * sizeof(float));
+        mix(params->leak.data(), params->leak.size() * sizeof(float));
+        return h;
+    }
+
+    // weights per edge of topology()
+    void weights(std::vector<float> &out) const {
+        if (!params) {
+            out.clear();
+            return;
+        }
+        std::vector<const Params *> chain;
+        for (const Params *p = params.get(); p; p = p->base.get()) chain.push_back(p);
+        const Params &full = *chain.back();
+        if (full.half.empty()) out = full.weights;
+        else {
+            out.resize(full.half.size());
+            for (size_t k = 0; k < out.size(); ++k) out[k] = fromHalf(full.half[k]);
+        }
+        for (size_t i = chain.size() - 1; i-- > 0;) {
+            const Params &d = *chain[i];
+            for (size_t c = 0; c < d.changed.size(); ++c) out[d.changed[c]] = d.changed_weights[c];
+        }
+    }
+
+private:
+    struct Params {
+        std::vector<float> threshold; // by handle
+        std::vector<float> leak;
+        std::vector<float> weights;   // per edge; empty for a delta or a half block
+        std::vector<uint16_t> half;   // per edge in fp16 instead of `weights` (halfPrecision())
+        // delta: `base` with weights[changed[c]] = changed_weights[c]
+        std::shared_ptr<const Params> base;
+        std::vector<int> changed;
+        std::vector<float> changed_weights;
+        int depth = 0;                // deltas between this and a full block
+    };
+
+    std::shared_ptr<const SnapshotTopology> topo;
+    std::shared_ptr<const Params> params;
+
+    // IEEE binary16, rounded to nearest even; beyond the range (65504) becomes infinity
+    static uint16_t toHalf(float f) {
+        uint32_t x;
+        std::memcpy(&x, &f, sizeof(x));
+        const uint32_t sign = (x >> 16) & 0x8000u;
+        x &= 0x7fffffffu;
+        if (x >= 0x7f800000u) return static_cast<uint16_t>(sign | 0x7c00u | (x > 0x7f800000u ? 0x200u : 0u));
+        if (x >= 0x477ff000u) return static_cast<uint16_t>(sign | 0x7c00u);
+        uint32_t h, rem, halfway;
+        if (x >= 0x38800000u) { // normal: rebias the exponent, drop 13 mantissa bits
+            h = (x - 0x38000000u) >> 13;
+            rem = x & 0x1fffu;
+            halfway = 0x1000u;
+        } else if (x > 0x33000000u) { // subnormal, in units of 2^-24
+            const uint32_t shift = 126u - (x >> 23);
+            const uint32_t m = (x & 0x7fffffu) | 0x800000u;
+            h = m >> shift;
+            rem = m & ((1u << shift) - 1u);
+            halfway = 1u << (shift - 1u);
+        } else {
+            return static_cast<uint16_t>(sign);
+        }
+        if (rem > halfway || (rem == halfway && (h & 1u))) ++h;
+        return static_cast<uint16_t>(sign | h);
+    }
+
+    static float fromHalf(uint16_t h) {
+        const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+        const uint32_t e = (h >> 10) & 0x1fu, m = h & 0x3ffu;
+        if (e == 0) {
+            const float f = std::ldexp(static_cast<float>(m), -24);
+            return sign ? -f : f;
+        }
+        const uint32_t x = sign | (e == 0x1fu ? 0x7f800000u | (m << 13) : ((e + 112u) << 23) | (m << 13));
+        float f;
+        std::memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+    // p (thresholds and leaks filled) with weights w, stored as a delta on prev when that has
+    // the same topology and at most a quarter of the weights differ
+    static NetworkSnapshot assemble(std::shared_ptr<const SnapshotTopology> t, const std::shared_ptr<Params> &p, std::vector<float> &w,
+                                    const NetworkSnapshot *prev) {
+        NetworkSnapshot s;
+        s.topo = std::move(t);
+        if (prev) {
+            std::vector<float> pw;
+            prev->weights(pw);
+            size_t changed = 0;
+            for (size_t k = 0; k < w.size(); ++k) if (w[k] != pw[k]) ++changed;
+            if (prev->params->depth < kMaxDeltaChain && changed * 4 <= w.size()) {
+                p->base = prev->params;
+                p->depth = prev->params->depth + 1;
+                for (size_t k = 0; k < w.size(); ++k) {
+                    if (w[k] == pw[k]) continue;
+                    p->changed.push_back(static_cast<int>(k));
+                    p->changed_weights.push_back(w[k]);
+                }
+            }
+        }
+        if (!p->base) p->weights.swap(w);
+        s.params = p;
+        return s;
+    }
+
+    // `from` still has exactly the row's edges (same targets, in the same order)
+    bool rowMatches(const Neuron &from, int lo, int hi, const std::vector<Neuron *> &dst) const {
+        const auto &conns = from.getConnections();
+        if (static_cast<int>(conns.size()) != hi - lo) return false;
+        const int n = topo->numNeurons();
+        int k = lo;
+        for (const auto &kv : conns) {
+            const int tgt = topo->targets[k++];
+            if (tgt >= n || kv.second.second != dst[tgt]) return false;
+        }
+        return true;
+    }
+
+    void restoreRow(Glia &net, Neuron &from, int lo, int hi, const std::vector<float> &w) const {
+        const SnapshotTopology &t = *topo;
+        const int n = t.numNeurons();
+        // row targets are in connection-map (ID) order, so they can be binary-searched
+        std::vector<nid::Key> row;
+        for (int k = lo; k < hi; ++k) if (t.targets[k] < n) row.push_back(t.keys[t.targets[k]]);
+        std::vector<nid::Key> to_remove;
+        for (const auto &kv : from.getConnections()) {
+            auto it = std::lower_bound(row.begin(), row.end(), kv.first, nid::ByName());
+            if (it == row.end() || *it != kv.first) to_remove.push_back(kv.first);
+        }
+        for (nid::Key k : to_remove) from.removeConnection(k);
+        for (int k = lo; k < hi; ++k) {
+            if (t.targets[k] >= n) continue;
+            const nid::Key to_key = t.keys[t.targets[k]];
+            const auto &conns = from.getConnections();
+            if (conns.find(to_key) != conns.end()) {
+                from.setTransmitter(to_key, w[k]);
+                continue;
+            }
+            auto to = net.getNeuronByKey(to_key);
+            if (to) from.addConnection(w[k], to.get());
+        }
+    }
+};
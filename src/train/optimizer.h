@@ -0,0 +1,94 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+
+/*
+Weight updates of the trainers as single passes over flat per-edge arrays (EdgeIndex
+order): weights, gradient or delta, and optimizer moments. Everything that is constant
+for a step (gradient scale and clipping factor, bias corrections, which decay applies) is
+worked out before the pass, so the loops have no per-edge branches beyond the weight
+clip and compilers vectorize them. Arithmetic is that of the former per-edge loops, so
+results are unchanged.
+*/
+namespace optim
+{
+
+// global L2 norm of scale * g, summed in double
+inline double norm(const float *g, int n, float scale)
+{
+    double sumsq = 0.0;
+    for (int k = 0; k < n; ++k) { double x = (double)g[k] * (double)scale; sumsq += x * x; }
+    return std::sqrt(std::max(1e-30, sumsq));
+}
+
+// factor that brings the norm of scale * g down to max_norm (1 if it is within, or max_norm <= 0)
+inline float clipFactor(const float *g, int n, float scale, float max_norm)
+{
+    if (max_norm <= 0.0f) return 1.0f;
+    double nrm = norm(g, n, scale);
+    return nrm > (double)max_norm ? (float)((double)max_norm / nrm) : 1.0f;
+}
+
+inline void clampWeights(float *w, int n, float clip)
+{
+    if (clip <= 0.0f) return;
+    for (int k = 0; k < n; ++k) { float x = w[k]; w[k] = x > clip ? clip : (x < -clip ? -clip : x); }
+}
+
+// w -= lr * g * scale * clip, then coupled L2 decay
+inline void sgd(float *w, const float *g, int n, float scale, float clip, float lr, float weight_decay, float weight_clip)
+{
+    if (weight_decay > 0.0f) {
+        for (int k = 0; k < n; ++k) { float x = w[k] - lr * (g[k] * scale * clip); w[k] = x - weight_decay * x; }
+    } else {
+        for (int k = 0; k < n; ++k) w[k] -= lr * (g[k] * scale * clip);
+    }
+    clampWeights(w, n, weight_clip);
+}
+
+struct AdamParams
+{
+    float lr = 0.01f;
+    float beta1 = 0.9f, beta2 = 0.999f, eps = 1e-8f;
+    float weight_decay = 0.0f;
+    bool decoupled = false; // AdamW: decay as its own step scaled by lr, before the update
+    float weight_clip = 0.0f;
+};
+
+// one Adam/AdamW step at `step` (>= 1) of the gradient scale * clip * g
+inline void adam(float *w, float *m, float *v, const float *g, int n, float scale, float clip, int step, const AdamParams &p)
+{
+    // bias corrections once per step (double, as before)
+    double bias1 = 1.0 - std::pow((double)p.beta1, (double)step);
+    double bias2 = 1.0 - std::pow((double)p.beta2, (double)step);
+    if (!(bias1 > 1e-20)) bias1 = 1.0;
+    if (!(bias2 > 1e-20)) bias2 = 1.0;
+    const float b1 = p.beta1, b2 = p.beta2, lr = p.lr;
+    const double eps = (double)(p.eps > 0.0f ? p.eps : 1e-8f);
+    // decoupled decay before the update, coupled decay after it (one of them is 0)
+    const float pre_decay = p.decoupled && p.weight_decay > 0.0f ? lr * p.weight_decay : 0.0f;
+    const float post_decay = !p.decoupled && p.weight_decay > 0.0f ? p.weight_decay : 0.0f;
+    for (int k = 0; k < n; ++k) {
+        float gk = g[k] * scale * clip;
+        float mk = b1 * m[k] + (1.0f - b1) * gk;
+        float vk = b2 * v[k] + (1.0f - b2) * (gk * gk);
+        m[k] = mk; v[k] = vk;
+        double mhat = (double)mk / bias1;
+        double vhat = (double)vk / bias2;
+        float x = w[k];
+        if (pre_decay != 0.0f) x -= pre_decay * x;
+        x -= lr * (float)(mhat / (std::sqrt(vhat) + eps));
+        if (post_decay != 0.0f) x -= post_decay * x;
+        w[k] = x;
+    }
+    clampWeights(w, n, p.weight_clip);
+}
+
+// Hebbian batch update: w += scale * delta, then decay
+inline void addScaled(float *w, const float *delta, int n, float scale, float weight_decay, float weight_clip)
+{
+    for (int k = 0; k < n; ++k) { float x = w[k] + scale * delta[k]; w[k] = x - weight_decay * x; }
+    clampWeights(w, n, weight_clip);
+}
+
+} // namespace optim
@@ -0,0 +1,207 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../arch/glia.h"
+#include "../arch/neuron.h"
+#include "edge_index.h"
+
+/*
+Pruning and growth for the trainers, through the EdgeIndex instead of "FROM|TO" strings
+and rescans of the network. A pass starts on an index that is current for the network;
+prune() tombstones edges by index, growth works on handles, and the inactive-neuron rules
+read a neuron's edges from its row or from the inbound index. commit() then applies the
+edits to the network and compacts the index once, so apart from the caller's own walk
+over the weights a pass costs in proportion to the edges it touches.
+
+The rules see the network as the old string-keyed passes did: growth after prune(), and
+the inactive-neuron rules after both, all choosing from the same edges (an edge picked
+from both ends is removed once).
+*/
+class StructuralPlasticity {
+public:
+    // start a pass over `edges`, which must be current for `glia`; `keys` (interned IDs) by handle
+    void begin(Glia &glia, EdgeIndex &edges, const std::vector<nid::Key> &keys) {
+        if (static_cast<int>(neurons.size()) != glia.getNeuronCount()) {
+            neurons.clear();
+            for (nid::Key k : keys) neurons.push_back(glia.getNeuronByKey(k).get());
+        }
+        index = &edges;
+        neuron_keys = &keys;
+        grown.clear();
+        chosen.clear();
+        sorted_added = 0;
+    }
+
+    void prune(int k) { index->tombstone(k); }
+
+    // true if the edge is in the network and not pruned in this pass, or grown in it
+    bool exists(int source, int target) const {
+        const int k = rowPosition(source, target);
+        if (k >= 0 && index->alive(k)) return true;
+        return grown.count(key(source, target)) != 0;
+    }
+
+    // queue a new edge; false if it exists or is a self-connection
+    bool grow(int source, int target, float weight) {
+        if (source == target || exists(source, target)) return false;
+        index->append(source, target, weight);
+        grown.insert(key(source, target));
+        return true;
+    }
+
+    // pick up to `max` of the weakest edges out of / into neuron h (by |weight|, from
+    // EdgeIndex::weights, which the caller keeps current); removed at commit()
+    void pruneWeakestOut(int h, int max) {
+        sortAdded();
+        const EdgeIndex &e = *index;
+        const std::vector<nid::Key> &keys = *neuron_keys;
+        const nid::ByName by_name;
+        candidates.clear();
+        // row and grown edges merged in connection-map (target ID) order
+        auto a = std::lower_bound(by_source.begin(), by_source.end(), h, [&](int i, int src){ return e.added[i].source < src; });
+        for (int k = e.row_offsets[h]; k < e.row_offsets[h + 1]; ++k) {
+            if (!e.alive(k)) continue;
+            for (; a != by_source.end() && e.added[*a].source == h && e.targets[k] < e.numNeurons() && by_name(keys[e.added[*a].target], keys[e.targets[k]]); ++a)
+                candidates.push_back(-1 - *a);
+            candidates.push_back(k);
+        }
+        for (; a != by_source.end() && e.added[*a].source == h; ++a) candidates.push_back(-1 - *a);
+        pickWeakest(max);
+    }
+    void pruneWeakestIn(int h, int max) {
+        sortAdded();
+        const EdgeIndex &e = *index;
+        candidates.clear();
+        // inbound and grown edges merged in source (tick) order
+        auto a = std::lower_bound(by_target.begin(), by_target.end(), h, [&](int i, int tgt){ return e.added[i].target < tgt; });
+        for (int i = e.in_offsets[h]; i < e.in_offsets[h + 1]; ++i) {
+            const int k = e.in_edges[i];
+            if (!e.alive(k)) continue;
+            for (; a != by_target.end() && e.added[*a].target == h && e.added[*a].source < e.sources[k]; ++a)
+                candidates.push_back(-1 - *a);
+            candidates.push_back(k);
+        }
+        for (; a != by_target.end() && e.added[*a].target == h; ++a) candidates.push_back(-1 - *a);
+        pickWeakest(max);
+    }
+
+    // apply the pass to the network and compact the index into `next` (from: see
+    // EdgeIndex::compactInto); false if nothing changed. If the index can't be compacted,
+    // `next` is built from the network.
+    bool commit(Glia &glia, EdgeIndex &next, std::vector<int> &from) {
+        EdgeIndex &edges = *index;
+        for (int c : chosen) {
+            if (c >= 0) edges.tombstone(c);
+            else edges.added[-1 - c].dropped = true;
+        }
+        chosen.clear();
+        if (!edges.edited()) return false;
+        // removals first, by position in the untouched maps for targets outside the
+        // network (highest first, so earlier positions in a row stay put)
+        removals.assign(edges.removed.begin(), edges.removed.end());
+        std::sort(removals.begin(), removals.end(), std::greater<int>());
+        const int n = edges.numNeurons();
+        for (int k : removals) {
+            Neuron &src = *neurons[edges.sources[k]];
+            if (edges.targets[k] < n) {
+                src.removeConnection((*neuron_keys)[edges.targets[k]]);
+            } else {
+                auto it = src.getConnections().begin();
+                std::advance(it, k - edges.row_offsets[edges.sources[k]]);
+                const nid::Key to = it->first;
+                src.removeConnection(to);
+            }
+        }
+        pruned_total += removals.size();
+        for (const EdgeIndex::NewEdge &e : edges.added)
+            if (!e.dropped) { neurons[e.source]->addConnection(e.weight, neurons[e.target]); ++grown_total; }
+        if (!edges.compactInto(next, *neuron_keys, from)) {
+            next.build(glia);
+            std::unordered_map<uint64_t, int> pos;
+            for (int k = 0; k < edges.numEdges(); ++k)
+                if (edges.alive(k)) pos.emplace(key(edges.sources[k], edges.targets[k]), k);
+            from.assign(next.numEdges(), -1);
+            for (int k = 0; k < next.numEdges(); ++k) {
+                auto it = pos.find(key(next.sources[k], next.targets[k]));
+                if (it != pos.end()) from[k] = it->second;
+            }
+        }
+        grown.clear();
+        return true;
+    }
+
+    // edges added / removed by every commit() so far
+    uint64_t grownTotal() const { return grown_total; }
+    uint64_t prunedTotal() const { return pruned_total; }
+
+private:
+    std::vector<Neuron *> neurons; // by handle
+    EdgeIndex *index = nullptr;
+    const std::vector<nid::Key> *neuron_keys = nullptr;
+    std::unordered_set<uint64_t> grown; // (source, target) of the edges grown in this pass
+    std::vector<int> by_source, by_target; // grown edges (EdgeIndex::added) in row / inbound order
+    size_t sorted_added = 0;            // added.size() when they were sorted
+    std::vector<int> candidates;        // edge k, or -1 - i for added edge i
+    std::vector<int> chosen;            // picked by the inactive-neuron rules (same encoding)
+    std::vector<int> removals;
+    uint64_t grown_total = 0, pruned_total = 0; // see grownTotal()
+
+    static uint64_t key(int source, int target) { return (static_cast<uint64_t>(source) << 32) | static_cast<uint32_t>(target); }
+
+    // edge source -> target in the source's row, or -1. Rows are in connection-map (target
+    // ID) order, so this is a binary search; an edge to a neuron outside the network has
+    // no ID to compare, and a row with one is scanned instead.
+    int rowPosition(int source, int target) const {
+        const EdgeIndex &e = *index;
+        const std::vector<nid::Key> &keys = *neuron_keys;
+        const int n = e.numNeurons();
+        const nid::ByName by_name;
+        int lo = e.row_offsets[source], hi = e.row_offsets[source + 1];
+        while (lo < hi) {
+            const int mid = lo + (hi - lo) / 2;
+            const int t = e.targets[mid];
+            if (t >= n) {
+                for (int k = e.row_offsets[source]; k < e.row_offsets[source + 1]; ++k)
+                    if (e.targets[k] == target) return k;
+                return -1;
+            }
+            if (t == target) return mid;
+            if (by_name(keys[t], keys[target])) lo = mid + 1;
+            else hi = mid;
+        }
+        return -1;
+    }
+
+    void sortAdded() {
+        const std::vector<EdgeIndex::NewEdge> &added = index->added;
+        if (sorted_added == added.size() && by_source.size() == added.size()) return;
+        const std::vector<nid::Key> &keys = *neuron_keys;
+        const nid::ByName by_name;
+        by_source.resize(added.size());
+        for (size_t i = 0; i < added.size(); ++i) by_source[i] = static_cast<int>(i);
+        by_target = by_source;
+        std::sort(by_source.begin(), by_source.end(), [&](int a, int b){
+            if (added[a].source != added[b].source) return added[a].source < added[b].source;
+            return by_name(keys[added[a].target], keys[added[b].target]);
+        });
+        std::sort(by_target.begin(), by_target.end(), [&](int a, int b){
+            if (added[a].target != added[b].target) return added[a].target < added[b].target;
+            return added[a].source < added[b].source;
+        });
+        sorted_added = added.size();
+    }
+
+    float weightOf(int c) const { return c >= 0 ? index->weights[c] : index->added[-1 - c].weight; }
+
+    void pickWeakest(int max) {
+        std::sort(candidates.begin(), candidates.end(), [&](int a, int b){ return std::fabs(weightOf(a)) < std::fabs(weightOf(b)); });
+        for (int i = 0; i < max && i < static_cast<int>(candidates.size()); ++i) chosen.push_back(candidates[i]);
+    }
+};
@@ -274,7 +274,7 @@ public:
                 const auto &conns = from->getConnections();
                 if (conns.find(to_id) != conns.end()) continue;
                 float w = cfg.init_weight * (dist_sign(rng) >= 0 ? 1.0f : -1.0f);
-                from->addConnection(w, to);
+                from->addConnection(w, to.get());
                 grown++;
             }
         }
@@ -520,7 +520,7 @@ public:
                 const auto &conns = from->getConnections();
                 if (conns.find(to_id) != conns.end()) continue;
                 float w = cfg.init_weight * (dist_sign(rng) >= 0 ? 1.0f : -1.0f);
-                from->addConnection(w, to);
+                from->addConnection(w, to.get());
                 grown++;
             }
         }
@@ -645,7 +645,7 @@ private:
             auto to = glia.getNeuronById(e.to);
             if (!from || !to) continue;
             const auto &conns = from->getConnections();
-            if (conns.find(e.to) == conns.end()) from->addConnection(e.w, to);
+            if (conns.find(e.to) == conns.end()) from->addConnection(e.w, to.get());
             else from->setTransmitter(e.to, e.w);
         }
         // Restore neuron params
@@ -5,6 +5,7 @@
 #include "meshdata.h"
 #include "argparser.h"
 #include "../arch/input_sequence.h"
+#include "simulation_thread.h"
 #include "input_control.h"
 #include "network_graph.h"
 
@@ -305,6 +306,7 @@ void OpenGLCanvas::keyboardCB(GLFWwindow* /*window*/, int key, int /*scancode*/,
           delete args->input_sequence;
           args->input_sequence = new InputSequence();
           *args->input_sequence = *args->loaded_tests[test_index];
+          if (args->simulation) args->simulation->setSequence(args->input_sequence);
           mesh_data->current_tick = 0;
           mesh_data->last_tick_time = glfwGetTime();
           std::cout << "Loaded test " << (test_index + 1) << ": " 
@@ -320,6 +322,7 @@ void OpenGLCanvas::keyboardCB(GLFWwindow* /*window*/, int key, int /*scancode*/,
       if (args->use_network) {
         delete args->input_sequence;
         args->input_sequence = nullptr;
+        if (args->simulation) args->simulation->setSequence(nullptr);
         mesh_data->current_tick = 0;
         std::cout << "Test sequence cleared (manual control mode)" << std::endl;
       }
@@ -367,7 +370,8 @@ void OpenGLCanvas::keyboardCB(GLFWwindow* /*window*/, int key, int /*scancode*/,
     case '.':  case '>':
       // Faster: divide seconds_per_tick by 2 (logarithmic)
       if (args->use_network) {
-        mesh_data->seconds_per_tick = std::max(0.001f, mesh_data->seconds_per_tick * 0.5f);
+        // (the simulation thread can go well past the frame rate)
+        mesh_data->seconds_per_tick = std::max(args->simulation ? 0.00001f : 0.001f, mesh_data->seconds_per_tick * 0.5f);
         float ticks_per_sec = 1.0f / mesh_data->seconds_per_tick;
         std::cout << "Speed: " << mesh_data->seconds_per_tick << " s/tick (" 
                   << ticks_per_sec << " ticks/s)" << std::endl;
@@ -403,6 +407,7 @@ void OpenGLCanvas::keyboardCB(GLFWwindow* /*window*/, int key, int /*scancode*/,
         if (args->input_sequence) {
           args->input_sequence->reset();
         }
+        if (args->simulation) args->simulation->resetTicks();
         std::cout << "Tick counter reset to 0" << std::endl;
       } else {
         // Cloth: reset system
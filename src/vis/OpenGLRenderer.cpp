@@ -12,6 +12,7 @@
 #include "network_graph.h"
 #include "ui_renderer.h"
 #include <iostream>
+#include <cstddef>
 
 // NOTE: These functions are also called by the Mac Metal Objective-C
 // code, so we need this extern to allow C code to call C++ functions
@@ -38,7 +39,7 @@ OpenGLRenderer::OpenGLRenderer(MeshData *_mesh_data, ArgParser *args) {
   glEnable(GL_POINT_SMOOTH);        // Smooth/round points (if supported)
 
   // Create and compile our GLSL program from the shaders
-  GLuint programID = LoadShaders( args->path+"/OpenGL.vertexshader", args->path+"/OpenGL.fragmentshader" );
+  programID = LoadShaders( args->path+"/OpenGL.vertexshader", args->path+"/OpenGL.fragmentshader" );
   
   // Get handles for our uniforms
   MatrixID = glGetUniformLocation(programID, "MVP");
@@ -47,6 +48,20 @@ OpenGLRenderer::OpenGLRenderer(MeshData *_mesh_data, ArgParser *args) {
   ModelMatrixID = glGetUniformLocation(programID, "M");
   wireframeID = glGetUniformLocation(programID, "wireframe");
   neuronSizeScaleID = glGetUniformLocation(programID, "neuronSizeScale");
+
+  // Networks draw their connections from a static edge buffer (see updateNetworkVBOs)
+  edgeProgramID = 0;
+  if (args->use_network && args->network_graph) {
+    edgeProgramID = LoadShaders( args->path+"/NetworkEdges.vertexshader", args->path+"/OpenGL.fragmentshader" );
+    edgeMatrixID = glGetUniformLocation(edgeProgramID, "MVP");
+    edgeViewMatrixID = glGetUniformLocation(edgeProgramID, "V");
+    edgeModelMatrixID = glGetUniformLocation(edgeProgramID, "M");
+    edgeLightID = glGetUniformLocation(edgeProgramID, "LightPosition_worldspace");
+    edgeWireframeID = glGetUniformLocation(edgeProgramID, "wireframe");
+    edgeStateID = glGetUniformLocation(edgeProgramID, "neuronState");
+    args->network_graph->setStreamRendering(true);
+    args->network_graph->packMesh();
+  }
   
   // Initialize UI renderer for 2D overlay
   UIRenderer::initialize(args->path);
@@ -104,6 +119,7 @@ OpenGLRenderer::OpenGLRenderer(MeshData *_mesh_data, ArgParser *args) {
   
   cleanupVBOs();
   glDeleteProgram(programID);
+  if (edgeProgramID) glDeleteProgram(edgeProgramID);
   
   // Close OpenGL window and terminate GLFW
   glfwDestroyWindow(OpenGLCanvas::window);
@@ -116,10 +132,24 @@ OpenGLRenderer::OpenGLRenderer(MeshData *_mesh_data, ArgParser *args) {
 void OpenGLRenderer::setupVBOs() {
   glGenVertexArrays(1, &cloth_VaoId);
   glGenBuffers(1, &cloth_tris_VBO);
+
+  glGenVertexArrays(1, &edge_VaoId);
+  glGenBuffers(1, &edge_VBO);
+  edge_vertex_count = 0;
+  edge_graph = NULL;
+  glGenVertexArrays(2, neuron_VaoId);
+  glGenBuffers(2, neuron_VBO);
+  glGenTextures(2, neuron_TBO);
+  neuron_bytes[0] = neuron_bytes[1] = 0;
+  neuron_frame = 0;
 }
 
 void OpenGLRenderer::drawVBOs(const glm::mat4 &mvp,const glm::mat4 &m,const glm::mat4 &v) {
   // Note: programID should already be active from main loop
+  if (streamingNetwork()) {
+    drawNetwork(mvp,m,v);
+    return;
+  }
   Vec3f lightPos = Vec3f(4,4,4);
   glUniform3f(LightID, lightPos.x(), lightPos.y(), lightPos.z());
   glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &mvp[0][0]);
@@ -137,7 +167,25 @@ void OpenGLRenderer::cleanupVBOs() {
 // ====================================================================
 
 
+bool OpenGLRenderer::streamingNetwork() const {
+  extern ArgParser *GLOBAL_args;
+  return GLOBAL_args && GLOBAL_args->use_network && GLOBAL_args->network_graph &&
+         GLOBAL_args->network_graph->isStreamRendering();
+}
+
 void OpenGLRenderer::updateVBOs() {
+  extern ArgParser *GLOBAL_args;
+  if (edgeProgramID && GLOBAL_args->use_network && GLOBAL_args->network_graph &&
+      !GLOBAL_args->network_graph->isStreamRendering()) {
+    // the network was reloaded
+    GLOBAL_args->network_graph->setStreamRendering(true);
+    edge_graph = NULL;
+    GLOBAL_args->network_graph->packMesh();
+  }
+  if (streamingNetwork()) {
+    updateNetworkVBOs();
+    return;
+  }
   glBindVertexArray(cloth_VaoId);
   glBindBuffer(GL_ARRAY_BUFFER, cloth_tris_VBO);
   
@@ -185,6 +233,94 @@ void OpenGLRenderer::drawMesh() const {
 void OpenGLRenderer::cleanupMesh() {
   glDeleteBuffers(1, &cloth_tris_VBO);
   glDeleteBuffers(1, &cloth_VaoId);
+  glDeleteBuffers(1, &edge_VBO);
+  glDeleteVertexArrays(1, &edge_VaoId);
+  glDeleteTextures(2, neuron_TBO);
+  glDeleteBuffers(2, neuron_VBO);
+  glDeleteVertexArrays(2, neuron_VaoId);
+}
+
+// ====================================================================
+
+void OpenGLRenderer::updateNetworkVBOs() {
+  extern ArgParser *GLOBAL_args;
+  NetworkGraph *graph = GLOBAL_args->network_graph;
+
+  // Connections: uploaded once per graph, they only reference neurons by index
+  if (graph != edge_graph) {
+    const std::vector<NetworkGraph::EdgeVertex> &edges = graph->getEdgeVertices();
+    glBindVertexArray(edge_VaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, edge_VBO);
+    glBufferData(GL_ARRAY_BUFFER, edges.size() * sizeof(NetworkGraph::EdgeVertex), edges.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_INT, sizeof(NetworkGraph::EdgeVertex), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(NetworkGraph::EdgeVertex),
+                          (void*)offsetof(NetworkGraph::EdgeVertex, color));
+    edge_vertex_count = edges.size();
+    edge_graph = graph;
+  }
+
+  // Neuron state: written into the buffer the previous frame didn't draw from, so the
+  // upload doesn't wait for that draw to finish
+  neuron_frame ^= 1;
+  const int f = neuron_frame;
+  const std::vector<float> &stream = graph->getNeuronStream();
+  const size_t bytes = stream.size() * sizeof(float);
+  glBindVertexArray(neuron_VaoId[f]);
+  glBindBuffer(GL_ARRAY_BUFFER, neuron_VBO[f]);
+  if (bytes != neuron_bytes[f]) {
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    const GLsizei stride = NetworkGraph::neuron_stream_floats * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, 0);
+    glDisableVertexAttribArray(1);  // constant normal, set in drawNetwork()
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec4));
+    glBindTexture(GL_TEXTURE_BUFFER, neuron_TBO[f]);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, neuron_VBO[f]);
+    neuron_bytes[f] = bytes;
+  }
+  if (bytes > 0) {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, stream.data());
+  }
+}
+
+void OpenGLRenderer::drawNetwork(const glm::mat4 &mvp,const glm::mat4 &m,const glm::mat4 &v) const {
+  extern ArgParser *GLOBAL_args;
+  const int f = neuron_frame;
+  const int neuron_count = GLOBAL_args->network_graph->getNeuronVertexCount();
+  Vec3f lightPos = Vec3f(4,4,4);
+
+  // Draw connections as lines (if enabled)
+  if (mesh_data->wireframe && edge_vertex_count > 0 && neuron_count > 0) {
+    glUseProgram(edgeProgramID);
+    glUniform3f(edgeLightID, lightPos.x(), lightPos.y(), lightPos.z());
+    glUniformMatrix4fv(edgeMatrixID, 1, GL_FALSE, &mvp[0][0]);
+    glUniformMatrix4fv(edgeModelMatrixID, 1, GL_FALSE, &m[0][0]);
+    glUniformMatrix4fv(edgeViewMatrixID, 1, GL_FALSE, &v[0][0]);
+    glUniform1i(edgeWireframeID, 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, neuron_TBO[f]);
+    glUniform1i(edgeStateID, 0);
+    glBindVertexArray(edge_VaoId);
+    glLineWidth(3.0f);  // Thicker lines for better visibility
+    glDrawArrays(GL_LINES, 0, GLsizei(edge_vertex_count));
+    glUseProgram(programID);
+  }
+
+  // Draw neurons as points (if enabled), straight from the state buffer
+  if (mesh_data->particles && neuron_count > 0) {
+    glUniform3f(LightID, lightPos.x(), lightPos.y(), lightPos.z());
+    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &mvp[0][0]);
+    glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &m[0][0]);
+    glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &v[0][0]);
+    glUniform1i(wireframeID, mesh_data->wireframe);
+    glUniform1f(neuronSizeScaleID, OpenGLCanvas::neuron_size_scale);
+    glBindVertexArray(neuron_VaoId[f]);
+    glVertexAttrib4f(1, 0.0f, 1.0f, 0.0f, 0.0f);  // Up vector, as AddPoint()
+    glDrawArrays(GL_POINTS, 0, neuron_count);
+  }
 }
 
 // ====================================================================
@@ -25,6 +25,12 @@ private:
   void drawMesh() const;
   void cleanupMesh();
 
+  // streamed network path (NetworkGraph::setStreamRendering): static edge buffer plus a
+  // double-buffered per-neuron state buffer, also read by the edge shader as a texture
+  void updateNetworkVBOs();
+  void drawNetwork(const glm::mat4 &MVP,const glm::mat4 &M,const glm::mat4 &V) const;
+  bool streamingNetwork() const;
+
   // REPRESENTATION
   MeshData *mesh_data;
 
@@ -32,6 +38,25 @@ private:
   
   GLuint cloth_VaoId;
 
+  GLuint edge_VBO;
+  GLuint edge_VaoId;
+  size_t edge_vertex_count;
+  const NetworkGraph *edge_graph;   // graph whose edges are in edge_VBO
+  GLuint neuron_VBO[2];
+  GLuint neuron_VaoId[2];
+  GLuint neuron_TBO[2];
+  size_t neuron_bytes[2];
+  int neuron_frame;                 // buffer written this frame
+
+  GLuint programID;
+  GLuint edgeProgramID;
+  GLuint edgeMatrixID;
+  GLuint edgeViewMatrixID;
+  GLuint edgeModelMatrixID;
+  GLuint edgeLightID;
+  GLuint edgeWireframeID;
+  GLuint edgeStateID;
+
   GLuint MatrixID;
   GLuint LightID;
   GLuint ViewMatrixID;
@@ -12,6 +12,7 @@
 #include "network_graph.h"
 #include "glia.h"
 #include "input_control.h"
+#include "simulation_thread.h"
 #include "../arch/input_sequence.h"
 
 #if __APPLE__
@@ -33,8 +34,12 @@ ArgParser::ArgParser(int argc, const char *argv[], MeshData *_mesh_data) {
   network_graph = NULL;
   glia = NULL;
   input_controls = NULL;
+  simulation = NULL;
   input_sequence = NULL;  // No sequence by default
   use_network = false;
+  layout_repulsion = 0.0;
+  layout_thread = false;
+  sim_thread = false;
   
   // parse the command line arguments
   for (int i = 1; i < argc; i++) {
@@ -61,6 +66,13 @@ ArgParser::ArgParser(int argc, const char *argv[], MeshData *_mesh_data) {
         i++;
       }
       i--; // Back up one since loop will increment
+    } else if (argv[i] == std::string("--repulsion")) {
+      i++; assert (i < argc);
+      layout_repulsion = atof(argv[i]);
+    } else if (argv[i] == std::string("--physics-thread")) {
+      layout_thread = true;
+    } else if (argv[i] == std::string("--sim-thread")) {
+      sim_thread = true;
     } else if (argv[i] == std::string("--size")) {
       i++; assert (i < argc); 
       mesh_data->width = atoi(argv[i]);
@@ -99,6 +111,8 @@ void ArgParser::Load() {
 }
 
 void ArgParser::LoadNetwork() {
+  delete simulation;  // joins the thread before glia goes away
+  simulation = NULL;
   delete network_graph;
   delete glia;
   
@@ -114,6 +128,11 @@ void ArgParser::LoadNetwork() {
     
     // Create NetworkGraph for visualization
     network_graph = new NetworkGraph(glia, this);
+
+    // From here on only the simulation thread touches glia
+    if (sim_thread) {
+      simulation = new SimulationThread(glia);
+    }
     
     // Create input controls for sensory neurons (dynamically discovered)
     std::vector<std::string> sensory_ids = glia->getSensoryNeuronIDs();
@@ -20,6 +20,7 @@ class NetworkGraph;  // Forward declaration
 class Glia;          // Forward declaration
 class InputControlManager;  // Forward declaration
 class InputSequence;  // Forward declaration
+class SimulationThread;  // Forward declaration
 
 class ArgParser {
 
@@ -54,12 +55,16 @@ public:
   NetworkGraph *network_graph;
   Glia *glia;
   InputControlManager *input_controls;  // Input controls for sensory neurons
+  SimulationThread *simulation;          // Steps glia off the render loop (--sim-thread), or NULL
   InputSequence *input_sequence;         // Currently active input sequence
   std::vector<InputSequence*> loaded_tests;  // Pre-loaded test sequences (accessible via 1-9)
   MeshData *mesh_data;
   BoundingBox *bbox;
   
   bool use_network;  // true = render network, false = render cloth
+  double layout_repulsion;  // --repulsion K: short-range repulsion in the network layout (0 = off)
+  bool layout_thread;       // --physics-thread: step the network layout on a worker thread
+  bool sim_thread;          // --sim-thread: tick the network on its own thread
 };
 
 extern ArgParser *GLOBAL_args;
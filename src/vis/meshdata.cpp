@@ -12,6 +12,7 @@
 #include "network_graph.h"
 #include "glia.h"
 #include "input_control.h"
+#include "simulation_thread.h"
 #include "../arch/input_sequence.h"
 #include "OpenGLCanvas.h"
 
@@ -68,7 +69,68 @@ extern "C" {
     }
   }
 
+  // With --sim-thread: hand this frame's controls to the simulation thread and show its
+  // newest snapshot (the thread ticks glia; the render thread never touches it)
+  static void SyncSimulation() {
+    ArgParser *args = GLOBAL_args;
+    NetworkGraph *graph = args->network_graph;
+    MeshData *data = args->mesh_data;
+
+    SimulationControls controls;
+    controls.running = data->animate && !graph->isTrainingMode();
+    controls.seconds_per_tick = data->seconds_per_tick;
+    // Same inputs as Step(): keyboard toggles, then mouse sliders
+    for (const auto& kv : OpenGLCanvas::sensory_input_enabled) {
+      if (kv.second) {
+        controls.inputs.push_back(std::make_pair(kv.first, 200.0f));
+      }
+    }
+    if (args->input_controls) {
+      for (int i = 0; i < 100; i++) {
+        std::string neuron_id = "S" + std::to_string(i);
+        float input = args->input_controls->getInputForNeuron(neuron_id);
+        if (input > 0.0f) {
+          controls.inputs.push_back(std::make_pair(neuron_id, input));
+        }
+      }
+    }
+    args->simulation->setControls(controls);
+
+    if (graph->isTrainingMode()) {
+      if (data->animate) {
+        for (int i = 0; i < 10; i++) {
+          graph->animatePhysics();
+        }
+        graph->packMesh();
+      }
+      return;
+    }
+
+    const SimulationSnapshot *snapshot = args->simulation->latestSnapshot();
+    if (snapshot) {
+      data->current_tick = int(snapshot->tick);
+      graph->updateActivationStates(snapshot->fired.empty() ? nullptr : snapshot->fired.data());
+      if (snapshot->sequence_finished) {
+        data->animate = false;
+        std::cout << "\nTest sequence completed. Press 'A' to run again." << std::endl;
+      }
+    } else if (data->animate) {
+      graph->updateActivationStates(nullptr);  // Let flashes fade between snapshots
+    } else {
+      return;
+    }
+    graph->updateColors();
+    graph->packMesh();
+  }
+
   void Step() {
+    if (GLOBAL_args->use_network && GLOBAL_args->simulation) {
+      // Single step: one tick on the simulation thread
+      if (GLOBAL_args->network_graph && !GLOBAL_args->network_graph->isTrainingMode()) {
+        GLOBAL_args->simulation->requestTick();
+      }
+      return;
+    }
     if (GLOBAL_args->use_network) {
       // Network simulation step
       if (GLOBAL_args->glia && GLOBAL_args->network_graph) {
@@ -162,6 +224,10 @@ extern "C" {
   }
 
   void Animate() {
+    if (GLOBAL_args->use_network && GLOBAL_args->simulation && GLOBAL_args->network_graph) {
+      SyncSimulation();
+      return;
+    }
     if (GLOBAL_args->mesh_data->animate) {
       for (int i = 0; i < 10; i++) {
         Step();
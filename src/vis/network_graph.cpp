@@ -7,6 +7,7 @@
 #include <queue>
 #include <set>
 #include <cmath>
+#include <chrono>
 
 extern MeshData *mesh_data;
 
@@ -19,6 +20,10 @@ NetworkGraph::NetworkGraph(Glia* network, ArgParser *_args) {
     args = _args;
     glia = network;
     training_mode = false;  // Start in inference mode
+    physics_stop = false;
+    published_new = false;
+    max_layer_depth = 1;
+    stream_rendering = false;
     
     // Initialize vertex counts
     connection_vertex_count = 0;
@@ -37,6 +42,7 @@ NetworkGraph::NetworkGraph(Glia* network, ArgParser *_args) {
     damping = 0.8;                // Increased damping for faster convergence (was 0.5)
     provot_structural_correction = 1.05;  // Tighter constraint (was 1.1)
     timestep = 0.01;              // Physics timestep
+    repulsion = args ? args->layout_repulsion : 0.0;  // Off by default
 
     std::cout << "Building network graph..." << std::endl;
     // Build network graph from Glia
@@ -45,6 +51,9 @@ NetworkGraph::NetworkGraph(Glia* network, ArgParser *_args) {
     initializeSpatialLayout();
     std::cout << "Computing bounding box..." << std::endl;
     computeBoundingBox();
+    buildSprings();
+    loadLayout(layout);
+    if (args && args->layout_thread) startPhysicsThread();
     
     // Output selection is handled by output_detector; no default index
     
@@ -56,6 +65,7 @@ NetworkGraph::NetworkGraph(Glia* network, ArgParser *_args) {
 // =====================================================================================
 
 NetworkGraph::~NetworkGraph() {
+    stopPhysicsThread();
     for (auto* p : particles) {
         delete p;
     }
@@ -86,11 +96,11 @@ void NetworkGraph::buildFromGlia(Glia* network) {
         particle_map[id] = p;
     }
 
-    // 2. Create interneurons and outputs (N* and O* neurons)
+    // 2. Create interneurons and outputs (every non-sensory neuron: N*, H*, O*)
     std::vector<Neuron*> interneurons;
     network->forEachNeuron([&](Neuron& n) {
         std::string id = n.getId();
-        if (id[0] == 'N' || id[0] == 'O') {  // Both N* and O* neurons
+        if (id[0] != 'S') {
             interneurons.push_back(&n);
         }
     });
@@ -111,7 +121,7 @@ void NetworkGraph::buildFromGlia(Glia* network) {
         const auto& connections = neuron->getConnections();
         
         for (const auto& conn : connections) {
-            std::string target_id = conn.first;
+            const std::string &target_id = nid::name(conn.first);
             float weight = conn.second.first;
             
             NeuronParticle* target = getParticleById(target_id);
@@ -151,6 +161,13 @@ void NetworkGraph::buildFromGlia(Glia* network) {
             output_neuron_ids.push_back(id);
         }
     }
+    std::vector<std::string> particle_ids;
+    for (auto* p : particles) {
+        particle_ids.push_back(p->getId());
+    }
+    particle_handles = glia->getNeuronHandles(particle_ids);
+    output_neuron_handles = glia->getNeuronHandles(output_neuron_ids);
+    output_detector.setOutputs(output_neuron_ids, output_neuron_handles);
 
     std::cout << "Built network graph: " 
               << sensory_neurons.size() << " sensory, "
@@ -212,6 +229,7 @@ void NetworkGraph::initializeSpatialLayout() {
         max_depth = std::max(max_depth, kv.second);
     }
     if (max_depth == 0) max_depth = 1;  // Avoid division by zero
+    max_layer_depth = max_depth;
 
     // Count neurons by type
     int sensory_count = 0;
@@ -275,17 +293,10 @@ Vec3f NetworkGraph::computeOutputPosition(int index, int total) {
 
 Vec3f NetworkGraph::computeInterneuronPosition(int index, int total, int layer_depth) {
     // Position based on layer depth (X) with random Y/Z spread within layer
-    
-    // Find max depth
-    int max_depth = 0;
-    for (const auto& kv : layer_depths) {
-        max_depth = std::max(max_depth, kv.second);
-    }
-    if (max_depth == 0) max_depth = 1;
 
     // X position based on layer depth
     float x_range = x_right - x_left;
-    float x = x_left + (x_range / float(max_depth + 1)) * float(layer_depth);
+    float x = x_left + (x_range / float(max_layer_depth + 1)) * float(layer_depth);
 
     // Y and Z spread randomly within bounds
     float y = -y_span / 2.0f + (float(rand()) / RAND_MAX) * y_span;
@@ -298,12 +309,9 @@ Vec3f NetworkGraph::computeInterneuronPosition(int index, int total, int layer_d
 // Physics Simulation (Training Mode)
 // =====================================================================================
 
-Vec3f NetworkGraph::computeSpringForce(NeuronParticle* p1, NeuronParticle* p2, double weight) {
-    // F = k * (L0 - L) * direction
-    // k is proportional to |weight| (stronger weights = stronger spring)
-    
-    double k = k_connection * std::abs(weight) / 120.0;  // Normalize by max weight
-    Vec3f diff = p1->getPosition() - p2->getPosition();
+Vec3f NetworkGraph::computeSpringForce(const Vec3f &p1, const Vec3f &p2, double k) const {
+    // F = k * (L0 - L) * direction, the force on p1
+    Vec3f diff = p1 - p2;
     double length = diff.Length();
     
     if (length < 0.001) return Vec3f(0, 0, 0);  // Avoid division by zero
@@ -315,44 +323,79 @@ Vec3f NetworkGraph::computeSpringForce(NeuronParticle* p1, NeuronParticle* p2, d
     return spring_force;
 }
 
-void NetworkGraph::animatePhysics() {
-    if (!training_mode) return;  // Only update physics in training mode
+void NetworkGraph::buildSprings() {
+    std::map<const NeuronParticle*, int> index;
+    for (size_t i = 0; i < particles.size(); i++) {
+        index[particles[i]] = int(i);
+    }
 
-    double h = timestep;
+    springs.clear();
+    particle_free.assign(particles.size(), 0);
+    particle_clamped.assign(particles.size(), 0);
+    particle_inv_mass.assign(particles.size(), 0.0);
+    for (size_t i = 0; i < particles.size(); i++) {
+        NeuronParticle* p = particles[i];
+        particle_free[i] = !p->isFixed();
+        particle_clamped[i] = p->getType() == NeuronType::INTERNEURON;
+        particle_inv_mass[i] = 1.0 / p->getMass();
+        for (const auto& conn : p->getConnections()) {
+            // k is proportional to |weight| (stronger weights = stronger spring)
+            Spring s;
+            s.a = int(i);
+            s.b = index[conn.target];
+            s.k = k_connection * std::abs(conn.weight) / 120.0;  // Normalize by max weight
+            springs.push_back(s);
+        }
+    }
+}
 
-    // Compute forces and update positions for all free particles
-    for (auto* p : particles) {
-        if (p->isFixed()) continue;  // Skip anchored neurons
+void NetworkGraph::loadLayout(Layout &l) const {
+    l.position.resize(particles.size());
+    l.velocity.resize(particles.size());
+    l.acceleration.resize(particles.size());
+    for (size_t i = 0; i < particles.size(); i++) {
+        l.position[i] = particles[i]->getPosition();
+        l.velocity[i] = particles[i]->getVelocity();
+        l.acceleration[i] = particles[i]->getAcceleration();
+    }
+}
 
-        Vec3f total_force(0, 0, 0);
+void NetworkGraph::storeLayout(const Layout &l) {
+    for (size_t i = 0; i < particles.size(); i++) {
+        particles[i]->setPosition(l.position[i]);
+        particles[i]->setVelocity(l.velocity[i]);
+        particles[i]->setAcceleration(l.acceleration[i]);
+    }
+}
 
-        // Spring forces from all connections
-        for (const auto& conn : p->getConnections()) {
-            Vec3f spring_force = computeSpringForce(p, conn.target, conn.weight);
-            total_force += spring_force;
-        }
+void NetworkGraph::stepLayout(Layout &l) const {
+    double h = timestep;
+    const size_t n = l.position.size();
+
+    // Spring forces: each connection pulls on its source and (mutual attraction) its target
+    l.force.assign(n, Vec3f(0, 0, 0));
+    for (const Spring &s : springs) {
+        Vec3f spring_force = computeSpringForce(l.position[s.a], l.position[s.b], s.k);
+        l.force[s.a] += spring_force;
+        l.force[s.b] -= spring_force;
+    }
 
-        // Also consider incoming connections (mutual attraction)
-        for (auto* other : particles) {
-            for (const auto& conn : other->getConnections()) {
-                if (conn.target == p) {
-                    Vec3f spring_force = computeSpringForce(p, other, conn.weight);
-                    total_force += spring_force;
-                }
-            }
-        }
+    if (repulsion > 0.0) addRepulsion(l);
+
+    // Update positions for all free particles
+    for (size_t i = 0; i < n; i++) {
+        if (!particle_free[i]) continue;  // Skip anchored neurons
 
         // Damping force
-        Vec3f damping_force = p->getVelocity() * float(-damping);
-        total_force += damping_force;
+        Vec3f total_force = l.force[i] + l.velocity[i] * float(-damping);
 
         // Euler integration
-        Vec3f acceleration = total_force * float(1.0 / p->getMass());
-        Vec3f new_velocity = p->getVelocity() + acceleration * float(h);
-        Vec3f new_position = p->getPosition() + new_velocity * float(h);
+        Vec3f acceleration = total_force * float(particle_inv_mass[i]);
+        Vec3f new_velocity = l.velocity[i] + acceleration * float(h);
+        Vec3f new_position = l.position[i] + new_velocity * float(h);
 
         // Apply layer constraints for interneurons (keep them in middle layer)
-        if (p->getType() == NeuronType::INTERNEURON) {
+        if (particle_clamped[i]) {
             float x_margin = 0.8f;  // Keep interneurons at least 0.8 units from edges
             if (new_position.x() < x_left + x_margin) {
                 new_position.setx(x_left + x_margin);
@@ -364,64 +407,180 @@ void NetworkGraph::animatePhysics() {
             }
         }
 
-        p->setAcceleration(acceleration);
-        p->setVelocity(new_velocity);
-        p->setPosition(new_position);
+        l.acceleration[i] = acceleration;
+        l.velocity[i] = new_velocity;
+        l.position[i] = new_position;
     }
 
     // Apply Provot correction
-    applyProvotCorrection();
+    applyProvotCorrection(l);
+}
+
+void NetworkGraph::addRepulsion(Layout &l) const {
+    // Pairs closer than a cutoff c push apart with (1/d^2 - 1/c^2). Particles are binned
+    // into a hashed grid of c-sized cells (counting sort) and each particle only tests the
+    // 27 cells around it. c starts at the rest length and is halved while a particle
+    // shares its cell with more than a few others on average (layers and the anchor
+    // planes are dense), so a step stays O(N) however the particles bunch up.
+    const int n = int(l.position.size());
+    if (n < 2) return;
+    size_t table = 1;
+    while (table < size_t(2 * n)) table <<= 1;
+    const size_t mask = table - 1;
+
+    double cell = rest_length;
+    auto cellOf = [&](const Vec3f &p, int axis) { return int(std::floor(p[axis] / cell)); };
+    auto hash = [&](int x, int y, int z) {
+        return ((size_t(x) * 73856093u) ^ (size_t(y) * 19349663u) ^ (size_t(z) * 83492791u)) & mask;
+    };
+
+    for (int attempt = 0; ; attempt++) {
+        l.cell_start.assign(table + 1, 0);
+        for (int i = 0; i < n; i++) {
+            const Vec3f &p = l.position[i];
+            l.cell_start[hash(cellOf(p, 0), cellOf(p, 1), cellOf(p, 2)) + 1]++;
+        }
+        double shared = 0.0;  // Mean number of particles in a particle's cell
+        for (size_t c = 1; c <= table; c++) shared += double(l.cell_start[c]) * l.cell_start[c];
+        if (shared / n <= 8.0 || attempt == 8) break;
+        cell *= 0.5;
+    }
+    for (size_t c = 0; c < table; c++) l.cell_start[c + 1] += l.cell_start[c];
+    l.cell_items.resize(n);
+    std::vector<int> fill(l.cell_start.begin(), l.cell_start.end() - 1);
+    for (int i = 0; i < n; i++) {
+        const Vec3f &p = l.position[i];
+        l.cell_items[fill[hash(cellOf(p, 0), cellOf(p, 1), cellOf(p, 2))]++] = i;
+    }
+
+    const double cutoff2 = cell * cell;
+    const double min_d2 = 0.0025 * cutoff2;  // Soften very close pairs (d < 0.05 c)
+    size_t buckets[27];
+    for (int i = 0; i < n; i++) {
+        if (!particle_free[i]) continue;
+        const Vec3f &p = l.position[i];
+        const int cx = cellOf(p, 0), cy = cellOf(p, 1), cz = cellOf(p, 2);
+
+        // Neighbouring cells can share a bucket; visit each bucket once
+        int nb = 0;
+        for (int dx = -1; dx <= 1; dx++)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dz = -1; dz <= 1; dz++)
+                    buckets[nb++] = hash(cx + dx, cy + dy, cz + dz);
+        std::sort(buckets, buckets + nb);
+        nb = int(std::unique(buckets, buckets + nb) - buckets);
+
+        Vec3f total(0, 0, 0);
+        for (int b = 0; b < nb; b++) {
+            for (int k = l.cell_start[buckets[b]]; k < l.cell_start[buckets[b] + 1]; k++) {
+                const int j = l.cell_items[k];
+                if (j == i) continue;
+                Vec3f diff = p - l.position[j];
+                double d2 = diff.Dot3(diff);
+                if (d2 >= cutoff2 || d2 < 1e-12) continue;
+                double d = std::sqrt(d2);
+                double magnitude = repulsion * (1.0 / std::max(d2, min_d2) - 1.0 / cutoff2);
+                total += diff * float(magnitude / d);
+            }
+        }
+        l.force[i] += total;
+    }
 }
 
-void NetworkGraph::applyProvotCorrection() {
+void NetworkGraph::applyProvotCorrection(Layout &l) const {
     // Prevent springs from over-stretching
-    for (auto* p : particles) {
-        for (const auto& conn : p->getConnections()) {
-            NeuronParticle* target = conn.target;
-            
-            Vec3f diff = p->getPosition() - target->getPosition();
-            float length = diff.Length();
-            float max_length = rest_length * provot_structural_correction;
-
-            if (length > max_length) {
-                // Pull particles closer
-                Vec3f direction = diff;
-                direction /= length;
-                float excess = length - max_length;
-                Vec3f correction = direction * (excess / 2.0f);
-
-                if (!p->isFixed()) {
-                    p->setPosition(p->getPosition() - correction);
-                }
-                if (!target->isFixed()) {
-                    target->setPosition(target->getPosition() + correction);
-                }
+    float max_length = rest_length * provot_structural_correction;
+    for (const Spring &s : springs) {
+        Vec3f diff = l.position[s.a] - l.position[s.b];
+        float length = diff.Length();
+
+        if (length > max_length) {
+            // Pull particles closer
+            Vec3f direction = diff;
+            direction /= length;
+            float excess = length - max_length;
+            Vec3f correction = direction * (excess / 2.0f);
+
+            if (particle_free[s.a]) {
+                l.position[s.a] -= correction;
+            }
+            if (particle_free[s.b]) {
+                l.position[s.b] += correction;
             }
         }
     }
 }
 
+void NetworkGraph::animatePhysics() {
+    if (!training_mode) return;  // Only update physics in training mode
+
+    if (physics_thread.joinable()) {
+        std::lock_guard<std::mutex> lock(physics_mutex);
+        if (published_new) {
+            storeLayout(published);
+            published_new = false;
+        }
+        return;
+    }
+
+    stepLayout(layout);
+    storeLayout(layout);
+}
+
+void NetworkGraph::startPhysicsThread() {
+    if (physics_thread.joinable()) return;
+    physics_stop = false;
+    physics_thread = std::thread(&NetworkGraph::physicsLoop, this);
+}
+
+void NetworkGraph::stopPhysicsThread() {
+    if (!physics_thread.joinable()) return;
+    physics_stop = true;
+    physics_thread.join();
+    // animatePhysics() continues inline from where the thread stopped
+    storeLayout(layout);
+    published_new = false;
+}
+
+void NetworkGraph::physicsLoop() {
+    // The thread owns `layout` while it runs; the render thread only sees `published`
+    while (!physics_stop) {
+        if (!training_mode) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        stepLayout(layout);
+        std::lock_guard<std::mutex> lock(physics_mutex);
+        published.position = layout.position;
+        published.velocity = layout.velocity;
+        published.acceleration = layout.acceleration;
+        published_new = true;
+    }
+}
+
 // =====================================================================================
 // Visualization Updates (Inference Mode)
 // =====================================================================================
 
 void NetworkGraph::updateActivationStates() {
+    glia->getFiredMask(fired_mask);
+    updateActivationStates(fired_mask.data());
+}
+
+void NetworkGraph::updateActivationStates(const uint64_t* fired) {
     // Update all particles
-    for (auto* p : particles) {
-        p->updateActivationState();
+    for (size_t i = 0; i < particles.size(); i++) {
+        int h = particle_handles[i];
+        particles[i]->updateActivationState(fired && h >= 0 && ((fired[h >> 6] >> (h & 63)) & 1));
     }
-    
+    if (!fired) return;
+
     // Track output neuron firing rates
-    for (const auto& output_id : output_neuron_ids) {
-        Neuron* n = glia->getNeuronById(output_id);
-        if (n) {
-            output_detector.update(output_id, n->didFire());
-        }
-    }
+    output_detector.updateFromMask(fired);
     
     // Determine winner using detector with "sticky" behavior
     // Winner only changes if a different output has higher rate
-    std::string candidate = output_detector.predict(output_neuron_ids);
+    std::string candidate = output_detector.winner();
 
     if (current_winner.empty()) {
         if (!candidate.empty()) {
@@ -4,6 +4,10 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
 
 #include "argparser.h"
 #include "boundingbox.h"
@@ -27,7 +31,7 @@ public:
 
     // ACCESSORS
     const BoundingBox& getBoundingBox() const { return box; }
-    bool isTrainingMode() const { return training_mode; }
+    bool isTrainingMode() const { return training_mode.load(); }
     void setTrainingMode(bool mode) { training_mode = mode; }
     int getConnectionVertexCount() const { return connection_vertex_count; }
     int getNeuronVertexCount() const { return neuron_vertex_count; }
@@ -42,14 +46,36 @@ public:
     void computeBoundingBox();
 
     // PHYSICS SIMULATION (training mode)
+    // One layout step per call, or, with the physics thread running, the latest positions
+    // the thread has published (the thread steps at its own rate, independent of frames)
     void animatePhysics();
-    void applyProvotCorrection();
+    void startPhysicsThread();
+    void stopPhysicsThread();
+    bool isPhysicsThreadRunning() const { return physics_thread.joinable(); }
 
     // VISUALIZATION UPDATES (inference mode)
     void updateActivationStates();
+    // From a fired mask in Glia::getFiredMask() layout (nullptr: nothing fired), without
+    // touching the network (e.g. a SimulationThread snapshot)
+    void updateActivationStates(const uint64_t* fired);
     void updateColors();
 
     // RENDERING
+    // packMesh() fills mesh_data->clothTriData with every connection and neuron. With
+    // stream rendering on (the OpenGL renderer) it only packs the neuron stream: the
+    // connections are a static edge buffer the renderer uploads once, and a frame costs
+    // O(neurons) on the CPU and in upload.
+    struct EdgeVertex {
+        int32_t neuron;                              // Particle this end is drawn at
+        int32_t source;                              // Source particle (its spike trace flashes the line)
+        float color[4];                              // Weight sign color, alpha from |weight|
+    };
+    static const int neuron_stream_floats = 8;       // position.xyz + size, color.rgb + spike trace
+    void setStreamRendering(bool on) { stream_rendering = on; }
+    bool isStreamRendering() const { return stream_rendering; }
+    const std::vector<EdgeVertex>& getEdgeVertices();
+    const std::vector<float>& getNeuronStream() const { return neuron_stream; }
+    void packNeuronStream();
     void packMesh();
     void packTestFloor(float* &current);   // Test floor for visibility
     void packNeurons(float* &current);
@@ -67,7 +93,26 @@ private:
     Vec3f computeInterneuronPosition(int index, int total, int layer_depth);
     
     // PHYSICS HELPERS
-    Vec3f computeSpringForce(NeuronParticle* p1, NeuronParticle* p2, double weight);
+    // The layout is simulated on flat arrays indexed like `particles`. Every connection is
+    // one spring that pulls on both of its ends, so a step is a single pass over the
+    // springs; repulsion (optional) only looks at particles in neighbouring grid cells.
+    struct Spring {
+        int a, b;      // particle indices, a -> b
+        double k;      // k_connection * |weight| / 120
+    };
+    struct Layout {
+        std::vector<Vec3f> position, velocity, acceleration;
+        std::vector<Vec3f> force;                    // scratch
+        std::vector<int> cell_start, cell_items;     // repulsion grid scratch
+    };
+    void buildSprings();
+    void loadLayout(Layout &l) const;                // particles -> l
+    void storeLayout(const Layout &l);               // l -> particles
+    void stepLayout(Layout &l) const;
+    void addRepulsion(Layout &l) const;
+    void applyProvotCorrection(Layout &l) const;
+    Vec3f computeSpringForce(const Vec3f &p1, const Vec3f &p2, double k) const;
+    void physicsLoop();
 
     // REPRESENTATION
     Glia* glia;                                      // Pointer to neural network
@@ -75,11 +120,13 @@ private:
 
     std::vector<NeuronParticle*> particles;          // All neurons as particles
     std::map<std::string, NeuronParticle*> particle_map;  // ID -> particle lookup
+    std::vector<int> particle_handles;               // Glia handle per particle
     std::map<std::string, int> layer_depths;         // Neuron ID -> connectivity depth
+    int max_layer_depth;                             // Max of layer_depths (at least 1)
 
     BoundingBox box;                                 // Bounding box for rendering
 
-    bool training_mode;                              // Training vs inference mode
+    std::atomic<bool> training_mode;                 // Training vs inference mode
 
     // SPATIAL LAYOUT PARAMETERS
     float x_left;                                    // X coordinate for sensory plane
@@ -93,12 +140,34 @@ private:
     double damping;                                  // Velocity damping
     double provot_structural_correction;             // Max stretch before correction
     double timestep;                                 // Physics timestep
+    double repulsion;                                // Short-range repulsion strength (0 = off)
+
+    // LAYOUT STATE
+    std::vector<Spring> springs;                     // One per connection, in particle order
+    std::vector<char> particle_free;                 // Per particle: !isFixed()
+    std::vector<char> particle_clamped;              // Per particle: interneuron (x kept off the planes)
+    std::vector<double> particle_inv_mass;
+    Layout layout;                                   // Stepped by animatePhysics() without a thread
+
+    // PHYSICS THREAD
+    std::thread physics_thread;
+    std::atomic<bool> physics_stop;
+    std::mutex physics_mutex;                        // Guards published / published_new
+    Layout published;                                // Latest positions from the thread
+    bool published_new;
 
     // OUTPUT NEURON TRACKING
     std::vector<std::string> output_neuron_ids;      // IDs of output neurons
-    EMAOutputDetector output_detector;               // Tracks firing rates to determine winner
+    std::vector<int> output_neuron_handles;          // Glia handles, parallel to output_neuron_ids
+    EMASlotDetector output_detector;                 // Tracks firing rates to determine winner (slots = output_neuron_ids)
+    std::vector<uint64_t> fired_mask;                // Glia::getFiredMask() scratch
     std::string current_winner;                      // Current winning output (from firing rate)
     
+    // STREAM RENDERING
+    bool stream_rendering;
+    std::vector<EdgeVertex> edge_vertices;           // Built on first use (topology is fixed)
+    std::vector<float> neuron_stream;                // neuron_stream_floats per particle
+
     // RENDERING VERTEX COUNTS (for separate draw calls)
     int connection_vertex_count;                     // Number of vertices for lines
     int neuron_vertex_count;                         // Number of vertices for points
@@ -1,5 +1,6 @@
 #include <cstring>
 #include <iostream>
+#include <map>
 #include "network_graph.h"
 #include "neuron_particle.h"
 #include "meshdata.h"
@@ -56,6 +57,13 @@ void AddPoint(float* &current, const Vec3f &pos, const Vec3f &color, float size)
 // ================================================================================
 
 void NetworkGraph::packMesh() {
+    if (stream_rendering) {
+        connection_vertex_count = int(getEdgeVertices().size());
+        neuron_vertex_count = particles.size();
+        packNeuronStream();
+        return;
+    }
+
     // Count connection vertices (lines = 2 vertices per connection)
     connection_vertex_count = 0;
     for (auto* p : particles) {
@@ -95,6 +103,46 @@ void NetworkGraph::packMesh() {
     }
 }
 
+const std::vector<NetworkGraph::EdgeVertex>& NetworkGraph::getEdgeVertices() {
+    if (!edge_vertices.empty()) return edge_vertices;
+
+    std::map<const NeuronParticle*, int> index;
+    for (size_t i = 0; i < particles.size(); i++) {
+        index[particles[i]] = int(i);
+    }
+    for (size_t i = 0; i < particles.size(); i++) {
+        for (const auto& conn : particles[i]->getConnections()) {
+            // Same colors as packConnections(), before the spike trace is applied
+            double weight = conn.weight;
+            float alpha = std::min(1.0f, float(std::abs(weight) / 120.0));
+            EdgeVertex v = { int32_t(i), int32_t(i), { 0.0f, 0.0f, 0.0f, alpha } };
+            v.color[weight > 0 ? 1 : 0] = 0.8f;  // Excitatory: green, inhibitory: red
+            edge_vertices.push_back(v);
+            v.neuron = index[conn.target];
+            edge_vertices.push_back(v);
+        }
+    }
+    return edge_vertices;
+}
+
+void NetworkGraph::packNeuronStream() {
+    neuron_stream.resize(particles.size() * neuron_stream_floats);
+    float *current = neuron_stream.data();
+    for (auto* p : particles) {
+        const Vec3f &pos = p->getPosition();
+        const Vec3f &color = p->getCurrentColor();
+        current[0] = float(pos.x());
+        current[1] = float(pos.y());
+        current[2] = float(pos.z());
+        current[3] = p->getSize();
+        current[4] = float(color.r());
+        current[5] = float(color.g());
+        current[6] = float(color.b());
+        current[7] = p->getSpikeTrace();
+        current += neuron_stream_floats;
+    }
+}
+
 void NetworkGraph::packTestFloor(float* &current) {
     // Create a gray floor at y = -3, spanning x=[-10,10] z=[-10,10]
     float y = -3.0f;
@@ -148,7 +196,7 @@ void NetworkGraph::packConnections(float* &current) {
             NeuronParticle* target = conn.target;
             Vec3f end_pos = target->getPosition();
             double weight = conn.weight;
-            float activation = conn.activation;
+            float activation = p->getSpikeTrace();
             
             // Color based on weight sign
             Vec3f base_color;
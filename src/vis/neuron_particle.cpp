@@ -41,6 +41,7 @@ NeuronParticle::NeuronParticle(const std::string &id, Neuron* neuron, NeuronType
 
     current_color = base_color;
     activation_level = 0.0f;
+    spike_trace = 0.0f;
     is_firing = false;
     is_winner_output = false;
 }
@@ -89,11 +90,11 @@ void NeuronParticle::addConnection(NeuronParticle* target, double weight) {
 
 void NeuronParticle::updateActivationState() {
     // Query the actual neuron's firing state
-    if (neuron_ptr) {
-        is_firing = neuron_ptr->didFire();
-    } else {
-        is_firing = false;
-    }
+    updateActivationState(neuron_ptr && neuron_ptr->didFire());
+}
+
+void NeuronParticle::updateActivationState(bool fired) {
+    is_firing = fired;
 
     // Update activation level with instant jump on fire, smooth decay otherwise
     if (is_firing) {
@@ -106,6 +107,7 @@ void NeuronParticle::updateActivationState() {
         // Clamp to zero when very small
         if (activation_level < 0.01f) {
             activation_level = 0.0f;
+    spike_trace = 0.0f;
         }
     }
 }
@@ -120,15 +122,14 @@ void NeuronParticle::updateColor(float alpha) {
     // Interpolate between base and active colors
     current_color = base_color * float(1.0f - t) + active_color * float(t);
 
-    // Update connection activations (for spike propagation visualization)
-    for (auto& conn : connections) {
-        if (is_firing) {
-            conn.activation = 1.0f;  // Spike just sent
-        } else {
-            conn.activation *= (1.0f - alpha);  // Decay
-            if (conn.activation < 0.01f) {
-                conn.activation = 0.0f;
-            }
+    // Update the spike trace (shared by all outgoing connections, for spike propagation
+    // visualization)
+    if (is_firing) {
+        spike_trace = 1.0f;  // Spike just sent
+    } else {
+        spike_trace *= (1.0f - alpha);  // Decay
+        if (spike_trace < 0.01f) {
+            spike_trace = 0.0f;
         }
     }
 }
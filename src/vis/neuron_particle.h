@@ -52,6 +52,7 @@ public:
     const Vec3f& getCurrentColor() const { return current_color; }
     float getSize() const { return size; }
     float getActivationLevel() const { return activation_level; }
+    float getSpikeTrace() const { return spike_trace; }
     bool isFiring() const { return is_firing; }
 
     // VISUAL MODIFIERS
@@ -66,9 +67,8 @@ public:
     struct Connection {
         NeuronParticle* target;
         double weight;
-        float activation;  // For visualizing spike propagation
         
-        Connection(NeuronParticle* t, double w) : target(t), weight(w), activation(0.0f) {}
+        Connection(NeuronParticle* t, double w) : target(t), weight(w) {}
     };
 
     void addConnection(NeuronParticle* target, double weight);
@@ -77,6 +77,7 @@ public:
 
     // ACTIVATION UPDATE (for inference mode visualization)
     void updateActivationState();
+    void updateActivationState(bool fired);   // From a fired mask instead of the Neuron
     void updateColor(float alpha = 0.2f);
     void setWinner(bool is_winner) { is_winner_output = is_winner; }
 
@@ -100,6 +101,7 @@ private:
     Vec3f current_color;          // Current interpolated color
     float size;                   // Rendering radius
     float activation_level;       // Smoothed activation (0.0 to 1.0)
+    float spike_trace;            // Decaying trace of sent spikes (lights up outgoing connections)
     bool is_firing;               // Current firing state
     bool is_winner_output;        // True if this is the winning output (from firing rate)
 
@@ -0,0 +1,192 @@
+#include "simulation_thread.h"
+#include "glia.h"
+#include <algorithm>
+#include <chrono>
+
+// =====================================================================================
+// Constructor / Destructor
+// =====================================================================================
+
+SimulationThread::SimulationThread(Glia* network)
+    : glia(network), cursor(sequence)
+{
+    std::vector<std::string> ids = glia->getAllNeuronIDs();
+    sensory_ids.assign(ids.begin(), ids.begin() + glia->getSensoryCount());
+
+    sequence_changed = false;
+    has_pending_sequence = false;
+    reset_requested = false;
+    ticks_requested = 0;
+    commands_pending = false;
+
+    has_sequence = false;
+    tick_count = 0;
+    single_ticks = 0;
+    halted = false;
+
+    stop = false;
+    worker = std::thread(&SimulationThread::run, this);
+}
+
+SimulationThread::~SimulationThread() {
+    stop = true;
+    if (worker.joinable()) worker.join();
+}
+
+// =====================================================================================
+// Controls (render thread)
+// =====================================================================================
+
+void SimulationThread::setControls(const SimulationControls &c) {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    pending_controls = c;
+    commands_pending = true;
+}
+
+void SimulationThread::setSequence(const InputSequence* seq) {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    sequence_changed = true;
+    has_pending_sequence = seq != nullptr;
+    if (seq) pending_sequence = *seq;
+    reset_requested = true;
+    commands_pending = true;
+}
+
+void SimulationThread::resetTicks() {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    reset_requested = true;
+    commands_pending = true;
+}
+
+void SimulationThread::requestTick() {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    ticks_requested++;
+    commands_pending = true;
+}
+
+// =====================================================================================
+// Simulation loop (worker thread)
+// =====================================================================================
+
+void SimulationThread::applyCommands() {
+    std::lock_guard<std::mutex> lock(command_mutex);
+    commands_pending = false;
+
+    controls = pending_controls;
+    if (!controls.running) halted = false;  // A finished sequence waits for a stop/start
+    input_handles.clear();
+    input_values.clear();
+    for (const auto& kv : controls.inputs) {
+        input_handles.push_back(glia->getNeuronHandle(kv.first));
+        input_values.push_back(kv.second);
+    }
+
+    if (sequence_changed) {
+        has_sequence = has_pending_sequence;
+        if (has_sequence) {
+            sequence = pending_sequence;
+            compiled_sequence.compile(sequence, sensory_ids);
+        }
+        sequence_changed = false;
+    }
+    if (reset_requested) {
+        tick_count = 0;
+        cursor = SequenceCursor(sequence);
+        reset_requested = false;
+    }
+    single_ticks += ticks_requested;
+    ticks_requested = 0;
+}
+
+bool SimulationThread::tick() {
+    // Apply inputs: the input sequence if there is one, otherwise the manual inputs
+    if (has_sequence) {
+        if (cursor.tick > cursor.max_tick) {
+            // Test complete - pause and rewind for the next run
+            cursor = SequenceCursor(sequence);
+            return false;
+        }
+        CompiledInputSequence::Span in = compiled_sequence.at(cursor.tick);
+        glia->injectSensoryBatch(in.handles, in.values, in.size);
+        cursor.advance();
+    } else if (!input_handles.empty()) {
+        glia->injectSensoryBatch(input_handles.data(), input_values.data(), int(input_handles.size()));
+    }
+
+    glia->step();
+    tick_count++;
+
+    // Collect spikes for the next snapshot
+    glia->getFiredMask(fired_scratch);
+    std::vector<uint64_t> &fired = snapshots.writeSlot().fired;
+    if (fired.size() != fired_scratch.size()) fired.assign(fired_scratch.size(), 0);
+    for (size_t w = 0; w < fired.size(); w++) fired[w] |= fired_scratch[w];
+    return true;
+}
+
+void SimulationThread::publish(bool sequence_finished) {
+    SimulationSnapshot &s = snapshots.writeSlot();
+    s.tick = tick_count;
+    s.sequence_finished = sequence_finished;
+    bool unread = snapshots.publish();
+
+    // The new write slot starts empty, unless the renderer skipped it: then its spikes
+    // are kept and go out with the next snapshot
+    SimulationSnapshot &next = snapshots.writeSlot();
+    if (!unread) std::fill(next.fired.begin(), next.fired.end(), 0);
+    next.sequence_finished = false;
+}
+
+void SimulationThread::run() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration idle = std::chrono::milliseconds(2);
+    const Clock::duration max_lag = std::chrono::milliseconds(100);  // Older backlog is dropped
+    const Clock::duration publish_interval = std::chrono::milliseconds(4);
+
+    Clock::time_point next_tick = Clock::now();
+    Clock::time_point last_publish = Clock::now();
+    bool dirty = false;  // Ticks run since the last publish
+
+    while (!stop) {
+        if (commands_pending) applyCommands();
+
+        const bool running = controls.running && !halted;
+        const Clock::time_point now = Clock::now();
+        bool finished = false;
+
+        if (running) {
+            // Run the ticks that are due at the configured rate
+            Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(controls.seconds_per_tick));
+            if (period.count() <= 0) period = Clock::duration(1);
+            if (now - next_tick > max_lag) next_tick = now - max_lag;
+            while (next_tick <= now && !stop) {
+                if (!tick()) {
+                    finished = true;
+                    break;
+                }
+                next_tick += period;
+                dirty = true;
+                if (Clock::now() - last_publish >= publish_interval) break;  // Keep the renderer fed
+            }
+        } else {
+            next_tick = now;
+        }
+        while (single_ticks > 0 && !finished) {
+            single_ticks--;
+            finished = !tick();
+            dirty = dirty || !finished;
+        }
+        if (finished) halted = true;
+
+        if (finished || (dirty && (!running || Clock::now() - last_publish >= publish_interval))) {
+            publish(finished);
+            last_publish = Clock::now();
+            dirty = false;
+        }
+
+        if (!running || next_tick > Clock::now()) {
+            std::this_thread::sleep_until(running ? std::min(next_tick, now + idle) : now + idle);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef _SIMULATION_THREAD_H_
+#define _SIMULATION_THREAD_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../arch/input_sequence.h"
+
+// Forward declarations
+class Glia;
+
+// =====================================================================================
+// Triple Buffer - lock-free handoff of the newest value from one writer to one reader
+// =====================================================================================
+
+// The writer fills its back slot and swaps it with the middle one; the reader swaps its
+// front slot for the middle one when that holds something it hasn't seen. Neither side
+// ever waits on the other, and the reader always gets the newest complete value.
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), back(2), front(0) {}
+
+    // WRITER
+    T& writeSlot() { return slots[back]; }
+    // Publish the write slot. Returns true if the slot handed back for writing holds a
+    // publication the reader never took.
+    bool publish() {
+        int old = middle.exchange(back | fresh_bit);
+        back = old & index_mask;
+        return (old & fresh_bit) != 0;
+    }
+
+    // READER
+    // The newest publication, or nullptr if there is none since the last call
+    const T* read() {
+        if (!(middle.load() & fresh_bit)) return nullptr;
+        front = middle.exchange(front) & index_mask;
+        return &slots[front];
+    }
+
+private:
+    static const int index_mask = 3;
+    static const int fresh_bit = 4;
+
+    T slots[3];
+    std::atomic<int> middle;                         // Slot index | fresh_bit
+    int back;                                        // Writer's slot
+    int front;                                       // Reader's slot
+};
+
+// =====================================================================================
+// Simulation Thread - steps the network at its own tick rate, apart from rendering
+// =====================================================================================
+
+// What the renderer sees of the network
+struct SimulationSnapshot {
+    uint64_t tick = 0;                               // Ticks since the last reset
+    std::vector<uint64_t> fired;                     // Neurons that fired since the previous snapshot
+                                                     // (Glia::getFiredMask() layout); spikes of a
+                                                     // snapshot the renderer skipped carry over
+    bool sequence_finished = false;                  // The input sequence ran out (the thread paused)
+};
+
+// Set by the render thread every frame
+struct SimulationControls {
+    bool running = false;
+    double seconds_per_tick = 1.0;
+    std::vector<std::pair<std::string, float>> inputs;  // Manual sensory inputs, every tick
+};
+
+class SimulationThread {
+
+public:
+    // Starts paused. While the thread exists it is the only user of `network`.
+    explicit SimulationThread(Glia* network);
+    ~SimulationThread();
+
+    // CONTROLS (render thread; applied before the next tick)
+    void setControls(const SimulationControls &c);
+    void setSequence(const InputSequence* seq);      // Copied; nullptr returns to manual inputs
+    void resetTicks();                               // Tick counter and sequence back to the start
+    void requestTick();                              // One tick, also while paused
+
+    // STATE (render thread)
+    // Newest snapshot, or nullptr if nothing happened since the last call
+    const SimulationSnapshot* latestSnapshot() { return snapshots.read(); }
+
+private:
+    void run();
+    void applyCommands();
+    bool tick();                                     // False if the sequence is finished
+    void publish(bool sequence_finished);
+
+    // REPRESENTATION
+    Glia* glia;
+    std::vector<std::string> sensory_ids;            // In handle order (for CompiledInputSequence)
+
+    // Commands, guarded by command_mutex
+    std::mutex command_mutex;
+    SimulationControls pending_controls;
+    bool sequence_changed;
+    bool has_pending_sequence;
+    InputSequence pending_sequence;
+    bool reset_requested;
+    int ticks_requested;
+    std::atomic<bool> commands_pending;
+
+    // Thread-owned state
+    SimulationControls controls;
+    std::vector<int> input_handles;
+    std::vector<float> input_values;
+    bool has_sequence;
+    InputSequence sequence;
+    CompiledInputSequence compiled_sequence;
+    SequenceCursor cursor;
+    uint64_t tick_count;
+    int single_ticks;                                // Requested ticks not run yet
+    bool halted;                                     // Finished a sequence; waits for running = false
+    std::vector<uint64_t> fired_scratch;
+
+    TripleBuffer<SimulationSnapshot> snapshots;
+    std::atomic<bool> stop;
+    std::thread worker;
+};
+
+#endif // _SIMULATION_THREAD_H_
@@ -51,12 +51,78 @@ def test_network_wrapper():
     firing = net.get_firing_neurons()
     print(f"[OK] get_firing_neurons(): {len(firing)} neurons fired")
     
+    # Handles and fired mask
+    cpp = net._cpp
+    handles = cpp.get_handles(net.neuron_ids)
+    assert list(handles) == list(range(net.num_neurons))
+    assert cpp.get_handle("no-such-neuron") == -1
+    cpp.inject_batch(handles[:2], np.array([100.0, 50.0], dtype=np.float32))
+    net.step()
+    fired = net.get_fired()
+    assert len(fired) == net.num_neurons
+    assert all(fired[h] == cpp.did_fire(int(h)) for h in handles)
+    print(f"[OK] handles and fired mask work")
+    
+    # Zero-copy views
+    v = net.views()
+    assert v['ids'] == net.neuron_ids
+    assert len(v['weights']) == net.num_connections == v['row_offsets'][-1]
+    assert np.array_equal(v['values'], net.state['values'])
+    assert not v['targets'].flags.writeable
+    src = np.repeat(np.arange(net.num_neurons), np.diff(v['row_offsets']))
+    expected = {(v['ids'][s], v['ids'][t]): w for s, t, w in zip(src, v['targets'], v['weights'])}
+    from_ids, to_ids, weights = net.get_weights()
+    assert all(expected[(f, t)] == w for f, t, w in zip(from_ids, to_ids, weights))
+    v['weights'][:] *= 2.0
+    v['thresholds'][0] += 1.0
+    net.commit_views()
+    _, _, doubled = net.get_weights()
+    assert np.allclose(doubled, 2.0 * weights)
+    assert net.state['thresholds'][0] == v['thresholds'][0]
+    v['weights'][:] /= 2.0
+    v['thresholds'][0] -= 1.0
+    net.commit_views()
+    print(f"[OK] views() and commit_views() work")
+    
+    # Multi-step run() matches a Python step loop
+    a, b = net.clone(), net.clone()
+    drive = np.zeros((20, 2), dtype=np.float32)
+    drive[::3, 0] = 100.0
+    drive[1::4, 1] = 80.0
+    raster = a.run(drive)
+    assert raster.shape == (20, net.num_neurons) and raster.dtype == bool
+    for t in range(20):
+        b.inject_array(drive[t])
+        b.step()
+        assert np.array_equal(raster[t], b.get_fired())
+    ticks, chans = np.nonzero(drive)
+    counts = a.run((ticks, chans, drive[ticks, chans]), 20, record="counts")
+    stepped = np.zeros(net.num_neurons, dtype=np.int64)
+    for t in range(20):
+        b.inject_array(drive[t])
+        b.step()
+        stepped += b.get_fired()
+    assert counts.shape == (net.num_neurons,) and np.array_equal(counts, stepped)
+    assert np.array_equal(a.state['values'], b.state['values'])
+    print(f"[OK] run() works")
+    
+    # Clone
+    copy = net.clone()
+    assert copy.num_neurons == net.num_neurons
+    assert copy.num_connections == net.num_connections
+    assert np.array_equal(copy.state['values'], net.state['values'])
+    copy.step(n_steps=5)
+    net.step(n_steps=5)
+    assert np.array_equal(copy.state['values'], net.state['values'])
+    print(f"[OK] clone() works")
+    
     return True
 
 
 def test_trainer_wrapper():
     """Test Trainer wrapper class"""
     import glia
+    import numpy as np
     
     print("\n[Trainer Wrapper]")
     
@@ -77,6 +143,45 @@ def test_trainer_wrapper():
     assert isinstance(history, dict)
     print(f"[OK] History property works")
     
+    # On-disk checkpoint round trip into a copy of the network
+    import tempfile
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path = os.path.join(tmpdir, "trainer.gckpt")
+        trainer.save_checkpoint(path)
+        from_ids, to_ids, weights = net.get_weights()
+        copy = net.clone()
+        copy.set_weights(from_ids, to_ids, np.zeros_like(weights))
+        resumed = glia.Trainer(copy)
+        resumed.load_checkpoint(path)
+        assert np.array_equal(copy.get_weights()[2], weights)
+        assert resumed._cpp.epochs_completed() == trainer._cpp.epochs_completed()
+    print(f"[OK] save_checkpoint() / load_checkpoint() work")
+
+    # A trainer keeps working across reorder(): outputs are looked up by their new handles
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path = os.path.join(tmpdir, "reorder.net")
+        with open(path, "w") as f:
+            f.write("NEURON S0 100.0 1.0 0.0\nNEURON S1 100.0 1.0 0.0\n"
+                    "NEURON O0 50.0 1.0 0.0\nNEURON H0 50.0 1.0 0.0\nNEURON O1 50.0 1.0 0.0\n"
+                    "CONNECTION S0 O0 60.0\nCONNECTION S1 O1 30.0\n"
+                    "CONNECTION S0 H0 10.0\nCONNECTION H0 O1 10.0\n")
+        seq = glia.InputSequence()
+        for t in range(20):
+            seq.add_timestep({"S0": 120.0} if t % 3 == 0 else {})
+        cfg = glia.create_config()
+        cfg.warmup_ticks = 0
+        cfg.decision_window = 20
+        for use_gradient in (False, True):
+            net = glia.Network.from_file(path, verbose=False)
+            trainer = glia.Trainer(net, cfg, use_gradient=use_gradient)
+            trainer.evaluate(seq)
+            net.reorder()
+            after = trainer.evaluate(seq)
+            fresh = glia.Trainer(net, cfg, use_gradient=use_gradient).evaluate(seq)
+            assert after.winner_id == fresh.winner_id == "O0", (after.winner_id, fresh.winner_id)
+            assert after.rates == fresh.rates
+    print(f"[OK] Trainer follows reorder()")
+
     return True
 
 
@@ -123,7 +228,25 @@ def test_dataset():
     shuffled = dataset.shuffle(seed=42)
     assert len(shuffled) == len(dataset)
     print(f"[OK] Shuffle works")
-    
+
+    # Packed (.gds) round trip
+    import tempfile
+    with tempfile.TemporaryDirectory() as tmpdir:
+        with open(os.path.join(tmpdir, "a.seq"), "w") as f:
+            f.write("0 S0 1.0\n3 S1 0.5\n")
+        with open(os.path.join(tmpdir, "b.seq"), "w") as f:
+            f.write("1 S1 2.0\n")
+        with open(os.path.join(tmpdir, "labels.csv"), "w") as f:
+            f.write("filename,label\na.seq,0\nb.seq,1\n")
+        gds = os.path.join(tmpdir, "episodes.gds")
+        assert glia._core.pack_labels_csv(tmpdir, gds) == 2
+        packed = glia.Dataset.from_packed(gds)
+        assert len(packed) == 2
+        assert [ep.target_id for ep in packed.episodes] == ["O0", "O1"]
+        ticks, channels, values = glia._core.SpikeDataset(gds).events(0)
+        assert list(ticks) == [0, 3] and list(values) == [1.0, 0.5]
+    print(f"[OK] Packed dataset works")
+
     return True
 
 
@@ -184,9 +307,18 @@ def test_file_io():
         assert net2.num_neurons == net1.num_neurons
         print(f"[OK] Neuron counts match")
         
+        # Binary round trip (.gnet chosen by extension, detected on load)
+        bin_path = temp_path[:-len('.net')] + '.gnet'
+        net2.save(bin_path)
+        net3 = glia.Network.from_file(bin_path, verbose=False)
+        assert net3.num_neurons == net2.num_neurons
+        assert net3.num_connections == net2.num_connections
+        print(f"[OK] .gnet round trip works")
+        
     finally:
-        if os.path.exists(temp_path):
-            os.remove(temp_path)
+        for path in (temp_path, temp_path[:-len('.net')] + '.gnet'):
+            if os.path.exists(path):
+                os.remove(path)
     
     return True
 
@@ -39,5 +39,11 @@ detector_cfg = glia.OutputDetectorConfig()
 detector_cfg.alpha = 0.1
 detector_cfg.threshold = 0.02
 print(f"✓ OutputDetectorConfig: alpha={detector_cfg.alpha}, threshold={detector_cfg.threshold}")
+detector_cfg.type = "count"
+detector_cfg.window = 20
+detector_cfg.early_exit = True
+detector_cfg.early_exit_margin = 0.3
+assert detector_cfg.window == 20 and detector_cfg.early_exit
+print(f"✓ OutputDetectorConfig: type={detector_cfg.type}, window={detector_cfg.window}, early_exit={detector_cfg.early_exit}")
 
 print("\n✓ All optimizer bindings working correctly!")
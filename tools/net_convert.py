@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+"""
+Convert a network between the text (.net) and binary (.gnet) formats.
+
+Usage:
+  python tools/net_convert.py examples/seq_digits_poisson/nets/readout_a.net /tmp/readout_a.gnet
+  python tools/net_convert.py /tmp/readout_a.gnet /tmp/readout_a.net
+
+The input format is detected from the file contents and the output format is chosen
+by the output extension (.gnet = binary, anything else = text).
+Note: NEWNET text files are generated on load, so each conversion samples new weights.
+"""
+
+import argparse
+import os
+import sys
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('input', help='network file (.net or .gnet)')
+    ap.add_argument('output', help='output path; .gnet writes the binary format')
+    ap.add_argument('--verbose', action='store_true', help='print loading info')
+    args = ap.parse_args()
+
+    import glia
+
+    if not os.path.exists(args.input):
+        print(f"Error: input not found: {args.input}", file=sys.stderr)
+        return 1
+    net = glia.Network.from_file(args.input, verbose=args.verbose)
+    if net.num_neurons == 0:
+        print(f"Error: no neurons loaded from {args.input}", file=sys.stderr)
+        return 1
+    net.save(args.output)
+    print(f"{args.input} -> {args.output}: {net.num_neurons} neurons, {net.num_connections} connections")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""
+Freeze a trained network into a compact .gnet for inference.
+
+Usage:
+  python tools/net_freeze.py trained.net frozen.gnet
+  python tools/net_freeze.py trained.gnet frozen.gnet --min-weight 0.05
+
+Edges with |weight| below --min-weight are pruned, neurons that can't affect an output
+(never reached from a sensory neuron, or without a path to an O* neuron) are dropped,
+and the rest are renumbered in layer order (--keep-order to skip that). Neuron IDs are
+unchanged, so the frozen file works with the same input sequences and readout.
+"""
+
+import argparse
+import os
+import sys
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('input', help='trained network (.net or .gnet)')
+    ap.add_argument('output', help='frozen network path (.gnet)')
+    ap.add_argument('--min-weight', type=float, default=0.0, help='drop edges with |weight| below this')
+    ap.add_argument('--keep-order', action='store_true', help='keep the neuron order instead of renumbering by layer')
+    ap.add_argument('--verbose', action='store_true', help='print loading info')
+    args = ap.parse_args()
+
+    import glia
+
+    if not os.path.exists(args.input):
+        print(f"Error: input not found: {args.input}", file=sys.stderr)
+        return 1
+    net = glia.Network.from_file(args.input, verbose=args.verbose)
+    if net.num_neurons == 0:
+        print(f"Error: no neurons loaded from {args.input}", file=sys.stderr)
+        return 1
+    net.freeze(args.output, min_weight=args.min_weight, reorder=not args.keep_order)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
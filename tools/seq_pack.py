@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+Pack a directory of .seq episodes into one binary spike dataset (.gds).
+
+Usage:
+  python tools/seq_pack.py examples/seq_digits_poisson/data/train data/train/episodes.gds
+  python tools/seq_pack.py examples/mini-world/data/run1 run1/episodes.gds
+
+Two layouts are recognised:
+  labels.csv             "filename,label" rows; label k becomes target O<k>
+                         (packed by the C++ loader, so episodes replay exactly)
+  seq/ + labels/labels_counts.csv
+                         mini-world runs; each clip's target is O<true_count>
+
+Load the result with glia.Dataset.from_packed() or gds::Dataset in C++.
+"""
+
+import argparse
+import csv
+import os
+import sys
+
+
+def pack_mini_world(run_dir, out_path):
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                    '..', 'examples', 'mini-world', 'generator'))
+    from seq_writer import DatasetWriter
+
+    counts = {}
+    with open(os.path.join(run_dir, 'labels', 'labels_counts.csv'), newline='', encoding='utf-8') as f:
+        for row in csv.DictReader(f):
+            counts.setdefault(int(row['clip_id']), int(row['true_count']))
+
+    w = DatasetWriter()
+    seq_dir = os.path.join(run_dir, 'seq')
+    for clip_id in sorted(counts):
+        name = f'clip_{clip_id:05d}'
+        path = os.path.join(seq_dir, name + '.seq')
+        if not os.path.exists(path):
+            print(f'Warning: missing {path}', file=sys.stderr)
+            continue
+        rows, loop = [], False
+        with open(path, encoding='utf-8') as f:
+            for line in f:
+                parts = line.split()
+                if not parts or parts[0].startswith('#'):
+                    continue
+                if parts[0] == 'LOOP':
+                    loop = len(parts) > 1 and parts[1] in ('true', '1')
+                elif parts[0] == 'EVENT' and len(parts) >= 4:
+                    rows.append((int(parts[1]), parts[2], float(parts[3])))
+                elif parts[0][0].isdigit() and len(parts) >= 3:
+                    rows.append((int(parts[0]), parts[1], float(parts[2])))
+        w.add(rows, label=f'O{counts[clip_id]}', name=name, loop=loop)
+    w.write(out_path)
+    return len(w)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('input', help='dataset directory (labels.csv or mini-world run)')
+    ap.add_argument('output', help='output .gds path')
+    args = ap.parse_args()
+
+    if os.path.exists(os.path.join(args.input, 'labels.csv')):
+        import glia
+        n = glia._core.pack_labels_csv(args.input, args.output)
+    elif os.path.exists(os.path.join(args.input, 'labels', 'labels_counts.csv')):
+        n = pack_mini_world(args.input, args.output)
+    else:
+        print(f'Error: no labels.csv or labels/labels_counts.csv in {args.input}', file=sys.stderr)
+        return 1
+    print(f'{args.input} -> {args.output}: {n} episodes')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())